@@ -12,6 +12,7 @@ using Dates
 using DataFrames
 using HTTP
 using JSON3
+using Libdl
 using Oxygen
 using Parquet2
 using Tables
@@ -20,11 +21,13 @@ using UUIDs
 
 export Config, load_config
 export FormBDClient, Document, fetch_collection, fetch_document, extract_prompt_scores, extract_timestamp, health_check
+export EngineExporter, ColumnBatch, open_engine, close_engine, export_columnar, decode_batch
 export ColumnarStore, sync!, load!, query, stats, prompt_stats, prompt_distribution, time_series, contributors
 export serve
 
 include("config.jl")
 include("formbd_client.jl")
+include("engine_export.jl")
 include("columnar_store.jl")
 include("analytics.jl")
 include("api.jl")
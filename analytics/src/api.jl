@@ -10,6 +10,7 @@ mutable struct AppState
     client::FormBDClient
     store::ColumnarStore
     config::Config
+    engine::Union{EngineExporter,Nothing}
 end
 
 # Global state (Oxygen uses global handlers)
@@ -30,7 +31,13 @@ function serve(config::Config)
         load!(store, collection)
     end
 
-    APP_STATE[] = AppState(client, store, config)
+    engine = if !isempty(config.formbd.engine_library) && !isempty(config.formbd.database)
+        open_engine(config.formbd.engine_library, config.formbd.database; fields=config.formbd.export_fields)
+    else
+        nothing
+    end
+
+    APP_STATE[] = AppState(client, store, config, engine)
 
     @info "FormBD-Analytics starting" host=config.server.host port=config.server.port
 
@@ -80,7 +87,11 @@ function serve(config::Config)
         start_time = now()
 
         try
-            rows = sync!(state.store, state.client, string(collection); mode=mode)
+            rows = if isnothing(state.engine)
+                sync!(state.store, state.client, string(collection); mode=mode)
+            else
+                sync!(state.store, state.engine, string(collection); mode=mode)
+            end
             duration = now() - start_time
 
             return Dict(
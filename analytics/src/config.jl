@@ -9,6 +9,12 @@ FormBD connection configuration
 Base.@kwdef struct FormBDConfig
     api_url::String = "http://localhost:8080"
     collections::Vector{String} = ["evidence"]
+    # Sync through the engine's columnar export when both are set: the
+    # bridge library and the database file it opens
+    engine_library::String = ""
+    database::String = ""
+    # Member paths the columnar export reads from each document
+    export_fields::Vector{String} = String[]
 end
 
 """
@@ -61,7 +67,10 @@ function load_config(path::String)::Config
         f = data["formbd"]
         FormBDConfig(
             api_url = get(f, "api_url", "http://localhost:8080"),
-            collections = get(f, "collections", ["evidence"])
+            collections = get(f, "collections", ["evidence"]),
+            engine_library = get(f, "engine_library", ""),
+            database = get(f, "database", ""),
+            export_fields = get(f, "export_fields", String[])
         )
     else
         FormBDConfig()
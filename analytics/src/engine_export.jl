@@ -0,0 +1,197 @@
+# SPDX-License-Identifier: PMPL-1.0-or-later
+"""
+Columnar export straight from the engine through the bridge C ABI
+(fdb_export_columnar in generated/abi/bridge.h)
+"""
+
+# FdbStatus values used here
+const FDB_OK = Cint(0)
+const FDB_ERR_NOT_FOUND = Cint(2)
+
+"""
+Owned byte buffer passed across the FFI boundary (LgBlob)
+"""
+struct LgBlob
+    ptr::Ptr{UInt8}
+    len::Csize_t
+end
+
+LgBlob() = LgBlob(C_NULL, 0)
+
+"""
+An open engine database exporting through the bridge library
+"""
+mutable struct EngineExporter
+    library::Ptr{Cvoid}
+    db::Ptr{Cvoid}
+    fields::Vector{String}
+end
+
+"""
+One fdb_export_columnar batch: rows written after `since`, up to `sequence`
+"""
+struct ColumnBatch
+    since::UInt64
+    sequence::UInt64
+    deleted::Vector{Int64}
+    columns::DataFrame
+end
+
+"""
+    open_engine(library::String, database::String; fields=String[]) -> EngineExporter
+
+Load the bridge library and open the database file. `fields` are the member
+paths exported for every collection.
+"""
+function open_engine(library::String, database::String; fields::Vector{String}=String[])::EngineExporter
+    lib = Libdl.dlopen(library)
+    db = Ref{Ptr{Cvoid}}(C_NULL)
+    err = Ref(LgBlob())
+    status = ccall(Libdl.dlsym(lib, :fdb_db_open), Cint,
+        (Ptr{UInt8}, Csize_t, Ptr{UInt8}, Csize_t, Ref{Ptr{Cvoid}}, Ref{LgBlob}),
+        database, sizeof(database), C_NULL, 0, db, err)
+    status == FDB_OK || error("fdb_db_open failed ($status): $(take_blob!(lib, err))")
+    return EngineExporter(lib, db[], fields)
+end
+
+"""
+    close_engine(engine::EngineExporter)
+
+Close the database opened by `open_engine`.
+"""
+function close_engine(engine::EngineExporter)
+    if engine.db != C_NULL
+        ccall(Libdl.dlsym(engine.library, :fdb_db_close), Cint, (Ptr{Cvoid},), engine.db)
+        engine.db = C_NULL
+    end
+    return nothing
+end
+
+# Copy a blob's bytes into Julia memory and free it
+function take_blob!(lib::Ptr{Cvoid}, blob::Ref{LgBlob})::Vector{UInt8}
+    blob[].ptr == C_NULL && return UInt8[]
+    bytes = copy(unsafe_wrap(Vector{UInt8}, blob[].ptr, blob[].len))
+    ccall(Libdl.dlsym(lib, :fdb_blob_free), Cvoid, (Ref{LgBlob},), blob)
+    return bytes
+end
+
+"""
+    export_columnar(engine::EngineExporter, collection::String; since_seq=0) -> Union{ColumnBatch,Nothing}
+
+Export `collection` in full (`since_seq` 0) or only the blocks written after
+`since_seq`. Returns nothing when the journal no longer reaches `since_seq`,
+in which case the caller exports in full.
+"""
+function export_columnar(engine::EngineExporter, collection::String; since_seq::Integer=0)
+    fields = join(engine.fields, ",")
+    batch = Ref(LgBlob())
+    err = Ref(LgBlob())
+    status = ccall(Libdl.dlsym(engine.library, :fdb_export_columnar), Cint,
+        (Ptr{Cvoid}, Ptr{UInt8}, Csize_t, Ptr{UInt8}, Csize_t, UInt64, Ref{LgBlob}, Ref{LgBlob}),
+        engine.db, collection, sizeof(collection), fields, sizeof(fields), UInt64(since_seq), batch, err)
+    message = String(take_blob!(engine.library, err))
+    status == FDB_ERR_NOT_FOUND && return nothing
+    status == FDB_OK || error("fdb_export_columnar failed ($status): $message")
+    return decode_batch(take_blob!(engine.library, batch))
+end
+
+"""
+    decode_batch(bytes::Vector{UInt8}) -> ColumnBatch
+
+Turn a CBOR batch into a DataFrame, one column per exported field. Column
+buffers are Arrow-layout little-endian arrays and are reinterpreted, not
+parsed; null rows become `missing`.
+"""
+function decode_batch(bytes::Vector{UInt8})::ColumnBatch
+    root, _ = read_cbor(bytes, 1)
+    columns = DataFrame()
+    for col in root["columns"]
+        columns[!, col["name"]] = column_values(col, Int(root["rows"]))
+    end
+    deleted = Int64[ltoh(x) for x in reinterpret(Int64, root["deleted"])]
+    return ColumnBatch(root["since"], root["sequence"], deleted, columns)
+end
+
+function column_values(col::Dict{String,Any}, rows::Int)
+    kind = col["type"]
+    values = col["values"]
+    valid = col["validity"]
+    isvalid(i) = isempty(valid) || (valid[(i - 1) >> 3 + 1] >> ((i - 1) & 7)) & 0x01 == 0x01
+
+    data = if kind == "int64"
+        Int64[ltoh(x) for x in reinterpret(Int64, values)]
+    elseif kind == "float64"
+        Float64[ltoh(x) for x in reinterpret(Float64, values)]
+    elseif kind == "bool"
+        Bool[(values[(i - 1) >> 3 + 1] >> ((i - 1) & 7)) & 0x01 == 0x01 for i in 1:rows]
+    elseif kind == "utf8"
+        offsets = Int32[ltoh(x) for x in reinterpret(Int32, col["offsets"])]
+        String[String(values[offsets[i] + 1:offsets[i + 1]]) for i in 1:rows]
+    else
+        return fill(missing, rows)
+    end
+
+    col["null_count"] == 0 && return data
+    return Union{Missing,eltype(data)}[isvalid(i) ? data[i] : missing for i in 1:rows]
+end
+
+# Minimal CBOR reader for batches: unsigned, negative, bytes, text, arrays,
+# maps with text keys, simple values and floats. Returns (value, next_pos).
+function read_cbor(bytes::Vector{UInt8}, pos::Int)
+    initial = bytes[pos]
+    major = initial >> 5
+    info = initial & 0x1f
+    pos += 1
+
+    if major == 7
+        info == 20 && return (false, pos)
+        info == 21 && return (true, pos)
+        info == 22 && return (nothing, pos)
+        info == 25 && return (Float64(reinterpret(Float16, read_be(UInt16, bytes, pos))), pos + 2)
+        info == 26 && return (Float64(reinterpret(Float32, read_be(UInt32, bytes, pos))), pos + 4)
+        info == 27 && return (reinterpret(Float64, read_be(UInt64, bytes, pos)), pos + 8)
+        return (nothing, pos)
+    end
+
+    arg, pos = if info < 24
+        (UInt64(info), pos)
+    elseif info == 24
+        (UInt64(bytes[pos]), pos + 1)
+    elseif info == 25
+        (UInt64(read_be(UInt16, bytes, pos)), pos + 2)
+    elseif info == 26
+        (UInt64(read_be(UInt32, bytes, pos)), pos + 4)
+    elseif info == 27
+        (read_be(UInt64, bytes, pos), pos + 8)
+    else
+        error("Unsupported CBOR argument $info")
+    end
+
+    if major == 0
+        return (arg, pos)
+    elseif major == 1
+        return (-1 - Int64(arg), pos)
+    elseif major == 2
+        return (bytes[pos:pos + Int(arg) - 1], pos + Int(arg))
+    elseif major == 3
+        return (String(bytes[pos:pos + Int(arg) - 1]), pos + Int(arg))
+    elseif major == 4
+        items = Vector{Any}(undef, arg)
+        for i in 1:arg
+            items[i], pos = read_cbor(bytes, pos)
+        end
+        return (items, pos)
+    elseif major == 5
+        map = Dict{String,Any}()
+        for _ in 1:arg
+            key, pos = read_cbor(bytes, pos)
+            map[key], pos = read_cbor(bytes, pos)
+        end
+        return (map, pos)
+    end
+    # Tags: the tagged item stands for itself
+    return read_cbor(bytes, pos)
+end
+
+read_be(::Type{T}, bytes::Vector{UInt8}, pos::Int) where {T} =
+    ntoh(reinterpret(T, bytes[pos:pos + sizeof(T) - 1])[1])
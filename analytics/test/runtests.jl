@@ -62,6 +62,38 @@ using Dates
         @test isnothing(extract_prompt_scores(doc_no_prompt))
     end
 
+    @testset "Columnar batch decoding" begin
+        # Just enough CBOR to write a batch as fdb_export_columnar does
+        head(major, n) = n < 24 ? UInt8[major << 5 | n] : UInt8[major << 5 | 24, n]
+        text(s) = vcat(head(3, sizeof(s)), Vector{UInt8}(s))
+        bytes(b) = vcat(head(2, length(b)), b)
+        le(xs) = collect(reinterpret(UInt8, htol.(xs)))
+        column(name, kind, nulls, validity, values, offsets=UInt8[]) = vcat(
+            head(5, 7),
+            text("name"), text(name), text("type"), text(kind),
+            text("null_count"), head(0, nulls), text("mismatched"), head(0, 0),
+            text("validity"), bytes(validity), text("values"), bytes(values),
+            text("offsets"), bytes(offsets))
+
+        batch = vcat(
+            head(5, 5),
+            text("since"), head(0, 3), text("sequence"), head(0, 9),
+            text("rows"), head(0, 2), text("deleted"), bytes(le(Int64[4])),
+            text("columns"), head(4, 3),
+            column("_id", "int64", 0, UInt8[], le(Int64[5, 6])),
+            column("score", "float64", 1, UInt8[0x02], le([0.0, 2.5])),
+            column("title", "utf8", 0, UInt8[], Vector{UInt8}("ab"), le(Int32[0, 1, 2])))
+
+        decoded = decode_batch(batch)
+        @test decoded.since == 3
+        @test decoded.sequence == 9
+        @test decoded.deleted == [4]
+        @test decoded.columns._id == [5, 6]
+        @test ismissing(decoded.columns.score[1])
+        @test decoded.columns.score[2] == 2.5
+        @test decoded.columns.title == ["a", "b"]
+    end
+
     @testset "Timestamp extraction" begin
         # Test provenance timestamp
         doc = Document(
@@ -18,14 +18,26 @@ pub const binary = extern struct {
 // Resource type (opaque)
 pub const resource_type = opaque {};
 
+// Local process identifier (ErlNifPid)
+pub const pid = extern struct {
+    pid: term,
+};
+
+// NIF function signature
+pub const NifFn = fn (?*env, c_int, [*c]const term) callconv(.c) term;
+
 // NIF function pointer
 pub const ErlNifFunc = extern struct {
     name: [*:0]const u8,
     arity: c_uint,
-    fptr: *const fn (?*env, c_int, [*c]const term) callconv(.c) term,
+    fptr: *const NifFn,
     flags: c_uint,
 };
 
+// ErlNifFunc.flags / enif_schedule_nif flags: run on a dirty scheduler
+pub const ERL_NIF_DIRTY_JOB_CPU_BOUND: c_uint = 1;
+pub const ERL_NIF_DIRTY_JOB_IO_BOUND: c_uint = 2;
+
 // Resource type initialization
 pub const ErlNifResourceTypeInit = extern struct {
     dtor: ?*const fn (?*env, ?*anyopaque) callconv(.c) void,
@@ -69,6 +81,7 @@ extern fn enif_get_resource(env: ?*env, t: term, resource_type: ?*resource_type,
 extern fn enif_alloc_resource(resource_type: ?*resource_type, size: usize) callconv(.c) ?*anyopaque;
 extern fn enif_release_resource(obj: *anyopaque) callconv(.c) void;
 extern fn enif_make_resource(env: ?*env, obj: *anyopaque) callconv(.c) term;
+extern fn enif_make_resource_binary(env: ?*env, obj: *anyopaque, data: ?*const anyopaque, size: usize) callconv(.c) term;
 // Destructor function type for resources
 pub const ErlNifResourceDtor = fn (?*env, ?*anyopaque) callconv(.c) void;
 
@@ -76,6 +89,14 @@ extern fn enif_open_resource_type(env: ?*env, module_str: ?[*:0]const u8, name:
 extern fn enif_inspect_binary(env: ?*env, term: term, bin: *binary) callconv(.c) c_int;
 extern fn enif_alloc_binary(size: usize, bin: *binary) callconv(.c) c_int;
 extern fn enif_make_binary(env: ?*env, bin: *const binary) callconv(.c) term;
+extern fn enif_schedule_nif(env: ?*env, fun_name: [*:0]const u8, flags: c_int, fp: *const NifFn, argc: c_int, argv: [*c]const term) callconv(.c) term;
+extern fn enif_consume_timeslice(env: ?*env, percent: c_int) callconv(.c) c_int;
+extern fn enif_get_map_value(env: ?*env, map: term, key: term, value: *term) callconv(.c) c_int;
+extern fn enif_self(env: ?*env, p: *pid) callconv(.c) ?*pid;
+extern fn enif_alloc_env() callconv(.c) ?*env;
+extern fn enif_free_env(env: *env) callconv(.c) void;
+extern fn enif_make_copy(dst_env: ?*env, src_term: term) callconv(.c) term;
+extern fn enif_send(caller_env: ?*env, to_pid: *const pid, msg_env: ?*env, msg: term) callconv(.c) c_int;
 
 // C helper functions (from nif_helpers.c - wrappers for inline functions)
 extern fn nif_make_tuple2(env: ?*env, t1: term, t2: term) callconv(.c) term;
@@ -141,6 +162,77 @@ pub fn alloc_resource(e: ?*env, obj: anytype, rt: ?*resource_type) !term {
     return enif_make_resource(e, res_ptr);
 }
 
+/// Allocate an uninitialised resource; hand it to the BEAM with
+/// make_owned_resource or free it with enif_release_resource
+pub fn new_resource(comptime T: type, rt: ?*resource_type) !*T {
+    const res_ptr = enif_alloc_resource(rt, @sizeOf(T)) orelse return error.AllocFailed;
+    // SAFETY: see alloc_resource; BEAM resources are max_align_t aligned
+    return @ptrCast(@alignCast(res_ptr));
+}
+
+/// Make a term for `obj` and drop our reference: the resource is freed
+/// (running its destructor) once no term refers to it
+pub fn make_owned_resource(e: ?*env, obj: *anyopaque) term {
+    const t = enif_make_resource(e, obj);
+    enif_release_resource(obj);
+    return t;
+}
+
+/// A binary over `data` (owned by resource `obj`) without copying it: the
+/// resource lives as long as the binary does. Drops our reference, as
+/// make_owned_resource does.
+pub fn make_owned_resource_binary(e: ?*env, obj: *anyopaque, data: []const u8) term {
+    const t = enif_make_resource_binary(e, obj, data.ptr, data.len);
+    enif_release_resource(obj);
+    return t;
+}
+
+/// Continue in `fp` with new arguments, on a dirty scheduler if `flags`
+/// asks for one. Returned by a NIF in place of its result.
+pub fn schedule_nif(e: ?*env, name: [*:0]const u8, flags: c_uint, fp: *const NifFn, args: []const term) term {
+    return enif_schedule_nif(e, name, @intCast(flags), fp, @intCast(args.len), args.ptr);
+}
+
+/// Report `percent` of the timeslice used; true once it is exhausted and
+/// the NIF should reschedule itself. Not for dirty NIFs.
+pub fn consume_timeslice(e: ?*env, percent: c_int) bool {
+    return enif_consume_timeslice(e, percent) != 0;
+}
+
+/// Value under atom key `key` if `map` is a map holding it
+pub fn get_map_value(e: ?*env, map: term, key: [*:0]const u8) ?term {
+    var value: term = undefined;
+    if (enif_get_map_value(e, map, enif_make_atom(e, key), &value) == 0) return null;
+    return value;
+}
+
+/// The calling process
+pub fn self_pid(e: ?*env) pid {
+    var p: pid = undefined;
+    _ = enif_self(e, &p);
+    return p;
+}
+
+/// A process-independent environment, for messages built off-scheduler
+pub fn alloc_env() !*env {
+    return enif_alloc_env() orelse error.AllocFailed;
+}
+
+pub fn free_env(e: *env) void {
+    enif_free_env(e);
+}
+
+/// Copy `t` into `dst` so it outlives the NIF call it came from
+pub fn make_copy(dst: ?*env, t: term) term {
+    return enif_make_copy(dst, t);
+}
+
+/// Send `msg` (built in `msg_env`) from a thread that is not a scheduler;
+/// false if the receiver is not alive
+pub fn send(to: *const pid, msg_env: ?*env, msg: term) bool {
+    return enif_send(null, to, msg_env, msg) != 0;
+}
+
 pub fn open_resource_type(e: ?*env, name: [*:0]const u8, dtor: ?*const ErlNifResourceDtor) !?*resource_type {
     const rt = enif_open_resource_type(e, null, name, dtor, ERL_NIF_RT_CREATE | ERL_NIF_RT_TAKEOVER, null);
     return rt orelse error.OpenFailed;
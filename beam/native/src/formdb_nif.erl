@@ -11,10 +11,14 @@
     db_close/1,
     txn_begin/2,
     txn_commit/1,
+    txn_commit_async/2,
     txn_abort/1,
     apply/2,
     schema/1,
-    journal/2
+    stats/1,
+    journal/2,
+    scan/2,
+    read_block/2
 ]).
 
 -on_load(init/0).
@@ -36,7 +40,14 @@ init() ->
             Dir
     end,
     SoPath = filename:join(PrivDir, "formdb_nif"),
-    erlang:load_nif(SoPath, 0).
+    erlang:load_nif(SoPath, load_info()).
+
+%% NIF options from the application environment. scan_mode picks how
+%% journal/2 and scan/2 avoid blocking a normal scheduler: yield (page at
+%% a time, rescheduling when the timeslice is spent) or dirty (run on a
+%% dirty CPU scheduler). Commit, open and close always use dirty I/O.
+load_info() ->
+    #{scan_mode => application:get_env(formdb, nif_scan_mode, yield)}.
 
 %% @doc Get FormDB version as {Major, Minor, Patch}
 -spec version() -> {non_neg_integer(), non_neg_integer(), non_neg_integer()}.
@@ -72,6 +83,15 @@ txn_begin(_DbRef, _Mode) ->
 txn_commit(_TxnRef) ->
     ?NIF_NOT_LOADED.
 
+%% @doc Queue a transaction for commit and return without waiting
+%% @param TxnRef Transaction reference
+%% @param Ref Tag echoed in the completion message
+%% @returns ok | {error, Reason}; the caller later receives
+%%          {lithoglyph_commit, Ref, ok | {error, Reason}}
+-spec txn_commit_async(reference(), term()) -> ok | {error, atom()}.
+txn_commit_async(_TxnRef, _Ref) ->
+    ?NIF_NOT_LOADED.
+
 %% @doc Abort a transaction
 %% @param TxnRef Transaction reference
 %% @returns ok
@@ -98,6 +118,14 @@ apply(_TxnRef, _OpCbor) ->
 schema(_DbRef) ->
     ?NIF_NOT_LOADED.
 
+%% @doc Get engine statistics: block and byte counters, fsyncs, CRC
+%% failures, cache hits and misses, and a histogram per commit phase
+%% @param DbRef Database reference
+%% @returns {ok, StatsJson} | {error, Reason}
+-spec stats(reference()) -> {ok, binary()} | {error, atom()}.
+stats(_DbRef) ->
+    ?NIF_NOT_LOADED.
+
 %% @doc Get journal entries since a sequence number
 %% @param DbRef Database reference
 %% @param Since Sequence number to start from
@@ -105,3 +133,20 @@ schema(_DbRef) ->
 -spec journal(reference(), non_neg_integer()) -> {ok, binary()} | {error, atom()}.
 journal(_DbRef, _Since) ->
     ?NIF_NOT_LOADED.
+
+%% @doc Read every live block of one type
+%% @param DbRef Database reference
+%% @param BlockType Block type code (17 for documents)
+%% @returns {ok, JsonLines} (one JSON object per line) | {error, Reason}
+-spec scan(reference(), non_neg_integer()) -> {ok, binary()} | {error, atom()}.
+scan(_DbRef, _BlockType) ->
+    ?NIF_NOT_LOADED.
+
+%% @doc Read one document without copying it out of the page cache
+%% @param DbRef Database reference
+%% @param BlockId Document block ID
+%% @returns {ok, Binary} | {error, Reason}. The binary borrows the
+%%          engine's buffer; binary:copy/1 it before holding it long term.
+-spec read_block(reference(), non_neg_integer()) -> {ok, binary()} | {error, atom()}.
+read_block(_DbRef, _BlockId) ->
+    ?NIF_NOT_LOADED.
@@ -27,6 +27,9 @@ const FdbDb = opaque {};
 /// Opaque transaction handle from the core bridge
 const FdbTxn = opaque {};
 
+/// Opaque block scan cursor from the core bridge
+const FdbCursor = opaque {};
+
 /// Owned byte buffer passed across the FFI boundary
 const LgBlob = extern struct {
     ptr: ?[*]const u8,
@@ -34,6 +37,12 @@ const LgBlob = extern struct {
 };
 
 /// Result type for operations returning data + provenance
+const LgView = extern struct {
+    ptr: ?[*]const u8,
+    len: usize,
+    token: u64,
+};
+
 const LgResult = extern struct {
     data: LgBlob,
     provenance: LgBlob,
@@ -49,7 +58,7 @@ const LgTxnMode = enum(c_int) {
 
 /// Render options for introspection functions
 const LgRenderOpts = extern struct {
-    format: c_int, // 0 = JSON
+    format: c_int, // 0 = JSON, 1 = CBOR
     include_metadata: bool,
 };
 
@@ -93,6 +102,15 @@ extern fn fdb_txn_commit(txn: *FdbTxn, out_err: *LgBlob) callconv(.c) c_int;
 
 extern fn fdb_txn_abort(txn: *FdbTxn) callconv(.c) c_int;
 
+const LgCommitCallback = *const fn (ctx: ?*anyopaque, status: c_int, err: LgBlob) callconv(.c) void;
+
+extern fn fdb_txn_commit_async(
+    txn: *FdbTxn,
+    callback: LgCommitCallback,
+    ctx: ?*anyopaque,
+    out_err: *LgBlob,
+) callconv(.c) c_int;
+
 extern fn fdb_apply(
     txn: *FdbTxn,
     op_ptr: [*]const u8,
@@ -105,6 +123,12 @@ extern fn fdb_introspect_schema(
     out_err: *LgBlob,
 ) callconv(.c) c_int;
 
+extern fn fdb_stats(
+    db: *FdbDb,
+    out_stats: *LgBlob,
+    out_err: *LgBlob,
+) callconv(.c) c_int;
+
 extern fn fdb_render_journal(
     db: *FdbDb,
     since: u64,
@@ -113,6 +137,41 @@ extern fn fdb_render_journal(
     out_err: *LgBlob,
 ) callconv(.c) c_int;
 
+extern fn fdb_journal_read(
+    db: *FdbDb,
+    start_seq: u64,
+    count: u64,
+    buf: [*]u8,
+    buf_len: usize,
+    written: *usize,
+) callconv(.c) c_int;
+
+extern fn fdb_cursor_open_blocks(
+    db: *FdbDb,
+    block_type: u16,
+    opts: LgRenderOpts,
+    out_cursor: *?*FdbCursor,
+    out_err: *LgBlob,
+) callconv(.c) c_int;
+
+extern fn fdb_cursor_next(
+    cursor: *FdbCursor,
+    buf: [*]u8,
+    buf_len: usize,
+    written: *usize,
+) callconv(.c) c_int;
+
+extern fn fdb_cursor_close(cursor: ?*FdbCursor) callconv(.c) void;
+
+extern fn fdb_read_block_view(
+    db: *FdbDb,
+    block_id: u64,
+    out_view: *LgView,
+    out_err: *LgBlob,
+) callconv(.c) c_int;
+
+extern fn fdb_view_release(view: *LgView) callconv(.c) void;
+
 extern fn fdb_blob_free(blob: *LgBlob) callconv(.c) void;
 
 extern fn fdb_version() callconv(.c) u32;
@@ -144,6 +203,20 @@ const allocator = gpa.allocator();
 // Resource types (initialized in nif_init)
 var db_handle_type: ?*beam.resource_type = undefined;
 var txn_handle_type: ?*beam.resource_type = undefined;
+var scan_type: ?*beam.resource_type = undefined;
+var view_type: ?*beam.resource_type = undefined;
+
+/// How journal/2 and scan/2 keep long reads off the normal schedulers,
+/// chosen at load time: erlang:load_nif(Path, #{scan_mode => yield | dirty})
+const ScanMode = enum {
+    /// Read a page at a time on the calling scheduler, rescheduling via
+    /// enif_schedule_nif whenever the timeslice is used up
+    yield,
+    /// Hand the whole read to a dirty CPU scheduler
+    dirty,
+};
+
+var scan_mode: ScanMode = .yield;
 
 // Database handle wrapper — holds an opaque FdbDb pointer from the core bridge.
 const DbHandle = struct {
@@ -409,7 +482,7 @@ export fn txn_commit(env: ?*beam.env, argc: c_int, argv: [*c]const beam.term) be
     const txn: *TxnHandle = @ptrCast(@alignCast(txn_ptr));
 
     // Commit the transaction via the core bridge C ABI (fdb_txn_commit).
-    // This executes the 6-phase WAL: journal -> sync -> blocks -> deletes -> superblock -> sync.
+    // This executes the group commit: journal + blocks + deletes -> sync -> superblock -> sync.
     var out_err: LgBlob = .{ .ptr = null, .len = 0 };
     const status = fdb_txn_commit(txn.fdb_txn, &out_err);
 
@@ -429,6 +502,108 @@ export fn txn_commit(env: ?*beam.env, argc: c_int, argv: [*c]const beam.term) be
     return beam.make_atom(env, "ok");
 }
 
+/// Queue a transaction on the bridge's writer pool and return at once.
+/// Parameters: TxnRef, Ref (any term, echoed back)
+/// Returns: ok | {error, Reason}; later the caller receives
+/// {lithoglyph_commit, Ref, ok | {error, Reason}}
+export fn txn_commit_async(env: ?*beam.env, argc: c_int, argv: [*c]const beam.term) beam.term {
+    if (argc != 2) {
+        return beam.make_badarg(env);
+    }
+
+    // Get transaction handle
+    const txn_ptr = beam.get_resource(env, argv[0], TxnHandle, txn_handle_type) catch {
+        return beam.make_tuple2(env,
+            beam.make_atom(env, "error"),
+            beam.make_atom(env, "invalid_handle")
+        );
+    };
+
+    // SAFETY: txn_ptr comes from beam.get_resource() which retrieves the pointer
+    // originally stored by beam.alloc_resource() in txn_begin. The NIF resource
+    // system guarantees the pointer is valid while the resource reference is live.
+    // Alignment is met because TxnHandle was heap-allocated by allocator.create().
+    const txn: *TxnHandle = @ptrCast(@alignCast(txn_ptr));
+
+    const reply = CommitReply.init(env, argv[1]) catch {
+        return beam.make_tuple2(env,
+            beam.make_atom(env, "error"),
+            beam.make_atom(env, "alloc_failed"),
+        );
+    };
+
+    var out_err: LgBlob = .{ .ptr = null, .len = 0 };
+    const status = fdb_txn_commit_async(txn.fdb_txn, commit_done, reply, &out_err);
+
+    // Free error blob regardless of outcome
+    if (out_err.ptr != null) fdb_blob_free(&out_err);
+
+    // Clean up the Zig-side wrapper regardless of commit outcome
+    allocator.destroy(txn);
+
+    if (status != @intFromEnum(FdbStatus.ok)) {
+        // Not queued, so the callback will never run
+        reply.deinit();
+        return beam.make_tuple2(env,
+            beam.make_atom(env, "error"),
+            beam.make_atom(env, status_to_atom(status)),
+        );
+    }
+
+    return beam.make_atom(env, "ok");
+}
+
+/// Where an async commit reports to: the calling process and its Ref,
+/// copied into an environment of our own
+const CommitReply = struct {
+    msg_env: *beam.env,
+    to: beam.pid,
+    ref: beam.term,
+
+    fn init(env: ?*beam.env, ref: beam.term) !*CommitReply {
+        const reply = try allocator.create(CommitReply);
+        const msg_env = beam.alloc_env() catch |err| {
+            allocator.destroy(reply);
+            return err;
+        };
+        reply.* = .{
+            .msg_env = msg_env,
+            .to = beam.self_pid(env),
+            .ref = beam.make_copy(msg_env, ref),
+        };
+        return reply;
+    }
+
+    fn deinit(self: *CommitReply) void {
+        beam.free_env(self.msg_env);
+        allocator.destroy(self);
+    }
+};
+
+/// fdb_txn_commit_async completion, on a bridge writer thread
+fn commit_done(ctx: ?*anyopaque, status: c_int, err: LgBlob) callconv(.c) void {
+    // SAFETY: ctx is the CommitReply passed to fdb_txn_commit_async by
+    // txn_commit_async, which allocator.create() aligned; the bridge calls
+    // this exactly once, so nothing else frees it.
+    const reply: *CommitReply = @ptrCast(@alignCast(ctx.?));
+    defer reply.deinit();
+
+    var err_blob = err;
+    if (err_blob.ptr != null) fdb_blob_free(&err_blob);
+
+    const e = reply.msg_env;
+    const result = if (status == @intFromEnum(FdbStatus.ok))
+        beam.make_atom(e, "ok")
+    else
+        beam.make_tuple2(e,
+            beam.make_atom(e, "error"),
+            beam.make_atom(e, status_to_atom(status)),
+        );
+
+    // A caller that has exited simply misses the message
+    _ = beam.send(&reply.to, e, beam.make_tuple3(e, beam.make_atom(e, "lithoglyph_commit"), reply.ref, result));
+}
+
 /// Abort a transaction, discarding all buffered operations.
 /// Parameters: TxnRef
 /// Returns: ok | {error, Reason}
@@ -663,7 +838,59 @@ export fn schema(env: ?*beam.env, argc: c_int, argv: [*c]const beam.term) beam.t
     );
 }
 
-/// Get journal entries since a sequence number via the core bridge (fdb_render_journal).
+/// Get engine statistics via the core bridge (fdb_stats): I/O counters,
+/// cache hits and misses, and per-phase commit histograms.
+/// Parameters: DbRef
+/// Returns: {ok, StatsJson} | {error, Reason}
+export fn stats(env: ?*beam.env, argc: c_int, argv: [*c]const beam.term) beam.term {
+    if (argc != 1) {
+        return beam.make_badarg(env);
+    }
+
+    const db_ptr = beam.get_resource(env, argv[0], DbHandle, db_handle_type) catch {
+        return beam.make_tuple2(env,
+            beam.make_atom(env, "error"),
+            beam.make_atom(env, "invalid_handle"),
+        );
+    };
+
+    // SAFETY: db_ptr comes from beam.get_resource() which retrieves the pointer
+    // originally stored by beam.alloc_resource() in db_open. Alignment is met
+    // because DbHandle was heap-allocated by allocator.create(DbHandle).
+    const db: *DbHandle = @ptrCast(@alignCast(db_ptr));
+
+    var out_stats: LgBlob = .{ .ptr = null, .len = 0 };
+    var out_err: LgBlob = .{ .ptr = null, .len = 0 };
+
+    const status = fdb_stats(db.fdb, &out_stats, &out_err);
+    if (out_err.ptr != null) fdb_blob_free(&out_err);
+
+    if (status != @intFromEnum(FdbStatus.ok)) {
+        if (out_stats.ptr != null) fdb_blob_free(&out_stats);
+        return beam.make_tuple2(env,
+            beam.make_atom(env, "error"),
+            beam.make_atom(env, status_to_atom(status)),
+        );
+    }
+    defer fdb_blob_free(&out_stats);
+
+    // SAFETY: on success the bridge always returns a non-empty JSON document,
+    // valid until fdb_blob_free() is called.
+    const stats_bin = beam.make_binary(env, out_stats.ptr.?[0..out_stats.len]) catch {
+        return beam.make_tuple2(env,
+            beam.make_atom(env, "error"),
+            beam.make_atom(env, "alloc_failed"),
+        );
+    };
+
+    return beam.make_tuple2(env,
+        beam.make_atom(env, "ok"),
+        stats_bin,
+    );
+}
+
+/// Get journal entries after a sequence number via the core bridge
+/// (fdb_journal_read, a page at a time; see ScanMode).
 /// Parameters: DbRef, Since (integer)
 /// Returns: {ok, JournalJson} | {error, Reason}
 export fn journal(env: ?*beam.env, argc: c_int, argv: [*c]const beam.term) beam.term {
@@ -686,71 +913,314 @@ export fn journal(env: ?*beam.env, argc: c_int, argv: [*c]const beam.term) beam.
     const db: *DbHandle = @ptrCast(@alignCast(db_ptr));
 
     // Get the 'since' sequence number
-    var since_val: c_int = undefined;
-    // Use beam.make_int to check — we need to extract the integer from term.
-    // The NIF C API provides enif_get_int for this.
-    since_val = nif_get_int(env, argv[1]) orelse {
+    const since_val = nif_get_int(env, argv[1]) orelse {
         return beam.make_badarg(env);
     };
 
-    const since: u64 = if (since_val >= 0)
-        @intCast(since_val)
-    else
-        0; // Negative since is treated as "from the beginning"
+    // Since is the last sequence already seen and fdb_journal_read starts
+    // inclusively, so resume one past it; 0 or negative reads from the start
+    const start_seq: u64 = if (since_val > 0) @as(u64, @intCast(since_val)) + 1 else 0;
+
+    return Scan.start(env, "journal", .{ .journal = .{ .db = db.fdb, .next_seq = start_seq } });
+}
+
+/// Scan every live block of one type via the core bridge (fdb_cursor_open_blocks).
+/// Rows are read a page at a time; see ScanMode.
+/// Parameters: DbRef, BlockType (integer, e.g. 17 for documents)
+/// Returns: {ok, JsonLines} | {error, Reason}
+export fn scan(env: ?*beam.env, argc: c_int, argv: [*c]const beam.term) beam.term {
+    if (argc != 2) {
+        return beam.make_badarg(env);
+    }
+
+    const db_ptr = beam.get_resource(env, argv[0], DbHandle, db_handle_type) catch {
+        return beam.make_tuple2(env,
+            beam.make_atom(env, "error"),
+            beam.make_atom(env, "invalid_handle"),
+        );
+    };
 
-    // Render journal entries via the core bridge
-    const opts: LgRenderOpts = .{
-        .format = 0, // JSON
-        .include_metadata = true,
+    // SAFETY: db_ptr comes from beam.get_resource() which retrieves the pointer
+    // originally stored by beam.alloc_resource() in db_open. The NIF resource system
+    // guarantees the pointer is valid while the resource reference is live. Alignment
+    // is met because DbHandle was heap-allocated by allocator.create(DbHandle).
+    const db: *DbHandle = @ptrCast(@alignCast(db_ptr));
+
+    const type_val = nif_get_int(env, argv[1]) orelse {
+        return beam.make_badarg(env);
     };
-    var out_text: LgBlob = .{ .ptr = null, .len = 0 };
+    if (type_val < 0 or type_val > std.math.maxInt(u16)) {
+        return beam.make_badarg(env);
+    }
+
+    // Opened here so its snapshot is taken at the call, not when a dirty
+    // scheduler picks the scan up
+    var cursor: ?*FdbCursor = null;
     var out_err: LgBlob = .{ .ptr = null, .len = 0 };
+    const opts: LgRenderOpts = .{ .format = 0, .include_metadata = false };
+    const status = fdb_cursor_open_blocks(db.fdb, @intCast(type_val), opts, &cursor, &out_err);
+    if (out_err.ptr != null) fdb_blob_free(&out_err);
 
-    const status = fdb_render_journal(db.fdb, since, opts, &out_text, &out_err);
+    if (status != @intFromEnum(FdbStatus.ok) or cursor == null) {
+        return beam.make_tuple2(env,
+            beam.make_atom(env, "error"),
+            beam.make_atom(env, status_to_atom(status)),
+        );
+    }
 
-    // Free error blob regardless of outcome
+    return Scan.start(env, "scan", .{ .blocks = cursor.? });
+}
+
+/// Read one document as a binary that shares the bridge's buffer-pool
+/// frame (or the bridge's reassembled copy) instead of copying it.
+/// Parameters: DbRef, BlockId
+/// Returns: {ok, Binary} | {error, Reason}
+export fn read_block(env: ?*beam.env, argc: c_int, argv: [*c]const beam.term) beam.term {
+    if (argc != 2) {
+        return beam.make_badarg(env);
+    }
+
+    const db_ptr = beam.get_resource(env, argv[0], DbHandle, db_handle_type) catch {
+        return beam.make_tuple2(env,
+            beam.make_atom(env, "error"),
+            beam.make_atom(env, "invalid_handle"),
+        );
+    };
+
+    // SAFETY: db_ptr comes from beam.get_resource() which retrieves the pointer
+    // originally stored by beam.alloc_resource() in db_open. The NIF resource system
+    // guarantees the pointer is valid while the resource reference is live. Alignment
+    // is met because DbHandle was heap-allocated by allocator.create(DbHandle).
+    const db: *DbHandle = @ptrCast(@alignCast(db_ptr));
+
+    const block_id = nif_get_u64(env, argv[1]) orelse {
+        return beam.make_badarg(env);
+    };
+
+    var view: LgView = .{ .ptr = null, .len = 0, .token = 0 };
+    var out_err: LgBlob = .{ .ptr = null, .len = 0 };
+    const status = fdb_read_block_view(db.fdb, block_id, &view, &out_err);
     if (out_err.ptr != null) fdb_blob_free(&out_err);
 
     if (status != @intFromEnum(FdbStatus.ok)) {
-        if (out_text.ptr != null) fdb_blob_free(&out_text);
         return beam.make_tuple2(env,
             beam.make_atom(env, "error"),
             beam.make_atom(env, status_to_atom(status)),
         );
     }
 
-    // Copy journal data into a BEAM binary
-    const journal_bin = blk: {
-        if (out_text.ptr != null and out_text.len > 0) {
-            // SAFETY: out_text.ptr is non-null and out_text.len > 0 (checked above).
-            // The bridge guarantees the pointer is valid until fdb_blob_free() is called.
-            const text_slice = out_text.ptr.?[0..out_text.len];
-            break :blk beam.make_binary(env, text_slice) catch {
-                fdb_blob_free(&out_text);
-                return beam.make_tuple2(env,
-                    beam.make_atom(env, "error"),
-                    beam.make_atom(env, "alloc_failed"),
-                );
-            };
-        } else {
-            // No journal entries — return empty JSON array
-            const empty_array = [_]u8{ '[', ']' };
-            break :blk beam.make_binary(env, &empty_array) catch {
+    // The resource owns the view; view_dtor releases it with the binary
+    const owner = beam.new_resource(LgView, view_type) catch {
+        fdb_view_release(&view);
+        return beam.make_tuple2(env,
+            beam.make_atom(env, "error"),
+            beam.make_atom(env, "resource_alloc_failed"),
+        );
+    };
+    owner.* = view;
+
+    const data: []const u8 = if (view.ptr) |ptr| ptr[0..view.len] else &.{};
+    return beam.make_tuple2(env,
+        beam.make_atom(env, "ok"),
+        beam.make_owned_resource_binary(env, owner, data),
+    );
+}
+
+/// Resource destructor for views: runs once no binary refers to one
+fn view_dtor(env: ?*beam.env, obj: ?*anyopaque) callconv(.c) void {
+    _ = env;
+    // SAFETY: the BEAM only calls this for view_type resources, which
+    // read_block filled with a view before making a binary over them.
+    const view: *LgView = @ptrCast(@alignCast(obj orelse return));
+    fdb_view_release(view);
+}
+
+/// State of a journal/2 or scan/2 read, carried across reschedules as a
+/// resource term. The destructor releases it if the caller goes away
+/// mid-read.
+const Scan = struct {
+    name: [*:0]const u8,
+    source: Source,
+    // Rows so far; a JSON array under construction for the journal
+    out: std.ArrayList(u8) = .{},
+    // Buffer handed to the bridge for each page
+    page: std.ArrayList(u8) = .{},
+
+    const Source = union(enum) {
+        journal: struct { db: *FdbDb, next_seq: u64 },
+        blocks: ?*FdbCursor,
+    };
+
+    /// Journal entries requested per page
+    const PAGE_ENTRIES: u64 = 256;
+    /// Initial page buffer; grown when a single row needs more
+    const PAGE_BYTES: usize = 64 * 1024;
+    /// Share of a timeslice charged per page when yielding
+    const PAGE_SLICE_PERCENT: c_int = 10;
+
+    const Step = union(enum) {
+        done,
+        more,
+        failed: c_int,
+    };
+
+    /// Allocate the scan resource and run (or schedule) its first step
+    fn start(env: ?*beam.env, name: [*:0]const u8, source: Source) beam.term {
+        const state = beam.new_resource(Scan, scan_type) catch {
+            if (source == .blocks) fdb_cursor_close(source.blocks);
+            return beam.make_tuple2(env,
+                beam.make_atom(env, "error"),
+                beam.make_atom(env, "resource_alloc_failed"),
+            );
+        };
+        state.* = .{ .name = name, .source = source };
+        if (source == .journal) {
+            state.out.append(allocator, '[') catch {};
+        }
+        const args = [_]beam.term{beam.make_owned_resource(env, state)};
+
+        return switch (scan_mode) {
+            .yield => scan_continue(env, args.len, &args),
+            .dirty => beam.schedule_nif(env, name, beam.ERL_NIF_DIRTY_JOB_CPU_BOUND, scan_continue, &args),
+        };
+    }
+
+    /// Read pages until done, or (when yielding) until the timeslice is spent
+    fn run(self: *Scan, env: ?*beam.env, yielding: bool) Step {
+        if (self.source == .journal and self.out.items.len == 0) {
+            return .{ .failed = @intFromEnum(FdbStatus.err_out_of_memory) };
+        }
+        if (self.page.items.len == 0) {
+            self.page.resize(allocator, PAGE_BYTES) catch return .{ .failed = @intFromEnum(FdbStatus.err_out_of_memory) };
+        }
+        while (true) {
+            const step = self.readPage();
+            if (step != .more) return step;
+            if (yielding and beam.consume_timeslice(env, PAGE_SLICE_PERCENT)) return .more;
+        }
+    }
+
+    /// Fetch and append one page of rows
+    fn readPage(self: *Scan) Step {
+        var written: usize = 0;
+        const status = switch (self.source) {
+            .journal => |j| fdb_journal_read(j.db, j.next_seq, PAGE_ENTRIES, self.page.items.ptr, self.page.items.len, &written),
+            .blocks => |cursor| fdb_cursor_next(cursor.?, self.page.items.ptr, self.page.items.len, &written),
+        };
+
+        switch (status) {
+            @intFromEnum(FdbStatus.ok) => {},
+            // End of a block scan
+            @intFromEnum(FdbStatus.err_not_found) => if (self.source == .blocks) return .done else return .{ .failed = status },
+            // The next row needs a bigger page
+            @intFromEnum(FdbStatus.err_invalid_argument) => {
+                if (written <= self.page.items.len) return .{ .failed = status };
+                self.page.resize(allocator, written) catch return .{ .failed = @intFromEnum(FdbStatus.err_out_of_memory) };
+                return .more;
+            },
+            else => return .{ .failed = status },
+        }
+
+        const rows = self.page.items[0..written];
+        switch (self.source) {
+            .journal => |*j| {
+                // A page is a JSON array; "[]" means the head was reached
+                if (rows.len <= 2) return .done;
+                const body = rows[1 .. rows.len - 1];
+                if (self.out.items.len > 1) self.out.append(allocator, ',') catch return .{ .failed = @intFromEnum(FdbStatus.err_out_of_memory) };
+                self.out.appendSlice(allocator, body) catch return .{ .failed = @intFromEnum(FdbStatus.err_out_of_memory) };
+                j.next_seq = (lastSequence(body) orelse return .{ .failed = @intFromEnum(FdbStatus.err_internal) }) + 1;
+            },
+            .blocks => self.out.appendSlice(allocator, rows) catch return .{ .failed = @intFromEnum(FdbStatus.err_out_of_memory) },
+        }
+        return .more;
+    }
+
+    /// The finished rows as {ok, Binary}
+    fn finish(self: *Scan, env: ?*beam.env) beam.term {
+        if (self.source == .journal) {
+            self.out.append(allocator, ']') catch {
                 return beam.make_tuple2(env,
                     beam.make_atom(env, "error"),
                     beam.make_atom(env, "alloc_failed"),
                 );
             };
         }
+        const bin = beam.make_binary(env, self.out.items) catch {
+            return beam.make_tuple2(env,
+                beam.make_atom(env, "error"),
+                beam.make_atom(env, "alloc_failed"),
+            );
+        };
+        self.release();
+        return beam.make_tuple2(env,
+            beam.make_atom(env, "ok"),
+            bin,
+        );
+    }
+
+    /// Free buffers and close the cursor; safe to call more than once
+    fn release(self: *Scan) void {
+        switch (self.source) {
+            .blocks => |*cursor| {
+                fdb_cursor_close(cursor.*);
+                cursor.* = null;
+            },
+            .journal => {},
+        }
+        self.out.deinit(allocator);
+        self.out = .{};
+        self.page.deinit(allocator);
+        self.page = .{};
+    }
+
+    /// Sequence of the last entry in a page body. Entry objects start with
+    /// {"seq": and quotes inside forward text are escaped, so the last
+    /// match is the last entry.
+    fn lastSequence(body: []const u8) ?u64 {
+        const key = "{\"seq\":";
+        const at = std.mem.lastIndexOf(u8, body, key) orelse return null;
+        const digits = body[at + key.len ..];
+        const end = std.mem.indexOfScalar(u8, digits, ',') orelse return null;
+        return std.fmt.parseInt(u64, digits[0..end], 10) catch null;
+    }
+};
+
+/// Continuation of journal/2 and scan/2: argv[0] is the Scan resource
+fn scan_continue(env: ?*beam.env, argc: c_int, argv: [*c]const beam.term) callconv(.c) beam.term {
+    if (argc != 1) {
+        return beam.make_badarg(env);
+    }
+
+    const scan_ptr = beam.get_resource(env, argv[0], Scan, scan_type) catch {
+        return beam.make_badarg(env);
     };
 
-    // Free the bridge blob now that data is copied
-    if (out_text.ptr != null) fdb_blob_free(&out_text);
+    // SAFETY: scan_ptr comes from beam.get_resource() on a scan_type resource
+    // allocated by beam.new_resource(Scan) in Scan.start, which initialised it.
+    // The argv term keeps the resource alive for the duration of this call.
+    const state: *Scan = @ptrCast(@alignCast(scan_ptr));
 
-    return beam.make_tuple2(env,
-        beam.make_atom(env, "ok"),
-        journal_bin,
-    );
+    switch (state.run(env, scan_mode == .yield)) {
+        .done => return state.finish(env),
+        .more => return beam.schedule_nif(env, state.name, 0, scan_continue, argv[0..1]),
+        .failed => |status| {
+            state.release();
+            return beam.make_tuple2(env,
+                beam.make_atom(env, "error"),
+                beam.make_atom(env, status_to_atom(status)),
+            );
+        },
+    }
+}
+
+/// Resource destructor for Scan: runs when the last term is gone
+fn scan_dtor(env: ?*beam.env, obj: ?*anyopaque) callconv(.c) void {
+    _ = env;
+    // SAFETY: the BEAM only calls this for scan_type resources, which
+    // Scan.start initialised before making any term for them.
+    const state: *Scan = @ptrCast(@alignCast(obj orelse return));
+    state.release();
 }
 
 /// Helper: extract a C int from a BEAM term. Returns null if the term is not an integer.
@@ -762,8 +1232,18 @@ fn nif_get_int(e: ?*beam.env, t: beam.term) ?c_int {
     return val;
 }
 
-// Additional extern needed for integer extraction
+/// Helper: extract an unsigned 64-bit integer (e.g. a block ID) from a BEAM term
+fn nif_get_u64(e: ?*beam.env, t: beam.term) ?u64 {
+    var val: u64 = undefined;
+    if (enif_get_uint64(e, t, &val) == 0) {
+        return null;
+    }
+    return val;
+}
+
+// Additional externs needed for integer extraction
 extern fn enif_get_int(env: ?*beam.env, term: beam.term, ip: *c_int) callconv(.c) c_int;
+extern fn enif_get_uint64(env: ?*beam.env, term: beam.term, ip: *u64) callconv(.c) c_int;
 
 //==============================================================================
 // NIF Initialization
@@ -771,25 +1251,42 @@ extern fn enif_get_int(env: ?*beam.env, term: beam.term, ip: *c_int) callconv(.c
 
 const nif_funcs = [_]beam.ErlNifFunc{
     .{ .name = "version", .arity = 0, .fptr = version, .flags = 0 },
-    .{ .name = "db_open", .arity = 1, .fptr = db_open, .flags = 0 },
-    .{ .name = "db_close", .arity = 1, .fptr = db_close, .flags = 0 },
+    // Opening recovers the journal and closing flushes: both do file I/O
+    .{ .name = "db_open", .arity = 1, .fptr = db_open, .flags = beam.ERL_NIF_DIRTY_JOB_IO_BOUND },
+    .{ .name = "db_close", .arity = 1, .fptr = db_close, .flags = beam.ERL_NIF_DIRTY_JOB_IO_BOUND },
     .{ .name = "txn_begin", .arity = 2, .fptr = txn_begin, .flags = 0 },
-    .{ .name = "txn_commit", .arity = 1, .fptr = txn_commit, .flags = 0 },
+    // Commit writes and fsyncs the journal, blocks and superblock
+    .{ .name = "txn_commit", .arity = 1, .fptr = txn_commit, .flags = beam.ERL_NIF_DIRTY_JOB_IO_BOUND },
+    // Only queues the commit; the result arrives as a message
+    .{ .name = "txn_commit_async", .arity = 2, .fptr = txn_commit_async, .flags = 0 },
     .{ .name = "txn_abort", .arity = 1, .fptr = txn_abort, .flags = 0 },
+    // Buffers in memory until commit
     .{ .name = "apply", .arity = 2, .fptr = apply, .flags = 0 },
     .{ .name = "schema", .arity = 1, .fptr = schema, .flags = 0 },
+    // Reads atomic counters only
+    .{ .name = "stats", .arity = 1, .fptr = stats, .flags = 0 },
+    // Long reads yield or move to a dirty scheduler themselves (ScanMode)
     .{ .name = "journal", .arity = 2, .fptr = journal, .flags = 0 },
+    .{ .name = "scan", .arity = 2, .fptr = scan, .flags = 0 },
+    // A miss reads the document (and any overflow chain) from disk
+    .{ .name = "read_block", .arity = 2, .fptr = read_block, .flags = beam.ERL_NIF_DIRTY_JOB_IO_BOUND },
 };
 
 export fn nif_init(env: ?*beam.env, priv_data: [*c]?*anyopaque, load_info: beam.term) c_int {
     _ = priv_data;
-    _ = load_info;
 
     // Check env is valid
     if (env == null) {
         return 1;
     }
 
+    // Load info may be a map of options; anything else keeps the defaults
+    if (beam.get_map_value(env, load_info, "scan_mode")) |mode_term| {
+        var mode_atom: [16]u8 = undefined;
+        const mode_len = beam.get_atom(env, mode_term, &mode_atom);
+        scan_mode = std.meta.stringToEnum(ScanMode, mode_atom[0..mode_len]) orelse return 1;
+    }
+
     // Register resource types
     db_handle_type = beam.open_resource_type(env, "db_handle", null) catch {
         return 1;
@@ -799,6 +1296,14 @@ export fn nif_init(env: ?*beam.env, priv_data: [*c]?*anyopaque, load_info: beam.
         return 1;
     };
 
+    scan_type = beam.open_resource_type(env, "scan", scan_dtor) catch {
+        return 1;
+    };
+
+    view_type = beam.open_resource_type(env, "view", view_dtor) catch {
+        return 1;
+    };
+
     return 0;
 }
 
@@ -2,7 +2,7 @@
 %% FormDB NIF module - Erlang wrapper
 
 -module(formdb_nif).
--export([version/0, db_open/1, db_close/1, txn_begin/2, txn_commit/1, txn_abort/1, apply/2, schema/1, journal/2]).
+-export([version/0, db_open/1, db_close/1, txn_begin/2, txn_commit/1, txn_commit_async/2, txn_abort/1, apply/2, schema/1, stats/1, journal/2, scan/2, read_block/2]).
 -on_load(init/0).
 
 -define(NOT_LOADED, erlang:nif_error({not_loaded, ?MODULE})).
@@ -17,7 +17,11 @@ init() ->
         Path ->
             Path
     end,
-    erlang:load_nif(filename:join(PrivDir, "formdb_nif"), 0).
+    erlang:load_nif(filename:join(PrivDir, "formdb_nif"), load_info()).
+
+%% scan_mode: yield | dirty (see native/src/formdb_nif.erl)
+load_info() ->
+    #{scan_mode => application:get_env(formdb, nif_scan_mode, yield)}.
 
 %% NIF function stubs (replaced when NIF loads)
 version() -> ?NOT_LOADED.
@@ -25,7 +29,11 @@ db_open(_Path) -> ?NOT_LOADED.
 db_close(_DbRef) -> ?NOT_LOADED.
 txn_begin(_DbRef, _Mode) -> ?NOT_LOADED.
 txn_commit(_TxnRef) -> ?NOT_LOADED.
+txn_commit_async(_TxnRef, _Ref) -> ?NOT_LOADED.
 txn_abort(_TxnRef) -> ?NOT_LOADED.
 apply(_TxnRef, _OpCbor) -> ?NOT_LOADED.
 schema(_DbRef) -> ?NOT_LOADED.
+stats(_DbRef) -> ?NOT_LOADED.
 journal(_DbRef, _Since) -> ?NOT_LOADED.
+scan(_DbRef, _BlockType) -> ?NOT_LOADED.
+read_block(_DbRef, _BlockId) -> ?NOT_LOADED.
@@ -14,10 +14,14 @@
 #   db_close/1       -> ok | {error, Reason}
 #   txn_begin/2      -> {ok, TxnRef} | {error, Reason}
 #   txn_commit/1     -> ok | {error, Reason}
+#   txn_commit_async/2 -> ok | {error, Reason}, then {lithoglyph_commit, Ref, Result}
 #   txn_abort/1      -> ok
 #   apply/2          -> {ok, ResultCbor} | {ok, ResultCbor, ProvCbor} | {error, Reason}
 #   schema/1         -> {ok, SchemaCbor} | {error, Reason}
-#   journal/2        -> {ok, JournalCbor} | {error, Reason}
+#   stats/1          -> {ok, StatsJson} | {error, Reason}
+#   journal/2        -> {ok, JournalJson} | {error, Reason}
+#   scan/2           -> {ok, JsonLines} | {error, Reason}
+#   read_block/2     -> {ok, Binary} | {error, Reason}
 
 defmodule FormdbNifTest do
   use ExUnit.Case, async: false
@@ -186,6 +190,52 @@ test "returns error for invalid transaction handle" do
     end
   end
 
+  # ============================================================
+  # txn_commit_async/2
+  # ============================================================
+
+  describe "txn_commit_async/2" do
+    test "reports completion with a message", %{db_path: db_path} do
+      {:ok, db_ref} = :formdb_nif.db_open(db_path)
+      {:ok, txn_ref} = :formdb_nif.txn_begin(db_ref, :read_write)
+      assert :ok == elem(:formdb_nif.apply(txn_ref, <<0xA1, 0x61, "n", 0x01>>), 0)
+
+      ref = make_ref()
+      assert :ok = :formdb_nif.txn_commit_async(txn_ref, ref)
+      assert_receive {:lithoglyph_commit, ^ref, :ok}, 5_000
+
+      :formdb_nif.db_close(db_ref)
+    end
+
+    test "many concurrent writers each get their result", %{db_path: db_path} do
+      {:ok, db_ref} = :formdb_nif.db_open(db_path)
+
+      writers =
+        for i <- 1..500 do
+          Task.async(fn ->
+            {:ok, txn_ref} = :formdb_nif.txn_begin(db_ref, :read_write)
+            :formdb_nif.apply(txn_ref, <<0xA1, 0x61, "n", 0x19, i::16>>)
+            ref = make_ref()
+            :ok = :formdb_nif.txn_commit_async(txn_ref, ref)
+
+            receive do
+              {:lithoglyph_commit, ^ref, result} -> result
+            after
+              10_000 -> :timeout
+            end
+          end)
+        end
+
+      assert Enum.all?(Task.await_many(writers, 15_000), &(&1 == :ok))
+
+      :formdb_nif.db_close(db_ref)
+    end
+
+    test "returns error for invalid transaction handle" do
+      assert {:error, :invalid_handle} = :formdb_nif.txn_commit_async(make_ref(), make_ref())
+    end
+  end
+
   # ============================================================
   # txn_abort/1
   # ============================================================
@@ -346,19 +396,92 @@ test "returns schema as CBOR binary", %{db_path: db_path} do
     end
   end
 
+  # ============================================================
+  # stats/1
+  # ============================================================
+
+  describe "stats/1" do
+    test "reports I/O counters and commit phase timings", %{db_path: db_path} do
+      {:ok, db_ref} = :formdb_nif.db_open(db_path)
+      commit_inserts(db_ref, 10)
+
+      assert {:ok, stats_json} = :formdb_nif.stats(db_ref)
+      assert stats_json =~ ~s("commit_groups":1,)
+      assert [_, fsyncs] = Regex.run(~r/"fsyncs":(\d+)/, stats_json)
+      assert String.to_integer(fsyncs) >= 2
+
+      # One group commit leaves one sample in every phase histogram
+      for phase <- ~w(journal journal_write blocks deletes block_write publish) do
+        assert stats_json =~ ~s("#{phase}":{"count":1,)
+      end
+
+      :formdb_nif.db_close(db_ref)
+    end
+
+    test "returns error for invalid handle" do
+      assert {:error, :invalid_handle} = :formdb_nif.stats(make_ref())
+    end
+  end
+
   # ============================================================
   # journal/2
   # ============================================================
 
   describe "journal/2" do
-    test "returns journal entries as CBOR binary", %{db_path: db_path} do
+    test "returns journal entries as a JSON array", %{db_path: db_path} do
       {:ok, db_ref} = :formdb_nif.db_open(db_path)
 
-      assert {:ok, journal_cbor} = :formdb_nif.journal(db_ref, 0)
-      assert is_binary(journal_cbor)
+      assert {:ok, journal_json} = :formdb_nif.journal(db_ref, 0)
+      assert is_binary(journal_json)
+      assert String.starts_with?(journal_json, "[")
+      assert String.ends_with?(journal_json, "]")
+
+      :formdb_nif.db_close(db_ref)
+    end
+
+    test "pages through a journal longer than one read", %{db_path: db_path} do
+      {:ok, db_ref} = :formdb_nif.db_open(db_path)
+      commit_inserts(db_ref, 600)
+
+      assert {:ok, journal_json} = :formdb_nif.journal(db_ref, 0)
+      seqs = journal_seqs(journal_json)
+
+      assert length(seqs) >= 600
+      assert seqs == Enum.sort(Enum.uniq(seqs))
+
+      :formdb_nif.db_close(db_ref)
+    end
+
+    test "resumes after the last sequence seen", %{db_path: db_path} do
+      {:ok, db_ref} = :formdb_nif.db_open(db_path)
+      commit_inserts(db_ref, 5)
+
+      assert {:ok, all_json} = :formdb_nif.journal(db_ref, 0)
+      [first, second | _] = journal_seqs(all_json)
+
+      assert {:ok, resumed_json} = :formdb_nif.journal(db_ref, first)
+      assert [^second | _] = journal_seqs(resumed_json)
+
+      assert {:ok, negative_json} = :formdb_nif.journal(db_ref, -1)
+      assert [^first | _] = journal_seqs(negative_json)
+
+      :formdb_nif.db_close(db_ref)
+    end
+
+    test "resumes across a reconnect without duplicating or skipping", %{db_path: db_path} do
+      {:ok, db_ref} = :formdb_nif.db_open(db_path)
+      commit_inserts(db_ref, 5)
+      assert {:ok, before_json} = :formdb_nif.journal(db_ref, 0)
+      seen = journal_seqs(before_json)
+      :formdb_nif.db_close(db_ref)
 
-      # M10 PoC returns empty CBOR array (0x80)
-      assert journal_cbor == <<0x80>>
+      {:ok, db_ref} = :formdb_nif.db_open(db_path)
+      commit_inserts(db_ref, 3)
+      assert {:ok, resumed_json} = :formdb_nif.journal(db_ref, List.last(seen))
+      resumed = journal_seqs(resumed_json)
+
+      assert length(resumed) >= 3
+      assert seen ++ resumed == Enum.to_list(hd(seen)..List.last(resumed))
 
       :formdb_nif.db_close(db_ref)
     end
@@ -374,6 +497,134 @@ test "accepts non-zero since parameter", %{db_path: db_path} do
     end
   end
 
+  # ============================================================
+  # scan/2
+  # ============================================================
+
+  describe "scan/2" do
+    test "returns one row per live document", %{db_path: db_path} do
+      {:ok, db_ref} = :formdb_nif.db_open(db_path)
+      commit_inserts(db_ref, 300)
+
+      assert {:ok, rows} = :formdb_nif.scan(db_ref, 17)
+      assert length(String.split(rows, "\n", trim: true)) == 300
+
+      :formdb_nif.db_close(db_ref)
+    end
+
+    test "returns error for invalid database handle" do
+      assert {:error, :invalid_handle} = :formdb_nif.scan(make_ref(), 17)
+    end
+  end
+
+  # ============================================================
+  # read_block/2
+  # ============================================================
+
+  describe "read_block/2" do
+    test "returns the stored document", %{db_path: db_path} do
+      {:ok, db_ref} = :formdb_nif.db_open(db_path)
+      {:ok, txn_ref} = :formdb_nif.txn_begin(db_ref, :read_write)
+      doc = <<0xA1, 0x65, "claim", 0x64, "test">>
+      {:ok, result} = :formdb_nif.apply(txn_ref, doc)
+      :ok = :formdb_nif.txn_commit(txn_ref)
+
+      [block_id] = Regex.run(~r/"block_id":(\d+)/, result, capture: :all_but_first)
+      assert {:ok, ^doc} = :formdb_nif.read_block(db_ref, String.to_integer(block_id))
+
+      :formdb_nif.db_close(db_ref)
+    end
+
+    test "binary stays readable after the database is closed", %{db_path: db_path} do
+      {:ok, db_ref} = :formdb_nif.db_open(db_path)
+      {:ok, txn_ref} = :formdb_nif.txn_begin(db_ref, :read_write)
+      {:ok, result} = :formdb_nif.apply(txn_ref, "kept")
+      :ok = :formdb_nif.txn_commit(txn_ref)
+
+      [block_id] = Regex.run(~r/"block_id":(\d+)/, result, capture: :all_but_first)
+      {:ok, view} = :formdb_nif.read_block(db_ref, String.to_integer(block_id))
+      :formdb_nif.db_close(db_ref)
+
+      assert view == "kept"
+    end
+
+    test "returns not_found for a missing block", %{db_path: db_path} do
+      {:ok, db_ref} = :formdb_nif.db_open(db_path)
+
+      assert {:error, :not_found} = :formdb_nif.read_block(db_ref, 1_000_000)
+
+      :formdb_nif.db_close(db_ref)
+    end
+  end
+
+  # ============================================================
+  # Scheduler behaviour
+  # ============================================================
+
+  describe "scheduler latency" do
+    # Commits run on dirty I/O schedulers and reads yield, so a process
+    # on a normal scheduler keeps getting woken on time while other
+    # processes hammer the NIF.
+    @tag timeout: 120_000
+    test "stays bounded during heavy commits and reads", %{db_path: db_path} do
+      {:ok, db_ref} = :formdb_nif.db_open(db_path)
+      commit_inserts(db_ref, 2_000)
+
+      parent = self()
+      probe = spawn_link(fn -> probe_latency(parent, 0) end)
+
+      workers =
+        for i <- 1..System.schedulers_online() do
+          Task.async(fn ->
+            for _ <- 1..50 do
+              if rem(i, 2) == 0 do
+                commit_inserts(db_ref, 20)
+              else
+                {:ok, _} = :formdb_nif.journal(db_ref, 0)
+                {:ok, _} = :formdb_nif.scan(db_ref, 17)
+              end
+            end
+          end)
+        end
+
+      Task.await_many(workers, 110_000)
+      send(probe, :stop)
+      assert_receive {:max_overshoot_ms, max_ms}, 5_000
+
+      assert max_ms < 50, "a 1 ms timer fired #{max_ms} ms late"
+
+      :formdb_nif.db_close(db_ref)
+    end
+  end
+
+  # Sleep 1 ms at a time and report the worst wake-up delay
+  defp probe_latency(parent, max_ms) do
+    started = System.monotonic_time(:millisecond)
+
+    receive do
+      :stop -> send(parent, {:max_overshoot_ms, max_ms})
+    after
+      1 ->
+        late = System.monotonic_time(:millisecond) - started - 1
+        probe_latency(parent, max(max_ms, late))
+    end
+  end
+
+  defp commit_inserts(db_ref, count) do
+    {:ok, txn_ref} = :formdb_nif.txn_begin(db_ref, :read_write)
+
+    for i <- 1..count do
+      assert :ok == elem(:formdb_nif.apply(txn_ref, <<0xA1, 0x61, "n", 0x19, i::16>>), 0)
+    end
+
+    :ok = :formdb_nif.txn_commit(txn_ref)
+  end
+
+  defp journal_seqs(journal_json) do
+    Regex.scan(~r/\{"seq":(\d+)/, journal_json, capture: :all_but_first)
+    |> Enum.map(fn [seq] -> String.to_integer(seq) end)
+  end
+
   # ============================================================
   # Arity validation
   # ============================================================
@@ -36,6 +36,11 @@ $0040 constant TYPE-JOURNAL-SEGMENT
 $0050 constant TYPE-SCHEMA
 $0051 constant TYPE-CONSTRAINT
 $0060 constant TYPE-MIGRATION
+$FF01 constant TYPE-FREE-SPACE-MAP  \ extension range
+$FF02 constant TYPE-TYPE-INDEX      \ extension range
+$FF03 constant TYPE-JOURNAL-ARCHIVE \ extension range
+$FF04 constant TYPE-SPATIAL-NODE     \ extension range
+$FF05 constant TYPE-SPATIAL-META     \ extension range
 
 \ Block flags (bitmask)
 $01 constant FLAG-COMPRESSED
@@ -23,6 +23,7 @@ $0001 constant OP-DOC-INSERT
 $0002 constant OP-DOC-UPDATE
 $0003 constant OP-DOC-DELETE
 $0004 constant OP-DOC-REPLACE
+$0005 constant OP-BULK-INSERT
 $0010 constant OP-EDGE-INSERT
 $0011 constant OP-EDGE-DELETE
 $0012 constant OP-EDGE-UPDATE
@@ -39,6 +40,7 @@ $0061 constant OP-MIGRATION-STEP
 $0062 constant OP-MIGRATION-COMPLETE
 $0063 constant OP-MIGRATION-ROLLBACK
 $0070 constant OP-CHECKPOINT
+$0072 constant OP-REPLICA-MARK
 $FF00 constant OP-IRREVERSIBLE
 
 \ Entry flags
@@ -390,11 +392,14 @@ create entry-buffer MAX-ENTRY-SIZE allot
     OP-DOC-INSERT of ." DOC_INSERT" endof
     OP-DOC-UPDATE of ." DOC_UPDATE" endof
     OP-DOC-DELETE of ." DOC_DELETE" endof
+    OP-BULK-INSERT of ." BULK_INSERT" endof
     OP-EDGE-INSERT of ." EDGE_INSERT" endof
     OP-EDGE-DELETE of ." EDGE_DELETE" endof
     OP-COLLECTION-CREATE of ." COLLECTION_CREATE" endof
     OP-COLLECTION-DROP of ." COLLECTION_DROP" endof
+    OP-INDEX-CREATE of ." INDEX_CREATE" endof
     OP-CHECKPOINT of ." CHECKPOINT" endof
+    OP-REPLICA-MARK of ." REPLICA_MARK" endof
     OP-IRREVERSIBLE of ." IRREVERSIBLE" endof
     ." UNKNOWN"
   endcase ;
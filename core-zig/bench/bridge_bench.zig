@@ -0,0 +1,456 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Form.Bridge - Bridge Throughput and Latency Benchmarks
+//
+// Run with: zig build bench [-- options]
+//
+// Drives the C ABI in generated/abi/bridge.h the way a runtime binding
+// does, against fresh databases filled by seeded generators: two runs
+// with the same --seed and --scale write identical datasets.
+//
+//   commit_throughput   fdb_apply + fdb_txn_commit, docs/s and fsyncs per
+//                       commit, for 1 to 1000 documents per transaction
+//   concurrent_commits  single-document commits from several threads,
+//                       showing how far group commit shares fsyncs
+//   commit_latency      single-document commits, p50/p99/p999 in us
+//   scan                fdb_read_blocks over the whole dataset, GB/s
+//   journal_append      journal entries made durable per second
+//
+// Each result is one JSON object per line on stdout:
+//   {"bench":"commit_latency","case":"doc_bytes=256","metric":"p99_us","value":812.000,"better":"lower"}
+//
+// Options:
+//   --scale quick|full   dataset size (default full)
+//   --seed N             generator seed
+//   --dir PATH           where the databases are created (default ".");
+//                        point it at the disk under test, not tmpfs
+//   --save FILE          also write the results to FILE
+//   --baseline FILE      compare with a saved run; exit 1 if any metric
+//                        is more than --tolerance percent worse
+//   --tolerance PCT      allowed regression (default 10)
+
+const std = @import("std");
+const c = @cImport(@cInclude("bridge.h"));
+
+const Scale = enum { quick, full };
+
+const Config = struct {
+    scale: Scale = .full,
+    seed: u64 = 0x4C47_4221,
+    dir: []const u8 = ".",
+    save: ?[]const u8 = null,
+    baseline: ?[]const u8 = null,
+    tolerance_pct: f64 = 10,
+
+    fn pick(self: Config, quick: usize, full: usize) usize {
+        return if (self.scale == .quick) quick else full;
+    }
+};
+
+// ============================================================
+// Results
+// ============================================================
+
+const Better = enum { higher, lower };
+
+const Result = struct {
+    bench: []const u8,
+    case: []const u8,
+    metric: []const u8,
+    value: f64,
+    better: Better,
+};
+
+const Results = struct {
+    allocator: std.mem.Allocator,
+    items: std.ArrayList(Result) = .{},
+
+    fn add(self: *Results, bench: []const u8, comptime case_fmt: []const u8, case_args: anytype, metric: []const u8, value: f64, better: Better) !void {
+        const case = try std.fmt.allocPrint(self.allocator, case_fmt, case_args);
+        try self.items.append(self.allocator, .{ .bench = bench, .case = case, .metric = metric, .value = value, .better = better });
+        std.debug.print("{s} {s} {s} = {d:.3}\n", .{ bench, case, metric, value });
+    }
+
+    fn write(self: *const Results, out: *std.Io.Writer) !void {
+        for (self.items.items) |r| {
+            try out.print("{{\"bench\":\"{s}\",\"case\":\"{s}\",\"metric\":\"{s}\",\"value\":{d:.3},\"better\":\"{s}\"}}\n", .{
+                r.bench, r.case, r.metric, r.value, @tagName(r.better),
+            });
+        }
+    }
+};
+
+/// Report metrics more than `tolerance_pct` worse than the baseline run.
+/// Returns the number of regressions.
+fn compareBaseline(allocator: std.mem.Allocator, results: *const Results, path: []const u8, tolerance_pct: f64) !usize {
+    const text = try std.fs.cwd().readFileAlloc(allocator, path, 16 << 20);
+    defer allocator.free(text);
+
+    var regressions: usize = 0;
+    var compared: usize = 0;
+    var lines = std.mem.tokenizeScalar(u8, text, '\n');
+    while (lines.next()) |line| {
+        const parsed = try std.json.parseFromSlice(Result, allocator, line, .{});
+        defer parsed.deinit();
+        const base = parsed.value;
+
+        for (results.items.items) |cur| {
+            if (!std.mem.eql(u8, cur.bench, base.bench) or
+                !std.mem.eql(u8, cur.case, base.case) or
+                !std.mem.eql(u8, cur.metric, base.metric)) continue;
+            compared += 1;
+            if (base.value == 0) break;
+
+            // Positive change means worse
+            const change_pct = switch (cur.better) {
+                .higher => (base.value - cur.value) / base.value * 100,
+                .lower => (cur.value - base.value) / base.value * 100,
+            };
+            if (change_pct > tolerance_pct) {
+                regressions += 1;
+                std.debug.print("REGRESSION {s} {s} {s}: {d:.3} -> {d:.3} ({d:.1}% worse)\n", .{
+                    cur.bench, cur.case, cur.metric, base.value, cur.value, change_pct,
+                });
+            }
+            break;
+        }
+    }
+    std.debug.print("baseline {s}: {d} metrics compared, {d} regressed beyond {d:.1}%\n", .{ path, compared, regressions, tolerance_pct });
+    return regressions;
+}
+
+// ============================================================
+// Datasets
+// ============================================================
+
+/// Seeded document generator. Documents read like small JSON records
+/// (so compression and escaping behave as on real data) padded with
+/// words to an exact size.
+const Dataset = struct {
+    prng: std.Random.DefaultPrng,
+    next_id: u64 = 1,
+
+    const words = [_][]const u8{
+        "stone", "carved", "ledger", "claim", "witness", "source", "archive", "record",
+        "provenance", "journal", "evidence", "narrative", "citation", "author", "revision", "draft",
+    };
+
+    fn init(seed: u64) Dataset {
+        return .{ .prng = std.Random.DefaultPrng.init(seed) };
+    }
+
+    /// Fill `buf` with the next document
+    fn next(self: *Dataset, buf: []u8) []const u8 {
+        const random = self.prng.random();
+        const id = self.next_id;
+        self.next_id += 1;
+
+        const head = std.fmt.bufPrint(buf, "{{\"id\":{d},\"text\":\"", .{id}) catch return buf[0..0];
+        var len = head.len;
+        const tail = "\"}";
+        while (len + tail.len < buf.len) {
+            const word = words[random.uintLessThan(usize, words.len)];
+            const n = @min(word.len + 1, buf.len - tail.len - len);
+            @memcpy(buf[len..][0 .. n - 1], word[0 .. n - 1]);
+            buf[len + n - 1] = ' ';
+            len += n;
+        }
+        @memcpy(buf[buf.len - tail.len ..], tail);
+        return buf;
+    }
+};
+
+// ============================================================
+// Bridge helpers
+// ============================================================
+
+fn check(status: c.FdbStatus, err: *c.LgBlob) !void {
+    if (status == c.FDB_OK) return;
+    if (err.ptr != null) {
+        std.debug.print("bridge error: {s}\n", .{err.ptr[0..err.len]});
+        c.fdb_blob_free(err);
+    }
+    return error.BridgeCall;
+}
+
+const Db = struct {
+    allocator: std.mem.Allocator,
+    handle: ?*c.FdbDb,
+    path: []const u8,
+
+    /// A new, empty database in `dir`
+    fn create(allocator: std.mem.Allocator, dir: []const u8, name: []const u8) !Db {
+        const path = try std.fmt.allocPrint(allocator, "{s}/bench_{s}.lgh", .{ dir, name });
+        errdefer allocator.free(path);
+        std.fs.cwd().deleteFile(path) catch {};
+
+        var db: ?*c.FdbDb = null;
+        var err: c.LgBlob = .{ .ptr = null, .len = 0 };
+        try check(c.fdb_db_open(path.ptr, path.len, null, 0, &db, &err), &err);
+        return .{ .allocator = allocator, .handle = db, .path = path };
+    }
+
+    fn close(self: *Db) void {
+        _ = c.fdb_db_close(self.handle);
+        std.fs.cwd().deleteFile(self.path) catch {};
+        self.allocator.free(self.path);
+    }
+
+    fn begin(self: *Db) !?*c.FdbTxn {
+        var txn: ?*c.FdbTxn = null;
+        var err: c.LgBlob = .{ .ptr = null, .len = 0 };
+        try check(c.fdb_txn_begin(self.handle, c.LG_TXN_READ_WRITE, &txn, &err), &err);
+        return txn;
+    }
+
+    fn syncs(self: *Db) u64 {
+        return c.fdb_db_sync_count(self.handle);
+    }
+};
+
+fn apply(txn: ?*c.FdbTxn, doc: []const u8) !void {
+    var result = c.fdb_apply(txn, doc.ptr, doc.len);
+    if (result.data.ptr != null) c.fdb_blob_free(&result.data);
+    try check(@intCast(result.status), &result.error_blob);
+}
+
+fn commit(txn: ?*c.FdbTxn) !void {
+    var err: c.LgBlob = .{ .ptr = null, .len = 0 };
+    try check(c.fdb_txn_commit(txn, &err), &err);
+}
+
+/// Insert `count` generated documents, `per_txn` per transaction, in
+/// batches of one fdb_apply_batch call per transaction
+fn load(allocator: std.mem.Allocator, db: *Db, dataset: *Dataset, count: usize, per_txn: usize, doc_bytes: usize) !void {
+    const bufs = try allocator.alloc(u8, per_txn * doc_bytes);
+    defer allocator.free(bufs);
+    const ops = try allocator.alloc(c.LgBlob, per_txn);
+    defer allocator.free(ops);
+    const ids = try allocator.alloc(u64, per_txn);
+    defer allocator.free(ids);
+
+    var done: usize = 0;
+    while (done < count) {
+        const n = @min(per_txn, count - done);
+        for (0..n) |i| {
+            const doc = dataset.next(bufs[i * doc_bytes ..][0..doc_bytes]);
+            ops[i] = .{ .ptr = doc.ptr, .len = doc.len };
+        }
+        const txn = try db.begin();
+        var err: c.LgBlob = .{ .ptr = null, .len = 0 };
+        try check(c.fdb_apply_batch(txn, ops.ptr, n, 0, ids.ptr, &err), &err);
+        try commit(txn);
+        done += n;
+    }
+}
+
+fn seconds(ns: u64) f64 {
+    return @as(f64, @floatFromInt(ns)) / std.time.ns_per_s;
+}
+
+/// Value at quantile `q` of sorted samples, in microseconds
+fn percentileUs(sorted_ns: []const u64, q: f64) f64 {
+    const rank = @as(usize, @intFromFloat(@ceil(q * @as(f64, @floatFromInt(sorted_ns.len)))));
+    const idx = @min(sorted_ns.len - 1, @max(rank, 1) - 1);
+    return @as(f64, @floatFromInt(sorted_ns[idx])) / std.time.ns_per_us;
+}
+
+// ============================================================
+// Benchmarks
+// ============================================================
+
+const DOC_BYTES: usize = 256;
+
+fn benchCommitThroughput(allocator: std.mem.Allocator, cfg: Config, results: *Results) !void {
+    const total = cfg.pick(2_000, 20_000);
+    var buf: [DOC_BYTES]u8 = undefined;
+
+    for ([_]usize{ 1, 10, 100, 1000 }) |txn_size| {
+        var db = try Db.create(allocator, cfg.dir, "commit_throughput");
+        defer db.close();
+        var dataset = Dataset.init(cfg.seed);
+
+        const n_txns = total / txn_size;
+        const syncs_before = db.syncs();
+        var timer = try std.time.Timer.start();
+        for (0..n_txns) |_| {
+            const txn = try db.begin();
+            for (0..txn_size) |_| try apply(txn, dataset.next(&buf));
+            try commit(txn);
+        }
+        const elapsed = timer.read();
+        const n_syncs = db.syncs() - syncs_before;
+
+        const docs: f64 = @floatFromInt(n_txns * txn_size);
+        const txns: f64 = @floatFromInt(n_txns);
+        try results.add("commit_throughput", "txn_docs={d}", .{txn_size}, "docs_per_sec", docs / seconds(elapsed), .higher);
+        try results.add("commit_throughput", "txn_docs={d}", .{txn_size}, "fsyncs_per_commit", @as(f64, @floatFromInt(n_syncs)) / txns, .lower);
+        try results.add("commit_throughput", "txn_docs={d}", .{txn_size}, "fsyncs_per_doc", @as(f64, @floatFromInt(n_syncs)) / docs, .lower);
+    }
+}
+
+fn commitWorker(db: *Db, seed: u64, commits: usize, failed: *std.atomic.Value(bool)) void {
+    var dataset = Dataset.init(seed);
+    var buf: [DOC_BYTES]u8 = undefined;
+    for (0..commits) |_| {
+        const txn = db.begin() catch return failed.store(true, .monotonic);
+        apply(txn, dataset.next(&buf)) catch return failed.store(true, .monotonic);
+        commit(txn) catch return failed.store(true, .monotonic);
+    }
+}
+
+fn benchConcurrentCommits(allocator: std.mem.Allocator, cfg: Config, results: *Results) !void {
+    const per_thread = cfg.pick(200, 2_000);
+
+    for ([_]usize{ 1, 4, 16 }) |n_threads| {
+        var db = try Db.create(allocator, cfg.dir, "concurrent_commits");
+        defer db.close();
+
+        const threads = try allocator.alloc(std.Thread, n_threads);
+        defer allocator.free(threads);
+        var failed = std.atomic.Value(bool).init(false);
+
+        const syncs_before = db.syncs();
+        var timer = try std.time.Timer.start();
+        for (threads, 0..) |*t, i| {
+            t.* = try std.Thread.spawn(.{}, commitWorker, .{ &db, cfg.seed +% i, per_thread, &failed });
+        }
+        for (threads) |t| t.join();
+        const elapsed = timer.read();
+        if (failed.load(.monotonic)) return error.BridgeCall;
+
+        const commits: f64 = @floatFromInt(n_threads * per_thread);
+        const n_syncs: f64 = @floatFromInt(db.syncs() - syncs_before);
+        try results.add("concurrent_commits", "threads={d}", .{n_threads}, "commits_per_sec", commits / seconds(elapsed), .higher);
+        try results.add("concurrent_commits", "threads={d}", .{n_threads}, "fsyncs_per_commit", n_syncs / commits, .lower);
+    }
+}
+
+fn benchCommitLatency(allocator: std.mem.Allocator, cfg: Config, results: *Results) !void {
+    const n = cfg.pick(500, 5_000);
+    var db = try Db.create(allocator, cfg.dir, "commit_latency");
+    defer db.close();
+    var dataset = Dataset.init(cfg.seed);
+    var buf: [DOC_BYTES]u8 = undefined;
+
+    const samples = try allocator.alloc(u64, n);
+    defer allocator.free(samples);
+    for (samples) |*sample| {
+        var timer = try std.time.Timer.start();
+        const txn = try db.begin();
+        try apply(txn, dataset.next(&buf));
+        try commit(txn);
+        sample.* = timer.read();
+    }
+    std.mem.sort(u64, samples, {}, std.sort.asc(u64));
+
+    try results.add("commit_latency", "doc_bytes={d}", .{DOC_BYTES}, "p50_us", percentileUs(samples, 0.50), .lower);
+    try results.add("commit_latency", "doc_bytes={d}", .{DOC_BYTES}, "p99_us", percentileUs(samples, 0.99), .lower);
+    try results.add("commit_latency", "doc_bytes={d}", .{DOC_BYTES}, "p999_us", percentileUs(samples, 0.999), .lower);
+}
+
+fn benchScan(allocator: std.mem.Allocator, cfg: Config, results: *Results) !void {
+    const doc_bytes: usize = 1024;
+    const count = cfg.pick(10_000, 100_000);
+    var db = try Db.create(allocator, cfg.dir, "scan");
+    defer db.close();
+    var dataset = Dataset.init(cfg.seed);
+    try load(allocator, &db, &dataset, count, 1000, doc_bytes);
+
+    // Best of three, so a cold first pass does not dominate
+    var best: u64 = std.math.maxInt(u64);
+    for (0..3) |_| {
+        var out: c.LgBlob = .{ .ptr = null, .len = 0 };
+        var err: c.LgBlob = .{ .ptr = null, .len = 0 };
+        var timer = try std.time.Timer.start();
+        try check(c.fdb_read_blocks(db.handle, c.LG_BLOCK_TYPE_DOCUMENT, &out, &err), &err);
+        best = @min(best, timer.read());
+        c.fdb_blob_free(&out);
+    }
+
+    const payload: f64 = @floatFromInt(count * doc_bytes);
+    try results.add("scan", "docs={d},doc_bytes={d}", .{ count, doc_bytes }, "gb_per_sec", payload / @as(f64, @floatFromInt(best)), .higher);
+}
+
+fn benchJournalAppend(allocator: std.mem.Allocator, cfg: Config, results: *Results) !void {
+    const count = cfg.pick(20_000, 200_000);
+    var db = try Db.create(allocator, cfg.dir, "journal_append");
+    defer db.close();
+    var dataset = Dataset.init(cfg.seed);
+
+    // Small documents, so the journal rather than block writes dominates
+    var timer = try std.time.Timer.start();
+    try load(allocator, &db, &dataset, count, 1000, 32);
+    const elapsed = timer.read();
+
+    try results.add("journal_append", "entries_per_txn={d}", .{@as(usize, 1000)}, "entries_per_sec", @as(f64, @floatFromInt(count)) / seconds(elapsed), .higher);
+}
+
+// ============================================================
+// Entry point
+// ============================================================
+
+fn parseArgs(args: []const [:0]u8) !Config {
+    var cfg = Config{};
+    var i: usize = 1;
+    while (i < args.len) : (i += 1) {
+        const arg = args[i];
+        if (i + 1 >= args.len) {
+            std.debug.print("missing value for {s}\n", .{arg});
+            return error.InvalidArguments;
+        }
+        const value = args[i + 1];
+        i += 1;
+        if (std.mem.eql(u8, arg, "--scale")) {
+            cfg.scale = std.meta.stringToEnum(Scale, value) orelse return error.InvalidArguments;
+        } else if (std.mem.eql(u8, arg, "--seed")) {
+            cfg.seed = try std.fmt.parseInt(u64, value, 0);
+        } else if (std.mem.eql(u8, arg, "--dir")) {
+            cfg.dir = value;
+        } else if (std.mem.eql(u8, arg, "--save")) {
+            cfg.save = value;
+        } else if (std.mem.eql(u8, arg, "--baseline")) {
+            cfg.baseline = value;
+        } else if (std.mem.eql(u8, arg, "--tolerance")) {
+            cfg.tolerance_pct = try std.fmt.parseFloat(f64, value);
+        } else {
+            std.debug.print("unknown option {s}\n", .{arg});
+            return error.InvalidArguments;
+        }
+    }
+    return cfg;
+}
+
+pub fn main() !void {
+    var arena = std.heap.ArenaAllocator.init(std.heap.page_allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    const args = try std.process.argsAlloc(allocator);
+    const cfg = try parseArgs(args);
+    std.debug.print("bridge bench: scale={s} seed=0x{x} dir={s}\n", .{ @tagName(cfg.scale), cfg.seed, cfg.dir });
+
+    var results = Results{ .allocator = allocator };
+    try benchCommitThroughput(allocator, cfg, &results);
+    try benchConcurrentCommits(allocator, cfg, &results);
+    try benchCommitLatency(allocator, cfg, &results);
+    try benchScan(allocator, cfg, &results);
+    try benchJournalAppend(allocator, cfg, &results);
+
+    var stdout_buf: [4096]u8 = undefined;
+    var stdout = std.fs.File.stdout().writer(&stdout_buf);
+    try results.write(&stdout.interface);
+    try stdout.interface.flush();
+
+    if (cfg.save) |path| {
+        const file = try std.fs.cwd().createFile(path, .{});
+        defer file.close();
+        var file_buf: [4096]u8 = undefined;
+        var writer = file.writer(&file_buf);
+        try results.write(&writer.interface);
+        try writer.interface.flush();
+    }
+
+    if (cfg.baseline) |path| {
+        if (try compareBaseline(allocator, &results, path, cfg.tolerance_pct) > 0) std.process.exit(1);
+    }
+}
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Form.Bridge - CRC32C Throughput Micro-Benchmark
+//
+// Run with: zig build bench-crc
+// Reports GB/s for the compile-time selected implementation and the
+// portable fallbacks, over block-sized (4032-byte payload) and 1 MiB buffers.
+
+const std = @import("std");
+const crc32c = @import("crc32c");
+
+const TOTAL_BYTES: usize = 1 << 30; // checksum 1 GiB per measurement
+
+const Impl = struct {
+    name: []const u8,
+    update: *const fn (u32, []const u8) u32,
+};
+
+const impls = [_]Impl{
+    .{ .name = "selected", .update = crc32c.update },
+    .{ .name = "slicing-by-8", .update = crc32c.updateSlicing8 },
+    .{ .name = "bytewise", .update = crc32c.updateBytewise },
+};
+
+fn measure(impl: Impl, buf: []const u8) !f64 {
+    const rounds = TOTAL_BYTES / buf.len;
+    var crc: u32 = 0xFFFFFFFF;
+
+    // Warm caches and branch predictors
+    crc = impl.update(crc, buf);
+
+    var timer = try std.time.Timer.start();
+    var i: usize = 0;
+    while (i < rounds) : (i += 1) crc = impl.update(crc, buf);
+    const elapsed_ns = timer.read();
+    std.mem.doNotOptimizeAway(crc);
+
+    const bytes: f64 = @floatFromInt(rounds * buf.len);
+    return bytes / @as(f64, @floatFromInt(elapsed_ns)); // bytes/ns == GB/s
+}
+
+pub fn main() !void {
+    const allocator = std.heap.page_allocator;
+    const buf = try allocator.alloc(u8, 1 << 20);
+    defer allocator.free(buf);
+
+    var prng = std.Random.DefaultPrng.init(0x1EDC6F41);
+    prng.random().bytes(buf);
+
+    std.debug.print("crc32c selected implementation: {s}\n", .{@tagName(crc32c.implementation)});
+
+    const sizes = [_]usize{ 4032, buf.len };
+    for (sizes) |size| {
+        for (impls) |impl| {
+            const gbps = try measure(impl, buf[0..size]);
+            std.debug.print("crc32c impl={s} size={d} gbps={d:.2}\n", .{ impl.name, size, gbps });
+        }
+    }
+}
@@ -57,7 +57,318 @@ pub fn build(b: *std.Build) void {
 
     const run_blocks_tests = b.addRunArtifact(blocks_tests);
 
+    // Unit tests for buffer pool
+    const buffer_pool_tests = b.addTest(.{
+        .name = "buffer-pool-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/buffer_pool.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_buffer_pool_tests = b.addRunArtifact(buffer_pool_tests);
+
+    // Unit tests for snapshot version store
+    const snapshot_tests = b.addTest(.{
+        .name = "snapshot-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/snapshot.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_snapshot_tests = b.addRunArtifact(snapshot_tests);
+
+    // Unit tests for free-space map
+    const free_space_tests = b.addTest(.{
+        .name = "free-space-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/free_space.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_free_space_tests = b.addRunArtifact(free_space_tests);
+
+    // Unit tests for CRC32C implementations
+    const crc32c_tests = b.addTest(.{
+        .name = "crc32c-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/crc32c.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_crc32c_tests = b.addRunArtifact(crc32c_tests);
+
+    // Unit tests for the mmap read path
+    const mapped_file_tests = b.addTest(.{
+        .name = "mapped-file-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/mapped_file.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_mapped_file_tests = b.addRunArtifact(mapped_file_tests);
+
+    // Unit tests for batched block write-back
+    const block_writer_tests = b.addTest(.{
+        .name = "block-writer-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/block_writer.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_block_writer_tests = b.addRunArtifact(block_writer_tests);
+
+    // Unit tests for the per-type block index
+    const block_index_tests = b.addTest(.{
+        .name = "block-index-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/block_index.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_block_index_tests = b.addRunArtifact(block_index_tests);
+
+    const cursor_tests = b.addTest(.{
+        .name = "cursor-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/cursor.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_cursor_tests = b.addRunArtifact(cursor_tests);
+
+    const cbor_tests = b.addTest(.{
+        .name = "cbor-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/cbor.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_cbor_tests = b.addRunArtifact(cbor_tests);
+
+    const lz4_tests = b.addTest(.{
+        .name = "lz4-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/lz4.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_lz4_tests = b.addRunArtifact(lz4_tests);
+
+    const journal_archive_tests = b.addTest(.{
+        .name = "journal-archive-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/journal_archive.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_journal_archive_tests = b.addRunArtifact(journal_archive_tests);
+
+    const journal_reader_tests = b.addTest(.{
+        .name = "journal-reader-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/journal_reader.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_journal_reader_tests = b.addRunArtifact(journal_reader_tests);
+
+    const handles_tests = b.addTest(.{
+        .name = "handles-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/handles.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_handles_tests = b.addRunArtifact(handles_tests);
+
+    const stats_tests = b.addTest(.{
+        .name = "stats-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/stats.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_stats_tests = b.addRunArtifact(stats_tests);
+
+    const json_fields_tests = b.addTest(.{
+        .name = "json-fields-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/json_fields.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_json_fields_tests = b.addRunArtifact(json_fields_tests);
+
+    const query_tests = b.addTest(.{
+        .name = "query-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/query.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_query_tests = b.addRunArtifact(query_tests);
+
+    const parallel_scan_tests = b.addTest(.{
+        .name = "parallel-scan-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/parallel_scan.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_parallel_scan_tests = b.addRunArtifact(parallel_scan_tests);
+
+    const columnar_tests = b.addTest(.{
+        .name = "columnar-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/columnar.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_columnar_tests = b.addRunArtifact(columnar_tests);
+
+    const replication_tests = b.addTest(.{
+        .name = "replication-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/replication.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_replication_tests = b.addRunArtifact(replication_tests);
+
+    const spatial_tests = b.addTest(.{
+        .name = "spatial-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/spatial.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_spatial_tests = b.addRunArtifact(spatial_tests);
+
+    const scrub_tests = b.addTest(.{
+        .name = "scrub-tests",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/scrub.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+
+    const run_scrub_tests = b.addRunArtifact(scrub_tests);
+
     const test_step = b.step("test", "Run unit tests");
     test_step.dependOn(&run_bridge_tests.step);
     test_step.dependOn(&run_blocks_tests.step);
+    test_step.dependOn(&run_buffer_pool_tests.step);
+    test_step.dependOn(&run_snapshot_tests.step);
+    test_step.dependOn(&run_free_space_tests.step);
+    test_step.dependOn(&run_crc32c_tests.step);
+    test_step.dependOn(&run_mapped_file_tests.step);
+    test_step.dependOn(&run_block_writer_tests.step);
+    test_step.dependOn(&run_block_index_tests.step);
+    test_step.dependOn(&run_cursor_tests.step);
+    test_step.dependOn(&run_cbor_tests.step);
+    test_step.dependOn(&run_lz4_tests.step);
+    test_step.dependOn(&run_journal_archive_tests.step);
+    test_step.dependOn(&run_journal_reader_tests.step);
+    test_step.dependOn(&run_handles_tests.step);
+    test_step.dependOn(&run_stats_tests.step);
+    test_step.dependOn(&run_json_fields_tests.step);
+    test_step.dependOn(&run_query_tests.step);
+    test_step.dependOn(&run_parallel_scan_tests.step);
+    test_step.dependOn(&run_columnar_tests.step);
+    test_step.dependOn(&run_replication_tests.step);
+    test_step.dependOn(&run_spatial_tests.step);
+    test_step.dependOn(&run_scrub_tests.step);
+
+    // CRC32C throughput micro-benchmark (always optimized)
+    const crc_bench = b.addExecutable(.{
+        .name = "crc32c-bench",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("bench/crc32c_bench.zig"),
+            .target = target,
+            .optimize = .ReleaseFast,
+            .imports = &.{.{
+                .name = "crc32c",
+                .module = b.createModule(.{
+                    .root_source_file = b.path("src/crc32c.zig"),
+                    .target = target,
+                    .optimize = .ReleaseFast,
+                }),
+            }},
+        }),
+    });
+
+    const run_crc_bench = b.addRunArtifact(crc_bench);
+    const crc_bench_step = b.step("bench-crc", "Measure CRC32C throughput (GB/s)");
+    crc_bench_step.dependOn(&run_crc_bench.step);
+
+    // Bridge throughput/latency suite, driven through the C ABI against an
+    // optimized build of the library. Pass options after `--`, e.g.
+    // `zig build bench -- --scale quick --baseline bench.jsonl`.
+    const bench_lib = b.addLibrary(.{
+        .name = "formdb_bridge_bench",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/bridge.zig"),
+            .target = target,
+            .optimize = .ReleaseFast,
+        }),
+        .linkage = .static,
+    });
+
+    const bridge_bench = b.addExecutable(.{
+        .name = "bridge-bench",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("bench/bridge_bench.zig"),
+            .target = target,
+            .optimize = .ReleaseFast,
+            .link_libc = true,
+        }),
+    });
+    bridge_bench.root_module.addIncludePath(b.path("../generated/abi"));
+    bridge_bench.root_module.linkLibrary(bench_lib);
+
+    const run_bridge_bench = b.addRunArtifact(bridge_bench);
+    if (b.args) |args| run_bridge_bench.addArgs(args);
+    const bridge_bench_step = b.step("bench", "Run the bridge benchmark suite (JSON lines on stdout)");
+    bridge_bench_step.dependOn(&run_bridge_bench.step);
 }
@@ -0,0 +1,340 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Block Index - Live Block IDs per Block Type
+//
+// One bitmap per block type (set = the block currently holds that type
+// and is not deleted), so type scans such as fdb_read_blocks only touch
+// matching blocks. Persisted as type_index blocks:
+//
+//   Offset  Size  Field
+//   0       2     block_type
+//   2       6     reserved (zero)
+//   8       8     page_index (page k covers blocks k*BITS_PER_PAGE ..)
+//   16      4016  bitmap, LSB-first within each byte
+//
+// Pages of every type form one chain, newest-to-oldest through the block
+// header's prev_block_id; the superblock records the newest page. Storage
+// bookkeeping blocks (superblock, free blocks, map and index pages) are
+// not indexed.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const blocks = @import("blocks.zig");
+
+const BlockType = blocks.BlockType;
+const PAYLOAD_SIZE = blocks.PAYLOAD_SIZE;
+
+const TYPE_FIELD_SIZE: usize = 8;
+const PAGE_INDEX_SIZE: usize = 8;
+const PAGE_HEADER_SIZE: usize = TYPE_FIELD_SIZE + PAGE_INDEX_SIZE;
+const BITMAP_BYTES: usize = PAYLOAD_SIZE - PAGE_HEADER_SIZE;
+pub const BITS_PER_PAGE: u64 = BITMAP_BYTES * 8;
+
+const Members = struct {
+    bits: std.DynamicBitSetUnmanaged = .{},
+    /// Block ID of each page (0 = not yet placed on disk)
+    pages: std.ArrayList(u64) = .{},
+    dirty: std.ArrayList(bool) = .{},
+    count: u64 = 0,
+
+    fn deinit(self: *Members, allocator: std.mem.Allocator) void {
+        self.bits.deinit(allocator);
+        self.pages.deinit(allocator);
+        self.dirty.deinit(allocator);
+    }
+
+    fn ensurePages(self: *Members, allocator: std.mem.Allocator, page_count: usize) !void {
+        if (page_count <= self.pages.items.len) return;
+        try self.bits.resize(allocator, page_count * BITS_PER_PAGE, false);
+        while (self.pages.items.len < page_count) {
+            try self.pages.append(allocator, 0);
+            try self.dirty.append(allocator, true);
+        }
+    }
+
+    fn contains(self: *const Members, block_id: u64) bool {
+        if (block_id >= self.bits.bit_length) return false;
+        return self.bits.isSet(@intCast(block_id));
+    }
+
+    fn remove(self: *Members, block_id: u64) void {
+        if (!self.contains(block_id)) return;
+        self.bits.unset(@intCast(block_id));
+        self.count -= 1;
+        self.dirty.items[@intCast(block_id / BITS_PER_PAGE)] = true;
+    }
+};
+
+/// One persisted page: `index` within the bitmap of `block_type`
+pub const PageRef = struct {
+    block_type: u16,
+    index: usize,
+};
+
+/// Not thread-safe: BlockStorage guards it with its alloc_mutex
+pub const TypeIndex = struct {
+    allocator: std.mem.Allocator,
+    types: std.AutoArrayHashMapUnmanaged(u16, Members) = .{},
+    /// Placed pages, oldest first (the on-disk chain order)
+    chain: std.ArrayList(PageRef) = .{},
+
+    pub fn init(allocator: std.mem.Allocator) TypeIndex {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(self: *TypeIndex) void {
+        for (self.types.values()) |*members| members.deinit(self.allocator);
+        self.types.deinit(self.allocator);
+        self.chain.deinit(self.allocator);
+    }
+
+    /// Whether blocks of this type are tracked at all
+    pub fn isIndexed(block_type: u16) bool {
+        return switch (block_type) {
+            @intFromEnum(BlockType.free),
+            @intFromEnum(BlockType.superblock),
+            @intFromEnum(BlockType.free_space_map),
+            @intFromEnum(BlockType.type_index),
+            => false,
+            else => true,
+        };
+    }
+
+    pub fn pagesFor(block_count: u64) usize {
+        return @intCast((block_count + BITS_PER_PAGE - 1) / BITS_PER_PAGE);
+    }
+
+    /// Record that `block_id` is about to hold a `block_type` block
+    pub fn set(self: *TypeIndex, block_id: u64, block_type: u16, deleted: bool) !void {
+        const live = !deleted and isIndexed(block_type);
+        for (self.types.keys(), self.types.values()) |key, *members| {
+            if (!live or key != block_type) members.remove(block_id);
+        }
+        if (!live) return;
+
+        const entry = try self.types.getOrPut(self.allocator, block_type);
+        if (!entry.found_existing) entry.value_ptr.* = .{};
+        const members = entry.value_ptr;
+        try members.ensurePages(self.allocator, pagesFor(block_id + 1));
+        if (members.contains(block_id)) return;
+        members.bits.set(@intCast(block_id));
+        members.count += 1;
+        members.dirty.items[@intCast(block_id / BITS_PER_PAGE)] = true;
+    }
+
+    /// The type `block_id` is listed under, if any
+    pub fn typeOf(self: *const TypeIndex, block_id: u64) ?u16 {
+        for (self.types.keys(), self.types.values()) |key, *members| {
+            if (members.contains(block_id)) return key;
+        }
+        return null;
+    }
+
+    pub fn contains(self: *const TypeIndex, block_type: u16, block_id: u64) bool {
+        const members = self.types.getPtr(block_type) orelse return false;
+        return members.contains(block_id);
+    }
+
+    pub fn count(self: *const TypeIndex, block_type: u16) u64 {
+        const members = self.types.getPtr(block_type) orelse return 0;
+        return members.count;
+    }
+
+    /// Append up to `max` IDs of `block_type` in [from, limit) to `out`,
+    /// ascending. Returns the ID to resume from (`limit` once exhausted).
+    pub fn collect(
+        self: *const TypeIndex,
+        allocator: std.mem.Allocator,
+        block_type: u16,
+        from: u64,
+        limit: u64,
+        max: usize,
+        out: *std.ArrayList(u64),
+    ) !u64 {
+        const members = self.types.getPtr(block_type) orelse return limit;
+        const mask_bits = @bitSizeOf(std.DynamicBitSetUnmanaged.MaskInt);
+        const end = @min(limit, members.bits.bit_length);
+
+        var taken: usize = 0;
+        var id = from;
+        while (id < end) : (id += 1) {
+            // Skip empty words whole
+            if (id % mask_bits == 0 and members.bits.masks[@intCast(id / mask_bits)] == 0) {
+                id += mask_bits - 1;
+                continue;
+            }
+            if (!members.bits.isSet(@intCast(id))) continue;
+            if (taken == max) return id;
+            try out.append(allocator, id);
+            taken += 1;
+        }
+        return limit;
+    }
+
+    /// Give every unplaced page a block ID from `next_block`. Returns
+    /// whether any page was placed.
+    pub fn placePages(self: *TypeIndex, next_block: *u64) !bool {
+        var placed = false;
+        for (self.types.keys(), self.types.values()) |key, *members| {
+            for (members.pages.items, 0..) |*page_id, index| {
+                if (page_id.* != 0) continue;
+                page_id.* = next_block.*;
+                next_block.* += 1;
+                members.dirty.items[index] = true;
+                try self.chain.append(self.allocator, .{ .block_type = key, .index = index });
+                placed = true;
+            }
+        }
+        return placed;
+    }
+
+    pub fn pageId(self: *const TypeIndex, ref: PageRef) u64 {
+        return self.types.getPtr(ref.block_type).?.pages.items[ref.index];
+    }
+
+    pub fn isDirty(self: *const TypeIndex, ref: PageRef) bool {
+        return self.types.getPtr(ref.block_type).?.dirty.items[ref.index];
+    }
+
+    pub fn markClean(self: *TypeIndex, ref: PageRef) void {
+        self.types.getPtr(ref.block_type).?.dirty.items[ref.index] = false;
+    }
+
+    /// Rewrite every page at the next superblock write
+    pub fn markAllDirty(self: *TypeIndex) void {
+        for (self.types.values()) |*members| @memset(members.dirty.items, true);
+    }
+
+    /// Newest page in the chain (0 when nothing is placed)
+    pub fn tail(self: *const TypeIndex) u64 {
+        if (self.chain.items.len == 0) return 0;
+        return self.pageId(self.chain.items[self.chain.items.len - 1]);
+    }
+
+    /// Serialize one page into a block payload
+    pub fn encodePage(self: *const TypeIndex, ref: PageRef, out: *[PAYLOAD_SIZE]u8) void {
+        const members = self.types.getPtr(ref.block_type).?;
+        @memset(out, 0);
+        std.mem.writeInt(u16, out[0..2], ref.block_type, .little);
+        std.mem.writeInt(u64, out[TYPE_FIELD_SIZE..][0..PAGE_INDEX_SIZE], ref.index, .little);
+
+        const bitmap = out[PAGE_HEADER_SIZE..];
+        const base: u64 = ref.index * BITS_PER_PAGE;
+        var bit: u64 = 0;
+        while (bit < BITS_PER_PAGE) : (bit += 1) {
+            if (members.bits.isSet(@intCast(base + bit))) {
+                bitmap[@intCast(bit / 8)] |= @as(u8, 1) << @intCast(bit % 8);
+            }
+        }
+    }
+
+    /// Load a page read from disk while walking the chain newest-first
+    /// (`block_id` is where it lives); call `finishLoad` afterwards
+    pub fn loadPage(self: *TypeIndex, block_id: u64, payload: []const u8) !void {
+        if (payload.len != PAYLOAD_SIZE) return error.InvalidTypeIndex;
+        const block_type = std.mem.readInt(u16, payload[0..2], .little);
+        const index: usize = @intCast(std.mem.readInt(u64, payload[TYPE_FIELD_SIZE..][0..PAGE_INDEX_SIZE], .little));
+
+        const entry = try self.types.getOrPut(self.allocator, block_type);
+        if (!entry.found_existing) entry.value_ptr.* = .{};
+        const members = entry.value_ptr;
+        try members.ensurePages(self.allocator, index + 1);
+
+        const bitmap = payload[PAGE_HEADER_SIZE..];
+        const base: u64 = index * BITS_PER_PAGE;
+        for (bitmap, 0..) |byte, byte_index| {
+            if (byte == 0) continue;
+            var b: u4 = 0;
+            while (b < 8) : (b += 1) {
+                if (byte & (@as(u8, 1) << @intCast(b)) == 0) continue;
+                const id = base + byte_index * 8 + b;
+                if (!members.bits.isSet(@intCast(id))) {
+                    members.bits.set(@intCast(id));
+                    members.count += 1;
+                }
+            }
+        }
+        members.pages.items[index] = block_id;
+        members.dirty.items[index] = false;
+        try self.chain.append(self.allocator, .{ .block_type = block_type, .index = index });
+    }
+
+    /// Restore oldest-first chain order after loading newest-first
+    pub fn finishLoad(self: *TypeIndex) void {
+        std.mem.reverse(PageRef, self.chain.items);
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+const DOC: u16 = @intFromEnum(BlockType.document);
+const SEGMENT: u16 = @intFromEnum(BlockType.journal_segment);
+
+test "blocks move between types and leave on delete" {
+    var index = TypeIndex.init(std.testing.allocator);
+    defer index.deinit();
+
+    try index.set(5, DOC, false);
+    try index.set(6, SEGMENT, false);
+    try index.set(7, DOC, false);
+    try std.testing.expectEqual(@as(u64, 2), index.count(DOC));
+
+    // Block 5 is freed, block 6 is reused for a document
+    try index.set(5, @intFromEnum(BlockType.free), true);
+    try index.set(6, DOC, false);
+    try std.testing.expect(!index.contains(DOC, 5));
+    try std.testing.expect(!index.contains(SEGMENT, 6));
+    try std.testing.expectEqual(@as(?u16, DOC), index.typeOf(6));
+    try std.testing.expectEqual(@as(?u16, null), index.typeOf(5));
+
+    var ids: std.ArrayList(u64) = .{};
+    defer ids.deinit(std.testing.allocator);
+    try std.testing.expectEqual(@as(u64, 100), try index.collect(std.testing.allocator, DOC, 0, 100, 10, &ids));
+    try std.testing.expectEqualSlices(u64, &.{ 6, 7 }, ids.items);
+
+    // Bounded batches resume where the last one stopped
+    ids.clearRetainingCapacity();
+    try std.testing.expectEqual(@as(u64, 7), try index.collect(std.testing.allocator, DOC, 0, 100, 1, &ids));
+    try std.testing.expectEqual(@as(u64, 100), try index.collect(std.testing.allocator, DOC, 7, 100, 1, &ids));
+    try std.testing.expectEqualSlices(u64, &.{ 6, 7 }, ids.items);
+
+    // Bookkeeping blocks are never indexed
+    try index.set(9, @intFromEnum(BlockType.free_space_map), false);
+    try std.testing.expectEqual(@as(usize, 2), index.types.count());
+}
+
+test "pages roundtrip through the chain" {
+    var index = TypeIndex.init(std.testing.allocator);
+    defer index.deinit();
+
+    try index.set(3, DOC, false);
+    try index.set(BITS_PER_PAGE + 2, DOC, false);
+    try index.set(4, SEGMENT, false);
+
+    var next_block: u64 = 500;
+    try std.testing.expect(try index.placePages(&next_block));
+    try std.testing.expectEqual(@as(u64, 503), next_block);
+    try std.testing.expect(!(try index.placePages(&next_block)));
+
+    var loaded = TypeIndex.init(std.testing.allocator);
+    defer loaded.deinit();
+
+    // Walk newest-first, as BlockStorage does from the superblock
+    var payload: [PAYLOAD_SIZE]u8 = undefined;
+    var i = index.chain.items.len;
+    while (i > 0) {
+        i -= 1;
+        const ref = index.chain.items[i];
+        index.encodePage(ref, &payload);
+        try loaded.loadPage(index.pageId(ref), &payload);
+    }
+    loaded.finishLoad();
+
+    try std.testing.expect(loaded.contains(DOC, 3));
+    try std.testing.expect(loaded.contains(DOC, BITS_PER_PAGE + 2));
+    try std.testing.expect(loaded.contains(SEGMENT, 4));
+    try std.testing.expect(!loaded.contains(DOC, 4));
+    try std.testing.expectEqual(index.tail(), loaded.tail());
+}
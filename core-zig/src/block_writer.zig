@@ -0,0 +1,415 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Block Writer - Batched Write-Back for Commit Phases
+//
+// The commit leader hands every block of a phase over as one WriteBatch,
+// which reaches disk as:
+//
+//   data blocks (any order) -> fsync -> commit block -> fsync
+//
+// On Linux the data writes and the first fsync (drained behind them) go
+// to io_uring as one submission. Their completions are checked before the
+// commit block (the superblock) and the final fsync are queued, so the
+// superblock is never written over blocks that did not reach disk. Where
+// io_uring is missing or refused (old kernels, seccomp) a small thread
+// pool issues the data writes in parallel and the syncs in order. Every
+// backend stops at the first failed data write.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const builtin = @import("builtin");
+const blocks = @import("blocks.zig");
+
+const Block = blocks.Block;
+const BLOCK_SIZE = blocks.BLOCK_SIZE;
+const linux = std.os.linux;
+
+pub const io_uring_supported = builtin.os.tag == .linux;
+
+/// Submission queue depth; larger batches are fed through in chunks
+const RING_ENTRIES: u16 = 64;
+
+/// Worker threads for the portable fallback
+pub const DEFAULT_WRITE_THREADS: u32 = 4;
+
+const OP_WRITE: u64 = 0;
+const OP_FSYNC: u64 = 1;
+
+pub const Backend = enum { io_uring, thread_pool, sequential };
+
+pub const PendingWrite = struct {
+    block_id: u64,
+    /// The on-disk image (Block.toBytes layout), which every backend
+    /// writes as is
+    image: [BLOCK_SIZE]u8,
+    /// Collected from the buffer pool, which already holds this image
+    staged: bool = false,
+
+    pub fn of(block_id: u64, block: *const Block, staged: bool) PendingWrite {
+        return .{ .block_id = block_id, .image = block.toBytes(), .staged = staged };
+    }
+
+    /// The block in native byte order, as the pool holds it
+    pub fn native(self: *const PendingWrite) Block {
+        return Block.fromBytesUnchecked(&self.image);
+    }
+};
+
+pub const WriteBatch = struct {
+    allocator: std.mem.Allocator,
+    /// Written in any order; durable before `commit_block` is written
+    data: std.ArrayList(PendingWrite) = .{},
+    /// Written last, after `data` is synced (normally the superblock)
+    commit_block: ?PendingWrite = null,
+
+    pub fn init(allocator: std.mem.Allocator) WriteBatch {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(self: *WriteBatch) void {
+        self.data.deinit(self.allocator);
+    }
+
+    /// Queue a data block
+    pub fn add(self: *WriteBatch, block_id: u64, block: *const Block) !void {
+        try self.data.append(self.allocator, PendingWrite.of(block_id, block, false));
+    }
+
+    /// Queue a dirty pool frame (signature matches BufferPool.flushDirty)
+    pub fn addStaged(self: *WriteBatch, block_id: u64, block: *const Block) anyerror!void {
+        try self.data.append(self.allocator, PendingWrite.of(block_id, block, true));
+    }
+
+    pub fn setCommitBlock(self: *WriteBatch, block_id: u64, block: *const Block) void {
+        self.commit_block = PendingWrite.of(block_id, block, false);
+    }
+};
+
+pub const BlockWriter = struct {
+    allocator: std.mem.Allocator,
+    backend: Backend,
+    ring: if (io_uring_supported) ?linux.IoUring else void,
+    threads: ?*std.Thread.Pool = null,
+    /// One batch at a time: the ring is single-producer
+    mutex: std.Thread.Mutex = .{},
+    /// Tests only: write just half of this block's image, as a full disk
+    /// might
+    short_write: if (builtin.is_test) ?u64 else void = if (builtin.is_test) null else {},
+
+    /// Pick the fastest available backend; never fails, at worst writes
+    /// sequentially from the calling thread
+    pub fn init(allocator: std.mem.Allocator, use_io_uring: bool) BlockWriter {
+        var writer = BlockWriter{
+            .allocator = allocator,
+            .backend = .sequential,
+            .ring = if (io_uring_supported) null else {},
+        };
+
+        if (io_uring_supported and use_io_uring) {
+            if (linux.IoUring.init(RING_ENTRIES, 0)) |ring| {
+                writer.ring = ring;
+                writer.backend = .io_uring;
+                return writer;
+            } else |_| {}
+        }
+
+        if (!builtin.single_threaded) {
+            if (allocator.create(std.Thread.Pool)) |pool| {
+                if (pool.init(.{ .allocator = allocator, .n_jobs = DEFAULT_WRITE_THREADS })) {
+                    writer.threads = pool;
+                    writer.backend = .thread_pool;
+                } else |_| {
+                    allocator.destroy(pool);
+                }
+            } else |_| {}
+        }
+        return writer;
+    }
+
+    pub fn deinit(self: *BlockWriter) void {
+        if (io_uring_supported) {
+            if (self.ring) |*ring| ring.deinit();
+            self.ring = null;
+        }
+        if (self.threads) |pool| {
+            pool.deinit();
+            self.allocator.destroy(pool);
+        }
+        self.threads = null;
+    }
+
+    /// Write and sync the batch. Returns only once everything in it is
+    /// durable (or the first error, after all queued I/O has settled).
+    pub fn submit(self: *BlockWriter, file: std.fs.File, batch: *const WriteBatch) !void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        switch (self.backend) {
+            .io_uring => if (io_uring_supported) return self.submitRing(file, batch) else unreachable,
+            .thread_pool => return self.submitThreaded(file, batch),
+            .sequential => return self.submitSequential(file, batch),
+        }
+    }
+
+    // --------------------------------------------------------
+    // io_uring backend
+    // --------------------------------------------------------
+
+    const RingState = struct {
+        inflight: u32 = 0,
+        failure: ?anyerror = null,
+
+        fn reap(state: *RingState, ring: *linux.IoUring, wait_nr: u32) !void {
+            var cqes: [RING_ENTRIES]linux.io_uring_cqe = undefined;
+            const n = try ring.copy_cqes(&cqes, wait_nr);
+            for (cqes[0..n]) |cqe| {
+                state.inflight -= 1;
+                if (state.failure != null) continue;
+                state.failure = completionError(cqe);
+            }
+        }
+    };
+
+    fn completionError(cqe: linux.io_uring_cqe) ?anyerror {
+        return switch (cqe.err()) {
+            .SUCCESS => if (cqe.user_data == OP_WRITE and cqe.res != @as(i32, BLOCK_SIZE)) error.ShortWrite else null,
+            .NOSPC => error.NoSpaceLeft,
+            .DQUOT => error.DiskQuota,
+            .CANCELED => error.Canceled,
+            else => error.InputOutput,
+        };
+    }
+
+    fn getSqe(ring: *linux.IoUring, state: *RingState) !*linux.io_uring_sqe {
+        return ring.get_sqe() catch {
+            // Queue full: hand it to the kernel and make room in the CQ
+            state.inflight += try ring.submit();
+            while (state.inflight >= RING_ENTRIES) try state.reap(ring, 1);
+            return ring.get_sqe();
+        };
+    }
+
+    fn submitRing(self: *BlockWriter, file: std.fs.File, batch: *const WriteBatch) !void {
+        const ring = &self.ring.?;
+        var state = RingState{};
+
+        // Whatever happens, no completion may outlive the batch buffers
+        defer {
+            while (state.inflight > 0) state.reap(ring, 1) catch break;
+        }
+
+        if (batch.data.items.len > 0) {
+            for (batch.data.items) |*pending| {
+                const sqe = try getSqe(ring, &state);
+                sqe.prep_write(file.handle, self.image(pending), pending.block_id * BLOCK_SIZE);
+                sqe.user_data = OP_WRITE;
+            }
+
+            const barrier = try getSqe(ring, &state);
+            barrier.prep_fsync(file.handle, 0);
+            barrier.user_data = OP_FSYNC;
+            barrier.flags |= linux.IOSQE_IO_DRAIN;
+
+            // The data must be durable before the commit block is queued
+            state.inflight += try ring.submit();
+            while (state.inflight > 0) try state.reap(ring, 1);
+            if (state.failure) |err| return err;
+        }
+
+        if (batch.commit_block) |*commit| {
+            const write = try getSqe(ring, &state);
+            write.prep_write(file.handle, self.image(commit), commit.block_id * BLOCK_SIZE);
+            write.user_data = OP_WRITE;
+            write.flags |= linux.IOSQE_IO_LINK;
+
+            const final = try getSqe(ring, &state);
+            final.prep_fsync(file.handle, 0);
+            final.user_data = OP_FSYNC;
+
+            state.inflight += try ring.submit();
+            while (state.inflight > 0) try state.reap(ring, 1);
+            if (state.failure) |err| return err;
+        }
+    }
+
+    // --------------------------------------------------------
+    // Portable backends
+    // --------------------------------------------------------
+
+    const ErrorSlot = struct {
+        mutex: std.Thread.Mutex = .{},
+        err: ?anyerror = null,
+
+        fn set(slot: *ErrorSlot, err: anyerror) void {
+            slot.mutex.lock();
+            defer slot.mutex.unlock();
+            if (slot.err == null) slot.err = err;
+        }
+    };
+
+    fn writeJob(self: *const BlockWriter, file: std.fs.File, pending: *const PendingWrite, slot: *ErrorSlot) void {
+        self.writePending(file, pending) catch |err| slot.set(err);
+    }
+
+    fn submitThreaded(self: *BlockWriter, file: std.fs.File, batch: *const WriteBatch) !void {
+        const pool = self.threads.?;
+        if (batch.data.items.len < 2) return self.submitSequential(file, batch);
+
+        var slot = ErrorSlot{};
+        var wg: std.Thread.WaitGroup = .{};
+        for (batch.data.items) |*pending| pool.spawnWg(&wg, writeJob, .{ self, file, pending, &slot });
+        pool.waitAndWork(&wg);
+        if (slot.err) |err| return err;
+
+        try file.sync();
+        try self.writeCommit(file, batch);
+    }
+
+    fn submitSequential(self: *const BlockWriter, file: std.fs.File, batch: *const WriteBatch) !void {
+        for (batch.data.items) |*pending| try self.writePending(file, pending);
+        if (batch.data.items.len > 0) try file.sync();
+        try self.writeCommit(file, batch);
+    }
+
+    fn writeCommit(self: *const BlockWriter, file: std.fs.File, batch: *const WriteBatch) !void {
+        const commit = if (batch.commit_block) |*c| c else return;
+        try self.writePending(file, commit);
+        try file.sync();
+    }
+
+    fn writePending(self: *const BlockWriter, file: std.fs.File, pending: *const PendingWrite) !void {
+        const bytes = self.image(pending);
+        try file.pwriteAll(bytes, pending.block_id * BLOCK_SIZE);
+        if (bytes.len < BLOCK_SIZE) return error.ShortWrite;
+    }
+
+    /// What to write for `pending`: its whole image outside tests
+    fn image(self: *const BlockWriter, pending: *const PendingWrite) []const u8 {
+        if (builtin.is_test) {
+            if (self.short_write == pending.block_id) return pending.image[0 .. BLOCK_SIZE / 2];
+        }
+        return &pending.image;
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+fn expectBatchOnDisk(file: std.fs.File, batch: *const WriteBatch) !void {
+    for (batch.data.items) |*pending| {
+        var bytes: [BLOCK_SIZE]u8 = undefined;
+        _ = try file.preadAll(&bytes, pending.block_id * BLOCK_SIZE);
+        const block = try Block.fromBytes(&bytes);
+        const expected = pending.native();
+        try std.testing.expectEqualSlices(u8, expected.getPayload(), block.getPayload());
+        try std.testing.expectEqualSlices(u8, &pending.image, &bytes);
+    }
+    if (batch.commit_block) |*commit| {
+        var bytes: [BLOCK_SIZE]u8 = undefined;
+        _ = try file.preadAll(&bytes, commit.block_id * BLOCK_SIZE);
+        const block = try Block.fromBytes(&bytes);
+        const expected = commit.native();
+        try std.testing.expectEqualSlices(u8, expected.getPayload(), block.getPayload());
+        try std.testing.expectEqualSlices(u8, &commit.image, &bytes);
+    }
+}
+
+test "every backend writes the whole batch" {
+    const allocator = std.testing.allocator;
+    const path = "test_block_writer.bin";
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const file = try std.fs.cwd().createFile(path, .{ .read = true });
+    defer file.close();
+
+    var batch = WriteBatch.init(allocator);
+    defer batch.deinit();
+
+    // More than one ring's worth, to exercise chunked submission
+    var id: u64 = 1;
+    while (id <= RING_ENTRIES + 10) : (id += 1) {
+        var block = Block.init(.document, id, 1);
+        var payload: [8]u8 = undefined;
+        std.mem.writeInt(u64, &payload, id * 31, .little);
+        try block.setPayload(&payload);
+        try batch.add(id, &block);
+    }
+    var head = Block.init(.superblock, 0, 1);
+    try head.setPayload("commit");
+    batch.setCommitBlock(0, &head);
+
+    const backends = [_]Backend{ .io_uring, .thread_pool, .sequential };
+    for (backends) |backend| {
+        var writer = BlockWriter.init(allocator, backend == .io_uring);
+        defer writer.deinit();
+        if (writer.backend != backend and backend != .sequential) continue; // not available here
+        writer.backend = backend;
+
+        try file.setEndPos(0);
+        try writer.submit(file, &batch);
+        try expectBatchOnDisk(file, &batch);
+    }
+}
+
+test "data-only batch is synced without a commit block" {
+    const allocator = std.testing.allocator;
+    const path = "test_block_writer_data.bin";
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const file = try std.fs.cwd().createFile(path, .{ .read = true });
+    defer file.close();
+
+    var batch = WriteBatch.init(allocator);
+    defer batch.deinit();
+    var block = Block.init(.journal_segment, 3, 7);
+    try block.setPayload("segment");
+    try batch.add(3, &block);
+
+    var writer = BlockWriter.init(allocator, true);
+    defer writer.deinit();
+    try writer.submit(file, &batch);
+    try expectBatchOnDisk(file, &batch);
+}
+
+test "a failed data write leaves the commit block unwritten" {
+    const allocator = std.testing.allocator;
+    const path = "test_block_writer_short.bin";
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const file = try std.fs.cwd().createFile(path, .{ .read = true });
+    defer file.close();
+
+    var old = Block.init(.superblock, 0, 1);
+    try old.setPayload("old");
+    const old_image = old.toBytes();
+
+    var batch = WriteBatch.init(allocator);
+    defer batch.deinit();
+    var id: u64 = 1;
+    while (id <= 8) : (id += 1) {
+        var block = Block.init(.document, id, 2);
+        try block.setPayload("data");
+        try batch.add(id, &block);
+    }
+    var head = Block.init(.superblock, 0, 2);
+    try head.setPayload("new");
+    batch.setCommitBlock(0, &head);
+
+    const backends = [_]Backend{ .io_uring, .thread_pool, .sequential };
+    for (backends) |backend| {
+        var writer = BlockWriter.init(allocator, backend == .io_uring);
+        defer writer.deinit();
+        if (writer.backend != backend and backend != .sequential) continue; // not available here
+        writer.backend = backend;
+        writer.short_write = 5;
+
+        try file.setEndPos(0);
+        try file.pwriteAll(&old_image, 0);
+        try std.testing.expectError(error.ShortWrite, writer.submit(file, &batch));
+
+        var bytes: [BLOCK_SIZE]u8 = undefined;
+        _ = try file.preadAll(&bytes, 0);
+        try std.testing.expectEqualSlices(u8, &old_image, &bytes);
+    }
+}
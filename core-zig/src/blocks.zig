@@ -8,6 +8,31 @@
 
 const std = @import("std");
 const builtin = @import("builtin");
+const buffer_pool = @import("buffer_pool.zig");
+const snapshot = @import("snapshot.zig");
+const free_space = @import("free_space.zig");
+const crc32c_impl = @import("crc32c.zig");
+const mapped_file = @import("mapped_file.zig");
+const block_writer = @import("block_writer.zig");
+const block_index = @import("block_index.zig");
+const lz4 = @import("lz4.zig");
+const journal_archive = @import("journal_archive.zig");
+const journal_reader = @import("journal_reader.zig");
+const engine_stats = @import("stats.zig");
+
+pub const BufferPool = buffer_pool.BufferPool;
+pub const Snapshot = snapshot.Snapshot;
+pub const VersionStore = snapshot.VersionStore;
+pub const FreeSpaceMap = free_space.FreeSpaceMap;
+pub const MappedFile = mapped_file.MappedFile;
+pub const BlockWriter = block_writer.BlockWriter;
+pub const WriteBatch = block_writer.WriteBatch;
+pub const TypeIndex = block_index.TypeIndex;
+pub const ArchivePacker = journal_archive.ArchivePacker;
+pub const JournalIndex = journal_reader.JournalIndex;
+pub const JournalLocation = journal_reader.Location;
+pub const EngineStats = engine_stats.EngineStats;
+const PhaseTimer = engine_stats.PhaseTimer;
 
 // ============================================================
 // Constants (must match Forth specification)
@@ -37,6 +62,12 @@ pub const BlockType = enum(u16) {
     schema = 0x0050,
     constraint = 0x0051,
     migration = 0x0060,
+    // Extension range 0xFF00-0xFFFF (spec/blocks.adoc)
+    free_space_map = 0xFF01,
+    type_index = 0xFF02,
+    journal_archive = 0xFF03,
+    spatial_node = 0xFF04,
+    spatial_meta = 0xFF05,
 };
 
 // Block Flags (bitmask)
@@ -48,6 +79,25 @@ pub const BlockFlags = packed struct {
     _reserved: u4 = 0,
 };
 
+/// BlockFlags.deleted as a header flags mask
+pub const FLAG_DELETED: u32 = @as(u8, @bitCast(BlockFlags{ .deleted = true }));
+
+/// BlockFlags.chained as a header flags mask
+pub const FLAG_CHAINED: u32 = @as(u8, @bitCast(BlockFlags{ .chained = true }));
+
+/// BlockFlags.compressed as a header flags mask
+pub const FLAG_COMPRESSED: u32 = @as(u8, @bitCast(BlockFlags{ .compressed = true }));
+
+/// `block` is a `block_type` block that has not been freed
+pub fn holdsLive(block: *const Block, block_type: BlockType) bool {
+    return block.header.block_type == @intFromEnum(block_type) and block.header.flags & FLAG_DELETED == 0;
+}
+
+/// `block` is a document that has not been freed
+pub fn isLiveDocument(block: *const Block) bool {
+    return holdsLive(block, .document);
+}
+
 // ============================================================
 // Block Header Structure (64 bytes, matching Forth layout)
 // ============================================================
@@ -148,7 +198,8 @@ pub const BlockHeader = extern struct {
 // Complete Block (Header + Payload)
 // ============================================================
 
-pub const Block = struct {
+// extern so a mapped 4 KiB region can be viewed as a Block in place
+pub const Block = extern struct {
     header: BlockHeader,
     payload: [PAYLOAD_SIZE]u8,
 
@@ -200,13 +251,14 @@ pub const Block = struct {
         }
     }
 
-    /// Write block to bytes (for disk storage)
+    /// Write block to bytes (for disk storage; the header little-endian)
     pub fn toBytes(self: *const Block) [BLOCK_SIZE]u8 {
         var bytes: [BLOCK_SIZE]u8 = undefined;
 
         // Copy header
-        const header_bytes = std.mem.asBytes(&self.header);
-        @memcpy(bytes[0..HEADER_SIZE], header_bytes);
+        var header = self.header;
+        header.toLittleEndian();
+        @memcpy(bytes[0..HEADER_SIZE], std.mem.asBytes(&header));
 
         // Copy payload
         @memcpy(bytes[HEADER_SIZE..], &self.payload);
@@ -214,6 +266,15 @@ pub const Block = struct {
         return bytes;
     }
 
+    /// Parse bytes written by toBytes without validating them
+    pub fn fromBytesUnchecked(bytes: *const [BLOCK_SIZE]u8) Block {
+        var block: Block = undefined;
+        block.header = @bitCast(bytes[0..HEADER_SIZE].*);
+        block.header.toNative();
+        @memcpy(&block.payload, bytes[HEADER_SIZE..]);
+        return block;
+    }
+
     /// Read block from bytes
     pub fn fromBytes(bytes: *const [BLOCK_SIZE]u8) !Block {
         var block: Block = undefined;
@@ -234,45 +295,161 @@ pub const Block = struct {
 };
 
 // ============================================================
-// CRC32C Implementation (Castagnoli polynomial: 0x1EDC6F41)
+// Overflow Chains (documents larger than one payload)
 // ============================================================
-// This matches the Forth implementation for bit-exact compatibility
-
-const CRC32C_TABLE = blk: {
-    @setEvalBranchQuota(3000); // Allow compile-time table generation
-    var table: [256]u32 = undefined;
-    for (&table, 0..) |*entry, i| {
-        var crc: u32 = @intCast(i);
-        var j: usize = 0;
-        while (j < 8) : (j += 1) {
-            if (crc & 1 != 0) {
-                crc = (crc >> 1) ^ 0x82F63B78;
-            } else {
-                crc >>= 1;
-            }
-        }
-        entry.* = crc;
+//
+// A document that does not fit in PAYLOAD_SIZE keeps its block ID: the
+// head block carries the CHAINED flag and starts its payload with an
+// OverflowHeader, followed by the first CHAIN_HEAD_CAPACITY bytes. The
+// rest lives in a contiguous extent of document_overflow blocks, each
+// linked to its predecessor through prev_block_id and stamped with the
+// head's sequence; all but the last are CHAINED too. The head's own
+// prev_block_id stays free for the collection link.
+//
+// Offset  Size  Field
+// 0       8     total_len (whole document)
+// 8       8     first_block (start of the overflow extent)
+// 16      4     block_count (blocks in the extent)
+// 20      4     reserved
+
+pub const OVERFLOW_HEADER_SIZE: usize = 24;
+
+/// Document bytes held by a chained head block
+pub const CHAIN_HEAD_CAPACITY: usize = PAYLOAD_SIZE - OVERFLOW_HEADER_SIZE;
+
+/// Largest document accepted for a single block ID
+pub const MAX_DOCUMENT_SIZE: usize = 16 * 1024 * 1024;
+
+pub const OverflowHeader = struct {
+    total_len: u64,
+    first_block: u64,
+    block_count: u32,
+
+    /// Overflow blocks needed for a document of `len` bytes (0 if it fits
+    /// in one block)
+    pub fn blocksFor(len: usize) u32 {
+        if (len <= PAYLOAD_SIZE) return 0;
+        return @intCast(std.math.divCeil(usize, len - CHAIN_HEAD_CAPACITY, PAYLOAD_SIZE) catch unreachable);
+    }
+
+    pub fn encode(self: OverflowHeader, out: *[OVERFLOW_HEADER_SIZE]u8) void {
+        std.mem.writeInt(u64, out[0..8], self.total_len, .little);
+        std.mem.writeInt(u64, out[8..16], self.first_block, .little);
+        std.mem.writeInt(u32, out[16..20], self.block_count, .little);
+        std.mem.writeInt(u32, out[20..24], 0, .little);
+    }
+
+    /// The chain described by a document head, or null for a single-block
+    /// document
+    pub fn of(head: *const Block) !?OverflowHeader {
+        if (head.header.flags & FLAG_CHAINED == 0) return null;
+        if (head.header.block_type != @intFromEnum(BlockType.document)) return null;
+
+        const payload = head.getPayload();
+        if (payload.len != PAYLOAD_SIZE) return error.InvalidChain;
+        const chain = OverflowHeader{
+            .total_len = std.mem.readInt(u64, payload[0..8], .little),
+            .first_block = std.mem.readInt(u64, payload[8..16], .little),
+            .block_count = std.mem.readInt(u32, payload[16..20], .little),
+        };
+        if (chain.total_len <= PAYLOAD_SIZE or chain.total_len > MAX_DOCUMENT_SIZE) return error.InvalidChain;
+        if (chain.block_count != blocksFor(@intCast(chain.total_len))) return error.InvalidChain;
+        return chain;
+    }
+
+    /// Payload length of overflow block `index` (PAYLOAD_SIZE except for
+    /// the last block)
+    pub fn chunkLen(self: OverflowHeader, index: u32) usize {
+        const tail_len: usize = @intCast(self.total_len - CHAIN_HEAD_CAPACITY);
+        return @min(PAYLOAD_SIZE, tail_len - @as(usize, index) * PAYLOAD_SIZE);
+    }
+
+    /// Whether `header` is overflow block `index` of this chain, written in
+    /// the same commit as a head with `sequence`
+    pub fn links(self: OverflowHeader, header: *const BlockHeader, index: u32, head_id: u64, sequence: u64) bool {
+        const block_id = self.first_block + index;
+        const prev = if (index == 0) head_id else block_id - 1;
+        const chained = index + 1 < self.block_count;
+        return header.magic == BLOCK_MAGIC and
+            header.block_type == @intFromEnum(BlockType.document_overflow) and
+            header.block_id == block_id and
+            header.prev_block_id == prev and
+            header.sequence == sequence and
+            header.payload_len == self.chunkLen(index) and
+            (header.flags & FLAG_CHAINED != 0) == chained;
     }
-    break :blk table;
 };
 
+// ============================================================
+// Compressed Documents
+// ============================================================
+//
+// With StorageOptions.compression set, a document head carries the
+// COMPRESSED flag when LZ4 shrinks the document by at least one block.
+// The stored bytes (the head payload, or the whole chain when they still
+// span several blocks) are then a u32 little-endian uncompressed length
+// followed by an LZ4 block; payload_len and checksums cover the stored
+// bytes, so blocks validate without decompressing.
+
+pub const Compression = enum { none, lz4 };
+
+const COMPRESSED_HEADER_SIZE: usize = 4;
+
+/// Compressed form of `data` in `out` when it occupies fewer blocks than
+/// `data` itself; null when compression does not pay for itself
+fn compressDocument(allocator: std.mem.Allocator, data: []const u8, out: *std.ArrayList(u8)) !?[]const u8 {
+    if (data.len <= PAYLOAD_SIZE) return null;
+
+    try out.resize(allocator, COMPRESSED_HEADER_SIZE + lz4.compressBound(data.len));
+    std.mem.writeInt(u32, out.items[0..COMPRESSED_HEADER_SIZE], @intCast(data.len), .little);
+    const len = COMPRESSED_HEADER_SIZE + lz4.compress(data, out.items[COMPRESSED_HEADER_SIZE..]);
+
+    if (OverflowHeader.blocksFor(len) >= OverflowHeader.blocksFor(data.len)) return null;
+    return out.items[0..len];
+}
+
+fn decompressDocument(allocator: std.mem.Allocator, stored: []const u8, out: *std.ArrayList(u8)) !void {
+    if (stored.len < COMPRESSED_HEADER_SIZE) return error.InvalidCompression;
+    const raw_len = std.mem.readInt(u32, stored[0..COMPRESSED_HEADER_SIZE], .little);
+    if (raw_len > MAX_DOCUMENT_SIZE) return error.InvalidCompression;
+
+    try out.resize(allocator, raw_len);
+    const len = lz4.decompress(stored[COMPRESSED_HEADER_SIZE..], out.items) catch return error.InvalidCompression;
+    if (len != raw_len) return error.InvalidCompression;
+}
+
+// ============================================================
+// CRC32C (Castagnoli polynomial: 0x1EDC6F41), see crc32c.zig
+// ============================================================
+// Hardware or slicing-by-8, bit-exact with the Forth implementation
+
 /// Calculate CRC32C checksum (Castagnoli)
 pub fn crc32c(data: []const u8, len: u32) u32 {
-    var crc: u32 = 0xFFFFFFFF;
-
-    var i: usize = 0;
-    while (i < len) : (i += 1) {
-        const index = @as(u8, @truncate((crc ^ data[i]) & 0xFF));
-        crc = (crc >> 8) ^ CRC32C_TABLE[index];
-    }
+    return crc32c_impl.update(0xFFFFFFFF, data[0..len]) ^ 0xFFFFFFFF;
+}
 
-    return crc ^ 0xFFFFFFFF;
+/// Fold more bytes into a running CRC32C (no initial/final inversion).
+/// Lets callers checksum discontiguous regions without copying them together.
+pub fn crc32cUpdate(crc_in: u32, data: []const u8) u32 {
+    return crc32c_impl.update(crc_in, data);
 }
 
 // ============================================================
 // Superblock (Block ID 0)
 // ============================================================
 
+// Superblock flags
+pub const SB_FLAG_FREE_MAP: u32 = 0x0001; // free_map_tail is valid
+pub const SB_FLAG_TYPE_INDEX: u32 = 0x0002; // type_index_tail is valid
+pub const SB_FLAG_CHECKPOINT: u32 = 0x0004; // checkpoint fields are valid
+pub const SB_FLAG_SCRUB: u32 = 0x0008; // scrub fields are valid
+pub const SB_FLAG_SCRUB_ACTIVE: u32 = 0x0010; // a scrub pass is in progress at scrub_next
+
+// Superblock format version. Version 1 files kept one free-form journal
+// entry per journal_segment block; version 2 packs entries into segments
+// (see below). Version 1 journals are converted on open.
+pub const SUPERBLOCK_VERSION: u32 = 2;
+
 pub const Superblock = extern struct {
     version: u32 align(1),
     block_count: u64 align(1),
@@ -283,21 +460,39 @@ pub const Superblock = extern struct {
     flags: u32 align(1),
     created_at: u64 align(1),
     last_checkpoint: u64 align(1),
-    reserved: [3968]u8 align(1), // Pad to payload size
+    // Extension fields carved from the reserved area; only meaningful when
+    // the matching SB_FLAG_* bit is set (older files left this area unset)
+    free_map_tail: u64 align(1), // newest free-space map page
+    type_index_tail: u64 align(1), // newest type index page
+    checkpoint_sequence: u64 align(1), // sequence of the last CHECKPOINT entry
+    journal_base: u64 align(1), // oldest live segment (0: the chain ends at 0)
+    archive_tail: u64 align(1), // newest journal_archive block
+    scrub_next: u64 align(1), // next block of the scrub pass in progress
+    scrub_pass_started: u64 align(1), // ms timestamp the latest pass began
+    scrub_pass_completed: u64 align(1), // ms timestamp the last full pass ended
+    reserved: [3904]u8 align(1), // Pad to payload size
 
     pub fn init() Superblock {
         const now = @as(u64, @intCast(std.time.milliTimestamp()));
         return .{
-            .version = 1,
+            .version = SUPERBLOCK_VERSION,
             .block_count = 1, // Just the superblock
             .free_list_head = 0,
             .journal_head = 0,
             .journal_tail = 0,
             .root_collection_id = 0,
-            .flags = 0,
+            .flags = SB_FLAG_FREE_MAP | SB_FLAG_TYPE_INDEX | SB_FLAG_CHECKPOINT | SB_FLAG_SCRUB,
             .created_at = now,
             .last_checkpoint = now,
-            .reserved = undefined,
+            .free_map_tail = 0,
+            .type_index_tail = 0,
+            .checkpoint_sequence = 0,
+            .journal_base = 0,
+            .archive_tail = 0,
+            .scrub_next = 0,
+            .scrub_pass_started = 0,
+            .scrub_pass_completed = 0,
+            .reserved = @splat(0),
         };
     }
 
@@ -318,12 +513,346 @@ pub const Superblock = extern struct {
         }
         return @bitCast(bytes[0..@sizeOf(Superblock)].*);
     }
+
+    comptime {
+        std.debug.assert(@sizeOf(Superblock) == PAYLOAD_SIZE);
+    }
+};
+
+// ============================================================
+// Journal Segments (packed entries, see spec/journal.adoc)
+// ============================================================
+//
+// A journal_segment block holds as many entries as fit in its payload,
+// back to back. Each entry uses the 48-byte header from
+// core-forth/src/lithoglyph-journal.fs followed by its forward payload.
+// The block header's `sequence` is the sequence of the first entry and
+// `prev_block_id` links to the previous segment.
+//
+// Segments from the superblock's journal_tail back to journal_base are
+// live; a checkpoint compacts everything older into journal_archive
+// blocks (journal_archive.zig), so the base segment's prev_block_id is
+// stale once SB_FLAG_CHECKPOINT is set and journal_base is non-zero.
+
+pub const JOURNAL_ENTRY_HEADER_SIZE: usize = 48;
+
+// Operation types (must match Forth OP-* constants)
+pub const JournalOp = enum(u16) {
+    unspecified = 0x0000,
+    doc_insert = 0x0001,
+    doc_update = 0x0002,
+    doc_delete = 0x0003,
+    bulk_insert = 0x0005,
+    index_create = 0x0050,
+    checkpoint = 0x0070,
+    replica_mark = 0x0072,
+    _,
+};
+
+// ============================================================
+// Journal Entry Header (48 bytes, matching Forth layout)
+// ============================================================
+//
+// Offset  Size  Field
+// 0       8     sequence
+// 8       8     timestamp
+// 16      2     op_type
+// 18      2     flags
+// 20      4     forward_len
+// 24      4     inverse_len
+// 28      4     provenance_len
+// 32      8     affected_block
+// 40      4     checksum (CRC32C of entry with this field zeroed)
+// 44      4     entry_len
+
+pub const JournalEntryHeader = extern struct {
+    sequence: u64 align(1),
+    timestamp: u64 align(1),
+    op_type: u16 align(1),
+    flags: u16 align(1),
+    forward_len: u32 align(1),
+    inverse_len: u32 align(1),
+    provenance_len: u32 align(1),
+    affected_block: u64 align(1),
+    checksum: u32 align(1),
+    entry_len: u32 align(1),
+
+    comptime {
+        if (@sizeOf(JournalEntryHeader) != JOURNAL_ENTRY_HEADER_SIZE) {
+            @compileError("JournalEntryHeader must be exactly 48 bytes");
+        }
+    }
+};
+
+const JOURNAL_CHECKSUM_OFFSET = @offsetOf(JournalEntryHeader, "checksum");
+
+/// Largest forward payload a single entry can carry
+pub const JOURNAL_MAX_FORWARD: usize = PAYLOAD_SIZE - JOURNAL_ENTRY_HEADER_SIZE;
+
+/// A journal record queued for commit (sequence assigned by the writer)
+pub const JournalRecord = struct {
+    op: JournalOp,
+    affected_block: u64,
+    forward: []const u8,
+};
+
+/// A decoded journal entry (forward slice borrows from the segment block)
+pub const JournalEntry = struct {
+    header: JournalEntryHeader,
+    forward: []const u8,
+    /// The entry as stored: header, forward text and checksum
+    raw: []const u8,
+};
+
+/// Packs journal entries into a single segment payload
+pub const JournalSegmentWriter = struct {
+    buf: [PAYLOAD_SIZE]u8 = undefined,
+    len: usize = 0,
+    count: u32 = 0,
+
+    pub fn fits(self: *const JournalSegmentWriter, forward_len: usize) bool {
+        return self.len + JOURNAL_ENTRY_HEADER_SIZE + forward_len <= PAYLOAD_SIZE;
+    }
+
+    pub fn append(self: *JournalSegmentWriter, sequence: u64, record: JournalRecord) !void {
+        if (record.forward.len > JOURNAL_MAX_FORWARD) return error.JournalEntryTooLarge;
+        if (!self.fits(record.forward.len)) return error.SegmentFull;
+
+        const entry_len = JOURNAL_ENTRY_HEADER_SIZE + record.forward.len;
+        var header = JournalEntryHeader{
+            .sequence = sequence,
+            .timestamp = @intCast(std.time.milliTimestamp()),
+            .op_type = @intFromEnum(record.op),
+            .flags = 0,
+            .forward_len = @intCast(record.forward.len),
+            .inverse_len = 0,
+            .provenance_len = 0,
+            .affected_block = record.affected_block,
+            .checksum = 0,
+            .entry_len = @intCast(entry_len),
+        };
+        if (builtin.cpu.arch.endian() != .little) {
+            std.mem.byteSwapAllFields(JournalEntryHeader, &header);
+        }
+
+        const dst = self.buf[self.len..][0..entry_len];
+        @memcpy(dst[0..JOURNAL_ENTRY_HEADER_SIZE], std.mem.asBytes(&header));
+        @memcpy(dst[JOURNAL_ENTRY_HEADER_SIZE..], record.forward);
+
+        const crc = crc32c(dst, @intCast(entry_len));
+        std.mem.writeInt(u32, dst[JOURNAL_CHECKSUM_OFFSET..][0..4], crc, .little);
+
+        self.len += entry_len;
+        self.count += 1;
+    }
+
+    pub fn payload(self: *const JournalSegmentWriter) []const u8 {
+        return self.buf[0..self.len];
+    }
+
+    pub fn reset(self: *JournalSegmentWriter) void {
+        self.len = 0;
+        self.count = 0;
+    }
+};
+
+/// A version 1 journal entry as a record. The op and block are recovered
+/// from the text the bridge wrote then ("INSERT block_id=N size=M", ...).
+fn legacyRecord(text: []const u8) JournalRecord {
+    const op: JournalOp = if (std.mem.startsWith(u8, text, "INSERT "))
+        .doc_insert
+    else if (std.mem.startsWith(u8, text, "UPDATE "))
+        .doc_update
+    else if (std.mem.startsWith(u8, text, "DELETE "))
+        .doc_delete
+    else
+        .unspecified;
+
+    var affected_block: u64 = 0;
+    if (std.mem.indexOf(u8, text, "block_id=")) |at| {
+        const digits = text[at + "block_id=".len ..];
+        const end = std.mem.indexOfNone(u8, digits, "0123456789") orelse digits.len;
+        affected_block = std.fmt.parseInt(u64, digits[0..end], 10) catch 0;
+    }
+    return .{ .op = op, .affected_block = affected_block, .forward = text };
+}
+
+/// Whether a version 1 journal block was already rewritten as a segment
+/// holding just entry `sequence`
+fn isConvertedSegment(block: *const Block, sequence: u64) bool {
+    if (block.header.sequence != sequence) return false;
+    var iter = JournalSegmentIterator.init(block) catch return false;
+    const entry = (iter.next() catch return false) orelse return false;
+    if (entry.header.sequence != sequence) return false;
+    return (iter.next() catch return false) == null;
+}
+
+/// Walks the entries packed into a journal segment, verifying each checksum
+pub const JournalSegmentIterator = struct {
+    payload: []const u8,
+    pos: usize = 0,
+
+    pub fn init(block: *const Block) !JournalSegmentIterator {
+        if (block.header.block_type != @intFromEnum(BlockType.journal_segment)) {
+            return error.NotJournalSegment;
+        }
+        return .{ .payload = block.getPayload() };
+    }
+
+    /// Walk entries already extracted from a block, such as an unpacked
+    /// journal_archive payload
+    pub fn fromPayload(payload: []const u8) JournalSegmentIterator {
+        return .{ .payload = payload };
+    }
+
+    pub fn next(self: *JournalSegmentIterator) !?JournalEntry {
+        if (self.pos >= self.payload.len) return null;
+
+        const rest = self.payload[self.pos..];
+        if (rest.len < JOURNAL_ENTRY_HEADER_SIZE) return error.TruncatedJournalEntry;
+
+        var header = std.mem.bytesToValue(JournalEntryHeader, rest[0..JOURNAL_ENTRY_HEADER_SIZE]);
+        if (builtin.cpu.arch.endian() != .little) {
+            std.mem.byteSwapAllFields(JournalEntryHeader, &header);
+        }
+
+        if (header.entry_len < JOURNAL_ENTRY_HEADER_SIZE or header.entry_len > rest.len) {
+            return error.TruncatedJournalEntry;
+        }
+        if (header.forward_len > header.entry_len - JOURNAL_ENTRY_HEADER_SIZE) {
+            return error.TruncatedJournalEntry;
+        }
+
+        const entry = rest[0..header.entry_len];
+        const zero = [_]u8{0} ** 4;
+        var crc = crc32cUpdate(0xFFFFFFFF, entry[0..JOURNAL_CHECKSUM_OFFSET]);
+        crc = crc32cUpdate(crc, &zero);
+        crc = crc32cUpdate(crc, entry[JOURNAL_CHECKSUM_OFFSET + 4 ..]);
+        if ((crc ^ 0xFFFFFFFF) != header.checksum) {
+            return error.JournalChecksumMismatch;
+        }
+
+        self.pos += header.entry_len;
+        return .{
+            .header = header,
+            .forward = entry[JOURNAL_ENTRY_HEADER_SIZE..][0..header.forward_len],
+            .raw = entry,
+        };
+    }
+};
+
+// ============================================================
+// Commit Batches (group commit)
+// ============================================================
+
+/// A block image written as part of a commit
+pub const BlockWrite = struct {
+    block_id: u64,
+    block_type: BlockType,
+    payload: []const u8,
+    /// Block already holds a committed version (update rather than insert)
+    replaces: bool = false,
+};
+
+/// Journal position a commit group writes into the superblock
+const JournalPointers = struct {
+    head: u64,
+    tail: u64,
+};
+
+/// What a commit group changed in memory before its superblock was durable,
+/// so a failed group can be put back (see `BlockStorage.rollBackGroup`).
+/// Blocks the group frees are only held (FreeSpaceMap.hold) meanwhile.
+const GroupUndo = struct {
+    /// Blocks staged or written, oldest first
+    frames: std.ArrayList(StagedFrame) = .{},
+    /// Type index entries as they were before the group changed them
+    types: std.ArrayList(IndexedType) = .{},
+    /// Extents reserved for journal segments and overflow chains
+    extents: std.ArrayList(Extent) = .{},
+    /// Blocks may be in the file: phase 5 began, or a block was written
+    /// through because the pool had no frame for it
+    written: bool = false,
+
+    const StagedFrame = struct {
+        block_id: u64,
+        /// Held a committed version, which the group preserved in the
+        /// VersionStore before staging over it
+        replaced: bool,
+    };
+
+    const IndexedType = struct {
+        block_id: u64,
+        block_type: ?u16,
+    };
+
+    const Extent = struct {
+        first_block: u64,
+        count: u64,
+    };
+
+    fn deinit(self: *GroupUndo, allocator: std.mem.Allocator) void {
+        self.frames.deinit(allocator);
+        self.types.deinit(allocator);
+        self.extents.deinit(allocator);
+    }
+};
+
+/// Everything one transaction needs made durable. Batches submitted while
+/// another commit is flushing are coalesced into the next group and share
+/// its syncs.
+pub const CommitBatch = struct {
+    journal: []const JournalRecord = &.{},
+    writes: []const BlockWrite = &.{},
+    frees: []const u64 = &.{},
+    /// What every block in `frees` must be: a live block of this type.
+    /// Anything else fails the batch with WrongBlockType.
+    free_type: BlockType = .document,
+    /// Checkpoint the journal once this batch's group is durable
+    checkpoint: bool = false,
+
+    // Filled in by the group leader
+    first_sequence: u64 = 0,
+    last_sequence: u64 = 0,
+    last_segment: u64 = 0,
+    err: ?anyerror = null,
+    done: bool = false,
+    next: ?*CommitBatch = null,
+};
+
+/// Where background scrubbing stands, kept in the superblock so a
+/// restart resumes the pass instead of starting over
+pub const ScrubCheckpoint = struct {
+    /// A pass is in progress and `next` is its next block
+    active: bool = false,
+    next: u64 = 0,
+    /// Millisecond timestamps; 0 when no pass has begun or ended
+    pass_started: u64 = 0,
+    pass_completed: u64 = 0,
 };
 
 // ============================================================
 // Block Storage Manager
 // ============================================================
 
+/// Tunables for an opened storage (decoded from fdb_db_open CBOR opts)
+pub const StorageOptions = struct {
+    /// Buffer pool size in 4 KiB frames (0 disables caching)
+    buffer_pool_frames: u32 = buffer_pool.DEFAULT_FRAME_COUNT,
+    /// Serve reads from a read-only mapping of the file. Ignored on
+    /// targets where mapped_file.supported is false.
+    mmap: bool = false,
+    /// Submit commit write-back through io_uring on Linux; otherwise (or
+    /// when the kernel refuses it) a small thread pool issues the writes
+    io_uring: bool = true,
+    /// Compress documents larger than one block on commit. Reads handle
+    /// compressed documents whatever this is set to.
+    compression: Compression = .none,
+    /// Checkpoint automatically once this many live journal segments
+    /// accumulate (0 leaves checkpoints to explicit `checkpoint` calls)
+    checkpoint_segments: u32 = 4096,
+};
+
 pub const BlockStorage = struct {
     allocator: std.mem.Allocator,
     file: std.fs.File,
@@ -331,43 +860,125 @@ pub const BlockStorage = struct {
     path: []const u8,
     is_open: bool,
 
-    /// Open or create block storage
+    // Shared frame cache for every transaction on this storage
+    pool: ?BufferPool = null,
+
+    // Encoding for newly written documents (StorageOptions.compression)
+    compression: Compression = .none,
+
+    // Batched write-back for commit phases (io_uring or thread pool)
+    writer: BlockWriter,
+
+    // Read-only mapping used instead of pread when StorageOptions.mmap is set
+    mapped: ?MappedFile = null,
+
+    // Pre-images kept for read-only snapshots while blocks are rewritten
+    versions: VersionStore,
+
+    // Free blocks available for reuse (guarded by alloc_mutex)
+    free_map: FreeSpaceMap,
+
+    // Live block IDs per block type (guarded by alloc_mutex)
+    type_index: TypeIndex,
+
+    // Segments from journal_tail back to journal_base, and the count that
+    // triggers an automatic checkpoint (both used by the commit leader only)
+    live_segments: u64 = 0,
+    checkpoint_segments: u32 = 0,
+
+    // Sequence -> block lookup for journal readers
+    journal_index: JournalIndex,
+
+    // I/O counters and commit phase timings (fdb_stats)
+    stats: EngineStats = .{},
+
+    // Guards superblock fields shared between block-ID reservation and the
+    // commit leader (block_count, journal pointers, free list head).
+    alloc_mutex: std.Thread.Mutex = .{},
+
+    // Group commit state: batches queue here; whoever finds no leader active
+    // flushes the whole queue with one journal batch and one data +
+    // superblock batch.
+    commit_mutex: std.Thread.Mutex = .{},
+    commit_cond: std.Thread.Condition = .{},
+    commit_head: ?*CommitBatch = null,
+    commit_tail: ?*CommitBatch = null,
+    commit_leader_active: bool = false,
+
+    /// Open or create block storage with default options
     pub fn open(allocator: std.mem.Allocator, path: []const u8) !*BlockStorage {
+        return openWithOptions(allocator, path, .{});
+    }
+
+    /// Open or create block storage
+    pub fn openWithOptions(allocator: std.mem.Allocator, path: []const u8, options: StorageOptions) !*BlockStorage {
         const storage = try allocator.create(BlockStorage);
         errdefer allocator.destroy(storage);
 
+        var sb: Superblock = undefined;
+        var created = false;
+
         // Try to open existing file
-        const file = std.fs.cwd().openFile(path, .{ .mode = .read_write }) catch |err| {
+        const file = std.fs.cwd().openFile(path, .{ .mode = .read_write }) catch |err| blk: {
             if (err == error.FileNotFound) {
                 // Create new database
                 const new_file = try std.fs.cwd().createFile(path, .{ .read = true });
-                const sb = Superblock.init();
+                errdefer new_file.close();
+                sb = Superblock.init();
                 const sb_block = try sb.toBlock();
                 const sb_bytes = sb_block.toBytes();
-                try new_file.writeAll(&sb_bytes);
+                try new_file.pwriteAll(&sb_bytes, 0);
                 try new_file.sync();
-
-                storage.* = .{
-                    .allocator = allocator,
-                    .file = new_file,
-                    .superblock = sb,
-                    .path = try allocator.dupe(u8, path),
-                    .is_open = true,
-                };
-                return storage;
+                created = true;
+                break :blk new_file;
             }
             return err;
         };
+        errdefer file.close();
+
+        if (!created) {
+            // Read existing superblock
+            var sb_bytes: [BLOCK_SIZE]u8 = undefined;
+            const n = try file.preadAll(&sb_bytes, 0);
+            if (n < BLOCK_SIZE) {
+                return error.InvalidDatabase;
+            }
 
-        // Read existing superblock
-        var sb_bytes: [BLOCK_SIZE]u8 = undefined;
-        const n = try file.read(&sb_bytes);
-        if (n < BLOCK_SIZE) {
-            return error.InvalidDatabase;
+            const sb_block = try Block.fromBytes(&sb_bytes);
+            sb = try Superblock.fromBlock(&sb_block);
+            if (sb.version > SUPERBLOCK_VERSION) {
+                return error.UnsupportedVersion;
+            }
+        }
+
+        var free_map = try loadFreeMap(allocator, file, &sb);
+        errdefer free_map.deinit();
+
+        var type_index = try loadTypeIndex(allocator, file, &sb);
+        errdefer type_index.deinit();
+
+        if (sb.version < SUPERBLOCK_VERSION) {
+            try convertLegacyJournal(allocator, file, &sb);
+        }
+
+        var journal_index = JournalIndex.init(allocator);
+        errdefer journal_index.deinit();
+        const live_segments = try recoverJournal(file, &sb, &journal_index);
+
+        var pool: ?BufferPool = null;
+        if (options.buffer_pool_frames > 0) {
+            pool = try BufferPool.init(allocator, options.buffer_pool_frames);
+        }
+        errdefer if (pool) |*p| p.deinit();
+
+        var mapped: ?MappedFile = null;
+        if (options.mmap and mapped_file.supported) {
+            mapped = try MappedFile.init(allocator, file);
         }
+        errdefer if (mapped) |*m| m.deinit();
 
-        const sb_block = try Block.fromBytes(&sb_bytes);
-        const sb = try Superblock.fromBlock(&sb_block);
+        var writer = BlockWriter.init(allocator, options.io_uring);
+        errdefer writer.deinit();
 
         storage.* = .{
             .allocator = allocator,
@@ -375,14 +986,192 @@ pub const BlockStorage = struct {
             .superblock = sb,
             .path = try allocator.dupe(u8, path),
             .is_open = true,
+            .pool = pool,
+            .compression = options.compression,
+            .mapped = mapped,
+            .writer = writer,
+            .versions = VersionStore.init(allocator),
+            .free_map = free_map,
+            .type_index = type_index,
+            .live_segments = live_segments,
+            .checkpoint_segments = options.checkpoint_segments,
+            .journal_index = journal_index,
         };
 
         return storage;
     }
 
+    /// Verify the live journal from journal_tail back to the last
+    /// checkpoint and count its segments. Blocks are durable before the
+    /// superblock publishes a commit, so nothing needs replaying; this only
+    /// proves the entries since the checkpoint are intact and contiguous,
+    /// and indexes the segments for journal readers. Files written before
+    /// checkpoints existed are walked in full once.
+    fn recoverJournal(file: std.fs.File, sb: *Superblock, index: *JournalIndex) !u64 {
+        if (sb.flags & SB_FLAG_CHECKPOINT == 0) {
+            sb.flags |= SB_FLAG_CHECKPOINT;
+            sb.checkpoint_sequence = 0;
+            sb.journal_base = 0;
+            sb.archive_tail = 0;
+        }
+
+        var segments: u64 = 0;
+        var expected = sb.journal_head;
+        var segment_id = sb.journal_tail;
+        while (segment_id != 0) {
+            if (segments >= sb.block_count) return error.InvalidJournal;
+            const segment = try readBlockFile(file, segment_id);
+            var iter = try JournalSegmentIterator.init(&segment);
+
+            // Entries run from the block's sequence up to the one the newer
+            // segment (or the superblock) expects next
+            var seq = segment.header.sequence;
+            while (try iter.next()) |entry| : (seq += 1) {
+                if (entry.header.sequence != seq) return error.InvalidJournal;
+            }
+            if (seq == segment.header.sequence or seq - 1 != expected) return error.InvalidJournal;
+
+            try index.live.append(index.allocator, .{ .first_sequence = segment.header.sequence, .block_id = segment_id });
+            segments += 1;
+            if (segment_id == sb.journal_base) break;
+            expected = segment.header.sequence - 1;
+            segment_id = segment.header.prev_block_id;
+        }
+        std.mem.reverse(JournalLocation, index.live.items);
+        return segments;
+    }
+
+    /// Rewrite a version 1 journal in place: each of its blocks holds one
+    /// free-form entry and becomes a segment packing just that entry, the
+    /// oldest numbered 1. Version 1 stamped blocks with sequences beyond
+    /// that numbering, so every block is clamped to the new head to stay
+    /// visible. The rewrite is deterministic and skips converted blocks,
+    /// so a crash before the version reaches disk redoes it on the next
+    /// open; the version is recorded on the next superblock write.
+    fn convertLegacyJournal(allocator: std.mem.Allocator, file: std.fs.File, sb: *Superblock) !void {
+        var chain: std.ArrayList(u64) = .{};
+        defer chain.deinit(allocator);
+
+        var segment_id = sb.journal_tail;
+        while (segment_id != 0) {
+            if (chain.items.len >= sb.block_count) return error.InvalidJournal;
+            const segment = try readBlockFile(file, segment_id);
+            if (segment.header.block_type != @intFromEnum(BlockType.journal_segment)) {
+                return error.InvalidJournal;
+            }
+            try chain.append(allocator, segment_id);
+            segment_id = segment.header.prev_block_id;
+        }
+        std.mem.reverse(u64, chain.items);
+
+        for (chain.items, 0..) |id, i| {
+            const sequence: u64 = @intCast(i + 1);
+            var block = try readBlockFile(file, id);
+            if (isConvertedSegment(&block, sequence)) continue;
+
+            var writer = JournalSegmentWriter{};
+            try writer.append(sequence, legacyRecord(block.getPayload()));
+            block.header.sequence = sequence;
+            try block.setPayload(writer.payload());
+            try file.pwriteAll(&block.toBytes(), id * BLOCK_SIZE);
+        }
+
+        const head: u64 = chain.items.len;
+        var block_id: u64 = 1;
+        while (block_id < sb.block_count) : (block_id += 1) {
+            var block = readBlockFile(file, block_id) catch continue;
+            if (block.header.sequence <= head) continue;
+            block.header.sequence = head;
+            try file.pwriteAll(&block.toBytes(), block_id * BLOCK_SIZE);
+        }
+        try file.sync();
+
+        sb.version = SUPERBLOCK_VERSION;
+        sb.journal_head = head;
+    }
+
+    /// Load the free-space map, or build it once from the legacy free
+    /// chain for files written before the map existed
+    fn loadFreeMap(allocator: std.mem.Allocator, file: std.fs.File, sb: *Superblock) !FreeSpaceMap {
+        var map = FreeSpaceMap.init(allocator);
+        errdefer map.deinit();
+
+        if (sb.flags & SB_FLAG_FREE_MAP != 0) {
+            var page_id = sb.free_map_tail;
+            var page_steps: u64 = 0;
+            while (page_id != 0 and page_steps < sb.block_count) : (page_steps += 1) {
+                const page = try readBlockFile(file, page_id);
+                if (page.header.block_type != @intFromEnum(BlockType.free_space_map)) {
+                    return error.InvalidFreeSpaceMap;
+                }
+                try map.loadPage(page_id, &page.payload);
+                page_id = page.header.prev_block_id;
+            }
+            return map;
+        }
+
+        var block_id = sb.free_list_head;
+        var steps: u64 = 0;
+        while (block_id != 0 and block_id < sb.block_count and steps < sb.block_count) : (steps += 1) {
+            const block = readBlockFile(file, block_id) catch break;
+            if (block.header.block_type != @intFromEnum(BlockType.free)) break;
+            try map.markFree(block_id);
+            block_id = block.header.prev_block_id;
+        }
+
+        // Map pages are placed on the next superblock write
+        sb.flags |= SB_FLAG_FREE_MAP;
+        sb.free_list_head = 0;
+        sb.free_map_tail = 0;
+        sb.reserved = @splat(0);
+        return map;
+    }
+
+    /// Load the type index, or build it with one full scan for files
+    /// written before the index existed
+    fn loadTypeIndex(allocator: std.mem.Allocator, file: std.fs.File, sb: *Superblock) !TypeIndex {
+        var index = TypeIndex.init(allocator);
+        errdefer index.deinit();
+
+        if (sb.flags & SB_FLAG_TYPE_INDEX != 0) {
+            var page_id = sb.type_index_tail;
+            var page_steps: u64 = 0;
+            while (page_id != 0 and page_steps < sb.block_count) : (page_steps += 1) {
+                const page = try readBlockFile(file, page_id);
+                if (page.header.block_type != @intFromEnum(BlockType.type_index)) {
+                    return error.InvalidTypeIndex;
+                }
+                try index.loadPage(page_id, &page.payload);
+                page_id = page.header.prev_block_id;
+            }
+            index.finishLoad();
+            return index;
+        }
+
+        var block_id: u64 = 1;
+        while (block_id < sb.block_count) : (block_id += 1) {
+            const block = readBlockFile(file, block_id) catch continue;
+            try index.set(block_id, block.header.block_type, block.header.flags & FLAG_DELETED != 0);
+        }
+
+        // Index pages are placed on the next superblock write
+        sb.flags |= SB_FLAG_TYPE_INDEX;
+        sb.type_index_tail = 0;
+        return index;
+    }
+
     /// Close block storage
     pub fn close(self: *BlockStorage) void {
         if (self.is_open) {
+            if (self.pool) |*pool| pool.deinit();
+            self.pool = null;
+            if (self.mapped) |*m| m.deinit();
+            self.mapped = null;
+            self.writer.deinit();
+            self.versions.deinit();
+            self.free_map.deinit();
+            self.type_index.deinit();
+            self.journal_index.deinit();
             self.file.close();
             self.allocator.free(self.path);
             self.is_open = false;
@@ -394,113 +1183,1333 @@ pub const BlockStorage = struct {
         self.allocator.destroy(self);
     }
 
-    /// Read a block by ID
+    /// Read a block by ID as of the published journal head (served from
+    /// the buffer pool when cached); see `pinBlock`
     pub fn readBlock(self: *BlockStorage, block_id: u64) !Block {
-        const offset = block_id * BLOCK_SIZE;
-        try self.file.seekTo(offset);
+        var head = self.journalHead();
+        while (true) {
+            var block = try self.readLatest(block_id);
+            if (block.header.sequence <= head) return block;
+            if (self.versions.find(block_id, head, &block)) return block;
+            head = try self.republishedHead(head);
+        }
+    }
 
-        var bytes: [BLOCK_SIZE]u8 = undefined;
-        const n = try self.file.read(&bytes);
-        if (n < BLOCK_SIZE) {
-            return error.InvalidBlock;
+    /// Read a block including whatever the commit group in flight staged
+    /// over it (leader only: nobody else may see unpublished blocks)
+    fn readLatest(self: *BlockStorage, block_id: u64) !Block {
+        if (self.mapped != null) {
+            var scratch: Block = undefined;
+            const view = try self.pinLatest(block_id, &scratch);
+            defer self.unpinBlock(view);
+            return view.*;
         }
 
-        return try Block.fromBytes(&bytes);
+        const pool = if (self.pool) |*p| p else return self.readBlockFromDisk(block_id);
+
+        var block: Block = undefined;
+        if (pool.lookup(block_id, &block)) return block;
+
+        const generation = pool.currentGeneration();
+        block = try self.readBlockFromDisk(block_id);
+        _ = pool.fill(block_id, &block, generation, false);
+        return block;
     }
 
-    /// Write a block by ID
-    pub fn writeBlock(self: *BlockStorage, block_id: u64, block: *const Block) !void {
-        const offset = block_id * BLOCK_SIZE;
-        try self.file.seekTo(offset);
+    /// Borrow a block without copying it. On a cache hit the returned
+    /// pointer is a pinned pool frame; with mmap reads it points into the
+    /// mapping; otherwise the block is read into `scratch`. Either way,
+    /// release it with `unpinBlock`.
+    ///
+    /// Reads see the published journal head. A commit group stages its
+    /// blocks (tagged with its own sequences) before its syncs, so until it
+    /// publishes, a block it rewrote reads as the pre-image it preserved,
+    /// and one it creates fails with BlockNotVisible.
+    pub fn pinBlock(self: *BlockStorage, block_id: u64, scratch: *Block) !*const Block {
+        var head = self.journalHead();
+        while (true) {
+            const current = try self.pinLatest(block_id, scratch);
+            if (current.header.sequence <= head) return current;
+            self.unpinBlock(current);
+            if (self.versions.find(block_id, head, scratch)) return scratch;
+            head = try self.republishedHead(head);
+        }
+    }
 
-        var bytes = block.toBytes();
-        try self.file.writeAll(&bytes);
-        try self.file.sync();
+    /// The head to retry at when a block is newer than `head` and has no
+    /// pre-image for it: either its group published meanwhile (and pruned
+    /// the pre-image), or it is still in flight and created the block
+    fn republishedHead(self: *BlockStorage, head: u64) !u64 {
+        const now = self.journalHead();
+        if (now == head) return error.BlockNotVisible;
+        return now;
     }
 
-    /// Allocate a new block (writes to disk immediately)
-    pub fn allocateBlock(self: *BlockStorage, block_type: BlockType) !u64 {
-        // TODO: Use free list for production
-        // For now, just append to end
-        const new_id = self.superblock.block_count;
-        self.superblock.block_count += 1;
+    /// `pinBlock` without the head check (see `readLatest`)
+    fn pinLatest(self: *BlockStorage, block_id: u64, scratch: *Block) !*const Block {
+        if (self.mapped) |*m| {
+            // The pool only holds blocks written through it here, which
+            // may be staged and not yet on disk, so it still wins
+            if (self.pool) |*pool| {
+                if (pool.pin(block_id)) |frame| return frame;
+            }
+            if (try self.mappedBlock(m, block_id)) |view| return view;
+            scratch.* = try self.readBlockFromDisk(block_id);
+            return scratch;
+        }
 
-        // Update superblock on disk
-        const sb_block = try self.superblock.toBlock();
-        try self.writeBlock(0, &sb_block);
+        const pool = if (self.pool) |*p| p else {
+            scratch.* = try self.readBlockFromDisk(block_id);
+            return scratch;
+        };
 
-        // Initialize new block
-        var block = Block.init(block_type, new_id, self.superblock.journal_head + 1);
-        try self.writeBlock(new_id, &block);
+        if (pool.pin(block_id)) |frame| return frame;
 
-        return new_id;
+        const generation = pool.currentGeneration();
+        scratch.* = try self.readBlockFromDisk(block_id);
+        return pool.fill(block_id, scratch, generation, true) orelse scratch;
     }
 
-    /// Reserve a block ID without writing to disk (for transaction buffering)
-    pub fn reserveBlockId(self: *BlockStorage) u64 {
-        const new_id = self.superblock.block_count;
-        self.superblock.block_count += 1;
-        return new_id;
+    /// Pin a block for as long as the caller likes: the result is always
+    /// a pool frame, which a later rewrite detaches instead of overwriting
+    /// (unlike a mapped view). Null when there is no pool or no frame can
+    /// be claimed, or the frame is staged by a group that has not
+    /// published; `scratch` then holds a copy (as `readBlock` sees it).
+    /// Release with `unpinBlock`.
+    pub fn pinBlockStable(self: *BlockStorage, block_id: u64, scratch: *Block) !?*const Block {
+        const pool = if (self.pool) |*p| p else {
+            scratch.* = try self.readBlock(block_id);
+            return null;
+        };
+        const head = self.journalHead();
+
+        var frame = pool.pin(block_id);
+        if (frame == null) {
+            const generation = pool.currentGeneration();
+            scratch.* = blk: {
+                if (self.mapped) |*m| {
+                    if (try self.mappedBlock(m, block_id)) |view| break :blk view.*;
+                }
+                break :blk try self.readBlockFromDisk(block_id);
+            };
+            frame = pool.fill(block_id, scratch, generation, true);
+        }
+        if (frame) |pinned| {
+            if (pinned.header.sequence <= head) return pinned;
+            pool.unpin(pinned);
+        } else if (scratch.header.sequence <= head) return null;
+
+        scratch.* = try self.readBlock(block_id);
+        return null;
     }
 
-    /// Flush superblock to disk (after batch operations)
-    pub fn flushSuperblock(self: *BlockStorage) !void {
-        const sb_block = try self.superblock.toBlock();
-        try self.writeBlock(0, &sb_block);
+    pub fn unpinBlock(self: *BlockStorage, block: *const Block) void {
+        if (self.pool) |*pool| pool.unpin(block);
     }
 
-    /// Append to journal
-    pub fn appendJournal(self: *BlockStorage, entry_data: []const u8) !u64 {
-        const journal_id = try self.allocateBlock(.journal_segment);
-        var block = try self.readBlock(journal_id);
-        try block.setPayload(entry_data);
+    /// Take a read view at the last committed journal sequence. Readers
+    /// never block the writer; release with `endSnapshot`.
+    pub fn beginSnapshot(self: *BlockStorage) !Snapshot {
+        self.versions.mutex.lock();
+        defer self.versions.mutex.unlock();
 
-        // Link to previous journal entry
-        block.header.prev_block_id = self.superblock.journal_tail;
-        block.header.sequence = self.superblock.journal_head + 1;
+        self.alloc_mutex.lock();
+        const snap = Snapshot{
+            .sequence = self.superblock.journal_head,
+            .block_count = self.superblock.block_count,
+        };
+        self.alloc_mutex.unlock();
 
-        try self.writeBlock(journal_id, &block);
+        try self.versions.registerLocked(snap.sequence);
+        return snap;
+    }
 
-        // Update superblock journal pointers
-        if (self.superblock.journal_head == 0) {
-            self.superblock.journal_head = journal_id;
-        }
-        self.superblock.journal_tail = journal_id;
-        self.superblock.journal_head += 1;
+    pub fn endSnapshot(self: *BlockStorage, snap: Snapshot) void {
+        self.versions.release(snap.sequence);
+    }
 
-        const sb_block = try self.superblock.toBlock();
-        try self.writeBlock(0, &sb_block);
+    /// Like `pinBlock`, but returns the version visible to `snap`
+    /// (the published head when null). Fails with BlockNotVisible for
+    /// blocks created after the snapshot was taken.
+    pub fn pinBlockAt(self: *BlockStorage, block_id: u64, snap: ?Snapshot, scratch: *Block) !*const Block {
+        const view = snap orelse return self.pinBlock(block_id, scratch);
+        if (block_id >= view.block_count) return error.BlockNotVisible;
 
-        return journal_id;
-    }
+        const current = try self.pinLatest(block_id, scratch);
+        if (current.header.sequence <= view.sequence) return current;
+        self.unpinBlock(current);
 
-    /// Free a block (mark as free, add to free list)
-    pub fn freeBlock(self: *BlockStorage, block_id: u64) !void {
-        if (block_id == 0) {
-            return error.CannotFreeSuperblock;
-        }
+        if (self.versions.find(block_id, view.sequence, scratch)) return scratch;
+        return error.BlockNotVisible;
+    }
 
-        var block = try self.readBlock(block_id);
-        block.header.block_type = @intFromEnum(BlockType.free);
-        block.header.prev_block_id = self.superblock.free_list_head;
-        block.header.flags |= @as(u32, @as(u8, @bitCast(BlockFlags{ .deleted = true })));
+    /// Copying variant of `pinBlockAt`
+    pub fn readBlockAt(self: *BlockStorage, block_id: u64, snap: ?Snapshot) !Block {
+        var scratch: Block = undefined;
+        const block = try self.pinBlockAt(block_id, snap, &scratch);
+        defer self.unpinBlock(block);
+        return block.*;
+    }
 
-        try self.writeBlock(block_id, &block);
+    /// Whole document held by `head` as seen by `snap`: the block's own
+    /// payload, or the reassembled and/or decompressed bytes, read into
+    /// `out` (whose contents are replaced). The returned slice is valid
+    /// until `head` is unpinned or `out` changes.
+    pub fn readChain(
+        self: *BlockStorage,
+        allocator: std.mem.Allocator,
+        head: *const Block,
+        snap: ?Snapshot,
+        out: *std.ArrayList(u8),
+    ) ![]const u8 {
+        if (head.header.flags & FLAG_COMPRESSED == 0) return self.readStored(allocator, head, snap, out);
+
+        var stored_buf: std.ArrayList(u8) = .{};
+        defer stored_buf.deinit(allocator);
+        const stored = try self.readStored(allocator, head, snap, &stored_buf);
+        try decompressDocument(allocator, stored, out);
+        return out.items;
+    }
 
-        // Update free list
-        self.superblock.free_list_head = block_id;
-        const sb_block = try self.superblock.toBlock();
-        try self.writeBlock(0, &sb_block);
+    /// Bytes stored for `head`: its payload, or its overflow chain
+    fn readStored(
+        self: *BlockStorage,
+        allocator: std.mem.Allocator,
+        head: *const Block,
+        snap: ?Snapshot,
+        out: *std.ArrayList(u8),
+    ) ![]const u8 {
+        const chain = (try OverflowHeader.of(head)) orelse return head.getPayload();
+
+        try out.resize(allocator, @intCast(chain.total_len));
+        @memcpy(out.items[0..CHAIN_HEAD_CAPACITY], head.getPayload()[OVERFLOW_HEADER_SIZE..]);
+        const rest = out.items[CHAIN_HEAD_CAPACITY..];
+
+        // A chain older than the latest pool or disk copy (snapshot reads,
+        // or a commit racing the read) is assembled block by block instead
+        if (self.mapped == null and try self.readOverflowVectored(head, chain, rest)) return out.items;
+        try self.readOverflowBlocks(head, chain, snap, rest);
+        return out.items;
     }
-};
 
-// ============================================================
-// Tests
-// ============================================================
+    /// Copying variant of `readChain` for a document by ID (caller frees)
+    pub fn readDocument(self: *BlockStorage, allocator: std.mem.Allocator, block_id: u64, snap: ?Snapshot) ![]u8 {
+        var scratch: Block = undefined;
+        const head = try self.pinBlockAt(block_id, snap, &scratch);
+        defer self.unpinBlock(head);
 
-test "block header size" {
-    try std.testing.expectEqual(@as(usize, 64), @sizeOf(BlockHeader));
-}
+        var out: std.ArrayList(u8) = .{};
+        defer out.deinit(allocator);
+        return allocator.dupe(u8, try self.readChain(allocator, head, snap, &out));
+    }
+
+    /// Read an overflow extent with vectored preads that land each payload
+    /// directly in `dest` and headers in a side buffer. Returns false when
+    /// any block is not the one the head expects, so the caller can fall
+    /// back to `readOverflowBlocks`.
+    fn readOverflowVectored(self: *BlockStorage, head: *const Block, chain: OverflowHeader, dest: []u8) !bool {
+        const per_read = 128;
+        var headers: [per_read]BlockHeader = undefined;
+        var padding: [PAYLOAD_SIZE]u8 = undefined;
+        var iovecs: [2 * per_read + 1]std.posix.iovec = undefined;
+
+        var index: u32 = 0;
+        var pos: usize = 0;
+        while (index < chain.block_count) {
+            const n: u32 = @min(per_read, chain.block_count - index);
+
+            var iov_count: usize = 0;
+            var end = pos;
+            for (0..n) |i| {
+                const len = chain.chunkLen(index + @as(u32, @intCast(i)));
+                iovecs[iov_count] = .{ .base = @ptrCast(&headers[i]), .len = HEADER_SIZE };
+                iovecs[iov_count + 1] = .{ .base = dest[end..].ptr, .len = len };
+                iov_count += 2;
+                end += len;
+                if (len < PAYLOAD_SIZE) {
+                    iovecs[iov_count] = .{ .base = &padding, .len = PAYLOAD_SIZE - len };
+                    iov_count += 1;
+                }
+            }
+
+            const offset = (chain.first_block + index) * BLOCK_SIZE;
+            const got = try self.file.preadvAll(iovecs[0..iov_count], offset);
+            _ = self.stats.blocks_read.fetchAdd(n, .monotonic);
+            if (got < @as(usize, n) * BLOCK_SIZE) return false;
+
+            for (headers[0..n], 0..) |*header, i| {
+                const link_index = index + @as(u32, @intCast(i));
+                header.toNative();
+                if (!chain.links(header, link_index, head.header.block_id, head.header.sequence)) return false;
+                const chunk = dest[pos..][0..header.payload_len];
+                if (crc32c(chunk, header.payload_len) != header.checksum) return false;
+                pos += chunk.len;
+            }
+            index += n;
+        }
+        return true;
+    }
+
+    /// Assemble an overflow extent through `pinBlockAt`, which also sees
+    /// blocks still staged in the pool and pre-images kept for `snap`
+    fn readOverflowBlocks(self: *BlockStorage, head: *const Block, chain: OverflowHeader, snap: ?Snapshot, dest: []u8) !void {
+        var scratch: Block = undefined;
+        var pos: usize = 0;
+        var index: u32 = 0;
+        while (index < chain.block_count) : (index += 1) {
+            const block = try self.pinBlockAt(chain.first_block + index, snap, &scratch);
+            defer self.unpinBlock(block);
+            if (!chain.links(&block.header, index, head.header.block_id, head.header.sequence)) return error.InvalidChain;
+
+            const chunk = block.getPayload();
+            @memcpy(dest[pos..][0..chunk.len], chunk);
+            pos += chunk.len;
+        }
+    }
+
+    /// Validated view of a block inside the mapping. Returns null when the
+    /// bytes do not check out (possibly racing an in-place write), so the
+    /// caller falls back to pread, which reports any real corruption.
+    fn mappedBlock(self: *BlockStorage, m: *MappedFile, block_id: u64) !?*const Block {
+        const bytes = (try m.slice(block_id * BLOCK_SIZE, BLOCK_SIZE)) orelse return error.InvalidBlock;
+        const view: *const Block = @ptrCast(bytes.ptr);
+        view.validate() catch return null;
+        _ = self.stats.blocks_read.fetchAdd(1, .monotonic);
+        return view;
+    }
+
+    /// Hint that a full scan is starting (true) or has finished (false)
+    pub fn adviseSequential(self: *BlockStorage, sequential: bool) void {
+        if (self.mapped) |*m| m.advise(sequential);
+    }
+
+    fn readBlockFromDisk(self: *BlockStorage, block_id: u64) !Block {
+        _ = self.stats.blocks_read.fetchAdd(1, .monotonic);
+        return readBlockFile(self.file, block_id) catch |err| {
+            if (err == error.ChecksumMismatch) _ = self.stats.crc_failures.fetchAdd(1, .monotonic);
+            return err;
+        };
+    }
+
+    fn readBlockFile(file: std.fs.File, block_id: u64) !Block {
+        const offset = block_id * BLOCK_SIZE;
+
+        var bytes: [BLOCK_SIZE]u8 = undefined;
+        const n = try file.preadAll(&bytes, offset);
+        if (n < BLOCK_SIZE) {
+            return error.InvalidBlock;
+        }
+
+        return try Block.fromBytes(&bytes);
+    }
+
+    /// Write a block by ID (durable: syncs before returning)
+    pub fn writeBlock(self: *BlockStorage, block_id: u64, block: *const Block) !void {
+        try self.writeBlockNoSync(block_id, block);
+        try self.sync();
+    }
+
+    /// Write a block by ID without syncing. Callers are responsible for
+    /// issuing `sync` at the right point in their ordering protocol.
+    pub fn writeBlockNoSync(self: *BlockStorage, block_id: u64, block: *const Block) !void {
+        try self.indexBlock(block_id, block, null);
+        try self.writeBlockToDisk(block_id, block);
+        if (self.pool) |*pool| _ = pool.put(block_id, block, false);
+    }
+
+    /// Buffer a modified block in the pool; it reaches disk at the next
+    /// `flushDirty`. Falls back to writing through when no frame is free.
+    /// `undo` is the commit group staging it, if any (the caller records
+    /// the frame).
+    pub fn stageBlock(self: *BlockStorage, block_id: u64, block: *const Block, undo: ?*GroupUndo) !void {
+        try self.indexBlock(block_id, block, undo);
+        if (self.pool) |*pool| {
+            if (pool.put(block_id, block, true)) return;
+        }
+        if (undo) |u| u.written = true;
+        try self.writeBlockToDisk(block_id, block);
+    }
+
+    /// Keep the type index in step with a block image about to be written;
+    /// it is persisted with the next superblock
+    fn indexBlock(self: *BlockStorage, block_id: u64, block: *const Block, undo: ?*GroupUndo) !void {
+        self.alloc_mutex.lock();
+        defer self.alloc_mutex.unlock();
+        if (undo) |u| try u.types.append(self.allocator, .{ .block_id = block_id, .block_type = self.type_index.typeOf(block_id) });
+        try self.type_index.set(block_id, block.header.block_type, block.header.flags & FLAG_DELETED != 0);
+    }
+
+    /// IDs from `from` onwards that may hold a live `block_type` block as
+    /// seen by `snap` (the published head when null), ascending, taking
+    /// about `max` per call. Returns the ID to resume from; the scan is done
+    /// once that reaches the snapshot's (or storage's) block count. Callers
+    /// still check each block they pin: this only narrows the candidates.
+    pub fn blocksOfType(
+        self: *BlockStorage,
+        allocator: std.mem.Allocator,
+        block_type: u16,
+        snap: ?Snapshot,
+        from: u64,
+        max: usize,
+        out: *std.ArrayList(u64),
+    ) !u64 {
+        const limit = if (snap) |view| view.block_count else self.blockCount();
+        const start = out.items.len;
+        const resume_at = blk: {
+            self.alloc_mutex.lock();
+            defer self.alloc_mutex.unlock();
+            break :blk try self.type_index.collect(allocator, block_type, from, limit, max, out);
+        };
+
+        // Blocks retyped or freed since the snapshot, or by a group that
+        // has not published yet, survive as pre-images
+        const indexed = out.items.len;
+        try self.versions.collectIds(allocator, block_type, from, resume_at, out);
+        if (out.items.len == indexed) return resume_at;
+
+        const found = out.items[start..];
+        std.mem.sort(u64, found, {}, std.sort.asc(u64));
+        var kept: usize = 0;
+        for (found) |id| {
+            if (kept > 0 and found[kept - 1] == id) continue;
+            found[kept] = id;
+            kept += 1;
+        }
+        out.shrinkRetainingCapacity(start + kept);
+        return resume_at;
+    }
+
+    /// Live blocks of `block_type` from the type index, counting any a group
+    /// in flight has staged (the planner's estimate for a scan of that type)
+    pub fn countOfType(self: *BlockStorage, block_type: u16) u64 {
+        self.alloc_mutex.lock();
+        defer self.alloc_mutex.unlock();
+        return self.type_index.count(block_type);
+    }
+
+    /// Write back every block staged since the last flush (no sync)
+    pub fn flushDirty(self: *BlockStorage) !void {
+        if (self.pool) |*pool| try pool.flushDirty(self, writeBlockToDisk);
+    }
+
+    fn writeBlockToDisk(self: *BlockStorage, block_id: u64, block: *const Block) anyerror!void {
+        const offset = block_id * BLOCK_SIZE;
+
+        const bytes = block.toBytes();
+        try self.file.pwriteAll(&bytes, offset);
+        _ = self.stats.blocks_written.fetchAdd(1, .monotonic);
+        _ = self.stats.bytes_written.fetchAdd(BLOCK_SIZE, .monotonic);
+        if (self.mapped) |*m| m.extendTo(offset + BLOCK_SIZE);
+    }
+
+    /// Make all previously written blocks durable
+    pub fn sync(self: *BlockStorage) !void {
+        _ = self.stats.syncs.fetchAdd(1, .monotonic);
+        try self.file.sync();
+    }
+
+    /// fsyncs issued on the file since it was opened
+    pub fn syncCount(self: *const BlockStorage) u64 {
+        return self.stats.syncs.load(.monotonic);
+    }
+
+    /// Read consecutive blocks straight from the file, bypassing the pool
+    /// and the mapping, into `buf` (a whole number of blocks). Returns the
+    /// bytes read, short when the file ends first.
+    pub fn readRawBlocks(self: *BlockStorage, first_id: u64, buf: []u8) !usize {
+        std.debug.assert(buf.len % BLOCK_SIZE == 0);
+        return self.file.preadAll(buf, first_id * BLOCK_SIZE);
+    }
+
+    /// The scrub position as last recorded (zeroes for files that never
+    /// recorded one)
+    pub fn scrubCheckpoint(self: *BlockStorage) ScrubCheckpoint {
+        self.alloc_mutex.lock();
+        defer self.alloc_mutex.unlock();
+        const sb = &self.superblock;
+        if (sb.flags & SB_FLAG_SCRUB == 0) return .{};
+        return .{
+            .active = sb.flags & SB_FLAG_SCRUB_ACTIVE != 0,
+            .next = sb.scrub_next,
+            .pass_started = sb.scrub_pass_started,
+            .pass_completed = sb.scrub_pass_completed,
+        };
+    }
+
+    /// Record the scrub position and make it durable with an empty commit
+    /// group (which only rewrites the superblock)
+    pub fn saveScrubCheckpoint(self: *BlockStorage, checkpoint: ScrubCheckpoint) !void {
+        {
+            self.alloc_mutex.lock();
+            defer self.alloc_mutex.unlock();
+            const sb = &self.superblock;
+            sb.flags |= SB_FLAG_SCRUB;
+            if (checkpoint.active) sb.flags |= SB_FLAG_SCRUB_ACTIVE else sb.flags &= ~SB_FLAG_SCRUB_ACTIVE;
+            sb.scrub_next = checkpoint.next;
+            sb.scrub_pass_started = checkpoint.pass_started;
+            sb.scrub_pass_completed = checkpoint.pass_completed;
+        }
+        var batch = CommitBatch{};
+        try self.commit(&batch);
+    }
+
+    /// Append the engine counters and commit phase histograms as JSON
+    pub fn appendStatsJson(self: *BlockStorage, allocator: std.mem.Allocator, out: *std.ArrayList(u8)) !void {
+        const cache = if (self.pool) |*pool| pool.stats() else buffer_pool.PoolStats{ .frames = 0, .hits = 0, .misses = 0 };
+        try self.stats.appendJson(allocator, out, cache);
+    }
+
+    /// Allocate a new block (writes to disk immediately), reusing a freed
+    /// block when one is available
+    pub fn allocateBlock(self: *BlockStorage, block_type: BlockType) !u64 {
+        const new_id = self.reserveBlockId();
+
+        // Initialize new block, then publish it through the superblock
+        var block = Block.init(block_type, new_id, self.superblock.journal_head);
+        try self.writeBlockNoSync(new_id, &block);
+        try self.flushSuperblock();
+
+        return new_id;
+    }
+
+    /// Number of block IDs handed out so far (including uncommitted reservations)
+    pub fn blockCount(self: *BlockStorage) u64 {
+        self.alloc_mutex.lock();
+        defer self.alloc_mutex.unlock();
+        return self.superblock.block_count;
+    }
+
+    /// Whether `block_id` is an allocated document head: below blockCount,
+    /// not in the free-space map and written as a `.document` block. Only
+    /// these may be replaced in place by an update.
+    pub fn isDocument(self: *BlockStorage, block_id: u64) bool {
+        return self.isLive(block_id, .document);
+    }
+
+    /// `block_id` is allocated and holds a live `block_type` block as of
+    /// the published head
+    fn isLive(self: *BlockStorage, block_id: u64, block_type: BlockType) bool {
+        {
+            self.alloc_mutex.lock();
+            defer self.alloc_mutex.unlock();
+            if (block_id == 0 or block_id >= self.superblock.block_count) return false;
+            if (self.free_map.isFree(block_id)) return false;
+        }
+
+        var scratch: Block = undefined;
+        const view = self.pinBlock(block_id, &scratch) catch return false;
+        defer self.unpinBlock(view);
+        return holdsLive(view, block_type);
+    }
+
+    /// Reserve a block ID without writing to disk (for transaction buffering)
+    pub fn reserveBlockId(self: *BlockStorage) u64 {
+        return self.reserveBlockIds(1);
+    }
+
+    /// Reserve `count` consecutive block IDs, returning the first. A free
+    /// extent of that length is reused if one exists; otherwise the IDs are
+    /// appended at the end of the file.
+    pub fn reserveBlockIds(self: *BlockStorage, count: u64) u64 {
+        self.alloc_mutex.lock();
+        defer self.alloc_mutex.unlock();
+
+        if (self.free_map.allocate(count)) |first_id| return first_id;
+
+        const first_id = self.superblock.block_count;
+        self.superblock.block_count += count;
+        return first_id;
+    }
+
+    /// Return reserved IDs that were never written (aborted or unused
+    /// extents) to the free-space map
+    pub fn releaseBlockIds(self: *BlockStorage, first_id: u64, count: u64) !void {
+        self.alloc_mutex.lock();
+        defer self.alloc_mutex.unlock();
+
+        var id = first_id;
+        while (id < first_id + count) : (id += 1) try self.free_map.markFree(id);
+    }
+
+    /// Blocks currently available for reuse
+    pub fn freeBlockCount(self: *BlockStorage) u64 {
+        self.alloc_mutex.lock();
+        defer self.alloc_mutex.unlock();
+        return self.free_map.free_count;
+    }
+
+    /// Flush staged blocks and the superblock to disk (after batch operations)
+    pub fn flushSuperblock(self: *BlockStorage) !void {
+        var batch = WriteBatch.init(self.allocator);
+        defer batch.deinit();
+        errdefer self.restageFailed(&batch);
+
+        try self.collectDirty(&batch);
+        try self.collectSuperblock(&batch, null);
+        try self.submitWrites(&batch);
+    }
+
+    /// Move every block staged in the pool into `batch`
+    fn collectDirty(self: *BlockStorage, batch: *WriteBatch) !void {
+        if (self.pool) |*pool| try pool.flushDirty(batch, WriteBatch.addStaged);
+    }
+
+    /// Queue changed free-space map pages as data and the superblock as
+    /// the batch's commit block. `journal` carries journal pointers that
+    /// are written now but only published in memory once durable.
+    fn collectSuperblock(self: *BlockStorage, batch: *WriteBatch, journal: ?JournalPointers) !void {
+        self.alloc_mutex.lock();
+        var sb = blk: {
+            defer self.alloc_mutex.unlock();
+            try self.collectMapPages(&batch.data);
+            break :blk self.superblock;
+        };
+
+        if (journal) |pointers| {
+            sb.journal_head = pointers.head;
+            sb.journal_tail = pointers.tail;
+        }
+        const sb_block = try sb.toBlock();
+        batch.setCommitBlock(0, &sb_block);
+    }
+
+    /// After `batch` failed outside a commit group, re-stage the blocks it
+    /// collected and rewrite every map page next time rather than track
+    /// which writes landed (a failed group is rolled back instead)
+    fn restageFailed(self: *BlockStorage, batch: *const WriteBatch) void {
+        if (self.pool) |*pool| {
+            for (batch.data.items) |*pending| {
+                if (pending.staged) {
+                    const block = pending.native();
+                    _ = pool.put(pending.block_id, &block, true);
+                }
+            }
+        }
+        self.alloc_mutex.lock();
+        @memset(self.free_map.dirty.items, true);
+        self.type_index.markAllDirty();
+        self.alloc_mutex.unlock();
+    }
+
+    /// Write and sync `batch`, then make it visible to readers
+    fn submitWrites(self: *BlockStorage, batch: *const WriteBatch) !void {
+        // The writer syncs once after the data and once after the commit block
+        const n_blocks: u64 = batch.data.items.len + @intFromBool(batch.commit_block != null);
+        const n_syncs: u64 = @as(u64, @intFromBool(batch.data.items.len > 0)) + @intFromBool(batch.commit_block != null);
+        _ = self.stats.blocks_written.fetchAdd(n_blocks, .monotonic);
+        _ = self.stats.bytes_written.fetchAdd(n_blocks * BLOCK_SIZE, .monotonic);
+        _ = self.stats.syncs.fetchAdd(n_syncs, .monotonic);
+        try self.writer.submit(self.file, batch);
+
+        for (batch.data.items) |*pending| {
+            if (self.pool) |*pool| {
+                if (!pending.staged) {
+                    const block = pending.native();
+                    _ = pool.put(pending.block_id, &block, false);
+                }
+            }
+            if (self.mapped) |*m| m.extendTo((pending.block_id + 1) * BLOCK_SIZE);
+        }
+    }
+
+    /// Place free-space map and type index pages that have no block yet,
+    /// then encode the dirty ones (caller holds alloc_mutex)
+    fn collectMapPages(self: *BlockStorage, out: *std.ArrayList(block_writer.PendingWrite)) !void {
+        const map = &self.free_map;
+
+        // Placing a page can itself extend the file past the covered range
+        var placed = true;
+        while (placed) {
+            placed = false;
+            try map.ensurePages(FreeSpaceMap.pagesFor(self.superblock.block_count));
+            for (map.pages.items) |*page_id| {
+                if (page_id.* != 0) continue;
+                page_id.* = self.superblock.block_count;
+                self.superblock.block_count += 1;
+                placed = true;
+            }
+            if (try self.type_index.placePages(&self.superblock.block_count)) placed = true;
+        }
+
+        var payload: [PAYLOAD_SIZE]u8 = undefined;
+        for (map.pages.items, 0..) |page_id, index| {
+            if (!map.dirty.items[index]) continue;
+            map.encodePage(index, &payload);
+
+            var page = Block.init(.free_space_map, page_id, self.superblock.journal_head);
+            page.header.prev_block_id = if (index > 0) map.pages.items[index - 1] else 0;
+            try page.setPayload(&payload);
+            try out.append(self.allocator, block_writer.PendingWrite.of(page_id, &page, false));
+            map.dirty.items[index] = false;
+        }
+
+        if (map.pages.items.len > 0) {
+            self.superblock.free_map_tail = map.pages.items[map.pages.items.len - 1];
+        }
+
+        const index = &self.type_index;
+        var prev_page: u64 = 0;
+        for (index.chain.items) |ref| {
+            const page_id = index.pageId(ref);
+            defer prev_page = page_id;
+            if (!index.isDirty(ref)) continue;
+            index.encodePage(ref, &payload);
+
+            var page = Block.init(.type_index, page_id, self.superblock.journal_head);
+            page.header.prev_block_id = prev_page;
+            try page.setPayload(&payload);
+            try out.append(self.allocator, block_writer.PendingWrite.of(page_id, &page, false));
+            index.markClean(ref);
+        }
+        self.superblock.type_index_tail = index.tail();
+    }
+
+    /// Append a single free-form entry to the journal (its own commit)
+    pub fn appendJournal(self: *BlockStorage, entry_data: []const u8) !u64 {
+        const records = [_]JournalRecord{.{
+            .op = .unspecified,
+            .affected_block = 0,
+            .forward = entry_data,
+        }};
+        var batch = CommitBatch{ .journal = &records };
+        try self.commit(&batch);
+        return batch.last_segment;
+    }
+
+    /// Free a block (mark as free in the free-space map)
+    pub fn freeBlock(self: *BlockStorage, block_id: u64) !void {
+        try self.freeBlockNoSync(block_id, self.superblock.journal_head, null);
+        try self.flushSuperblock();
+    }
+
+    /// Free a block as of `sequence`. Within a commit group (`undo` set) it
+    /// is only held in the free-space map until the group publishes.
+    fn freeBlockNoSync(self: *BlockStorage, block_id: u64, sequence: u64, undo: ?*GroupUndo) !void {
+        if (block_id == 0) {
+            return error.CannotFreeSuperblock;
+        }
+
+        var block = try self.readLatest(block_id);
+        const chain = try OverflowHeader.of(&block);
+        try self.versions.preserve(&block, sequence);
+        if (undo) |u| try u.frames.append(self.allocator, .{ .block_id = block_id, .replaced = true });
+        block.header.block_type = @intFromEnum(BlockType.free);
+        block.header.sequence = sequence;
+        block.header.flags |= @as(u32, @as(u8, @bitCast(BlockFlags{ .deleted = true })));
+
+        block.header.prev_block_id = 0;
+        try self.stageBlock(block_id, &block, undo);
+
+        {
+            self.alloc_mutex.lock();
+            defer self.alloc_mutex.unlock();
+            if (undo != null) {
+                try self.free_map.hold(block_id);
+            } else {
+                try self.free_map.markFree(block_id);
+            }
+        }
+
+        if (chain) |overflow| try self.freeOverflow(overflow, sequence, undo);
+    }
+
+    fn freeOverflow(self: *BlockStorage, chain: OverflowHeader, sequence: u64, undo: ?*GroupUndo) !void {
+        var index: u32 = 0;
+        while (index < chain.block_count) : (index += 1) {
+            try self.freeBlockNoSync(chain.first_block + index, sequence, undo);
+        }
+    }
+
+    /// Fill `head` with a document too large for one block and stage its
+    /// overflow extent, reserved here so it is contiguous. On failure the
+    /// group's rollback releases the extent.
+    fn stageChain(self: *BlockStorage, head: *Block, data: []const u8, undo: *GroupUndo) !void {
+        const count = OverflowHeader.blocksFor(data.len);
+        try undo.extents.ensureUnusedCapacity(self.allocator, 1);
+        const chain = OverflowHeader{
+            .total_len = data.len,
+            .first_block = self.reserveBlockIds(count),
+            .block_count = count,
+        };
+        undo.extents.appendAssumeCapacity(.{ .first_block = chain.first_block, .count = count });
+
+        var payload: [PAYLOAD_SIZE]u8 = undefined;
+        chain.encode(payload[0..OVERFLOW_HEADER_SIZE]);
+        @memcpy(payload[OVERFLOW_HEADER_SIZE..], data[0..CHAIN_HEAD_CAPACITY]);
+        head.header.flags |= FLAG_CHAINED;
+        try head.setPayload(&payload);
+
+        var pos: usize = CHAIN_HEAD_CAPACITY;
+        var index: u32 = 0;
+        while (index < count) : (index += 1) {
+            const block_id = chain.first_block + index;
+            var block = Block.init(.document_overflow, block_id, head.header.sequence);
+            block.header.prev_block_id = if (index == 0) head.header.block_id else block_id - 1;
+            if (index + 1 < count) block.header.flags |= FLAG_CHAINED;
+
+            const len = chain.chunkLen(index);
+            try block.setPayload(data[pos..][0..len]);
+            try undo.frames.append(self.allocator, .{ .block_id = block_id, .replaced = false });
+            try self.stageBlock(block_id, &block, undo);
+            pos += len;
+        }
+    }
+
+    /// Commit a batch durably (group commit).
+    ///
+    /// The batch is queued; if no other thread is flushing, this thread
+    /// becomes the leader and writes every queued batch as one group:
+    /// journal segments + blocks + frees -> sync -> superblock -> sync,
+    /// handed to the BlockWriter as one batch. Otherwise it waits for a
+    /// leader to flush it. Concurrent commits on the same storage
+    /// therefore share the syncs.
+    pub fn commit(self: *BlockStorage, batch: *CommitBatch) !void {
+        self.commitAll((&batch)[0..1]);
+        if (batch.err) |err| return err;
+    }
+
+    /// Commit several batches in the same group, as if each had been
+    /// passed to `commit` by its own thread. Each outcome is left in the
+    /// batch's `err`.
+    pub fn commitAll(self: *BlockStorage, batches: []const *CommitBatch) void {
+        if (batches.len == 0) return;
+        for (batches, 0..) |batch, i| {
+            batch.done = false;
+            batch.err = null;
+            batch.next = if (i + 1 < batches.len) batches[i + 1] else null;
+        }
+        const last = batches[batches.len - 1];
+
+        self.commit_mutex.lock();
+        if (self.commit_tail) |tail| {
+            tail.next = batches[0];
+        } else {
+            self.commit_head = batches[0];
+        }
+        self.commit_tail = last;
+
+        // Queued in one step, so every batch lands in the same group
+        while (!last.done) {
+            if (self.commit_leader_active) {
+                self.commit_cond.wait(&self.commit_mutex);
+                continue;
+            }
+
+            // Become leader for everything queued so far
+            self.commit_leader_active = true;
+            const queued = self.commit_head;
+            self.commit_head = null;
+            self.commit_tail = null;
+            self.commit_mutex.unlock();
+
+            var rejected: ?*CommitBatch = null;
+            const group = self.rejectInvalid(queued, &rejected);
+
+            // A group that fails is rolled back whole, so each of its
+            // batches fails together and none is left staged
+            var group_err: ?anyerror = null;
+            if (group != null) {
+                self.flushGroup(group) catch |err| {
+                    group_err = err;
+                };
+            }
+
+            // Checkpoint while still leader so no commit interleaves with
+            // compaction. Only batches that asked for it see its failure;
+            // an automatic one is simply retried after the next group.
+            var checkpoint_err: ?anyerror = null;
+            if (group != null and group_err == null and (wantsCheckpoint(group) or self.checkpointDue())) {
+                self.runCheckpoint() catch |err| {
+                    checkpoint_err = err;
+                };
+            }
+
+            self.commit_mutex.lock();
+            var it = group;
+            while (it) |b| {
+                // Read next before publishing done: the owner may free b
+                const next_batch = b.next;
+                b.err = group_err orelse if (b.checkpoint) checkpoint_err else null;
+                b.done = true;
+                it = next_batch;
+            }
+            it = rejected;
+            while (it) |b| {
+                const next_batch = b.next;
+                b.done = true;
+                it = next_batch;
+            }
+            self.commit_leader_active = false;
+            self.commit_cond.broadcast();
+        }
+        self.commit_mutex.unlock();
+    }
+
+    /// Unlink batches that cannot be written from `group`, failing each
+    /// with its own error, so they do not fail the rest. Returns what is
+    /// left; the rejected batches are chained onto `rejected`.
+    fn rejectInvalid(self: *BlockStorage, group: ?*CommitBatch, rejected: *?*CommitBatch) ?*CommitBatch {
+        var valid: ?*CommitBatch = null;
+        var valid_tail: ?*CommitBatch = null;
+        var it = group;
+        while (it) |b| {
+            const next_batch = b.next;
+            b.next = null;
+            if (self.checkBatch(b)) {
+                if (valid_tail) |tail| tail.next = b else valid = b;
+                valid_tail = b;
+            } else |err| {
+                b.err = err;
+                b.next = rejected.*;
+                rejected.* = b;
+            }
+            it = next_batch;
+        }
+        return valid;
+    }
+
+    fn checkBatch(self: *BlockStorage, batch: *const CommitBatch) !void {
+        for (batch.writes) |w| {
+            if (w.payload.len > MAX_DOCUMENT_SIZE) return error.PayloadTooLarge;
+            if (w.payload.len > PAYLOAD_SIZE and w.block_type != .document) return error.PayloadTooLarge;
+        }
+        for (batch.journal) |record| {
+            if (record.forward.len > JOURNAL_MAX_FORWARD) return error.JournalEntryTooLarge;
+        }
+        // Freeing a map page, journal segment or overflow block by ID
+        // would corrupt the file
+        for (batch.frees) |block_id| {
+            if (block_id == 0) return error.CannotFreeSuperblock;
+            if (!self.isLive(block_id, batch.free_type)) return error.WrongBlockType;
+        }
+    }
+
+    /// Write one commit group (leader only)
+    fn flushGroup(self: *BlockStorage, group: ?*CommitBatch) !void {
+        var timer = PhaseTimer.start(&self.stats);
+
+        // Readers without a snapshot stay on the published head until
+        // phase 6, reading what this group rewrites from its pre-images;
+        // hold those until then (ending the view prunes them)
+        const published = try self.beginSnapshot();
+        defer self.endSnapshot(published);
+
+        // Anything failing from here on is undone, so the next group
+        // writes none of it
+        var undo = GroupUndo{};
+        defer undo.deinit(self.allocator);
+        errdefer self.rollBackGroup(&undo, published.sequence);
+
+        // Assign sequence numbers and count segments needed (batches were
+        // checked by `rejectInvalid`)
+        var segment_count: u64 = 0;
+        var next_seq = self.superblock.journal_head + 1;
+        {
+            var writer = JournalSegmentWriter{};
+            var it = group;
+            while (it) |b| : (it = b.next) {
+                b.first_sequence = next_seq;
+                for (b.journal) |record| {
+                    if (writer.count == 0 or !writer.fits(record.forward.len)) {
+                        segment_count += 1;
+                        writer.reset();
+                    }
+                    writer.len += JOURNAL_ENTRY_HEADER_SIZE + record.forward.len;
+                    writer.count += 1;
+                    next_seq += 1;
+                }
+                b.last_sequence = if (next_seq > b.first_sequence) next_seq - 1 else self.superblock.journal_head;
+            }
+        }
+
+        // Every block of the group is written as one batch: the segments
+        // queued in phase 1, then what phase 5 collects. Recovery reaches
+        // segments only through the superblock, which is written after the
+        // batch is synced, so they need no sync of their own.
+        var batch = WriteBatch.init(self.allocator);
+        defer batch.deinit();
+        // Runs before the rollback: blocks other commits left dirty stay so
+        errdefer self.restageFailed(&batch);
+
+        // Phase 1: Pack journal entries into contiguous segments
+        var prev_segment = self.superblock.journal_tail;
+        var new_segments: std.ArrayList(JournalLocation) = .{};
+        defer new_segments.deinit(self.allocator);
+        try new_segments.ensureTotalCapacity(self.allocator, segment_count);
+        try self.journal_index.reserveLive(segment_count);
+        if (segment_count > 0) {
+            try undo.extents.ensureUnusedCapacity(self.allocator, 1);
+            var segment_id = self.reserveBlockIds(segment_count);
+            undo.extents.appendAssumeCapacity(.{ .first_block = segment_id, .count = segment_count });
+            var writer = JournalSegmentWriter{};
+            var segment_first_seq: u64 = self.superblock.journal_head + 1;
+            var seq = segment_first_seq;
+
+            var it = group;
+            while (it) |b| : (it = b.next) {
+                for (b.journal) |record| {
+                    if (writer.count > 0 and !writer.fits(record.forward.len)) {
+                        try self.queueSegment(&batch, segment_id, segment_first_seq, prev_segment, &writer, &undo);
+                        new_segments.appendAssumeCapacity(.{ .first_sequence = segment_first_seq, .block_id = segment_id });
+                        prev_segment = segment_id;
+                        segment_id += 1;
+                        segment_first_seq = seq;
+                        writer.reset();
+                    }
+                    try writer.append(seq, record);
+                    b.last_segment = segment_id;
+                    seq += 1;
+                }
+            }
+            if (writer.count > 0) {
+                try self.queueSegment(&batch, segment_id, segment_first_seq, prev_segment, &writer, &undo);
+                new_segments.appendAssumeCapacity(.{ .first_sequence = segment_first_seq, .block_id = segment_id });
+                prev_segment = segment_id;
+            }
+        }
+        timer.stop(.journal);
+        // Phase 2 (segment write) is part of phase 5's batch
+        timer.stop(.journal_write);
+
+        // Phase 3: Stage all data blocks in the buffer pool; documents
+        // larger than a block are compressed if enabled, and those still
+        // larger get a fresh overflow extent
+        var compressed: std.ArrayList(u8) = .{};
+        defer compressed.deinit(self.allocator);
+
+        var it = group;
+        while (it) |b| : (it = b.next) {
+            for (b.writes) |w| {
+                var block = Block.init(w.block_type, w.block_id, b.last_sequence);
+                var stored = w.payload;
+                if (self.compression == .lz4 and w.block_type == .document) {
+                    if (try compressDocument(self.allocator, w.payload, &compressed)) |packed_doc| {
+                        stored = packed_doc;
+                        block.header.flags |= FLAG_COMPRESSED;
+                    }
+                }
+
+                if (stored.len > PAYLOAD_SIZE) {
+                    try self.stageChain(&block, stored, &undo);
+                } else {
+                    try block.setPayload(stored);
+                }
+
+                var replaced = false;
+                var replaced_chain: ?OverflowHeader = null;
+                if (w.replaces) {
+                    // Keep the pre-image for snapshots taken before this group
+                    // (and for a rollback)
+                    if (self.readLatest(w.block_id)) |previous| {
+                        try self.versions.preserve(&previous, b.last_sequence);
+                        replaced = true;
+                        replaced_chain = OverflowHeader.of(&previous) catch null;
+                    } else |_| {}
+                }
+                try undo.frames.append(self.allocator, .{ .block_id = w.block_id, .replaced = replaced });
+                try self.stageBlock(w.block_id, &block, &undo);
+
+                // The old extent is only freed after the new one was
+                // reserved, so the two never overlap
+                if (replaced_chain) |old| try self.freeOverflow(old, b.last_sequence, &undo);
+            }
+        }
+
+        timer.stop(.blocks);
+
+        // Phase 4: Process deletions
+        it = group;
+        while (it) |b| : (it = b.next) {
+            for (b.frees) |block_id| {
+                // Checked by `rejectInvalid`; one that an earlier batch in
+                // the group already freed is left alone. Failing once it is
+                // being freed fails the group.
+                const block = self.readLatest(block_id) catch continue;
+                if (!holdsLive(&block, b.free_type)) continue;
+                try self.freeBlockNoSync(block_id, b.last_sequence, &undo);
+            }
+        }
+        timer.stop(.deletes);
+
+        // Phase 5: Write back the segments, staged blocks and map pages as
+        // one batch; the superblock follows only once they are synced
+        const journal: ?JournalPointers = if (next_seq > self.superblock.journal_head + 1)
+            .{ .head = next_seq - 1, .tail = prev_segment }
+        else
+            null;
+
+        undo.written = true;
+        try self.collectDirty(&batch);
+        try self.collectSuperblock(&batch, journal);
+        try self.submitWrites(&batch);
+        timer.stop(.block_write);
+
+        // Phase 6: Publish the journal pointers now that they are durable;
+        // segments are indexed first so readers bounded by the head find them.
+        // Blocks freed by the group become reusable at the same time.
+        self.journal_index.appendLive(new_segments.items);
+        {
+            self.alloc_mutex.lock();
+            defer self.alloc_mutex.unlock();
+            if (journal) |pointers| {
+                self.superblock.journal_head = pointers.head;
+                self.superblock.journal_tail = pointers.tail;
+            }
+            self.free_map.publishHeld();
+        }
+        self.live_segments += segment_count;
+        timer.stop(.publish);
+        _ = self.stats.commit_groups.fetchAdd(1, .monotonic);
+    }
+
+    /// Undo what a failed group staged, newest first, so its blocks,
+    /// frees and reserved IDs are not picked up by the next group. `head`
+    /// is the published head the group started from. Cannot fail: a map
+    /// entry that cannot be restored is leaked rather than reused.
+    fn rollBackGroup(self: *BlockStorage, undo: *const GroupUndo, head: u64) void {
+        var i = undo.frames.items.len;
+        while (i > 0) {
+            i -= 1;
+            const frame = undo.frames.items[i];
+            var previous: Block = undefined;
+            if (frame.replaced and self.versions.find(frame.block_id, head, &previous)) {
+                self.restoreBlock(frame.block_id, &previous);
+            } else if (undo.written) {
+                // Never committed: whatever reached the file reads as free
+                var block = Block.init(.free, frame.block_id, head);
+                block.header.flags |= FLAG_DELETED;
+                self.restoreBlock(frame.block_id, &block);
+            } else if (self.pool) |*pool| {
+                pool.discard(frame.block_id);
+            }
+        }
+
+        self.alloc_mutex.lock();
+        defer self.alloc_mutex.unlock();
+        i = undo.types.items.len;
+        while (i > 0) {
+            i -= 1;
+            const entry = undo.types.items[i];
+            const block_type = entry.block_type orelse @intFromEnum(BlockType.free);
+            self.type_index.set(entry.block_id, block_type, entry.block_type == null) catch {};
+        }
+        self.free_map.dropHeld();
+        for (undo.extents.items) |extent| {
+            var id = extent.first_block;
+            while (id < extent.first_block + extent.count) : (id += 1) self.free_map.markFree(id) catch {};
+        }
+        // Rewrite every map page next time rather than track which the
+        // group's writes reached
+        @memset(self.free_map.dirty.items, true);
+        self.type_index.markAllDirty();
+    }
+
+    /// Put `block` back as the image of `block_id`. Staged dirty: the file
+    /// may hold the group's image, or not yet hold this one.
+    fn restoreBlock(self: *BlockStorage, block_id: u64, block: *const Block) void {
+        if (self.pool) |*pool| {
+            pool.discard(block_id);
+            if (pool.put(block_id, block, true)) return;
+        }
+        self.writeBlockToDisk(block_id, block) catch {};
+    }
+
+    /// Sequence of the last durable journal entry
+    pub fn journalHead(self: *BlockStorage) u64 {
+        self.alloc_mutex.lock();
+        defer self.alloc_mutex.unlock();
+        return self.superblock.journal_head;
+    }
+
+    /// The segment or archive block holding journal entry `sequence`
+    pub fn locateJournal(self: *BlockStorage, sequence: u64) !?JournalLocation {
+        const index = &self.journal_index;
+        index.mutex.lock();
+        defer index.mutex.unlock();
+
+        if (index.needsArchiveLocked(sequence)) try self.loadArchiveIndexLocked();
+        return index.findLocked(sequence);
+    }
+
+    /// Index the archive chain, newest to oldest through prev_block_id.
+    /// Done once, on the first read of archived history.
+    fn loadArchiveIndexLocked(self: *BlockStorage) !void {
+        const index = &self.journal_index;
+        index.archive.clearRetainingCapacity();
+        errdefer index.archive.clearRetainingCapacity();
+
+        var block_id = self.superblock.archive_tail;
+        while (block_id != 0) {
+            if (index.archive.items.len >= self.superblock.block_count) return error.InvalidJournal;
+            const block = try self.readBlock(block_id);
+            if (block.header.block_type != @intFromEnum(BlockType.journal_archive)) return error.InvalidJournal;
+            try index.archive.append(self.allocator, .{ .first_sequence = block.header.sequence, .block_id = block_id });
+            block_id = block.header.prev_block_id;
+        }
+        std.mem.reverse(JournalLocation, index.archive.items);
+        index.archive_loaded = true;
+    }
+
+    /// Write a CHECKPOINT journal entry and compact every segment before
+    /// it into the archive (its own commit)
+    pub fn checkpoint(self: *BlockStorage) !void {
+        var batch = CommitBatch{ .checkpoint = true };
+        try self.commit(&batch);
+    }
+
+    fn wantsCheckpoint(group: ?*CommitBatch) bool {
+        var it = group;
+        while (it) |b| : (it = b.next) {
+            if (b.checkpoint) return true;
+        }
+        return false;
+    }
+
+    fn checkpointDue(self: *const BlockStorage) bool {
+        return self.checkpoint_segments != 0 and self.live_segments >= self.checkpoint_segments;
+    }
+
+    /// Journal the checkpoint as a group of its own, then compact (leader only)
+    fn runCheckpoint(self: *BlockStorage) !void {
+        const records = [_]JournalRecord{.{ .op = .checkpoint, .affected_block = 0, .forward = "CHECKPOINT" }};
+        var marker = CommitBatch{ .journal = &records };
+        try self.flushGroup(&marker);
+        try self.compactJournal(marker.last_segment, marker.last_sequence);
+    }
+
+    /// Archive blocks written per sync while compacting
+    const ARCHIVE_WRITE_BATCH: usize = 256;
+
+    /// Move the segments older than `base` into journal_archive blocks and
+    /// free them (leader only). Archive blocks are synced before the
+    /// superblock that references them and frees the segments, so a crash
+    /// at any point leaves either the old chain or the compacted one.
+    fn compactJournal(self: *BlockStorage, base: u64, sequence: u64) !void {
+        const old_base = self.superblock.journal_base;
+
+        // Superseded segments, newest first
+        var superseded: std.ArrayList(u64) = .{};
+        defer superseded.deinit(self.allocator);
+        if (base != old_base) {
+            const base_block = try self.readBlock(base);
+            var segment_id = base_block.header.prev_block_id;
+            while (segment_id != 0) {
+                if (superseded.items.len >= self.superblock.block_count) return error.InvalidJournal;
+                try superseded.append(self.allocator, segment_id);
+                if (segment_id == old_base) break;
+                const segment = try self.readBlock(segment_id);
+                if (segment.header.block_type != @intFromEnum(BlockType.journal_segment)) return error.InvalidJournal;
+                segment_id = segment.header.prev_block_id;
+            }
+        }
+
+        var archive_tail = self.superblock.archive_tail;
+        var archived: std.ArrayList(JournalLocation) = .{};
+        defer archived.deinit(self.allocator);
+        if (superseded.items.len > 0) {
+            var packer = ArchivePacker.init(self.allocator);
+            defer packer.deinit();
+            var batch = WriteBatch.init(self.allocator);
+            defer batch.deinit();
+            errdefer self.restageFailed(&batch);
+
+            var i = superseded.items.len;
+            while (i > 0) {
+                i -= 1;
+                const segment = try self.readBlock(superseded.items[i]);
+                var iter = try JournalSegmentIterator.init(&segment);
+                while (true) {
+                    const start = iter.pos;
+                    if ((try iter.next()) == null) break;
+                    const entry = iter.payload[start..iter.pos];
+                    while (packer.full(entry.len)) try self.queueArchive(&batch, &packer, &archive_tail, &archived);
+                    try packer.append(entry);
+                }
+            }
+            while (!packer.isEmpty()) try self.queueArchive(&batch, &packer, &archive_tail, &archived);
+            try self.submitWrites(&batch);
+
+            for (superseded.items) |segment_id| try self.freeBlockNoSync(segment_id, sequence, null);
+        }
+
+        {
+            // Readers move to the archive together with the superblock
+            self.journal_index.mutex.lock();
+            defer self.journal_index.mutex.unlock();
+            self.journal_index.compactedLocked(sequence, archived.items);
+
+            self.alloc_mutex.lock();
+            defer self.alloc_mutex.unlock();
+            self.superblock.checkpoint_sequence = sequence;
+            self.superblock.journal_base = base;
+            self.superblock.archive_tail = archive_tail;
+            self.superblock.last_checkpoint = @intCast(std.time.milliTimestamp());
+        }
+
+        var batch = WriteBatch.init(self.allocator);
+        defer batch.deinit();
+        errdefer self.restageFailed(&batch);
+        try self.collectDirty(&batch);
+        try self.collectSuperblock(&batch, null);
+        try self.submitWrites(&batch);
+
+        self.live_segments = 1;
+        self.versions.prune();
+    }
+
+    fn queueArchive(
+        self: *BlockStorage,
+        batch: *WriteBatch,
+        packer: *ArchivePacker,
+        archive_tail: *u64,
+        archived: *std.ArrayList(JournalLocation),
+    ) !void {
+        const out = try packer.emit();
+        const block_id = self.reserveBlockId();
+        try archived.append(self.allocator, .{ .first_sequence = out.first_sequence, .block_id = block_id });
+        var block = Block.init(.journal_archive, block_id, out.first_sequence);
+        block.header.prev_block_id = archive_tail.*;
+        if (out.compressed) block.header.flags |= FLAG_COMPRESSED;
+        try block.setPayload(out.payload);
+        try self.indexBlock(block_id, &block, null);
+        try batch.add(block_id, &block);
+        archive_tail.* = block_id;
+
+        // Bound memory when a long legacy journal is compacted at once
+        if (batch.data.items.len >= ARCHIVE_WRITE_BATCH) {
+            try self.submitWrites(batch);
+            batch.data.clearRetainingCapacity();
+        }
+    }
+
+    fn queueSegment(
+        self: *BlockStorage,
+        batch: *WriteBatch,
+        segment_id: u64,
+        first_sequence: u64,
+        prev_segment: u64,
+        writer: *const JournalSegmentWriter,
+        undo: *GroupUndo,
+    ) !void {
+        var block = Block.init(.journal_segment, segment_id, first_sequence);
+        block.header.prev_block_id = prev_segment;
+        try block.setPayload(writer.payload());
+        try undo.frames.append(self.allocator, .{ .block_id = segment_id, .replaced = false });
+        try self.indexBlock(segment_id, &block, undo);
+        try batch.add(segment_id, &block);
+        // A dirty frame left for the reused ID (a rolled-back group's free
+        // image) would otherwise be flushed over it in the same batch
+        if (self.pool) |*pool| pool.discard(segment_id);
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "block header size" {
+    try std.testing.expectEqual(@as(usize, 64), @sizeOf(BlockHeader));
+}
 
 test "block size" {
     try std.testing.expectEqual(@as(usize, 4096), @sizeOf(Block));
@@ -510,7 +2519,7 @@ test "crc32c" {
     const data = "hello world";
     const crc = crc32c(data, data.len);
     // Verify against known CRC32C value
-    try std.testing.expect(crc != 0);
+    try std.testing.expectEqual(@as(u32, 0xC99465AA), crc);
 }
 
 test "block init and payload" {
@@ -608,3 +2617,686 @@ test "journal append" {
     const block2 = try storage.readBlock(j2);
     try std.testing.expectEqual(j1, block2.header.prev_block_id);
 }
+
+test "journal segment packing" {
+    var writer = JournalSegmentWriter{};
+    try writer.append(7, .{ .op = .doc_insert, .affected_block = 3, .forward = "INSERT block_id=3 size=10" });
+    try writer.append(8, .{ .op = .doc_delete, .affected_block = 4, .forward = "DELETE block_id=4" });
+    try std.testing.expectEqual(@as(u32, 2), writer.count);
+
+    var block = Block.init(.journal_segment, 1, 7);
+    try block.setPayload(writer.payload());
+
+    var iter = try JournalSegmentIterator.init(&block);
+    const e1 = (try iter.next()).?;
+    try std.testing.expectEqual(@as(u64, 7), e1.header.sequence);
+    try std.testing.expectEqual(@as(u16, 0x0001), e1.header.op_type);
+    try std.testing.expectEqualStrings("INSERT block_id=3 size=10", e1.forward);
+    const e2 = (try iter.next()).?;
+    try std.testing.expectEqual(@as(u64, 8), e2.header.sequence);
+    try std.testing.expectEqual(@as(u64, 4), e2.header.affected_block);
+    try std.testing.expect((try iter.next()) == null);
+
+    // A flipped payload byte must be caught by the per-entry checksum
+    block.payload[JOURNAL_ENTRY_HEADER_SIZE] ^= 0xFF;
+    var bad_iter = try JournalSegmentIterator.init(&block);
+    try std.testing.expectError(error.JournalChecksumMismatch, bad_iter.next());
+}
+
+test "group commit packs a transaction into one segment" {
+    const allocator = std.testing.allocator;
+    const path = "test_group_commit.lgh";
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const storage = try BlockStorage.open(allocator, path);
+    defer storage.deinit();
+
+    const first = storage.reserveBlockIds(2);
+    const records = [_]JournalRecord{
+        .{ .op = .doc_insert, .affected_block = first, .forward = "INSERT a" },
+        .{ .op = .doc_insert, .affected_block = first + 1, .forward = "INSERT b" },
+        .{ .op = .doc_delete, .affected_block = 99, .forward = "DELETE c" },
+    };
+    const writes = [_]BlockWrite{
+        .{ .block_id = first, .block_type = .document, .payload = "doc a" },
+        .{ .block_id = first + 1, .block_type = .document, .payload = "doc b" },
+    };
+    var batch = CommitBatch{ .journal = &records, .writes = &writes };
+    try storage.commit(&batch);
+
+    try std.testing.expectEqual(@as(u64, 1), batch.first_sequence);
+    try std.testing.expectEqual(@as(u64, 3), batch.last_sequence);
+    try std.testing.expectEqual(@as(u64, 3), storage.superblock.journal_head);
+    try std.testing.expectEqual(batch.last_segment, storage.superblock.journal_tail);
+
+    const segment = try storage.readBlock(storage.superblock.journal_tail);
+    var iter = try JournalSegmentIterator.init(&segment);
+    var count: usize = 0;
+    while (try iter.next()) |_| count += 1;
+    try std.testing.expectEqual(@as(usize, 3), count);
+
+    const doc = try storage.readBlock(first + 1);
+    try std.testing.expectEqualStrings("doc b", doc.getPayload());
+    try std.testing.expectEqual(@as(u64, 3), doc.header.sequence);
+}
+
+fn groupCommitWorker(storage: *BlockStorage, commits: usize) void {
+    var i: usize = 0;
+    while (i < commits) : (i += 1) {
+        const records = [_]JournalRecord{
+            .{ .op = .unspecified, .affected_block = 0, .forward = "concurrent entry" },
+        };
+        var batch = CommitBatch{ .journal = &records };
+        storage.commit(&batch) catch unreachable;
+    }
+}
+
+test "concurrent commits are all journaled" {
+    const allocator = std.testing.allocator;
+    const path = "test_group_commit_threads.lgh";
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const storage = try BlockStorage.open(allocator, path);
+    defer storage.deinit();
+
+    var threads: [4]std.Thread = undefined;
+    for (&threads) |*t| {
+        t.* = try std.Thread.spawn(.{}, groupCommitWorker, .{ storage, 25 });
+    }
+    for (threads) |t| t.join();
+
+    try std.testing.expectEqual(@as(u64, 100), storage.superblock.journal_head);
+
+    // Walk the segment chain back from the tail and count every entry
+    var entries: u64 = 0;
+    var segment_id = storage.superblock.journal_tail;
+    while (segment_id != 0) {
+        const segment = try storage.readBlock(segment_id);
+        var iter = try JournalSegmentIterator.init(&segment);
+        while (try iter.next()) |_| entries += 1;
+        segment_id = segment.header.prev_block_id;
+    }
+    try std.testing.expectEqual(@as(u64, 100), entries);
+}
+
+/// Sequences of every archived entry, oldest first
+fn archivedSequences(storage: *BlockStorage, out: *std.ArrayList(u64)) !usize {
+    var archive_blocks: usize = 0;
+    var raw: [journal_archive.MAX_RAW]u8 = undefined;
+    var block_id = storage.superblock.archive_tail;
+    while (block_id != 0) : (archive_blocks += 1) {
+        const block = try storage.readBlock(block_id);
+        var iter = JournalSegmentIterator.fromPayload(try journal_archive.unpack(&block, &raw));
+        var sequences: std.ArrayList(u64) = .{};
+        defer sequences.deinit(std.testing.allocator);
+        while (try iter.next()) |entry| try sequences.append(std.testing.allocator, entry.header.sequence);
+        try out.insertSlice(std.testing.allocator, 0, sequences.items);
+        block_id = block.header.prev_block_id;
+    }
+    return archive_blocks;
+}
+
+test "checkpoints compact superseded segments into the archive" {
+    const allocator = std.testing.allocator;
+    const path = "test_checkpoint.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    {
+        const storage = try BlockStorage.openWithOptions(allocator, path, .{ .checkpoint_segments = 0 });
+        defer storage.deinit();
+
+        // One small commit per segment, the case checkpoints compact best
+        for (0..50) |_| _ = try storage.appendJournal("INSERT block_id=1 size=10");
+        try std.testing.expectEqual(@as(u64, 50), storage.live_segments);
+
+        try storage.checkpoint();
+        try std.testing.expectEqual(@as(u64, 1), storage.live_segments);
+        try std.testing.expectEqual(@as(u64, 51), storage.superblock.checkpoint_sequence);
+        try std.testing.expectEqual(storage.superblock.journal_tail, storage.superblock.journal_base);
+        try std.testing.expect(storage.freeBlockCount() >= 40);
+
+        var sequences: std.ArrayList(u64) = .{};
+        defer sequences.deinit(allocator);
+        try std.testing.expect(try archivedSequences(storage, &sequences) < 5);
+        try std.testing.expectEqual(@as(usize, 50), sequences.items.len);
+        for (sequences.items, 1..) |seq, expected| try std.testing.expectEqual(@as(u64, expected), seq);
+    }
+
+    // Recovery only walks segments written since the checkpoint
+    {
+        const storage = try BlockStorage.openWithOptions(allocator, path, .{ .checkpoint_segments = 4 });
+        defer storage.deinit();
+        try std.testing.expectEqual(@as(u64, 1), storage.live_segments);
+
+        // The fourth live segment triggers an automatic checkpoint, which
+        // archives the previous checkpoint's segment as well
+        for (0..3) |_| _ = try storage.appendJournal("UPDATE block_id=1 size=12");
+        try std.testing.expectEqual(@as(u64, 1), storage.live_segments);
+        try std.testing.expectEqual(@as(u64, 55), storage.superblock.checkpoint_sequence);
+
+        var sequences: std.ArrayList(u64) = .{};
+        defer sequences.deinit(allocator);
+        _ = try archivedSequences(storage, &sequences);
+        try std.testing.expectEqual(@as(usize, 54), sequences.items.len);
+        for (sequences.items, 1..) |seq, expected| try std.testing.expectEqual(@as(u64, expected), seq);
+    }
+}
+
+test "version 1 files convert their journal on open" {
+    const allocator = std.testing.allocator;
+    const path = "test_legacy_journal.lgh";
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    // A file as the version 1 tree left it: one document and a journal
+    // block per entry, numbered the way its appendJournal did (the head
+    // jumps to the first journal block's ID, the document sits past it)
+    {
+        const file = try std.fs.cwd().createFile(path, .{});
+        defer file.close();
+
+        var sb = Superblock.init();
+        sb.version = 1;
+        sb.flags = 0;
+        sb.block_count = 4;
+        sb.journal_head = 4;
+        sb.journal_tail = 3;
+
+        var doc = Block.init(.document, 1, 5);
+        try doc.setPayload("{\"name\":\"legacy\"}");
+        var first = Block.init(.journal_segment, 2, 1);
+        try first.setPayload("INSERT block_id=1 size=17");
+        var second = Block.init(.journal_segment, 3, 4);
+        second.header.prev_block_id = 2;
+        try second.setPayload("UPDATE block_id=1 size=17");
+
+        const fixture = [_]Block{ try sb.toBlock(), doc, first, second };
+        for (fixture, 0..) |block, id| {
+            const bytes = block.toBytes();
+            try file.pwriteAll(&bytes, id * BLOCK_SIZE);
+        }
+    }
+
+    // The first two opens convert (the second finds the blocks already
+    // rewritten, since nothing wrote the superblock); the third reads
+    // the version 2 file the commit left behind
+    var pass: usize = 0;
+    while (pass < 3) : (pass += 1) {
+        const storage = try BlockStorage.open(allocator, path);
+        defer storage.deinit();
+
+        try std.testing.expectEqual(SUPERBLOCK_VERSION, storage.superblock.version);
+        try std.testing.expectEqual(@as(u64, if (pass == 2) 3 else 2), storage.journalHead());
+        const doc = try storage.readBlock(1);
+        try std.testing.expectEqualStrings("{\"name\":\"legacy\"}", doc.getPayload());
+
+        var reader = try journal_reader.JournalReader.open(allocator, storage, 1);
+        defer reader.close();
+        const insert = (try reader.next()).?;
+        try std.testing.expectEqual(@as(u64, 1), insert.header.sequence);
+        try std.testing.expectEqual(@as(u16, @intFromEnum(JournalOp.doc_insert)), insert.header.op_type);
+        try std.testing.expectEqual(@as(u64, 1), insert.header.affected_block);
+        try std.testing.expectEqualStrings("INSERT block_id=1 size=17", insert.forward);
+        const update = (try reader.next()).?;
+        try std.testing.expectEqual(@as(u64, 2), update.header.sequence);
+        try std.testing.expectEqual(@as(u16, @intFromEnum(JournalOp.doc_update)), update.header.op_type);
+        try std.testing.expectEqualStrings("UPDATE block_id=1 size=17", update.forward);
+
+        if (pass == 1) _ = try storage.appendJournal("after conversion");
+    }
+}
+
+test "buffer pool serves committed blocks and flushes them to disk" {
+    const allocator = std.testing.allocator;
+    const path = "test_buffer_pool.lgh";
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const block_id = blk: {
+        const storage = try BlockStorage.openWithOptions(allocator, path, .{ .buffer_pool_frames = 8 });
+        defer storage.deinit();
+
+        const id = storage.reserveBlockId();
+        const records = [_]JournalRecord{.{ .op = .doc_insert, .affected_block = id, .forward = "INSERT" }};
+        const writes = [_]BlockWrite{.{ .block_id = id, .block_type = .document, .payload = "cached" }};
+        var batch = CommitBatch{ .journal = &records, .writes = &writes };
+        try storage.commit(&batch);
+
+        const pool = &storage.pool.?;
+        const before = pool.stats().hits;
+        _ = try storage.readBlock(id);
+        _ = try storage.readBlock(id);
+        try std.testing.expectEqual(before + 2, pool.stats().hits);
+
+        var scratch: Block = undefined;
+        const pinned = try storage.pinBlock(id, &scratch);
+        defer storage.unpinBlock(pinned);
+        try std.testing.expect(pinned != &scratch);
+        try std.testing.expectEqualStrings("cached", pinned.getPayload());
+
+        break :blk id;
+    };
+
+    // Reopen uncached: the staged frame must have been written back
+    const storage = try BlockStorage.openWithOptions(allocator, path, .{ .buffer_pool_frames = 0 });
+    defer storage.deinit();
+    try std.testing.expect(storage.pool == null);
+
+    const doc = try storage.readBlock(block_id);
+    try std.testing.expectEqualStrings("cached", doc.getPayload());
+}
+
+test "storage counts I/O and times each commit phase" {
+    const allocator = std.testing.allocator;
+    const path = "test_engine_stats.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const block_id = blk: {
+        const storage = try BlockStorage.openWithOptions(allocator, path, .{ .buffer_pool_frames = 8 });
+        defer storage.deinit();
+
+        const written_before = storage.stats.blocks_written.load(.monotonic);
+        const syncs_before = storage.syncCount();
+
+        const id = storage.reserveBlockId();
+        const records = [_]JournalRecord{.{ .op = .doc_insert, .affected_block = id, .forward = "INSERT" }};
+        const writes = [_]BlockWrite{.{ .block_id = id, .block_type = .document, .payload = "counted" }};
+        var batch = CommitBatch{ .journal = &records, .writes = &writes };
+        try storage.commit(&batch);
+
+        // Segment, document and superblock at least: one sync for the
+        // segment and data, one for the superblock
+        try std.testing.expect(storage.stats.blocks_written.load(.monotonic) - written_before >= 3);
+        try std.testing.expectEqual(syncs_before + 2, storage.syncCount());
+        try std.testing.expectEqual(
+            storage.stats.blocks_written.load(.monotonic) * BLOCK_SIZE,
+            storage.stats.bytes_written.load(.monotonic),
+        );
+        try std.testing.expectEqual(@as(u64, 1), storage.stats.commit_groups.load(.monotonic));
+        for (&storage.stats.phases) |*h| try std.testing.expectEqual(@as(u64, 1), h.count.load(.monotonic));
+
+        break :blk id;
+    };
+
+    // Flip a payload byte on disk: the uncached read reports it
+    {
+        const file = try std.fs.cwd().openFile(path, .{ .mode = .read_write });
+        defer file.close();
+        const offset = block_id * BLOCK_SIZE + HEADER_SIZE;
+        var byte: [1]u8 = undefined;
+        _ = try file.preadAll(&byte, offset);
+        byte[0] ^= 0xFF;
+        try file.pwriteAll(&byte, offset);
+    }
+
+    const storage = try BlockStorage.openWithOptions(allocator, path, .{ .buffer_pool_frames = 0 });
+    defer storage.deinit();
+    const read_before = storage.stats.blocks_read.load(.monotonic);
+    try std.testing.expectError(error.ChecksumMismatch, storage.readBlock(block_id));
+    try std.testing.expectEqual(read_before + 1, storage.stats.blocks_read.load(.monotonic));
+    try std.testing.expectEqual(@as(u64, 1), storage.stats.crc_failures.load(.monotonic));
+}
+
+test "freed blocks are reused and the free-space map persists" {
+    const allocator = std.testing.allocator;
+    const path = "test_free_space.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const freed = blk: {
+        const storage = try BlockStorage.open(allocator, path);
+        defer storage.deinit();
+
+        const first = storage.reserveBlockIds(3);
+        const writes = [_]BlockWrite{
+            .{ .block_id = first, .block_type = .document, .payload = "a" },
+            .{ .block_id = first + 1, .block_type = .document, .payload = "b" },
+            .{ .block_id = first + 2, .block_type = .document, .payload = "c" },
+        };
+        const records = [_]JournalRecord{.{ .op = .doc_insert, .affected_block = first, .forward = "INSERT" }};
+        var insert = CommitBatch{ .journal = &records, .writes = &writes };
+        try storage.commit(&insert);
+
+        const frees = [_]u64{ first, first + 1 };
+        const deletes = [_]JournalRecord{.{ .op = .doc_delete, .affected_block = first, .forward = "DELETE" }};
+        var delete = CommitBatch{ .journal = &deletes, .frees = &frees };
+        try storage.commit(&delete);
+
+        try std.testing.expectEqual(@as(u64, 2), storage.freeBlockCount());
+        break :blk first;
+    };
+
+    const storage = try BlockStorage.open(allocator, path);
+    defer storage.deinit();
+
+    try std.testing.expectEqual(@as(u64, 2), storage.freeBlockCount());
+    const count_before = storage.blockCount();
+    try std.testing.expectEqual(freed, storage.reserveBlockIds(2));
+    try std.testing.expectEqual(count_before, storage.blockCount());
+}
+
+test "type index lists live blocks and persists" {
+    const allocator = std.testing.allocator;
+    const path = "test_type_index.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const doc_type: u16 = @intFromEnum(BlockType.document);
+    var ids: std.ArrayList(u64) = .{};
+    defer ids.deinit(allocator);
+
+    const first = blk: {
+        const storage = try BlockStorage.open(allocator, path);
+        defer storage.deinit();
+
+        const base = storage.reserveBlockIds(3);
+        const writes = [_]BlockWrite{
+            .{ .block_id = base, .block_type = .document, .payload = "a" },
+            .{ .block_id = base + 1, .block_type = .document, .payload = "b" },
+            .{ .block_id = base + 2, .block_type = .schema, .payload = "s" },
+        };
+        const records = [_]JournalRecord{.{ .op = .doc_insert, .affected_block = base, .forward = "INSERT" }};
+        var insert = CommitBatch{ .journal = &records, .writes = &writes };
+        try storage.commit(&insert);
+
+        const frees = [_]u64{base};
+        const deletes = [_]JournalRecord{.{ .op = .doc_delete, .affected_block = base, .forward = "DELETE" }};
+        var delete = CommitBatch{ .journal = &deletes, .frees = &frees };
+        try storage.commit(&delete);
+
+        _ = try storage.blocksOfType(allocator, doc_type, null, 1, std.math.maxInt(usize), &ids);
+        try std.testing.expectEqualSlices(u64, &.{base + 1}, ids.items);
+        break :blk base;
+    };
+
+    // Reopen: the index is loaded from its pages, not rebuilt
+    const storage = try BlockStorage.open(allocator, path);
+    defer storage.deinit();
+    try std.testing.expect(storage.superblock.type_index_tail != 0);
+
+    ids.clearRetainingCapacity();
+    _ = try storage.blocksOfType(allocator, doc_type, null, 1, std.math.maxInt(usize), &ids);
+    try std.testing.expectEqualSlices(u64, &.{first + 1}, ids.items);
+
+    ids.clearRetainingCapacity();
+    _ = try storage.blocksOfType(allocator, @intFromEnum(BlockType.journal_segment), null, 1, std.math.maxInt(usize), &ids);
+    try std.testing.expectEqual(@as(usize, 2), ids.items.len);
+}
+
+test "blocks staged by an unpublished group read as the published head" {
+    const allocator = std.testing.allocator;
+    const path = "test_staged_reads.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const storage = try BlockStorage.open(allocator, path);
+    defer storage.deinit();
+
+    const doc_id = storage.reserveBlockId();
+    const inserts = [_]BlockWrite{.{ .block_id = doc_id, .block_type = .document, .payload = "committed" }};
+    const records = [_]JournalRecord{.{ .op = .doc_insert, .affected_block = doc_id, .forward = "INSERT" }};
+    var insert = CommitBatch{ .journal = &records, .writes = &inserts };
+    try storage.commit(&insert);
+    const head = storage.journalHead();
+
+    // Stage a rewrite and a new block as phase 3 does, under the next
+    // group's sequence, without publishing it
+    const previous = try storage.readBlock(doc_id);
+    try storage.versions.preserve(&previous, head + 1);
+    var rewritten = Block.init(.document, doc_id, head + 1);
+    try rewritten.setPayload("staged");
+    try storage.stageBlock(doc_id, &rewritten, null);
+
+    const new_id = storage.reserveBlockId();
+    var created = Block.init(.document, new_id, head + 1);
+    try created.setPayload("new");
+    try storage.stageBlock(new_id, &created, null);
+
+    try std.testing.expectEqualStrings("committed", (try storage.readBlock(doc_id)).getPayload());
+    {
+        var scratch: Block = undefined;
+        const pinned = try storage.pinBlock(doc_id, &scratch);
+        defer storage.unpinBlock(pinned);
+        try std.testing.expectEqualStrings("committed", pinned.getPayload());
+    }
+    try std.testing.expectError(error.BlockNotVisible, storage.readBlock(new_id));
+
+    var ids: std.ArrayList(u64) = .{};
+    defer ids.deinit(allocator);
+    _ = try storage.blocksOfType(allocator, @intFromEnum(BlockType.document), null, 1, std.math.maxInt(usize), &ids);
+    try std.testing.expect(std.mem.indexOfScalar(u64, ids.items, doc_id) != null);
+
+    // Publishing the head makes both visible
+    storage.alloc_mutex.lock();
+    storage.superblock.journal_head = head + 1;
+    storage.alloc_mutex.unlock();
+    try std.testing.expectEqualStrings("staged", (try storage.readBlock(doc_id)).getPayload());
+    try std.testing.expectEqualStrings("new", (try storage.readBlock(new_id)).getPayload());
+}
+
+test "an invalid batch fails alone in its group" {
+    const allocator = std.testing.allocator;
+    const path = "test_invalid_batch.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const storage = try BlockStorage.open(allocator, path);
+    defer storage.deinit();
+
+    const good_id = storage.reserveBlockId();
+    const good_writes = [_]BlockWrite{.{ .block_id = good_id, .block_type = .document, .payload = "good" }};
+    const good_records = [_]JournalRecord{.{ .op = .doc_insert, .affected_block = good_id, .forward = "INSERT" }};
+    var good = CommitBatch{ .journal = &good_records, .writes = &good_writes };
+
+    // Only documents may overflow a block
+    const bad_id = storage.reserveBlockId();
+    const oversized = [_]u8{'x'} ** (PAYLOAD_SIZE + 1);
+    const bad_writes = [_]BlockWrite{.{ .block_id = bad_id, .block_type = .collection_meta, .payload = &oversized }};
+    const bad_records = [_]JournalRecord{.{ .op = .doc_insert, .affected_block = bad_id, .forward = "INSERT" }};
+    var bad = CommitBatch{ .journal = &bad_records, .writes = &bad_writes };
+
+    var group = [_]*CommitBatch{ &good, &bad };
+    storage.commitAll(&group);
+
+    try std.testing.expectEqual(@as(?anyerror, null), good.err);
+    try std.testing.expectEqual(@as(?anyerror, error.PayloadTooLarge), bad.err);
+    try std.testing.expectEqualStrings("good", (try storage.readBlock(good_id)).getPayload());
+    try std.testing.expectEqual(good.last_sequence, storage.journalHead());
+    try std.testing.expect(!storage.isDocument(bad_id));
+}
+
+test "a failed group leaves nothing for the next one to write" {
+    const allocator = std.testing.allocator;
+    const path = "test_failed_group.lgh";
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    var large: [10_000]u8 = undefined;
+    for (&large, 0..) |*byte, i| byte.* = @truncate(i * 7);
+
+    // Fail the k-th allocation of a group that rewrites a chained document,
+    // inserts another and frees a third, for every k the group reaches
+    var k: usize = 0;
+    while (true) : (k += 1) {
+        std.fs.cwd().deleteFile(path) catch {};
+        var failing = std.testing.FailingAllocator.init(allocator, .{});
+        const ids = blk: {
+            const storage = try BlockStorage.openWithOptions(failing.allocator(), path, .{});
+            defer storage.deinit();
+
+            const first = storage.reserveBlockIds(2);
+            const kept = first; // rewritten by the failing group
+            const dropped = first + 1; // freed by it
+            const setup = [_]BlockWrite{
+                .{ .block_id = kept, .block_type = .document, .payload = &large },
+                .{ .block_id = dropped, .block_type = .document, .payload = "dropped" },
+            };
+            const setup_records = [_]JournalRecord{.{ .op = .doc_insert, .affected_block = kept, .forward = "INSERT" }};
+            var insert = CommitBatch{ .journal = &setup_records, .writes = &setup };
+            try storage.commit(&insert);
+            const head = storage.journalHead();
+
+            const added = storage.reserveBlockId();
+            const writes = [_]BlockWrite{
+                .{ .block_id = kept, .block_type = .document, .payload = "rewritten", .replaces = true },
+                .{ .block_id = added, .block_type = .document, .payload = &large },
+            };
+            const frees = [_]u64{dropped};
+            const records = [_]JournalRecord{
+                .{ .op = .doc_update, .affected_block = kept, .forward = "UPDATE" },
+                .{ .op = .doc_insert, .affected_block = added, .forward = "INSERT" },
+                .{ .op = .doc_delete, .affected_block = dropped, .forward = "DELETE" },
+            };
+            var txn = CommitBatch{ .journal = &records, .writes = &writes, .frees = &frees };
+
+            failing.fail_index = failing.alloc_index + k;
+            const result = storage.commit(&txn);
+            failing.fail_index = std.math.maxInt(usize);
+            if (result) |_| {
+                // Done once the group no longer reaches the k-th allocation
+                if (!failing.has_induced_failure) break :blk null;
+                continue;
+            } else |_| {}
+
+            // Nothing of the failed group is visible or reusable
+            try std.testing.expectEqual(head, storage.journalHead());
+            const doc = try storage.readDocument(allocator, kept, null);
+            defer allocator.free(doc);
+            try std.testing.expectEqualSlices(u8, &large, doc);
+            try std.testing.expect(storage.isDocument(dropped));
+            try std.testing.expect(!storage.isDocument(added));
+            try std.testing.expectEqual(@as(?u16, null), storage.type_index.typeOf(added));
+
+            // The next group must not write what the failed one staged
+            const other = storage.reserveBlockId();
+            const other_writes = [_]BlockWrite{.{ .block_id = other, .block_type = .document, .payload = "other" }};
+            const other_records = [_]JournalRecord{.{ .op = .doc_insert, .affected_block = other, .forward = "INSERT" }};
+            var next = CommitBatch{ .journal = &other_records, .writes = &other_writes };
+            try storage.commit(&next);
+            break :blk [_]u64{ kept, dropped, added, other };
+        } orelse break;
+
+        const storage = try BlockStorage.open(allocator, path);
+        defer storage.deinit();
+        const doc = try storage.readDocument(allocator, ids[0], null);
+        defer allocator.free(doc);
+        try std.testing.expectEqualSlices(u8, &large, doc);
+        try std.testing.expect(storage.isDocument(ids[1]));
+        try std.testing.expect(!storage.isDocument(ids[2]));
+        try std.testing.expectEqualStrings("other", (try storage.readBlock(ids[3])).getPayload());
+    }
+    try std.testing.expect(k > 0);
+}
+
+test "large documents span an overflow chain" {
+    const allocator = std.testing.allocator;
+    const path = "test_overflow.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const storage = try BlockStorage.open(allocator, path);
+    defer storage.deinit();
+
+    var large: [10_000]u8 = undefined;
+    for (&large, 0..) |*byte, i| byte.* = @truncate(i * 7);
+    try std.testing.expectEqual(@as(u32, 2), OverflowHeader.blocksFor(large.len));
+
+    const doc_id = storage.reserveBlockId();
+    const inserts = [_]BlockWrite{.{ .block_id = doc_id, .block_type = .document, .payload = &large }};
+    const insert_records = [_]JournalRecord{.{ .op = .doc_insert, .affected_block = doc_id, .forward = "INSERT" }};
+    var insert = CommitBatch{ .journal = &insert_records, .writes = &inserts };
+    try storage.commit(&insert);
+
+    const read = try storage.readDocument(allocator, doc_id, null);
+    defer allocator.free(read);
+    try std.testing.expectEqualSlices(u8, &large, read);
+
+    // Shrinking the document frees its extent; a snapshot still sees it
+    const snap = try storage.beginSnapshot();
+    defer storage.endSnapshot(snap);
+    const free_before = storage.freeBlockCount();
+
+    const updates = [_]BlockWrite{.{ .block_id = doc_id, .block_type = .document, .payload = "small", .replaces = true }};
+    const update_records = [_]JournalRecord{.{ .op = .doc_update, .affected_block = doc_id, .forward = "UPDATE" }};
+    var update = CommitBatch{ .journal = &update_records, .writes = &updates };
+    try storage.commit(&update);
+    try std.testing.expectEqual(free_before + 2, storage.freeBlockCount());
+
+    const latest = try storage.readDocument(allocator, doc_id, null);
+    defer allocator.free(latest);
+    try std.testing.expectEqualStrings("small", latest);
+
+    const old = try storage.readDocument(allocator, doc_id, snap);
+    defer allocator.free(old);
+    try std.testing.expectEqualSlices(u8, &large, old);
+}
+
+test "compressible documents shrink to fewer blocks" {
+    const allocator = std.testing.allocator;
+    const path = "test_compressed.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const storage = try BlockStorage.openWithOptions(allocator, path, .{ .compression = .lz4 });
+    defer storage.deinit();
+
+    // ~12 KiB of repetitive JSON: three blocks raw, one compressed
+    var json: std.ArrayList(u8) = .{};
+    defer json.deinit(allocator);
+    var i: usize = 0;
+    while (json.items.len < 12_000) : (i += 1) {
+        try json.print(allocator, "{{\"id\":{d},\"kind\":\"evidence\"}},", .{i});
+    }
+
+    const doc_id = storage.reserveBlockId();
+    const writes = [_]BlockWrite{.{ .block_id = doc_id, .block_type = .document, .payload = json.items }};
+    const records = [_]JournalRecord{.{ .op = .doc_insert, .affected_block = doc_id, .forward = "INSERT" }};
+    var batch = CommitBatch{ .journal = &records, .writes = &writes };
+    try storage.commit(&batch);
+
+    const head = try storage.readBlock(doc_id);
+    try std.testing.expect(head.header.flags & FLAG_COMPRESSED != 0);
+    try std.testing.expect(head.header.flags & FLAG_CHAINED == 0);
+    try head.validate();
+
+    const read = try storage.readDocument(allocator, doc_id, null);
+    defer allocator.free(read);
+    try std.testing.expectEqualSlices(u8, json.items, read);
+}
+
+test "mmap reads hand out views that follow file growth" {
+    if (!mapped_file.supported) return error.SkipZigTest;
+
+    const allocator = std.testing.allocator;
+    const path = "test_mmap.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const storage = try BlockStorage.openWithOptions(allocator, path, .{ .buffer_pool_frames = 0, .mmap = true });
+    defer storage.deinit();
+    try std.testing.expect(storage.mapped != null);
+
+    // Enough blocks to outgrow the initial mapping several times
+    var ids: [64]u64 = undefined;
+    for (&ids, 0..) |*id, i| {
+        id.* = storage.reserveBlockId();
+        var payload: [8]u8 = undefined;
+        std.mem.writeInt(u64, &payload, i, .little);
+        const records = [_]JournalRecord{.{ .op = .doc_insert, .affected_block = id.*, .forward = "INSERT" }};
+        const writes = [_]BlockWrite{.{ .block_id = id.*, .block_type = .document, .payload = &payload }};
+        var batch = CommitBatch{ .journal = &records, .writes = &writes };
+        try storage.commit(&batch);
+    }
+
+    storage.adviseSequential(true);
+    defer storage.adviseSequential(false);
+
+    var scratch: Block = undefined;
+    for (ids, 0..) |id, i| {
+        const view = try storage.pinBlock(id, &scratch);
+        defer storage.unpinBlock(view);
+        try std.testing.expect(view != &scratch);
+        try std.testing.expectEqual(@as(u64, i), std.mem.readInt(u64, view.getPayload()[0..8], .little));
+    }
+
+    try std.testing.expectError(error.InvalidBlock, storage.readBlock(storage.blockCount() + 100));
+}
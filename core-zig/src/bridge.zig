@@ -8,7 +8,18 @@
 // Lg* = Lithoglyph types (abbreviated for C compatibility)
 
 const std = @import("std");
+const builtin = @import("builtin");
 const blocks = @import("blocks.zig");
+const cbor = @import("cbor.zig");
+const cursors = @import("cursor.zig");
+const handles = @import("handles.zig");
+const journal = @import("journal_reader.zig");
+const query = @import("query.zig");
+const parallel_scan = @import("parallel_scan.zig");
+const columnar = @import("columnar.zig");
+const replication = @import("replication.zig");
+const spatial = @import("spatial.zig");
+const scrub = @import("scrub.zig");
 
 // Simplified types for C ABI (no external dependencies)
 pub const LgBlob = extern struct {
@@ -31,6 +42,17 @@ pub const LgBlob = extern struct {
     }
 };
 
+/// Bytes borrowed from the bridge; valid until fdb_view_release(&view)
+pub const LgView = extern struct {
+    ptr: ?[*]const u8,
+    len: usize,
+    token: u64,
+
+    pub fn empty() LgView {
+        return .{ .ptr = null, .len = 0, .token = 0 };
+    }
+};
+
 pub const LgStatus = enum(c_int) {
     ok = 0,
     err_internal = 1,
@@ -40,6 +62,7 @@ pub const LgStatus = enum(c_int) {
     err_not_implemented = 5,
     err_txn_not_active = 6,
     err_txn_already_committed = 7,
+    err_conflict = 10,
 };
 
 pub const LgResult = extern struct {
@@ -82,28 +105,143 @@ pub const LgTxnMode = enum(c_int) {
 };
 
 pub const LgRenderOpts = extern struct {
-    format: c_int,
+    format: c_int, // LG_RENDER_JSON or LG_RENDER_CBOR
     include_metadata: bool,
 };
 
+pub const LG_RENDER_JSON: c_int = @intFromEnum(cursors.Format.json);
+pub const LG_RENDER_CBOR: c_int = @intFromEnum(cursors.Format.cbor);
+
+const json_opts = LgRenderOpts{ .format = LG_RENDER_JSON, .include_metadata = false };
+
+/// Output format requested by render options; null when unrecognised
+fn renderFormat(opts: LgRenderOpts) ?cursors.Format {
+    return std.meta.intToEnum(cursors.Format, opts.format) catch null;
+}
+
 // ============================================================
 // Opaque Handles
 // ============================================================
 
 pub const LgDb = opaque {};
 pub const LgTxn = opaque {};
+pub const LgCursor = opaque {};
 
 // Internal state structures
 const DbState = struct {
     allocator: std.mem.Allocator,
     storage: *blocks.BlockStorage,
+
+    // Compiled fdb_query_execute plans by normalized text
+    plans: query.PlanCache,
+
+    // Workers for fdb_read_blocks and friends ("scan_workers")
+    scanners: parallel_scan.ScanPool,
+
+    // Leader-to-local block IDs and watermark of fdb_replication_apply
+    replica: replication.ReplicaMap,
+
+    // Held by fdb_spatial_sync; queries read snapshots and never take it
+    spatial_mutex: std.Thread.Mutex = .{},
+
+    // Background checksum passes ("scrub_mib_per_sec") and the workers
+    // fdb_verify_checksums shares with them
+    scrubber: scrub.Scrubber,
+
+    // fdb_txn_commit_async: transactions wait in `async_queue` for a
+    // writer thread, which takes everything queued and commits it as one
+    // group. The pool starts with the first async commit.
+    async_mutex: std.Thread.Mutex = .{},
+    async_queue: std.ArrayList(*AsyncCommit) = .{},
+    writers: ?*std.Thread.Pool = null,
+    writers_failed: bool = false,
+    async_pending: std.Thread.WaitGroup = .{},
+
+    // Views from fdb_read_block_view still out. A close with views open
+    // leaves the storage to the last fdb_view_release, so borrowed bytes
+    // never outlive the pool frames they point into.
+    view_mutex: std.Thread.Mutex = .{},
+    open_views: usize = 0,
+    closing: bool = false,
+
+    fn retainView(self: *DbState) void {
+        self.view_mutex.lock();
+        defer self.view_mutex.unlock();
+        self.open_views += 1;
+    }
+
+    /// Drop a view; true if that was the last one holding a closed database
+    fn releaseView(self: *DbState) bool {
+        self.view_mutex.lock();
+        defer self.view_mutex.unlock();
+        self.open_views -= 1;
+        return self.closing and self.open_views == 0;
+    }
+
+    /// Mark closed; true if no views remain and it can be freed now
+    fn markClosing(self: *DbState) bool {
+        self.view_mutex.lock();
+        defer self.view_mutex.unlock();
+        self.closing = true;
+        return self.open_views == 0;
+    }
+
+    fn destroy(self: *DbState) void {
+        self.scrubber.deinit();
+        self.plans.deinit();
+        self.scanners.deinit();
+        self.replica.deinit();
+        self.storage.deinit();
+        self.allocator.destroy(self);
+    }
+
+    /// The writer pool, started on first use; null when threads are not
+    /// available, in which case callers drain the queue themselves
+    fn writerPoolLocked(self: *DbState) ?*std.Thread.Pool {
+        if (self.writers != null or self.writers_failed or builtin.single_threaded) return self.writers;
+        const pool = self.allocator.create(std.Thread.Pool) catch {
+            self.writers_failed = true;
+            return null;
+        };
+        pool.init(.{ .allocator = self.allocator, .n_jobs = ASYNC_COMMIT_THREADS }) catch {
+            self.allocator.destroy(pool);
+            self.writers_failed = true;
+            return null;
+        };
+        self.writers = pool;
+        return pool;
+    }
+
+    /// Move up to `out.len` queued commits into `out`
+    fn takeAsync(self: *DbState, out: []*AsyncCommit) usize {
+        self.async_mutex.lock();
+        defer self.async_mutex.unlock();
+        const n = @min(out.len, self.async_queue.items.len);
+        @memcpy(out[0..n], self.async_queue.items[0..n]);
+        const rest = self.async_queue.items.len - n;
+        std.mem.copyForwards(*AsyncCommit, self.async_queue.items[0..rest], self.async_queue.items[n..]);
+        self.async_queue.shrinkRetainingCapacity(rest);
+        return n;
+    }
+
+    /// Wait for queued async commits and stop the writer pool
+    fn stopWriters(self: *DbState) void {
+        self.async_pending.wait();
+        if (self.writers) |pool| {
+            pool.deinit();
+            self.allocator.destroy(pool);
+        }
+        self.writers = null;
+        self.async_queue.deinit(self.allocator);
+    }
 };
 
 /// A pending write operation buffered within a transaction
 const PendingWrite = struct {
     block_id: u64,
-    data: []u8, // owned copy of payload
-    journal_msg: []u8, // owned journal entry text
+    data: []u8, // copy of payload (transaction arena)
+    journal_op: blocks.JournalOp,
+    journal_msg: ?[]u8, // entry text (transaction arena); null when an earlier bulk record covers it
     is_new: bool, // true=insert, false=update
 };
 
@@ -114,24 +252,158 @@ const TxnState = struct {
     sequence: u64,
     pending_writes: std.ArrayList(PendingWrite),
     pending_deletes: std.ArrayList(u64), // block IDs to delete
+    snapshot: ?blocks.Snapshot = null, // read view for read-only transactions
+
+    // Serves the pending lists, payload copies, journal text and commit
+    // scratch; released in one shot at commit or abort. A handle is used
+    // by one thread at a time, so the arena needs no locking.
+    arena: std.heap.ArenaAllocator,
+
+    // Contiguous block IDs reserved for this transaction's inserts
+    extent_next: u64 = 0,
+    extent_end: u64 = 0,
+    extent_size: u64 = 0,
+
+    /// Next block ID for an insert. Extents double in size (up to
+    /// MAX_TXN_EXTENT) so a multi-block transaction writes sequentially.
+    fn nextBlockId(self: *TxnState) u64 {
+        if (self.extent_next == self.extent_end) {
+            self.extent_size = @min(@max(self.extent_size * 2, 1), MAX_TXN_EXTENT);
+            self.extent_next = self.db.storage.reserveBlockIds(self.extent_size);
+            self.extent_end = self.extent_next + self.extent_size;
+        }
+        const block_id = self.extent_next;
+        self.extent_next += 1;
+        return block_id;
+    }
+
+    /// Hand unwritten IDs back to the free-space map. With `inserts` set
+    /// (abort), IDs already given to pending inserts are returned too.
+    fn releaseBlockIds(self: *TxnState, inserts: bool) void {
+        // Failure (out of memory) only leaks the IDs
+        const storage = self.db.storage;
+        if (inserts) {
+            for (self.pending_writes.items) |pw| {
+                if (pw.is_new) storage.releaseBlockIds(pw.block_id, 1) catch {};
+            }
+        }
+        if (self.extent_next < self.extent_end) {
+            storage.releaseBlockIds(self.extent_next, self.extent_end - self.extent_next) catch {};
+        }
+        self.extent_next = 0;
+        self.extent_end = 0;
+    }
+
+    fn releaseSnapshot(self: *TxnState) void {
+        if (self.snapshot) |snap| self.db.storage.endSnapshot(snap);
+        self.snapshot = null;
+    }
+
+    fn allocator(self: *TxnState) std.mem.Allocator {
+        return self.arena.allocator();
+    }
 
     fn deinitPending(self: *TxnState) void {
-        for (self.pending_writes.items) |pw| {
-            global_allocator.free(pw.data);
-            global_allocator.free(pw.journal_msg);
+        self.pending_writes = .{};
+        self.pending_deletes = .{};
+        self.arena.deinit();
+    }
+};
+
+/// A transaction handed to fdb_txn_commit_async (in its own arena)
+const AsyncCommit = struct {
+    txn: *TxnState,
+    callback: LgCommitCallback,
+    ctx: ?*anyopaque,
+    batch: blocks.CommitBatch = .{},
+    prepared: bool = false,
+};
+
+/// An open scan from fdb_cursor_open_blocks or fdb_query_execute
+const CursorState = struct {
+    db: *DbState,
+    scan: cursors.BlockCursor,
+    // The query the scan filters for, if any
+    exec: ?*query.Execution = null,
+
+    fn close(self: *CursorState) void {
+        self.scan.close();
+        if (self.exec) |exec| {
+            exec.deinit();
+            global_allocator.destroy(exec);
         }
-        self.pending_writes.deinit(global_allocator);
-        self.pending_deletes.deinit(global_allocator);
+        global_allocator.destroy(self);
+    }
+};
+
+/// Bytes lent out by fdb_read_block_view
+const ViewState = struct {
+    db: *DbState,
+    // Pinned pool frame the view points into, if borrowed
+    frame: ?*const blocks.Block = null,
+    // Otherwise the document copied or reassembled here
+    owned: std.ArrayList(u8) = .{},
+
+    fn release(self: *ViewState) void {
+        const db = self.db;
+        if (self.frame) |frame| db.storage.unpinBlock(frame);
+        self.owned.deinit(global_allocator);
+        global_allocator.destroy(self);
+        if (db.releaseView()) db.destroy();
     }
 };
 
-// Global allocator for C ABI (can't pass allocator through C)
+/// Largest block-ID extent a transaction reserves at once
+const MAX_TXN_EXTENT: u64 = 64;
+
+/// Writer threads per database for fdb_txn_commit_async. Each takes
+/// every queued transaction as one commit group, so a few threads keep
+/// the disk busy however many callers are waiting.
+const ASYNC_COMMIT_THREADS: u32 = 4;
+
+/// Most transactions a writer takes from the queue per group
+const ASYNC_GROUP_MAX: usize = 256;
+
+// Global allocator for C ABI (can't pass allocator through C). Debug
+// builds keep the GPA for its leak and double-free checks; release builds
+// use the thread-caching smp_allocator so concurrent callers allocating
+// result blobs do not contend on one lock.
 var gpa = std.heap.GeneralPurposeAllocator(.{}){};
-const global_allocator = gpa.allocator();
+const global_allocator = if (builtin.mode == .Debug or builtin.single_threaded)
+    gpa.allocator()
+else
+    std.heap.smp_allocator;
+
+// Live handles. A C handle is the table handle reinterpreted as a
+// pointer (it is never 0), so validating one is an array lookup and a
+// generation compare: bridge calls from any number of threads do not
+// serialize on a registry lock, and a stale or closed handle is rejected
+// rather than dereferenced.
+var db_handles = handles.HandleTable(DbState).init(global_allocator);
+var txn_handles = handles.HandleTable(TxnState).init(global_allocator);
+var cursor_handles = handles.HandleTable(CursorState).init(global_allocator);
+var view_handles = handles.HandleTable(ViewState).init(global_allocator);
+
+fn lookupDb(db: ?*LgDb) ?*DbState {
+    return db_handles.get(@intFromPtr(db));
+}
+
+fn lookupTxn(txn: ?*LgTxn) ?*TxnState {
+    return txn_handles.get(@intFromPtr(txn));
+}
+
+fn lookupCursor(cursor: ?*LgCursor) ?*CursorState {
+    return cursor_handles.get(@intFromPtr(cursor));
+}
 
-// Active handles registry
-var db_registry = std.AutoHashMap(*DbState, void).init(global_allocator);
-var txn_registry = std.AutoHashMap(*TxnState, void).init(global_allocator);
+/// The C form of a table handle
+fn toHandle(comptime Handle: type, handle: usize) *Handle {
+    // SAFETY: opaque types have alignment 1 and table handles are never 0,
+    // so the result is a valid non-null *Handle. It is never dereferenced:
+    // callers only pass it back, and every entry point resolves it through
+    // its HandleTable, which rejects stale and unknown values.
+    return @ptrFromInt(handle);
+}
 
 // ============================================================
 // Error Blob Creation
@@ -169,13 +441,16 @@ pub export fn fdb_db_open(
     out_db: *?*LgDb,
     out_err: *LgBlob,
 ) LgStatus {
-    _ = opts_ptr;
-    _ = opts_len;
-
     const path = path_ptr[0..path_len];
 
+    const opts: []const u8 = if (opts_ptr) |ptr| ptr[0..opts_len] else &.{};
+    const options = parseOpenOptions(opts) catch {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid open options (expected CBOR map)");
+        return .err_invalid_argument;
+    };
+
     // Open or create block storage
-    const storage = blocks.BlockStorage.open(global_allocator, path) catch |err| {
+    const storage = blocks.BlockStorage.openWithOptions(global_allocator, path, options.storage) catch |err| {
         const msg = switch (err) {
             error.OutOfMemory => "Out of memory",
             error.FileNotFound => "Database not found",
@@ -196,56 +471,226 @@ pub export fn fdb_db_open(
     db.* = .{
         .allocator = global_allocator,
         .storage = storage,
+        .plans = query.PlanCache.init(global_allocator),
+        .scanners = parallel_scan.ScanPool.init(global_allocator, options.scan_workers),
+        .replica = replication.ReplicaMap.init(global_allocator),
+        .scrubber = scrub.Scrubber.init(global_allocator, storage, options.scrub),
+    };
+
+    db.scrubber.start() catch |err| {
+        db.destroy();
+        const msg = if (err == error.TimerUnsupported) "No clock to pace scrubbing by" else "Failed to start scrubber";
+        out_err.* = createErrorBlob(.err_internal, msg);
+        return .err_internal;
     };
 
     // Register handle
-    db_registry.put(db, {}) catch {
-        storage.deinit();
-        global_allocator.destroy(db);
+    const handle = db_handles.insert(db) catch {
+        db.destroy();
         out_err.* = createErrorBlob(.err_internal, "Failed to register database handle");
         return .err_internal;
     };
 
-    // SAFETY: db is a freshly-allocated *DbState from global_allocator.create() above,
-    // registered in db_registry. Cast to opaque *LgDb is safe because callers only
-    // pass it back through C ABI functions that cast it back to *DbState after
-    // validating the handle exists in db_registry.
-    out_db.* = @ptrCast(db);
+    out_db.* = toHandle(LgDb, handle);
     out_err.* = LgBlob.empty();
     return .ok;
 }
 
+const OpenOptions = struct {
+    storage: blocks.StorageOptions = .{},
+    scan_workers: u32 = 0,
+    scrub: scrub.Options = .{},
+};
+
+/// Decode fdb_db_open options: a CBOR map keyed by text strings.
+/// Unknown keys are skipped so newer clients can open with older cores.
+///
+///   "buffer_pool_frames" (uint) - shared page cache size in 4 KiB frames
+///   "checkpoint_segments" (uint) - live journal segments per automatic checkpoint
+///   "scan_workers" (uint) - threads per block scan, caller included; 0 (the
+///                           default) is one per CPU, 1 scans serially
+///   "scrub_mib_per_sec" (uint) - background checksum read budget; 0 (the
+///                                default) verifies only on request
+///   "scrub_workers" (uint) - threads per checksum pass (default 2)
+///   "scrub_interval_hours" (uint) - least time between background passes
+fn parseOpenOptions(opts: []const u8) !OpenOptions {
+    var options = OpenOptions{};
+    if (opts.len == 0) return options;
+
+    var decoder = cbor.Decoder.init(global_allocator, opts);
+    const entries = try decoder.decodeMapLen();
+    for (0..entries) |_| {
+        const key = try decoder.decodeText();
+        if (std.mem.eql(u8, key, "buffer_pool_frames")) {
+            options.storage.buffer_pool_frames = std.math.cast(u32, try decoder.decodeUint()) orelse return error.InvalidValue;
+        } else if (std.mem.eql(u8, key, "mmap")) {
+            options.storage.mmap = try decoder.decodeBool();
+        } else if (std.mem.eql(u8, key, "io_uring")) {
+            options.storage.io_uring = try decoder.decodeBool();
+        } else if (std.mem.eql(u8, key, "compression")) {
+            const name = try decoder.decodeText();
+            options.storage.compression = std.meta.stringToEnum(blocks.Compression, name) orelse return error.InvalidValue;
+        } else if (std.mem.eql(u8, key, "checkpoint_segments")) {
+            options.storage.checkpoint_segments = std.math.cast(u32, try decoder.decodeUint()) orelse return error.InvalidValue;
+        } else if (std.mem.eql(u8, key, "scan_workers")) {
+            options.scan_workers = std.math.cast(u32, try decoder.decodeUint()) orelse return error.InvalidValue;
+        } else if (std.mem.eql(u8, key, "scrub_mib_per_sec")) {
+            options.scrub.bytes_per_sec = std.math.mul(u64, try decoder.decodeUint(), 1024 * 1024) catch return error.InvalidValue;
+        } else if (std.mem.eql(u8, key, "scrub_workers")) {
+            options.scrub.workers = std.math.cast(u32, try decoder.decodeUint()) orelse return error.InvalidValue;
+        } else if (std.mem.eql(u8, key, "scrub_interval_hours")) {
+            options.scrub.interval_ms = std.math.mul(u64, try decoder.decodeUint(), std.time.ms_per_hour) catch return error.InvalidValue;
+        } else {
+            try decoder.skip();
+        }
+    }
+    return options;
+}
+
 /// Close a FormDB database
 ///
 /// @param db Database handle
 /// @return Status code
 pub export fn fdb_db_close(db: ?*LgDb) LgStatus {
-    // SAFETY: db was originally a *DbState allocated by global_allocator.create()
-    // in fdb_db_open, then cast to *LgDb. The orelse guards null. Alignment is
-    // guaranteed because DbState was heap-allocated with proper alignment by the GPA.
-    // The subsequent db_registry.contains() check validates the pointer is still live.
-    const state: *DbState = @ptrCast(@alignCast(db orelse return .err_invalid_argument));
+    // Invalidate the handle first: of two racing closes only one proceeds
+    const state = db_handles.remove(@intFromPtr(db)) orelse return .err_invalid_argument;
 
-    if (!db_registry.contains(state)) {
-        return .err_invalid_argument;
-    }
+    // A background pass stops at its last checkpoint
+    state.scrubber.stop();
+
+    // Async commits in flight are completed, not dropped
+    state.stopWriters();
 
     // Clean up any active transactions
-    var txn_iter = txn_registry.keyIterator();
-    while (txn_iter.next()) |txn| {
-        if (txn.*.db == state) {
-            _ = txn_registry.remove(txn.*);
-            global_allocator.destroy(txn.*);
-        }
+    var txn_iter = txn_handles.iterator();
+    while (txn_iter.next()) |entry| {
+        if (entry.value.db != state) continue;
+        const owned = txn_handles.remove(entry.handle) orelse continue;
+        owned.deinitPending();
+        owned.releaseSnapshot();
+        global_allocator.destroy(owned);
+    }
+
+    // Cursors hold snapshots on this storage
+    var cursor_iter = cursor_handles.iterator();
+    while (cursor_iter.next()) |entry| {
+        if (entry.value.db != state) continue;
+        const open_cursor = cursor_handles.remove(entry.handle) orelse continue;
+        open_cursor.close();
     }
 
-    // Close block storage
-    state.storage.deinit();
+    // Close block storage, unless views still borrow from it: the last
+    // fdb_view_release closes it then
+    if (state.markClosing()) state.destroy();
 
-    // Clean up database state
-    _ = db_registry.remove(state);
-    global_allocator.destroy(state);
+    return .ok;
+}
+
+/// Checkpoint the journal now rather than waiting for the
+/// "checkpoint_segments" threshold: segments before the checkpoint are
+/// compacted into the journal archive and their blocks freed for reuse
+///
+/// @param db Database handle
+/// @param out_err Output parameter for error blob
+/// @return Status code
+pub export fn fdb_db_checkpoint(db: ?*LgDb, out_err: *LgBlob) LgStatus {
+    const state = lookupDb(db) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
+        return .err_invalid_argument;
+    };
+
+    state.storage.checkpoint() catch {
+        out_err.* = createErrorBlob(.err_internal, "Journal or block write failed during checkpoint");
+        return .err_internal;
+    };
+
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Number of fsyncs issued on the database file since it was opened
+/// (0 for an invalid handle). Group commit shows up as fewer syncs per
+/// transaction.
+pub export fn fdb_db_sync_count(db: ?*LgDb) u64 {
+    const state = lookupDb(db) orelse return 0;
+    return state.storage.syncCount();
+}
+
+/// Engine statistics as JSON: block and byte counters, fsyncs, CRC
+/// failures, buffer pool hits and misses, a histogram per commit phase
+/// (journal, journal_write, blocks, deletes, block_write, publish), and
+/// scrub progress with the corrupted block IDs found. The counters only
+/// grow from open; sample twice for rates.
+///
+/// @param db Database handle
+/// @param out_stats Output parameter for the JSON blob (free with fdb_blob_free)
+/// @param out_err Output parameter for error blob
+/// @return Status code
+pub export fn fdb_stats(
+    db: ?*LgDb,
+    out_stats: *LgBlob,
+    out_err: *LgBlob,
+) LgStatus {
+    const state = lookupDb(db) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
+        return .err_invalid_argument;
+    };
+
+    var out: std.ArrayList(u8) = .{};
+    defer out.deinit(global_allocator);
+    state.storage.appendStatsJson(global_allocator, &out) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Failed to allocate result");
+        return .err_out_of_memory;
+    };
+    const data = out.toOwnedSlice(global_allocator) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Failed to allocate result");
+        return .err_out_of_memory;
+    };
+
+    out_stats.* = LgBlob.fromSlice(data);
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Verify the checksum of every block in the file now, at full speed,
+/// over the "scrub_workers" threads. Background scrubbing paces the same
+/// check and reports it through fdb_stats; this is the blocking form.
+///
+/// @param db Database handle
+/// @param out_ids Output buffer for corrupted block IDs, ascending (nullable when capacity is 0)
+/// @param capacity Number of IDs out_ids holds
+/// @param out_count Output parameter for the number of corrupted blocks (may exceed capacity)
+/// @param out_err Output parameter for error blob
+/// @return Status code
+pub export fn fdb_verify_checksums(
+    db: ?*LgDb,
+    out_ids: ?[*]u64,
+    capacity: usize,
+    out_count: *usize,
+    out_err: *LgBlob,
+) LgStatus {
+    const state = lookupDb(db) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
+        return .err_invalid_argument;
+    };
+    if (out_ids == null and capacity > 0) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Missing output buffer");
+        return .err_invalid_argument;
+    }
+
+    var findings = scrub.Findings.init(global_allocator);
+    defer findings.deinit();
+    state.scrubber.verifyAll(&findings) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Failed to allocate scrub buffers");
+        return .err_out_of_memory;
+    };
 
+    const ids = findings.ids.items;
+    std.mem.sort(u64, ids, {}, std.sort.asc(u64));
+    const n = @min(ids.len, capacity);
+    if (n > 0) @memcpy(out_ids.?[0..n], ids[0..n]);
+    out_count.* = ids.len;
+    out_err.* = LgBlob.empty();
     return .ok;
 }
 
@@ -266,19 +711,10 @@ pub export fn fdb_txn_begin(
     out_txn: *?*LgTxn,
     out_err: *LgBlob,
 ) LgStatus {
-    // SAFETY: db was originally a *DbState from fdb_db_open, cast to opaque *LgDb.
-    // The orelse guards null. Alignment is safe because DbState was heap-allocated
-    // by global_allocator.create() which respects @alignOf(DbState). The
-    // db_registry.contains() check below validates the pointer is still registered.
-    const state: *DbState = @ptrCast(@alignCast(db orelse {
+    const state = lookupDb(db) orelse {
         out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
         return .err_invalid_argument;
-    }));
-
-    if (!db_registry.contains(state)) {
-        out_err.* = createErrorBlob(.err_invalid_argument, "Database handle not registered");
-        return .err_invalid_argument;
-    }
+    };
 
     // Create transaction state
     const txn = global_allocator.create(TxnState) catch {
@@ -290,22 +726,31 @@ pub export fn fdb_txn_begin(
         .db = state,
         .mode = mode,
         .is_active = true,
-        .sequence = state.storage.superblock.journal_head + 1,
+        .sequence = state.storage.journalHead() + 1,
         .pending_writes = .{},
         .pending_deletes = .{},
+        .arena = std.heap.ArenaAllocator.init(global_allocator),
     };
 
-    txn_registry.put(txn, {}) catch {
+    // Read-only transactions read a consistent view at the last committed
+    // sequence and never wait for the writer
+    if (mode == .read_only) {
+        txn.snapshot = state.storage.beginSnapshot() catch {
+            global_allocator.destroy(txn);
+            out_err.* = createErrorBlob(.err_out_of_memory, "Failed to take snapshot");
+            return .err_out_of_memory;
+        };
+    }
+
+    const handle = txn_handles.insert(txn) catch {
+        txn.releaseSnapshot();
+        txn.arena.deinit();
         global_allocator.destroy(txn);
         out_err.* = createErrorBlob(.err_internal, "Failed to register transaction");
         return .err_internal;
     };
 
-    // SAFETY: txn is a freshly-allocated *TxnState from global_allocator.create()
-    // above, registered in txn_registry. Cast to opaque *LgTxn is safe because
-    // callers only pass it back through C ABI functions that cast it back to
-    // *TxnState after validating the handle exists in txn_registry.
-    out_txn.* = @ptrCast(txn);
+    out_txn.* = toHandle(LgTxn, handle);
     out_err.* = LgBlob.empty();
     return .ok;
 }
@@ -316,74 +761,223 @@ pub export fn fdb_txn_begin(
 /// @param out_err Output parameter for error blob
 /// @return Status code
 pub export fn fdb_txn_commit(txn: ?*LgTxn, out_err: *LgBlob) LgStatus {
-    // SAFETY: txn was originally a *TxnState from fdb_txn_begin, cast to opaque
-    // *LgTxn. The orelse guards null. Alignment is safe because TxnState was
-    // heap-allocated by global_allocator.create(). The txn_registry.contains()
-    // check below validates the pointer is still a live, registered handle.
-    const state: *TxnState = @ptrCast(@alignCast(txn orelse {
+    const state = lookupTxn(txn) orelse {
         out_err.* = createErrorBlob(.err_invalid_argument, "Invalid transaction handle");
         return .err_invalid_argument;
-    }));
+    };
 
-    if (!txn_registry.contains(state)) {
-        out_err.* = createErrorBlob(.err_invalid_argument, "Transaction handle not registered");
-        return .err_invalid_argument;
+    if (!state.is_active) {
+        out_err.* = createErrorBlob(.err_txn_already_committed, "Transaction already committed");
+        return .err_txn_already_committed;
+    }
+
+    // Atomic commit with WAL ordering (see BlockStorage.commit):
+    // journal + blocks + deletes -> sync -> superblock -> sync.
+    // Entries are packed into shared journal segments, and concurrent
+    // commits on the same database are coalesced into one group.
+    var batch = prepareCommit(state) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+
+    // Nothing buffered (e.g. read-only transaction): no I/O needed
+    if (batch.journal.len > 0) {
+        state.db.storage.commit(&batch) catch |err| switch (err) {
+            // Another transaction freed or replaced a block this one deletes
+            error.WrongBlockType => {
+                out_err.* = createErrorBlob(.err_invalid_argument, "Not a document block");
+                return .err_invalid_argument;
+            },
+            else => {
+                out_err.* = createErrorBlob(.err_internal, "Journal or block write failed during commit");
+                return .err_internal;
+            },
+        };
     }
 
+    // Clean up transaction
+    _ = txn_handles.remove(@intFromPtr(txn));
+    finishTxn(state);
+
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Called once when an asynchronous commit completes, on a writer
+/// thread (or, where threads are unavailable, before
+/// fdb_txn_commit_async returns). `err` is owned by the callback: free
+/// it with fdb_blob_free.
+pub const LgCommitCallback = *const fn (
+    ctx: ?*anyopaque,
+    status: LgStatus,
+    err: LgBlob,
+) callconv(.c) void;
+
+/// Commit a transaction without waiting for it to be durable
+///
+/// The transaction is queued for the database's writer threads and the
+/// handle is invalidated at once. Queued transactions are committed in
+/// groups that share their syncs; `callback` then reports each outcome.
+/// A failed transaction is aborted. fdb_db_close waits for every queued
+/// commit to complete first.
+///
+/// @param txn Transaction handle
+/// @param callback Completion callback (called exactly once if queued)
+/// @param ctx Passed through to the callback
+/// @param out_err Output parameter for error blob
+/// @return LG_OK if queued; otherwise the callback is never called
+pub export fn fdb_txn_commit_async(
+    txn: ?*LgTxn,
+    callback: LgCommitCallback,
+    ctx: ?*anyopaque,
+    out_err: *LgBlob,
+) LgStatus {
+    const state = lookupTxn(txn) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid transaction handle");
+        return .err_invalid_argument;
+    };
+
     if (!state.is_active) {
         out_err.* = createErrorBlob(.err_txn_already_committed, "Transaction already committed");
         return .err_txn_already_committed;
     }
 
-    // Atomic commit with WAL ordering:
-    // Phase 1: Write all journal entries (WAL — durable before data)
-    for (state.pending_writes.items) |pw| {
-        _ = state.db.storage.appendJournal(pw.journal_msg) catch {
-            out_err.* = createErrorBlob(.err_internal, "Journal write failed during commit");
-            return .err_internal;
+    const job = state.allocator().create(AsyncCommit) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    job.* = .{ .txn = state, .callback = callback, .ctx = ctx };
+
+    const db = state.db;
+    const pool = blk: {
+        db.async_mutex.lock();
+        defer db.async_mutex.unlock();
+        db.async_queue.append(db.allocator, job) catch {
+            out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+            return .err_out_of_memory;
         };
+        _ = txn_handles.remove(@intFromPtr(txn));
+        break :blk db.writerPoolLocked();
+    };
+
+    // Without writer threads the caller drains the queue itself
+    if (pool) |writers| {
+        writers.spawnWg(&db.async_pending, drainAsyncCommits, .{db});
+    } else {
+        drainAsyncCommits(db);
     }
-    for (state.pending_deletes.items) |block_id| {
-        var del_buf: [80]u8 = undefined;
-        const del_msg = std.fmt.bufPrint(&del_buf, "DELETE block_id={d}", .{block_id}) catch continue;
-        _ = state.db.storage.appendJournal(del_msg) catch {
-            out_err.* = createErrorBlob(.err_internal, "Journal write failed during commit");
-            return .err_internal;
-        };
+
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Writer-pool job: commit queued transactions a group at a time until
+/// the queue is empty
+fn drainAsyncCommits(db: *DbState) void {
+    var jobs: [ASYNC_GROUP_MAX]*AsyncCommit = undefined;
+    var batches: [ASYNC_GROUP_MAX]*blocks.CommitBatch = undefined;
+    while (true) {
+        const n = db.takeAsync(&jobs);
+        if (n == 0) return;
+
+        var n_batches: usize = 0;
+        for (jobs[0..n]) |job| {
+            job.batch = prepareCommit(job.txn) catch continue;
+            job.prepared = true;
+            if (job.batch.journal.len == 0) continue;
+            batches[n_batches] = &job.batch;
+            n_batches += 1;
+        }
+        db.storage.commitAll(batches[0..n_batches]);
+
+        for (jobs[0..n]) |job| {
+            // The job lives in the transaction arena: copy out first
+            const callback = job.callback;
+            const ctx = job.ctx;
+            const status: LgStatus = if (!job.prepared)
+                .err_out_of_memory
+            else if (job.batch.err != null)
+                .err_internal
+            else
+                .ok;
+
+            if (status == .ok) finishTxn(job.txn) else discardTxn(job.txn);
+            const err_blob = switch (status) {
+                .ok => LgBlob.empty(),
+                .err_out_of_memory => createErrorBlob(status, "Out of memory"),
+                else => createErrorBlob(status, "Journal or block write failed during commit"),
+            };
+            callback(ctx, status, err_blob);
+        }
     }
+}
 
-    // Phase 2: Sync journal to disk (WAL guarantee)
-    state.db.storage.file.sync() catch {};
+/// Build the commit batch for a transaction's buffered operations. The
+/// records and scratch come from the transaction arena.
+fn prepareCommit(state: *TxnState) !blocks.CommitBatch {
+    const n_writes = state.pending_writes.items.len;
+    const n_deletes = state.pending_deletes.items.len;
 
-    // Phase 3: Write all data blocks
+    const scratch = state.allocator();
+    var n_records = n_deletes;
     for (state.pending_writes.items) |pw| {
-        var block = blocks.Block.init(.document, pw.block_id, state.sequence);
-        block.setPayload(pw.data) catch continue;
-        state.db.storage.writeBlock(pw.block_id, &block) catch {
-            out_err.* = createErrorBlob(.err_internal, "Block write failed during commit");
-            return .err_internal;
+        if (pw.journal_msg != null) n_records += 1;
+    }
+    const records = try scratch.alloc(blocks.JournalRecord, n_records);
+    const block_writes = try scratch.alloc(blocks.BlockWrite, n_writes);
+    const del_msgs = try scratch.alloc([48]u8, n_deletes);
+
+    var n_write_records: usize = 0;
+    for (state.pending_writes.items, 0..) |pw, i| {
+        if (pw.journal_msg) |msg| {
+            records[n_write_records] = .{
+                .op = pw.journal_op,
+                .affected_block = pw.block_id,
+                .forward = msg,
+            };
+            n_write_records += 1;
+        }
+        block_writes[i] = .{
+            .block_id = pw.block_id,
+            .block_type = .document,
+            .payload = pw.data,
+            .replaces = !pw.is_new,
         };
     }
-
-    // Phase 4: Process deletions
-    for (state.pending_deletes.items) |block_id| {
-        state.db.storage.freeBlock(block_id) catch continue;
+    for (state.pending_deletes.items, 0..) |block_id, i| {
+        const del_msg = std.fmt.bufPrint(&del_msgs[i], "DELETE block_id={d}", .{block_id}) catch unreachable;
+        records[n_write_records + i] = .{
+            .op = .doc_delete,
+            .affected_block = block_id,
+            .forward = del_msg,
+        };
     }
 
-    // Phase 5: Flush superblock (reflects all allocations)
-    state.db.storage.flushSuperblock() catch {};
-
-    // Phase 6: Final sync (all data durable)
-    state.db.storage.file.sync() catch {};
+    return .{
+        .journal = records,
+        .writes = block_writes,
+        .frees = state.pending_deletes.items,
+    };
+}
 
-    // Clean up transaction
+/// Free a committed transaction (already removed from txn_handles)
+fn finishTxn(state: *TxnState) void {
+    state.releaseBlockIds(false);
     state.deinitPending();
+    state.releaseSnapshot();
     state.is_active = false;
-    _ = txn_registry.remove(state);
     global_allocator.destroy(state);
+}
 
-    out_err.* = LgBlob.empty();
-    return .ok;
+/// Free an uncommitted transaction and return its block IDs (already
+/// removed from txn_handles)
+fn discardTxn(state: *TxnState) void {
+    // Discard all buffered operations (nothing was written to disk)
+    state.releaseBlockIds(true);
+    state.deinitPending();
+    state.releaseSnapshot();
+    state.is_active = false;
+    global_allocator.destroy(state);
 }
 
 /// Abort a transaction
@@ -391,24 +985,8 @@ pub export fn fdb_txn_commit(txn: ?*LgTxn, out_err: *LgBlob) LgStatus {
 /// @param txn Transaction handle
 /// @return Status code
 pub export fn fdb_txn_abort(txn: ?*LgTxn) LgStatus {
-    // SAFETY: txn was originally a *TxnState from fdb_txn_begin, cast to opaque
-    // *LgTxn. The orelse guards null. Alignment is safe because TxnState was
-    // heap-allocated by global_allocator.create(). The txn_registry.contains()
-    // check below validates the pointer is still a live, registered handle.
-    const state: *TxnState = @ptrCast(@alignCast(txn orelse return .err_invalid_argument));
-
-    if (!txn_registry.contains(state)) {
-        return .err_invalid_argument;
-    }
-
-    // Discard all buffered operations (nothing was written to disk)
-    state.deinitPending();
-    state.is_active = false;
-
-    // Clean up transaction
-    _ = txn_registry.remove(state);
-    global_allocator.destroy(state);
-
+    const state = txn_handles.remove(@intFromPtr(txn)) orelse return .err_invalid_argument;
+    discardTxn(state);
     return .ok;
 }
 
@@ -428,17 +1006,9 @@ pub export fn fdb_apply(
     op_ptr: [*]const u8,
     op_len: usize,
 ) LgResult {
-    // SAFETY: txn was originally a *TxnState from fdb_txn_begin, cast to opaque
-    // *LgTxn. The orelse guards null. Alignment is safe because TxnState was
-    // heap-allocated by global_allocator.create(). The txn_registry.contains()
-    // check below validates the pointer is still a live, registered handle.
-    const state: *TxnState = @ptrCast(@alignCast(txn orelse {
+    const state = lookupTxn(txn) orelse {
         return LgResult.err(.err_invalid_argument, createErrorBlob(.err_invalid_argument, "Invalid transaction"));
-    }));
-
-    if (!txn_registry.contains(state)) {
-        return LgResult.err(.err_invalid_argument, createErrorBlob(.err_invalid_argument, "Transaction not registered"));
-    }
+    };
 
     if (!state.is_active) {
         return LgResult.err(.err_txn_not_active, createErrorBlob(.err_txn_not_active, "Transaction not active"));
@@ -450,40 +1020,33 @@ pub export fn fdb_apply(
 
     const op_data = op_ptr[0..op_len];
 
-    // Validate payload fits in a block
-    if (op_len > blocks.PAYLOAD_SIZE) {
-        return LgResult.err(.err_invalid_argument, createErrorBlob(.err_invalid_argument, "Payload too large for single block"));
+    // Larger payloads are stored as an overflow chain at commit
+    if (op_len > blocks.MAX_DOCUMENT_SIZE) {
+        return LgResult.err(.err_invalid_argument, createErrorBlob(.err_invalid_argument, "Payload too large"));
     }
 
     // Reserve a block ID (memory only — no disk write yet)
-    const block_id = state.db.storage.reserveBlockId();
+    const block_id = state.nextBlockId();
 
-    // Copy payload data (owned by transaction until commit/abort)
-    const data_copy = global_allocator.dupe(u8, op_data) catch {
+    // Copy payload data and format the journal entry into the transaction
+    // arena (released at commit/abort; a failed call's partial copies go
+    // with it)
+    const arena = state.allocator();
+    const data_copy = arena.dupe(u8, op_data) catch {
         return LgResult.err(.err_out_of_memory, LgBlob.empty());
     };
-
-    // Format journal entry
-    var journal_buf: [100]u8 = undefined;
-    const journal_str = std.fmt.bufPrint(&journal_buf, "INSERT block_id={d} size={d}", .{ block_id, op_len }) catch {
-        global_allocator.free(data_copy);
-        return LgResult.err(.err_internal, createErrorBlob(.err_internal, "Failed to format journal"));
-    };
-
-    const journal_copy = global_allocator.dupe(u8, journal_str) catch {
-        global_allocator.free(data_copy);
+    const journal_copy = std.fmt.allocPrint(arena, "INSERT block_id={d} size={d}", .{ block_id, op_len }) catch {
         return LgResult.err(.err_out_of_memory, LgBlob.empty());
     };
 
     // Buffer the write (deferred until commit)
-    state.pending_writes.append(global_allocator, .{
+    state.pending_writes.append(arena, .{
         .block_id = block_id,
         .data = data_copy,
+        .journal_op = .doc_insert,
         .journal_msg = journal_copy,
         .is_new = true,
     }) catch {
-        global_allocator.free(data_copy);
-        global_allocator.free(journal_copy);
         return LgResult.err(.err_out_of_memory, LgBlob.empty());
     };
 
@@ -502,195 +1065,1824 @@ pub export fn fdb_apply(
     return LgResult.ok(LgBlob.fromSlice(result_data));
 }
 
-/// Update an existing block within a transaction (buffered)
-pub export fn fdb_update_block(
+/// fdb_apply_batch flag: journal the batch as one BULK_INSERT record
+/// instead of one DOC_INSERT per document
+pub const LG_APPLY_BULK_LOAD: u32 = 0x0001;
+
+/// Apply many inserts in one call (buffered like fdb_apply). The batch
+/// gets one contiguous block-ID extent, reserved up front; `out_ids[i]`
+/// receives the ID of `ops[i]`. Every op is validated first, so a rejected
+/// batch leaves the transaction unchanged.
+///
+/// @param txn Transaction handle
+/// @param ops Documents to insert
+/// @param count Number of documents
+/// @param flags 0 or LG_APPLY_BULK_LOAD
+/// @param out_ids Output array of `count` block IDs
+/// @param out_err Output parameter for error blob
+/// @return Status code
+pub export fn fdb_apply_batch(
     txn: ?*LgTxn,
-    block_id: u64,
-    data_ptr: [*]const u8,
-    data_len: usize,
+    ops: [*]const LgBlob,
+    count: usize,
+    flags: u32,
+    out_ids: [*]u64,
     out_err: *LgBlob,
 ) LgStatus {
-    // SAFETY: txn was originally a *TxnState from fdb_txn_begin, cast to opaque
-    // *LgTxn. The orelse guards null. Alignment is safe because TxnState was
-    // heap-allocated by global_allocator.create(). State validity is checked
-    // immediately after via is_active and mode fields.
-    const state: *TxnState = @ptrCast(@alignCast(txn orelse {
+    const state = lookupTxn(txn) orelse {
         out_err.* = createErrorBlob(.err_invalid_argument, "Invalid transaction");
         return .err_invalid_argument;
-    }));
+    };
 
-    if (!state.is_active or state.mode != .read_write) {
-        out_err.* = createErrorBlob(.err_txn_not_active, "Transaction not active or read-only");
+    if (!state.is_active) {
+        out_err.* = createErrorBlob(.err_txn_not_active, "Transaction not active");
         return .err_txn_not_active;
     }
 
-    if (data_len > blocks.PAYLOAD_SIZE) {
-        out_err.* = createErrorBlob(.err_invalid_argument, "Payload too large");
+    if (state.mode != .read_write) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Read-only transaction");
+        return .err_invalid_argument;
+    }
+
+    if (flags & ~LG_APPLY_BULK_LOAD != 0) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Unknown apply flags");
         return .err_invalid_argument;
     }
 
-    const data_copy = global_allocator.dupe(u8, data_ptr[0..data_len]) catch {
+    const docs = ops[0..count];
+    var total_len: usize = 0;
+    for (docs) |op| {
+        if (op.len > blocks.MAX_DOCUMENT_SIZE or (op.ptr == null and op.len != 0)) {
+            out_err.* = createErrorBlob(.err_invalid_argument, "Payload too large or missing");
+            return .err_invalid_argument;
+        }
+        total_len += op.len;
+    }
+    if (count == 0) {
+        out_err.* = LgBlob.empty();
+        return .ok;
+    }
+
+    // One arena block for every payload, and room for every pending write,
+    // before any ID is reserved
+    const arena = state.allocator();
+    const copies = arena.alloc(u8, total_len) catch {
         out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
         return .err_out_of_memory;
     };
-
-    var journal_buf: [100]u8 = undefined;
-    const journal_str = std.fmt.bufPrint(&journal_buf, "UPDATE block_id={d} size={d}", .{ block_id, data_len }) catch {
-        global_allocator.free(data_copy);
-        out_err.* = createErrorBlob(.err_internal, "Failed to format journal");
-        return .err_internal;
-    };
-
-    const journal_copy = global_allocator.dupe(u8, journal_str) catch {
-        global_allocator.free(data_copy);
+    state.pending_writes.ensureUnusedCapacity(arena, count) catch {
         out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
         return .err_out_of_memory;
     };
 
-    state.pending_writes.append(global_allocator, .{
-        .block_id = block_id,
-        .data = data_copy,
-        .journal_msg = journal_copy,
-        .is_new = false,
-    }) catch {
-        global_allocator.free(data_copy);
-        global_allocator.free(journal_copy);
+    // A contiguous extent, so the documents land in sequential blocks and
+    // a bulk record can name them by range
+    const first_id = state.db.storage.reserveBlockIds(count);
+    const bulk = flags & LG_APPLY_BULK_LOAD != 0;
+    const messages = formatBatchMessages(arena, docs, first_id, total_len, bulk) catch {
+        state.db.storage.releaseBlockIds(first_id, count) catch {};
         out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
         return .err_out_of_memory;
     };
 
-    out_err.* = LgBlob.empty();
+    var pos: usize = 0;
+    for (docs, messages, 0..) |op, journal_msg, i| {
+        const data_copy = copies[pos..][0..op.len];
+        if (op.ptr) |ptr| @memcpy(data_copy, ptr[0..op.len]);
+        pos += op.len;
+
+        state.pending_writes.appendAssumeCapacity(.{
+            .block_id = first_id + i,
+            .data = data_copy,
+            .journal_op = if (bulk) .bulk_insert else .doc_insert,
+            .journal_msg = journal_msg,
+            .is_new = true,
+        });
+        out_ids[i] = first_id + i;
+    }
+
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Journal text for each document of a batch: one INSERT per document,
+/// or a single BULK_INSERT on the first covering the whole extent
+fn formatBatchMessages(
+    arena: std.mem.Allocator,
+    docs: []const LgBlob,
+    first_id: u64,
+    total_len: usize,
+    bulk: bool,
+) ![]?[]u8 {
+    const messages = try arena.alloc(?[]u8, docs.len);
+    if (bulk) {
+        @memset(messages, null);
+        messages[0] = try std.fmt.allocPrint(arena, "BULK_INSERT first_block={d} count={d} size={d}", .{
+            first_id,
+            docs.len,
+            total_len,
+        });
+        return messages;
+    }
+    for (docs, messages, 0..) |op, *msg, i| {
+        msg.* = try std.fmt.allocPrint(arena, "INSERT block_id={d} size={d}", .{ first_id + i, op.len });
+    }
+    return messages;
+}
+
+/// Update an existing document block within a transaction (buffered).
+/// Any other block ID is INVALID_ARGUMENT.
+pub export fn fdb_update_block(
+    txn: ?*LgTxn,
+    block_id: u64,
+    data_ptr: [*]const u8,
+    data_len: usize,
+    out_err: *LgBlob,
+) LgStatus {
+    const state = lookupTxn(txn) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid transaction");
+        return .err_invalid_argument;
+    };
+
+    if (!state.is_active or state.mode != .read_write) {
+        out_err.* = createErrorBlob(.err_txn_not_active, "Transaction not active or read-only");
+        return .err_txn_not_active;
+    }
+
+    if (data_len > blocks.MAX_DOCUMENT_SIZE) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Payload too large");
+        return .err_invalid_argument;
+    }
+
+    // The superblock, map pages, journal segments, free blocks and IDs
+    // still only reserved are never documents to replace
+    if (!state.db.storage.isDocument(block_id)) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Not a document block");
+        return .err_invalid_argument;
+    }
+
+    const arena = state.allocator();
+    const data_copy = arena.dupe(u8, data_ptr[0..data_len]) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    const journal_copy = std.fmt.allocPrint(arena, "UPDATE block_id={d} size={d}", .{ block_id, data_len }) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+
+    state.pending_writes.append(arena, .{
+        .block_id = block_id,
+        .data = data_copy,
+        .journal_op = .doc_update,
+        .journal_msg = journal_copy,
+        .is_new = false,
+    }) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Delete a document block within a transaction (buffered). Any other
+/// block ID is INVALID_ARGUMENT, as for fdb_update_block.
+pub export fn fdb_delete_block(
+    txn: ?*LgTxn,
+    block_id: u64,
+    out_err: *LgBlob,
+) LgStatus {
+    const state = lookupTxn(txn) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid transaction");
+        return .err_invalid_argument;
+    };
+
+    if (!state.is_active or state.mode != .read_write) {
+        out_err.* = createErrorBlob(.err_txn_not_active, "Transaction not active or read-only");
+        return .err_txn_not_active;
+    }
+
+    // Freeing a map page, journal segment, index node or overflow block
+    // would corrupt the file
+    if (!state.db.storage.isDocument(block_id)) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Not a document block");
+        return .err_invalid_argument;
+    }
+
+    state.pending_deletes.append(state.allocator(), block_id) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Read all blocks of a given type (full scan for PoC)
+/// Returns JSON array of objects with block_id and data fields.
+pub export fn fdb_read_blocks(
+    db: ?*LgDb,
+    block_type: u16,
+    out_data: *LgBlob,
+    out_err: *LgBlob,
+) LgStatus {
+    return fdb_read_blocks_format(db, block_type, json_opts, out_data, out_err);
+}
+
+/// Read all blocks of a given type in the format `opts` selects: a JSON
+/// array as fdb_read_blocks returns, or a CBOR array of maps whose "data"
+/// is a byte string.
+pub export fn fdb_read_blocks_format(
+    db: ?*LgDb,
+    block_type: u16,
+    opts: LgRenderOpts,
+    out_data: *LgBlob,
+    out_err: *LgBlob,
+) LgStatus {
+    const state = lookupDb(db) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
+        return .err_invalid_argument;
+    };
+
+    return scanBlocks(state, null, block_type, opts, out_data, out_err);
+}
+
+/// Read all blocks of a given type as seen by a transaction. Read-only
+/// transactions see the snapshot taken at fdb_txn_begin, unaffected by
+/// concurrent commits; read-write transactions see the latest commit.
+pub export fn fdb_txn_read_blocks(
+    txn: ?*LgTxn,
+    block_type: u16,
+    out_data: *LgBlob,
+    out_err: *LgBlob,
+) LgStatus {
+    return fdb_txn_read_blocks_format(txn, block_type, json_opts, out_data, out_err);
+}
+
+/// fdb_read_blocks_format within a transaction, with the visibility rules
+/// of fdb_txn_read_blocks
+pub export fn fdb_txn_read_blocks_format(
+    txn: ?*LgTxn,
+    block_type: u16,
+    opts: LgRenderOpts,
+    out_data: *LgBlob,
+    out_err: *LgBlob,
+) LgStatus {
+    const state = lookupTxn(txn) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid transaction handle");
+        return .err_invalid_argument;
+    };
+
+    if (!state.is_active) {
+        out_err.* = createErrorBlob(.err_txn_not_active, "Transaction not active");
+        return .err_txn_not_active;
+    }
+
+    return scanBlocks(state.db, state.snapshot, block_type, opts, out_data, out_err);
+}
+
+/// Open a cursor over the live blocks of one type, with rows in the
+/// format `opts` selects. The cursor reads from its own snapshot, so rows
+/// stay consistent while it is drained with fdb_cursor_next; close it with
+/// fdb_cursor_close.
+pub export fn fdb_cursor_open_blocks(
+    db: ?*LgDb,
+    block_type: u16,
+    opts: LgRenderOpts,
+    out_cursor: *?*LgCursor,
+    out_err: *LgBlob,
+) LgStatus {
+    out_cursor.* = null;
+
+    const state = lookupDb(db) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
+        return .err_invalid_argument;
+    };
+
+    const format = renderFormat(opts) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Unknown render format");
+        return .err_invalid_argument;
+    };
+
+    const open_cursor = global_allocator.create(CursorState) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    open_cursor.* = .{
+        .db = state,
+        .scan = cursors.BlockCursor.open(global_allocator, state.storage, block_type, format) catch {
+            global_allocator.destroy(open_cursor);
+            out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+            return .err_out_of_memory;
+        },
+    };
+
+    const handle = cursor_handles.insert(open_cursor) catch {
+        open_cursor.close();
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+
+    out_cursor.* = toHandle(LgCursor, handle);
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Fill `buf` with the next batch of rows: newline-terminated JSON objects
+/// as in fdb_read_blocks, or back-to-back CBOR maps. Returns err_not_found with *written = 0
+/// once the scan is exhausted. If the next row alone exceeds `buf_len`,
+/// returns err_invalid_argument with *written set to the size it needs.
+pub export fn fdb_cursor_next(
+    cursor: ?*LgCursor,
+    buf: [*]u8,
+    buf_len: usize,
+    written: *usize,
+) LgStatus {
+    written.* = 0;
+
+    const state = lookupCursor(cursor) orelse return .err_invalid_argument;
+
+    const n = state.scan.fill(buf[0..buf_len]) catch |err| switch (err) {
+        error.BufferTooSmall => {
+            written.* = state.scan.pendingRowLen();
+            return .err_invalid_argument;
+        },
+        error.OutOfMemory => return .err_out_of_memory,
+        else => return .err_internal,
+    };
+    if (n == 0) return .err_not_found;
+
+    written.* = n;
+    return .ok;
+}
+
+/// Close a cursor and release its snapshot
+pub export fn fdb_cursor_close(cursor: ?*LgCursor) void {
+    const state = cursor_handles.remove(@intFromPtr(cursor)) orelse return;
+    state.close();
+}
+
+// ============================================================
+// Queries - C ABI Exports
+// ============================================================
+
+/// A cursor over the documents `plan` selects, with its predicates and
+/// projection applied inside the scan (takes its own plan reference)
+fn openQueryCursor(db: *DbState, plan: *query.Plan) !*CursorState {
+    const exec = try global_allocator.create(query.Execution);
+    exec.* = query.Execution.init(global_allocator, plan);
+    errdefer {
+        exec.deinit();
+        global_allocator.destroy(exec);
+    }
+
+    const open_cursor = try global_allocator.create(CursorState);
+    errdefer global_allocator.destroy(open_cursor);
+    open_cursor.* = .{
+        .db = db,
+        .scan = try cursors.BlockCursor.open(global_allocator, db.storage, @intFromEnum(blocks.BlockType.document), .json),
+    };
+    errdefer open_cursor.scan.close();
+
+    if (plan.isEmpty()) {
+        try open_cursor.scan.restrictTo(&.{});
+    } else switch (plan.access) {
+        .type_scan => {},
+        .block_ids => |ids| try open_cursor.scan.restrictTo(ids),
+    }
+    open_cursor.scan.filter = exec.filter();
+    open_cursor.exec = exec;
+    return open_cursor;
+}
+
+/// Run a query and return its rows through a cursor, drained with
+/// fdb_cursor_next and closed with fdb_cursor_close
+///
+/// Rows are the JSON rows of fdb_cursor_next with `data` holding the
+/// document or the selected fields. Plans are compiled once per
+/// normalized query text and cached on the database. Reads are not
+/// journaled, so `provenance` is accepted for callers of the planned
+/// signature but not recorded.
+///
+/// @param db Database handle
+/// @param query_ptr Query text
+/// @param query_len Length of query
+/// @param prov_ptr Provenance JSON (nullable)
+/// @param prov_len Length of provenance
+/// @param out_cursor Output parameter for cursor handle
+/// @return Status code (err_invalid_argument for an invalid query)
+pub export fn fdb_query_execute(
+    db: ?*LgDb,
+    query_ptr: [*]const u8,
+    query_len: usize,
+    prov_ptr: ?[*]const u8,
+    prov_len: usize,
+    out_cursor: *?*LgCursor,
+) LgStatus {
+    _ = prov_ptr;
+    _ = prov_len;
+    out_cursor.* = null;
+
+    const state = lookupDb(db) orelse return .err_invalid_argument;
+
+    var cached = false;
+    const plan = state.plans.acquire(query_ptr[0..query_len], &cached) catch |err| switch (err) {
+        error.InvalidQuery => return .err_invalid_argument,
+        error.OutOfMemory => return .err_out_of_memory,
+    };
+    defer plan.release();
+
+    const open_cursor = openQueryCursor(state, plan) catch return .err_out_of_memory;
+    const handle = cursor_handles.insert(open_cursor) catch {
+        open_cursor.close();
+        return .err_out_of_memory;
+    };
+
+    out_cursor.* = toHandle(LgCursor, handle);
+    return .ok;
+}
+
+/// Plan and run a query, writing the plan, the blocks the planner
+/// expected to read and the blocks the scan actually read as JSON
+///
+/// @param db Database handle
+/// @param query_ptr Query text
+/// @param query_len Length of query
+/// @param buf Output buffer
+/// @param buf_len Capacity of buf
+/// @param written Bytes written; if the document does not fit, the size
+///        needed and INVALID_ARGUMENT
+/// @return Status code
+pub export fn fdb_query_explain(
+    db: ?*LgDb,
+    query_ptr: [*]const u8,
+    query_len: usize,
+    buf: [*]u8,
+    buf_len: usize,
+    written: *usize,
+) LgStatus {
+    written.* = 0;
+
+    const state = lookupDb(db) orelse return .err_invalid_argument;
+
+    var cached = false;
+    const plan = state.plans.acquire(query_ptr[0..query_len], &cached) catch |err| switch (err) {
+        error.InvalidQuery => return .err_invalid_argument,
+        error.OutOfMemory => return .err_out_of_memory,
+    };
+    defer plan.release();
+
+    const estimated = query.estimateBlocks(plan, state.storage.countOfType(@intFromEnum(blocks.BlockType.document)));
+
+    const open_cursor = openQueryCursor(state, plan) catch return .err_out_of_memory;
+    defer open_cursor.close();
+
+    // Drain the scan; rows are counted, not kept
+    var rows_buf: [4096]u8 = undefined;
+    var rows: []u8 = &rows_buf;
+    var grown: std.ArrayList(u8) = .{};
+    defer grown.deinit(global_allocator);
+    while (true) {
+        const n = open_cursor.scan.fill(rows) catch |err| switch (err) {
+            error.BufferTooSmall => {
+                grown.resize(global_allocator, open_cursor.scan.pendingRowLen()) catch return .err_out_of_memory;
+                rows = grown.items;
+                continue;
+            },
+            error.OutOfMemory => return .err_out_of_memory,
+            else => return .err_internal,
+        };
+        if (n == 0) break;
+    }
+
+    const exec = open_cursor.exec.?;
+    var out: std.ArrayList(u8) = .{};
+    defer out.deinit(global_allocator);
+    query.appendExplainJson(global_allocator, &out, plan, .{
+        .cached = cached,
+        .estimated_blocks = estimated,
+        .actual_blocks = open_cursor.scan.blocks_touched,
+        .examined = exec.examined,
+        .prefiltered = exec.prefiltered,
+        .rows = exec.rows,
+    }) catch return .err_out_of_memory;
+
+    if (out.items.len > buf_len) {
+        written.* = out.items.len;
+        return .err_invalid_argument;
+    }
+    @memcpy(buf[0..out.items.len], out.items);
+    written.* = out.items.len;
+    return .ok;
+}
+
+/// Export one collection's documents as typed column batches (layout in
+/// columnar.zig), read from a snapshot. With `since_seq` 0 every document
+/// is exported; otherwise only blocks the journal records as written
+/// after `since_seq`, with those no longer in the collection listed under
+/// "deleted". Pass the batch's "sequence" as the next `since_seq`.
+///
+/// @param db Database handle
+/// @param collection_ptr Collection name, matched against "collection"
+/// @param collection_len Length of the name
+/// @param fields_ptr Comma-separated member paths, e.g. "title,meta.lang"
+/// @param fields_len Length of the field list
+/// @param since_seq Journal sequence the client is up to date with
+/// @param out_batch CBOR batch blob
+/// @param out_err Error blob; NOT_FOUND when the journal no longer
+///        reaches back to since_seq and a full export is needed
+/// @return Status code
+pub export fn fdb_export_columnar(
+    db: ?*LgDb,
+    collection_ptr: [*]const u8,
+    collection_len: usize,
+    fields_ptr: [*]const u8,
+    fields_len: usize,
+    since_seq: u64,
+    out_batch: *LgBlob,
+    out_err: *LgBlob,
+) LgStatus {
+    out_batch.* = LgBlob.empty();
+
+    const state = lookupDb(db) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
+        return .err_invalid_argument;
+    };
+    const storage = state.storage;
+
+    const fields = columnar.parseFields(global_allocator, fields_ptr[0..fields_len]) catch |err| switch (err) {
+        error.InvalidFields => {
+            out_err.* = createErrorBlob(.err_invalid_argument, "Fields must be distinct, comma-separated member paths");
+            return .err_invalid_argument;
+        },
+        error.OutOfMemory => {
+            out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+            return .err_out_of_memory;
+        },
+    };
+    defer global_allocator.free(fields);
+
+    var batch = columnar.Batch.init(global_allocator, collection_ptr[0..collection_len], fields) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    defer batch.deinit();
+
+    const snap = storage.beginSnapshot() catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    defer storage.endSnapshot(snap);
+
+    if (since_seq > snap.sequence) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "since_seq is ahead of the journal");
+        return .err_invalid_argument;
+    }
+
+    var ids: std.ArrayList(u64) = .{};
+    defer ids.deinit(global_allocator);
+    listExported(storage, snap, since_seq, &ids) catch |err| {
+        out_err.* = switch (err) {
+            error.OutOfMemory => createErrorBlob(.err_out_of_memory, "Out of memory"),
+            error.JournalGap => createErrorBlob(.err_not_found, "Journal no longer reaches since_seq; export in full"),
+            else => createErrorBlob(.err_internal, "Failed to read the journal"),
+        };
+        return switch (err) {
+            error.OutOfMemory => .err_out_of_memory,
+            error.JournalGap => .err_not_found,
+            else => .err_internal,
+        };
+    };
+
+    storage.adviseSequential(since_seq == 0);
+    defer storage.adviseSequential(false);
+
+    var doc: std.ArrayList(u8) = .{};
+    defer doc.deinit(global_allocator);
+    var scratch: blocks.Block = undefined;
+    for (ids.items) |block_id| {
+        const kept = exportBlock(storage, snap, &batch, block_id, &doc, &scratch) catch |err| {
+            out_err.* = switch (err) {
+                error.OutOfMemory => createErrorBlob(.err_out_of_memory, "Out of memory"),
+                else => createErrorBlob(.err_invalid_argument, "Column too large for int32 offsets"),
+            };
+            return if (err == error.OutOfMemory) .err_out_of_memory else .err_invalid_argument;
+        };
+        if (!kept and since_seq != 0) batch.addDeleted(block_id) catch {
+            out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+            return .err_out_of_memory;
+        };
+    }
+
+    var out = cbor.Encoder.init(global_allocator);
+    defer out.deinit();
+    batch.encode(since_seq, snap.sequence, &out) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    const data = out.buffer.toOwnedSlice(global_allocator) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    out_batch.* = LgBlob.fromSlice(data);
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Every document block at `snap`, or those written since `since_seq`
+fn listExported(storage: *blocks.BlockStorage, snap: blocks.Snapshot, since_seq: u64, ids: *std.ArrayList(u64)) !void {
+    if (since_seq != 0) return blocksWrittenSince(storage, since_seq, snap.sequence, ids);
+    _ = try storage.blocksOfType(global_allocator, @intFromEnum(blocks.BlockType.document), snap, 1, std.math.maxInt(usize), ids);
+}
+
+/// Add `block_id` to the batch if, at `snap`, it is a live document in the
+/// batch's collection; false otherwise. Unreadable blocks count as gone.
+fn exportBlock(
+    storage: *blocks.BlockStorage,
+    snap: blocks.Snapshot,
+    batch: *columnar.Batch,
+    block_id: u64,
+    doc: *std.ArrayList(u8),
+    scratch: *blocks.Block,
+) !bool {
+    const block = storage.pinBlockAt(block_id, snap, scratch) catch return false;
+    defer storage.unpinBlock(block);
+
+    if (!blocks.isLiveDocument(block)) return false;
+
+    const data = storage.readChain(global_allocator, block, snap, doc) catch |err| switch (err) {
+        error.OutOfMemory => return err,
+        else => return false,
+    };
+    return batch.addDocument(block_id, block.header.sequence, data);
+}
+
+/// Sorted, distinct IDs of the blocks journal entries in (since, until]
+/// inserted, updated or deleted. error.JournalGap when the journal no
+/// longer holds all of them.
+fn blocksWrittenSince(storage: *blocks.BlockStorage, since: u64, until: u64, out: *std.ArrayList(u64)) !void {
+    var reader = try journal.JournalReader.open(global_allocator, storage, since + 1);
+    defer reader.close();
+
+    while (try reader.next()) |entry| {
+        if (entry.header.sequence > until) break;
+        switch (@as(blocks.JournalOp, @enumFromInt(entry.header.op_type))) {
+            .doc_insert, .doc_update, .doc_delete => try out.append(global_allocator, entry.header.affected_block),
+            .bulk_insert => {
+                const first = entry.header.affected_block;
+                for (0..replication.bulkCount(entry.forward)) |i| try out.append(global_allocator, first + i);
+            },
+            else => {},
+        }
+    }
+    if (reader.next_sequence <= until) return error.JournalGap;
+
+    std.mem.sort(u64, out.items, {}, std.sort.asc(u64));
+    var kept: usize = 0;
+    for (out.items) |id| {
+        if (kept > 0 and out.items[kept - 1] == id) continue;
+        out.items[kept] = id;
+        kept += 1;
+    }
+    out.shrinkRetainingCapacity(kept);
+}
+
+// ============================================================
+// Replication - C ABI Exports
+// ============================================================
+
+/// fdb_replication_read flag: LZ4-compress the shipment body
+pub const LG_SHIP_LZ4: u32 = replication.SHIP_LZ4;
+
+/// Read a journal shipment for a follower (format in replication.zig):
+/// the raw journal entries from `from_seq` on, and the current image of
+/// every document they insert or update. Entries are added until the
+/// shipment holds about `max_bytes`, so at least one is shipped when any
+/// exist; an empty shipment means the follower is up to date. Images are
+/// read at the time of the call, and a shipment may end inside a leader
+/// transaction.
+///
+/// @param db Database handle
+/// @param from_seq First sequence wanted: the follower's watermark + 1
+/// @param max_bytes Uncompressed size to stop adding entries at; 0 for 16 MiB
+/// @param flags 0 or LG_SHIP_LZ4
+/// @param out_shipment Shipment blob
+/// @param out_err Error blob; NOT_FOUND when the journal no longer
+///        reaches back to from_seq
+/// @return Status code
+pub export fn fdb_replication_read(
+    db: ?*LgDb,
+    from_seq: u64,
+    max_bytes: usize,
+    flags: u32,
+    out_shipment: *LgBlob,
+    out_err: *LgBlob,
+) LgStatus {
+    out_shipment.* = LgBlob.empty();
+
+    const state = lookupDb(db) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
+        return .err_invalid_argument;
+    };
+    const storage = state.storage;
+
+    if (flags & ~LG_SHIP_LZ4 != 0) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Unknown shipment flags");
+        return .err_invalid_argument;
+    }
+    if (from_seq == 0) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "from_seq starts at 1");
+        return .err_invalid_argument;
+    }
+
+    const snap = storage.beginSnapshot() catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    defer storage.endSnapshot(snap);
+
+    if (from_seq > snap.sequence + 1) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "from_seq is ahead of the journal");
+        return .err_invalid_argument;
+    }
+
+    var builder = replication.Builder.init(global_allocator, from_seq);
+    defer builder.deinit();
+    const limit = if (max_bytes == 0) replication.DEFAULT_SHIPMENT_BYTES else max_bytes;
+    fillShipment(storage, snap, &builder, limit) catch |err| {
+        out_err.* = switch (err) {
+            error.OutOfMemory => createErrorBlob(.err_out_of_memory, "Out of memory"),
+            error.JournalGap => createErrorBlob(.err_not_found, "Journal no longer reaches from_seq"),
+            error.ShipmentTooLarge => createErrorBlob(.err_invalid_argument, "Entry and its documents exceed the shipment size limit"),
+            else => createErrorBlob(.err_internal, "Failed to read the journal or a document"),
+        };
+        return switch (err) {
+            error.OutOfMemory => .err_out_of_memory,
+            error.JournalGap => .err_not_found,
+            error.ShipmentTooLarge => .err_invalid_argument,
+            else => .err_internal,
+        };
+    };
+
+    var out: std.ArrayList(u8) = .{};
+    defer out.deinit(global_allocator);
+    builder.finish(@intCast(flags), &out) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    const data = out.toOwnedSlice(global_allocator) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    out_shipment.* = LgBlob.fromSlice(data);
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Add entries from the builder's first sequence up to `snap`, and each
+/// document they write once, until the shipment reaches `max_bytes`
+fn fillShipment(storage: *blocks.BlockStorage, snap: blocks.Snapshot, builder: *replication.Builder, max_bytes: usize) !void {
+    var reader = try journal.JournalReader.open(global_allocator, storage, builder.first_sequence);
+    defer reader.close();
+
+    var shipped: std.AutoHashMapUnmanaged(u64, void) = .{};
+    defer shipped.deinit(global_allocator);
+    var doc: std.ArrayList(u8) = .{};
+    defer doc.deinit(global_allocator);
+    var scratch: blocks.Block = undefined;
+
+    while (builder.rawLen() < max_bytes) {
+        const entry = try reader.next() orelse {
+            if (reader.next_sequence <= snap.sequence) return error.JournalGap;
+            break;
+        };
+        if (entry.header.sequence > snap.sequence) break;
+        try builder.addEntry(entry);
+
+        const first = entry.header.affected_block;
+        const count: u64 = switch (@as(blocks.JournalOp, @enumFromInt(entry.header.op_type))) {
+            .doc_insert, .doc_update => 1,
+            .bulk_insert => replication.bulkCount(entry.forward),
+            else => 0,
+        };
+        for (0..count) |i| {
+            const origin = first + i;
+            if ((try shipped.getOrPut(global_allocator, origin)).found_existing) continue;
+            try shipDocument(storage, snap, builder, origin, &doc, &scratch);
+        }
+    }
+}
+
+/// Add the image of `origin` if it is a live document at `snap`
+fn shipDocument(
+    storage: *blocks.BlockStorage,
+    snap: blocks.Snapshot,
+    builder: *replication.Builder,
+    origin: u64,
+    doc: *std.ArrayList(u8),
+    scratch: *blocks.Block,
+) !void {
+    const block = storage.pinBlockAt(origin, snap, scratch) catch |err| switch (err) {
+        error.BlockNotVisible => return,
+        else => return err,
+    };
+    defer storage.unpinBlock(block);
+
+    if (!blocks.isLiveDocument(block)) return;
+
+    try builder.addDocument(origin, try storage.readChain(global_allocator, block, snap, doc));
+}
+
+/// Apply a shipment from fdb_replication_read as one commit group. It
+/// must start right after the follower's watermark; one already applied
+/// is accepted and changes nothing. Replicated documents get the
+/// follower's own block IDs, and their journal records name the leader
+/// block ("origin=N").
+///
+/// @param db Follower database handle
+/// @param shipment_ptr Shipment bytes
+/// @param shipment_len Length of the shipment
+/// @param out_watermark Output: last leader sequence applied
+/// @param out_err Error blob; CONFLICT when the shipment does not follow
+///        the watermark (read again from *out_watermark + 1)
+/// @return Status code
+pub export fn fdb_replication_apply(
+    db: ?*LgDb,
+    shipment_ptr: [*]const u8,
+    shipment_len: usize,
+    out_watermark: *u64,
+    out_err: *LgBlob,
+) LgStatus {
+    const state = lookupDb(db) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
+        return .err_invalid_argument;
+    };
+    const replica = &state.replica;
+    replica.mutex.lock();
+    defer replica.mutex.unlock();
+
+    replica.loadLocked(state.storage) catch |err| {
+        out_err.* = if (err == error.OutOfMemory) createErrorBlob(.err_out_of_memory, "Out of memory") else createErrorBlob(.err_internal, "Failed to read the journal");
+        return if (err == error.OutOfMemory) .err_out_of_memory else .err_internal;
+    };
+    out_watermark.* = replica.watermark;
+
+    var arena = std.heap.ArenaAllocator.init(global_allocator);
+    defer arena.deinit();
+    const scratch = arena.allocator();
+
+    var raw: std.ArrayList(u8) = .{};
+    const shipment = replication.Shipment.parse(scratch, shipment_ptr[0..shipment_len], &raw) catch |err| {
+        out_err.* = if (err == error.OutOfMemory) createErrorBlob(.err_out_of_memory, "Out of memory") else createErrorBlob(.err_invalid_argument, "Corrupt or unsupported shipment");
+        return if (err == error.OutOfMemory) .err_out_of_memory else .err_invalid_argument;
+    };
+    const header = shipment.header;
+
+    if (header.last_sequence <= replica.watermark) {
+        out_err.* = LgBlob.empty();
+        return .ok;
+    }
+    if (header.first_sequence != replica.watermark + 1) {
+        out_err.* = createErrorBlob(.err_conflict, "Shipment does not follow the replica watermark");
+        return .err_conflict;
+    }
+
+    const changes = replication.netChanges(scratch, &shipment) catch |err| {
+        out_err.* = if (err == error.OutOfMemory) createErrorBlob(.err_out_of_memory, "Out of memory") else createErrorBlob(.err_invalid_argument, "Corrupt shipment entries");
+        return if (err == error.OutOfMemory) .err_out_of_memory else .err_invalid_argument;
+    };
+
+    var commit = prepareReplicaCommit(state.storage, replica, scratch, changes, header.last_sequence) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    state.storage.commit(&commit.batch) catch {
+        if (commit.inserts > 0) state.storage.releaseBlockIds(commit.first_insert, commit.inserts) catch {};
+        out_err.* = createErrorBlob(.err_internal, "Journal or block write failed during commit");
+        return .err_internal;
+    };
+
+    // Capacity for the inserts was reserved before the commit
+    for (changes, commit.locals) |change, local| {
+        if (local == 0) continue;
+        if (change.deleted) {
+            _ = replica.origins.remove(change.origin);
+        } else {
+            replica.origins.putAssumeCapacity(change.origin, local);
+        }
+    }
+    replica.watermark = header.last_sequence;
+
+    out_watermark.* = replica.watermark;
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Last leader sequence applied by fdb_replication_apply; 0 for a
+/// database that has never been a follower
+///
+/// @param db Database handle
+/// @param out_watermark Output: the watermark
+/// @param out_err Output parameter for error blob
+/// @return Status code
+pub export fn fdb_replication_watermark(db: ?*LgDb, out_watermark: *u64, out_err: *LgBlob) LgStatus {
+    const state = lookupDb(db) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
+        return .err_invalid_argument;
+    };
+    const replica = &state.replica;
+    replica.mutex.lock();
+    defer replica.mutex.unlock();
+
+    replica.loadLocked(state.storage) catch |err| {
+        out_err.* = if (err == error.OutOfMemory) createErrorBlob(.err_out_of_memory, "Out of memory") else createErrorBlob(.err_internal, "Failed to read the journal");
+        return if (err == error.OutOfMemory) .err_out_of_memory else .err_internal;
+    };
+    out_watermark.* = replica.watermark;
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// A shipment's changes as a local commit batch. `locals[i]` is the
+/// local block changes[i] wrote or freed, 0 when it touched nothing.
+const ReplicaCommit = struct {
+    batch: blocks.CommitBatch,
+    locals: []u64,
+    first_insert: u64,
+    inserts: u64,
+};
+
+fn prepareReplicaCommit(
+    storage: *blocks.BlockStorage,
+    replica: *replication.ReplicaMap,
+    arena: std.mem.Allocator,
+    changes: []const replication.Change,
+    through: u64,
+) !ReplicaCommit {
+    var n_writes: usize = 0;
+    var n_frees: usize = 0;
+    var n_inserts: u64 = 0;
+    for (changes) |change| {
+        const mapped = replica.origins.contains(change.origin);
+        if (change.deleted) {
+            if (mapped) n_frees += 1;
+        } else if (change.data != null) {
+            n_writes += 1;
+            if (!mapped) n_inserts += 1;
+        }
+    }
+
+    const records = try arena.alloc(blocks.JournalRecord, n_writes + n_frees + 1);
+    const writes = try arena.alloc(blocks.BlockWrite, n_writes);
+    const frees = try arena.alloc(u64, n_frees);
+    const locals = try arena.alloc(u64, changes.len);
+    try replica.origins.ensureUnusedCapacity(replica.allocator, @intCast(n_inserts));
+
+    // Inserts share one extent, handed back if formatting a record fails
+    const first_insert = if (n_inserts > 0) storage.reserveBlockIds(n_inserts) else 0;
+    errdefer if (n_inserts > 0) storage.releaseBlockIds(first_insert, n_inserts) catch {};
+
+    var next_insert = first_insert;
+    var n_records: usize = 0;
+    var w: usize = 0;
+    var f: usize = 0;
+    for (changes, locals) |change, *local| {
+        local.* = 0;
+        const mapped = replica.origins.get(change.origin);
+        if (change.deleted) {
+            const block_id = mapped orelse continue;
+            frees[f] = block_id;
+            f += 1;
+            records[n_records] = .{
+                .op = .doc_delete,
+                .affected_block = block_id,
+                .forward = try std.fmt.allocPrint(arena, "DELETE block_id={d} origin={d}", .{ block_id, change.origin }),
+            };
+            n_records += 1;
+            local.* = block_id;
+            continue;
+        }
+
+        const data = change.data orelse continue;
+        const block_id = mapped orelse blk: {
+            next_insert += 1;
+            break :blk next_insert - 1;
+        };
+        writes[w] = .{
+            .block_id = block_id,
+            .block_type = .document,
+            .payload = data,
+            .replaces = mapped != null,
+        };
+        w += 1;
+        records[n_records] = .{
+            .op = if (mapped != null) .doc_update else .doc_insert,
+            .affected_block = block_id,
+            .forward = try std.fmt.allocPrint(arena, "{s} block_id={d} size={d} origin={d}", .{
+                if (mapped != null) "UPDATE" else "INSERT",
+                block_id,
+                data.len,
+                change.origin,
+            }),
+        };
+        n_records += 1;
+        local.* = block_id;
+    }
+
+    records[n_records] = .{
+        .op = .replica_mark,
+        .affected_block = 0,
+        .forward = try std.fmt.allocPrint(arena, "REPLICA through={d}", .{through}),
+    };
+
+    return .{
+        .batch = .{ .journal = records, .writes = writes, .frees = frees },
+        .locals = locals,
+        .first_insert = first_insert,
+        .inserts = n_inserts,
+    };
+}
+
+// ============================================================
+// Spatial Index - C ABI Exports
+// ============================================================
+
+/// Bring the persistent R-tree over `field` of `collection`'s documents
+/// up to the current journal sequence (layout in spatial.zig). The first
+/// sync packs every document; later ones repack from the old tree's
+/// leaves and only the documents the journal records as written since,
+/// so an index is never rebuilt by reparsing the whole collection. The
+/// new tree, its meta block and the freeing of the old tree commit
+/// together; readers on older snapshots keep the tree they started on.
+///
+/// @param db Database handle
+/// @param collection_ptr Collection name, matched against "collection"
+/// @param collection_len Length of the name
+/// @param field_ptr Location member path, e.g. "location" or "site.at"
+/// @param field_len Length of the path
+/// @param out_entries Output: documents in the index
+/// @param out_err Output parameter for error blob
+/// @return Status code
+pub export fn fdb_spatial_sync(
+    db: ?*LgDb,
+    collection_ptr: [*]const u8,
+    collection_len: usize,
+    field_ptr: [*]const u8,
+    field_len: usize,
+    out_entries: *u64,
+    out_err: *LgBlob,
+) LgStatus {
+    out_entries.* = 0;
+
+    const state = lookupDb(db) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
+        return .err_invalid_argument;
+    };
+    const storage = state.storage;
+    const collection = collection_ptr[0..collection_len];
+    const field = field_ptr[0..field_len];
+    if (field.len == 0 or collection.len + field.len > spatial.MAX_NAME_LEN) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Field must be non-empty and fit a meta block with the collection name");
+        return .err_invalid_argument;
+    }
+
+    // One sync at a time frees each old tree exactly once
+    state.spatial_mutex.lock();
+    defer state.spatial_mutex.unlock();
+
+    const snap = storage.beginSnapshot() catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    defer storage.endSnapshot(snap);
+
+    var arena = std.heap.ArenaAllocator.init(global_allocator);
+    defer arena.deinit();
+
+    var prepared = prepareSpatialCommit(storage, snap, arena.allocator(), collection, field) catch |err| {
+        out_err.* = switch (err) {
+            error.OutOfMemory => createErrorBlob(.err_out_of_memory, "Out of memory"),
+            error.InvalidSpatialNode => createErrorBlob(.err_internal, "Spatial index node is corrupt"),
+            else => createErrorBlob(.err_internal, "Failed to read documents or the journal"),
+        };
+        return if (err == error.OutOfMemory) .err_out_of_memory else .err_internal;
+    };
+    switch (prepared) {
+        .current => |entries| out_entries.* = entries,
+        .commit => |*commit| {
+            storage.commit(&commit.batch) catch {
+                commit.release(storage);
+                out_err.* = createErrorBlob(.err_internal, "Journal or block write failed during commit");
+                return .err_internal;
+            };
+            out_entries.* = commit.entries;
+        },
+    }
+    out_err.* = LgBlob.empty();
     return .ok;
 }
 
-/// Delete a block within a transaction (buffered)
-pub export fn fdb_delete_block(
-    txn: ?*LgTxn,
-    block_id: u64,
+/// Documents in the index on `collection`/`field` whose location lies in
+/// the box (inclusive), ordered by block ID. Reads one snapshot without
+/// blocking writers: the tree as last synced, with documents written
+/// since taken from the journal instead.
+///
+/// @param db Database handle
+/// @param collection_ptr Collection name
+/// @param collection_len Length of the name
+/// @param field_ptr Location member path the index was synced with
+/// @param field_len Length of the path
+/// @param min_lon West edge
+/// @param min_lat South edge
+/// @param max_lon East edge
+/// @param max_lat North edge
+/// @param out_rows JSON array [{"block_id":N,"lon":X,"lat":Y}, ...]
+/// @param out_err Error blob; NOT_FOUND when there is no such index, or
+///        the journal no longer reaches it and it needs fdb_spatial_sync
+/// @return Status code
+pub export fn fdb_spatial_query_bbox(
+    db: ?*LgDb,
+    collection_ptr: [*]const u8,
+    collection_len: usize,
+    field_ptr: [*]const u8,
+    field_len: usize,
+    min_lon: f64,
+    min_lat: f64,
+    max_lon: f64,
+    max_lat: f64,
+    out_rows: *LgBlob,
     out_err: *LgBlob,
 ) LgStatus {
-    // SAFETY: txn was originally a *TxnState from fdb_txn_begin, cast to opaque
-    // *LgTxn. The orelse guards null. Alignment is safe because TxnState was
-    // heap-allocated by global_allocator.create(). State validity is checked
-    // immediately after via is_active and mode fields.
-    const state: *TxnState = @ptrCast(@alignCast(txn orelse {
-        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid transaction");
+    out_rows.* = LgBlob.empty();
+
+    const state = lookupDb(db) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
+        return .err_invalid_argument;
+    };
+    const box = spatial.Rect{ .min_x = min_lon, .min_y = min_lat, .max_x = max_lon, .max_y = max_lat };
+    if (!(box.min_x <= box.max_x and box.min_y <= box.max_y)) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Box edges must be numbers with min <= max");
         return .err_invalid_argument;
-    }));
+    }
 
-    if (!state.is_active or state.mode != .read_write) {
-        out_err.* = createErrorBlob(.err_txn_not_active, "Transaction not active or read-only");
-        return .err_txn_not_active;
+    var read = SpatialRead{ .storage = state.storage, .collection = collection_ptr[0..collection_len], .field = field_ptr[0..field_len] };
+    const opened = read.begin(out_err);
+    if (opened != .ok) return opened;
+    defer read.end();
+
+    var hits: std.ArrayList(spatial.Entry) = .{};
+    defer hits.deinit(global_allocator);
+    read.searchBox(box, &hits) catch |err| return spatialReadFailed(err, out_err);
+    return spatialRows(hits.items, out_rows, out_err);
+}
+
+/// The `k` documents in the index on `collection`/`field` nearest the
+/// point, nearest first. Distance is planar in degrees, as the geo
+/// service's in-memory tree measures it. Same snapshot rules and errors
+/// as fdb_spatial_query_bbox.
+///
+/// @param db Database handle
+/// @param collection_ptr Collection name
+/// @param collection_len Length of the name
+/// @param field_ptr Location member path the index was synced with
+/// @param field_len Length of the path
+/// @param lon Longitude of the point
+/// @param lat Latitude of the point
+/// @param k Number of documents wanted
+/// @param out_rows JSON array [{"block_id":N,"lon":X,"lat":Y}, ...]
+/// @param out_err Output parameter for error blob
+/// @return Status code
+pub export fn fdb_spatial_nearest(
+    db: ?*LgDb,
+    collection_ptr: [*]const u8,
+    collection_len: usize,
+    field_ptr: [*]const u8,
+    field_len: usize,
+    lon: f64,
+    lat: f64,
+    k: usize,
+    out_rows: *LgBlob,
+    out_err: *LgBlob,
+) LgStatus {
+    out_rows.* = LgBlob.empty();
+
+    const state = lookupDb(db) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
+        return .err_invalid_argument;
+    };
+    if (!std.math.isFinite(lon) or !std.math.isFinite(lat)) {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Point must have finite coordinates");
+        return .err_invalid_argument;
+    }
+
+    var read = SpatialRead{ .storage = state.storage, .collection = collection_ptr[0..collection_len], .field = field_ptr[0..field_len] };
+    const opened = read.begin(out_err);
+    if (opened != .ok) return opened;
+    defer read.end();
+
+    var hits: std.ArrayList(spatial.Entry) = .{};
+    defer hits.deinit(global_allocator);
+    read.nearest(lon, lat, k, &hits) catch |err| return spatialReadFailed(err, out_err);
+    return spatialRows(hits.items, out_rows, out_err);
+}
+
+/// The meta block of an index and its decoded contents, whose names
+/// borrow `payload`
+const SpatialIndex = struct {
+    block_id: u64,
+    meta: spatial.Meta,
+};
+
+fn findSpatialIndex(
+    storage: *blocks.BlockStorage,
+    snap: blocks.Snapshot,
+    collection: []const u8,
+    field: []const u8,
+    payload: *[blocks.PAYLOAD_SIZE]u8,
+) !?SpatialIndex {
+    var ids: std.ArrayList(u64) = .{};
+    defer ids.deinit(global_allocator);
+    _ = try storage.blocksOfType(global_allocator, @intFromEnum(blocks.BlockType.spatial_meta), snap, 1, std.math.maxInt(usize), &ids);
+
+    var scratch: blocks.Block = undefined;
+    for (ids.items) |block_id| {
+        const block = storage.pinBlockAt(block_id, snap, &scratch) catch continue;
+        defer storage.unpinBlock(block);
+        if (block.header.block_type != @intFromEnum(blocks.BlockType.spatial_meta)) continue;
+        const meta = spatial.Meta.decode(block.getPayload()) catch continue;
+        if (!meta.indexes(collection, field)) continue;
+
+        const stored = block.getPayload();
+        @memcpy(payload[0..stored.len], stored);
+        return .{ .block_id = block_id, .meta = try spatial.Meta.decode(payload[0..stored.len]) };
+    }
+    return null;
+}
+
+/// Spatial nodes as a snapshot sees them, for the spatial.zig walks
+const SnapshotNodes = struct {
+    storage: *blocks.BlockStorage,
+    snap: blocks.Snapshot,
+
+    pub fn read(self: SnapshotNodes, block_id: u64, scratch: *[blocks.PAYLOAD_SIZE]u8) ![]const u8 {
+        var frame: blocks.Block = undefined;
+        const block = try self.storage.pinBlockAt(block_id, self.snap, &frame);
+        defer self.storage.unpinBlock(block);
+        if (block.header.block_type != @intFromEnum(blocks.BlockType.spatial_node)) return error.InvalidSpatialNode;
+        const stored = block.getPayload();
+        @memcpy(scratch[0..stored.len], stored);
+        return scratch[0..stored.len];
+    }
+};
+
+/// Tree entries for documents written after the tree was packed, which
+/// are stale and read from the documents instead
+const ChangedBlocks = struct {
+    ids: []const u64,
+
+    pub fn skip(self: ChangedBlocks, block_id: u64) bool {
+        return std.sort.binarySearch(u64, self.ids, block_id, orderBlockId) != null;
+    }
+
+    fn orderBlockId(target: u64, id: u64) std.math.Order {
+        return std.math.order(target, id);
+    }
+};
+
+/// Location of `block_id` at `snap` when it is a live document of
+/// `collection` that has one
+fn spatialLocation(
+    storage: *blocks.BlockStorage,
+    snap: blocks.Snapshot,
+    block_id: u64,
+    collection: []const u8,
+    field: []const u8,
+    doc: *std.ArrayList(u8),
+    scratch: *std.ArrayList(u8),
+) !?[2]f64 {
+    var frame: blocks.Block = undefined;
+    const block = storage.pinBlockAt(block_id, snap, &frame) catch return null;
+    defer storage.unpinBlock(block);
+
+    if (!blocks.isLiveDocument(block)) return null;
+
+    const data = storage.readChain(global_allocator, block, snap, doc) catch |err| switch (err) {
+        error.OutOfMemory => return err,
+        else => return null,
+    };
+    return spatial.documentLocation(global_allocator, data, collection, field, scratch);
+}
+
+/// What a sync found: the index already at the snapshot, or a commit
+/// installing a repacked tree
+const SpatialSync = union(enum) {
+    current: u64,
+    commit: SpatialCommit,
+};
+
+const SpatialCommit = struct {
+    batch: blocks.CommitBatch,
+    entries: u64,
+    first_node: u64,
+    nodes: u64,
+    /// Meta block reserved for a new index (0 when rewriting the old one)
+    new_meta: u64,
+
+    /// Hand back the IDs reserved for a commit that failed
+    fn release(self: *const SpatialCommit, storage: *blocks.BlockStorage) void {
+        if (self.nodes > 0) storage.releaseBlockIds(self.first_node, self.nodes) catch {};
+        if (self.new_meta != 0) storage.releaseBlockIds(self.new_meta, 1) catch {};
+    }
+};
+
+fn prepareSpatialCommit(
+    storage: *blocks.BlockStorage,
+    snap: blocks.Snapshot,
+    arena: std.mem.Allocator,
+    collection: []const u8,
+    field: []const u8,
+) !SpatialSync {
+    var meta_payload: [blocks.PAYLOAD_SIZE]u8 = undefined;
+    const existing = try findSpatialIndex(storage, snap, collection, field, &meta_payload);
+    if (existing) |index| {
+        if (index.meta.through == snap.sequence) return .{ .current = index.meta.entries };
+    }
+
+    var entries: std.ArrayList(spatial.Entry) = .{};
+    var doc: std.ArrayList(u8) = .{};
+    defer doc.deinit(global_allocator);
+    var scratch: std.ArrayList(u8) = .{};
+    defer scratch.deinit(global_allocator);
+
+    // Repack from the old leaves and the journal since; without an index,
+    // or when the journal no longer reaches it, every document is read
+    var ids: std.ArrayList(u64) = .{};
+    defer ids.deinit(global_allocator);
+    const incremental = if (existing) |index| blk: {
+        blocksWrittenSince(storage, index.meta.through, snap.sequence, &ids) catch |err| switch (err) {
+            error.JournalGap => {
+                ids.clearRetainingCapacity();
+                break :blk false;
+            },
+            else => return err,
+        };
+        // `through` precedes the sync's own INDEX_CREATE entry: with no
+        // document written since, the tree is still current
+        if (ids.items.len == 0) return .{ .current = index.meta.entries };
+        const nodes = SnapshotNodes{ .storage = storage, .snap = snap };
+        try spatial.collectLeaves(arena, nodes, index.meta.root, ChangedBlocks{ .ids = ids.items }, &entries);
+        break :blk true;
+    } else false;
+
+    if (!incremental) {
+        _ = try storage.blocksOfType(global_allocator, @intFromEnum(blocks.BlockType.document), snap, 1, std.math.maxInt(usize), &ids);
+        storage.adviseSequential(true);
+    }
+    defer storage.adviseSequential(false);
+    for (ids.items) |block_id| {
+        const at = (try spatialLocation(storage, snap, block_id, collection, field, &doc, &scratch)) orelse continue;
+        try entries.append(arena, .{ .rect = spatial.Rect.point(at[0], at[1]), .ref = block_id });
+    }
+
+    const n_nodes = spatial.nodeCount(entries.items.len);
+    var commit = SpatialCommit{
+        .batch = .{},
+        .entries = entries.items.len,
+        .first_node = if (n_nodes > 0) storage.reserveBlockIds(n_nodes) else 0,
+        .nodes = n_nodes,
+        .new_meta = if (existing == null) storage.reserveBlockIds(1) else 0,
+    };
+    errdefer commit.release(storage);
+    const meta_id = if (existing) |index| index.block_id else commit.new_meta;
+
+    const tree = try spatial.pack(arena, entries.items, commit.first_node);
+    const writes = try arena.alloc(blocks.BlockWrite, n_nodes + 1);
+    for (writes[0..n_nodes], 0..) |*w, i| {
+        w.* = .{ .block_id = commit.first_node + i, .block_type = .spatial_node, .payload = tree.payload(i) };
+    }
+    const meta = spatial.Meta{
+        .root = tree.root,
+        .first_node = commit.first_node,
+        .nodes = n_nodes,
+        .entries = entries.items.len,
+        .through = snap.sequence,
+        .height = tree.height,
+        .collection = collection,
+        .field = field,
+    };
+    writes[n_nodes] = .{
+        .block_id = meta_id,
+        .block_type = .spatial_meta,
+        .payload = meta.encode(try arena.create([blocks.PAYLOAD_SIZE]u8)),
+        .replaces = existing != null,
+    };
+
+    const frees: []const u64 = if (existing) |index| blk: {
+        const old = try arena.alloc(u64, @intCast(index.meta.nodes));
+        for (old, 0..) |*id, i| id.* = index.meta.first_node + i;
+        break :blk old;
+    } else &.{};
+
+    const records = try arena.alloc(blocks.JournalRecord, 1);
+    records[0] = .{
+        .op = .index_create,
+        .affected_block = meta_id,
+        .forward = try std.fmt.allocPrint(arena, "INDEX_CREATE spatial collection={s} field={s} root={d} entries={d} through={d}", .{
+            collection,
+            field,
+            tree.root,
+            entries.items.len,
+            snap.sequence,
+        }),
+    };
+
+    commit.batch = .{ .journal = records, .writes = writes, .frees = frees, .free_type = .spatial_node };
+    return .{ .commit = commit };
+}
+
+/// One query's view of an index: its meta at a snapshot and the
+/// documents written since it was packed
+const SpatialRead = struct {
+    storage: *blocks.BlockStorage,
+    collection: []const u8,
+    field: []const u8,
+    snap: blocks.Snapshot = undefined,
+    meta_payload: [blocks.PAYLOAD_SIZE]u8 = undefined,
+    meta: spatial.Meta = undefined,
+    changed: std.ArrayList(u64) = .{},
+    doc: std.ArrayList(u8) = .{},
+    scratch: std.ArrayList(u8) = .{},
+
+    /// Take the snapshot and find the index; on anything but .ok the
+    /// error blob is set and nothing needs ending
+    fn begin(self: *SpatialRead, out_err: *LgBlob) LgStatus {
+        self.snap = self.storage.beginSnapshot() catch {
+            out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+            return .err_out_of_memory;
+        };
+        const status = self.load(out_err);
+        if (status != .ok) self.end();
+        return status;
+    }
+
+    fn load(self: *SpatialRead, out_err: *LgBlob) LgStatus {
+        const found = findSpatialIndex(self.storage, self.snap, self.collection, self.field, &self.meta_payload) catch |err| {
+            out_err.* = if (err == error.OutOfMemory) createErrorBlob(.err_out_of_memory, "Out of memory") else createErrorBlob(.err_internal, "Failed to read the spatial index");
+            return if (err == error.OutOfMemory) .err_out_of_memory else .err_internal;
+        };
+        const index = found orelse {
+            out_err.* = createErrorBlob(.err_not_found, "No spatial index on that collection and field; run fdb_spatial_sync");
+            return .err_not_found;
+        };
+        self.meta = index.meta;
+
+        blocksWrittenSince(self.storage, self.meta.through, self.snap.sequence, &self.changed) catch |err| {
+            out_err.* = switch (err) {
+                error.OutOfMemory => createErrorBlob(.err_out_of_memory, "Out of memory"),
+                error.JournalGap => createErrorBlob(.err_not_found, "Journal no longer reaches the spatial index; run fdb_spatial_sync"),
+                else => createErrorBlob(.err_internal, "Failed to read the journal"),
+            };
+            return switch (err) {
+                error.OutOfMemory => .err_out_of_memory,
+                error.JournalGap => .err_not_found,
+                else => .err_internal,
+            };
+        };
+        return .ok;
+    }
+
+    fn end(self: *SpatialRead) void {
+        self.changed.deinit(global_allocator);
+        self.doc.deinit(global_allocator);
+        self.scratch.deinit(global_allocator);
+        self.storage.endSnapshot(self.snap);
+    }
+
+    fn nodes(self: *const SpatialRead) SnapshotNodes {
+        return .{ .storage = self.storage, .snap = self.snap };
+    }
+
+    fn stale(self: *const SpatialRead) ChangedBlocks {
+        return .{ .ids = self.changed.items };
+    }
+
+    fn location(self: *SpatialRead, block_id: u64) !?spatial.Entry {
+        const at = (try spatialLocation(self.storage, self.snap, block_id, self.collection, self.field, &self.doc, &self.scratch)) orelse return null;
+        return .{ .rect = spatial.Rect.point(at[0], at[1]), .ref = block_id };
+    }
+
+    fn searchBox(self: *SpatialRead, box: spatial.Rect, hits: *std.ArrayList(spatial.Entry)) !void {
+        try spatial.search(global_allocator, self.nodes(), self.meta.root, box, hits);
+        var kept: usize = 0;
+        for (hits.items) |hit| {
+            if (self.stale().skip(hit.ref)) continue;
+            hits.items[kept] = hit;
+            kept += 1;
+        }
+        hits.shrinkRetainingCapacity(kept);
+
+        for (self.changed.items) |block_id| {
+            const entry = (try self.location(block_id)) orelse continue;
+            if (entry.rect.intersects(box)) try hits.append(global_allocator, entry);
+        }
+        std.mem.sort(spatial.Entry, hits.items, {}, lessRef);
+    }
+
+    fn nearest(self: *SpatialRead, lon: f64, lat: f64, k: usize, hits: *std.ArrayList(spatial.Entry)) !void {
+        try spatial.nearest(global_allocator, self.nodes(), self.meta.root, lon, lat, k, self.stale(), hits);
+        for (self.changed.items) |block_id| {
+            if (try self.location(block_id)) |entry| try hits.append(global_allocator, entry);
+        }
+
+        const Point = struct {
+            lon: f64,
+            lat: f64,
+
+            fn closer(p: @This(), a: spatial.Entry, b: spatial.Entry) bool {
+                const da = a.rect.distance2(p.lon, p.lat);
+                const db = b.rect.distance2(p.lon, p.lat);
+                return da < db or (da == db and a.ref < b.ref);
+            }
+        };
+        std.mem.sort(spatial.Entry, hits.items, Point{ .lon = lon, .lat = lat }, Point.closer);
+        hits.shrinkRetainingCapacity(@min(k, hits.items.len));
+    }
+
+    fn lessRef(_: void, a: spatial.Entry, b: spatial.Entry) bool {
+        return a.ref < b.ref;
+    }
+};
+
+fn spatialReadFailed(err: anyerror, out_err: *LgBlob) LgStatus {
+    if (err == error.OutOfMemory) {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
     }
+    out_err.* = createErrorBlob(.err_internal, "Failed to read the spatial index");
+    return .err_internal;
+}
 
-    state.pending_deletes.append(global_allocator, block_id) catch {
+fn spatialRows(hits: []const spatial.Entry, out_rows: *LgBlob, out_err: *LgBlob) LgStatus {
+    var out: std.ArrayList(u8) = .{};
+    defer out.deinit(global_allocator);
+    appendSpatialRows(&out, hits) catch {
         out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
         return .err_out_of_memory;
     };
-
+    const data = out.toOwnedSlice(global_allocator) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    out_rows.* = LgBlob.fromSlice(data);
     out_err.* = LgBlob.empty();
     return .ok;
 }
 
-/// Read all blocks of a given type (full scan for PoC)
-/// Returns JSON array of objects with block_id and data fields.
-pub export fn fdb_read_blocks(
+fn appendSpatialRows(out: *std.ArrayList(u8), hits: []const spatial.Entry) !void {
+    try out.append(global_allocator, '[');
+    for (hits, 0..) |hit, i| {
+        if (i > 0) try out.append(global_allocator, ',');
+        try out.print(global_allocator, "{{\"block_id\":{d},\"lon\":{d},\"lat\":{d}}}", .{ hit.ref, hit.rect.min_x, hit.rect.min_y });
+    }
+    try out.append(global_allocator, ']');
+}
+
+/// Read one document without copying it out of the buffer pool
+///
+/// A single-block document is returned as a view of its pinned pool
+/// frame. A commit that rewrites the block leaves the frame alone, so
+/// the bytes stay as read until the view is released. Chained or
+/// compressed documents, and databases opened without a buffer pool, get
+/// the document reassembled or copied into memory owned by the view.
+/// Views hold pool frames, so release them promptly. A database closed
+/// while views remain keeps its storage open until the last is released.
+///
+/// @param db Database handle
+/// @param block_id Document block ID
+/// @param out_view Output: the document bytes and their release token
+/// @param out_err Output parameter for error blob
+/// @return Status code (LG_ERR_NOT_FOUND for missing, deleted or non-document blocks)
+pub export fn fdb_read_block_view(
     db: ?*LgDb,
-    block_type: u16,
-    out_data: *LgBlob,
+    block_id: u64,
+    out_view: *LgView,
     out_err: *LgBlob,
 ) LgStatus {
-    // SAFETY: db was originally a *DbState from fdb_db_open, cast to opaque *LgDb.
-    // The orelse guards null. Alignment is safe because DbState was heap-allocated
-    // by global_allocator.create(). The db_registry.contains() check below validates
-    // the pointer is still a live, registered handle.
-    const state: *DbState = @ptrCast(@alignCast(db orelse {
+    out_view.* = LgView.empty();
+    const state = lookupDb(db) orelse {
         out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
         return .err_invalid_argument;
-    }));
+    };
+    const storage = state.storage;
 
-    if (!db_registry.contains(state)) {
-        out_err.* = createErrorBlob(.err_invalid_argument, "Database handle not registered");
-        return .err_invalid_argument;
+    const view = global_allocator.create(ViewState) catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+        return .err_out_of_memory;
+    };
+    view.* = .{ .db = state };
+    state.retainView();
+
+    var scratch: blocks.Block = undefined;
+    view.frame = storage.pinBlockStable(block_id, &scratch) catch |err| {
+        view.release();
+        if (err == error.InvalidBlock) {
+            out_err.* = createErrorBlob(.err_not_found, "Block not found or invalid");
+            return .err_not_found;
+        }
+        const msg = switch (err) {
+            error.ChecksumMismatch => "Block checksum mismatch",
+            else => "Failed to read block",
+        };
+        out_err.* = createErrorBlob(.err_internal, msg);
+        return .err_internal;
+    };
+    const head = view.frame orelse &scratch;
+
+    if (!blocks.isLiveDocument(head)) {
+        view.release();
+        out_err.* = createErrorBlob(.err_not_found, "Document not found");
+        return .err_not_found;
     }
 
-    // Build JSON array by scanning all blocks
-    var result: std.ArrayList(u8) = .{};
-    defer result.deinit(global_allocator);
+    var data = storage.readChain(global_allocator, head, null, &view.owned) catch {
+        view.release();
+        out_err.* = createErrorBlob(.err_internal, "Failed to read overflow chain");
+        return .err_internal;
+    };
 
-    result.appendSlice(global_allocator, "[") catch {
-        out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+    // Only a payload inside the pinned frame can be borrowed
+    const borrowed = view.frame != null and data.ptr == head.getPayload().ptr;
+    if (!borrowed) {
+        if (data.ptr != view.owned.items.ptr) {
+            view.owned.appendSlice(global_allocator, data) catch {
+                view.release();
+                out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+                return .err_out_of_memory;
+            };
+            data = view.owned.items;
+        }
+        if (view.frame) |frame| storage.unpinBlock(frame);
+        view.frame = null;
+    }
+
+    const token = view_handles.insert(view) catch {
+        view.release();
+        out_err.* = createErrorBlob(.err_out_of_memory, "Failed to register view");
         return .err_out_of_memory;
     };
 
-    var first = true;
-    var block_id: u64 = 1;
-    while (block_id < state.storage.superblock.block_count) : (block_id += 1) {
-        const block = state.storage.readBlock(block_id) catch continue;
+    out_view.* = .{ .ptr = data.ptr, .len = data.len, .token = token };
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Release a view from fdb_read_block_view. Unknown or already released
+/// views are ignored.
+pub export fn fdb_view_release(view: *LgView) void {
+    const state = view_handles.remove(@intCast(view.token)) orelse {
+        view.* = LgView.empty();
+        return;
+    };
+    state.release();
+    view.* = LgView.empty();
+}
+
+/// Append one scan row; JSON rows after the first are comma-separated
+fn appendRow(rows: *cbor.Encoder, format: cursors.Format, first: bool, block_id: u64, data: []const u8) !void {
+    switch (format) {
+        .json => {
+            if (!first) try rows.encodeRaw(",");
+            try cursors.appendBlockJson(rows.allocator, &rows.buffer, block_id, data);
+        },
+        .cbor => try cursors.appendBlockCbor(rows, block_id, data),
+    }
+}
 
-        // Filter by type and skip deleted blocks
-        if (block.header.block_type != block_type) continue;
-        if (block.header.flags & 0x08 != 0) continue; // FLAG_DELETED
+/// One morsel of a type scan: its rows, encoded as the serial scan would,
+/// minus the separator before the first
+const MorselRows = struct {
+    rows: cbor.Encoder,
+    count: usize = 0,
+};
 
-        if (!first) {
-            result.appendSlice(global_allocator, ",") catch continue;
-        }
-        first = false;
-
-        // Format as JSON object with block_id and raw payload
-        const payload = block.getPayload();
-
-        // Start JSON object
-        var header_buf: [80]u8 = undefined;
-        const header_str = std.fmt.bufPrint(&header_buf,
-            \\{{"block_id":{d},"size":{d},"data":
-        , .{ block.header.block_id, block.header.payload_len }) catch continue;
-
-        result.appendSlice(global_allocator, header_str) catch continue;
-
-        // Include payload as JSON-escaped string
-        result.appendSlice(global_allocator, "\"") catch continue;
-        for (payload) |byte| {
-            switch (byte) {
-                '"' => result.appendSlice(global_allocator, "\\\"") catch continue,
-                '\\' => result.appendSlice(global_allocator, "\\\\") catch continue,
-                '\n' => result.appendSlice(global_allocator, "\\n") catch continue,
-                '\r' => result.appendSlice(global_allocator, "\\r") catch continue,
-                '\t' => result.appendSlice(global_allocator, "\\t") catch continue,
-                else => {
-                    if (byte >= 0x20 and byte < 0x7F) {
-                        result.append(global_allocator, byte) catch continue;
-                    } else {
-                        var hex_buf: [6]u8 = undefined;
-                        const hex_str = std.fmt.bufPrint(&hex_buf, "\\u{x:0>4}", .{byte}) catch continue;
-                        result.appendSlice(global_allocator, hex_str) catch continue;
-                    }
-                },
-            }
+/// parallel_scan job for scanBlocks. Workers read through the shared
+/// pool; a block read from disk has its CRC checked on the way in, and
+/// blocks that fail it are skipped like any other unreadable block.
+const BlockScan = struct {
+    storage: *blocks.BlockStorage,
+    snap: ?blocks.Snapshot,
+    block_type: u16,
+    format: cursors.Format,
+    out: []MorselRows,
+
+    pub fn runMorsel(self: *BlockScan, index: usize, ids: []const u64) void {
+        const slot = &self.out[index];
+
+        var doc: std.ArrayList(u8) = .{};
+        defer doc.deinit(global_allocator);
+
+        var scratch: blocks.Block = undefined;
+        for (ids) |block_id| {
+            const block = self.storage.pinBlockAt(block_id, self.snap, &scratch) catch continue;
+            defer self.storage.unpinBlock(block);
+
+            // Filter by type and skip deleted blocks
+            if (block.header.block_type != self.block_type) continue;
+            if (block.header.flags & blocks.FLAG_DELETED != 0) continue;
+
+            // Drop a row that runs out of memory half-way rather than
+            // leave a broken encoding behind
+            const data = self.storage.readChain(global_allocator, block, self.snap, &doc) catch continue;
+            const row_start = slot.rows.buffer.items.len;
+            appendRow(&slot.rows, self.format, slot.count == 0, block_id, data) catch {
+                slot.rows.buffer.shrinkRetainingCapacity(row_start);
+                continue;
+            };
+            slot.count += 1;
         }
-        result.appendSlice(global_allocator, "\"}") catch continue;
     }
+};
+
+/// Type scan shared by fdb_read_blocks and fdb_txn_read_blocks. The
+/// candidates are split into morsels over the database's scan workers and
+/// the morsels' rows joined back in block-ID order.
+fn scanBlocks(
+    state: *DbState,
+    snap: ?blocks.Snapshot,
+    block_type: u16,
+    opts: LgRenderOpts,
+    out_data: *LgBlob,
+    out_err: *LgBlob,
+) LgStatus {
+    const storage = state.storage;
+    const format = renderFormat(opts) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Unknown render format");
+        return .err_invalid_argument;
+    };
 
-    result.appendSlice(global_allocator, "]") catch {
+    var candidates: std.ArrayList(u64) = .{};
+    defer candidates.deinit(global_allocator);
+    _ = storage.blocksOfType(global_allocator, block_type, snap, 1, std.math.maxInt(usize), &candidates) catch {
         out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
         return .err_out_of_memory;
     };
 
-    const result_data = global_allocator.dupe(u8, result.items) catch {
+    const morsels = global_allocator.alloc(MorselRows, parallel_scan.morselCount(candidates.items.len)) catch {
         out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
         return .err_out_of_memory;
     };
+    defer global_allocator.free(morsels);
+    for (morsels) |*m| m.* = .{ .rows = cbor.Encoder.init(global_allocator) };
+    defer for (morsels) |*m| m.rows.deinit();
+
+    storage.adviseSequential(true);
+    var job = BlockScan{ .storage = storage, .snap = snap, .block_type = block_type, .format = format, .out = morsels };
+    state.scanners.run(BlockScan, &job, candidates.items);
+    storage.adviseSequential(false);
+
+    var row_count: usize = 0;
+    var rows_len: usize = 0;
+    for (morsels) |*m| {
+        row_count += m.count;
+        rows_len += m.rows.buffer.items.len + 1;
+    }
 
-    out_data.* = LgBlob.fromSlice(result_data);
-    out_err.* = LgBlob.empty();
-    return .ok;
+    // JSON rows go between brackets, with a comma where two morsels meet;
+    // CBOR rows after a definite-length array header
+    var result = cbor.Encoder.init(global_allocator);
+    defer result.deinit();
+    assemble: {
+        result.buffer.ensureTotalCapacity(global_allocator, rows_len + 16) catch break :assemble;
+        switch (format) {
+            .json => result.encodeRaw("[") catch break :assemble,
+            .cbor => result.beginArray(row_count) catch break :assemble,
+        }
+        var emitted = false;
+        for (morsels) |*m| {
+            if (m.count == 0) continue;
+            if (format == .json and emitted) result.encodeRaw(",") catch break :assemble;
+            result.encodeRaw(m.rows.finish()) catch break :assemble;
+            emitted = true;
+        }
+        if (format == .json) result.encodeRaw("]") catch break :assemble;
+
+        const result_data = result.buffer.toOwnedSlice(global_allocator) catch break :assemble;
+        out_data.* = LgBlob.fromSlice(result_data);
+        out_err.* = LgBlob.empty();
+        return .ok;
+    }
+
+    out_err.* = createErrorBlob(.err_out_of_memory, "Out of memory");
+    return .err_out_of_memory;
 }
 
 // ============================================================
 // Introspection - C ABI Exports
 // ============================================================
 
-/// Render a block as canonical text
+/// Render a block as canonical text, or as a CBOR map carrying the
+/// payload as a byte string when opts.format is LG_RENDER_CBOR
 ///
 /// @param db Database handle
 /// @param block_id Block ID to render
@@ -705,21 +2897,15 @@ pub export fn fdb_render_block(
     out_text: *LgBlob,
     out_err: *LgBlob,
 ) LgStatus {
-    _ = opts;
-
-    // SAFETY: db was originally a *DbState from fdb_db_open, cast to opaque *LgDb.
-    // The orelse guards null. Alignment is safe because DbState was heap-allocated
-    // by global_allocator.create(). The db_registry.contains() check below validates
-    // the pointer is still a live, registered handle.
-    const state: *DbState = @ptrCast(@alignCast(db orelse {
+    const state = lookupDb(db) orelse {
         out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
         return .err_invalid_argument;
-    }));
+    };
 
-    if (!db_registry.contains(state)) {
-        out_err.* = createErrorBlob(.err_invalid_argument, "Database handle not registered");
+    const format = renderFormat(opts) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Unknown render format");
         return .err_invalid_argument;
-    }
+    };
 
     // Read block from storage
     const block = state.storage.readBlock(block_id) catch |err| {
@@ -731,18 +2917,43 @@ pub export fn fdb_render_block(
         out_err.* = createErrorBlob(.err_internal, msg);
         return .err_internal;
     };
+    const type_name = @tagName(@as(blocks.BlockType, @enumFromInt(block.header.block_type)));
+
+    // Chained documents render whole, not just their head block
+    var doc: std.ArrayList(u8) = .{};
+    defer doc.deinit(global_allocator);
+    const data = state.storage.readChain(global_allocator, &block, null, &doc) catch {
+        out_err.* = createErrorBlob(.err_internal, "Failed to read overflow chain");
+        return .err_internal;
+    };
+
+    if (format == .cbor) {
+        var encoder = cbor.Encoder.init(global_allocator);
+        defer encoder.deinit();
+        encodeRenderedBlock(&encoder, &block, type_name, data) catch {
+            out_err.* = createErrorBlob(.err_out_of_memory, "Failed to allocate result");
+            return .err_out_of_memory;
+        };
+
+        const cbor_data = global_allocator.dupe(u8, encoder.finish()) catch {
+            out_err.* = createErrorBlob(.err_out_of_memory, "Failed to allocate result");
+            return .err_out_of_memory;
+        };
+        out_text.* = LgBlob.fromSlice(cbor_data);
+        out_err.* = LgBlob.empty();
+        return .ok;
+    }
 
     // Format block as JSON (show payload size only, not content)
-    _ = block.getPayload(); // Validate payload exists
     var buf: [8192]u8 = undefined;
     const text = std.fmt.bufPrint(&buf,
         \\{{"block_id":{d},"type":"{s}","sequence":{d},"size":{d},"payload":"[{d} bytes]"}}
     , .{
         block.header.block_id,
-        @tagName(@as(blocks.BlockType, @enumFromInt(block.header.block_type))),
+        type_name,
         block.header.sequence,
-        block.header.payload_len,
-        block.header.payload_len,
+        data.len,
+        data.len,
     }) catch {
         out_err.* = createErrorBlob(.err_internal, "Failed to format block");
         return .err_internal;
@@ -758,10 +2969,27 @@ pub export fn fdb_render_block(
     return .ok;
 }
 
-/// Render journal entries since a sequence number
+/// CBOR form of fdb_render_block: the JSON fields, with the payload itself
+fn encodeRenderedBlock(encoder: *cbor.Encoder, block: *const blocks.Block, type_name: []const u8, data: []const u8) !void {
+    try encoder.beginMap(5);
+    try encoder.encodeText("block_id");
+    try encoder.encodeUint(block.header.block_id);
+    try encoder.encodeText("type");
+    try encoder.encodeText(type_name);
+    try encoder.encodeText("sequence");
+    try encoder.encodeUint(block.header.sequence);
+    try encoder.encodeText("size");
+    try encoder.encodeUint(data.len);
+    try encoder.encodeText("payload");
+    try encoder.encodeBytes(data);
+}
+
+/// Render journal entries after a sequence number, as JSON or CBOR:
+/// {"since","head","tail","entries":[{"seq","timestamp","op",
+/// "affected_block","forward"}, ...]}, at most RENDER_JOURNAL_LIMIT entries
 ///
 /// @param db Database handle
-/// @param since Sequence number to start from
+/// @param since Last sequence already seen (0 renders from the start)
 /// @param opts Render options
 /// @param out_text Output parameter for text blob
 /// @param out_err Output parameter for error blob
@@ -773,42 +3001,156 @@ pub export fn fdb_render_journal(
     out_text: *LgBlob,
     out_err: *LgBlob,
 ) LgStatus {
-    _ = opts;
-
-    // SAFETY: db was originally a *DbState from fdb_db_open, cast to opaque *LgDb.
-    // The orelse guards null. Alignment is safe because DbState was heap-allocated
-    // by global_allocator.create(). The db_registry.contains() check below validates
-    // the pointer is still a live, registered handle.
-    const state: *DbState = @ptrCast(@alignCast(db orelse {
+    const state = lookupDb(db) orelse {
         out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
         return .err_invalid_argument;
-    }));
+    };
 
-    if (!db_registry.contains(state)) {
-        out_err.* = createErrorBlob(.err_invalid_argument, "Database handle not registered");
+    const format = renderFormat(opts) orelse {
+        out_err.* = createErrorBlob(.err_invalid_argument, "Unknown render format");
         return .err_invalid_argument;
-    }
-
-    // Format journal info as JSON
-    var buf: [512]u8 = undefined;
-    const text = std.fmt.bufPrint(&buf,
-        \\{{"since":{d},"head":{d},"tail":{d},"entries":[]}}
-    , .{
-        since,
-        state.storage.superblock.journal_head,
-        state.storage.superblock.journal_tail,
-    }) catch {
-        out_err.* = createErrorBlob(.err_internal, "Failed to format journal");
+    };
+    const journal_head = state.storage.journalHead();
+    const journal_tail = state.storage.superblock.journal_tail;
+
+    var rows = cbor.Encoder.init(global_allocator);
+    defer rows.deinit();
+    const row_count = appendJournalRows(state.storage, since +| 1, RENDER_JOURNAL_LIMIT, format, &rows) catch |err| {
+        if (err == error.OutOfMemory) {
+            out_err.* = createErrorBlob(.err_out_of_memory, "Failed to allocate result");
+            return .err_out_of_memory;
+        }
+        out_err.* = createErrorBlob(.err_internal, "Failed to read journal");
         return .err_internal;
     };
 
-    const text_data = global_allocator.dupe(u8, text) catch {
+    // Entries go inside {"since","head","tail","entries"} once counted
+    var head = cbor.Encoder.init(global_allocator);
+    defer head.deinit();
+    const framed = switch (format) {
+        .json => head.buffer.print(global_allocator,
+            \{{"since":{d},"head":{d},"tail":{d},"entries":[
+        , .{ since, journal_head, journal_tail }),
+        .cbor => encodeJournalHead(&head, since, journal_head, journal_tail, row_count),
+    };
+    framed catch {
+        out_err.* = createErrorBlob(.err_out_of_memory, "Failed to allocate result");
+        return .err_out_of_memory;
+    };
+
+    const parts = [_][]const u8{ head.finish(), rows.finish(), if (format == .json) "]}" else "" };
+    const text_data = std.mem.concat(global_allocator, u8, &parts) catch {
         out_err.* = createErrorBlob(.err_out_of_memory, "Failed to allocate result");
         return .err_out_of_memory;
     };
 
-    out_text.* = LgBlob.fromSlice(text_data);
-    out_err.* = LgBlob.empty();
+    out_text.* = LgBlob.fromSlice(text_data);
+    out_err.* = LgBlob.empty();
+    return .ok;
+}
+
+/// Entries rendered per fdb_render_journal call; callers page on with the
+/// last sequence they saw
+const RENDER_JOURNAL_LIMIT: usize = 1024;
+
+fn encodeJournalHead(encoder: *cbor.Encoder, since: u64, journal_head: u64, journal_tail: u64, entries: usize) !void {
+    try encoder.beginMap(4);
+    try encoder.encodeText("since");
+    try encoder.encodeUint(since);
+    try encoder.encodeText("head");
+    try encoder.encodeUint(journal_head);
+    try encoder.encodeText("tail");
+    try encoder.encodeUint(journal_tail);
+    try encoder.encodeText("entries");
+    try encoder.beginArray(entries);
+}
+
+/// Append up to `limit` entries from `start` as rows (comma-separated for
+/// JSON); returns how many were appended
+fn appendJournalRows(storage: *blocks.BlockStorage, start: u64, limit: usize, format: cursors.Format, rows: *cbor.Encoder) !usize {
+    var reader = try journal.JournalReader.open(global_allocator, storage, start);
+    defer reader.close();
+
+    var count: usize = 0;
+    while (count < limit) : (count += 1) {
+        const entry = (try reader.next()) orelse break;
+        switch (format) {
+            .json => {
+                if (count > 0) try rows.encodeRaw(",");
+                try journal.appendEntryJson(global_allocator, &rows.buffer, entry);
+            },
+            .cbor => try journal.appendEntryCbor(rows, entry),
+        }
+    }
+    return count;
+}
+
+/// Read up to `count` journal entries from `start_seq` (inclusive; 0 reads
+/// from the oldest entry) as a JSON array into `buf`. Only whole entries
+/// are written; an empty array means the reader is at the head. Each call
+/// seeks through the journal index, so tailing costs the same however
+/// long the journal is.
+///
+/// @param db Database handle
+/// @param start_seq First sequence to return
+/// @param count Maximum number of entries
+/// @param buf Output buffer
+/// @param buf_len Capacity of buf
+/// @param written Bytes written; if the first entry does not fit, the size
+///        needed and INVALID_ARGUMENT
+/// @return Status code
+pub export fn fdb_journal_read(
+    db: ?*LgDb,
+    start_seq: u64,
+    count: u64,
+    buf: [*]u8,
+    buf_len: usize,
+    written: *usize,
+) LgStatus {
+    written.* = 0;
+
+    const state = lookupDb(db) orelse return .err_invalid_argument;
+
+    // "[]" at minimum
+    if (buf_len < 2) {
+        written.* = 2;
+        return .err_invalid_argument;
+    }
+
+    var reader = journal.JournalReader.open(global_allocator, state.storage, start_seq) catch return .err_out_of_memory;
+    defer reader.close();
+
+    var row: std.ArrayList(u8) = .{};
+    defer row.deinit(global_allocator);
+
+    var len: usize = 1;
+    var rows: u64 = 0;
+    while (rows < count) : (rows += 1) {
+        const next_entry = reader.next() catch |err| switch (err) {
+            error.OutOfMemory => return .err_out_of_memory,
+            else => return .err_internal,
+        };
+        const entry = next_entry orelse break;
+
+        row.clearRetainingCapacity();
+        if (rows > 0) row.append(global_allocator, ',') catch return .err_out_of_memory;
+        journal.appendEntryJson(global_allocator, &row, entry) catch return .err_out_of_memory;
+
+        // Keep room for the closing bracket
+        if (row.items.len > buf_len - len - 1) {
+            if (rows == 0) {
+                written.* = row.items.len + 2;
+                return .err_invalid_argument;
+            }
+            break;
+        }
+        @memcpy(buf[len..][0..row.items.len], row.items);
+        len += row.items.len;
+    }
+
+    buf[0] = '[';
+    buf[len] = ']';
+    written.* = len + 1;
     return .ok;
 }
 
@@ -823,19 +3165,10 @@ pub export fn fdb_introspect_schema(
     out_schema: *LgBlob,
     out_err: *LgBlob,
 ) LgStatus {
-    // SAFETY: db was originally a *DbState from fdb_db_open, cast to opaque *LgDb.
-    // The orelse guards null. Alignment is safe because DbState was heap-allocated
-    // by global_allocator.create(). The db_registry.contains() check below validates
-    // the pointer is still a live, registered handle.
-    const state: *DbState = @ptrCast(@alignCast(db orelse {
+    const state = lookupDb(db) orelse {
         out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
         return .err_invalid_argument;
-    }));
-
-    if (!db_registry.contains(state)) {
-        out_err.* = createErrorBlob(.err_invalid_argument, "Database handle not registered");
-        return .err_invalid_argument;
-    }
+    };
 
     // Format schema as JSON
     var buf: [512]u8 = undefined;
@@ -870,19 +3203,10 @@ pub export fn fdb_introspect_constraints(
     out_constraints: *LgBlob,
     out_err: *LgBlob,
 ) LgStatus {
-    // SAFETY: db was originally a *DbState from fdb_db_open, cast to opaque *LgDb.
-    // The orelse guards null. Alignment is safe because DbState was heap-allocated
-    // by global_allocator.create(). The db_registry.contains() check below validates
-    // the pointer is still a live, registered handle.
-    const state: *DbState = @ptrCast(@alignCast(db orelse {
+    const state = lookupDb(db) orelse {
         out_err.* = createErrorBlob(.err_invalid_argument, "Invalid database handle");
         return .err_invalid_argument;
-    }));
-
-    if (!db_registry.contains(state)) {
-        out_err.* = createErrorBlob(.err_invalid_argument, "Database handle not registered");
-        return .err_invalid_argument;
-    }
+    };
 
     // Generate constraint introspection (placeholder - no constraints yet)
     const constraint_json = "{\"constraints\":[],\"functional_dependencies\":[]}";
@@ -914,8 +3238,61 @@ const VerifierEntry = struct {
     context: ?*anyopaque,
 };
 
-// Registry of proof verifiers
-var verifier_registry = std.StringHashMap(VerifierEntry).init(global_allocator);
+/// Registered verifiers. Never modified once published: registration
+/// builds a new set and swaps it in, so fdb_proof_verify looks verifiers
+/// up without taking a lock.
+const VerifierSet = struct {
+    entries: []const VerifierEntry,
+
+    fn find(self: *const VerifierSet, verifier_type: []const u8) ?VerifierEntry {
+        for (self.entries) |entry| {
+            if (std.mem.eql(u8, entry.verifier_type, verifier_type)) return entry;
+        }
+        return null;
+    }
+};
+
+var verifiers: handles.ReadMostly(VerifierSet) = .{};
+
+/// Publish a copy of the current set with `verifier_type` removed and
+/// `added` (if any) appended. Returns false if there was nothing to remove
+/// or add. The type string owned by a removed entry is freed.
+fn updateVerifiers(verifier_type: []const u8, added: ?VerifierEntry) !bool {
+    verifiers.mutex.lock();
+    defer verifiers.mutex.unlock();
+
+    const old: []const VerifierEntry = if (verifiers.current.load(.acquire)) |set| set.entries else &.{};
+    var dropped: ?VerifierEntry = null;
+    for (old) |entry| {
+        if (std.mem.eql(u8, entry.verifier_type, verifier_type)) dropped = entry;
+    }
+    if (dropped == null and added == null) return false;
+
+    const len = old.len - @intFromBool(dropped != null) + @intFromBool(added != null);
+    var next: ?*VerifierSet = null;
+    if (len > 0) {
+        const entries = try global_allocator.alloc(VerifierEntry, len);
+        errdefer global_allocator.free(entries);
+        var n: usize = 0;
+        for (old) |entry| {
+            if (std.mem.eql(u8, entry.verifier_type, verifier_type)) continue;
+            entries[n] = entry;
+            n += 1;
+        }
+        if (added) |entry| entries[n] = entry;
+
+        next = try global_allocator.create(VerifierSet);
+        next.?.* = .{ .entries = entries };
+    }
+
+    // Waits for in-flight lookups of the old set before freeing it
+    if (verifiers.replaceLocked(next)) |previous| {
+        global_allocator.free(previous.entries);
+        global_allocator.destroy(previous);
+    }
+    if (dropped) |entry| global_allocator.free(entry.verifier_type);
+    return true;
+}
 
 /// Register a proof verifier for a specific proof type
 ///
@@ -942,9 +3319,10 @@ pub export fn fdb_proof_register_verifier(
         .context = context,
     };
 
-    verifier_registry.put(type_copy, entry) catch {
+    // Replaces any verifier already registered for the type
+    _ = updateVerifiers(type_copy, entry) catch {
         global_allocator.free(type_copy);
-        return .err_internal;
+        return .err_out_of_memory;
     };
 
     return .ok;
@@ -961,12 +3339,8 @@ pub export fn fdb_proof_unregister_verifier(
 ) LgStatus {
     const verifier_type = type_ptr[0..type_len];
 
-    if (verifier_registry.fetchRemove(verifier_type)) |entry| {
-        global_allocator.free(@constCast(entry.value.verifier_type));
-        return .ok;
-    }
-
-    return .err_not_found;
+    const removed = updateVerifiers(verifier_type, null) catch return .err_out_of_memory;
+    return if (removed) .ok else .err_not_found;
 }
 
 /// Verify a proof using registered verifiers
@@ -1015,7 +3389,10 @@ pub export fn fdb_proof_verify(
 
     const ptype = type_value.string;
 
-    const entry = verifier_registry.get(ptype) orelse {
+    const guard = verifiers.acquire();
+    const found = if (guard.value) |set| set.find(ptype) else null;
+    verifiers.release(guard);
+    const entry = found orelse {
         out_err.* = createErrorBlob(.err_not_found, "No verifier registered for proof type");
         return .err_not_found;
     };
@@ -1139,6 +3516,1164 @@ test "transaction lifecycle" {
     try std.testing.expectEqual(LgStatus.ok, commit_status);
 }
 
+test "closed handles are rejected" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_handles.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+
+    var first: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &first, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_abort(first));
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_txn_abort(first));
+
+    // The next transaction reuses the slot under a new generation
+    var second: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &second, &err_blob));
+    try std.testing.expect(first != second);
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_txn_commit(first, &err_blob));
+    fdb_blob_free(&err_blob);
+
+    // Closing the database also closes its open transaction
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_close(db));
+    try std.testing.expect(lookupTxn(second) == null);
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_db_close(db));
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_db_close(null));
+}
+
+test "verifiers can be replaced and removed" {
+    const Verifiers = struct {
+        fn accept(_: [*]const u8, _: usize, _: ?*anyopaque) callconv(.c) LgStatus {
+            return .ok;
+        }
+        fn reject(_: [*]const u8, _: usize, _: ?*anyopaque) callconv(.c) LgStatus {
+            return .err_invalid_argument;
+        }
+    };
+
+    const kind = "test-kind";
+    const proof = "{\"type\":\"test-kind\",\"data\":\"x\"}";
+    var valid = false;
+    var err_blob: LgBlob = undefined;
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_proof_register_verifier(kind.ptr, kind.len, Verifiers.accept, null));
+    try std.testing.expectEqual(LgStatus.ok, fdb_proof_verify(proof.ptr, proof.len, &valid, &err_blob));
+    try std.testing.expect(valid);
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_proof_register_verifier(kind.ptr, kind.len, Verifiers.reject, null));
+    try std.testing.expectEqual(LgStatus.ok, fdb_proof_verify(proof.ptr, proof.len, &valid, &err_blob));
+    try std.testing.expect(!valid);
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_proof_unregister_verifier(kind.ptr, kind.len));
+    try std.testing.expectEqual(LgStatus.err_not_found, fdb_proof_unregister_verifier(kind.ptr, kind.len));
+    try std.testing.expectEqual(LgStatus.err_not_found, fdb_proof_verify(proof.ptr, proof.len, &valid, &err_blob));
+    fdb_blob_free(&err_blob);
+}
+
+test "open options select buffer pool size" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_opts.fdb";
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    // {"buffer_pool_frames": 16}
+    const opts = [_]u8{0xA1} ++ [_]u8{0x72} ++ "buffer_pool_frames".* ++ [_]u8{0x10};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, &opts, opts.len, &db, &err_blob));
+
+    const state = lookupDb(db).?;
+    try std.testing.expectEqual(@as(u32, 16), state.storage.pool.?.stats().frames);
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_close(db));
+
+    // Not a CBOR map
+    const bad = [_]u8{0x01};
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_db_open(path.ptr, path.len, &bad, bad.len, &db, &err_blob));
+    fdb_blob_free(&err_blob);
+}
+
+test "journal checkpoints on demand and by segment count" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_checkpoint.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    // {"checkpoint_segments": 0}
+    const opts = [_]u8{0xA1} ++ [_]u8{0x73} ++ "checkpoint_segments".* ++ [_]u8{0x00};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, &opts, opts.len, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+
+    const state = lookupDb(db).?;
+    try std.testing.expectEqual(@as(u32, 0), state.storage.checkpoint_segments);
+    for (0..3) |_| _ = try state.storage.appendJournal("ENTRY");
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_checkpoint(db, &err_blob));
+    try std.testing.expectEqual(@as(u64, 4), state.storage.superblock.checkpoint_sequence);
+    try std.testing.expect(state.storage.superblock.archive_tail != 0);
+
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_db_checkpoint(null, &err_blob));
+    fdb_blob_free(&err_blob);
+}
+
+test "journal reads page through entries" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_journal_read.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+
+    const state = lookupDb(db).?;
+    for ([_][]const u8{ "first", "second \"quoted\"", "third" }) |forward| {
+        _ = try state.storage.appendJournal(forward);
+    }
+
+    var buf: [512]u8 = undefined;
+    var written: usize = 0;
+    try std.testing.expectEqual(LgStatus.ok, fdb_journal_read(db, 0, 2, &buf, buf.len, &written));
+    const page = buf[0..written];
+    try std.testing.expect(std.mem.startsWith(u8, page, "[{\"seq\":1,"));
+    try std.testing.expect(std.mem.indexOf(u8, page, "\"forward\":\"second \\\"quoted\\\"\"}]") != null);
+
+    // Too small for the first entry reports the size needed
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_journal_read(db, 3, 1, &buf, 16, &written));
+    try std.testing.expect(written > 16);
+    const needed = written;
+    try std.testing.expectEqual(LgStatus.ok, fdb_journal_read(db, 3, 1, &buf, needed, &written));
+    try std.testing.expectEqual(needed, written);
+
+    // Past the head
+    try std.testing.expectEqual(LgStatus.ok, fdb_journal_read(db, 4, 10, &buf, buf.len, &written));
+    try std.testing.expectEqualStrings("[]", buf[0..written]);
+
+    var text: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_render_journal(db, 2, json_opts, &text, &err_blob));
+    defer fdb_blob_free(&text);
+    const rendered = text.ptr.?[0..text.len];
+    try std.testing.expect(std.mem.indexOf(u8, rendered, "\"entries\":[{\"seq\":3,") != null);
+    try std.testing.expect(std.mem.endsWith(u8, rendered, "\"forward\":\"third\"}]}"));
+}
+
+test "read-only transaction reads its snapshot" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_snapshot.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+
+    var writer: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &writer, &err_blob));
+    const applied = fdb_apply(writer, "v1", 2);
+    try std.testing.expectEqual(LgStatus.ok, applied.status);
+    var applied_data = applied.data;
+    defer fdb_blob_free(&applied_data);
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(writer, &err_blob));
+
+    const db_state = lookupDb(db).?;
+    const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, applied_data.ptr.?[0..applied_data.len], .{});
+    defer parsed.deinit();
+    const doc_id: u64 = @intCast(parsed.value.object.get("block_id").?.integer);
+
+    var reader: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_only, &reader, &err_blob));
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &writer, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_update_block(writer, doc_id, "v2", 2, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(writer, &err_blob));
+
+    var snap_data: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_read_blocks(reader, @intFromEnum(blocks.BlockType.document), &snap_data, &err_blob));
+    defer fdb_blob_free(&snap_data);
+    try std.testing.expect(std.mem.indexOf(u8, snap_data.toSlice().?, "\"v1\"") != null);
+
+    var latest: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_read_blocks(db, @intFromEnum(blocks.BlockType.document), &latest, &err_blob));
+    defer fdb_blob_free(&latest);
+    try std.testing.expect(std.mem.indexOf(u8, latest.toSlice().?, "\"v2\"") != null);
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(reader, &err_blob));
+    try std.testing.expectEqual(@as(u32, 0), db_state.storage.versions.activeReaders());
+}
+
+test "cursor drains a type scan across calls" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_cursor_bridge.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+
+    var writer: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &writer, &err_blob));
+    for ([_][]const u8{ "alpha", "beta" }) |doc| {
+        const applied = fdb_apply(writer, doc.ptr, doc.len);
+        try std.testing.expectEqual(LgStatus.ok, applied.status);
+        var applied_data = applied.data;
+        fdb_blob_free(&applied_data);
+    }
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(writer, &err_blob));
+
+    var scan: ?*LgCursor = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_cursor_open_blocks(db, @intFromEnum(blocks.BlockType.document), json_opts, &scan, &err_blob));
+    defer fdb_cursor_close(scan);
+
+    // A buffer too small for one row reports the size it needs
+    var buf: [256]u8 = undefined;
+    var written: usize = 0;
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_cursor_next(scan, &buf, 4, &written));
+    try std.testing.expect(written > 4);
+
+    var rows: usize = 0;
+    while (fdb_cursor_next(scan, &buf, written, &written) == .ok) {
+        rows += std.mem.count(u8, buf[0..written], "\n");
+        written = buf.len;
+    }
+    try std.testing.expectEqual(@as(usize, 2), rows);
+    try std.testing.expectEqual(LgStatus.err_not_found, fdb_cursor_next(scan, &buf, buf.len, &written));
+    try std.testing.expectEqual(@as(usize, 0), written);
+}
+
+test "cbor render format leaves payloads unescaped" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_render_cbor.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+
+    const doc = "a\"b\x01";
+    var writer: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &writer, &err_blob));
+    const applied = fdb_apply(writer, doc.ptr, doc.len);
+    try std.testing.expectEqual(LgStatus.ok, applied.status);
+    var applied_data = applied.data;
+    fdb_blob_free(&applied_data);
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(writer, &err_blob));
+
+    const cbor_opts = LgRenderOpts{ .format = LG_RENDER_CBOR, .include_metadata = false };
+    var data: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_read_blocks_format(db, @intFromEnum(blocks.BlockType.document), cbor_opts, &data, &err_blob));
+    defer fdb_blob_free(&data);
+
+    var decoder = cbor.Decoder.init(std.testing.allocator, data.toSlice().?);
+    try std.testing.expectEqual(@as(usize, 1), try decoder.decodeArrayLen());
+    try std.testing.expectEqual(@as(usize, 3), try decoder.decodeMapLen());
+    _ = try decoder.decodeText();
+    const block_id = try decoder.decodeUint();
+    _ = try decoder.decodeText();
+    _ = try decoder.decodeUint();
+    _ = try decoder.decodeText();
+    try std.testing.expectEqualStrings(doc, try decoder.decodeBytes());
+
+    var rendered: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_render_block(db, block_id, cbor_opts, &rendered, &err_blob));
+    defer fdb_blob_free(&rendered);
+    try std.testing.expect(std.mem.endsWith(u8, rendered.toSlice().?, doc));
+
+    const bad_opts = LgRenderOpts{ .format = 7, .include_metadata = false };
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_read_blocks_format(db, @intFromEnum(blocks.BlockType.document), bad_opts, &data, &err_blob));
+    fdb_blob_free(&err_blob);
+}
+
+test "documents larger than a block round-trip" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_overflow_bridge.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+
+    const doc = try std.testing.allocator.alloc(u8, 50_000);
+    defer std.testing.allocator.free(doc);
+    for (doc, 0..) |*byte, i| byte.* = @truncate(i);
+
+    var writer: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &writer, &err_blob));
+    const applied = fdb_apply(writer, doc.ptr, doc.len);
+    try std.testing.expectEqual(LgStatus.ok, applied.status);
+    var applied_data = applied.data;
+    fdb_blob_free(&applied_data);
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(writer, &err_blob));
+
+    // Overflow blocks are not listed as documents of their own
+    const cbor_opts = LgRenderOpts{ .format = LG_RENDER_CBOR, .include_metadata = false };
+    var data: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_read_blocks_format(db, @intFromEnum(blocks.BlockType.document), cbor_opts, &data, &err_blob));
+    defer fdb_blob_free(&data);
+
+    var decoder = cbor.Decoder.init(std.testing.allocator, data.toSlice().?);
+    try std.testing.expectEqual(@as(usize, 1), try decoder.decodeArrayLen());
+    _ = try decoder.decodeMapLen();
+    _ = try decoder.decodeText();
+    _ = try decoder.decodeUint();
+    _ = try decoder.decodeText();
+    try std.testing.expectEqual(@as(u64, doc.len), try decoder.decodeUint());
+    _ = try decoder.decodeText();
+    try std.testing.expectEqualSlices(u8, doc, try decoder.decodeBytes());
+}
+
+test "batch apply inserts a contiguous extent" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_apply_batch.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+    const state = lookupDb(db).?;
+
+    const docs = [_]LgBlob{ LgBlob.fromSlice("alpha"), LgBlob.fromSlice("beta"), LgBlob.fromSlice("gamma") };
+    var ids: [docs.len]u64 = undefined;
+
+    for ([_]u32{ 0, LG_APPLY_BULK_LOAD }) |flags| {
+        const head = state.storage.journalHead();
+
+        var writer: ?*LgTxn = null;
+        try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &writer, &err_blob));
+        try std.testing.expectEqual(LgStatus.ok, fdb_apply_batch(writer, &docs, docs.len, flags, &ids, &err_blob));
+        try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(writer, &err_blob));
+
+        for (docs, ids, 0..) |doc, id, i| {
+            try std.testing.expectEqual(ids[0] + i, id);
+            const block = try state.storage.readBlock(id);
+            try std.testing.expectEqualStrings(doc.toSlice().?, block.getPayload());
+        }
+
+        // One entry per document, or a single BULK_INSERT for the extent
+        var reader = try journal.JournalReader.open(std.testing.allocator, state.storage, head + 1);
+        defer reader.close();
+        var entries: usize = 0;
+        while (try reader.next()) |entry| : (entries += 1) {
+            const expected_op = if (flags == 0) "DOC_INSERT" else "BULK_INSERT";
+            try std.testing.expectEqualStrings(expected_op, journal.opName(entry.header.op_type));
+        }
+        try std.testing.expectEqual(@as(usize, if (flags == 0) docs.len else 1), entries);
+    }
+
+    // An oversized op rejects the whole batch
+    const too_big = try std.testing.allocator.alloc(u8, blocks.MAX_DOCUMENT_SIZE + 1);
+    defer std.testing.allocator.free(too_big);
+    const bad = [_]LgBlob{ LgBlob.fromSlice("ok"), LgBlob.fromSlice(too_big) };
+    var writer: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &writer, &err_blob));
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_apply_batch(writer, &bad, bad.len, 0, &ids, &err_blob));
+    fdb_blob_free(&err_blob);
+    const txn_state = lookupTxn(writer).?;
+    try std.testing.expectEqual(@as(usize, 0), txn_state.pending_writes.items.len);
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_abort(writer));
+}
+
+const AsyncCompletions = struct {
+    count: std.atomic.Value(usize) = .init(0),
+    failures: std.atomic.Value(usize) = .init(0),
+
+    fn done(ctx: ?*anyopaque, status: LgStatus, err: LgBlob) callconv(.c) void {
+        const self: *AsyncCompletions = @ptrCast(@alignCast(ctx.?));
+        var err_blob = err;
+        fdb_blob_free(&err_blob);
+        if (status != .ok) _ = self.failures.fetchAdd(1, .monotonic);
+        _ = self.count.fetchAdd(1, .release);
+    }
+};
+
+test "async commits complete through the callback" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_commit_async.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    const head = lookupDb(db).?.storage.journalHead();
+
+    const n_txns = 64;
+    var completions = AsyncCompletions{};
+    for (0..n_txns) |_| {
+        var writer: ?*LgTxn = null;
+        try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &writer, &err_blob));
+        var result = fdb_apply(writer, "async".ptr, 5);
+        try std.testing.expectEqual(LgStatus.ok, result.status);
+        fdb_blob_free(&result.data);
+        try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit_async(writer, AsyncCompletions.done, &completions, &err_blob));
+
+        // The handle is gone as soon as the commit is queued
+        try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_txn_commit(writer, &err_blob));
+        fdb_blob_free(&err_blob);
+    }
+
+    // Close waits for the queue to drain
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_close(db));
+    try std.testing.expectEqual(@as(usize, n_txns), completions.count.load(.acquire));
+    try std.testing.expectEqual(@as(usize, 0), completions.failures.load(.monotonic));
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+    try std.testing.expectEqual(head + n_txns, lookupDb(db).?.storage.journalHead());
+}
+
+test "block views borrow pool frames and outlive rewrites" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_block_view.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    const storage = lookupDb(db).?.storage;
+
+    const big = try std.testing.allocator.alloc(u8, blocks.PAYLOAD_SIZE * 3);
+    defer std.testing.allocator.free(big);
+    @memset(big, 'x');
+    const docs = [_]LgBlob{ LgBlob.fromSlice("original"), LgBlob.fromSlice(big) };
+    var ids: [docs.len]u64 = undefined;
+    var writer: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &writer, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_apply_batch(writer, &docs, docs.len, 0, &ids, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(writer, &err_blob));
+
+    // A single-block document is a view of the pinned frame
+    var small: LgView = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_read_block_view(db, ids[0], &small, &err_blob));
+    try std.testing.expectEqualStrings("original", small.ptr.?[0..small.len]);
+    try std.testing.expect(view_handles.get(@intCast(small.token)).?.frame != null);
+
+    // Rewriting it detaches the frame instead of changing the view
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &writer, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_update_block(writer, ids[0], "rewritten", 9, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(writer, &err_blob));
+    try std.testing.expectEqualStrings("original", small.ptr.?[0..small.len]);
+
+    var fresh: LgView = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_read_block_view(db, ids[0], &fresh, &err_blob));
+    try std.testing.expectEqualStrings("rewritten", fresh.ptr.?[0..fresh.len]);
+    fdb_view_release(&fresh);
+    try std.testing.expect(fresh.ptr == null);
+
+    // A chained document is reassembled into memory the view owns
+    var chained: LgView = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_read_block_view(db, ids[1], &chained, &err_blob));
+    try std.testing.expectEqualSlices(u8, big, chained.ptr.?[0..chained.len]);
+    try std.testing.expect(view_handles.get(@intCast(chained.token)).?.frame == null);
+    fdb_view_release(&chained);
+    fdb_view_release(&chained);
+
+    // Journal segments are not documents
+    var seg: LgView = undefined;
+    try std.testing.expectEqual(LgStatus.err_not_found, fdb_read_block_view(db, storage.superblock.journal_tail, &seg, &err_blob));
+    fdb_blob_free(&err_blob);
+
+    // Closing with a view still out defers to its release
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_close(db));
+    try std.testing.expectEqualStrings("original", small.ptr.?[0..small.len]);
+    fdb_view_release(&small);
+}
+
+test "stats report commit phases and I/O counters" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_stats.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+
+    var txn: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+    const applied = fdb_apply(txn, "{\"n\":1}", 7);
+    try std.testing.expectEqual(LgStatus.ok, applied.status);
+    var applied_data = applied.data;
+    fdb_blob_free(&applied_data);
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+
+    var out: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_stats(db, &out, &err_blob));
+    defer fdb_blob_free(&out);
+
+    const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, out.ptr.?[0..out.len], .{});
+    defer parsed.deinit();
+    const root = parsed.value.object;
+    try std.testing.expectEqual(@as(i64, @intCast(fdb_db_sync_count(db))), root.get("fsyncs").?.integer);
+    try std.testing.expect(root.get("blocks_written").?.integer >= 3);
+    try std.testing.expectEqual(@as(i64, 0), root.get("crc_failures").?.integer);
+
+    const phases = root.get("commit_phases").?.object;
+    for ([_][]const u8{ "journal", "journal_write", "blocks", "deletes", "block_write", "publish" }) |name| {
+        try std.testing.expectEqual(@as(i64, 1), phases.get(name).?.object.get("count").?.integer);
+    }
+
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_stats(null, &out, &err_blob));
+    fdb_blob_free(&err_blob);
+}
+
+test "queries filter inside the scan and explain the blocks they read" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_query.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+
+    const docs = [_][]const u8{
+        \\{"collection":"evidence","title":"A","score":95}
+        ,
+        \\{"collection":"evidence","title":"B","score":40}
+        ,
+        \\{"collection":"notes","title":"C","score":99}
+        ,
+        \\{"collection":"evidence","title":"D","score":88}
+        ,
+    };
+    var ids: [docs.len]u64 = undefined;
+    var txn: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+    for (docs, &ids) |doc, *id| {
+        const applied = fdb_apply(txn, doc.ptr, doc.len);
+        try std.testing.expectEqual(LgStatus.ok, applied.status);
+        var applied_data = applied.data;
+        defer fdb_blob_free(&applied_data);
+        const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, applied_data.ptr.?[0..applied_data.len], .{});
+        defer parsed.deinit();
+        id.* = @intCast(parsed.value.object.get("block_id").?.integer);
+    }
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+
+    // Matching documents come back projected, in block order
+    const select = "SELECT title FROM evidence WHERE score > 50";
+    var cursor: ?*LgCursor = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_query_execute(db, select.ptr, select.len, null, 0, &cursor));
+    defer fdb_cursor_close(cursor);
+
+    var buf: [1024]u8 = undefined;
+    var written: usize = 0;
+    try std.testing.expectEqual(LgStatus.ok, fdb_cursor_next(cursor, &buf, buf.len, &written));
+    const rows = buf[0..written];
+    try std.testing.expectEqual(@as(usize, 2), std.mem.count(u8, rows, "\n"));
+    try std.testing.expect(std.mem.indexOf(u8, rows, "{\\\"title\\\":\\\"A\\\"}") != null);
+    try std.testing.expect(std.mem.indexOf(u8, rows, "{\\\"title\\\":\\\"D\\\"}") != null);
+    try std.testing.expectEqual(LgStatus.err_not_found, fdb_cursor_next(cursor, &buf, buf.len, &written));
+
+    // The scan read every document; the second run reuses the plan
+    try std.testing.expectEqual(LgStatus.ok, fdb_query_explain(db, select.ptr, select.len, &buf, buf.len, &written));
+    {
+        const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, buf[0..written], .{});
+        defer parsed.deinit();
+        const root = parsed.value.object;
+        try std.testing.expect(root.get("cached").?.bool);
+        try std.testing.expectEqualStrings("type_scan", root.get("plan").?.object.get("access").?.string);
+        try std.testing.expectEqual(@as(i64, 4), root.get("estimated_blocks").?.integer);
+        try std.testing.expectEqual(@as(i64, 4), root.get("actual_blocks").?.integer);
+        try std.testing.expectEqual(@as(i64, 2), root.get("rows").?.integer);
+    }
+
+    // A block-ID lookup reads only the blocks it names
+    var lookup_buf: [128]u8 = undefined;
+    const lookup = try std.fmt.bufPrint(&lookup_buf, "select * from evidence where _id in ({d}, {d})", .{ ids[1], ids[2] });
+    try std.testing.expectEqual(LgStatus.ok, fdb_query_explain(db, lookup.ptr, lookup.len, &buf, buf.len, &written));
+    {
+        const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, buf[0..written], .{});
+        defer parsed.deinit();
+        const root = parsed.value.object;
+        try std.testing.expect(!root.get("cached").?.bool);
+        try std.testing.expectEqualStrings("block_ids", root.get("plan").?.object.get("access").?.string);
+        try std.testing.expectEqual(@as(i64, 2), root.get("estimated_blocks").?.integer);
+        try std.testing.expectEqual(@as(i64, 2), root.get("actual_blocks").?.integer);
+        // The "notes" document is read but not returned
+        try std.testing.expectEqual(@as(i64, 1), root.get("rows").?.integer);
+    }
+
+    // Too small a buffer reports the size needed
+    var tiny: [8]u8 = undefined;
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_query_explain(db, select.ptr, select.len, &tiny, tiny.len, &written));
+    try std.testing.expect(written > tiny.len);
+
+    const invalid = "SELECT FROM";
+    var rejected: ?*LgCursor = null;
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_query_execute(db, invalid.ptr, invalid.len, null, 0, &rejected));
+    try std.testing.expect(rejected == null);
+}
+
+test "parallel scans return every row in block order" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_parallel_scan.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    // {"scan_workers": 4}
+    const opts = [_]u8{0xA1} ++ [_]u8{0x6C} ++ "scan_workers".* ++ [_]u8{0x04};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, &opts, opts.len, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+    try std.testing.expectEqual(@as(u32, 4), lookupDb(db).?.scanners.workers);
+
+    // Enough documents for several morsels, the last one short
+    const count = 3 * parallel_scan.MORSEL_BLOCKS + 40;
+    var txn: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+    for (0..count) |n| {
+        var doc_buf: [32]u8 = undefined;
+        const doc = try std.fmt.bufPrint(&doc_buf, "{{\"n\":{d}}}", .{n});
+        const applied = fdb_apply(txn, doc.ptr, doc.len);
+        try std.testing.expectEqual(LgStatus.ok, applied.status);
+        var applied_data = applied.data;
+        fdb_blob_free(&applied_data);
+    }
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+
+    var out: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_read_blocks(db, @intFromEnum(blocks.BlockType.document), &out, &err_blob));
+    defer fdb_blob_free(&out);
+
+    const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, out.ptr.?[0..out.len], .{});
+    defer parsed.deinit();
+    const rows = parsed.value.array.items;
+    try std.testing.expectEqual(@as(usize, count), rows.len);
+    var last_id: i64 = 0;
+    for (rows) |row| {
+        const id = row.object.get("block_id").?.integer;
+        try std.testing.expect(id > last_id);
+        last_id = id;
+    }
+
+    // The CBOR framing counts rows across morsels
+    var cbor_out: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_read_blocks_format(db, @intFromEnum(blocks.BlockType.document), .{ .format = LG_RENDER_CBOR, .include_metadata = false }, &cbor_out, &err_blob));
+    defer fdb_blob_free(&cbor_out);
+    var decoder = cbor.Decoder.init(std.testing.allocator, cbor_out.ptr.?[0..cbor_out.len]);
+    try std.testing.expectEqual(@as(usize, count), try decoder.decodeArrayLen());
+}
+
+test "columnar exports follow the journal from a sequence" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_columnar.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+
+    const docs = [_][]const u8{
+        \\{"collection":"evidence","score":95}
+        ,
+        \\{"collection":"notes","score":10}
+        ,
+        \\{"collection":"evidence","score":40}
+        ,
+    };
+    var ids: [docs.len]u64 = undefined;
+    var txn: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+    for (docs, &ids) |doc, *id| {
+        const applied = fdb_apply(txn, doc.ptr, doc.len);
+        try std.testing.expectEqual(LgStatus.ok, applied.status);
+        var applied_data = applied.data;
+        defer fdb_blob_free(&applied_data);
+        const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, applied_data.ptr.?[0..applied_data.len], .{});
+        defer parsed.deinit();
+        id.* = @intCast(parsed.value.object.get("block_id").?.integer);
+    }
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+
+    const collection = "evidence";
+    const fields = "score";
+    const Summary = struct {
+        sequence: u64,
+        rows: u64,
+        deleted: []const u8,
+
+        fn of(blob: LgBlob) !@This() {
+            var decoder = cbor.Decoder.init(std.testing.allocator, blob.ptr.?[0..blob.len]);
+            _ = try decoder.decodeMapLen();
+            for (0..2) |_| try decoder.skip(); // since
+            _ = try decoder.decodeText();
+            const sequence = try decoder.decodeUint();
+            _ = try decoder.decodeText();
+            const rows = try decoder.decodeUint();
+            _ = try decoder.decodeText();
+            return .{ .sequence = sequence, .rows = rows, .deleted = try decoder.decodeBytes() };
+        }
+    };
+
+    var full: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_export_columnar(db, collection.ptr, collection.len, fields.ptr, fields.len, 0, &full, &err_blob));
+    defer fdb_blob_free(&full);
+    const first = try Summary.of(full);
+    try std.testing.expectEqual(@as(u64, 2), first.rows);
+    try std.testing.expectEqual(@as(usize, 0), first.deleted.len);
+
+    // Update one evidence document, delete the other, insert a third
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+    const updated =
+        \\{"collection":"evidence","score":97}
+    ;
+    try std.testing.expectEqual(LgStatus.ok, fdb_update_block(txn, ids[0], updated.ptr, updated.len, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_delete_block(txn, ids[2], &err_blob));
+    const added =
+        \\{"collection":"evidence","score":12.5}
+    ;
+    const applied = fdb_apply(txn, added.ptr, added.len);
+    try std.testing.expectEqual(LgStatus.ok, applied.status);
+    var applied_data = applied.data;
+    fdb_blob_free(&applied_data);
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+
+    // Only the three written blocks move
+    var delta: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_export_columnar(db, collection.ptr, collection.len, fields.ptr, fields.len, first.sequence, &delta, &err_blob));
+    defer fdb_blob_free(&delta);
+    const second = try Summary.of(delta);
+    try std.testing.expect(second.sequence > first.sequence);
+    try std.testing.expectEqual(@as(u64, 2), second.rows);
+    try std.testing.expectEqual(@as(usize, 8), second.deleted.len);
+    try std.testing.expectEqual(ids[2], std.mem.readInt(u64, second.deleted[0..8], .little));
+
+    // Nothing since the latest sequence; a sequence from the future is refused
+    var empty: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_export_columnar(db, collection.ptr, collection.len, fields.ptr, fields.len, second.sequence, &empty, &err_blob));
+    defer fdb_blob_free(&empty);
+    try std.testing.expectEqual(@as(u64, 0), (try Summary.of(empty)).rows);
+
+    var refused: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_export_columnar(db, collection.ptr, collection.len, fields.ptr, fields.len, second.sequence + 100, &refused, &err_blob));
+    fdb_blob_free(&err_blob);
+    const bad_fields = "score,,title";
+    try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_export_columnar(db, collection.ptr, collection.len, bad_fields.ptr, bad_fields.len, 0, &refused, &err_blob));
+    fdb_blob_free(&err_blob);
+}
+
+test "followers apply journal shipments and resume from their watermark" {
+    var leader: ?*LgDb = null;
+    var follower: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const leader_path = "test_ship_leader.fdb";
+    const follower_path = "test_ship_follower.fdb";
+    for ([_][]const u8{ leader_path, follower_path }) |path| std.fs.cwd().deleteFile(path) catch {};
+    defer for ([_][]const u8{ leader_path, follower_path }) |path| std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(leader_path.ptr, leader_path.len, null, 0, &leader, &err_blob));
+    defer _ = fdb_db_close(leader);
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(follower_path.ptr, follower_path.len, null, 0, &follower, &err_blob));
+
+    // Three inserts, then an update, a delete and a bulk load
+    var ids: [3]u64 = undefined;
+    var txn: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(leader, .read_write, &txn, &err_blob));
+    for (&ids, 0..) |*id, i| {
+        var doc_buf: [32]u8 = undefined;
+        const doc = try std.fmt.bufPrint(&doc_buf, "{{\"n\":{d}}}", .{i});
+        const applied = fdb_apply(txn, doc.ptr, doc.len);
+        try std.testing.expectEqual(LgStatus.ok, applied.status);
+        var applied_data = applied.data;
+        defer fdb_blob_free(&applied_data);
+        const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, applied_data.ptr.?[0..applied_data.len], .{});
+        defer parsed.deinit();
+        id.* = @intCast(parsed.value.object.get("block_id").?.integer);
+    }
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(leader, .read_write, &txn, &err_blob));
+    const updated = "{\"n\":\"updated\"}";
+    try std.testing.expectEqual(LgStatus.ok, fdb_update_block(txn, ids[0], updated.ptr, updated.len, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_delete_block(txn, ids[1], &err_blob));
+    const bulk = [_][]const u8{ "{\"bulk\":1}", "{\"bulk\":2}" };
+    var bulk_ops: [bulk.len]LgBlob = undefined;
+    for (bulk, &bulk_ops) |doc, *op| op.* = .{ .ptr = doc.ptr, .len = doc.len };
+    var bulk_ids: [bulk.len]u64 = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_apply_batch(txn, &bulk_ops, bulk.len, LG_APPLY_BULK_LOAD, &bulk_ids, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+    const leader_head = lookupDb(leader).?.storage.journalHead();
+
+    // Ship one entry at a time, compressed, until the follower is current
+    var watermark: u64 = 0;
+    var shipments: usize = 0;
+    while (true) : (shipments += 1) {
+        var shipment: LgBlob = undefined;
+        try std.testing.expectEqual(LgStatus.ok, fdb_replication_read(leader, watermark + 1, 1, LG_SHIP_LZ4, &shipment, &err_blob));
+        defer fdb_blob_free(&shipment);
+        const before = watermark;
+        try std.testing.expectEqual(LgStatus.ok, fdb_replication_apply(follower, shipment.ptr.?, shipment.len, &watermark, &err_blob));
+        if (watermark == before) break;
+
+        // Applying it twice changes nothing
+        try std.testing.expectEqual(LgStatus.ok, fdb_replication_apply(follower, shipment.ptr.?, shipment.len, &watermark, &err_blob));
+    }
+    try std.testing.expectEqual(leader_head, watermark);
+    try std.testing.expectEqual(@as(usize, @intCast(leader_head)), shipments);
+
+    var rows: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_read_blocks(follower, @intFromEnum(blocks.BlockType.document), &rows, &err_blob));
+    const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, rows.toSlice().?, .{});
+    defer parsed.deinit();
+    try std.testing.expectEqual(@as(usize, 4), parsed.value.array.items.len);
+    try std.testing.expect(std.mem.indexOf(u8, rows.toSlice().?, "updated") != null);
+    try std.testing.expect(std.mem.indexOf(u8, rows.toSlice().?, "bulk") != null);
+    fdb_blob_free(&rows);
+
+    // A shipment that skips ahead of the watermark is refused
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(leader, .read_write, &txn, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_delete_block(txn, ids[0], &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_delete_block(txn, ids[2], &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+    var skipped: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_replication_read(leader, watermark + 2, 0, 0, &skipped, &err_blob));
+    try std.testing.expectEqual(LgStatus.err_conflict, fdb_replication_apply(follower, skipped.ptr.?, skipped.len, &watermark, &err_blob));
+    fdb_blob_free(&err_blob);
+    fdb_blob_free(&skipped);
+
+    // After a restart the follower resumes from the journal it wrote, and
+    // deletes still find the local blocks
+    _ = fdb_db_close(follower);
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(follower_path.ptr, follower_path.len, null, 0, &follower, &err_blob));
+    defer _ = fdb_db_close(follower);
+    var resumed: u64 = 0;
+    try std.testing.expectEqual(LgStatus.ok, fdb_replication_watermark(follower, &resumed, &err_blob));
+    try std.testing.expectEqual(watermark, resumed);
+
+    var rest: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_replication_read(leader, resumed + 1, 0, 0, &rest, &err_blob));
+    defer fdb_blob_free(&rest);
+    try std.testing.expectEqual(LgStatus.ok, fdb_replication_apply(follower, rest.ptr.?, rest.len, &watermark, &err_blob));
+    try std.testing.expectEqual(lookupDb(leader).?.storage.journalHead(), watermark);
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_read_blocks(follower, @intFromEnum(blocks.BlockType.document), &rows, &err_blob));
+    defer fdb_blob_free(&rows);
+    const remaining = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, rows.toSlice().?, .{});
+    defer remaining.deinit();
+    try std.testing.expectEqual(@as(usize, 2), remaining.value.array.items.len);
+    try std.testing.expect(std.mem.indexOf(u8, rows.toSlice().?, "updated") == null);
+}
+
+test "spatial indexes persist and merge the journal written since their sync" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_spatial.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+
+    const Rows = struct {
+        fn ids(blob: *LgBlob) ![]u64 {
+            defer fdb_blob_free(blob);
+            const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, blob.ptr.?[0..blob.len], .{});
+            defer parsed.deinit();
+            const rows = parsed.value.array.items;
+            const out = try std.testing.allocator.alloc(u64, rows.len);
+            for (rows, out) |row, *id| id.* = @intCast(row.object.get("block_id").?.integer);
+            return out;
+        }
+    };
+
+    // A 30 x 30 grid spans several leaves; one document elsewhere
+    var txn: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+    var first_id: u64 = 0;
+    var doc_buf: [128]u8 = undefined;
+    for (0..900) |i| {
+        const doc = try std.fmt.bufPrint(&doc_buf, "{{\"collection\":\"sites\",\"location\":{{\"lat\":{d},\"lon\":{d}}}}}", .{ @as(f64, @floatFromInt(i / 30)), @as(f64, @floatFromInt(i % 30)) });
+        const applied = fdb_apply(txn, doc.ptr, doc.len);
+        try std.testing.expectEqual(LgStatus.ok, applied.status);
+        var applied_data = applied.data;
+        defer fdb_blob_free(&applied_data);
+        if (i == 0) {
+            const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, applied_data.ptr.?[0..applied_data.len], .{});
+            defer parsed.deinit();
+            first_id = @intCast(parsed.value.object.get("block_id").?.integer);
+        }
+    }
+    const other =
+        \\{"collection":"finds","location":[5,2.5]}
+    ;
+    const applied_other = fdb_apply(txn, other.ptr, other.len);
+    var other_data = applied_other.data;
+    fdb_blob_free(&other_data);
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+
+    const collection = "sites";
+    const field = "location";
+    var rows: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.err_not_found, fdb_spatial_query_bbox(db, collection.ptr, collection.len, field.ptr, field.len, 0, 0, 1, 1, &rows, &err_blob));
+    fdb_blob_free(&err_blob);
+
+    var entries: u64 = 0;
+    try std.testing.expectEqual(LgStatus.ok, fdb_spatial_sync(db, collection.ptr, collection.len, field.ptr, field.len, &entries, &err_blob));
+    try std.testing.expectEqual(@as(u64, 900), entries);
+
+    // lat 2..3 x lon 4..6: six documents, none from "finds"
+    try std.testing.expectEqual(LgStatus.ok, fdb_spatial_query_bbox(db, collection.ptr, collection.len, field.ptr, field.len, 4, 2, 6, 3, &rows, &err_blob));
+    const boxed = try Rows.ids(&rows);
+    defer std.testing.allocator.free(boxed);
+    try std.testing.expectEqual(@as(usize, 6), boxed.len);
+    try std.testing.expectEqual(first_id + 2 * 30 + 4, boxed[0]);
+
+    // Move one document into the box and delete one from it, without a sync
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+    const moved =
+        \\{"collection":"sites","location":{"lat":2.5,"lon":5.5}}
+    ;
+    try std.testing.expectEqual(LgStatus.ok, fdb_update_block(txn, first_id + 899, moved.ptr, moved.len, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_delete_block(txn, first_id + 2 * 30 + 4, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_spatial_query_bbox(db, collection.ptr, collection.len, field.ptr, field.len, 4, 2, 6, 3, &rows, &err_blob));
+    const merged = try Rows.ids(&rows);
+    defer std.testing.allocator.free(merged);
+    try std.testing.expectEqual(@as(usize, 6), merged.len);
+    try std.testing.expectEqual(first_id + 2 * 30 + 5, merged[0]);
+    try std.testing.expectEqual(first_id + 899, merged[5]);
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_spatial_nearest(db, collection.ptr, collection.len, field.ptr, field.len, 5.6, 2.6, 2, &rows, &err_blob));
+    const near = try Rows.ids(&rows);
+    defer std.testing.allocator.free(near);
+    try std.testing.expectEqual(@as(usize, 2), near.len);
+    try std.testing.expectEqual(first_id + 899, near[0]);
+
+    // The incremental sync folds the changes in and survives a reopen
+    try std.testing.expectEqual(LgStatus.ok, fdb_spatial_sync(db, collection.ptr, collection.len, field.ptr, field.len, &entries, &err_blob));
+    try std.testing.expectEqual(@as(u64, 899), entries);
+    _ = fdb_db_close(db);
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_spatial_sync(db, collection.ptr, collection.len, field.ptr, field.len, &entries, &err_blob));
+    try std.testing.expectEqual(@as(u64, 899), entries);
+    try std.testing.expectEqual(LgStatus.ok, fdb_spatial_query_bbox(db, collection.ptr, collection.len, field.ptr, field.len, 4, 2, 6, 3, &rows, &err_blob));
+    const reopened = try Rows.ids(&rows);
+    defer std.testing.allocator.free(reopened);
+    try std.testing.expectEqualSlices(u64, merged, reopened);
+}
+
+test "scrubbing finds corrupted blocks and resumes from its checkpoint" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_scrub.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+
+    var txn: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+    var victim: u64 = 0;
+    for (0..3) |i| {
+        const applied = fdb_apply(txn, "{\"n\":1}", 7);
+        try std.testing.expectEqual(LgStatus.ok, applied.status);
+        var applied_data = applied.data;
+        defer fdb_blob_free(&applied_data);
+        if (i == 1) {
+            const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, applied_data.ptr.?[0..applied_data.len], .{});
+            defer parsed.deinit();
+            victim = @intCast(parsed.value.object.get("block_id").?.integer);
+        }
+    }
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+
+    var ids: [4]u64 = undefined;
+    var count: usize = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_verify_checksums(db, &ids, ids.len, &count, &err_blob));
+    try std.testing.expectEqual(@as(usize, 0), count);
+
+    // Flip a payload bit behind the engine's back
+    {
+        const file = try std.fs.cwd().openFile(path, .{ .mode = .read_write });
+        defer file.close();
+        const offset = victim * blocks.BLOCK_SIZE + blocks.HEADER_SIZE + 2;
+        var byte: [1]u8 = undefined;
+        _ = try file.preadAll(&byte, offset);
+        byte[0] ^= 0x01;
+        try file.pwriteAll(&byte, offset);
+    }
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_verify_checksums(db, &ids, ids.len, &count, &err_blob));
+    try std.testing.expectEqual(@as(usize, 1), count);
+    try std.testing.expectEqual(victim, ids[0]);
+    try std.testing.expectEqual(LgStatus.ok, fdb_verify_checksums(db, null, 0, &count, &err_blob));
+    try std.testing.expectEqual(@as(usize, 1), count);
+
+    var out: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_stats(db, &out, &err_blob));
+    {
+        defer fdb_blob_free(&out);
+        const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator, out.ptr.?[0..out.len], .{});
+        defer parsed.deinit();
+        const report = parsed.value.object.get("scrub").?.object;
+        try std.testing.expectEqual(@as(i64, 3), report.get("passes").?.integer);
+        const corrupted = report.get("corrupted").?.array.items;
+        try std.testing.expectEqual(@as(usize, 1), corrupted.len);
+        try std.testing.expectEqual(@as(i64, @intCast(victim)), corrupted[0].integer);
+    }
+
+    // The checkpoint lives in the superblock
+    try lookupDb(db).?.storage.saveScrubCheckpoint(.{ .active = true, .next = victim, .pass_started = 1000 });
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_close(db));
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    const resumed = lookupDb(db).?.storage.scrubCheckpoint();
+    try std.testing.expect(resumed.active);
+    try std.testing.expectEqual(victim, resumed.next);
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_close(db));
+
+    if (builtin.single_threaded) return;
+
+    // {"scrub_mib_per_sec": 64}: the background pass picks up at the
+    // victim, finishes and records its end
+    const opts = [_]u8{0xA1} ++ [_]u8{0x71} ++ "scrub_mib_per_sec".* ++ [_]u8{ 0x18, 0x40 };
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, &opts, opts.len, &db, &err_blob));
+    const report = &lookupDb(db).?.storage.stats.scrub;
+    var waited: usize = 0;
+    while (report.passes.load(.monotonic) == 0 and waited < 5000) : (waited += 1) std.Thread.sleep(std.time.ns_per_ms);
+    try std.testing.expectEqual(@as(u64, 1), report.passes.load(.monotonic));
+    try std.testing.expect(report.reported.load(.acquire) == 1);
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_close(db));
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+    const finished = lookupDb(db).?.storage.scrubCheckpoint();
+    try std.testing.expect(!finished.active);
+    try std.testing.expect(finished.pass_completed != 0);
+}
+
+test "updates and deletes reject anything but a live document" {
+    const path = "test_reject_non_documents.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+
+    // A document, one deleted again and one spanning an overflow chain
+    var large: [2 * blocks.PAYLOAD_SIZE]u8 = undefined;
+    @memset(&large, 'x');
+    const docs = [_]LgBlob{ LgBlob.fromSlice("kept"), LgBlob.fromSlice("freed"), LgBlob.fromSlice(&large) };
+    var ids: [3]u64 = undefined;
+    var txn: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_apply_batch(txn, &docs, docs.len, 0, &ids, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_delete_block(txn, ids[1], &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+
+    const storage = lookupDb(db).?.storage;
+    const sb = storage.superblock;
+    const chain = (try blocks.OverflowHeader.of(&(try storage.readBlock(ids[2])))).?;
+    try std.testing.expect(sb.free_map_tail != 0);
+    try std.testing.expect(sb.journal_tail != 0);
+
+    const rejected = [_]u64{
+        0, // superblock
+        sb.free_map_tail,
+        sb.journal_tail,
+        chain.first_block,
+        ids[1], // freed
+        storage.blockCount(),
+        std.math.maxInt(u64),
+    };
+    for (rejected) |block_id| {
+        try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+        defer _ = fdb_txn_abort(txn);
+        try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_update_block(txn, block_id, "x", 1, &err_blob));
+        fdb_blob_free(&err_blob);
+        try std.testing.expectEqual(LgStatus.err_invalid_argument, fdb_delete_block(txn, block_id, &err_blob));
+        fdb_blob_free(&err_blob);
+        try std.testing.expectEqual(@as(usize, 0), lookupTxn(txn).?.pending_writes.items.len);
+        try std.testing.expectEqual(@as(usize, 0), lookupTxn(txn).?.pending_deletes.items.len);
+    }
+
+    // Commit checks the frees again, in case they changed since
+    const frees = [_]u64{ sb.free_map_tail, chain.first_block };
+    for (frees) |block_id| {
+        const records = [_]blocks.JournalRecord{.{ .op = .doc_delete, .affected_block = block_id, .forward = "DELETE" }};
+        var batch = blocks.CommitBatch{ .journal = &records, .frees = (&block_id)[0..1] };
+        try std.testing.expectError(error.WrongBlockType, storage.commit(&batch));
+    }
+
+    // The kept document still updates, and the file still opens
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_update_block(txn, ids[0], "again", 5, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_close(db));
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+    const reopened = lookupDb(db).?.storage;
+    try std.testing.expectEqualStrings("again", (try reopened.readBlock(ids[0])).getPayload());
+    const doc = try reopened.readDocument(std.testing.allocator, ids[2], null);
+    defer std.testing.allocator.free(doc);
+    try std.testing.expectEqualSlices(u8, &large, doc);
+}
+
+test "a spatial sync with nothing written since is current" {
+    var db: ?*LgDb = null;
+    var err_blob: LgBlob = undefined;
+
+    const path = "test_spatial_current.fdb";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+    try std.testing.expectEqual(LgStatus.ok, fdb_db_open(path.ptr, path.len, null, 0, &db, &err_blob));
+    defer _ = fdb_db_close(db);
+
+    var txn: ?*LgTxn = null;
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_begin(db, .read_write, &txn, &err_blob));
+    const doc =
+        \{"collection":"sites","location":[5,2.5]}
+    ;
+    const applied = fdb_apply(txn, doc.ptr, doc.len);
+    try std.testing.expectEqual(LgStatus.ok, applied.status);
+    var applied_data = applied.data;
+    fdb_blob_free(&applied_data);
+    try std.testing.expectEqual(LgStatus.ok, fdb_txn_commit(txn, &err_blob));
+
+    const collection = "sites";
+    const field = "location";
+    var entries: u64 = 0;
+    try std.testing.expectEqual(LgStatus.ok, fdb_spatial_sync(db, collection.ptr, collection.len, field.ptr, field.len, &entries, &err_blob));
+    try std.testing.expectEqual(@as(u64, 1), entries);
+
+    // The second sync only sees the first one's INDEX_CREATE entry: it
+    // commits nothing and reserves no blocks
+    const storage = lookupDb(db).?.storage;
+    const head = storage.journalHead();
+    const count = storage.blockCount();
+    const free = storage.freeBlockCount();
+    var meta_payload: [blocks.PAYLOAD_SIZE]u8 = undefined;
+    const snap = try storage.beginSnapshot();
+    defer storage.endSnapshot(snap);
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const prepared = try prepareSpatialCommit(storage, snap, arena.allocator(), collection, field);
+    try std.testing.expect(prepared == .current);
+    try std.testing.expectEqual(@as(u64, 1), prepared.current);
+    try std.testing.expectEqual(@as(usize, 0), arena.queryCapacity());
+    try std.testing.expect((try findSpatialIndex(storage, snap, collection, field, &meta_payload)).?.meta.through < snap.sequence);
+
+    try std.testing.expectEqual(LgStatus.ok, fdb_spatial_sync(db, collection.ptr, collection.len, field.ptr, field.len, &entries, &err_blob));
+    try std.testing.expectEqual(@as(u64, 1), entries);
+    try std.testing.expectEqual(head, storage.journalHead());
+    try std.testing.expectEqual(count, storage.blockCount());
+    try std.testing.expectEqual(free, storage.freeBlockCount());
+}
+
 test "version" {
     const version = fdb_version();
     try std.testing.expectEqual(@as(u32, 100), version); // 0.1.0
@@ -0,0 +1,368 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Buffer Pool - Shared 4 KiB Frame Cache
+//
+// Fixed-size cache of validated blocks sitting in front of BlockStorage.
+// Frames are shared by every transaction on a database. Eviction uses the
+// CLOCK (second chance) algorithm; pinned and dirty frames are never evicted.
+// Dirty frames are only written back when the owner flushes at commit.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const blocks = @import("blocks.zig");
+
+const Block = blocks.Block;
+
+/// Default pool size: 1024 frames = 4 MiB
+pub const DEFAULT_FRAME_COUNT: u32 = 1024;
+
+const NO_BLOCK: u64 = std.math.maxInt(u64);
+
+const FrameMeta = struct {
+    block_id: u64 = NO_BLOCK,
+    pins: u32 = 0,
+    referenced: bool = false,
+    dirty: bool = false,
+};
+
+pub const PoolStats = struct {
+    frames: u32,
+    hits: u64,
+    misses: u64,
+};
+
+pub const BufferPool = struct {
+    allocator: std.mem.Allocator,
+    frames: []Block,
+    meta: []FrameMeta,
+    index: std.AutoHashMapUnmanaged(u64, u32) = .{},
+    hand: usize = 0,
+
+    // Bumped by every put; a miss only fills if no put raced its disk read
+    generation: u64 = 0,
+
+    hits: u64 = 0,
+    misses: u64 = 0,
+    mutex: std.Thread.Mutex = .{},
+
+    pub fn init(allocator: std.mem.Allocator, frame_count: u32) !BufferPool {
+        if (frame_count == 0) return error.InvalidFrameCount;
+
+        const frames = try allocator.alloc(Block, frame_count);
+        errdefer allocator.free(frames);
+        const meta = try allocator.alloc(FrameMeta, frame_count);
+        errdefer allocator.free(meta);
+        @memset(meta, .{});
+
+        var index: std.AutoHashMapUnmanaged(u64, u32) = .{};
+        try index.ensureTotalCapacity(allocator, frame_count);
+
+        return .{
+            .allocator = allocator,
+            .frames = frames,
+            .meta = meta,
+            .index = index,
+        };
+    }
+
+    pub fn deinit(self: *BufferPool) void {
+        self.index.deinit(self.allocator);
+        self.allocator.free(self.meta);
+        self.allocator.free(self.frames);
+    }
+
+    /// Copy a cached block into `out`. Returns false on a miss.
+    pub fn lookup(self: *BufferPool, block_id: u64, out: *Block) bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        const idx = self.index.get(block_id) orelse {
+            self.misses += 1;
+            return false;
+        };
+        self.hits += 1;
+        self.meta[idx].referenced = true;
+        out.* = self.frames[idx];
+        return true;
+    }
+
+    /// Pin a cached block in place. The frame is not evicted or overwritten
+    /// until `unpin` is called with the returned pointer.
+    pub fn pin(self: *BufferPool, block_id: u64) ?*const Block {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        const idx = self.index.get(block_id) orelse {
+            self.misses += 1;
+            return null;
+        };
+        self.hits += 1;
+        self.meta[idx].referenced = true;
+        self.meta[idx].pins += 1;
+        return &self.frames[idx];
+    }
+
+    /// Release a pin. Pointers that do not belong to the pool are ignored,
+    /// so callers may pass a scratch block they fell back to on a miss.
+    pub fn unpin(self: *BufferPool, block: *const Block) void {
+        const idx = self.frameIndex(block) orelse return;
+
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (self.meta[idx].pins > 0) self.meta[idx].pins -= 1;
+    }
+
+    /// Generation to capture before reading a missed block from disk
+    pub fn currentGeneration(self: *BufferPool) u64 {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.generation;
+    }
+
+    /// Install a clean block read from disk after a miss. Skipped when a
+    /// put happened since `generation` was captured, because the disk copy
+    /// may predate it. Returns the frame (pinned if requested) or null.
+    pub fn fill(self: *BufferPool, block_id: u64, block: *const Block, generation: u64, pin_frame: bool) ?*const Block {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        if (self.index.get(block_id)) |idx| {
+            self.meta[idx].referenced = true;
+            if (pin_frame) self.meta[idx].pins += 1;
+            return &self.frames[idx];
+        }
+        if (generation != self.generation) return null;
+
+        const idx = self.claimFrame() orelse return null;
+        self.index.put(self.allocator, block_id, idx) catch return null;
+        self.frames[idx] = block.*;
+        self.meta[idx] = .{
+            .block_id = block_id,
+            .pins = if (pin_frame) 1 else 0,
+            .referenced = true,
+        };
+        return &self.frames[idx];
+    }
+
+    /// Store a new version of a block. With `dirty` set the frame is held
+    /// until `flushDirty`; otherwise the caller already wrote it to disk.
+    /// Returns false if no frame could be claimed (caller must write through).
+    pub fn put(self: *BufferPool, block_id: u64, block: *const Block, dirty: bool) bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        self.generation += 1;
+
+        if (self.index.get(block_id)) |idx| {
+            const meta = &self.meta[idx];
+            if (meta.pins == 0) {
+                self.frames[idx] = block.*;
+                meta.referenced = true;
+                meta.dirty = meta.dirty or dirty;
+                return true;
+            }
+            // Pinned readers keep their copy; the detached frame is
+            // recycled once its last pin is released.
+            _ = self.index.remove(block_id);
+            meta.block_id = NO_BLOCK;
+            meta.dirty = false;
+        }
+
+        const idx = self.claimFrame() orelse return false;
+        self.index.put(self.allocator, block_id, idx) catch return false;
+        self.frames[idx] = block.*;
+        self.meta[idx] = .{
+            .block_id = block_id,
+            .referenced = true,
+            .dirty = dirty,
+        };
+        return true;
+    }
+
+    /// Forget a block, dirty or not (a commit group that failed drops what
+    /// it staged). Pinned readers keep their copy, as with `put`.
+    pub fn discard(self: *BufferPool, block_id: u64) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        self.generation += 1;
+        const idx = self.index.get(block_id) orelse return;
+        _ = self.index.remove(block_id);
+        self.meta[idx].block_id = NO_BLOCK;
+        self.meta[idx].dirty = false;
+    }
+
+    /// Write every dirty frame through `write_fn` and mark it clean
+    pub fn flushDirty(
+        self: *BufferPool,
+        context: anytype,
+        comptime write_fn: fn (@TypeOf(context), u64, *const Block) anyerror!void,
+    ) !void {
+        for (0..self.frames.len) |idx| {
+            var copy: Block = undefined;
+            var block_id: u64 = NO_BLOCK;
+            {
+                self.mutex.lock();
+                defer self.mutex.unlock();
+                const meta = &self.meta[idx];
+                if (!meta.dirty) continue;
+                block_id = meta.block_id;
+                copy = self.frames[idx];
+                meta.dirty = false;
+            }
+
+            write_fn(context, block_id, &copy) catch |err| {
+                self.mutex.lock();
+                defer self.mutex.unlock();
+                if (self.meta[idx].block_id == block_id) self.meta[idx].dirty = true;
+                return err;
+            };
+        }
+    }
+
+    pub fn stats(self: *BufferPool) PoolStats {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return .{
+            .frames = @intCast(self.frames.len),
+            .hits = self.hits,
+            .misses = self.misses,
+        };
+    }
+
+    fn frameIndex(self: *const BufferPool, block: *const Block) ?usize {
+        const base = @intFromPtr(self.frames.ptr);
+        const addr = @intFromPtr(block);
+        if (addr < base or addr >= base + self.frames.len * @sizeOf(Block)) return null;
+        return (addr - base) / @sizeOf(Block);
+    }
+
+    /// CLOCK sweep for a free or evictable frame (caller holds mutex)
+    fn claimFrame(self: *BufferPool) ?u32 {
+        var scanned: usize = 0;
+        while (scanned < 2 * self.frames.len) : (scanned += 1) {
+            const idx = self.hand;
+            self.hand = (self.hand + 1) % self.frames.len;
+
+            const meta = &self.meta[idx];
+            if (meta.pins > 0 or meta.dirty) continue;
+            if (meta.block_id == NO_BLOCK) return @intCast(idx);
+            if (meta.referenced) {
+                meta.referenced = false;
+                continue;
+            }
+
+            _ = self.index.remove(meta.block_id);
+            meta.* = .{};
+            return @intCast(idx);
+        }
+        return null;
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+fn testBlock(block_id: u64, tag: u8) Block {
+    var block = Block.init(.document, block_id, 1);
+    block.setPayload(&[_]u8{tag}) catch unreachable;
+    return block;
+}
+
+test "hit after fill" {
+    var pool = try BufferPool.init(std.testing.allocator, 4);
+    defer pool.deinit();
+
+    var out: Block = undefined;
+    try std.testing.expect(!pool.lookup(7, &out));
+
+    const gen = pool.currentGeneration();
+    const block = testBlock(7, 'a');
+    try std.testing.expect(pool.fill(7, &block, gen, false) != null);
+    try std.testing.expect(pool.lookup(7, &out));
+    try std.testing.expectEqual(@as(u8, 'a'), out.getPayload()[0]);
+
+    const s = pool.stats();
+    try std.testing.expectEqual(@as(u64, 1), s.hits);
+    try std.testing.expectEqual(@as(u64, 1), s.misses);
+}
+
+test "stale fill is discarded after a put" {
+    var pool = try BufferPool.init(std.testing.allocator, 4);
+    defer pool.deinit();
+
+    const gen = pool.currentGeneration();
+    const newer = testBlock(3, 'n');
+    try std.testing.expect(pool.put(3, &newer, false));
+
+    _ = pool.put(9, &newer, false); // unrelated put still bumps generation
+    const older = testBlock(4, 'o');
+    try std.testing.expect(pool.fill(4, &older, gen, false) == null);
+}
+
+test "pinned and dirty frames survive eviction" {
+    var pool = try BufferPool.init(std.testing.allocator, 2);
+    defer pool.deinit();
+
+    const a = testBlock(1, 'a');
+    const b = testBlock(2, 'b');
+    const c = testBlock(3, 'c');
+
+    try std.testing.expect(pool.put(1, &a, true));
+    try std.testing.expect(pool.fill(2, &b, pool.currentGeneration(), false) != null);
+    const pinned = pool.pin(2) orelse return error.TestUnexpectedResult;
+
+    // Both frames are held: no room for a third block
+    try std.testing.expect(!pool.put(3, &c, false));
+
+    pool.unpin(pinned);
+    try std.testing.expect(pool.put(3, &c, false));
+
+    var out: Block = undefined;
+    try std.testing.expect(pool.lookup(1, &out));
+    try std.testing.expect(!pool.lookup(2, &out));
+}
+
+test "discarded frames are neither read nor flushed" {
+    var pool = try BufferPool.init(std.testing.allocator, 4);
+    defer pool.deinit();
+
+    const a = testBlock(1, 'a');
+    try std.testing.expect(pool.put(1, &a, true));
+    pool.discard(1);
+    pool.discard(2); // not cached: nothing to do
+
+    var out: Block = undefined;
+    try std.testing.expect(!pool.lookup(1, &out));
+    var recorder = FlushRecorder{};
+    try pool.flushDirty(&recorder, FlushRecorder.write);
+    try std.testing.expectEqual(@as(u32, 0), recorder.written);
+}
+
+const FlushRecorder = struct {
+    written: u32 = 0,
+
+    fn write(self: *FlushRecorder, block_id: u64, block: *const Block) anyerror!void {
+        try std.testing.expectEqual(block_id, block.header.block_id);
+        self.written += 1;
+    }
+};
+
+test "flushDirty writes each dirty frame once" {
+    var pool = try BufferPool.init(std.testing.allocator, 4);
+    defer pool.deinit();
+
+    const a = testBlock(1, 'a');
+    const b = testBlock(2, 'b');
+    try std.testing.expect(pool.put(1, &a, true));
+    try std.testing.expect(pool.put(2, &b, false));
+    try std.testing.expect(pool.put(1, &a, true));
+
+    var recorder = FlushRecorder{};
+    try pool.flushDirty(&recorder, FlushRecorder.write);
+    try std.testing.expectEqual(@as(u32, 1), recorder.written);
+
+    try pool.flushDirty(&recorder, FlushRecorder.write);
+    try std.testing.expectEqual(@as(u32, 1), recorder.written);
+}
@@ -29,16 +29,45 @@ pub const MajorType = enum(u3) {
 // ============================================================
 
 pub const Encoder = struct {
-    buffer: std.ArrayList(u8),
+    allocator: std.mem.Allocator,
+    buffer: std.ArrayList(u8) = .{},
+    /// Writing into caller memory: never grows, fails with NoSpaceLeft
+    fixed: bool = false,
 
     pub fn init(allocator: std.mem.Allocator) Encoder {
-        return .{
-            .buffer = std.ArrayList(u8).init(allocator),
-        };
+        return .{ .allocator = allocator };
+    }
+
+    /// Encode into `buffer` without allocating, e.g. a slice of the
+    /// transaction arena sized with the *Size functions below
+    pub fn initFixed(buffer: []u8) Encoder {
+        return .{ .allocator = undefined, .buffer = .initBuffer(buffer), .fixed = true };
     }
 
     pub fn deinit(self: *Encoder) void {
-        self.buffer.deinit();
+        if (!self.fixed) self.buffer.deinit(self.allocator);
+    }
+
+    /// Make room for `len` more bytes up front, so a value of known size
+    /// is encoded without growing the buffer part-way
+    pub fn reserve(self: *Encoder, len: usize) !void {
+        if (self.fixed) {
+            if (self.buffer.unusedCapacitySlice().len < len) return error.NoSpaceLeft;
+            return;
+        }
+        try self.buffer.ensureUnusedCapacity(self.allocator, len);
+    }
+
+    fn put(self: *Encoder, byte: u8) !void {
+        if (!self.fixed) return self.buffer.append(self.allocator, byte);
+        if (self.buffer.items.len == self.buffer.capacity) return error.NoSpaceLeft;
+        self.buffer.appendAssumeCapacity(byte);
+    }
+
+    fn putSlice(self: *Encoder, bytes: []const u8) !void {
+        if (!self.fixed) return self.buffer.appendSlice(self.allocator, bytes);
+        if (self.buffer.unusedCapacitySlice().len < bytes.len) return error.NoSpaceLeft;
+        self.buffer.appendSliceAssumeCapacity(bytes);
     }
 
     pub fn finish(self: *Encoder) []const u8 {
@@ -54,19 +83,19 @@ pub const Encoder = struct {
         const base: u8 = @as(u8, @intFromEnum(major)) << 5;
 
         if (arg < 24) {
-            try self.buffer.append(base | @as(u8, @truncate(arg)));
+            try self.put(base | @as(u8, @truncate(arg)));
         } else if (arg <= 0xFF) {
-            try self.buffer.append(base | 24);
-            try self.buffer.append(@truncate(arg));
+            try self.put(base | 24);
+            try self.put(@truncate(arg));
         } else if (arg <= 0xFFFF) {
-            try self.buffer.append(base | 25);
-            try self.buffer.appendSlice(&std.mem.toBytes(std.mem.nativeToBig(u16, @truncate(arg))));
+            try self.put(base | 25);
+            try self.putSlice(&std.mem.toBytes(std.mem.nativeToBig(u16, @truncate(arg))));
         } else if (arg <= 0xFFFFFFFF) {
-            try self.buffer.append(base | 26);
-            try self.buffer.appendSlice(&std.mem.toBytes(std.mem.nativeToBig(u32, @truncate(arg))));
+            try self.put(base | 26);
+            try self.putSlice(&std.mem.toBytes(std.mem.nativeToBig(u32, @truncate(arg))));
         } else {
-            try self.buffer.append(base | 27);
-            try self.buffer.appendSlice(&std.mem.toBytes(std.mem.nativeToBig(u64, arg)));
+            try self.put(base | 27);
+            try self.putSlice(&std.mem.toBytes(std.mem.nativeToBig(u64, arg)));
         }
     }
 
@@ -93,13 +122,18 @@ pub const Encoder = struct {
     // Encode byte string
     pub fn encodeBytes(self: *Encoder, data: []const u8) !void {
         try self.writeTypeArg(.bytes, data.len);
-        try self.buffer.appendSlice(data);
+        try self.putSlice(data);
     }
 
     // Encode text string
     pub fn encodeText(self: *Encoder, text: []const u8) !void {
         try self.writeTypeArg(.text, text.len);
-        try self.buffer.appendSlice(text);
+        try self.putSlice(text);
+    }
+
+    // Append items that are already CBOR-encoded
+    pub fn encodeRaw(self: *Encoder, items: []const u8) !void {
+        try self.putSlice(items);
     }
 
     // Begin array (definite length)
@@ -124,12 +158,12 @@ pub const Encoder = struct {
 
     // Encode null
     pub fn encodeNull(self: *Encoder) !void {
-        try self.buffer.append(0xF6);
+        try self.put(0xF6);
     }
 
     // Encode boolean
     pub fn encodeBool(self: *Encoder, value: bool) !void {
-        try self.buffer.append(if (value) 0xF5 else 0xF4);
+        try self.put(if (value) 0xF5 else 0xF4);
     }
 
     // Encode float (smallest representation per RFC 8949 §4.2)
@@ -137,22 +171,22 @@ pub const Encoder = struct {
         // Check if it fits in half precision
         const half: f16 = @floatCast(value);
         if (@as(f64, @floatCast(half)) == value) {
-            try self.buffer.append(0xF9);
-            try self.buffer.appendSlice(&std.mem.toBytes(std.mem.nativeToBig(u16, @bitCast(half))));
+            try self.put(0xF9);
+            try self.putSlice(&std.mem.toBytes(std.mem.nativeToBig(u16, @bitCast(half))));
             return;
         }
 
         // Check if it fits in single precision
         const single: f32 = @floatCast(value);
         if (@as(f64, @floatCast(single)) == value) {
-            try self.buffer.append(0xFA);
-            try self.buffer.appendSlice(&std.mem.toBytes(std.mem.nativeToBig(u32, @bitCast(single))));
+            try self.put(0xFA);
+            try self.putSlice(&std.mem.toBytes(std.mem.nativeToBig(u32, @bitCast(single))));
             return;
         }
 
         // Use double precision
-        try self.buffer.append(0xFB);
-        try self.buffer.appendSlice(&std.mem.toBytes(std.mem.nativeToBig(u64, @bitCast(value))));
+        try self.put(0xFB);
+        try self.putSlice(&std.mem.toBytes(std.mem.nativeToBig(u64, @bitCast(value))));
     }
 
     // Encode a simple document (map of string -> any)
@@ -182,7 +216,7 @@ pub const Encoder = struct {
         } else if (T == []const u8) {
             try self.encodeText(value);
         } else if (@typeInfo(T) == .pointer) {
-            if (@typeInfo(T).pointer.size == .Slice) {
+            if (@typeInfo(T).pointer.size == .slice) {
                 if (@typeInfo(T).pointer.child == u8) {
                     try self.encodeText(value);
                 } else {
@@ -206,6 +240,26 @@ pub const Encoder = struct {
     }
 };
 
+/// Encoded size of a major-type head carrying `arg`
+pub fn headSize(arg: u64) usize {
+    if (arg < 24) return 1;
+    if (arg <= 0xFF) return 2;
+    if (arg <= 0xFFFF) return 3;
+    if (arg <= 0xFFFFFFFF) return 5;
+    return 9;
+}
+
+/// Encoded size of a text or byte string of `len` bytes
+pub fn stringSize(len: usize) usize {
+    return headSize(len) + len;
+}
+
+/// Encoded size of an integer
+pub fn intSize(value: i64) usize {
+    const arg: u64 = if (value >= 0) @bitCast(value) else @bitCast(-1 - value);
+    return headSize(arg);
+}
+
 // ============================================================
 // CBOR Decoder
 // ============================================================
@@ -214,9 +268,14 @@ pub const DecodeError = error{
     UnexpectedEof,
     InvalidType,
     InvalidValue,
+    NestingTooDeep,
     OutOfMemory,
 };
 
+/// Most arrays, maps and tags an item may sit inside; walks fail deeper
+/// items with NestingTooDeep rather than exhausting the stack
+pub const MAX_DEPTH: usize = 64;
+
 pub const Decoder = struct {
     data: []const u8,
     pos: usize,
@@ -340,6 +399,12 @@ pub const Decoder = struct {
     }
 
     pub fn skip(self: *Decoder) !void {
+        return self.skipNested(0);
+    }
+
+    /// `skip` for an item inside `depth` enclosing arrays, maps and tags
+    pub fn skipNested(self: *Decoder, depth: usize) !void {
+        if (depth > MAX_DEPTH) return error.NestingTooDeep;
         const ta = try self.readTypeArg();
         switch (ta.major) {
             .unsigned, .negative => {},
@@ -349,31 +414,187 @@ pub const Decoder = struct {
             .array => {
                 var i: usize = 0;
                 while (i < ta.arg) : (i += 1) {
-                    try self.skip();
+                    try self.skipNested(depth + 1);
                 }
             },
             .map => {
                 var i: usize = 0;
                 while (i < ta.arg) : (i += 1) {
-                    try self.skip(); // key
-                    try self.skip(); // value
+                    try self.skipNested(depth + 1); // key
+                    try self.skipNested(depth + 1); // value
                 }
             },
             .tag => {
-                try self.skip();
+                try self.skipNested(depth + 1);
             },
-            .simple => {
-                // Handle floats
-                const additional: u5 = @truncate(self.data[self.pos - 1]);
-                switch (additional) {
-                    25 => _ = try self.readBytes(2),
-                    26 => _ = try self.readBytes(4),
-                    27 => _ = try self.readBytes(8),
-                    else => {},
-                }
+            // Simple values and floats: readArg has consumed any payload
+            .simple => {},
+        }
+    }
+
+    /// Integer or float of any width, as f64
+    pub fn decodeNumber(self: *Decoder) !f64 {
+        if (self.pos >= self.data.len) return error.UnexpectedEof;
+        switch (self.data[self.pos]) {
+            0xF9 => {
+                self.pos += 1;
+                const bytes = try self.readBytes(2);
+                const half: f16 = @bitCast(std.mem.readInt(u16, bytes[0..2], .big));
+                return half;
+            },
+            0xFA => {
+                self.pos += 1;
+                const bytes = try self.readBytes(4);
+                const single: f32 = @bitCast(std.mem.readInt(u32, bytes[0..4], .big));
+                return single;
             },
+            0xFB => {
+                self.pos += 1;
+                const bytes = try self.readBytes(8);
+                return @bitCast(std.mem.readInt(u64, bytes[0..8], .big));
+            },
+            else => {
+                const ta = try self.readTypeArg();
+                return switch (ta.major) {
+                    .unsigned => @floatFromInt(ta.arg),
+                    .negative => -1.0 - @as(f64, @floatFromInt(ta.arg)),
+                    else => error.InvalidType,
+                };
+            },
+        }
+    }
+
+    /// The encoded bytes of the next item, skipping past it
+    pub fn rawItem(self: *Decoder) ![]const u8 {
+        const start = self.pos;
+        try self.skip();
+        return self.data[start..self.pos];
+    }
+};
+
+/// Encoded value stored under the text key `key` in the definite-length
+/// map that `item` encodes, or null if absent. Keys are compared as raw
+/// bytes, so the map is walked in place without allocating.
+pub fn findMapMember(item: []const u8, key: []const u8) DecodeError!?[]const u8 {
+    // Decoding text and skipping never allocate
+    var decoder = Decoder{ .data = item, .pos = 0, .allocator = undefined };
+    const count = try decoder.decodeMapLen();
+    for (0..count) |_| {
+        const is_text = decoder.pos < item.len and item[decoder.pos] >> 5 == @intFromEnum(MajorType.text);
+        if (is_text) {
+            if (std.mem.eql(u8, try decoder.decodeText(), key)) return try decoder.rawItem();
+        } else {
+            try decoder.skip();
+        }
+        try decoder.skip();
+    }
+    return null;
+}
+
+/// Lazy index over the members of one CBOR map, for payloads looked up
+/// by several keys. The first lookup walks the map like findMapMember
+/// and stops at its key; the second records where every text key's value
+/// lies in one pass, and every lookup after that hashes the key into the
+/// table and compares it in place. Values are slices of the payload, and
+/// the table is kept across reset() calls, so a scan allocates it once.
+pub const MapView = struct {
+    allocator: std.mem.Allocator,
+    data: []const u8 = &.{},
+    slots: std.ArrayList(Slot) = .{},
+    lookups: usize = 0,
+    indexed: bool = false,
+
+    /// Offsets into `data`; key_start 0 marks an empty slot (offset 0
+    /// always holds the map's own head)
+    const Slot = struct {
+        key_start: u32,
+        key_len: u32,
+        value_start: u32,
+        value_len: u32,
+    };
+
+    const empty_slot = Slot{ .key_start = 0, .key_len = 0, .value_start = 0, .value_len = 0 };
+
+    pub fn init(allocator: std.mem.Allocator) MapView {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(self: *MapView) void {
+        self.slots.deinit(self.allocator);
+    }
+
+    /// Look into another map (`data` must outlive the lookups)
+    pub fn reset(self: *MapView, data: []const u8) void {
+        self.data = data;
+        self.lookups = 0;
+        self.indexed = false;
+    }
+
+    /// Encoded value under the text key `key`, or null if absent
+    pub fn get(self: *MapView, key: []const u8) DecodeError!?[]const u8 {
+        self.lookups += 1;
+        if (!self.indexed) {
+            if (self.lookups == 1) return findMapMember(self.data, key);
+            try self.build();
+        }
+
+        const mask = self.slots.items.len - 1;
+        var i = hashKey(key) & mask;
+        while (true) : (i = (i + 1) & mask) {
+            const slot = self.slots.items[i];
+            if (slot.key_start == 0) return null;
+            if (std.mem.eql(u8, self.data[slot.key_start..][0..slot.key_len], key)) {
+                return self.data[slot.value_start..][0..slot.value_len];
+            }
         }
     }
+
+    fn build(self: *MapView) DecodeError!void {
+        var decoder = Decoder{ .data = self.data, .pos = 0, .allocator = undefined };
+        const count = try decoder.decodeMapLen();
+        // Every member takes at least two bytes, which bounds a forged count
+        if (count > self.data.len / 2 or self.data.len > std.math.maxInt(u32)) return error.InvalidValue;
+
+        const capacity = std.math.ceilPowerOfTwoAssert(usize, count * 2 + 2);
+        try self.slots.resize(self.allocator, capacity);
+        @memset(self.slots.items, empty_slot);
+
+        for (0..count) |_| {
+            const is_text = decoder.pos < self.data.len and self.data[decoder.pos] >> 5 == @intFromEnum(MajorType.text);
+            if (!is_text) {
+                try decoder.skip();
+                try decoder.skip();
+                continue;
+            }
+            const key = try decoder.decodeText();
+            const key_start = decoder.pos - key.len;
+            const value = try decoder.rawItem();
+            self.insert(.{
+                .key_start = @intCast(key_start),
+                .key_len = @intCast(key.len),
+                .value_start = @intCast(decoder.pos - value.len),
+                .value_len = @intCast(value.len),
+            });
+        }
+        self.indexed = true;
+    }
+
+    /// Add a member unless its key is already present (the first of
+    /// duplicate keys wins, as with findMapMember)
+    fn insert(self: *MapView, slot: Slot) void {
+        const key = self.data[slot.key_start..][0..slot.key_len];
+        const mask = self.slots.items.len - 1;
+        var i = hashKey(key) & mask;
+        while (self.slots.items[i].key_start != 0) : (i = (i + 1) & mask) {
+            const other = self.slots.items[i];
+            if (std.mem.eql(u8, self.data[other.key_start..][0..other.key_len], key)) return;
+        }
+        self.slots.items[i] = slot;
+    }
+
+    fn hashKey(key: []const u8) usize {
+        return @truncate(std.hash.Wyhash.hash(0, key));
+    }
 };
 
 // ============================================================
@@ -388,8 +609,14 @@ pub fn encodeProvenance(
     rationale: []const u8,
     timestamp: []const u8,
 ) ![]u8 {
-    var encoder = Encoder.init(allocator);
-    errdefer encoder.deinit();
+    const size = headSize(@intFromEnum(types.CborTag.provenance)) + 1 +
+        stringSize("actor".len) + headSize(@intFromEnum(types.CborTag.actor)) + 1 +
+        stringSize("id".len) + stringSize(actor_id.len) + stringSize("type".len) + stringSize(actor_type.len) +
+        stringSize("rationale".len) + stringSize(rationale.len) +
+        stringSize("timestamp".len) + headSize(0) + stringSize(timestamp.len);
+    const result = try allocator.alloc(u8, size);
+    errdefer allocator.free(result);
+    var encoder = Encoder.initFixed(result);
 
     try encoder.encodeFdbTag(.provenance);
     try encoder.beginMap(3);
@@ -412,8 +639,7 @@ pub fn encodeProvenance(
     try encoder.encodeTag(0); // datetime tag
     try encoder.encodeText(timestamp);
 
-    const result = try allocator.dupe(u8, encoder.finish());
-    encoder.deinit();
+    std.debug.assert(encoder.finish().len == size);
     return result;
 }
 
@@ -423,8 +649,10 @@ pub fn encodeError(
     code: i32,
     message: []const u8,
 ) ![]u8 {
-    var encoder = Encoder.init(allocator);
-    errdefer encoder.deinit();
+    const size = 1 + stringSize("code".len) + intSize(code) + stringSize("message".len) + stringSize(message.len);
+    const result = try allocator.alloc(u8, size);
+    errdefer allocator.free(result);
+    var encoder = Encoder.initFixed(result);
 
     try encoder.beginMap(2);
     try encoder.encodeText("code");
@@ -432,8 +660,7 @@ pub fn encodeError(
     try encoder.encodeText("message");
     try encoder.encodeText(message);
 
-    const result = try allocator.dupe(u8, encoder.finish());
-    encoder.deinit();
+    std.debug.assert(encoder.finish().len == size);
     return result;
 }
 
@@ -488,6 +715,20 @@ test "encode simple map" {
     try std.testing.expectEqual(@as(u8, 0xA2), result[0]); // map(2)
 }
 
+test "byte strings round-trip without escaping" {
+    var encoder = Encoder.init(std.testing.allocator);
+    defer encoder.deinit();
+
+    const payload = [_]u8{ 0x00, '"', 0xFF, '\n' };
+    try encoder.encodeBytes(&payload);
+
+    const result = encoder.finish();
+    try std.testing.expectEqual(@as(usize, 1 + payload.len), result.len);
+
+    var decoder = Decoder.init(std.testing.allocator, result);
+    try std.testing.expectEqualSlices(u8, &payload, try decoder.decodeBytes());
+}
+
 test "decode unsigned integer" {
     const data = [_]u8{ 0x18, 0x64 }; // 100
     var decoder = Decoder.init(std.testing.allocator, &data);
@@ -517,3 +758,107 @@ test "encode provenance" {
     // Verify it starts with provenance tag
     try std.testing.expectEqual(@as(u8, 0xD9), result[0]); // tag (2-byte)
 }
+
+test "skip steps over floats of every width" {
+    var encoder = Encoder.init(std.testing.allocator);
+    defer encoder.deinit();
+    try encoder.beginArray(4);
+    try encoder.encodeFloat(1.5); // half
+    try encoder.encodeFloat(0.1); // double
+    try encoder.encodeFloat(100000.5); // single
+    try encoder.encodeUint(7);
+
+    var decoder = Decoder.init(std.testing.allocator, encoder.finish());
+    try std.testing.expectEqual(@as(usize, 4), try decoder.decodeArrayLen());
+    try std.testing.expectEqual(@as(f64, 1.5), try decoder.decodeNumber());
+    try decoder.skip();
+    try decoder.skip();
+    try std.testing.expectEqual(@as(f64, 7), try decoder.decodeNumber());
+    try std.testing.expectEqual(encoder.finish().len, decoder.pos);
+}
+
+test "skip refuses items nested past the limit" {
+    var encoder = Encoder.init(std.testing.allocator);
+    defer encoder.deinit();
+    for (0..MAX_DEPTH + 1) |_| try encoder.beginArray(1);
+    try encoder.encodeUint(7);
+
+    var decoder = Decoder.init(std.testing.allocator, encoder.finish());
+    try std.testing.expectError(error.NestingTooDeep, decoder.skip());
+}
+
+test "map members are found in place" {
+    var encoder = Encoder.init(std.testing.allocator);
+    defer encoder.deinit();
+    try encoder.beginMap(4);
+    try encoder.encodeUint(1); // non-text keys are skipped
+    try encoder.encodeText("one");
+    try encoder.encodeText("nested");
+    try encoder.beginMap(1);
+    try encoder.encodeText("x");
+    try encoder.encodeFloat(2.5);
+    try encoder.encodeText("collection");
+    try encoder.encodeText("evidence");
+    try encoder.encodeText("score");
+    try encoder.encodeInt(-3);
+
+    const doc = encoder.finish();
+    const score = (try findMapMember(doc, "score")).?;
+    var decoder = Decoder.init(std.testing.allocator, score);
+    try std.testing.expectEqual(@as(f64, -3), try decoder.decodeNumber());
+
+    const nested = (try findMapMember(doc, "nested")).?;
+    try std.testing.expect((try findMapMember(nested, "x")) != null);
+    try std.testing.expect((try findMapMember(doc, "missing")) == null);
+    try std.testing.expectError(error.UnexpectedEof, findMapMember(doc[0 .. doc.len - 1], "missing"));
+}
+
+test "fixed encoders fill a presized buffer and refuse to grow" {
+    var buf: [16]u8 = undefined;
+    var encoder = Encoder.initFixed(&buf);
+    defer encoder.deinit();
+    try encoder.beginMap(1);
+    try encoder.encodeText("id");
+    try encoder.encodeUint(1000);
+    try std.testing.expectEqual(@as(usize, 1 + stringSize(2) + headSize(1000)), encoder.finish().len);
+    try std.testing.expectError(error.NoSpaceLeft, encoder.reserve(buf.len));
+    try std.testing.expectError(error.NoSpaceLeft, encoder.encodeBytes(&[_]u8{0} ** 16));
+
+    const err = try encodeError(std.testing.allocator, -42, "bad field");
+    defer std.testing.allocator.free(err);
+    try std.testing.expect((try findMapMember(err, "message")) != null);
+}
+
+test "map views index members after the first lookup" {
+    var encoder = Encoder.init(std.testing.allocator);
+    defer encoder.deinit();
+    try encoder.beginMap(5);
+    try encoder.encodeText("collection");
+    try encoder.encodeText("evidence");
+    try encoder.encodeUint(9); // non-text keys are skipped
+    try encoder.encodeNull();
+    try encoder.encodeText("score");
+    try encoder.encodeInt(-3);
+    try encoder.encodeText("score"); // the first of duplicate keys wins
+    try encoder.encodeInt(4);
+    try encoder.encodeText("");
+    try encoder.encodeBool(true);
+    const doc = encoder.finish();
+
+    var view = MapView.init(std.testing.allocator);
+    defer view.deinit();
+    for (0..2) |_| {
+        view.reset(doc);
+        for (0..3) |_| {
+            try std.testing.expectEqualSlices(u8, (try findMapMember(doc, "score")).?, (try view.get("score")).?);
+            try std.testing.expectEqualSlices(u8, (try findMapMember(doc, "collection")).?, (try view.get("collection")).?);
+            try std.testing.expectEqualSlices(u8, &.{0xF5}, (try view.get("")).?);
+            try std.testing.expect((try view.get("missing")) == null);
+        }
+        try std.testing.expect(view.indexed);
+    }
+
+    view.reset(doc[0 .. doc.len - 1]);
+    _ = try view.get("collection");
+    try std.testing.expectError(error.UnexpectedEof, view.get("collection"));
+}
@@ -0,0 +1,487 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Columnar Export - Typed Column Batches from a Scan
+//
+// fdb_export_columnar reads one collection's documents and hands back
+// the requested fields as columns, so analytics clients load a batch
+// instead of parsing documents row by row. Each column keeps Arrow's
+// physical layout, little-endian, ready to wrap without copying:
+//
+//   validity   bitmap, bit i set when row i has a value; empty when no
+//              row is null
+//   values     int64/float64: 8 bytes a row; bool: bitmap; utf8: bytes
+//   offsets    utf8 only: rows + 1 int32 offsets into values
+//
+// A column's type is set by its first value. Integers widen to float64
+// when a fraction arrives later, and objects and arrays go into utf8
+// columns as JSON text. Any other value that disagrees is left null and
+// counted as mismatched.
+//
+// Every batch starts with "_id" (the block ID) and "_seq" (the journal
+// sequence that last wrote the block), both int64 without nulls.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const builtin = @import("builtin");
+const cbor = @import("cbor.zig");
+const json_fields = @import("json_fields.zig");
+const query = @import("query.zig");
+
+pub const ColumnType = enum { null, bool, int64, float64, utf8 };
+
+/// One field of one document, decoded far enough to place in a column
+const Cell = union(enum) {
+    null,
+    boolean: bool,
+    int: i64,
+    float: f64,
+    text: []const u8,
+    /// An object or array, rendered as JSON
+    json: []const u8,
+};
+
+const Column = struct {
+    name: []const u8,
+    kind: ColumnType = .null,
+    rows: usize = 0,
+    null_count: usize = 0,
+    mismatched: usize = 0,
+    validity: std.ArrayList(u8) = .{},
+    /// bool/int64/float64: one 8-byte slot a row, bools packed on encode
+    slots: std.ArrayList(u64) = .{},
+    /// utf8: the bytes, and where each row ends
+    text: std.ArrayList(u8) = .{},
+    ends: std.ArrayList(u32) = .{},
+
+    fn deinit(self: *Column, allocator: std.mem.Allocator) void {
+        self.validity.deinit(allocator);
+        self.slots.deinit(allocator);
+        self.text.deinit(allocator);
+        self.ends.deinit(allocator);
+    }
+
+    fn append(self: *Column, allocator: std.mem.Allocator, cell: Cell) !void {
+        if (cell == .null) return self.appendNull(allocator, false);
+        if (self.kind == .null) try self.settle(allocator, switch (cell) {
+            .null => unreachable,
+            .boolean => .bool,
+            .int => .int64,
+            .float => .float64,
+            .text, .json => .utf8,
+        });
+
+        switch (self.kind) {
+            .null => unreachable,
+            .bool => switch (cell) {
+                .boolean => |b| try self.slots.append(allocator, @intFromBool(b)),
+                else => return self.appendNull(allocator, true),
+            },
+            .int64 => switch (cell) {
+                .int => |n| try self.slots.append(allocator, @bitCast(n)),
+                .float => |f| {
+                    self.widen();
+                    try self.slots.append(allocator, @bitCast(f));
+                },
+                else => return self.appendNull(allocator, true),
+            },
+            .float64 => switch (cell) {
+                .int => |n| try self.slots.append(allocator, @bitCast(@as(f64, @floatFromInt(n)))),
+                .float => |f| try self.slots.append(allocator, @bitCast(f)),
+                else => return self.appendNull(allocator, true),
+            },
+            .utf8 => switch (cell) {
+                .text, .json => |bytes| {
+                    // Arrow offsets are int32
+                    if (self.text.items.len + bytes.len > std.math.maxInt(i32)) return error.ColumnTooLarge;
+                    try self.text.appendSlice(allocator, bytes);
+                    try self.ends.append(allocator, @intCast(self.text.items.len));
+                },
+                else => return self.appendNull(allocator, true),
+            },
+        }
+        try self.markRow(allocator, true);
+    }
+
+    fn appendNull(self: *Column, allocator: std.mem.Allocator, mismatch: bool) !void {
+        switch (self.kind) {
+            .null => {},
+            .bool, .int64, .float64 => try self.slots.append(allocator, 0),
+            .utf8 => try self.ends.append(allocator, @intCast(self.text.items.len)),
+        }
+        if (mismatch) self.mismatched += 1;
+        self.null_count += 1;
+        try self.markRow(allocator, false);
+    }
+
+    fn markRow(self: *Column, allocator: std.mem.Allocator, valid: bool) !void {
+        if (self.rows % 8 == 0) try self.validity.append(allocator, 0);
+        if (valid) self.validity.items[self.rows / 8] |= @as(u8, 1) << @intCast(self.rows % 8);
+        self.rows += 1;
+    }
+
+    /// Fix the type on the first value, backfilling the null rows so far
+    fn settle(self: *Column, allocator: std.mem.Allocator, kind: ColumnType) !void {
+        switch (kind) {
+            .null => unreachable,
+            .bool, .int64, .float64 => try self.slots.appendNTimes(allocator, 0, self.rows),
+            .utf8 => try self.ends.appendNTimes(allocator, 0, self.rows),
+        }
+        self.kind = kind;
+    }
+
+    /// int64 -> float64, in place (null slots are 0 either way)
+    fn widen(self: *Column) void {
+        for (self.slots.items) |*slot| slot.* = @bitCast(@as(f64, @floatFromInt(@as(i64, @bitCast(slot.*)))));
+        self.kind = .float64;
+    }
+
+    /// {"name":..,"type":..,"null_count":N,"mismatched":N,"validity":bytes,
+    ///  "values":bytes,"offsets":bytes}
+    fn encode(self: *const Column, allocator: std.mem.Allocator, out: *cbor.Encoder) !void {
+        try out.beginMap(7);
+        try out.encodeText("name");
+        try out.encodeText(self.name);
+        try out.encodeText("type");
+        try out.encodeText(@tagName(self.kind));
+        try out.encodeText("null_count");
+        try out.encodeUint(self.null_count);
+        try out.encodeText("mismatched");
+        try out.encodeUint(self.mismatched);
+        try out.encodeText("validity");
+        try out.encodeBytes(if (self.null_count == 0) &.{} else self.validity.items);
+
+        var packed_buf: std.ArrayList(u8) = .{};
+        defer packed_buf.deinit(allocator);
+        try out.encodeText("values");
+        switch (self.kind) {
+            .null => try out.encodeBytes(&.{}),
+            .bool => {
+                try packed_buf.appendNTimes(allocator, 0, std.math.divCeil(usize, self.rows, 8) catch unreachable);
+                for (self.slots.items, 0..) |slot, i| {
+                    if (slot != 0) packed_buf.items[i / 8] |= @as(u8, 1) << @intCast(i % 8);
+                }
+                try out.encodeBytes(packed_buf.items);
+            },
+            .int64, .float64 => try out.encodeBytes(try littleEndian(u64, allocator, self.slots.items, &packed_buf)),
+            .utf8 => try out.encodeBytes(self.text.items),
+        }
+
+        try out.encodeText("offsets");
+        if (self.kind == .utf8) {
+            var offsets: std.ArrayList(u32) = .{};
+            defer offsets.deinit(allocator);
+            try offsets.ensureTotalCapacity(allocator, self.ends.items.len + 1);
+            offsets.appendAssumeCapacity(0);
+            offsets.appendSliceAssumeCapacity(self.ends.items);
+            var offset_bytes: std.ArrayList(u8) = .{};
+            defer offset_bytes.deinit(allocator);
+            try out.encodeBytes(try littleEndian(u32, allocator, offsets.items, &offset_bytes));
+        } else {
+            try out.encodeBytes(&.{});
+        }
+    }
+};
+
+/// `values` as little-endian bytes: the slice itself on little-endian
+/// hosts, otherwise swapped into `buf`
+fn littleEndian(comptime T: type, allocator: std.mem.Allocator, values: []const T, buf: *std.ArrayList(u8)) ![]const u8 {
+    if (builtin.cpu.arch.endian() == .little) return std.mem.sliceAsBytes(values);
+    try buf.ensureTotalCapacity(allocator, values.len * @sizeOf(T));
+    for (values) |v| buf.appendSliceAssumeCapacity(std.mem.asBytes(&std.mem.nativeToLittle(T, v)));
+    return buf.items;
+}
+
+/// Split a comma-separated field list into member paths. "_id" and
+/// "_seq" are always exported and are dropped here.
+pub fn parseFields(allocator: std.mem.Allocator, text: []const u8) ![]const []const u8 {
+    var fields: std.ArrayList([]const u8) = .{};
+    errdefer fields.deinit(allocator);
+    var parts = std.mem.splitScalar(u8, text, ',');
+    while (parts.next()) |part| {
+        const field = std.mem.trim(u8, part, " \t");
+        if (field.len == 0) return error.InvalidFields;
+        if (std.mem.eql(u8, field, "_id") or std.mem.eql(u8, field, "_seq")) continue;
+        for (fields.items) |seen| {
+            if (std.mem.eql(u8, seen, field)) return error.InvalidFields;
+        }
+        try fields.append(allocator, field);
+    }
+    return fields.toOwnedSlice(allocator);
+}
+
+pub const Batch = struct {
+    allocator: std.mem.Allocator,
+    collection: []const u8,
+    /// _id, _seq, then the requested fields
+    columns: []Column,
+    /// Blocks the client should drop if it holds them
+    deleted: std.ArrayList(u64) = .{},
+    rows: usize = 0,
+    scratch: std.ArrayList(u8) = .{},
+    rendered: std.ArrayList(u8) = .{},
+    /// Member offsets of the CBOR document being added
+    view: cbor.MapView,
+
+    /// `collection` and `fields` must outlive the batch
+    pub fn init(allocator: std.mem.Allocator, collection: []const u8, fields: []const []const u8) !Batch {
+        const columns = try allocator.alloc(Column, fields.len + 2);
+        columns[0] = .{ .name = "_id", .kind = .int64 };
+        columns[1] = .{ .name = "_seq", .kind = .int64 };
+        for (columns[2..], fields) |*column, field| column.* = .{ .name = field };
+        return .{ .allocator = allocator, .collection = collection, .columns = columns, .view = cbor.MapView.init(allocator) };
+    }
+
+    pub fn deinit(self: *Batch) void {
+        for (self.columns) |*column| column.deinit(self.allocator);
+        self.allocator.free(self.columns);
+        self.deleted.deinit(self.allocator);
+        self.scratch.deinit(self.allocator);
+        self.rendered.deinit(self.allocator);
+        self.view.deinit();
+    }
+
+    /// Add the document held by `block_id`, last written at `sequence`.
+    /// False when it is not in the collection (or not a document at all).
+    pub fn addDocument(self: *Batch, block_id: u64, sequence: u64, data: []const u8) !bool {
+        var doc = query.Document.of(data) orelse return false;
+        if (doc.encoding == .cbor) {
+            self.view.reset(data);
+            doc.view = &self.view;
+        }
+        const member = (doc.findPath("collection") catch return false) orelse return false;
+        const name = self.cellOf(doc.encoding, member) catch return false;
+        if (name != .text or !std.mem.eql(u8, name.text, self.collection)) return false;
+
+        try self.columns[0].append(self.allocator, .{ .int = std.math.cast(i64, block_id) orelse return error.ColumnTooLarge });
+        try self.columns[1].append(self.allocator, .{ .int = std.math.cast(i64, sequence) orelse return error.ColumnTooLarge });
+        for (self.columns[2..]) |*column| {
+            const found = doc.findPath(column.name) catch |err| switch (err) {
+                error.OutOfMemory => return err,
+                else => null,
+            };
+            const raw = found orelse {
+                try column.appendNull(self.allocator, false);
+                continue;
+            };
+            const cell = self.cellOf(doc.encoding, raw) catch {
+                try column.appendNull(self.allocator, true);
+                continue;
+            };
+            try column.append(self.allocator, cell);
+        }
+        self.rows += 1;
+        return true;
+    }
+
+    pub fn addDeleted(self: *Batch, block_id: u64) !void {
+        try self.deleted.append(self.allocator, block_id);
+    }
+
+    /// Decode one raw member; strings and rendered JSON borrow the
+    /// batch's scratch until the next call
+    fn cellOf(self: *Batch, encoding: query.Encoding, raw: []const u8) !Cell {
+        switch (encoding) {
+            .json => return switch (json_fields.kindOf(raw) orelse return error.InvalidJson) {
+                .string => .{ .text = try json_fields.stringContents(self.allocator, raw, &self.scratch) },
+                .number => numberCell(raw),
+                .boolean => .{ .boolean = raw[0] == 't' },
+                .null => .null,
+                .object, .array => .{ .json = raw },
+            },
+            .cbor => {
+                if (raw.len == 0) return error.UnexpectedEof;
+                var decoder = cbor.Decoder{ .data = raw, .pos = 0, .allocator = undefined };
+                switch (@as(cbor.MajorType, @enumFromInt(@as(u3, @truncate(raw[0] >> 5))))) {
+                    .unsigned => {
+                        const n = try decoder.decodeUint();
+                        return if (std.math.cast(i64, n)) |int| .{ .int = int } else .{ .float = @floatFromInt(n) };
+                    },
+                    .negative => {
+                        const arg = (try decoder.readTypeArg()).arg;
+                        return if (std.math.cast(i64, arg)) |int| .{ .int = -1 - int } else .{ .float = -1.0 - @as(f64, @floatFromInt(arg)) };
+                    },
+                    .text => return .{ .text = try decoder.decodeText() },
+                    .simple => switch (raw[0]) {
+                        0xF4 => return .{ .boolean = false },
+                        0xF5 => return .{ .boolean = true },
+                        0xF9, 0xFA, 0xFB => return .{ .float = try decoder.decodeNumber() },
+                        else => return .null,
+                    },
+                    else => {
+                        self.rendered.clearRetainingCapacity();
+                        try query.appendCborJson(self.allocator, &self.rendered, &decoder);
+                        return .{ .json = self.rendered.items };
+                    },
+                }
+            },
+        }
+    }
+
+    /// {"since":N,"sequence":N,"rows":N,"deleted":bytes,"columns":[...]},
+    /// with "deleted" as little-endian int64 block IDs
+    pub fn encode(self: *Batch, since: u64, sequence: u64, out: *cbor.Encoder) !void {
+        try out.beginMap(5);
+        try out.encodeText("since");
+        try out.encodeUint(since);
+        try out.encodeText("sequence");
+        try out.encodeUint(sequence);
+        try out.encodeText("rows");
+        try out.encodeUint(self.rows);
+        try out.encodeText("deleted");
+        var deleted_bytes: std.ArrayList(u8) = .{};
+        defer deleted_bytes.deinit(self.allocator);
+        try out.encodeBytes(try littleEndian(u64, self.allocator, self.deleted.items, &deleted_bytes));
+        try out.encodeText("columns");
+        try out.beginArray(self.columns.len);
+        for (self.columns) |*column| try column.encode(self.allocator, out);
+    }
+};
+
+/// JSON numbers without a fraction or exponent stay integers when they fit
+fn numberCell(raw: []const u8) !Cell {
+    if (std.mem.indexOfAny(u8, raw, ".eE") == null) {
+        if (std.fmt.parseInt(i64, raw, 10)) |n| return .{ .int = n } else |_| {}
+    }
+    return .{ .float = std.fmt.parseFloat(f64, raw) catch return error.InvalidJson };
+}
+
+// ============================================================
+// Tests
+// ============================================================
+
+fn testColumn(batch: *const Batch, name: []const u8) *const Column {
+    for (batch.columns) |*column| {
+        if (std.mem.eql(u8, column.name, name)) return column;
+    }
+    unreachable;
+}
+
+test "fields parse into member paths" {
+    const allocator = std.testing.allocator;
+    const fields = try parseFields(allocator, " title, meta.lang ,_id,score");
+    defer allocator.free(fields);
+    try std.testing.expectEqual(@as(usize, 3), fields.len);
+    try std.testing.expectEqualStrings("meta.lang", fields[1]);
+
+    try std.testing.expectError(error.InvalidFields, parseFields(allocator, "a,,b"));
+    try std.testing.expectError(error.InvalidFields, parseFields(allocator, "a,a"));
+}
+
+test "columns take the type of their first value" {
+    const allocator = std.testing.allocator;
+    var batch = try Batch.init(allocator, "evidence", &.{ "score", "title", "ok", "meta", "n" });
+    defer batch.deinit();
+
+    const docs = [_][]const u8{
+        \\{"collection":"evidence","title":"A","ok":true,"meta":{"lang":"en"},"n":1}
+        ,
+        \\{"collection":"notes","score":1}
+        ,
+        \\{"collection":"evidence","score":3,"title":"B\n","ok":"yes","n":2.5}
+        ,
+        \\{"collection":"evidence","score":4,"title":7,"meta":[1,2]}
+        ,
+    };
+    var added: usize = 0;
+    for (docs, 1..) |doc, id| {
+        if (try batch.addDocument(id, 10 + id, doc)) added += 1;
+    }
+    try std.testing.expectEqual(@as(usize, 3), added);
+    try std.testing.expectEqual(@as(usize, 3), batch.rows);
+
+    // Nulls before the first value are backfilled
+    const score = testColumn(&batch, "score");
+    try std.testing.expectEqual(ColumnType.int64, score.kind);
+    try std.testing.expectEqual(@as(usize, 1), score.null_count);
+    try std.testing.expectEqual(@as(u8, 0b110), score.validity.items[0]);
+    try std.testing.expectEqual(@as(i64, 4), @as(i64, @bitCast(score.slots.items[2])));
+
+    // A number in a text column is a mismatch; escapes are decoded
+    const title = testColumn(&batch, "title");
+    try std.testing.expectEqual(ColumnType.utf8, title.kind);
+    try std.testing.expectEqual(@as(usize, 1), title.mismatched);
+    try std.testing.expectEqualStrings("AB\n", title.text.items);
+    try std.testing.expectEqualSlices(u32, &.{ 1, 3, 3 }, title.ends.items);
+
+    const ok = testColumn(&batch, "ok");
+    try std.testing.expectEqual(ColumnType.bool, ok.kind);
+    try std.testing.expectEqual(@as(usize, 1), ok.mismatched);
+
+    // Nested values are kept as JSON text
+    const meta = testColumn(&batch, "meta");
+    try std.testing.expectEqualStrings("{\"lang\":\"en\"}[1,2]", meta.text.items);
+
+    // Integers widen when a fraction arrives
+    const n = testColumn(&batch, "n");
+    try std.testing.expectEqual(ColumnType.float64, n.kind);
+    try std.testing.expectEqual(@as(f64, 1.0), @as(f64, @bitCast(n.slots.items[0])));
+    try std.testing.expectEqual(@as(f64, 2.5), @as(f64, @bitCast(n.slots.items[1])));
+
+    const ids = testColumn(&batch, "_id");
+    try std.testing.expectEqual(@as(i64, 4), @as(i64, @bitCast(ids.slots.items[2])));
+}
+
+test "cbor documents export and batches encode their buffers" {
+    const allocator = std.testing.allocator;
+    var batch = try Batch.init(allocator, "c", &.{ "n", "s", "t" });
+    defer batch.deinit();
+
+    var doc = cbor.Encoder.init(allocator);
+    defer doc.deinit();
+    try doc.beginMap(4);
+    try doc.encodeText("collection");
+    try doc.encodeText("c");
+    try doc.encodeText("n");
+    try doc.encodeInt(-5);
+    try doc.encodeText("s");
+    try doc.encodeText("x");
+    try doc.encodeText("t");
+    try doc.encodeBool(true);
+    try std.testing.expect(try batch.addDocument(9, 3, doc.finish()));
+    try batch.addDeleted(2);
+
+    var out = cbor.Encoder.init(allocator);
+    defer out.deinit();
+    try batch.encode(1, 3, &out);
+
+    var decoder = cbor.Decoder.init(allocator, out.finish());
+    try std.testing.expectEqual(@as(usize, 5), try decoder.decodeMapLen());
+    try std.testing.expectEqualStrings("since", try decoder.decodeText());
+    try std.testing.expectEqual(@as(u64, 1), try decoder.decodeUint());
+    try std.testing.expectEqualStrings("sequence", try decoder.decodeText());
+    try std.testing.expectEqual(@as(u64, 3), try decoder.decodeUint());
+    try std.testing.expectEqualStrings("rows", try decoder.decodeText());
+    try std.testing.expectEqual(@as(u64, 1), try decoder.decodeUint());
+    try std.testing.expectEqualStrings("deleted", try decoder.decodeText());
+    try std.testing.expectEqualSlices(u8, &.{ 2, 0, 0, 0, 0, 0, 0, 0 }, try decoder.decodeBytes());
+    try std.testing.expectEqualStrings("columns", try decoder.decodeText());
+    try std.testing.expectEqual(@as(usize, 5), try decoder.decodeArrayLen());
+
+    // _id, then _seq
+    for (0..2) |_| try decoder.skip();
+
+    // n: int64 -5 without a validity bitmap
+    try std.testing.expectEqual(@as(usize, 7), try decoder.decodeMapLen());
+    try std.testing.expectEqualStrings("name", try decoder.decodeText());
+    try std.testing.expectEqualStrings("n", try decoder.decodeText());
+    try std.testing.expectEqualStrings("type", try decoder.decodeText());
+    try std.testing.expectEqualStrings("int64", try decoder.decodeText());
+    for (0..2) |_| {
+        _ = try decoder.decodeText();
+        try std.testing.expectEqual(@as(u64, 0), try decoder.decodeUint());
+    }
+    _ = try decoder.decodeText();
+    try std.testing.expectEqual(@as(usize, 0), (try decoder.decodeBytes()).len);
+    _ = try decoder.decodeText();
+    try std.testing.expectEqual(@as(i64, -5), std.mem.readInt(i64, (try decoder.decodeBytes())[0..8], .little));
+    _ = try decoder.decodeText();
+    try std.testing.expectEqual(@as(usize, 0), (try decoder.decodeBytes()).len);
+
+    // s: utf8 with offsets 0, 1
+    try decoder.skip();
+    // t: one packed bool
+    try std.testing.expectEqual(@as(usize, 7), try decoder.decodeMapLen());
+    for (0..10) |_| try decoder.skip();
+    try std.testing.expectEqualStrings("values", try decoder.decodeText());
+    try std.testing.expectEqualSlices(u8, &.{1}, try decoder.decodeBytes());
+}
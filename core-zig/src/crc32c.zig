@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph CRC32C - Hardware-Accelerated Castagnoli Checksums
+//
+// Every block read and write is checksummed, so this sits on the hot path.
+// The implementation is picked at compile time from the target CPU:
+//
+//   x86_64 + SSE4.2   crc32q / crc32b instructions
+//   aarch64 + CRC     crc32cx / crc32cb instructions
+//   otherwise         slicing-by-8 tables (8 bytes per step)
+//
+// All three produce bit-identical results to the byte-wise table used by
+// core-forth/src/lithoglyph-blocks.fs.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const builtin = @import("builtin");
+
+/// Reflected Castagnoli polynomial (0x1EDC6F41 bit-reversed)
+const POLY: u32 = 0x82F63B78;
+
+pub const Implementation = enum { sse42, armv8_crc, slicing_by_8 };
+
+/// Implementation selected for this build target
+pub const implementation: Implementation = blk: {
+    const features = builtin.cpu.features;
+    if (builtin.cpu.arch == .x86_64 and std.Target.x86.featureSetHas(features, .sse4_2)) break :blk .sse42;
+    if (builtin.cpu.arch == .aarch64 and std.Target.aarch64.featureSetHas(features, .crc)) break :blk .armv8_crc;
+    break :blk .slicing_by_8;
+};
+
+const TABLES = blk: {
+    @setEvalBranchQuota(20000); // Allow compile-time table generation
+    var tables: [8][256]u32 = undefined;
+    for (&tables[0], 0..) |*entry, i| {
+        var crc: u32 = @intCast(i);
+        var j: usize = 0;
+        while (j < 8) : (j += 1) {
+            if (crc & 1 != 0) {
+                crc = (crc >> 1) ^ POLY;
+            } else {
+                crc >>= 1;
+            }
+        }
+        entry.* = crc;
+    }
+    var k: usize = 1;
+    while (k < 8) : (k += 1) {
+        for (&tables[k], 0..) |*entry, i| {
+            const prev = tables[k - 1][i];
+            entry.* = (prev >> 8) ^ tables[0][prev & 0xFF];
+        }
+    }
+    break :blk tables;
+};
+
+/// Fold `data` into a running CRC (no initial/final inversion)
+pub fn update(crc_in: u32, data: []const u8) u32 {
+    return switch (implementation) {
+        .sse42 => updateSse42(crc_in, data),
+        .armv8_crc => updateArmv8(crc_in, data),
+        .slicing_by_8 => updateSlicing8(crc_in, data),
+    };
+}
+
+/// Byte-at-a-time reference (matches the Forth implementation)
+pub fn updateBytewise(crc_in: u32, data: []const u8) u32 {
+    var crc = crc_in;
+    for (data) |byte| {
+        crc = (crc >> 8) ^ TABLES[0][@as(u8, @truncate(crc)) ^ byte];
+    }
+    return crc;
+}
+
+pub fn updateSlicing8(crc_in: u32, data: []const u8) u32 {
+    var crc = crc_in;
+    var rest = data;
+    while (rest.len >= 8) : (rest = rest[8..]) {
+        const lo = crc ^ std.mem.readInt(u32, rest[0..4], .little);
+        const hi = std.mem.readInt(u32, rest[4..8], .little);
+        crc = TABLES[7][lo & 0xFF] ^
+            TABLES[6][(lo >> 8) & 0xFF] ^
+            TABLES[5][(lo >> 16) & 0xFF] ^
+            TABLES[4][lo >> 24] ^
+            TABLES[3][hi & 0xFF] ^
+            TABLES[2][(hi >> 8) & 0xFF] ^
+            TABLES[1][(hi >> 16) & 0xFF] ^
+            TABLES[0][hi >> 24];
+    }
+    return updateBytewise(crc, rest);
+}
+
+fn updateSse42(crc_in: u32, data: []const u8) u32 {
+    var crc: u64 = crc_in;
+    var rest = data;
+    while (rest.len >= 8) : (rest = rest[8..]) {
+        crc = asm ("crc32q %[value], %[ret]"
+            : [ret] "=r" (-> u64),
+            : [value] "r" (std.mem.readInt(u64, rest[0..8], .little)),
+              [crc_in] "0" (crc),
+        );
+    }
+    var crc32: u32 = @truncate(crc);
+    for (rest) |byte| {
+        crc32 = asm ("crc32b %[value], %[ret]"
+            : [ret] "=r" (-> u32),
+            : [value] "r" (byte),
+              [crc_in] "0" (crc32),
+        );
+    }
+    return crc32;
+}
+
+fn updateArmv8(crc_in: u32, data: []const u8) u32 {
+    var crc = crc_in;
+    var rest = data;
+    while (rest.len >= 8) : (rest = rest[8..]) {
+        crc = asm ("crc32cx %w[ret], %w[crc], %x[value]"
+            : [ret] "=r" (-> u32),
+            : [crc] "r" (crc),
+              [value] "r" (std.mem.readInt(u64, rest[0..8], .little)),
+        );
+    }
+    for (rest) |byte| {
+        crc = asm ("crc32cb %w[ret], %w[crc], %w[value]"
+            : [ret] "=r" (-> u32),
+            : [crc] "r" (crc),
+              [value] "r" (@as(u32, byte)),
+        );
+    }
+    return crc;
+}
+
+/// One-shot CRC32C with standard initial value and final inversion
+pub fn checksum(data: []const u8) u32 {
+    return update(0xFFFFFFFF, data) ^ 0xFFFFFFFF;
+}
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "standard check value" {
+    // CRC-32C/ISCSI check value (RFC 3720 B.4)
+    try std.testing.expectEqual(@as(u32, 0xE3069283), checksum("123456789"));
+    try std.testing.expectEqual(@as(u32, 0xE3069283), updateSlicing8(0xFFFFFFFF, "123456789") ^ 0xFFFFFFFF);
+}
+
+test "all implementations agree with the byte-wise table" {
+    var prng = std.Random.DefaultPrng.init(0x1EDC6F41);
+    var buf: [4096 + 7]u8 = undefined;
+    prng.random().bytes(&buf);
+
+    const lengths = [_]usize{ 0, 1, 7, 8, 9, 63, 4032, buf.len };
+    for (lengths) |len| {
+        // Unaligned start exercises the unaligned 8-byte loads
+        const data = buf[3 .. 3 + @min(len, buf.len - 3)];
+        const expected = updateBytewise(0xFFFFFFFF, data);
+        try std.testing.expectEqual(expected, updateSlicing8(0xFFFFFFFF, data));
+        try std.testing.expectEqual(expected, update(0xFFFFFFFF, data));
+    }
+}
+
+test "incremental update matches one-shot" {
+    const data = "stone-carved data for the ages";
+    const split = update(update(0xFFFFFFFF, data[0..11]), data[11..]);
+    try std.testing.expectEqual(checksum(data), split ^ 0xFFFFFFFF);
+}
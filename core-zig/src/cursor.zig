@@ -0,0 +1,371 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Cursors - Incremental Block Scans
+//
+// A BlockCursor walks one block type in ID order and hands out rows in
+// caller-sized batches, so a scan never holds more than one batch of
+// candidate IDs and one formatted row in memory. Each cursor reads from
+// its own snapshot, taken when it is opened: rows stay consistent however
+// long the caller takes to drain it.
+//
+// Rows are JSON objects, one per line, or CBOR maps back to back (an
+// RFC 8742 CBOR sequence) with the payload as a byte string.
+//
+// A RowFilter sees each document before it is formatted and decides
+// whether it becomes a row, and with what data: the query executor uses
+// it to evaluate predicates and projections inside the scan.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const blocks = @import("blocks.zig");
+const cbor = @import("cbor.zig");
+
+const Block = blocks.Block;
+const BlockStorage = blocks.BlockStorage;
+const Snapshot = blocks.Snapshot;
+
+/// Candidate IDs fetched from the type index per refill
+const ID_BATCH: usize = 256;
+
+/// Row encoding, matching LgRenderOpts.format
+pub const Format = enum(c_int) {
+    json = 0,
+    cbor = 1,
+};
+
+/// Append one document as a JSON object:
+/// {"block_id":N,"size":N,"data":"<escaped payload>"}
+pub fn appendBlockJson(allocator: std.mem.Allocator, out: *std.ArrayList(u8), block_id: u64, data: []const u8) !void {
+    var header_buf: [80]u8 = undefined;
+    const header_str = try std.fmt.bufPrint(&header_buf,
+        \\{{"block_id":{d},"size":{d},"data":"
+    , .{ block_id, data.len });
+    try out.appendSlice(allocator, header_str);
+    try appendJsonEscaped(allocator, out, data);
+    try out.appendSlice(allocator, "\"}");
+}
+
+/// Append `data` escaped for use inside a JSON string (no quotes)
+pub fn appendJsonEscaped(allocator: std.mem.Allocator, out: *std.ArrayList(u8), data: []const u8) !void {
+    for (data) |byte| {
+        switch (byte) {
+            '"' => try out.appendSlice(allocator, "\\\""),
+            '\\' => try out.appendSlice(allocator, "\\\\"),
+            '\n' => try out.appendSlice(allocator, "\\n"),
+            '\r' => try out.appendSlice(allocator, "\\r"),
+            '\t' => try out.appendSlice(allocator, "\\t"),
+            else => {
+                if (byte >= 0x20 and byte < 0x7F) {
+                    try out.append(allocator, byte);
+                } else {
+                    var hex_buf: [6]u8 = undefined;
+                    const hex_str = try std.fmt.bufPrint(&hex_buf, "\\u{x:0>4}", .{byte});
+                    try out.appendSlice(allocator, hex_str);
+                }
+            },
+        }
+    }
+}
+
+/// Append one document as a CBOR map with the payload left unescaped:
+/// {"block_id": uint, "size": uint, "data": bytes}
+pub fn appendBlockCbor(encoder: *cbor.Encoder, block_id: u64, data: []const u8) !void {
+    // One reservation per row, so large payloads are copied once
+    try encoder.reserve(1 + cbor.stringSize("block_id".len) + cbor.headSize(block_id) +
+        cbor.stringSize("size".len) + cbor.headSize(data.len) + cbor.stringSize("data".len) + cbor.stringSize(data.len));
+    try encoder.beginMap(3);
+    try encoder.encodeText("block_id");
+    try encoder.encodeUint(block_id);
+    try encoder.encodeText("size");
+    try encoder.encodeUint(data.len);
+    try encoder.encodeText("data");
+    try encoder.encodeBytes(data);
+}
+
+/// What a RowFilter makes of one document
+pub const Verdict = union(enum) {
+    /// Not a row
+    skip,
+    /// A row with this data (valid until the next call)
+    emit: []const u8,
+    /// The last row: emit it and end the scan
+    last: []const u8,
+    /// End the scan without emitting
+    stop,
+};
+
+pub const RowFilter = struct {
+    ctx: *anyopaque,
+    applyFn: *const fn (ctx: *anyopaque, block_id: u64, data: []const u8) anyerror!Verdict,
+
+    pub fn apply(self: RowFilter, block_id: u64, data: []const u8) !Verdict {
+        return self.applyFn(self.ctx, block_id, data);
+    }
+};
+
+pub const BlockCursor = struct {
+    allocator: std.mem.Allocator,
+    storage: *BlockStorage,
+    snapshot: Snapshot,
+    block_type: u16,
+    format: Format,
+
+    // Candidate IDs from the type index and where the next refill resumes
+    ids: std.ArrayList(u64) = .{},
+    pos: usize = 0,
+    next_from: u64 = 1,
+
+    // Formatted row that did not fit the caller's last buffer
+    row: cbor.Encoder,
+    row_ready: bool = false,
+
+    // Reassembled payload of the current chained document
+    doc: std.ArrayList(u8) = .{},
+
+    filter: ?RowFilter = null,
+    done: bool = false,
+
+    /// Blocks read so far: each candidate pinned plus its overflow chain
+    blocks_touched: u64 = 0,
+
+    pub fn open(allocator: std.mem.Allocator, storage: *BlockStorage, block_type: u16, format: Format) !BlockCursor {
+        return .{
+            .allocator = allocator,
+            .storage = storage,
+            .snapshot = try storage.beginSnapshot(),
+            .block_type = block_type,
+            .format = format,
+            .row = cbor.Encoder.init(allocator),
+        };
+    }
+
+    pub fn close(self: *BlockCursor) void {
+        self.storage.endSnapshot(self.snapshot);
+        self.ids.deinit(self.allocator);
+        self.row.deinit();
+        self.doc.deinit(self.allocator);
+    }
+
+    /// Copy as many whole rows as fit into `buf`. Returns the bytes written; 0 means the scan is
+    /// exhausted. Fails with BufferTooSmall when the next row alone does
+    /// not fit; `pendingRowLen` then gives the size needed.
+    pub fn fill(self: *BlockCursor, buf: []u8) !usize {
+        var written: usize = 0;
+        while (true) {
+            if (!self.row_ready and !try self.nextRow()) break;
+
+            const row = self.row.finish();
+            if (row.len > buf.len - written) {
+                if (written == 0) return error.BufferTooSmall;
+                break;
+            }
+            @memcpy(buf[written..][0..row.len], row);
+            written += row.len;
+            self.row_ready = false;
+        }
+        return written;
+    }
+
+    pub fn pendingRowLen(self: *const BlockCursor) usize {
+        return if (self.row_ready) self.row.finish().len else 0;
+    }
+
+    /// Visit only `ids` (ascending) instead of every block of the type
+    pub fn restrictTo(self: *BlockCursor, ids: []const u64) !void {
+        self.ids.clearRetainingCapacity();
+        try self.ids.appendSlice(self.allocator, ids);
+        self.pos = 0;
+        self.next_from = std.math.maxInt(u64);
+    }
+
+    /// Format the next visible block into `row`; false once exhausted
+    fn nextRow(self: *BlockCursor) !bool {
+        const storage = self.storage;
+        var scratch: Block = undefined;
+
+        while (!self.done) {
+            if (self.pos == self.ids.items.len) {
+                if (self.next_from >= self.snapshot.block_count) return false;
+                self.ids.clearRetainingCapacity();
+                self.pos = 0;
+                self.next_from = try storage.blocksOfType(
+                    self.allocator,
+                    self.block_type,
+                    self.snapshot,
+                    self.next_from,
+                    ID_BATCH,
+                    &self.ids,
+                );
+                continue;
+            }
+
+            const block_id = self.ids.items[self.pos];
+            self.pos += 1;
+
+            const block = storage.pinBlockAt(block_id, self.snapshot, &scratch) catch continue;
+            defer storage.unpinBlock(block);
+            self.blocks_touched += 1;
+            if (block.header.block_type != self.block_type) continue;
+            if (block.header.flags & blocks.FLAG_DELETED != 0) continue;
+
+            if (try blocks.OverflowHeader.of(block)) |chain| self.blocks_touched += chain.block_count;
+            var data = try storage.readChain(self.allocator, block, self.snapshot, &self.doc);
+            if (self.filter) |row_filter| {
+                switch (try row_filter.apply(block_id, data)) {
+                    .skip => continue,
+                    .emit => |projected| data = projected,
+                    .last => |projected| {
+                        data = projected;
+                        self.done = true;
+                    },
+                    .stop => {
+                        self.done = true;
+                        return false;
+                    },
+                }
+            }
+            self.row.reset();
+            switch (self.format) {
+                .json => {
+                    try appendBlockJson(self.allocator, &self.row.buffer, block_id, data);
+                    try self.row.buffer.append(self.allocator, '\n');
+                },
+                .cbor => try appendBlockCbor(&self.row, block_id, data),
+            }
+            self.row_ready = true;
+            return true;
+        }
+        return false;
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "cursor streams rows in caller-sized batches" {
+    const allocator = std.testing.allocator;
+    const path = "test_cursor.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const storage = try BlockStorage.open(allocator, path);
+    defer storage.deinit();
+
+    const first = storage.reserveBlockIds(3);
+    const writes = [_]blocks.BlockWrite{
+        .{ .block_id = first, .block_type = .document, .payload = "one" },
+        .{ .block_id = first + 1, .block_type = .schema, .payload = "skip" },
+        .{ .block_id = first + 2, .block_type = .document, .payload = "two" },
+    };
+    const records = [_]blocks.JournalRecord{.{ .op = .doc_insert, .affected_block = first, .forward = "INSERT" }};
+    var batch = blocks.CommitBatch{ .journal = &records, .writes = &writes };
+    try storage.commit(&batch);
+
+    var cursor = try BlockCursor.open(allocator, storage, @intFromEnum(blocks.BlockType.document), .json);
+    defer cursor.close();
+
+    // Too small for any row
+    var tiny: [8]u8 = undefined;
+    try std.testing.expectError(error.BufferTooSmall, cursor.fill(&tiny));
+    try std.testing.expect(cursor.pendingRowLen() > tiny.len);
+
+    // Room for exactly one row at a time
+    var buf: [64]u8 = undefined;
+    const n1 = try cursor.fill(buf[0..cursor.pendingRowLen()]);
+    try std.testing.expect(std.mem.indexOf(u8, buf[0..n1], "\"data\":\"one\"") != null);
+
+    const n2 = try cursor.fill(&buf);
+    try std.testing.expect(std.mem.indexOf(u8, buf[0..n2], "\"data\":\"two\"") != null);
+    try std.testing.expectEqual(@as(usize, 0), try cursor.fill(&buf));
+}
+
+test "cbor rows carry payloads as byte strings" {
+    const allocator = std.testing.allocator;
+    const path = "test_cursor_cbor.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const storage = try BlockStorage.open(allocator, path);
+    defer storage.deinit();
+
+    const payload = [_]u8{ 0x00, '"', 0xFF };
+    const first = storage.reserveBlockIds(1);
+    const writes = [_]blocks.BlockWrite{.{ .block_id = first, .block_type = .document, .payload = &payload }};
+    const records = [_]blocks.JournalRecord{.{ .op = .doc_insert, .affected_block = first, .forward = "INSERT" }};
+    var batch = blocks.CommitBatch{ .journal = &records, .writes = &writes };
+    try storage.commit(&batch);
+
+    var cursor = try BlockCursor.open(allocator, storage, @intFromEnum(blocks.BlockType.document), .cbor);
+    defer cursor.close();
+
+    var buf: [64]u8 = undefined;
+    const n = try cursor.fill(&buf);
+
+    var decoder = cbor.Decoder.init(allocator, buf[0..n]);
+    try std.testing.expectEqual(@as(usize, 3), try decoder.decodeMapLen());
+    try std.testing.expectEqualStrings("block_id", try decoder.decodeText());
+    try std.testing.expectEqual(first, try decoder.decodeUint());
+    try std.testing.expectEqualStrings("size", try decoder.decodeText());
+    try std.testing.expectEqual(@as(u64, payload.len), try decoder.decodeUint());
+    try std.testing.expectEqualStrings("data", try decoder.decodeText());
+    try std.testing.expectEqualSlices(u8, &payload, try decoder.decodeBytes());
+    try std.testing.expectEqual(n, decoder.pos);
+}
+
+test "filters choose rows and end the scan early" {
+    const allocator = std.testing.allocator;
+    const path = "test_cursor_filter.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const storage = try BlockStorage.open(allocator, path);
+    defer storage.deinit();
+
+    const first = storage.reserveBlockIds(4);
+    const writes = [_]blocks.BlockWrite{
+        .{ .block_id = first, .block_type = .document, .payload = "a1" },
+        .{ .block_id = first + 1, .block_type = .document, .payload = "b2" },
+        .{ .block_id = first + 2, .block_type = .document, .payload = "a3" },
+        .{ .block_id = first + 3, .block_type = .document, .payload = "a4" },
+    };
+    const records = [_]blocks.JournalRecord{.{ .op = .doc_insert, .affected_block = first, .forward = "INSERT" }};
+    var batch = blocks.CommitBatch{ .journal = &records, .writes = &writes };
+    try storage.commit(&batch);
+
+    // Documents starting with 'a', renamed, at most two
+    const OnlyA = struct {
+        emitted: usize = 0,
+
+        fn apply(ctx: *anyopaque, _: u64, data: []const u8) anyerror!Verdict {
+            const self: *@This() = @ptrCast(@alignCast(ctx));
+            if (data[0] != 'a') return .skip;
+            self.emitted += 1;
+            return if (self.emitted == 2) .{ .last = "last" } else .{ .emit = "first" };
+        }
+    };
+    var only_a = OnlyA{};
+
+    var cursor = try BlockCursor.open(allocator, storage, @intFromEnum(blocks.BlockType.document), .json);
+    defer cursor.close();
+    cursor.filter = .{ .ctx = &only_a, .applyFn = OnlyA.apply };
+
+    var buf: [256]u8 = undefined;
+    const n = try cursor.fill(&buf);
+    try std.testing.expectEqual(@as(usize, 2), std.mem.count(u8, buf[0..n], "\n"));
+    try std.testing.expect(std.mem.indexOf(u8, buf[0..n], "\"data\":\"first\"") != null);
+    try std.testing.expect(std.mem.indexOf(u8, buf[0..n], "\"data\":\"last\"") != null);
+    try std.testing.expectEqual(@as(usize, 0), try cursor.fill(&buf));
+
+    // The fourth block was never read
+    try std.testing.expectEqual(@as(u64, 3), cursor.blocks_touched);
+
+    // A restricted cursor pins only the IDs it is given
+    var lookup = try BlockCursor.open(allocator, storage, @intFromEnum(blocks.BlockType.document), .json);
+    defer lookup.close();
+    try lookup.restrictTo(&.{ first + 1, first + 1000 });
+    const m = try lookup.fill(&buf);
+    try std.testing.expect(std.mem.indexOf(u8, buf[0..m], "\"data\":\"b2\"") != null);
+    try std.testing.expectEqual(@as(usize, 0), try lookup.fill(&buf));
+    try std.testing.expectEqual(@as(u64, 1), lookup.blocks_touched);
+}
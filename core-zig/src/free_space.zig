@@ -0,0 +1,287 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Free-Space Map - Bitmap Allocator for Block Reuse
+//
+// One bit per block (set = free), kept in memory and persisted as
+// free_space_map blocks. Each map page covers BITS_PER_PAGE blocks:
+//
+//   Offset  Size  Field
+//   0       8     page_index (page k covers blocks k*BITS_PER_PAGE ..)
+//   8       4024  bitmap, LSB-first within each byte
+//
+// Pages are chained newest-to-oldest through the block header's
+// prev_block_id; the superblock records the newest page.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const blocks = @import("blocks.zig");
+
+const PAYLOAD_SIZE = blocks.PAYLOAD_SIZE;
+
+const PAGE_INDEX_SIZE: usize = 8;
+const BITMAP_BYTES: usize = PAYLOAD_SIZE - PAGE_INDEX_SIZE;
+pub const BITS_PER_PAGE: u64 = BITMAP_BYTES * 8;
+
+/// Not thread-safe: BlockStorage guards it with its alloc_mutex
+pub const FreeSpaceMap = struct {
+    allocator: std.mem.Allocator,
+    bits: std.DynamicBitSetUnmanaged = .{},
+    /// Block ID of each map page (0 = not yet placed on disk)
+    pages: std.ArrayList(u64) = .{},
+    dirty: std.ArrayList(bool) = .{},
+    free_count: u64 = 0,
+    /// Next-fit cursor so successive allocations walk forward
+    cursor: u64 = 0,
+    /// Freed by a commit group that has not published: set in `bits`, so
+    /// the pages it writes show them free, but not allocated (or counted)
+    /// until `publishHeld`
+    held: std.DynamicBitSetUnmanaged = .{},
+    held_ids: std.ArrayList(u64) = .{},
+
+    pub fn init(allocator: std.mem.Allocator) FreeSpaceMap {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(self: *FreeSpaceMap) void {
+        self.bits.deinit(self.allocator);
+        self.held.deinit(self.allocator);
+        self.held_ids.deinit(self.allocator);
+        self.pages.deinit(self.allocator);
+        self.dirty.deinit(self.allocator);
+    }
+
+    pub fn pageCount(self: *const FreeSpaceMap) usize {
+        return self.pages.items.len;
+    }
+
+    /// Grow to at least `page_count` pages (new pages start all-used)
+    pub fn ensurePages(self: *FreeSpaceMap, page_count: usize) !void {
+        if (page_count <= self.pages.items.len) return;
+        try self.bits.resize(self.allocator, page_count * BITS_PER_PAGE, false);
+        try self.held.resize(self.allocator, page_count * BITS_PER_PAGE, false);
+        while (self.pages.items.len < page_count) {
+            try self.pages.append(self.allocator, 0);
+            try self.dirty.append(self.allocator, true);
+        }
+    }
+
+    /// Pages needed to describe `block_count` blocks
+    pub fn pagesFor(block_count: u64) usize {
+        return @intCast((block_count + BITS_PER_PAGE - 1) / BITS_PER_PAGE);
+    }
+
+    pub fn isFree(self: *const FreeSpaceMap, block_id: u64) bool {
+        return self.isSet(block_id) and !self.held.isSet(@intCast(block_id));
+    }
+
+    pub fn markFree(self: *FreeSpaceMap, block_id: u64) !void {
+        try self.ensurePages(pagesFor(block_id + 1));
+        if (self.isSet(block_id)) return;
+        self.bits.set(@intCast(block_id));
+        self.free_count += 1;
+        self.dirty.items[@intCast(block_id / BITS_PER_PAGE)] = true;
+        if (block_id < self.cursor) self.cursor = block_id;
+    }
+
+    /// Free `block_id` on behalf of a commit group still in flight
+    pub fn hold(self: *FreeSpaceMap, block_id: u64) !void {
+        try self.ensurePages(pagesFor(block_id + 1));
+        if (self.isSet(block_id)) return;
+        try self.held_ids.append(self.allocator, block_id);
+        self.bits.set(@intCast(block_id));
+        self.held.set(@intCast(block_id));
+        self.dirty.items[@intCast(block_id / BITS_PER_PAGE)] = true;
+    }
+
+    /// The group published: its held blocks can be reused
+    pub fn publishHeld(self: *FreeSpaceMap) void {
+        for (self.held_ids.items) |block_id| {
+            self.held.unset(@intCast(block_id));
+            self.free_count += 1;
+            if (block_id < self.cursor) self.cursor = block_id;
+        }
+        self.held_ids.clearRetainingCapacity();
+    }
+
+    /// The group failed: its held blocks stay in use
+    pub fn dropHeld(self: *FreeSpaceMap) void {
+        for (self.held_ids.items) |block_id| {
+            self.held.unset(@intCast(block_id));
+            self.bits.unset(@intCast(block_id));
+            self.dirty.items[@intCast(block_id / BITS_PER_PAGE)] = true;
+        }
+        self.held_ids.clearRetainingCapacity();
+    }
+
+    fn isSet(self: *const FreeSpaceMap, block_id: u64) bool {
+        if (block_id >= self.bits.bit_length) return false;
+        return self.bits.isSet(@intCast(block_id));
+    }
+
+    pub fn markUsed(self: *FreeSpaceMap, block_id: u64) void {
+        if (!self.isFree(block_id)) return;
+        self.bits.unset(@intCast(block_id));
+        self.free_count -= 1;
+        self.dirty.items[@intCast(block_id / BITS_PER_PAGE)] = true;
+    }
+
+    /// Claim `count` contiguous free blocks, returning the first ID
+    pub fn allocate(self: *FreeSpaceMap, count: u64) ?u64 {
+        if (count == 0 or self.free_count < count) return null;
+
+        var start = self.findRun(self.cursor, count);
+        if (start == null and self.cursor > 0) start = self.findRun(0, count);
+        const first = start orelse return null;
+
+        var id = first;
+        while (id < first + count) : (id += 1) self.markUsed(id);
+        self.cursor = first + count;
+        return first;
+    }
+
+    /// First run of `count` free blocks at or after `from`
+    fn findRun(self: *const FreeSpaceMap, from: u64, count: u64) ?u64 {
+        var it = self.bits.iterator(.{});
+        var run_start: u64 = 0;
+        var run_len: u64 = 0;
+        while (it.next()) |bit| {
+            const id: u64 = @intCast(bit);
+            if (id < from) continue;
+            if (self.held.isSet(bit)) {
+                run_len = 0;
+                continue;
+            }
+            if (run_len > 0 and id == run_start + run_len) {
+                run_len += 1;
+            } else {
+                run_start = id;
+                run_len = 1;
+            }
+            if (run_len == count) return run_start;
+        }
+        return null;
+    }
+
+    /// Serialize page `index` into a block payload
+    pub fn encodePage(self: *const FreeSpaceMap, index: usize, out: *[PAYLOAD_SIZE]u8) void {
+        std.mem.writeInt(u64, out[0..PAGE_INDEX_SIZE], index, .little);
+        const bitmap = out[PAGE_INDEX_SIZE..];
+        @memset(bitmap, 0);
+
+        const base: u64 = index * BITS_PER_PAGE;
+        var bit: u64 = 0;
+        while (bit < BITS_PER_PAGE) : (bit += 1) {
+            if (self.bits.isSet(@intCast(base + bit))) {
+                bitmap[@intCast(bit / 8)] |= @as(u8, 1) << @intCast(bit % 8);
+            }
+        }
+    }
+
+    /// Load a page read from disk (`block_id` is where it lives)
+    pub fn loadPage(self: *FreeSpaceMap, block_id: u64, payload: []const u8) !void {
+        if (payload.len != PAYLOAD_SIZE) return error.InvalidFreeSpaceMap;
+        const index: usize = @intCast(std.mem.readInt(u64, payload[0..PAGE_INDEX_SIZE], .little));
+        try self.ensurePages(index + 1);
+
+        const bitmap = payload[PAGE_INDEX_SIZE..];
+        const base: u64 = index * BITS_PER_PAGE;
+        for (bitmap, 0..) |byte, byte_index| {
+            if (byte == 0) continue;
+            var b: u4 = 0;
+            while (b < 8) : (b += 1) {
+                if (byte & (@as(u8, 1) << @intCast(b)) != 0) {
+                    const id = base + byte_index * 8 + b;
+                    if (!self.bits.isSet(@intCast(id))) {
+                        self.bits.set(@intCast(id));
+                        self.free_count += 1;
+                    }
+                }
+            }
+        }
+        self.pages.items[index] = block_id;
+        self.dirty.items[index] = false;
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "freed blocks are reused" {
+    var map = FreeSpaceMap.init(std.testing.allocator);
+    defer map.deinit();
+
+    try map.markFree(10);
+    try map.markFree(11);
+    try std.testing.expectEqual(@as(u64, 2), map.free_count);
+
+    try std.testing.expectEqual(@as(?u64, 10), map.allocate(1));
+    try std.testing.expectEqual(@as(?u64, 11), map.allocate(1));
+    try std.testing.expectEqual(@as(?u64, null), map.allocate(1));
+}
+
+test "extents are contiguous" {
+    var map = FreeSpaceMap.init(std.testing.allocator);
+    defer map.deinit();
+
+    // Holes: 3, then 7..10
+    try map.markFree(3);
+    var id: u64 = 7;
+    while (id <= 10) : (id += 1) try map.markFree(id);
+
+    try std.testing.expectEqual(@as(?u64, 7), map.allocate(3));
+    try std.testing.expectEqual(@as(?u64, null), map.allocate(2));
+
+    // Next-fit: continue past the extent before wrapping around
+    try std.testing.expectEqual(@as(?u64, 10), map.allocate(1));
+    try std.testing.expectEqual(@as(?u64, 3), map.allocate(1));
+}
+
+test "held blocks are written free but only reused once published" {
+    var map = FreeSpaceMap.init(std.testing.allocator);
+    defer map.deinit();
+
+    try map.markFree(4);
+    try map.hold(5);
+    try map.hold(6);
+    try std.testing.expect(!map.isFree(5));
+    try std.testing.expectEqual(@as(u64, 1), map.free_count);
+    try std.testing.expectEqual(@as(?u64, null), map.allocate(2));
+
+    var payload: [PAYLOAD_SIZE]u8 = undefined;
+    map.encodePage(0, &payload);
+    try std.testing.expectEqual(@as(u8, 0b0111_0000), payload[PAGE_INDEX_SIZE]);
+
+    map.publishHeld();
+    try std.testing.expectEqual(@as(u64, 3), map.free_count);
+    try std.testing.expectEqual(@as(?u64, 4), map.allocate(3));
+
+    // A failed group's frees are forgotten
+    try map.hold(9);
+    map.dropHeld();
+    try std.testing.expect(!map.isFree(9));
+    try std.testing.expectEqual(@as(?u64, null), map.allocate(1));
+}
+
+test "page encoding roundtrip" {
+    var map = FreeSpaceMap.init(std.testing.allocator);
+    defer map.deinit();
+
+    try map.markFree(5);
+    try map.markFree(BITS_PER_PAGE + 1);
+
+    var payload: [PAYLOAD_SIZE]u8 = undefined;
+    var loaded = FreeSpaceMap.init(std.testing.allocator);
+    defer loaded.deinit();
+
+    for (0..map.pageCount()) |index| {
+        map.encodePage(index, &payload);
+        try loaded.loadPage(100 + index, &payload);
+    }
+
+    try std.testing.expect(loaded.isFree(5));
+    try std.testing.expect(loaded.isFree(BITS_PER_PAGE + 1));
+    try std.testing.expect(!loaded.isFree(6));
+    try std.testing.expectEqual(@as(u64, 2), loaded.free_count);
+    try std.testing.expectEqual(@as(u64, 101), loaded.pages.items[1]);
+}
@@ -0,0 +1,342 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Handles - Generation-Tagged Handle Tables
+//
+// Bridge handles (databases, transactions, cursors) are slot indices into
+// a HandleTable rather than raw pointers checked against a hash set:
+//
+//   handle   generation << INDEX_BITS | slot index
+//
+// Validating a handle is an array lookup and a generation compare; no
+// lock is taken and nothing is hashed. Freeing a slot bumps its
+// generation, so a stale or double-closed handle no longer matches and
+// is rejected instead of aliasing whatever reuses the slot. Free slots
+// form a lock-free stack (tagged head, so a pop racing a pop and push of
+// the same slot cannot corrupt it). Slot pages are allocated on demand
+// and never freed, so readers can index them without synchronisation.
+//
+// ReadMostly publishes an immutable value that readers borrow without
+// locking; writers replace it and wait out a short grace period before
+// freeing the old one (two-counter quiescence, as in userspace RCU).
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+
+/// Low bits of a handle that select the slot
+pub const INDEX_BITS = 20;
+
+/// Slots allocated together; pages live as long as the table
+const PAGE_SLOTS = 1024;
+const MAX_PAGES = (1 << INDEX_BITS) / PAGE_SLOTS;
+
+/// Most live handles one table can hold
+pub const CAPACITY: u32 = 1 << INDEX_BITS;
+
+/// Generation bits that fit above the index in a handle
+const GEN_BITS = @min(32, @bitSizeOf(usize) - INDEX_BITS);
+const GEN_MASK: u32 = @intCast((@as(u64, 1) << GEN_BITS) - 1);
+const INDEX_MASK: usize = (1 << INDEX_BITS) - 1;
+
+/// Free-list link meaning "end of list" (links store index + 1)
+const NIL: u32 = 0;
+
+pub fn HandleTable(comptime T: type) type {
+    return struct {
+        const Self = @This();
+
+        const Slot = struct {
+            value: std.atomic.Value(?*T) = .init(null),
+            generation: std.atomic.Value(u32) = .init(1),
+            next_free: std.atomic.Value(u32) = .init(NIL),
+        };
+        const Page = [PAGE_SLOTS]Slot;
+
+        allocator: std.mem.Allocator,
+        pages: [MAX_PAGES]std.atomic.Value(?*Page) = @splat(.init(null)),
+        // Slots ever handed out; every index below it has a page
+        len: std.atomic.Value(u32) = .init(0),
+        // Pop count << 32 | (index + 1) of the top free slot
+        free_head: std.atomic.Value(u64) = .init(NIL),
+
+        pub fn init(allocator: std.mem.Allocator) Self {
+            return .{ .allocator = allocator };
+        }
+
+        /// Free the slot pages. No handle may be used afterwards.
+        pub fn deinit(self: *Self) void {
+            for (&self.pages) |*page| {
+                if (page.load(.acquire)) |p| self.allocator.destroy(p);
+            }
+        }
+
+        /// Store `value` in a free slot and return its handle (never 0)
+        pub fn insert(self: *Self, value: *T) !usize {
+            const index = self.popFree() orelse try self.grow();
+            const slot = self.slotAt(index);
+            slot.value.store(value, .release);
+            return encode(slot.generation.load(.acquire), index);
+        }
+
+        /// The value behind `handle`, or null if it is 0, stale or never issued.
+        /// The value stays valid only until the handle is removed; callers
+        /// must not race a remove of the same handle.
+        pub fn get(self: *Self, handle: usize) ?*T {
+            const slot = self.slotFor(handle) orelse return null;
+            if (slot.generation.load(.acquire) & GEN_MASK != handleGeneration(handle)) return null;
+            return slot.value.load(.acquire);
+        }
+
+        /// Invalidate `handle` and return its value. Of several threads
+        /// removing the same handle, exactly one gets the value.
+        pub fn remove(self: *Self, handle: usize) ?*T {
+            const slot = self.slotFor(handle) orelse return null;
+            var generation = slot.generation.load(.acquire);
+            while (generation & GEN_MASK == handleGeneration(handle)) {
+                generation = slot.generation.cmpxchgWeak(generation, nextGeneration(generation), .acq_rel, .acquire) orelse {
+                    const value = slot.value.swap(null, .acq_rel);
+                    self.pushFree(@intCast(handle & INDEX_MASK));
+                    return value;
+                };
+            }
+            return null;
+        }
+
+        /// Live handles in slot order. Entries inserted or removed during
+        /// iteration may or may not be seen.
+        pub fn iterator(self: *Self) Iterator {
+            return .{ .table = self, .end = self.len.load(.acquire) };
+        }
+
+        pub const Entry = struct {
+            handle: usize,
+            value: *T,
+        };
+
+        pub const Iterator = struct {
+            table: *Self,
+            index: u32 = 0,
+            end: u32,
+
+            pub fn next(it: *Iterator) ?Entry {
+                while (it.index < it.end) {
+                    const index = it.index;
+                    it.index += 1;
+                    const slot = it.table.slotAt(index);
+                    const generation = slot.generation.load(.acquire);
+                    if (slot.value.load(.acquire)) |value| {
+                        return .{ .handle = encode(generation, index), .value = value };
+                    }
+                }
+                return null;
+            }
+        };
+
+        fn slotAt(self: *Self, index: u32) *Slot {
+            const page = self.pages[index / PAGE_SLOTS].load(.acquire).?;
+            return &page[index % PAGE_SLOTS];
+        }
+
+        fn slotFor(self: *Self, handle: usize) ?*Slot {
+            const index = handle & INDEX_MASK;
+            if (index >= self.len.load(.acquire)) return null;
+            return self.slotAt(@intCast(index));
+        }
+
+        /// Claim a never-used slot, allocating its page first if needed
+        fn grow(self: *Self) !u32 {
+            var len = self.len.load(.acquire);
+            while (true) {
+                if (len >= CAPACITY) return error.TooManyHandles;
+                try self.ensurePage(len / PAGE_SLOTS);
+                len = self.len.cmpxchgWeak(len, len + 1, .acq_rel, .acquire) orelse return len;
+            }
+        }
+
+        fn ensurePage(self: *Self, page_index: u32) !void {
+            const entry = &self.pages[page_index];
+            if (entry.load(.acquire) != null) return;
+
+            const page = try self.allocator.create(Page);
+            page.* = @splat(.{});
+            // Another thread may have installed the page meanwhile
+            if (entry.cmpxchgStrong(null, page, .acq_rel, .acquire) != null) {
+                self.allocator.destroy(page);
+            }
+        }
+
+        fn popFree(self: *Self) ?u32 {
+            var head = self.free_head.load(.acquire);
+            while (true) {
+                const top: u32 = @truncate(head);
+                if (top == NIL) return null;
+                const index = top - 1;
+                const next = self.slotAt(index).next_free.load(.acquire);
+                const tag = (head >> 32) +% 1;
+                head = self.free_head.cmpxchgWeak(head, tag << 32 | next, .acq_rel, .acquire) orelse return index;
+            }
+        }
+
+        fn pushFree(self: *Self, index: u32) void {
+            const slot = self.slotAt(index);
+            var head = self.free_head.load(.acquire);
+            while (true) {
+                slot.next_free.store(@truncate(head), .release);
+                const new_head = (head & ~@as(u64, 0xFFFF_FFFF)) | (index + 1);
+                head = self.free_head.cmpxchgWeak(head, new_head, .acq_rel, .acquire) orelse return;
+            }
+        }
+    };
+}
+
+fn encode(generation: u32, index: u32) usize {
+    return @as(usize, generation & GEN_MASK) << INDEX_BITS | index;
+}
+
+fn handleGeneration(handle: usize) u32 {
+    return @intCast(handle >> INDEX_BITS & GEN_MASK);
+}
+
+/// Generations skip values that encode as 0, so every handle is non-zero
+fn nextGeneration(generation: u32) u32 {
+    const next = generation +% 1;
+    return if (next & GEN_MASK == 0) next +% 1 else next;
+}
+
+/// A value read far more often than replaced. Readers borrow it between
+/// `acquire` and `release` without locking; `replace` swaps in a new one
+/// and returns the old once no reader can still hold it.
+pub fn ReadMostly(comptime T: type) type {
+    return struct {
+        const Self = @This();
+
+        current: std.atomic.Value(?*const T) = .init(null),
+        epoch: std.atomic.Value(usize) = .init(0),
+        readers: [2]std.atomic.Value(usize) = .{ .init(0), .init(0) },
+        // Serializes writers
+        mutex: std.Thread.Mutex = .{},
+
+        pub const Guard = struct {
+            parity: usize,
+            value: ?*const T,
+        };
+
+        /// Borrow the current value; keep the section short
+        pub fn acquire(self: *Self) Guard {
+            const parity = self.epoch.load(.seq_cst) & 1;
+            _ = self.readers[parity].fetchAdd(1, .seq_cst);
+            return .{ .parity = parity, .value = self.current.load(.seq_cst) };
+        }
+
+        pub fn release(self: *Self, guard: Guard) void {
+            _ = self.readers[guard.parity].fetchSub(1, .release);
+        }
+
+        /// Publish `next` (caller holds `mutex`) and wait until every
+        /// reader that might have seen the previous value has released it.
+        /// The caller owns the returned value.
+        pub fn replaceLocked(self: *Self, next: ?*const T) ?*const T {
+            const old = self.current.swap(next, .seq_cst);
+            // Flip twice, draining each counter while new readers go to
+            // the other: readers that entered before the swap sit in one
+            // of the two
+            for (0..2) |_| {
+                const parity = self.epoch.fetchAdd(1, .seq_cst) & 1;
+                while (self.readers[parity].load(.seq_cst) != 0) std.Thread.yield() catch {};
+            }
+            return old;
+        }
+    };
+}
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "stale handles are rejected after their slot is reused" {
+    var table = HandleTable(u32).init(std.testing.allocator);
+    defer table.deinit();
+
+    var a: u32 = 1;
+    var b: u32 = 2;
+    const first = try table.insert(&a);
+    try std.testing.expect(first != 0);
+    try std.testing.expectEqual(&a, table.get(first).?);
+    try std.testing.expect(table.get(0) == null);
+    try std.testing.expect(table.get(first + 1) == null);
+
+    try std.testing.expectEqual(&a, table.remove(first).?);
+    try std.testing.expect(table.remove(first) == null);
+    try std.testing.expect(table.get(first) == null);
+
+    // Same slot, new generation
+    const second = try table.insert(&b);
+    try std.testing.expectEqual(first & INDEX_MASK, second & INDEX_MASK);
+    try std.testing.expect(second != first);
+    try std.testing.expect(table.get(first) == null);
+    try std.testing.expectEqual(&b, table.get(second).?);
+
+    var count: usize = 0;
+    var it = table.iterator();
+    while (it.next()) |entry| : (count += 1) try std.testing.expectEqual(second, entry.handle);
+    try std.testing.expectEqual(@as(usize, 1), count);
+}
+
+test "handles survive concurrent insert and remove" {
+    var table = HandleTable(u64).init(std.testing.allocator);
+    defer table.deinit();
+
+    const Worker = struct {
+        fn run(t: *HandleTable(u64), seed: usize, failures: *std.atomic.Value(u32)) void {
+            churn(t, seed) catch {
+                _ = failures.fetchAdd(1, .monotonic);
+            };
+        }
+
+        fn churn(t: *HandleTable(u64), seed: usize) !void {
+            var values: [64]u64 = undefined;
+            var owned: [64]usize = undefined;
+            for (0..200) |round| {
+                for (&values, &owned, 0..) |*value, *handle, i| {
+                    value.* = seed * 1_000_000 + round * 64 + i;
+                    handle.* = try t.insert(value);
+                }
+                for (values, owned) |value, handle| {
+                    if (t.get(handle).?.* != value) return error.TestUnexpectedResult;
+                    if (t.remove(handle) == null) return error.TestUnexpectedResult;
+                }
+            }
+        }
+    };
+
+    var failures = std.atomic.Value(u32).init(0);
+    var threads: [4]std.Thread = undefined;
+    for (&threads, 0..) |*thread, i| thread.* = try std.Thread.spawn(.{}, Worker.run, .{ &table, i + 1, &failures });
+    for (threads) |thread| thread.join();
+    try std.testing.expectEqual(@as(u32, 0), failures.load(.acquire));
+
+    // Slots were recycled rather than grown per insert
+    try std.testing.expect(table.len.load(.acquire) <= 4 * 64);
+    var it = table.iterator();
+    try std.testing.expect(it.next() == null);
+}
+
+test "read-mostly values are replaced after readers release them" {
+    var cell: ReadMostly(u32) = .{};
+    const first: u32 = 1;
+    const second: u32 = 2;
+
+    cell.mutex.lock();
+    try std.testing.expect(cell.replaceLocked(&first) == null);
+    cell.mutex.unlock();
+
+    const guard = cell.acquire();
+    try std.testing.expectEqual(@as(u32, 1), guard.value.?.*);
+    cell.release(guard);
+
+    cell.mutex.lock();
+    try std.testing.expectEqual(&first, cell.replaceLocked(&second).?);
+    cell.mutex.unlock();
+    const after = cell.acquire();
+    defer cell.release(after);
+    try std.testing.expectEqual(@as(u32, 2), after.value.?.*);
+}
@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Journal Archive - Compacted History Behind a Checkpoint
+//
+// A checkpoint moves the journal segments it supersedes into
+// journal_archive blocks. Entries keep their exact segment encoding
+// (48-byte header, forward payload, per-entry checksum), so archived
+// history audits the same way live history does; they are only packed
+// more densely:
+//
+//   * up to MAX_RAW bytes of entries are gathered per archive block,
+//     so the partly-filled segments of small commits merge together
+//   * the packed run is LZ4-compressed (FLAG_COMPRESSED on the block)
+//     when that is smaller, otherwise stored as-is
+//
+// The block header's `sequence` is the sequence of the first entry and
+// `prev_block_id` links to the previous (older) archive block; the
+// superblock records the newest one.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const blocks = @import("blocks.zig");
+const lz4 = @import("lz4.zig");
+
+const Block = blocks.Block;
+const BlockType = blocks.BlockType;
+const PAYLOAD_SIZE = blocks.PAYLOAD_SIZE;
+const JOURNAL_ENTRY_HEADER_SIZE = blocks.JOURNAL_ENTRY_HEADER_SIZE;
+
+/// Most entry bytes one archive block can hold once decompressed
+pub const MAX_RAW: usize = 64 * 1024;
+
+/// One archive block's worth of entries, valid until the next `emit`
+pub const Packed = struct {
+    payload: []const u8,
+    compressed: bool,
+    first_sequence: u64,
+    entry_count: usize,
+};
+
+/// Gathers entries in sequence order and cuts them into archive payloads
+pub const ArchivePacker = struct {
+    allocator: std.mem.Allocator,
+    raw: std.ArrayList(u8) = .{},
+    // End offset in `raw` of each pending entry
+    ends: std.ArrayList(usize) = .{},
+    encoded: std.ArrayList(u8) = .{},
+
+    pub fn init(allocator: std.mem.Allocator) ArchivePacker {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(self: *ArchivePacker) void {
+        self.raw.deinit(self.allocator);
+        self.ends.deinit(self.allocator);
+        self.encoded.deinit(self.allocator);
+    }
+
+    /// Whether pending entries must be emitted before `entry_len` more
+    /// bytes can be added
+    pub fn full(self: *const ArchivePacker, entry_len: usize) bool {
+        return self.ends.items.len > 0 and self.raw.items.len + entry_len > MAX_RAW;
+    }
+
+    pub fn isEmpty(self: *const ArchivePacker) bool {
+        return self.ends.items.len == 0;
+    }
+
+    /// Queue one encoded entry (header and forward payload)
+    pub fn append(self: *ArchivePacker, entry: []const u8) !void {
+        std.debug.assert(entry.len >= JOURNAL_ENTRY_HEADER_SIZE and entry.len <= PAYLOAD_SIZE);
+        try self.raw.appendSlice(self.allocator, entry);
+        try self.ends.append(self.allocator, self.raw.items.len);
+    }
+
+    /// Encode the longest run of pending entries that fits one block and
+    /// drop it from the queue. Must not be called when empty.
+    pub fn emit(self: *ArchivePacker) !Packed {
+        const pending = self.ends.items.len;
+        std.debug.assert(pending > 0);
+
+        // Compressed size grows with the run, so search for the longest
+        // prefix that fits; a single entry always fits uncompressed
+        var count = pending;
+        if (!try self.encode(count)) {
+            var lo: usize = 1;
+            var hi: usize = pending - 1;
+            while (lo < hi) {
+                const mid = lo + (hi - lo + 1) / 2;
+                if (try self.encode(mid)) lo = mid else hi = mid - 1;
+            }
+            count = lo;
+            std.debug.assert(try self.encode(count));
+        }
+
+        const raw_len = self.ends.items[count - 1];
+        const result = Packed{
+            .payload = self.encoded.items,
+            .compressed = self.encoded.items.len < raw_len,
+            .first_sequence = std.mem.readInt(u64, self.raw.items[0..8], .little),
+            .entry_count = count,
+        };
+
+        // Shift the remainder to the front of the queue
+        const rest = self.raw.items.len - raw_len;
+        std.mem.copyForwards(u8, self.raw.items[0..rest], self.raw.items[raw_len..]);
+        self.raw.shrinkRetainingCapacity(rest);
+        for (self.ends.items[count..], 0..) |end, i| self.ends.items[i] = end - raw_len;
+        self.ends.shrinkRetainingCapacity(pending - count);
+        return result;
+    }
+
+    /// Encode the first `count` entries into `encoded`; false if they do
+    /// not fit one block either way
+    fn encode(self: *ArchivePacker, count: usize) !bool {
+        const raw = self.raw.items[0..self.ends.items[count - 1]];
+        try self.encoded.resize(self.allocator, lz4.compressBound(raw.len));
+        const len = lz4.compress(raw, self.encoded.items);
+        if (len < raw.len and len <= PAYLOAD_SIZE) {
+            self.encoded.shrinkRetainingCapacity(len);
+            return true;
+        }
+        if (raw.len > PAYLOAD_SIZE) return false;
+        try self.encoded.resize(self.allocator, raw.len);
+        @memcpy(self.encoded.items, raw);
+        return true;
+    }
+};
+
+/// The packed entries of an archive block, decompressed into `buf` if
+/// needed. Walk them with JournalSegmentIterator.fromPayload.
+pub fn unpack(block: *const Block, buf: *[MAX_RAW]u8) ![]const u8 {
+    if (block.header.block_type != @intFromEnum(BlockType.journal_archive)) {
+        return error.NotJournalArchive;
+    }
+    const payload = block.getPayload();
+    if (block.header.flags & blocks.FLAG_COMPRESSED == 0) return payload;
+    const len = lz4.decompress(payload, buf) catch return error.InvalidJournalArchive;
+    return buf[0..len];
+}
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "small entries share compressed archive blocks" {
+    const allocator = std.testing.allocator;
+    var packer = ArchivePacker.init(allocator);
+    defer packer.deinit();
+
+    var writer = blocks.JournalSegmentWriter{};
+    var seq: u64 = 1;
+    var buf: [64]u8 = undefined;
+    while (seq <= 400) : (seq += 1) {
+        writer.reset();
+        const forward = try std.fmt.bufPrint(&buf, "INSERT block_id={d} size=42", .{seq});
+        try writer.append(seq, .{ .op = .doc_insert, .affected_block = seq, .forward = forward });
+        const entry = writer.payload();
+        try std.testing.expect(!packer.full(entry.len));
+        try packer.append(entry);
+    }
+
+    var archived: std.ArrayList(Block) = .{};
+    defer archived.deinit(allocator);
+    while (!packer.isEmpty()) {
+        const out = try packer.emit();
+        var block = Block.init(.journal_archive, archived.items.len + 1, out.first_sequence);
+        if (out.compressed) block.header.flags |= blocks.FLAG_COMPRESSED;
+        try block.setPayload(out.payload);
+        try archived.append(allocator, block);
+    }
+
+    // 400 one-entry segments would take 400 blocks
+    try std.testing.expect(archived.items.len < 20);
+
+    var expected: u64 = 1;
+    var raw: [MAX_RAW]u8 = undefined;
+    for (archived.items) |*block| {
+        try std.testing.expectEqual(expected, block.header.sequence);
+        var iter = blocks.JournalSegmentIterator.fromPayload(try unpack(block, &raw));
+        while (try iter.next()) |entry| : (expected += 1) {
+            try std.testing.expectEqual(expected, entry.header.sequence);
+        }
+    }
+    try std.testing.expectEqual(@as(u64, 401), expected);
+}
+
+test "incompressible entries are stored as-is" {
+    const allocator = std.testing.allocator;
+    var packer = ArchivePacker.init(allocator);
+    defer packer.deinit();
+
+    var noise: [3000]u8 = undefined;
+    var prng = std.Random.DefaultPrng.init(0x4C474801);
+    var writer = blocks.JournalSegmentWriter{};
+    for (1..4) |seq| {
+        prng.random().bytes(&noise);
+        writer.reset();
+        try writer.append(seq, .{ .op = .unspecified, .affected_block = 0, .forward = &noise });
+        try packer.append(writer.payload());
+    }
+
+    // Each entry needs most of a block, so they come out one per block
+    for (1..4) |seq| {
+        const out = try packer.emit();
+        try std.testing.expectEqual(@as(u64, seq), out.first_sequence);
+        try std.testing.expectEqual(@as(usize, 1), out.entry_count);
+        try std.testing.expect(!out.compressed);
+    }
+    try std.testing.expect(packer.isEmpty());
+}
@@ -0,0 +1,291 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Journal Reader - Seek and Stream Journal Entries
+//
+// The journal is linked newest-to-oldest, so finding sequence N by
+// following prev_block_id costs a block read per segment walked. The
+// JournalIndex instead keeps one (first_sequence, block_id) pair per
+// block that holds entries:
+//
+//   archive   journal_archive blocks, oldest first (loaded on first use)
+//   live      segments from journal_base to journal_tail, oldest first
+//
+// Both are sorted, so a lookup is a binary search and a JournalReader
+// starting at any sequence reads only the blocks it returns entries
+// from. The live list is filled during recovery and by the commit leader;
+// checkpoints move its superseded prefix to the archive list.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const blocks = @import("blocks.zig");
+const cbor = @import("cbor.zig");
+const cursors = @import("cursor.zig");
+const journal_archive = @import("journal_archive.zig");
+
+const Block = blocks.Block;
+const BlockStorage = blocks.BlockStorage;
+const BlockType = blocks.BlockType;
+const JournalEntry = blocks.JournalEntry;
+const JournalOp = blocks.JournalOp;
+const JournalSegmentIterator = blocks.JournalSegmentIterator;
+
+/// A block holding entries from `first_sequence` onwards
+pub const Location = struct {
+    first_sequence: u64,
+    block_id: u64,
+};
+
+pub const JournalIndex = struct {
+    allocator: std.mem.Allocator,
+    // Guards every field; lock before alloc_mutex when holding both
+    mutex: std.Thread.Mutex = .{},
+    archive: std.ArrayList(Location) = .{},
+    archive_loaded: bool = false,
+    live: std.ArrayList(Location) = .{},
+
+    pub fn init(allocator: std.mem.Allocator) JournalIndex {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(self: *JournalIndex) void {
+        self.archive.deinit(self.allocator);
+        self.live.deinit(self.allocator);
+    }
+
+    /// The block holding `sequence`: the last one starting at or before it
+    pub fn findLocked(self: *const JournalIndex, sequence: u64) ?Location {
+        if (self.live.items.len > 0 and self.live.items[0].first_sequence <= sequence) {
+            return floor(self.live.items, sequence);
+        }
+        return floor(self.archive.items, sequence);
+    }
+
+    /// Whether `sequence` may be archived and the archive is not loaded yet
+    pub fn needsArchiveLocked(self: *const JournalIndex, sequence: u64) bool {
+        if (self.archive_loaded) return false;
+        return self.live.items.len == 0 or sequence < self.live.items[0].first_sequence;
+    }
+
+    /// Make room for `count` segments ahead of a commit, so recording
+    /// them once durable cannot fail
+    pub fn reserveLive(self: *JournalIndex, count: usize) !void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        try self.live.ensureUnusedCapacity(self.allocator, count);
+    }
+
+    /// Record durable segments (capacity reserved with reserveLive)
+    pub fn appendLive(self: *JournalIndex, segments: []const Location) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        self.live.appendSliceAssumeCapacity(segments);
+    }
+
+    /// A checkpoint archived every live segment before `base_sequence`
+    /// into `archived`. If the archive list cannot grow it is dropped and
+    /// reloaded on next use.
+    pub fn compactedLocked(self: *JournalIndex, base_sequence: u64, archived: []const Location) void {
+        var keep: usize = 0;
+        while (keep < self.live.items.len and self.live.items[keep].first_sequence < base_sequence) keep += 1;
+        const rest = self.live.items.len - keep;
+        std.mem.copyForwards(Location, self.live.items[0..rest], self.live.items[keep..]);
+        self.live.shrinkRetainingCapacity(rest);
+
+        if (!self.archive_loaded) return;
+        self.archive.appendSlice(self.allocator, archived) catch {
+            self.archive.clearRetainingCapacity();
+            self.archive_loaded = false;
+        };
+    }
+
+    fn floor(items: []const Location, sequence: u64) ?Location {
+        var lo: usize = 0;
+        var hi: usize = items.len;
+        while (lo < hi) {
+            const mid = lo + (hi - lo) / 2;
+            if (items[mid].first_sequence <= sequence) lo = mid + 1 else hi = mid;
+        }
+        return if (lo == 0) null else items[lo - 1];
+    }
+};
+
+/// Streams entries in sequence order from a starting sequence up to the
+/// journal head as of `open`. Entries borrow from the reader and are
+/// valid until the next call to `next`.
+pub const JournalReader = struct {
+    allocator: std.mem.Allocator,
+    storage: *BlockStorage,
+    next_sequence: u64,
+    head: u64,
+
+    block: Block = undefined,
+    raw: *[journal_archive.MAX_RAW]u8,
+    iter: ?JournalSegmentIterator = null,
+
+    pub fn open(allocator: std.mem.Allocator, storage: *BlockStorage, start_sequence: u64) !JournalReader {
+        return .{
+            .allocator = allocator,
+            .storage = storage,
+            .next_sequence = @max(start_sequence, 1),
+            .head = storage.journalHead(),
+            .raw = try allocator.create([journal_archive.MAX_RAW]u8),
+        };
+    }
+
+    pub fn close(self: *JournalReader) void {
+        self.allocator.destroy(self.raw);
+    }
+
+    /// The next entry, or null once the head is reached
+    pub fn next(self: *JournalReader) !?JournalEntry {
+        while (self.next_sequence <= self.head) {
+            if (self.iter) |*iter| {
+                while (try iter.next()) |entry| {
+                    if (entry.header.sequence < self.next_sequence) continue;
+                    if (entry.header.sequence != self.next_sequence) return error.InvalidJournal;
+                    self.next_sequence += 1;
+                    return entry;
+                }
+                self.iter = null;
+            }
+            if (!try self.seek(self.next_sequence)) return null;
+        }
+        return null;
+    }
+
+    /// Load the block holding `sequence`. A checkpoint may free a live
+    /// segment between the lookup and the read, in which case the retry
+    /// finds it in the archive.
+    fn seek(self: *JournalReader, sequence: u64) !bool {
+        var attempts: usize = 0;
+        while (attempts < 2) : (attempts += 1) {
+            const location = try self.storage.locateJournal(sequence) orelse return false;
+            self.block = try self.storage.readBlock(location.block_id);
+            if (self.block.header.sequence != location.first_sequence) continue;
+
+            const payload = switch (self.block.header.block_type) {
+                @intFromEnum(BlockType.journal_segment) => self.block.getPayload(),
+                @intFromEnum(BlockType.journal_archive) => try journal_archive.unpack(&self.block, self.raw),
+                else => continue,
+            };
+            self.iter = JournalSegmentIterator.fromPayload(payload);
+            return true;
+        }
+        return error.InvalidJournal;
+    }
+};
+
+/// Canonical operation name (spec/journal.adoc)
+pub fn opName(op_type: u16) []const u8 {
+    return switch (@as(JournalOp, @enumFromInt(op_type))) {
+        .unspecified => "UNSPECIFIED",
+        .doc_insert => "DOC_INSERT",
+        .doc_update => "DOC_UPDATE",
+        .doc_delete => "DOC_DELETE",
+        .bulk_insert => "BULK_INSERT",
+        .index_create => "INDEX_CREATE",
+        .checkpoint => "CHECKPOINT",
+        .replica_mark => "REPLICA_MARK",
+        _ => "UNKNOWN",
+    };
+}
+
+/// Append one entry as a JSON object:
+/// {"seq":N,"timestamp":N,"op":"DOC_INSERT","affected_block":N,"forward":"<escaped>"}
+pub fn appendEntryJson(allocator: std.mem.Allocator, out: *std.ArrayList(u8), entry: JournalEntry) !void {
+    try out.print(allocator,
+        \\{{"seq":{d},"timestamp":{d},"op":"{s}","affected_block":{d},"forward":"
+    , .{ entry.header.sequence, entry.header.timestamp, opName(entry.header.op_type), entry.header.affected_block });
+    try cursors.appendJsonEscaped(allocator, out, entry.forward);
+    try out.appendSlice(allocator, "\"}");
+}
+
+/// Append one entry as a CBOR map with the forward payload as bytes
+pub fn appendEntryCbor(encoder: *cbor.Encoder, entry: JournalEntry) !void {
+    try encoder.beginMap(5);
+    try encoder.encodeText("seq");
+    try encoder.encodeUint(entry.header.sequence);
+    try encoder.encodeText("timestamp");
+    try encoder.encodeUint(entry.header.timestamp);
+    try encoder.encodeText("op");
+    try encoder.encodeText(opName(entry.header.op_type));
+    try encoder.encodeText("affected_block");
+    try encoder.encodeUint(entry.header.affected_block);
+    try encoder.encodeText("forward");
+    try encoder.encodeBytes(entry.forward);
+}
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "index lookups land on the block holding a sequence" {
+    var index = JournalIndex.init(std.testing.allocator);
+    defer index.deinit();
+
+    index.archive_loaded = true;
+    try index.archive.appendSlice(std.testing.allocator, &.{
+        .{ .first_sequence = 1, .block_id = 40 },
+        .{ .first_sequence = 30, .block_id = 41 },
+    });
+    try index.reserveLive(3);
+    index.appendLive(&.{
+        .{ .first_sequence = 60, .block_id = 7 },
+        .{ .first_sequence = 61, .block_id = 9 },
+        .{ .first_sequence = 65, .block_id = 8 },
+    });
+
+    try std.testing.expect(index.findLocked(0) == null);
+    try std.testing.expectEqual(@as(u64, 40), index.findLocked(29).?.block_id);
+    try std.testing.expectEqual(@as(u64, 41), index.findLocked(59).?.block_id);
+    try std.testing.expectEqual(@as(u64, 7), index.findLocked(60).?.block_id);
+    try std.testing.expectEqual(@as(u64, 8), index.findLocked(1000).?.block_id);
+
+    // A checkpoint at 65 archives the first two live segments
+    index.compactedLocked(65, &.{.{ .first_sequence = 60, .block_id = 42 }});
+    try std.testing.expectEqual(@as(usize, 1), index.live.items.len);
+    try std.testing.expectEqual(@as(u64, 42), index.findLocked(62).?.block_id);
+    try std.testing.expect(!index.needsArchiveLocked(2));
+}
+
+test "reader seeks into live and archived history" {
+    const allocator = std.testing.allocator;
+    const path = "test_journal_reader.lgh";
+    std.fs.cwd().deleteFile(path) catch {};
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    {
+        const storage = try BlockStorage.openWithOptions(allocator, path, .{ .checkpoint_segments = 0 });
+        defer storage.deinit();
+
+        var buf: [32]u8 = undefined;
+        for (1..41) |i| _ = try storage.appendJournal(try std.fmt.bufPrint(&buf, "entry {d}", .{i}));
+        try storage.checkpoint();
+        for (42..51) |i| _ = try storage.appendJournal(try std.fmt.bufPrint(&buf, "entry {d}", .{i}));
+    }
+
+    // Reopened, so the archive is indexed lazily by the first old read
+    const storage = try BlockStorage.open(allocator, path);
+    defer storage.deinit();
+
+    for ([_]u64{ 0, 17, 41, 48 }) |start| {
+        var reader = try JournalReader.open(allocator, storage, start);
+        defer reader.close();
+
+        var expected = @max(start, 1);
+        while (try reader.next()) |entry| : (expected += 1) {
+            try std.testing.expectEqual(expected, entry.header.sequence);
+            if (expected == 41) {
+                try std.testing.expectEqualStrings("CHECKPOINT", opName(entry.header.op_type));
+            } else {
+                var buf: [32]u8 = undefined;
+                try std.testing.expectEqualStrings(try std.fmt.bufPrint(&buf, "entry {d}", .{expected}), entry.forward);
+            }
+        }
+        try std.testing.expectEqual(@as(u64, 51), expected);
+    }
+
+    var past_head = try JournalReader.open(allocator, storage, 51);
+    defer past_head.close();
+    try std.testing.expect((try past_head.next()) == null);
+}
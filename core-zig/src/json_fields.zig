@@ -0,0 +1,393 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph JSON Fields - Member Lookup in Raw Documents
+//
+// Query predicates only look at a few members of each document, so the
+// executor does not build a std.json tree per block. `findMember` walks
+// the raw text of an object, skipping the values it is not looking for
+// (nested objects, arrays and strings included), and returns the raw
+// bytes of the one it is. Nothing is allocated: a document that fails a
+// predicate is rejected after one pass over its bytes.
+//
+// Strings are returned still escaped; `unescape` decodes one only when
+// it contains a backslash.
+//
+// Skipping is vectorized in the simdjson style: each chunk of
+// VECTOR_LEN bytes is compared against the structural characters at
+// once and only the set bits of the resulting masks are visited, so a
+// long string or nested array costs a few vector compares per chunk
+// rather than a branch per byte. `indexOfString` uses the same chunks
+// to test whether a key or value can occur in a document at all.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+
+pub const Kind = enum { string, number, boolean, null, object, array };
+
+/// Kind of a raw value as returned by `findMember`
+pub fn kindOf(raw: []const u8) ?Kind {
+    if (raw.len == 0) return null;
+    return switch (raw[0]) {
+        '"' => .string,
+        '{' => .object,
+        '[' => .array,
+        't', 'f' => .boolean,
+        'n' => .null,
+        '-', '0'...'9' => .number,
+        else => null,
+    };
+}
+
+/// Bytes compared per vector step
+pub const VECTOR_LEN = std.simd.suggestVectorLength(u8) orelse 16;
+
+const Chunk = @Vector(VECTOR_LEN, u8);
+const Mask = std.meta.Int(.unsigned, VECTOR_LEN);
+
+inline fn loadChunk(text: []const u8, at: usize) Chunk {
+    return text[at..][0..VECTOR_LEN].*;
+}
+
+/// Bit i set where byte i of `chunk` equals `byte`
+inline fn maskOf(chunk: Chunk, byte: u8) Mask {
+    return @bitCast(chunk == @as(Chunk, @splat(byte)));
+}
+
+fn isSpace(c: u8) bool {
+    return c == ' ' or c == '\t' or c == '\n' or c == '\r';
+}
+
+pub fn skipSpace(text: []const u8, start: usize) usize {
+    var i = start;
+    while (i < text.len and isSpace(text[i])) i += 1;
+    return i;
+}
+
+/// Index just past the string whose opening quote is at `start`
+fn skipString(text: []const u8, start: usize) !usize {
+    var i = start + 1;
+    while (i + VECTOR_LEN <= text.len) {
+        const chunk = loadChunk(text, i);
+        const hits = maskOf(chunk, '"') | maskOf(chunk, '\\');
+        if (hits == 0) {
+            i += VECTOR_LEN;
+            continue;
+        }
+        const at = i + @ctz(hits);
+        if (text[at] == '"') return at + 1;
+        // Step over the escaped byte
+        i = at + 2;
+    }
+    while (i < text.len) : (i += 1) {
+        switch (text[i]) {
+            '"' => return i + 1,
+            '\\' => i += 1,
+            else => {},
+        }
+    }
+    return error.InvalidJson;
+}
+
+/// Index just past the value starting at `start`
+pub fn skipValue(text: []const u8, start: usize) !usize {
+    if (start >= text.len) return error.InvalidJson;
+    switch (text[start]) {
+        '"' => return skipString(text, start),
+        '{', '[' => return skipContainer(text, start),
+        else => {
+            // Number or literal: runs to the next delimiter
+            var i = start;
+            while (i < text.len) : (i += 1) {
+                switch (text[i]) {
+                    ',', '}', ']', ' ', '\t', '\n', '\r' => break,
+                    else => {},
+                }
+            }
+            if (i == start) return error.InvalidJson;
+            return i;
+        },
+    }
+}
+
+/// Index just past the object or array opening at `start`
+fn skipContainer(text: []const u8, start: usize) !usize {
+    var depth: usize = 0;
+    var i = start;
+    while (i + VECTOR_LEN <= text.len) {
+        const chunk = loadChunk(text, i);
+        var structural = maskOf(chunk, '"') | maskOf(chunk, '{') | maskOf(chunk, '[') |
+            maskOf(chunk, '}') | maskOf(chunk, ']');
+        var next = i + VECTOR_LEN;
+        while (structural != 0) : (structural &= structural - 1) {
+            const at = i + @ctz(structural);
+            switch (text[at]) {
+                '"' => {
+                    // Resume after the string, which may end in a later chunk
+                    next = try skipString(text, at);
+                    break;
+                },
+                '{', '[' => depth += 1,
+                else => {
+                    depth -= 1;
+                    if (depth == 0) return at + 1;
+                },
+            }
+        }
+        i = next;
+    }
+
+    while (i < text.len) {
+        switch (text[i]) {
+            '"' => {
+                i = try skipString(text, i);
+                continue;
+            },
+            '{', '[' => depth += 1,
+            '}', ']' => {
+                depth -= 1;
+                if (depth == 0) return i + 1;
+            },
+            else => {},
+        }
+        i += 1;
+    }
+    return error.InvalidJson;
+}
+
+/// First index at or after `from` where `needle` occurs in `haystack`.
+/// Candidates are positions whose first and last bytes both match,
+/// found a chunk at a time; only those are compared in full.
+pub fn indexOfString(haystack: []const u8, needle: []const u8, from: usize) ?usize {
+    if (needle.len == 0) return if (from <= haystack.len) from else null;
+    if (needle.len > haystack.len) return null;
+
+    const last = needle.len - 1;
+    var i = from;
+    while (i + last + VECTOR_LEN <= haystack.len) : (i += VECTOR_LEN) {
+        var candidates = maskOf(loadChunk(haystack, i), needle[0]) & maskOf(loadChunk(haystack, i + last), needle[last]);
+        while (candidates != 0) : (candidates &= candidates - 1) {
+            const at = i + @ctz(candidates);
+            if (std.mem.eql(u8, haystack[at + 1 ..][0..last], needle[1..])) return at;
+        }
+    }
+    return std.mem.indexOfPos(u8, haystack, i, needle);
+}
+
+/// Iterates the members of a raw object
+pub const MemberIterator = struct {
+    text: []const u8,
+    pos: usize,
+
+    pub const Member = struct {
+        /// Key as written between the quotes (still escaped)
+        key: []const u8,
+        value: []const u8,
+    };
+
+    pub fn init(object: []const u8) !MemberIterator {
+        const open = skipSpace(object, 0);
+        if (open >= object.len or object[open] != '{') return error.InvalidJson;
+        return .{ .text = object, .pos = open + 1 };
+    }
+
+    pub fn next(self: *MemberIterator) !?Member {
+        const text = self.text;
+        var i = skipSpace(text, self.pos);
+        if (i >= text.len) return error.InvalidJson;
+        if (text[i] == '}') {
+            self.pos = text.len;
+            return null;
+        }
+        if (text[i] == ',') i = skipSpace(text, i + 1);
+        if (i >= text.len or text[i] != '"') return error.InvalidJson;
+
+        const key_end = try skipString(text, i);
+        const key = text[i + 1 .. key_end - 1];
+
+        i = skipSpace(text, key_end);
+        if (i >= text.len or text[i] != ':') return error.InvalidJson;
+        i = skipSpace(text, i + 1);
+
+        const value_end = try skipValue(text, i);
+        self.pos = value_end;
+        return .{ .key = key, .value = text[i..value_end] };
+    }
+};
+
+/// Iterates the elements of a raw array
+pub const ElementIterator = struct {
+    text: []const u8,
+    pos: usize,
+
+    pub fn init(array: []const u8) !ElementIterator {
+        const open = skipSpace(array, 0);
+        if (open >= array.len or array[open] != '[') return error.InvalidJson;
+        return .{ .text = array, .pos = open + 1 };
+    }
+
+    pub fn next(self: *ElementIterator) !?[]const u8 {
+        const text = self.text;
+        var i = skipSpace(text, self.pos);
+        if (i >= text.len) return error.InvalidJson;
+        if (text[i] == ']') {
+            self.pos = text.len;
+            return null;
+        }
+        if (text[i] == ',') i = skipSpace(text, i + 1);
+
+        const end = try skipValue(text, i);
+        self.pos = end;
+        return text[i..end];
+    }
+};
+
+/// Raw value of the member `key` of a raw object, or null if absent
+pub fn findMember(object: []const u8, key: []const u8) !?[]const u8 {
+    var members = try MemberIterator.init(object);
+    while (try members.next()) |member| {
+        if (keyEquals(member.key, key)) return member.value;
+    }
+    return null;
+}
+
+/// Follow a dotted path ("source.name") through nested objects
+pub fn findPath(object: []const u8, path: []const u8) !?[]const u8 {
+    var current = object;
+    var segments = std.mem.splitScalar(u8, path, '.');
+    while (segments.next()) |segment| {
+        if (kindOf(current[skipSpace(current, 0)..]) != .object) return null;
+        current = (try findMember(current, segment)) orelse return null;
+    }
+    return current;
+}
+
+fn keyEquals(raw_key: []const u8, key: []const u8) bool {
+    if (std.mem.indexOfScalar(u8, raw_key, '\\') == null) return std.mem.eql(u8, raw_key, key);
+    var buf: [256]u8 = undefined;
+    var fixed = std.heap.FixedBufferAllocator.init(&buf);
+    var out: std.ArrayList(u8) = .{};
+    const decoded = unescape(fixed.allocator(), raw_key, &out) catch return false;
+    return std.mem.eql(u8, decoded, key);
+}
+
+/// Contents of a raw string value (between the quotes), decoded into
+/// `out` only if it has escapes
+pub fn stringContents(allocator: std.mem.Allocator, raw: []const u8, out: *std.ArrayList(u8)) ![]const u8 {
+    if (raw.len < 2 or raw[0] != '"') return error.InvalidJson;
+    return unescape(allocator, raw[1 .. raw.len - 1], out);
+}
+
+/// Decode JSON escapes in `escaped`; returns it unchanged when it has none
+pub fn unescape(allocator: std.mem.Allocator, escaped: []const u8, out: *std.ArrayList(u8)) ![]const u8 {
+    if (std.mem.indexOfScalar(u8, escaped, '\\') == null) return escaped;
+
+    out.clearRetainingCapacity();
+    var i: usize = 0;
+    while (i < escaped.len) : (i += 1) {
+        const c = escaped[i];
+        if (c != '\\') {
+            try out.append(allocator, c);
+            continue;
+        }
+        i += 1;
+        if (i >= escaped.len) return error.InvalidJson;
+        switch (escaped[i]) {
+            '"', '\\', '/' => |e| try out.append(allocator, e),
+            'b' => try out.append(allocator, 0x08),
+            'f' => try out.append(allocator, 0x0C),
+            'n' => try out.append(allocator, '\n'),
+            'r' => try out.append(allocator, '\r'),
+            't' => try out.append(allocator, '\t'),
+            'u' => {
+                if (i + 5 > escaped.len) return error.InvalidJson;
+                var code: u21 = std.fmt.parseInt(u16, escaped[i + 1 ..][0..4], 16) catch return error.InvalidJson;
+                i += 4;
+                // Surrogate pair
+                if (code >= 0xD800 and code < 0xDC00 and i + 7 <= escaped.len and escaped[i + 1] == '\\' and escaped[i + 2] == 'u') {
+                    const low = std.fmt.parseInt(u16, escaped[i + 3 ..][0..4], 16) catch return error.InvalidJson;
+                    if (low >= 0xDC00 and low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    }
+                }
+                var utf8: [4]u8 = undefined;
+                const n = std.unicode.utf8Encode(code, &utf8) catch return error.InvalidJson;
+                try out.appendSlice(allocator, utf8[0..n]);
+            },
+            else => return error.InvalidJson,
+        }
+    }
+    return out.items;
+}
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "members are found without parsing the rest" {
+    const doc =
+        \\{ "collection": "evidence", "nested": {"score": [1, {"x": "}"}]},
+        \\  "quote": "say \"hi\"", "score": 95, "ok": true, "none": null }
+    ;
+    try std.testing.expectEqualStrings("\"evidence\"", (try findMember(doc, "collection")).?);
+    try std.testing.expectEqualStrings("95", (try findMember(doc, "score")).?);
+    try std.testing.expectEqualStrings("true", (try findMember(doc, "ok")).?);
+    try std.testing.expectEqual(Kind.null, kindOf((try findMember(doc, "none")).?).?);
+    try std.testing.expect((try findMember(doc, "missing")) == null);
+
+    try std.testing.expectEqualStrings("[1, {\"x\": \"}\"}]", (try findPath(doc, "nested.score")).?);
+    try std.testing.expect((try findPath(doc, "score.deeper")) == null);
+
+    var out: std.ArrayList(u8) = .{};
+    defer out.deinit(std.testing.allocator);
+    const quote = try stringContents(std.testing.allocator, (try findMember(doc, "quote")).?, &out);
+    try std.testing.expectEqualStrings("say \"hi\"", quote);
+}
+
+test "unescape decodes unicode escapes and surrogate pairs" {
+    var out: std.ArrayList(u8) = .{};
+    defer out.deinit(std.testing.allocator);
+    try std.testing.expectEqualStrings("plain", try unescape(std.testing.allocator, "plain", &out));
+    try std.testing.expectEqualStrings("caf\xc3\xa9 \xf0\x9f\x98\x80", try unescape(std.testing.allocator, "caf\\u00e9 \\ud83d\\ude00", &out));
+    try std.testing.expectError(error.InvalidJson, unescape(std.testing.allocator, "bad\\u12", &out));
+}
+
+test "malformed documents are reported" {
+    try std.testing.expectError(error.InvalidJson, findMember("[1, 2]", "a"));
+    try std.testing.expectError(error.InvalidJson, findMember("{\"a\": \"open", "b"));
+    try std.testing.expectError(error.InvalidJson, findMember("{\"a\" 1}", "a"));
+}
+
+test "vector skipping agrees across chunk boundaries" {
+    // Values long enough to span several chunks, with escapes and nested
+    // structure landing at every offset within a chunk
+    var doc: std.ArrayList(u8) = .{};
+    defer doc.deinit(std.testing.allocator);
+    const allocator = std.testing.allocator;
+    try doc.appendSlice(allocator, "{\"pad\":\"");
+    for (0..3 * VECTOR_LEN) |i| try doc.appendSlice(allocator, if (i % 7 == 0) "\\\"" else "x");
+    try doc.appendSlice(allocator, "\",\"deep\":[");
+    for (0..2 * VECTOR_LEN) |_| try doc.appendSlice(allocator, "{\"a\":[\"]}\"],\"b\":{}},");
+    try doc.appendSlice(allocator, "null],\"score\":95}");
+
+    for (0..VECTOR_LEN) |shift| {
+        var shifted: std.ArrayList(u8) = .{};
+        defer shifted.deinit(allocator);
+        try shifted.appendNTimes(allocator, ' ', shift);
+        try shifted.appendSlice(allocator, doc.items);
+        try std.testing.expectEqualStrings("95", (try findMember(shifted.items, "score")).?);
+    }
+}
+
+test "substring search finds needles at any offset" {
+    var text: [4 * VECTOR_LEN]u8 = undefined;
+    @memset(&text, 'a');
+    try std.testing.expectEqual(@as(?usize, null), indexOfString(&text, "ab", 0));
+    for (0..text.len - 2) |at| {
+        @memset(&text, 'a');
+        @memcpy(text[at..][0..3], "\"b\"");
+        try std.testing.expectEqual(@as(?usize, at), indexOfString(&text, "\"b\"", 0));
+        try std.testing.expectEqual(@as(?usize, null), indexOfString(&text, "\"b\"", at + 1));
+    }
+    try std.testing.expectEqual(@as(?usize, 3), indexOfString("abcabc", "", 3));
+}
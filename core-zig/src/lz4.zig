@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph LZ4 - Block-Format Payload Compression
+//
+// Documents are compressed on the commit path and decompressed on every
+// read, so this favours speed over ratio: a single-probe hash table of
+// 4-byte sequences (LZ4 "fast" level 1) and a bounds-checked decoder.
+// Output is the standard LZ4 block format (no frame header), so payloads
+// can be inspected with any LZ4 implementation:
+//
+//   token       literal length (high nibble), match length - 4 (low nibble)
+//   [length]    255-byte continuation for either nibble when it is 15
+//   literals
+//   offset      u16 little-endian distance back into the output
+//
+// The final sequence carries literals only; the last 5 bytes of the input
+// are always literals and no match starts in the last 12.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+
+const MIN_MATCH: usize = 4;
+const LAST_LITERALS: usize = 5;
+const MF_LIMIT: usize = 12;
+const MAX_OFFSET: usize = 65535;
+const HASH_LOG = 12;
+
+pub const Error = error{CorruptInput};
+
+/// Largest compressed size for `len` input bytes
+pub fn compressBound(len: usize) usize {
+    return len + len / 255 + 16;
+}
+
+/// Compress `src` into `dst`, which must hold at least
+/// `compressBound(src.len)` bytes. Returns the compressed length.
+pub fn compress(src: []const u8, dst: []u8) usize {
+    std.debug.assert(dst.len >= compressBound(src.len));
+
+    var table: [1 << HASH_LOG]u32 = @splat(0);
+    var out: usize = 0;
+    var anchor: usize = 0;
+
+    if (src.len > MF_LIMIT) {
+        const match_limit = src.len - MF_LIMIT;
+        const extend_limit = src.len - LAST_LITERALS;
+
+        var pos: usize = 0;
+        while (pos < match_limit) {
+            const sequence = read32(src, pos);
+            const slot = hash(sequence);
+            const candidate: usize = table[slot];
+            table[slot] = @intCast(pos);
+
+            if (candidate < pos and pos - candidate <= MAX_OFFSET and read32(src, candidate) == sequence) {
+                var len = MIN_MATCH;
+                while (pos + len < extend_limit and src[candidate + len] == src[pos + len]) len += 1;
+
+                out = writeSequence(dst, out, src[anchor..pos], pos - candidate, len);
+                pos += len;
+                anchor = pos;
+                continue;
+            }
+            pos += 1;
+        }
+    }
+
+    // Trailing literals
+    const literals = src[anchor..];
+    const token_pos = out;
+    out += 1;
+    dst[token_pos] = @as(u8, @intCast(@min(literals.len, 15))) << 4;
+    if (literals.len >= 15) out = writeLength(dst, out, literals.len - 15);
+    @memcpy(dst[out..][0..literals.len], literals);
+    return out + literals.len;
+}
+
+/// Decompress `src` into `dst`. Returns the decompressed length; fails on
+/// malformed input or output that would not fit in `dst`.
+pub fn decompress(src: []const u8, dst: []u8) Error!usize {
+    var in: usize = 0;
+    var out: usize = 0;
+
+    while (true) {
+        if (in >= src.len) return error.CorruptInput;
+        const token = src[in];
+        in += 1;
+
+        var literal_len: usize = token >> 4;
+        if (literal_len == 15) literal_len += try readLength(src, &in);
+        if (literal_len > src.len - in or literal_len > dst.len - out) return error.CorruptInput;
+        @memcpy(dst[out..][0..literal_len], src[in..][0..literal_len]);
+        in += literal_len;
+        out += literal_len;
+
+        // The last sequence ends after its literals
+        if (in == src.len) return out;
+
+        if (src.len - in < 2) return error.CorruptInput;
+        const offset: usize = std.mem.readInt(u16, src[in..][0..2], .little);
+        in += 2;
+        if (offset == 0 or offset > out) return error.CorruptInput;
+
+        var match_len: usize = (token & 15) + MIN_MATCH;
+        if (token & 15 == 15) match_len += try readLength(src, &in);
+        if (match_len > dst.len - out) return error.CorruptInput;
+
+        // Matches may overlap their own output (offset < length)
+        const from = out - offset;
+        if (offset >= match_len) {
+            @memcpy(dst[out..][0..match_len], dst[from..][0..match_len]);
+        } else {
+            for (0..match_len) |i| dst[out + i] = dst[from + i];
+        }
+        out += match_len;
+    }
+}
+
+fn read32(data: []const u8, pos: usize) u32 {
+    return std.mem.readInt(u32, data[pos..][0..4], .little);
+}
+
+fn hash(sequence: u32) usize {
+    return @intCast((sequence *% 2654435761) >> (32 - HASH_LOG));
+}
+
+fn writeLength(dst: []u8, pos: usize, len: usize) usize {
+    var out = pos;
+    var remaining = len;
+    while (remaining >= 255) : (remaining -= 255) {
+        dst[out] = 255;
+        out += 1;
+    }
+    dst[out] = @intCast(remaining);
+    return out + 1;
+}
+
+fn readLength(src: []const u8, pos: *usize) Error!usize {
+    var len: usize = 0;
+    while (true) {
+        if (pos.* >= src.len) return error.CorruptInput;
+        const byte = src[pos.*];
+        pos.* += 1;
+        len += byte;
+        if (byte != 255) return len;
+    }
+}
+
+fn writeSequence(dst: []u8, pos: usize, literals: []const u8, offset: usize, match_len: usize) usize {
+    var out = pos;
+    const token_pos = out;
+    out += 1;
+
+    var token: u8 = @as(u8, @intCast(@min(literals.len, 15))) << 4;
+    if (literals.len >= 15) out = writeLength(dst, out, literals.len - 15);
+    @memcpy(dst[out..][0..literals.len], literals);
+    out += literals.len;
+
+    std.mem.writeInt(u16, dst[out..][0..2], @intCast(offset), .little);
+    out += 2;
+
+    const extra = match_len - MIN_MATCH;
+    token |= @intCast(@min(extra, 15));
+    if (extra >= 15) out = writeLength(dst, out, extra - 15);
+
+    dst[token_pos] = token;
+    return out;
+}
+
+// ============================================================
+// Tests
+// ============================================================
+
+fn roundTrip(src: []const u8) !usize {
+    const allocator = std.testing.allocator;
+    const compressed = try allocator.alloc(u8, compressBound(src.len));
+    defer allocator.free(compressed);
+    const len = compress(src, compressed);
+
+    const restored = try allocator.alloc(u8, src.len);
+    defer allocator.free(restored);
+    try std.testing.expectEqual(src.len, try decompress(compressed[0..len], restored));
+    try std.testing.expectEqualSlices(u8, src, restored);
+    return len;
+}
+
+test "repetitive JSON compresses and round-trips" {
+    var buf: [8192]u8 = undefined;
+    var len: usize = 0;
+    var i: usize = 0;
+    while (len + 64 < buf.len) : (i += 1) {
+        const row = try std.fmt.bufPrint(buf[len..], "{{\"id\":{d},\"kind\":\"evidence\",\"tags\":[\"a\",\"b\"]}},", .{i});
+        len += row.len;
+    }
+    const compressed_len = try roundTrip(buf[0..len]);
+    try std.testing.expect(compressed_len * 3 < len);
+}
+
+test "short and incompressible inputs round-trip" {
+    _ = try roundTrip("");
+    _ = try roundTrip("abc");
+    _ = try roundTrip("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+
+    var noise: [5000]u8 = undefined;
+    var prng = std.Random.DefaultPrng.init(0x4C474800);
+    prng.random().bytes(&noise);
+    const compressed_len = try roundTrip(&noise);
+    try std.testing.expect(compressed_len <= compressBound(noise.len));
+}
+
+test "decodes the reference block format" {
+    // "a", then a 14-byte match at offset 1, then 5 literals
+    const stream = [_]u8{ 0x1A, 'a', 0x01, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a' };
+    var out: [20]u8 = undefined;
+    try std.testing.expectEqual(@as(usize, 20), try decompress(&stream, &out));
+    try std.testing.expectEqualSlices(u8, &([_]u8{'a'} ** 20), &out);
+}
+
+test "rejects corrupt input" {
+    var out: [64]u8 = undefined;
+    // Offset reaches before the start of the output
+    try std.testing.expectError(error.CorruptInput, decompress(&.{ 0x10, 'a', 0x05, 0x00 }, &out));
+    // Literal run longer than the input
+    try std.testing.expectError(error.CorruptInput, decompress(&.{ 0x40, 'a' }, &out));
+    // Output larger than the destination
+    try std.testing.expectError(error.CorruptInput, decompress(&.{ 0x1F, 'a', 0x01, 0x00, 0xFF, 0x00 }, out[0..8]));
+}
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Mapped File - Read-Only mmap View of a .lgh File
+//
+// Backs the `mmap` open option. Readers get slices straight out of the
+// page cache instead of pread + copy. Writes still go through pwrite;
+// MAP_SHARED keeps the mapping coherent with them.
+//
+// When the file grows past the mapped range a larger region is mapped
+// (at least doubling). Superseded regions are retired, not unmapped, so
+// views handed out earlier stay valid until the file is closed. Total
+// address space stays under twice the final file size.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const builtin = @import("builtin");
+
+const page_size = std.heap.page_size_min;
+
+/// Views alias on-disk bytes, so they are only usable when the on-disk
+/// little-endian layout is also the native one
+pub const supported = builtin.os.tag != .windows and
+    builtin.os.tag != .wasi and
+    builtin.cpu.arch.endian() == .little;
+
+const Region = struct {
+    bytes: []align(page_size) const u8,
+};
+
+pub const MappedFile = struct {
+    allocator: std.mem.Allocator,
+    file: std.fs.File,
+    current: std.atomic.Value(?*Region) = .init(null),
+    retired: std.ArrayList(*Region) = .{},
+    /// Bytes known to exist on disk; slices never reach past this
+    file_len: std.atomic.Value(u64),
+    sequential: bool = false,
+    mutex: std.Thread.Mutex = .{},
+
+    pub fn init(allocator: std.mem.Allocator, file: std.fs.File) !MappedFile {
+        if (!supported) return error.MmapUnsupported;
+        var mapped = MappedFile{
+            .allocator = allocator,
+            .file = file,
+            .file_len = .init(try file.getEndPos()),
+        };
+        const len = mapped.file_len.raw;
+        if (len > 0) {
+            mapped.mutex.lock();
+            defer mapped.mutex.unlock();
+            try mapped.growLocked(len);
+        }
+        return mapped;
+    }
+
+    pub fn deinit(self: *MappedFile) void {
+        if (!supported) return;
+        if (self.current.load(.acquire)) |region| self.release(region);
+        for (self.retired.items) |region| self.release(region);
+        self.retired.deinit(self.allocator);
+    }
+
+    /// Record that bytes up to `len` now exist (call after pwrite)
+    pub fn extendTo(self: *MappedFile, len: u64) void {
+        _ = self.file_len.fetchMax(len, .release);
+    }
+
+    /// View `len` bytes at `offset`, or null if they lie past end of file
+    pub fn slice(self: *MappedFile, offset: u64, len: usize) !?[]const u8 {
+        if (!supported) return null;
+        const end = offset + len;
+        if (end > self.file_len.load(.acquire)) return null;
+
+        while (true) {
+            if (self.current.load(.acquire)) |region| {
+                if (end <= region.bytes.len) {
+                    return region.bytes[@intCast(offset)..@intCast(end)];
+                }
+            }
+            self.mutex.lock();
+            defer self.mutex.unlock();
+            try self.growLocked(end);
+        }
+    }
+
+    /// Hint the kernel about the coming access pattern (scans vs lookups)
+    pub fn advise(self: *MappedFile, sequential: bool) void {
+        if (!supported) return;
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        self.sequential = sequential;
+        if (self.current.load(.acquire)) |region| adviseRegion(region, sequential);
+    }
+
+    fn growLocked(self: *MappedFile, min_len: u64) !void {
+        const old = self.current.load(.acquire);
+        const old_len: u64 = if (old) |region| region.bytes.len else 0;
+        if (old_len >= min_len) return;
+
+        const wanted = @max(min_len, old_len * 2, self.file_len.load(.acquire));
+        const len = std.mem.alignForward(u64, wanted, page_size);
+
+        const bytes = try std.posix.mmap(
+            null,
+            @intCast(len),
+            std.posix.PROT.READ,
+            .{ .TYPE = .SHARED },
+            self.file.handle,
+            0,
+        );
+        errdefer std.posix.munmap(bytes);
+
+        const region = try self.allocator.create(Region);
+        errdefer self.allocator.destroy(region);
+        region.* = .{ .bytes = bytes };
+
+        if (old) |previous| try self.retired.append(self.allocator, previous);
+        adviseRegion(region, self.sequential);
+        self.current.store(region, .release);
+    }
+
+    fn adviseRegion(region: *const Region, sequential: bool) void {
+        const advice: u32 = if (sequential) std.posix.MADV.SEQUENTIAL else std.posix.MADV.NORMAL;
+        std.posix.madvise(@constCast(region.bytes.ptr), region.bytes.len, advice) catch {};
+    }
+
+    fn release(self: *MappedFile, region: *Region) void {
+        std.posix.munmap(region.bytes);
+        self.allocator.destroy(region);
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "mapping follows file growth" {
+    if (!supported) return error.SkipZigTest;
+
+    const path = "test_mapped_file.bin";
+    defer std.fs.cwd().deleteFile(path) catch {};
+
+    const file = try std.fs.cwd().createFile(path, .{ .read = true });
+    defer file.close();
+    try file.pwriteAll("first", 0);
+
+    var mapped = try MappedFile.init(std.testing.allocator, file);
+    defer mapped.deinit();
+
+    const head = (try mapped.slice(0, 5)) orelse return error.TestUnexpectedResult;
+    try std.testing.expectEqualStrings("first", head);
+
+    // Past end of file until a writer extends it
+    const far: u64 = 3 * page_size;
+    try std.testing.expect((try mapped.slice(far, 6)) == null);
+    try file.pwriteAll("second", far);
+    mapped.extendTo(far + 6);
+
+    const tail = (try mapped.slice(far, 6)) orelse return error.TestUnexpectedResult;
+    try std.testing.expectEqualStrings("second", tail);
+
+    // Earlier views survive the remap
+    try std.testing.expectEqualStrings("first", head);
+}
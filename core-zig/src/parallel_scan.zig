@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Parallel Scans - Morsels and Work Stealing
+//
+// A scan's block IDs are cut into morsels of MORSEL_BLOCKS consecutive
+// IDs. Each worker starts with an equal run of morsels and takes them
+// from the front; once its own run is empty it steals single morsels
+// from the back of the others'. A worker that lands on slow blocks (cold
+// pages, long overflow chains, decompression) sheds the rest of its run
+// instead of holding up the scan.
+//
+// Every morsel writes to its own output slot, so merging in block order
+// is concatenating the slots. The calling thread is worker 0: a scan
+// finishes even when every pool thread is busy with another one.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const builtin = @import("builtin");
+
+/// Block IDs per morsel: 1 MiB of blocks, large enough that claiming one
+/// costs nothing next to reading it
+pub const MORSEL_BLOCKS: usize = 256;
+
+/// Most workers one scan uses, calling thread included
+pub const MAX_WORKERS: u32 = 64;
+
+/// Number of morsels covering `len` IDs
+pub fn morselCount(len: usize) usize {
+    return std.math.divCeil(usize, len, MORSEL_BLOCKS) catch unreachable;
+}
+
+/// The IDs of morsel `index`
+pub fn morsel(ids: []const u64, index: usize) []const u64 {
+    const start = index * MORSEL_BLOCKS;
+    return ids[start..@min(ids.len, start + MORSEL_BLOCKS)];
+}
+
+/// A worker's unclaimed morsels [front, back), packed into one word so
+/// the owner and thieves claim from either end with one CAS. Runs only
+/// shrink, so an empty run stays empty.
+const Run = struct {
+    bounds: std.atomic.Value(u64),
+
+    fn init(front: u32, back: u32) Run {
+        return .{ .bounds = .init(pack(front, back)) };
+    }
+
+    fn pack(front: u32, back: u32) u64 {
+        return @as(u64, front) << 32 | back;
+    }
+
+    /// The owner's end
+    fn takeFront(self: *Run) ?u32 {
+        var cur = self.bounds.load(.monotonic);
+        while (true) {
+            const front: u32 = @intCast(cur >> 32);
+            const back: u32 = @truncate(cur);
+            if (front >= back) return null;
+            cur = self.bounds.cmpxchgWeak(cur, pack(front + 1, back), .monotonic, .monotonic) orelse return front;
+        }
+    }
+
+    /// The thieves' end
+    fn takeBack(self: *Run) ?u32 {
+        var cur = self.bounds.load(.monotonic);
+        while (true) {
+            const front: u32 = @intCast(cur >> 32);
+            const back: u32 = @truncate(cur);
+            if (front >= back) return null;
+            cur = self.bounds.cmpxchgWeak(cur, pack(front, back - 1), .monotonic, .monotonic) orelse return back - 1;
+        }
+    }
+};
+
+/// One scan in flight. `Job.runMorsel(job, index, ids)` is called exactly
+/// once per morsel, from whichever worker claims it.
+fn Scan(comptime Job: type) type {
+    return struct {
+        const Self = @This();
+
+        job: *Job,
+        ids: []const u64,
+        runs: []Run,
+
+        fn work(self: *Self, worker: usize) void {
+            while (self.runs[worker].takeFront()) |index| {
+                self.job.runMorsel(index, morsel(self.ids, index));
+            }
+
+            // Visit every other run once, draining it from the back
+            var offset: usize = 1;
+            while (offset < self.runs.len) {
+                const victim = (worker + offset) % self.runs.len;
+                if (self.runs[victim].takeBack()) |index| {
+                    self.job.runMorsel(index, morsel(self.ids, index));
+                } else {
+                    offset += 1;
+                }
+            }
+        }
+    };
+}
+
+/// Scan workers for one database. Threads start with the first scan
+/// large enough to split, so databases that never scan much never pay
+/// for them.
+pub const ScanPool = struct {
+    allocator: std.mem.Allocator,
+    /// Workers per scan, calling thread included; 1 scans serially
+    workers: u32,
+    threads: ?*std.Thread.Pool = null,
+    failed: bool = false,
+    mutex: std.Thread.Mutex = .{},
+
+    /// `workers` 0 means one per CPU
+    pub fn init(allocator: std.mem.Allocator, workers: u32) ScanPool {
+        const wanted = if (workers != 0) workers else @as(u32, @intCast(@min(MAX_WORKERS, std.Thread.getCpuCount() catch 1)));
+        return .{
+            .allocator = allocator,
+            .workers = if (builtin.single_threaded) 1 else std.math.clamp(wanted, 1, MAX_WORKERS),
+        };
+    }
+
+    pub fn deinit(self: *ScanPool) void {
+        if (self.threads) |pool| {
+            pool.deinit();
+            self.allocator.destroy(pool);
+        }
+        self.threads = null;
+    }
+
+    /// The pool threads, started on first use; null when they cannot be
+    /// started, in which case scans run on the calling thread
+    fn started(self: *ScanPool) ?*std.Thread.Pool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (self.threads != null or self.failed) return self.threads;
+
+        const pool = self.allocator.create(std.Thread.Pool) catch {
+            self.failed = true;
+            return null;
+        };
+        pool.init(.{ .allocator = self.allocator, .n_jobs = self.workers - 1 }) catch {
+            self.allocator.destroy(pool);
+            self.failed = true;
+            return null;
+        };
+        self.threads = pool;
+        return pool;
+    }
+
+    /// Call `job.runMorsel(index, ids)` for every morsel of `ids`, spread
+    /// over the workers; returns once all have run
+    pub fn run(self: *ScanPool, comptime Job: type, job: *Job, ids: []const u64) void {
+        const count = morselCount(ids.len);
+        const workers: usize = @min(self.workers, count);
+        const pool = (if (workers > 1) self.started() else null) orelse {
+            for (0..count) |index| job.runMorsel(index, morsel(ids, index));
+            return;
+        };
+
+        // Contiguous starting runs, so workers mostly read ahead of
+        // themselves and steal only near the end
+        var runs_buf: [MAX_WORKERS]Run = undefined;
+        const runs = runs_buf[0..workers];
+        for (runs, 0..) |*r, w| r.* = Run.init(@intCast(count * w / workers), @intCast(count * (w + 1) / workers));
+
+        var scan = Scan(Job){ .job = job, .ids = ids, .runs = runs };
+        var wg: std.Thread.WaitGroup = .{};
+        for (1..workers) |w| pool.spawnWg(&wg, Scan(Job).work, .{ &scan, w });
+        scan.work(0);
+        pool.waitAndWork(&wg);
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "runs are claimed from both ends exactly once" {
+    var r = Run.init(3, 7);
+    try std.testing.expectEqual(@as(?u32, 3), r.takeFront());
+    try std.testing.expectEqual(@as(?u32, 6), r.takeBack());
+    try std.testing.expectEqual(@as(?u32, 5), r.takeBack());
+    try std.testing.expectEqual(@as(?u32, 4), r.takeFront());
+    try std.testing.expectEqual(@as(?u32, null), r.takeFront());
+    try std.testing.expectEqual(@as(?u32, null), r.takeBack());
+}
+
+const CountingJob = struct {
+    seen: []std.atomic.Value(u32),
+    ids_seen: std.atomic.Value(usize) = .init(0),
+
+    pub fn runMorsel(self: *CountingJob, index: usize, ids: []const u64) void {
+        _ = self.seen[index].fetchAdd(1, .monotonic);
+        _ = self.ids_seen.fetchAdd(ids.len, .monotonic);
+        // Uneven morsels, so some workers fall behind and get robbed
+        if (index % 7 == 0) std.Thread.sleep(100 * std.time.ns_per_us);
+    }
+};
+
+test "every morsel runs once whatever the worker count" {
+    const allocator = std.testing.allocator;
+    const ids = try allocator.alloc(u64, 100 * MORSEL_BLOCKS + 17);
+    defer allocator.free(ids);
+    for (ids, 1..) |*id, n| id.* = n;
+
+    for ([_]u32{ 1, 3, 8 }) |workers| {
+        var pool = ScanPool.init(allocator, workers);
+        defer pool.deinit();
+
+        const seen = try allocator.alloc(std.atomic.Value(u32), morselCount(ids.len));
+        defer allocator.free(seen);
+        @memset(seen, .init(0));
+
+        var job = CountingJob{ .seen = seen };
+        pool.run(CountingJob, &job, ids);
+        for (seen) |*n| try std.testing.expectEqual(@as(u32, 1), n.load(.monotonic));
+        try std.testing.expectEqual(ids.len, job.ids_seen.load(.monotonic));
+    }
+
+    // The last morsel is short
+    try std.testing.expectEqual(@as(usize, 17), morsel(ids, 100).len);
+}
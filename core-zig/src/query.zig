@@ -0,0 +1,1364 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Query - Compiled Plans for fdb_query_execute
+//
+// A query is compiled once into a Plan and then run as a filter inside a
+// BlockCursor, so predicates are evaluated on each document as the scan
+// reads it and only matching (projected) rows are formatted:
+//
+//   SELECT * | field, ... FROM collection
+//     [WHERE cond (AND | OR) cond ...]
+//     [LIMIT n [OFFSET m]]
+//
+//   cond := field (= | != | <> | < | > | <= | >=) literal
+//         | field LIKE 'pattern'          (% any run, _ any byte)
+//         | field IN (literal, ...)
+//         | field CONTAINS literal        (array element or substring)
+//
+// AND binds tighter than OR, so the WHERE clause is held as a list of
+// conjunctions, any of which admits a document. Documents are JSON
+// objects or CBOR maps, read in place; a document belongs to a
+// collection when its top-level "collection" member names it. Fields are
+// top-level members or dotted paths into nested objects; `_id` is the
+// block ID. A missing field fails every comparison; mismatched types are
+// unequal and unordered.
+//
+// Access paths: every document block comes from the type index, except
+// that a single conjunction pinning `_id` to literals visits only those
+// blocks. Before any member is located, each document is searched for
+// the keys and string values the plan needs (vectorized, see
+// json_fields.indexOfString): with filters that match a small fraction
+// of documents, most are rejected by that scan alone. Plans are cached
+// per database by their normalized text (tokens
+// re-emitted with single spaces and uppercase keywords), so clients do
+// not need their own plan cache.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const cbor = @import("cbor.zig");
+const cursors = @import("cursor.zig");
+const json_fields = @import("json_fields.zig");
+
+/// Plans kept per database before the least recently used is dropped
+pub const PLAN_CACHE_CAPACITY: usize = 256;
+
+/// Longest query text accepted
+pub const MAX_QUERY_LEN: usize = 64 * 1024;
+
+pub const QueryError = error{ InvalidQuery, OutOfMemory };
+
+// ============================================================
+// Lexer
+// ============================================================
+
+const Tag = enum {
+    ident,
+    string,
+    number,
+    star,
+    comma,
+    lparen,
+    rparen,
+    semicolon,
+    eq,
+    ne,
+    lt,
+    gt,
+    le,
+    ge,
+    kw_select,
+    kw_from,
+    kw_where,
+    kw_and,
+    kw_or,
+    kw_limit,
+    kw_offset,
+    kw_like,
+    kw_in,
+    kw_contains,
+    kw_true,
+    kw_false,
+    kw_null,
+};
+
+const keywords = [_]struct { []const u8, Tag }{
+    .{ "SELECT", .kw_select },
+    .{ "FROM", .kw_from },
+    .{ "WHERE", .kw_where },
+    .{ "AND", .kw_and },
+    .{ "OR", .kw_or },
+    .{ "LIMIT", .kw_limit },
+    .{ "OFFSET", .kw_offset },
+    .{ "LIKE", .kw_like },
+    .{ "IN", .kw_in },
+    .{ "CONTAINS", .kw_contains },
+    .{ "TRUE", .kw_true },
+    .{ "FALSE", .kw_false },
+    .{ "NULL", .kw_null },
+};
+
+const Token = struct {
+    tag: Tag,
+    /// Source text; for strings, the contents between the quotes
+    text: []const u8,
+    /// Quote character of a string token
+    quote: u8 = 0,
+};
+
+fn keywordOf(word: []const u8) ?Tag {
+    for (keywords) |entry| {
+        if (std.ascii.eqlIgnoreCase(word, entry[0])) return entry[1];
+    }
+    return null;
+}
+
+fn isIdentStart(c: u8) bool {
+    return std.ascii.isAlphabetic(c) or c == '_';
+}
+
+fn isIdentChar(c: u8) bool {
+    return std.ascii.isAlphanumeric(c) or c == '_' or c == '.';
+}
+
+fn tokenize(allocator: std.mem.Allocator, text: []const u8, out: *std.ArrayList(Token)) QueryError!void {
+    var i: usize = 0;
+    while (i < text.len) {
+        const c = text[i];
+        if (std.ascii.isWhitespace(c)) {
+            i += 1;
+            continue;
+        }
+        // -- comment to end of line
+        if (c == '-' and i + 1 < text.len and text[i + 1] == '-') {
+            while (i < text.len and text[i] != '\n') i += 1;
+            continue;
+        }
+
+        const start = i;
+        const tag: Tag = switch (c) {
+            '*' => .star,
+            ',' => .comma,
+            '(' => .lparen,
+            ')' => .rparen,
+            ';' => .semicolon,
+            '=' => .eq,
+            '!' => blk: {
+                if (i + 1 >= text.len or text[i + 1] != '=') return error.InvalidQuery;
+                i += 1;
+                break :blk .ne;
+            },
+            '<' => blk: {
+                if (i + 1 < text.len and text[i + 1] == '=') {
+                    i += 1;
+                    break :blk .le;
+                }
+                if (i + 1 < text.len and text[i + 1] == '>') {
+                    i += 1;
+                    break :blk .ne;
+                }
+                break :blk .lt;
+            },
+            '>' => blk: {
+                if (i + 1 < text.len and text[i + 1] == '=') {
+                    i += 1;
+                    break :blk .ge;
+                }
+                break :blk .gt;
+            },
+            '\'', '"' => {
+                // A doubled quote stands for itself
+                i += 1;
+                while (true) : (i += 1) {
+                    if (i >= text.len) return error.InvalidQuery;
+                    if (text[i] != c) continue;
+                    if (i + 1 < text.len and text[i + 1] == c) {
+                        i += 1;
+                        continue;
+                    }
+                    break;
+                }
+                try out.append(allocator, .{ .tag = .string, .text = text[start + 1 .. i], .quote = c });
+                i += 1;
+                continue;
+            },
+            else => {
+                if (std.ascii.isDigit(c) or (c == '-' and i + 1 < text.len and std.ascii.isDigit(text[i + 1]))) {
+                    i += 1;
+                    while (i < text.len and (std.ascii.isAlphanumeric(text[i]) or text[i] == '.' or
+                        ((text[i] == '-' or text[i] == '+') and (text[i - 1] == 'e' or text[i - 1] == 'E')))) i += 1;
+                    _ = std.fmt.parseFloat(f64, text[start..i]) catch return error.InvalidQuery;
+                    try out.append(allocator, .{ .tag = .number, .text = text[start..i] });
+                    continue;
+                }
+                if (!isIdentStart(c)) return error.InvalidQuery;
+                while (i < text.len and isIdentChar(text[i])) i += 1;
+                const word = text[start..i];
+                try out.append(allocator, .{ .tag = keywordOf(word) orelse .ident, .text = word });
+                continue;
+            },
+        };
+        i += 1;
+        try out.append(allocator, .{ .tag = tag, .text = text[start..i] });
+    }
+}
+
+/// Decode a string token's doubled quotes
+fn stringValue(allocator: std.mem.Allocator, token: Token) ![]const u8 {
+    const doubled = [2]u8{ token.quote, token.quote };
+    if (std.mem.indexOf(u8, token.text, &doubled) == null) return allocator.dupe(u8, token.text);
+    return std.mem.replaceOwned(u8, allocator, token.text, &doubled, doubled[0..1]);
+}
+
+/// The cache key: tokens separated by single spaces, keywords in upper
+/// case, strings single-quoted, comments and a trailing `;` dropped
+fn appendNormalized(allocator: std.mem.Allocator, tokens: []const Token, out: *std.ArrayList(u8)) !void {
+    var count = tokens.len;
+    if (count > 0 and tokens[count - 1].tag == .semicolon) count -= 1;
+    for (tokens[0..count], 0..) |token, i| {
+        if (i > 0) try out.append(allocator, ' ');
+        switch (token.tag) {
+            .string => {
+                const value = try stringValue(allocator, token);
+                defer allocator.free(value);
+                try out.append(allocator, '\'');
+                for (value) |byte| {
+                    if (byte == '\'') try out.append(allocator, '\'');
+                    try out.append(allocator, byte);
+                }
+                try out.append(allocator, '\'');
+            },
+            .ne => try out.appendSlice(allocator, "!="),
+            else => {
+                if (@intFromEnum(token.tag) >= @intFromEnum(Tag.kw_select)) {
+                    for (token.text) |byte| try out.append(allocator, std.ascii.toUpper(byte));
+                } else {
+                    try out.appendSlice(allocator, token.text);
+                }
+            },
+        }
+    }
+}
+
+/// Normalized form of `text` (caller frees)
+pub fn normalize(allocator: std.mem.Allocator, text: []const u8) QueryError![]u8 {
+    var tokens: std.ArrayList(Token) = .{};
+    defer tokens.deinit(allocator);
+    try tokenize(allocator, text, &tokens);
+
+    var out: std.ArrayList(u8) = .{};
+    errdefer out.deinit(allocator);
+    try appendNormalized(allocator, tokens.items, &out);
+    return out.toOwnedSlice(allocator);
+}
+
+// ============================================================
+// Plans
+// ============================================================
+
+pub const Op = enum { eq, ne, lt, gt, le, ge, like, in, contains };
+
+pub const Literal = union(enum) {
+    string: []const u8,
+    number: f64,
+    boolean: bool,
+    null,
+};
+
+pub const Condition = struct {
+    field: []const u8,
+    op: Op,
+    /// One literal, or the IN list
+    values: []const Literal,
+};
+
+pub const Access = union(enum) {
+    /// Every document block, from the type index
+    type_scan,
+    /// Only these block IDs, ascending
+    block_ids: []const u64,
+};
+
+pub const Plan = struct {
+    arena: std.heap.ArenaAllocator,
+    /// Normalized query text (the cache key)
+    text: []const u8,
+    collection: []const u8,
+    /// Projected fields; null selects whole documents
+    fields: ?[]const []const u8,
+    /// Conjunctions, any of which admits a document; empty admits all
+    where: []const []const Condition,
+    limit: ?u64,
+    offset: u64,
+    access: Access,
+
+    /// JSON string tokens ("key") every admitted document contains
+    required: []const []const u8 = &.{},
+    /// The same per conjunction: a document may satisfy one only if it
+    /// contains all of its needles
+    needles: []const []const []const u8 = &.{},
+
+    // The cache holds one reference while the plan is cached and each
+    // running query holds one more
+    refs: std.atomic.Value(u32) = .init(1),
+    // Cache clock at last use (guarded by the cache mutex)
+    last_used: u64 = 0,
+
+    pub fn retain(self: *Plan) void {
+        _ = self.refs.fetchAdd(1, .monotonic);
+    }
+
+    pub fn release(self: *Plan) void {
+        if (self.refs.fetchSub(1, .acq_rel) != 1) return;
+        var arena = self.arena;
+        arena.deinit();
+    }
+
+    /// Whether the plan can stop before reading any block
+    pub fn isEmpty(self: *const Plan) bool {
+        return if (self.limit) |limit| limit == 0 else false;
+    }
+
+    pub fn hasPredicates(self: *const Plan) bool {
+        return self.where.len > 0;
+    }
+};
+
+/// Compile already-tokenized query text into a plan allocated by
+/// `allocator` (released with Plan.release)
+fn compile(allocator: std.mem.Allocator, tokens: []const Token, normalized: []const u8) QueryError!*Plan {
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    errdefer arena.deinit();
+    const plan_alloc = arena.allocator();
+
+    var parser = Parser{ .allocator = plan_alloc, .tokens = tokens };
+    const plan = try plan_alloc.create(Plan);
+    plan.* = .{
+        .arena = undefined,
+        .text = try plan_alloc.dupe(u8, normalized),
+        .collection = undefined,
+        .fields = null,
+        .where = &.{},
+        .limit = null,
+        .offset = 0,
+        .access = .type_scan,
+    };
+    try parser.parseSelect(plan);
+    plan.access = try chooseAccess(plan_alloc, plan.where);
+    try chooseNeedles(plan_alloc, plan);
+    plan.arena = arena;
+    return plan;
+}
+
+/// Strings a document must contain for the plan to admit it. JSON with
+/// no escapes spells each key and string value as exactly one quoted
+/// token, and CBOR stores text verbatim, so a document missing a needle
+/// fails without locating a single member. Every field a condition
+/// names must be present (missing fields fail every comparison), as must
+/// string literals compared with `=`.
+fn chooseNeedles(allocator: std.mem.Allocator, plan: *Plan) !void {
+    var required: std.ArrayList([]const u8) = .{};
+    try addNeedle(allocator, &required, "collection");
+    try addNeedle(allocator, &required, plan.collection);
+    plan.required = required.items;
+
+    const needles = try allocator.alloc([]const []const u8, plan.where.len);
+    for (plan.where, needles) |conjunction, *out| {
+        var list: std.ArrayList([]const u8) = .{};
+        for (conjunction) |cond| {
+            if (std.mem.eql(u8, cond.field, "_id")) continue;
+            var segments = std.mem.splitScalar(u8, cond.field, '.');
+            while (segments.next()) |segment| try addNeedle(allocator, &list, segment);
+            if (cond.op == .eq and cond.values[0] == .string) try addNeedle(allocator, &list, cond.values[0].string);
+        }
+        out.* = list.items;
+    }
+    plan.needles = needles;
+}
+
+/// Add `"text"`, unless JSON would have to escape it
+fn addNeedle(allocator: std.mem.Allocator, list: *std.ArrayList([]const u8), text: []const u8) !void {
+    for (text) |byte| {
+        if (byte < 0x20 or byte == '"' or byte == '\\') return;
+    }
+    try list.append(allocator, try std.fmt.allocPrint(allocator, "\"{s}\"", .{text}));
+}
+
+/// Block-ID lookup when the only conjunction pins `_id`
+fn chooseAccess(allocator: std.mem.Allocator, where: []const []const Condition) !Access {
+    if (where.len != 1) return .type_scan;
+    for (where[0]) |cond| {
+        if (!std.mem.eql(u8, cond.field, "_id")) continue;
+        if (cond.op != .eq and cond.op != .in) continue;
+
+        var ids: std.ArrayList(u64) = .{};
+        for (cond.values) |value| {
+            const number = switch (value) {
+                .number => |n| n,
+                else => continue,
+            };
+            if (number < 1 or number != @floor(number) or number > 0x1p63) continue;
+            try ids.append(allocator, @intFromFloat(number));
+        }
+        std.mem.sort(u64, ids.items, {}, std.sort.asc(u64));
+        var kept: usize = 0;
+        for (ids.items) |id| {
+            if (kept > 0 and ids.items[kept - 1] == id) continue;
+            ids.items[kept] = id;
+            kept += 1;
+        }
+        return .{ .block_ids = ids.items[0..kept] };
+    }
+    return .type_scan;
+}
+
+const Parser = struct {
+    allocator: std.mem.Allocator,
+    tokens: []const Token,
+    pos: usize = 0,
+
+    fn peek(self: *const Parser) ?Tag {
+        return if (self.pos < self.tokens.len) self.tokens[self.pos].tag else null;
+    }
+
+    fn take(self: *Parser, tag: Tag) ?Token {
+        if (self.peek() != tag) return null;
+        self.pos += 1;
+        return self.tokens[self.pos - 1];
+    }
+
+    fn expect(self: *Parser, tag: Tag) QueryError!Token {
+        return self.take(tag) orelse error.InvalidQuery;
+    }
+
+    fn parseSelect(self: *Parser, plan: *Plan) QueryError!void {
+        _ = try self.expect(.kw_select);
+        if (self.take(.star) == null) {
+            var fields: std.ArrayList([]const u8) = .{};
+            while (true) {
+                try fields.append(self.allocator, (try self.expect(.ident)).text);
+                if (self.take(.comma) == null) break;
+            }
+            plan.fields = fields.items;
+        }
+
+        _ = try self.expect(.kw_from);
+        plan.collection = switch (self.peek() orelse return error.InvalidQuery) {
+            .ident => self.tokens[self.pos].text,
+            .string => try stringValue(self.allocator, self.tokens[self.pos]),
+            else => return error.InvalidQuery,
+        };
+        self.pos += 1;
+
+        if (self.take(.kw_where) != null) plan.where = try self.parseWhere();
+
+        if (self.take(.kw_limit) != null) {
+            plan.limit = try self.parseCount();
+            if (self.take(.kw_offset) != null) plan.offset = try self.parseCount();
+        }
+
+        _ = self.take(.semicolon);
+        if (self.pos != self.tokens.len) return error.InvalidQuery;
+    }
+
+    fn parseCount(self: *Parser) QueryError!u64 {
+        const token = try self.expect(.number);
+        return std.fmt.parseInt(u64, token.text, 10) catch error.InvalidQuery;
+    }
+
+    fn parseWhere(self: *Parser) QueryError![]const []const Condition {
+        var disjuncts: std.ArrayList([]const Condition) = .{};
+        var conjunction: std.ArrayList(Condition) = .{};
+        while (true) {
+            try conjunction.append(self.allocator, try self.parseCondition());
+            if (self.take(.kw_and) != null) continue;
+            try disjuncts.append(self.allocator, conjunction.items);
+            conjunction = .{};
+            if (self.take(.kw_or) == null) break;
+        }
+        return disjuncts.items;
+    }
+
+    fn parseCondition(self: *Parser) QueryError!Condition {
+        const field = (try self.expect(.ident)).text;
+        const op_token = self.peek() orelse return error.InvalidQuery;
+        self.pos += 1;
+        const op: Op = switch (op_token) {
+            .eq => .eq,
+            .ne => .ne,
+            .lt => .lt,
+            .gt => .gt,
+            .le => .le,
+            .ge => .ge,
+            .kw_like => .like,
+            .kw_in => .in,
+            .kw_contains => .contains,
+            else => return error.InvalidQuery,
+        };
+
+        if (op == .in) {
+            _ = try self.expect(.lparen);
+            var values: std.ArrayList(Literal) = .{};
+            while (true) {
+                try values.append(self.allocator, try self.parseLiteral());
+                if (self.take(.comma) == null) break;
+            }
+            _ = try self.expect(.rparen);
+            return .{ .field = field, .op = op, .values = values.items };
+        }
+
+        const values = try self.allocator.alloc(Literal, 1);
+        values[0] = try self.parseLiteral();
+        if (op == .like and values[0] != .string) return error.InvalidQuery;
+        return .{ .field = field, .op = op, .values = values };
+    }
+
+    fn parseLiteral(self: *Parser) QueryError!Literal {
+        if (self.pos >= self.tokens.len) return error.InvalidQuery;
+        const token = self.tokens[self.pos];
+        self.pos += 1;
+        return switch (token.tag) {
+            .string => .{ .string = try stringValue(self.allocator, token) },
+            .number => .{ .number = std.fmt.parseFloat(f64, token.text) catch return error.InvalidQuery },
+            .kw_true => .{ .boolean = true },
+            .kw_false => .{ .boolean = false },
+            .kw_null => .null,
+            else => error.InvalidQuery,
+        };
+    }
+};
+
+// ============================================================
+// Evaluation
+// ============================================================
+
+const Order = std.math.Order;
+
+/// Document encodings evaluated in place
+pub const Encoding = enum { json, cbor };
+
+const CBOR_MAP: u8 = @intFromEnum(cbor.MajorType.map);
+const CBOR_ARRAY: u8 = @intFromEnum(cbor.MajorType.array);
+
+/// A payload the executor can look inside: a JSON object or a CBOR map.
+/// Anything else belongs to no collection.
+pub const Document = struct {
+    data: []const u8,
+    encoding: Encoding,
+    /// Index over the top-level CBOR map, reset to `data` by the caller,
+    /// for documents looked up by several paths
+    view: ?*cbor.MapView = null,
+
+    pub fn of(data: []const u8) ?Document {
+        const start = json_fields.skipSpace(data, 0);
+        if (start < data.len and data[start] == '{') return .{ .data = data, .encoding = .json };
+        if (data.len > 0 and data[0] >> 5 == CBOR_MAP) return .{ .data = data, .encoding = .cbor };
+        return null;
+    }
+
+    /// Raw value at a member or dotted path, in the document's encoding
+    pub fn findPath(self: Document, path: []const u8) !?[]const u8 {
+        switch (self.encoding) {
+            .json => return json_fields.findPath(self.data, path),
+            .cbor => {
+                var current = self.data;
+                var segments = std.mem.splitScalar(u8, path, '.');
+                if (self.view) |view| {
+                    current = (try view.get(segments.first())) orelse return null;
+                }
+                while (segments.next()) |segment| {
+                    if (current.len == 0 or current[0] >> 5 != CBOR_MAP) return null;
+                    current = (try cbor.findMapMember(current, segment)) orelse return null;
+                }
+                return current;
+            },
+        }
+    }
+
+    /// Whether every needle occurs (JSON as quoted tokens, CBOR as the
+    /// raw text it stores)
+    fn mayContain(self: Document, needles: []const []const u8) bool {
+        for (needles) |needle| {
+            const text = if (self.encoding == .json) needle else needle[1 .. needle.len - 1];
+            if (json_fields.indexOfString(self.data, text, 0) == null) return false;
+        }
+        return true;
+    }
+};
+
+/// A document value decoded far enough to compare
+const Value = union(enum) {
+    string: []const u8,
+    number: f64,
+    boolean: bool,
+    null,
+    /// Objects, arrays and anything else (only CONTAINS looks inside arrays)
+    other: []const u8,
+};
+
+fn decodeValue(allocator: std.mem.Allocator, encoding: Encoding, raw: []const u8, scratch: *std.ArrayList(u8)) !Value {
+    if (encoding == .cbor) return decodeCborValue(raw);
+    return switch (json_fields.kindOf(raw) orelse return error.InvalidJson) {
+        .string => .{ .string = try json_fields.stringContents(allocator, raw, scratch) },
+        .number => .{ .number = std.fmt.parseFloat(f64, raw) catch return error.InvalidJson },
+        .boolean => .{ .boolean = raw[0] == 't' },
+        .null => .null,
+        .object, .array => .{ .other = raw },
+    };
+}
+
+/// Decoders over raw items only decode text and skip, which never allocate
+fn rawDecoder(raw: []const u8) cbor.Decoder {
+    return .{ .data = raw, .pos = 0, .allocator = undefined };
+}
+
+fn decodeCborValue(raw: []const u8) !Value {
+    if (raw.len == 0) return error.UnexpectedEof;
+    var decoder = rawDecoder(raw);
+    return switch (@as(cbor.MajorType, @enumFromInt(@as(u3, @truncate(raw[0] >> 5))))) {
+        .unsigned, .negative => .{ .number = try decoder.decodeNumber() },
+        .text => .{ .string = try decoder.decodeText() },
+        .simple => switch (raw[0]) {
+            0xF4 => .{ .boolean = false },
+            0xF5 => .{ .boolean = true },
+            0xF6 => .null,
+            0xF9, 0xFA, 0xFB => .{ .number = try decoder.decodeNumber() },
+            else => .{ .other = raw },
+        },
+        else => .{ .other = raw },
+    };
+}
+
+/// Render the next CBOR item as JSON: byte strings as strings, tags
+/// dropped, non-finite floats and other simple values as null, and map
+/// members with non-text keys left out
+pub fn appendCborJson(allocator: std.mem.Allocator, out: *std.ArrayList(u8), decoder: *cbor.Decoder) !void {
+    return appendCborJsonNested(allocator, out, decoder, 0);
+}
+
+/// `appendCborJson` for an item inside `depth` enclosing arrays, maps and
+/// tags, bounded by cbor.MAX_DEPTH
+fn appendCborJsonNested(allocator: std.mem.Allocator, out: *std.ArrayList(u8), decoder: *cbor.Decoder, depth: usize) !void {
+    if (depth > cbor.MAX_DEPTH) return error.NestingTooDeep;
+    if (decoder.pos >= decoder.data.len) return error.UnexpectedEof;
+    const initial = decoder.data[decoder.pos];
+    switch (@as(cbor.MajorType, @enumFromInt(@as(u3, @truncate(initial >> 5))))) {
+        .unsigned => try out.print(allocator, "{d}", .{try decoder.decodeUint()}),
+        .negative => {
+            const ta = try decoder.readTypeArg();
+            try out.print(allocator, "-{d}", .{@as(u128, ta.arg) + 1});
+        },
+        .bytes, .text => {
+            const text = if (initial >> 5 == @intFromEnum(cbor.MajorType.text)) try decoder.decodeText() else try decoder.decodeBytes();
+            try out.append(allocator, '"');
+            try cursors.appendJsonEscaped(allocator, out, text);
+            try out.append(allocator, '"');
+        },
+        .array => {
+            const count = try decoder.decodeArrayLen();
+            try out.append(allocator, '[');
+            for (0..count) |i| {
+                if (i > 0) try out.append(allocator, ',');
+                try appendCborJsonNested(allocator, out, decoder, depth + 1);
+            }
+            try out.append(allocator, ']');
+        },
+        .map => {
+            const count = try decoder.decodeMapLen();
+            try out.append(allocator, '{');
+            var first = true;
+            for (0..count) |_| {
+                const is_text = decoder.pos < decoder.data.len and decoder.data[decoder.pos] >> 5 == @intFromEnum(cbor.MajorType.text);
+                if (!is_text) {
+                    try decoder.skipNested(depth + 1);
+                    try decoder.skipNested(depth + 1);
+                    continue;
+                }
+                if (!first) try out.append(allocator, ',');
+                first = false;
+                try out.append(allocator, '"');
+                try cursors.appendJsonEscaped(allocator, out, try decoder.decodeText());
+                try out.appendSlice(allocator, "\":");
+                try appendCborJsonNested(allocator, out, decoder, depth + 1);
+            }
+            try out.append(allocator, '}');
+        },
+        .tag => {
+            _ = try decoder.decodeTag();
+            try appendCborJsonNested(allocator, out, decoder, depth + 1);
+        },
+        .simple => switch (initial) {
+            0xF4, 0xF5 => {
+                try decoder.skip();
+                try out.appendSlice(allocator, if (initial == 0xF5) "true" else "false");
+            },
+            0xF9, 0xFA, 0xFB => {
+                const number = try decoder.decodeNumber();
+                if (std.math.isFinite(number)) {
+                    try out.print(allocator, "{d}", .{number});
+                } else {
+                    try out.appendSlice(allocator, "null");
+                }
+            },
+            else => {
+                try decoder.skip();
+                try out.appendSlice(allocator, "null");
+            },
+        },
+    }
+}
+
+/// Ordering of two values of the same type; null when they do not compare
+fn compare(value: Value, literal: Literal) ?Order {
+    return switch (literal) {
+        .string => |s| if (value == .string) std.mem.order(u8, value.string, s) else null,
+        .number => |n| if (value == .number) std.math.order(value.number, n) else null,
+        .boolean => |b| if (value == .boolean) std.math.order(@intFromBool(value.boolean), @intFromBool(b)) else null,
+        .null => if (value == .null) .eq else null,
+    };
+}
+
+fn equals(value: Value, literal: Literal) bool {
+    return compare(value, literal) == .eq;
+}
+
+/// SQL LIKE: `%` matches any run of bytes, `_` any one byte
+pub fn likeMatch(text: []const u8, pattern: []const u8) bool {
+    var t: usize = 0;
+    var p: usize = 0;
+    // Where the last % was seen, and the text position it is trying
+    var star_p: ?usize = null;
+    var star_t: usize = 0;
+    while (t < text.len) {
+        if (p < pattern.len and (pattern[p] == '_' or pattern[p] == text[t])) {
+            t += 1;
+            p += 1;
+        } else if (p < pattern.len and pattern[p] == '%') {
+            star_p = p;
+            star_t = t;
+            p += 1;
+        } else if (star_p) |sp| {
+            p = sp + 1;
+            star_t += 1;
+            t = star_t;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.len and pattern[p] == '%') p += 1;
+    return p == pattern.len;
+}
+
+/// Runs a plan as the RowFilter of one cursor
+pub const Execution = struct {
+    allocator: std.mem.Allocator,
+    plan: *Plan,
+
+    /// Documents offered to the filter
+    examined: u64 = 0,
+    /// Documents rejected by the needle scan alone
+    prefiltered: u64 = 0,
+    /// Documents that matched, including those skipped by OFFSET
+    matched: u64 = 0,
+    rows: u64 = 0,
+
+    // Projected row, and unescaped strings being compared
+    projection: std.ArrayList(u8) = .{},
+    scratch: std.ArrayList(u8) = .{},
+    element_scratch: std.ArrayList(u8) = .{},
+    /// Member offsets of the CBOR document being evaluated
+    view: cbor.MapView,
+
+    /// Takes a reference on `plan`
+    pub fn init(allocator: std.mem.Allocator, plan: *Plan) Execution {
+        plan.retain();
+        return .{ .allocator = allocator, .plan = plan, .view = cbor.MapView.init(allocator) };
+    }
+
+    pub fn deinit(self: *Execution) void {
+        self.view.deinit();
+        self.projection.deinit(self.allocator);
+        self.scratch.deinit(self.allocator);
+        self.element_scratch.deinit(self.allocator);
+        self.plan.release();
+    }
+
+    pub fn filter(self: *Execution) cursors.RowFilter {
+        return .{ .ctx = self, .applyFn = applyErased };
+    }
+
+    fn applyErased(ctx: *anyopaque, block_id: u64, data: []const u8) anyerror!cursors.Verdict {
+        const self: *Execution = @ptrCast(@alignCast(ctx));
+        return self.apply(block_id, data);
+    }
+
+    pub fn apply(self: *Execution, block_id: u64, data: []const u8) !cursors.Verdict {
+        const plan = self.plan;
+        if (plan.isEmpty()) return .stop;
+        self.examined += 1;
+
+        var doc = Document.of(data) orelse return .skip;
+        if (doc.encoding == .cbor) {
+            self.view.reset(data);
+            doc.view = &self.view;
+        }
+        if (!self.prefilter(doc)) {
+            self.prefiltered += 1;
+            return .skip;
+        }
+
+        // Malformed documents match nothing
+        const admitted = self.admits(block_id, doc) catch |err| switch (err) {
+            error.InvalidJson, error.UnexpectedEof, error.InvalidType, error.InvalidValue, error.NestingTooDeep => false,
+            else => return err,
+        };
+        if (!admitted) return .skip;
+
+        self.matched += 1;
+        if (self.matched <= plan.offset) return .skip;
+
+        const fields = plan.fields orelse return self.emit(data);
+        const row = self.project(block_id, doc, fields) catch |err| switch (err) {
+            error.InvalidJson, error.UnexpectedEof, error.InvalidType, error.InvalidValue, error.NestingTooDeep => return .skip,
+            else => return err,
+        };
+        return self.emit(row);
+    }
+
+    fn emit(self: *Execution, row: []const u8) cursors.Verdict {
+        self.rows += 1;
+        if (self.plan.limit) |limit| {
+            if (self.rows >= limit) return .{ .last = row };
+        }
+        return .{ .emit = row };
+    }
+
+    /// Whether `doc` can be admitted at all, from the needle scan
+    fn prefilter(self: *Execution, doc: Document) bool {
+        const plan = self.plan;
+        // An escape could spell any key or value another way
+        if (doc.encoding == .json and std.mem.indexOfScalar(u8, doc.data, '\\') != null) return true;
+        if (!doc.mayContain(plan.required)) return false;
+        if (plan.needles.len == 0) return true;
+        for (plan.needles) |conjunction| {
+            if (doc.mayContain(conjunction)) return true;
+        }
+        return false;
+    }
+
+    fn admits(self: *Execution, block_id: u64, doc: Document) !bool {
+        const plan = self.plan;
+        const collection = (try doc.findPath("collection")) orelse return false;
+        const name = try decodeValue(self.allocator, doc.encoding, collection, &self.scratch);
+        if (!equals(name, .{ .string = plan.collection })) return false;
+
+        if (plan.where.len == 0) return true;
+        for (plan.where) |conjunction| {
+            for (conjunction) |cond| {
+                if (!try self.holds(block_id, doc, cond)) break;
+            } else return true;
+        }
+        return false;
+    }
+
+    fn holds(self: *Execution, block_id: u64, doc: Document, cond: Condition) !bool {
+        const value: Value = if (std.mem.eql(u8, cond.field, "_id"))
+            .{ .number = @floatFromInt(block_id) }
+        else blk: {
+            const raw = (try doc.findPath(cond.field)) orelse return false;
+            break :blk try decodeValue(self.allocator, doc.encoding, raw, &self.scratch);
+        };
+
+        const literal = cond.values[0];
+        return switch (cond.op) {
+            .eq => equals(value, literal),
+            .ne => !equals(value, literal),
+            .lt => compare(value, literal) == .lt,
+            .gt => compare(value, literal) == .gt,
+            .le => if (compare(value, literal)) |order| order != .gt else false,
+            .ge => if (compare(value, literal)) |order| order != .lt else false,
+            .like => value == .string and likeMatch(value.string, literal.string),
+            .in => for (cond.values) |candidate| {
+                if (equals(value, candidate)) break true;
+            } else false,
+            .contains => switch (value) {
+                .string => |s| literal == .string and std.mem.indexOf(u8, s, literal.string) != null,
+                .other => |raw| try self.arrayContains(doc.encoding, raw, literal),
+                else => false,
+            },
+        };
+    }
+
+    fn arrayContains(self: *Execution, encoding: Encoding, raw: []const u8, literal: Literal) !bool {
+        switch (encoding) {
+            .json => {
+                if (json_fields.kindOf(raw) != .array) return false;
+                var elements = try json_fields.ElementIterator.init(raw);
+                while (try elements.next()) |element| {
+                    if (equals(try decodeValue(self.allocator, .json, element, &self.element_scratch), literal)) return true;
+                }
+            },
+            .cbor => {
+                if (raw[0] >> 5 != CBOR_ARRAY) return false;
+                var decoder = rawDecoder(raw);
+                const count = try decoder.decodeArrayLen();
+                for (0..count) |_| {
+                    if (equals(try decodeCborValue(try decoder.rawItem()), literal)) return true;
+                }
+            },
+        }
+        return false;
+    }
+
+    /// {"field":<value as JSON>,...} with null for missing fields
+    fn project(self: *Execution, block_id: u64, doc: Document, fields: []const []const u8) ![]const u8 {
+        const out = &self.projection;
+        out.clearRetainingCapacity();
+        try out.append(self.allocator, '{');
+        for (fields, 0..) |field, i| {
+            if (i > 0) try out.append(self.allocator, ',');
+            try out.append(self.allocator, '"');
+            try cursors.appendJsonEscaped(self.allocator, out, field);
+            try out.appendSlice(self.allocator, "\":");
+            if (std.mem.eql(u8, field, "_id")) {
+                try out.print(self.allocator, "{d}", .{block_id});
+            } else if (try doc.findPath(field)) |raw| {
+                switch (doc.encoding) {
+                    .json => try out.appendSlice(self.allocator, raw),
+                    .cbor => {
+                        var decoder = rawDecoder(raw);
+                        try appendCborJson(self.allocator, out, &decoder);
+                    },
+                }
+            } else {
+                try out.appendSlice(self.allocator, "null");
+            }
+        }
+        try out.append(self.allocator, '}');
+        return out.items;
+    }
+};
+
+// ============================================================
+// Explain
+// ============================================================
+
+pub const ExplainCounts = struct {
+    cached: bool,
+    estimated_blocks: u64,
+    actual_blocks: u64,
+    examined: u64,
+    prefiltered: u64,
+    rows: u64,
+};
+
+/// Blocks the plan expects to read given the live documents in the type
+/// index: lookups read their IDs; an unfiltered scan stops at its limit
+pub fn estimateBlocks(plan: *const Plan, live_documents: u64) u64 {
+    if (plan.isEmpty()) return 0;
+    return switch (plan.access) {
+        .block_ids => |ids| ids.len,
+        .type_scan => if (plan.limit != null and !plan.hasPredicates())
+            @min(live_documents, plan.offset +| plan.limit.?)
+        else
+            live_documents,
+    };
+}
+
+fn appendLiteralJson(allocator: std.mem.Allocator, out: *std.ArrayList(u8), literal: Literal) !void {
+    switch (literal) {
+        .string => |s| {
+            try out.append(allocator, '"');
+            try cursors.appendJsonEscaped(allocator, out, s);
+            try out.append(allocator, '"');
+        },
+        .number => |n| try out.print(allocator, "{d}", .{n}),
+        .boolean => |b| try out.appendSlice(allocator, if (b) "true" else "false"),
+        .null => try out.appendSlice(allocator, "null"),
+    }
+}
+
+/// The fdb_query_explain document:
+/// {"query":"...","plan":{"access":"type_scan"|"block_ids","collection":...,
+///  "fields":[...]|null,"where":[[{"field":...,"op":...,"values":[...]}]],
+///  "limit":N|null,"offset":N},"cached":B,"estimated_blocks":N,
+///  "actual_blocks":N,"examined":N,"prefiltered":N,"rows":N}
+pub fn appendExplainJson(allocator: std.mem.Allocator, out: *std.ArrayList(u8), plan: *const Plan, counts: ExplainCounts) !void {
+    try out.appendSlice(allocator, "{\"query\":\"");
+    try cursors.appendJsonEscaped(allocator, out, plan.text);
+    try out.print(allocator, "\",\"plan\":{{\"access\":\"{s}\",\"collection\":\"", .{@tagName(plan.access)});
+    try cursors.appendJsonEscaped(allocator, out, plan.collection);
+    try out.appendSlice(allocator, "\",\"fields\":");
+    if (plan.fields) |fields| {
+        try out.append(allocator, '[');
+        for (fields, 0..) |field, i| {
+            if (i > 0) try out.append(allocator, ',');
+            try out.append(allocator, '"');
+            try cursors.appendJsonEscaped(allocator, out, field);
+            try out.append(allocator, '"');
+        }
+        try out.append(allocator, ']');
+    } else {
+        try out.appendSlice(allocator, "null");
+    }
+
+    try out.appendSlice(allocator, ",\"where\":[");
+    for (plan.where, 0..) |conjunction, i| {
+        if (i > 0) try out.append(allocator, ',');
+        try out.append(allocator, '[');
+        for (conjunction, 0..) |cond, j| {
+            if (j > 0) try out.append(allocator, ',');
+            try out.appendSlice(allocator, "{\"field\":\"");
+            try cursors.appendJsonEscaped(allocator, out, cond.field);
+            try out.print(allocator, "\",\"op\":\"{s}\",\"values\":[", .{@tagName(cond.op)});
+            for (cond.values, 0..) |value, k| {
+                if (k > 0) try out.append(allocator, ',');
+                try appendLiteralJson(allocator, out, value);
+            }
+            try out.appendSlice(allocator, "]}");
+        }
+        try out.append(allocator, ']');
+    }
+    try out.appendSlice(allocator, "],\"limit\":");
+    if (plan.limit) |limit| try out.print(allocator, "{d}", .{limit}) else try out.appendSlice(allocator, "null");
+
+    try out.print(allocator,
+        \\,"offset":{d}}},"cached":{any},"estimated_blocks":{d},"actual_blocks":{d},"examined":{d},"prefiltered":{d},"rows":{d}}}
+    , .{ plan.offset, counts.cached, counts.estimated_blocks, counts.actual_blocks, counts.examined, counts.prefiltered, counts.rows });
+}
+
+// ============================================================
+// Plan Cache
+// ============================================================
+
+pub const PlanCache = struct {
+    allocator: std.mem.Allocator,
+    mutex: std.Thread.Mutex = .{},
+    // Keys are the plans' own normalized text
+    plans: std.StringHashMapUnmanaged(*Plan) = .{},
+    clock: u64 = 0,
+    capacity: usize = PLAN_CACHE_CAPACITY,
+    hits: u64 = 0,
+    misses: u64 = 0,
+
+    pub fn init(allocator: std.mem.Allocator) PlanCache {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(self: *PlanCache) void {
+        var it = self.plans.valueIterator();
+        while (it.next()) |plan| plan.*.release();
+        self.plans.deinit(self.allocator);
+    }
+
+    /// The plan for `text`, compiled on first use. The caller owns one
+    /// reference (Plan.release); `cached` says whether it was reused.
+    pub fn acquire(self: *PlanCache, text: []const u8, cached: *bool) QueryError!*Plan {
+        if (text.len > MAX_QUERY_LEN) return error.InvalidQuery;
+
+        var tokens: std.ArrayList(Token) = .{};
+        defer tokens.deinit(self.allocator);
+        try tokenize(self.allocator, text, &tokens);
+
+        var key: std.ArrayList(u8) = .{};
+        defer key.deinit(self.allocator);
+        try appendNormalized(self.allocator, tokens.items, &key);
+
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        self.clock += 1;
+
+        if (self.plans.get(key.items)) |plan| {
+            self.hits += 1;
+            plan.last_used = self.clock;
+            plan.retain();
+            cached.* = true;
+            return plan;
+        }
+
+        const plan = try compile(self.allocator, tokens.items, key.items);
+        errdefer plan.release();
+        if (self.plans.count() >= self.capacity) self.evictLocked();
+        try self.plans.put(self.allocator, plan.text, plan);
+
+        self.misses += 1;
+        plan.last_used = self.clock;
+        plan.retain();
+        cached.* = false;
+        return plan;
+    }
+
+    /// Drop the least recently used plan (queries running it keep theirs)
+    fn evictLocked(self: *PlanCache) void {
+        var oldest: ?*Plan = null;
+        var it = self.plans.valueIterator();
+        while (it.next()) |plan| {
+            if (oldest == null or plan.*.last_used < oldest.?.last_used) oldest = plan.*;
+        }
+        const victim = oldest orelse return;
+        _ = self.plans.remove(victim.text);
+        victim.release();
+    }
+
+    pub fn count(self: *PlanCache) usize {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.plans.count();
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "normalization ignores spacing, case and comments" {
+    const allocator = std.testing.allocator;
+    const a = try normalize(allocator, "select *  from evidence\n where score >= 90 -- high\n limit 5;");
+    defer allocator.free(a);
+    const b = try normalize(allocator, "SELECT * FROM evidence WHERE score>=90 LIMIT 5");
+    defer allocator.free(b);
+    try std.testing.expectEqualStrings("SELECT * FROM evidence WHERE score >= 90 LIMIT 5", a);
+    try std.testing.expectEqualStrings(a, b);
+
+    const quoted = try normalize(allocator, "SELECT * FROM c WHERE name = \"it's\" OR name <> 'a''b'");
+    defer allocator.free(quoted);
+    try std.testing.expectEqualStrings("SELECT * FROM c WHERE name = 'it''s' OR name != 'a''b'", quoted);
+
+    try std.testing.expectError(error.InvalidQuery, normalize(allocator, "SELECT * FROM c WHERE name = 'open"));
+    try std.testing.expectError(error.InvalidQuery, normalize(allocator, "SELECT # FROM c"));
+}
+
+test "plans hold predicates as conjunctions and pick an access path" {
+    var cache = PlanCache.init(std.testing.allocator);
+    defer cache.deinit();
+    var cached = false;
+
+    const scan = try cache.acquire("SELECT title, source.name FROM evidence WHERE score > 80 AND tags CONTAINS 'x' OR title LIKE 'A%' LIMIT 10 OFFSET 2", &cached);
+    defer scan.release();
+    try std.testing.expect(!cached);
+    try std.testing.expectEqualStrings("evidence", scan.collection);
+    try std.testing.expectEqual(@as(usize, 2), scan.fields.?.len);
+    try std.testing.expectEqual(@as(usize, 2), scan.where.len);
+    try std.testing.expectEqual(@as(usize, 2), scan.where[0].len);
+    try std.testing.expectEqual(Op.like, scan.where[1][0].op);
+    try std.testing.expectEqual(@as(?u64, 10), scan.limit);
+    try std.testing.expectEqual(@as(u64, 2), scan.offset);
+    try std.testing.expect(scan.access == .type_scan);
+
+    const lookup = try cache.acquire("SELECT * FROM evidence WHERE _id IN (9, 3, 9) AND score > 1", &cached);
+    defer lookup.release();
+    try std.testing.expectEqualSlices(u64, &.{ 3, 9 }, lookup.access.block_ids);
+
+    try std.testing.expectError(error.InvalidQuery, cache.acquire("SELECT * FROM", &cached));
+    try std.testing.expectError(error.InvalidQuery, cache.acquire("SELECT * FROM c WHERE a LIKE 3", &cached));
+    try std.testing.expectError(error.InvalidQuery, cache.acquire("SELECT * FROM c LIMIT 2 extra", &cached));
+}
+
+test "the cache reuses plans by normalized text and evicts the oldest" {
+    var cache = PlanCache.init(std.testing.allocator);
+    defer cache.deinit();
+    cache.capacity = 2;
+    var cached = false;
+
+    const first = try cache.acquire("SELECT * FROM a", &cached);
+    first.release();
+    const again = try cache.acquire("select *\tfrom a;", &cached);
+    try std.testing.expect(cached);
+    try std.testing.expectEqual(first, again);
+
+    (try cache.acquire("SELECT * FROM b", &cached)).release();
+    (try cache.acquire("SELECT * FROM c", &cached)).release();
+    try std.testing.expectEqual(@as(usize, 2), cache.count());
+
+    // "a" was least recently used: evicted, but alive while held here
+    try std.testing.expect(cache.plans.get("SELECT * FROM a") == null);
+    try std.testing.expectEqualStrings("SELECT * FROM a", again.text);
+    again.release();
+
+    const b = try cache.acquire("SELECT * FROM b", &cached);
+    b.release();
+    try std.testing.expect(cached);
+}
+
+test "executions filter, project and stop at the limit" {
+    var cache = PlanCache.init(std.testing.allocator);
+    defer cache.deinit();
+    var cached = false;
+
+    const plan = try cache.acquire(
+        "SELECT title, meta.lang, _id FROM evidence WHERE score >= 80 AND tags CONTAINS 'peer' OR title LIKE 'Re_ort%' LIMIT 2 OFFSET 1",
+        &cached,
+    );
+    defer plan.release();
+    var exec = Execution.init(std.testing.allocator, plan);
+    defer exec.deinit();
+
+    const docs = [_][]const u8{
+        \\{"collection":"evidence","title":"A","score":95,"tags":["peer","x"],"meta":{"lang":"en"}}
+        ,
+        \\{"collection":"other","title":"Report 1","score":99,"tags":["peer"]}
+        ,
+        \\{"collection":"evidence","title":"B","score":70,"tags":["peer"]}
+        ,
+        \\{"collection":"evidence","title":"Report 2","score":"n/a"}
+        ,
+        "not json",
+        \\{"collection":"evidence","title":"C","score":80,"tags":["peer"]}
+        ,
+        \\{"collection":"evidence","title":"D","score":90,"tags":["peer"]}
+        ,
+    };
+
+    // A is skipped by OFFSET; B fails both conjunctions
+    try std.testing.expect(try exec.apply(1, docs[0]) == .skip);
+    try std.testing.expect(try exec.apply(2, docs[1]) == .skip);
+    try std.testing.expect(try exec.apply(3, docs[2]) == .skip);
+    const report = try exec.apply(4, docs[3]);
+    try std.testing.expectEqualStrings("{\"title\":\"Report 2\",\"meta.lang\":null,\"_id\":4}", report.emit);
+    try std.testing.expect(try exec.apply(5, docs[4]) == .skip);
+    const last = try exec.apply(6, docs[5]);
+    try std.testing.expectEqualStrings("{\"title\":\"C\",\"meta.lang\":null,\"_id\":6}", last.last);
+
+    try std.testing.expectEqual(@as(u64, 6), exec.examined);
+    // Only "other" lacks the collection's needles
+    try std.testing.expectEqual(@as(u64, 1), exec.prefiltered);
+    try std.testing.expectEqual(@as(u64, 3), exec.matched);
+    try std.testing.expectEqual(@as(u64, 2), exec.rows);
+}
+
+test "needles reject documents before members are located" {
+    var cache = PlanCache.init(std.testing.allocator);
+    defer cache.deinit();
+    var cached = false;
+
+    const plan = try cache.acquire("SELECT * FROM evidence WHERE status = 'published' AND meta.score > 1 OR kind = 'a\"b'", &cached);
+    defer plan.release();
+    try std.testing.expectEqual(@as(usize, 2), plan.required.len);
+    try std.testing.expectEqualStrings("\"evidence\"", plan.required[1]);
+    try std.testing.expectEqual(@as(usize, 4), plan.needles[0].len);
+    // Strings JSON would escape are not needles
+    try std.testing.expectEqual(@as(usize, 1), plan.needles[1].len);
+
+    var exec = Execution.init(std.testing.allocator, plan);
+    defer exec.deinit();
+
+    // A draft with no "kind": rejected by the scan alone
+    const near_miss =
+        \\{"collection":"evidence","status":"draft","meta":{"score":5}}
+    ;
+    try std.testing.expect(try exec.apply(1, near_miss) == .skip);
+    try std.testing.expectEqual(@as(u64, 1), exec.prefiltered);
+
+    // An escape anywhere disables the scan, not the predicates
+    const escaped =
+        \\{"collection":"evid\u0065nce","status":"published","meta":{"score":5}}
+    ;
+    try std.testing.expect(try exec.apply(2, escaped) == .emit);
+    try std.testing.expectEqual(@as(u64, 1), exec.prefiltered);
+}
+
+test "cbor documents are evaluated and projected in place" {
+    const allocator = std.testing.allocator;
+    var encoder = cbor.Encoder.init(allocator);
+    defer encoder.deinit();
+    try encoder.beginMap(4);
+    try encoder.encodeText("collection");
+    try encoder.encodeText("evidence");
+    try encoder.encodeText("score");
+    try encoder.encodeFloat(92.5);
+    try encoder.encodeText("tags");
+    try encoder.beginArray(2);
+    try encoder.encodeText("peer");
+    try encoder.encodeBool(true);
+    try encoder.encodeText("meta");
+    try encoder.beginMap(1);
+    try encoder.encodeText("lang");
+    try encoder.encodeText("en");
+    const doc = encoder.finish();
+
+    var cache = PlanCache.init(allocator);
+    defer cache.deinit();
+    var cached = false;
+
+    const plan = try cache.acquire("SELECT score, tags, meta, meta.lang, title FROM evidence WHERE score > 90 AND tags CONTAINS 'peer' AND meta.lang = 'en'", &cached);
+    defer plan.release();
+    var exec = Execution.init(allocator, plan);
+    defer exec.deinit();
+    const verdict = try exec.apply(1, doc);
+    try std.testing.expectEqualStrings(
+        \\{"score":92.5,"tags":["peer",true],"meta":{"lang":"en"},"meta.lang":"en","title":null}
+    , verdict.emit);
+
+    const miss = try cache.acquire("SELECT * FROM evidence WHERE meta.lang = 'fr'", &cached);
+    defer miss.release();
+    var miss_exec = Execution.init(allocator, miss);
+    defer miss_exec.deinit();
+    try std.testing.expect(try miss_exec.apply(1, doc) == .skip);
+    try std.testing.expectEqual(@as(u64, 1), miss_exec.prefiltered);
+}
+
+test "cbor rendering stops at the decoder's nesting limit" {
+    const allocator = std.testing.allocator;
+    var out: std.ArrayList(u8) = .{};
+    defer out.deinit(allocator);
+
+    for ([_]usize{ cbor.MAX_DEPTH, cbor.MAX_DEPTH + 1 }) |depth| {
+        var encoder = cbor.Encoder.init(allocator);
+        defer encoder.deinit();
+        for (0..depth) |_| try encoder.beginArray(1);
+        try encoder.encodeUint(7);
+
+        out.clearRetainingCapacity();
+        var decoder = cbor.Decoder.init(allocator, encoder.finish());
+        if (depth > cbor.MAX_DEPTH) {
+            try std.testing.expectError(error.NestingTooDeep, appendCborJson(allocator, &out, &decoder));
+        } else {
+            try appendCborJson(allocator, &out, &decoder);
+            try std.testing.expectEqual(2 * depth + 1, out.items.len);
+        }
+    }
+}
+
+test "comparisons follow document types" {
+    var cache = PlanCache.init(std.testing.allocator);
+    defer cache.deinit();
+    var cached = false;
+
+    const doc =
+        \\{"collection":"c","n":5,"s":"b","t":true,"z":null}
+    ;
+    const cases = [_]struct { []const u8, bool }{
+        .{ "n = 5", true },
+        .{ "n != 5", false },
+        .{ "n != 'five'", true },
+        .{ "n < 'z'", false },
+        .{ "n IN (1, 5)", true },
+        .{ "s > 'a'", true },
+        .{ "s <= 'b'", true },
+        .{ "t = TRUE", true },
+        .{ "z = NULL", true },
+        .{ "missing != 1", false },
+        .{ "s LIKE '%'", true },
+        .{ "s CONTAINS 'b'", true },
+    };
+    for (cases) |case| {
+        var text: std.ArrayList(u8) = .{};
+        defer text.deinit(std.testing.allocator);
+        try text.print(std.testing.allocator, "SELECT * FROM c WHERE {s}", .{case[0]});
+
+        const plan = try cache.acquire(text.items, &cached);
+        defer plan.release();
+        var exec = Execution.init(std.testing.allocator, plan);
+        defer exec.deinit();
+        const verdict = try exec.apply(1, doc);
+        try std.testing.expectEqual(case[1], verdict == .emit);
+    }
+}
+
+test "like patterns" {
+    try std.testing.expect(likeMatch("report", "rep%"));
+    try std.testing.expect(likeMatch("report", "%port"));
+    try std.testing.expect(likeMatch("report", "r_p_r_"));
+    try std.testing.expect(likeMatch("", "%"));
+    try std.testing.expect(!likeMatch("report", "rep"));
+    try std.testing.expect(!likeMatch("report", "%x%"));
+}
@@ -0,0 +1,500 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Replication - Journal Shipments
+//
+// A leader ships its journal to followers in shipments: a run of entries,
+// copied byte for byte as they sit in the leader's segments (each with
+// its own CRC32C), followed by the current image of every document they
+// insert or update. The journal records what changed, not the bytes, so
+// the images travel alongside. The body may be LZ4-compressed as a whole.
+//
+//   Header (56 bytes, little-endian)
+//   0   8   magic "LGSHIP01"
+//   8   8   first_sequence
+//   16  8   last_sequence
+//   24  4   entry_count
+//   28  4   document_count
+//   32  4   entries_len     (bytes of entries in the raw body)
+//   36  4   raw_len         (entries + documents, uncompressed)
+//   40  4   body_len        (bytes following the header, as stored)
+//   44  2   version
+//   46  2   flags           (SHIP_LZ4)
+//   48  4   checksum        (CRC32C of header with this field zeroed, then body)
+//   52  4   reserved
+//
+//   Raw body
+//   entries     journal entries first_sequence..last_sequence
+//   documents   document_count x { u64 origin block, u32 len, bytes }
+//
+// A follower applies a shipment as one commit group and keeps its own
+// block IDs: its journal and map pages are placed by its own allocator,
+// so leader IDs cannot be mirrored. Each replicated journal record names
+// the leader block it came from ("origin=N") and every shipment ends with
+// a REPLICA_MARK record ("through=N"), so the origin map and the applied
+// watermark are rebuilt from the follower's own journal after a restart.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const blocks = @import("blocks.zig");
+const journal = @import("journal_reader.zig");
+const lz4 = @import("lz4.zig");
+
+const JournalEntry = blocks.JournalEntry;
+const JournalOp = blocks.JournalOp;
+const JournalSegmentIterator = blocks.JournalSegmentIterator;
+
+pub const MAGIC = "LGSHIP01";
+pub const VERSION: u16 = 1;
+pub const HEADER_SIZE: usize = 56;
+const CHECKSUM_OFFSET: usize = 48;
+
+/// Body is one LZ4 block
+pub const SHIP_LZ4: u16 = 0x0001;
+
+/// Raw body size a leader stops adding entries at when the caller sets
+/// no limit
+pub const DEFAULT_SHIPMENT_BYTES: usize = 16 * 1024 * 1024;
+
+/// Largest raw body: lengths are u32 on the wire
+pub const MAX_SHIPMENT_BYTES: usize = std.math.maxInt(u32);
+
+const DOCUMENT_HEADER_SIZE: usize = 12;
+
+pub const Header = struct {
+    first_sequence: u64,
+    last_sequence: u64,
+    entry_count: u32,
+    document_count: u32,
+    entries_len: u32,
+    raw_len: u32,
+    body_len: u32,
+    flags: u16,
+
+    fn write(self: Header, dst: *[HEADER_SIZE]u8) void {
+        @memcpy(dst[0..8], MAGIC);
+        std.mem.writeInt(u64, dst[8..16], self.first_sequence, .little);
+        std.mem.writeInt(u64, dst[16..24], self.last_sequence, .little);
+        std.mem.writeInt(u32, dst[24..28], self.entry_count, .little);
+        std.mem.writeInt(u32, dst[28..32], self.document_count, .little);
+        std.mem.writeInt(u32, dst[32..36], self.entries_len, .little);
+        std.mem.writeInt(u32, dst[36..40], self.raw_len, .little);
+        std.mem.writeInt(u32, dst[40..44], self.body_len, .little);
+        std.mem.writeInt(u16, dst[44..46], VERSION, .little);
+        std.mem.writeInt(u16, dst[46..48], self.flags, .little);
+        @memset(dst[48..56], 0);
+    }
+
+    fn read(src: *const [HEADER_SIZE]u8) !Header {
+        if (!std.mem.eql(u8, src[0..8], MAGIC)) return error.InvalidShipment;
+        if (std.mem.readInt(u16, src[44..46], .little) != VERSION) return error.InvalidShipment;
+        return .{
+            .first_sequence = std.mem.readInt(u64, src[8..16], .little),
+            .last_sequence = std.mem.readInt(u64, src[16..24], .little),
+            .entry_count = std.mem.readInt(u32, src[24..28], .little),
+            .document_count = std.mem.readInt(u32, src[28..32], .little),
+            .entries_len = std.mem.readInt(u32, src[32..36], .little),
+            .raw_len = std.mem.readInt(u32, src[36..40], .little),
+            .body_len = std.mem.readInt(u32, src[40..44], .little),
+            .flags = std.mem.readInt(u16, src[46..48], .little),
+        };
+    }
+};
+
+fn checksum(header: *const [HEADER_SIZE]u8, body: []const u8) u32 {
+    const zero = [_]u8{0} ** 4;
+    var crc = blocks.crc32cUpdate(0xFFFFFFFF, header[0..CHECKSUM_OFFSET]);
+    crc = blocks.crc32cUpdate(crc, &zero);
+    crc = blocks.crc32cUpdate(crc, header[CHECKSUM_OFFSET + 4 ..]);
+    crc = blocks.crc32cUpdate(crc, body);
+    return crc ^ 0xFFFFFFFF;
+}
+
+// ============================================================
+// Leader: building shipments
+// ============================================================
+
+/// Collects entries and document images for one shipment
+pub const Builder = struct {
+    allocator: std.mem.Allocator,
+    entries: std.ArrayList(u8) = .{},
+    documents: std.ArrayList(u8) = .{},
+    entry_count: u32 = 0,
+    document_count: u32 = 0,
+    first_sequence: u64,
+    last_sequence: u64,
+
+    /// An empty shipment starting at `first_sequence`
+    pub fn init(allocator: std.mem.Allocator, first_sequence: u64) Builder {
+        return .{
+            .allocator = allocator,
+            .first_sequence = first_sequence,
+            .last_sequence = first_sequence - 1,
+        };
+    }
+
+    pub fn deinit(self: *Builder) void {
+        self.entries.deinit(self.allocator);
+        self.documents.deinit(self.allocator);
+    }
+
+    /// Raw body bytes so far
+    pub fn rawLen(self: *const Builder) usize {
+        return self.entries.items.len + self.documents.items.len;
+    }
+
+    /// Append the next entry, which must follow the last one
+    pub fn addEntry(self: *Builder, entry: JournalEntry) !void {
+        std.debug.assert(entry.header.sequence == self.last_sequence + 1);
+        if (self.rawLen() + entry.raw.len > MAX_SHIPMENT_BYTES) return error.ShipmentTooLarge;
+        try self.entries.appendSlice(self.allocator, entry.raw);
+        self.entry_count += 1;
+        self.last_sequence = entry.header.sequence;
+    }
+
+    /// Append the image of leader block `origin`
+    pub fn addDocument(self: *Builder, origin: u64, data: []const u8) !void {
+        if (self.rawLen() + DOCUMENT_HEADER_SIZE + data.len > MAX_SHIPMENT_BYTES) return error.ShipmentTooLarge;
+        var head: [DOCUMENT_HEADER_SIZE]u8 = undefined;
+        std.mem.writeInt(u64, head[0..8], origin, .little);
+        std.mem.writeInt(u32, head[8..12], @intCast(data.len), .little);
+        try self.documents.appendSlice(self.allocator, &head);
+        try self.documents.appendSlice(self.allocator, data);
+        self.document_count += 1;
+    }
+
+    /// Write the finished shipment to `out`. With SHIP_LZ4 the body is
+    /// compressed unless that would not make it smaller.
+    pub fn finish(self: *const Builder, flags: u16, out: *std.ArrayList(u8)) !void {
+        const raw_len = self.rawLen();
+        out.clearRetainingCapacity();
+        try out.ensureTotalCapacity(self.allocator, HEADER_SIZE + lz4.compressBound(raw_len));
+        out.appendNTimesAssumeCapacity(0, HEADER_SIZE);
+
+        var stored_flags: u16 = 0;
+        if (flags & SHIP_LZ4 != 0 and raw_len > 0) {
+            const raw = try self.allocator.alloc(u8, raw_len);
+            defer self.allocator.free(raw);
+            @memcpy(raw[0..self.entries.items.len], self.entries.items);
+            @memcpy(raw[self.entries.items.len..], self.documents.items);
+
+            const dst = out.allocatedSlice()[HEADER_SIZE..][0..lz4.compressBound(raw_len)];
+            const len = lz4.compress(raw, dst);
+            if (len < raw_len) {
+                out.items.len = HEADER_SIZE + len;
+                stored_flags = SHIP_LZ4;
+            }
+        }
+        if (stored_flags == 0) {
+            out.appendSliceAssumeCapacity(self.entries.items);
+            out.appendSliceAssumeCapacity(self.documents.items);
+        }
+
+        const header = Header{
+            .first_sequence = self.first_sequence,
+            .last_sequence = self.last_sequence,
+            .entry_count = self.entry_count,
+            .document_count = self.document_count,
+            .entries_len = @intCast(self.entries.items.len),
+            .raw_len = @intCast(raw_len),
+            .body_len = @intCast(out.items.len - HEADER_SIZE),
+            .flags = stored_flags,
+        };
+        const head = out.items[0..HEADER_SIZE];
+        header.write(head);
+        std.mem.writeInt(u32, head[CHECKSUM_OFFSET..][0..4], checksum(head, out.items[HEADER_SIZE..]), .little);
+    }
+};
+
+// ============================================================
+// Follower: reading shipments
+// ============================================================
+
+pub const Document = struct {
+    origin: u64,
+    data: []const u8,
+};
+
+/// A verified shipment. Slices borrow from the input or, for compressed
+/// shipments, from the buffer passed to `parse`.
+pub const Shipment = struct {
+    header: Header,
+    entries: []const u8,
+    documents: []const u8,
+
+    /// Check the header and checksum and decompress the body into `raw`
+    /// if needed. Entry checksums are verified as they are iterated.
+    pub fn parse(allocator: std.mem.Allocator, bytes: []const u8, raw: *std.ArrayList(u8)) !Shipment {
+        if (bytes.len < HEADER_SIZE) return error.InvalidShipment;
+        const head = bytes[0..HEADER_SIZE];
+        const header = try Header.read(head);
+        if (header.body_len != bytes.len - HEADER_SIZE) return error.InvalidShipment;
+        if (header.entries_len > header.raw_len) return error.InvalidShipment;
+        // Untrusted: last_sequence + 1 - first_sequence must not wrap
+        const next = std.math.add(u64, header.last_sequence, 1) catch return error.InvalidShipment;
+        const span = std.math.sub(u64, next, header.first_sequence) catch return error.InvalidShipment;
+        if (span != header.entry_count) return error.InvalidShipment;
+
+        const body = bytes[HEADER_SIZE..];
+        const stored = std.mem.readInt(u32, head[CHECKSUM_OFFSET..][0..4], .little);
+        if (stored != checksum(head, body)) return error.ShipmentChecksumMismatch;
+
+        const plain: []const u8 = if (header.flags & SHIP_LZ4 != 0) blk: {
+            try raw.resize(allocator, header.raw_len);
+            const len = lz4.decompress(body, raw.items) catch return error.InvalidShipment;
+            if (len != header.raw_len) return error.InvalidShipment;
+            break :blk raw.items;
+        } else body;
+        if (plain.len != header.raw_len) return error.InvalidShipment;
+
+        return .{
+            .header = header,
+            .entries = plain[0..header.entries_len],
+            .documents = plain[header.entries_len..],
+        };
+    }
+
+    pub fn entryIterator(self: *const Shipment) JournalSegmentIterator {
+        return JournalSegmentIterator.fromPayload(self.entries);
+    }
+
+    pub fn documentIterator(self: *const Shipment) DocumentIterator {
+        return .{ .bytes = self.documents };
+    }
+};
+
+pub const DocumentIterator = struct {
+    bytes: []const u8,
+    pos: usize = 0,
+
+    pub fn next(self: *DocumentIterator) !?Document {
+        if (self.pos == self.bytes.len) return null;
+        const rest = self.bytes[self.pos..];
+        if (rest.len < DOCUMENT_HEADER_SIZE) return error.InvalidShipment;
+        const len = std.mem.readInt(u32, rest[8..12], .little);
+        if (len > rest.len - DOCUMENT_HEADER_SIZE or len > blocks.MAX_DOCUMENT_SIZE) return error.InvalidShipment;
+        self.pos += DOCUMENT_HEADER_SIZE + len;
+        return .{
+            .origin = std.mem.readInt(u64, rest[0..8], .little),
+            .data = rest[DOCUMENT_HEADER_SIZE..][0..len],
+        };
+    }
+};
+
+/// What a shipment leaves of one leader block
+pub const Change = struct {
+    origin: u64,
+    /// Current image; null when the block ends deleted, or when the
+    /// leader had already deleted it again by the time it was shipped
+    data: ?[]const u8,
+    deleted: bool,
+};
+
+/// The net change per leader block, in order of first mention, after
+/// checking that entries run first_sequence..last_sequence. Blocks
+/// written and deleted within the shipment still appear (deleted).
+pub fn netChanges(allocator: std.mem.Allocator, shipment: *const Shipment) ![]Change {
+    var changes: std.AutoArrayHashMapUnmanaged(u64, Change) = .{};
+    errdefer changes.deinit(allocator);
+
+    var expected = shipment.header.first_sequence;
+    var entries = shipment.entryIterator();
+    while (try entries.next()) |entry| {
+        if (entry.header.sequence != expected) return error.InvalidShipment;
+        expected = std.math.add(u64, expected, 1) catch return error.InvalidShipment;
+
+        switch (@as(JournalOp, @enumFromInt(entry.header.op_type))) {
+            .doc_insert, .doc_update => try mark(allocator, &changes, entry.header.affected_block, false),
+            .doc_delete => try mark(allocator, &changes, entry.header.affected_block, true),
+            .bulk_insert => {
+                const first = entry.header.affected_block;
+                const count = bulkCount(entry.forward);
+                _ = std.math.add(u64, first, count) catch return error.InvalidShipment;
+                for (0..count) |i| try mark(allocator, &changes, first + i, false);
+            },
+            else => {},
+        }
+    }
+    if (expected != shipment.header.last_sequence + 1) return error.InvalidShipment;
+
+    var documents = shipment.documentIterator();
+    while (try documents.next()) |doc| {
+        const change = changes.getPtr(doc.origin) orelse return error.InvalidShipment;
+        if (!change.deleted) change.data = doc.data;
+    }
+
+    const out = try allocator.dupe(Change, changes.values());
+    changes.deinit(allocator);
+    return out;
+}
+
+fn mark(allocator: std.mem.Allocator, changes: *std.AutoArrayHashMapUnmanaged(u64, Change), origin: u64, deleted: bool) !void {
+    const slot = try changes.getOrPut(allocator, origin);
+    slot.value_ptr.* = .{ .origin = origin, .data = null, .deleted = deleted };
+}
+
+/// Documents covered by a BULK_INSERT record "... count=N ..."
+pub fn bulkCount(forward: []const u8) u64 {
+    return wordValue(forward, "count=") orelse 0;
+}
+
+/// The number following `key` in a forward message, e.g. "origin="
+pub fn wordValue(forward: []const u8, key: []const u8) ?u64 {
+    var words = std.mem.tokenizeScalar(u8, forward, ' ');
+    while (words.next()) |word| {
+        if (std.mem.startsWith(u8, word, key)) return std.fmt.parseInt(u64, word[key.len..], 10) catch null;
+    }
+    return null;
+}
+
+// ============================================================
+// Follower: origin map and watermark
+// ============================================================
+
+/// Which local block holds each replicated leader block, and the last
+/// leader sequence applied. Loaded from the follower's journal on first
+/// use; the mutex also serializes appliers.
+pub const ReplicaMap = struct {
+    allocator: std.mem.Allocator,
+    mutex: std.Thread.Mutex = .{},
+    loaded: bool = false,
+    origins: std.AutoHashMapUnmanaged(u64, u64) = .{},
+    watermark: u64 = 0,
+
+    pub fn init(allocator: std.mem.Allocator) ReplicaMap {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(self: *ReplicaMap) void {
+        self.origins.deinit(self.allocator);
+    }
+
+    /// Replay the local journal's replicated records (caller holds mutex)
+    pub fn loadLocked(self: *ReplicaMap, storage: *blocks.BlockStorage) !void {
+        if (self.loaded) return;
+        self.origins.clearRetainingCapacity();
+        self.watermark = 0;
+
+        var reader = try journal.JournalReader.open(self.allocator, storage, 1);
+        defer reader.close();
+        while (try reader.next()) |entry| {
+            switch (@as(JournalOp, @enumFromInt(entry.header.op_type))) {
+                .doc_insert, .doc_update => if (wordValue(entry.forward, "origin=")) |origin| {
+                    try self.origins.put(self.allocator, origin, entry.header.affected_block);
+                },
+                .doc_delete => if (wordValue(entry.forward, "origin=")) |origin| {
+                    _ = self.origins.remove(origin);
+                },
+                .replica_mark => self.watermark = wordValue(entry.forward, "through=") orelse self.watermark,
+                else => {},
+            }
+        }
+        self.loaded = true;
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+fn testEntry(writer: *blocks.JournalSegmentWriter, op: JournalOp, block: u64, forward: []const u8, sequence: u64) !void {
+    try writer.append(sequence, .{ .op = op, .affected_block = block, .forward = forward });
+}
+
+test "shipments round-trip with and without compression" {
+    const allocator = std.testing.allocator;
+
+    var writer = blocks.JournalSegmentWriter{};
+    try testEntry(&writer, .doc_insert, 40, "INSERT block_id=40 size=11", 7);
+    try testEntry(&writer, .doc_update, 40, "UPDATE block_id=40 size=11", 8);
+    try testEntry(&writer, .doc_insert, 41, "INSERT block_id=41 size=11", 9);
+    try testEntry(&writer, .doc_delete, 41, "DELETE block_id=41", 10);
+
+    var builder = Builder.init(allocator, 7);
+    defer builder.deinit();
+    var segment = JournalSegmentIterator.fromPayload(writer.payload());
+    while (try segment.next()) |entry| try builder.addEntry(entry);
+    try builder.addDocument(40, "{\"v\":\"two\"}");
+
+    for ([_]u16{ 0, SHIP_LZ4 }) |flags| {
+        var out: std.ArrayList(u8) = .{};
+        defer out.deinit(allocator);
+        try builder.finish(flags, &out);
+
+        var raw: std.ArrayList(u8) = .{};
+        defer raw.deinit(allocator);
+        const shipment = try Shipment.parse(allocator, out.items, &raw);
+        try std.testing.expectEqual(@as(u64, 7), shipment.header.first_sequence);
+        try std.testing.expectEqual(@as(u64, 10), shipment.header.last_sequence);
+
+        const changes = try netChanges(allocator, &shipment);
+        defer allocator.free(changes);
+        try std.testing.expectEqual(@as(usize, 2), changes.len);
+        try std.testing.expectEqual(@as(u64, 40), changes[0].origin);
+        try std.testing.expectEqualStrings("{\"v\":\"two\"}", changes[0].data.?);
+        try std.testing.expect(changes[1].deleted);
+
+        // A flipped bit anywhere is caught
+        out.items[out.items.len - 1] ^= 0x01;
+        try std.testing.expectError(error.ShipmentChecksumMismatch, Shipment.parse(allocator, out.items, &raw));
+    }
+}
+
+test "an empty shipment names the next sequence" {
+    const allocator = std.testing.allocator;
+    var builder = Builder.init(allocator, 12);
+    defer builder.deinit();
+
+    var out: std.ArrayList(u8) = .{};
+    defer out.deinit(allocator);
+    try builder.finish(SHIP_LZ4, &out);
+    try std.testing.expectEqual(HEADER_SIZE, out.items.len);
+
+    var raw: std.ArrayList(u8) = .{};
+    defer raw.deinit(allocator);
+    const shipment = try Shipment.parse(allocator, out.items, &raw);
+    try std.testing.expectEqual(@as(u32, 0), shipment.header.entry_count);
+    try std.testing.expectEqual(@as(u64, 11), shipment.header.last_sequence);
+}
+
+test "crafted header sequences are rejected, never wrapped" {
+    const allocator = std.testing.allocator;
+    var builder = Builder.init(allocator, 12);
+    defer builder.deinit();
+
+    var out: std.ArrayList(u8) = .{};
+    defer out.deinit(allocator);
+    try builder.finish(0, &out);
+    var raw: std.ArrayList(u8) = .{};
+    defer raw.deinit(allocator);
+
+    const max = std.math.maxInt(u64);
+    const edges = [_]u64{ 0, 1, 11, 12, max - 1, max };
+    var prng = std.Random.DefaultPrng.init(0x5eed);
+    const random = prng.random();
+    const head = out.items[0..HEADER_SIZE];
+    for (0..1024) |i| {
+        var header = try Header.read(head);
+        header.first_sequence = if (i % 2 == 0) edges[random.uintLessThan(usize, edges.len)] else random.int(u64);
+        header.last_sequence = if (i % 3 == 0) random.int(u64) else edges[random.uintLessThan(usize, edges.len)];
+        header.entry_count = if (i % 5 == 0) random.int(u32) else random.uintLessThan(u32, 2);
+        header.write(head);
+        std.mem.writeInt(u32, head[CHECKSUM_OFFSET..][0..4], checksum(head, out.items[HEADER_SIZE..]), .little);
+
+        // Only an empty run (last = first - 1) fits this empty body
+        if (Shipment.parse(allocator, out.items, &raw)) |shipment| {
+            try std.testing.expectEqual(@as(u32, 0), shipment.header.entry_count);
+            try std.testing.expectEqual(shipment.header.first_sequence, shipment.header.last_sequence + 1);
+            const changes = try netChanges(allocator, &shipment);
+            allocator.free(changes);
+        } else |err| {
+            try std.testing.expectEqual(error.InvalidShipment, err);
+        }
+    }
+
+    var header = try Header.read(head);
+    header.first_sequence = 1;
+    header.last_sequence = max;
+    header.write(head);
+    std.mem.writeInt(u32, head[CHECKSUM_OFFSET..][0..4], checksum(head, out.items[HEADER_SIZE..]), .little);
+    try std.testing.expectError(error.InvalidShipment, Shipment.parse(allocator, out.items, &raw));
+}
@@ -0,0 +1,395 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Scrubbing - Background Checksum Verification
+//
+// Reads only check the blocks they touch, so a block nobody reads can rot
+// unnoticed. The scrubber walks the whole file instead: workers claim
+// EXTENT_BLOCKS consecutive blocks at a time, read each extent with one
+// pread and check every block's CRC32C (crc32c.zig picks the hardware
+// kernel). Extents are claimed in file order, so the workers together
+// stream the file front to back.
+//
+// A background pass is paced by a byte budget shared by every worker and
+// walks the file in windows of CHECKPOINT_BLOCKS. Each finished window
+// moves the checkpoint in the superblock, so a restart resumes the pass
+// where the last window ended. Corrupted block IDs go to the scrub
+// section of fdb_stats; fdb_verify_checksums runs one pass at full speed
+// and returns them.
+//
+// A block that fails is read again on its own and only reported when the
+// second read returns the same bytes: a block rewritten in place while the
+// extent was being read fails transiently and is checked on the next pass.
+// All-zero blocks were reserved but never written and are skipped.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const builtin = @import("builtin");
+const blocks = @import("blocks.zig");
+
+const BLOCK_SIZE = blocks.BLOCK_SIZE;
+
+/// Blocks per read: 1 MiB
+pub const EXTENT_BLOCKS: usize = 256;
+
+/// Blocks between persisted checkpoints: 256 MiB, so the superblock
+/// write this costs is lost in the reads
+pub const CHECKPOINT_BLOCKS: u64 = 256 * EXTENT_BLOCKS;
+
+/// Most workers one scrubber uses, the pass's own thread included
+pub const MAX_WORKERS: u32 = 16;
+
+pub const Options = struct {
+    /// Background read budget in bytes per second; 0 scrubs only on
+    /// fdb_verify_checksums
+    bytes_per_sec: u64 = 0,
+    /// Workers per pass, the pass's own thread included
+    workers: u32 = 2,
+    /// Least time from the start of one background pass to the next
+    interval_ms: u64 = 24 * std.time.ms_per_hour,
+};
+
+/// Spaces reads out to a byte rate. Each read reserves the next free slot
+/// of the schedule and waits for it to start; time left idle is not
+/// saved up, so the scrubber never bursts above the rate.
+pub const RateLimiter = struct {
+    bytes_per_sec: u64,
+    timer: ?std.time.Timer,
+    mutex: std.Thread.Mutex = .{},
+    next_ns: u64 = 0,
+
+    /// `bytes_per_sec` 0 never waits. Otherwise `timer` is null only when
+    /// no monotonic clock is available, and the limiter must not be used.
+    pub fn init(bytes_per_sec: u64) RateLimiter {
+        return .{
+            .bytes_per_sec = bytes_per_sec,
+            .timer = if (bytes_per_sec == 0) null else std.time.Timer.start() catch null,
+        };
+    }
+
+    /// Reserve a read of `bytes`; returns the nanoseconds to wait first
+    pub fn reserve(self: *RateLimiter, bytes: u64) u64 {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        const timer = if (self.timer) |*t| t else return 0;
+        const now = timer.read();
+        const start = @max(now, self.next_ns);
+        self.next_ns = start + bytes * std.time.ns_per_s / self.bytes_per_sec;
+        return start - now;
+    }
+};
+
+pub const Verdict = enum { ok, unwritten, corrupt };
+
+/// Check one block as stored on disk
+pub fn checkBlock(bytes: *const [BLOCK_SIZE]u8) Verdict {
+    _ = blocks.Block.fromBytes(bytes) catch {
+        if (std.mem.allEqual(u8, bytes, 0)) return .unwritten;
+        return .corrupt;
+    };
+    return .ok;
+}
+
+/// Corrupted block IDs found by one pass, in no particular order
+pub const Findings = struct {
+    allocator: std.mem.Allocator,
+    mutex: std.Thread.Mutex = .{},
+    ids: std.ArrayList(u64) = .{},
+    failed: bool = false,
+
+    pub fn init(allocator: std.mem.Allocator) Findings {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(self: *Findings) void {
+        self.ids.deinit(self.allocator);
+    }
+
+    fn add(self: *Findings, block_id: u64) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        self.ids.append(self.allocator, block_id) catch {
+            self.failed = true;
+        };
+    }
+};
+
+/// The scrubber of one open database: a background pass thread when a
+/// read budget is given, and the workers every pass shares
+pub const Scrubber = struct {
+    allocator: std.mem.Allocator,
+    storage: *blocks.BlockStorage,
+    options: Options,
+    limiter: RateLimiter,
+
+    thread: ?std.Thread = null,
+    workers: ?*std.Thread.Pool = null,
+    workers_failed: bool = false,
+
+    // Guards the fields below and wakes a waiting pass on stop
+    mutex: std.Thread.Mutex = .{},
+    cond: std.Thread.Condition = .{},
+    stopping: bool = false,
+
+    pub fn init(allocator: std.mem.Allocator, storage: *blocks.BlockStorage, options: Options) Scrubber {
+        var opts = options;
+        opts.workers = if (builtin.single_threaded) 1 else std.math.clamp(options.workers, 1, MAX_WORKERS);
+        return .{
+            .allocator = allocator,
+            .storage = storage,
+            .options = opts,
+            .limiter = RateLimiter.init(options.bytes_per_sec),
+        };
+    }
+
+    /// Stops the background pass (see `stop`) and the workers
+    pub fn deinit(self: *Scrubber) void {
+        self.stop();
+        if (self.workers) |pool| {
+            pool.deinit();
+            self.allocator.destroy(pool);
+        }
+        self.workers = null;
+    }
+
+    /// Start background scrubbing if a read budget was given. `self` must
+    /// not move until `stop`. Fails rather than scrub unpaced when there
+    /// is no clock to pace by.
+    pub fn start(self: *Scrubber) !void {
+        if (self.options.bytes_per_sec == 0 or builtin.single_threaded) return;
+        if (self.limiter.timer == null) return error.TimerUnsupported;
+        self.thread = try std.Thread.spawn(.{}, run, .{self});
+    }
+
+    /// End the background pass, leaving its checkpoint at the last
+    /// finished window
+    pub fn stop(self: *Scrubber) void {
+        const thread = self.thread orelse return;
+        self.mutex.lock();
+        self.stopping = true;
+        self.cond.broadcast();
+        self.mutex.unlock();
+        thread.join();
+        self.thread = null;
+    }
+
+    fn isStopping(self: *Scrubber) bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.stopping;
+    }
+
+    /// Sleep up to `ns`; true (and at once) if the scrubber is stopping
+    fn pause(self: *Scrubber, ns: u64) bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        var timer = std.time.Timer.start() catch return self.stopping;
+        while (!self.stopping) {
+            const elapsed = timer.read();
+            if (elapsed >= ns) return false;
+            self.cond.timedWait(&self.mutex, ns - elapsed) catch {};
+        }
+        return true;
+    }
+
+    /// Verify every block written so far at full speed, adding the
+    /// corrupted ones to `findings`
+    pub fn verifyAll(self: *Scrubber, findings: *Findings) !void {
+        var pass = Pass{ .scrubber = self, .paced = false, .findings = findings, .next = .init(0), .end = self.storage.blockCount() };
+        self.runPass(&pass);
+        if (!pass.finished() or findings.failed) return error.OutOfMemory;
+        _ = self.storage.stats.scrub.passes.fetchAdd(1, .monotonic);
+    }
+
+    /// The background loop: resume or begin a pass, walk it window by
+    /// window, then wait out the interval
+    fn run(self: *Scrubber) void {
+        const report = &self.storage.stats.scrub;
+        var checkpoint = self.storage.scrubCheckpoint();
+        report.last_pass_completed.store(checkpoint.pass_completed, .monotonic);
+
+        while (true) {
+            const now: u64 = @intCast(@max(0, std.time.milliTimestamp()));
+            if (!checkpoint.active) {
+                const due = checkpoint.pass_started +| self.options.interval_ms;
+                if (checkpoint.pass_started != 0 and now < due) {
+                    if (self.pause((due - now) *| std.time.ns_per_ms)) return;
+                    continue;
+                }
+                checkpoint = .{ .active = true, .next = 0, .pass_started = now, .pass_completed = checkpoint.pass_completed };
+            }
+
+            const end = self.storage.blockCount();
+            if (checkpoint.next >= end) {
+                checkpoint = .{ .pass_started = checkpoint.pass_started, .pass_completed = now };
+                report.last_pass_completed.store(now, .monotonic);
+                _ = report.passes.fetchAdd(1, .monotonic);
+            } else {
+                const window_end = @min(end, checkpoint.next + CHECKPOINT_BLOCKS);
+                var pass = Pass{ .scrubber = self, .paced = true, .findings = null, .next = .init(checkpoint.next), .end = window_end };
+                self.runPass(&pass);
+                // Stopped part-way: the window is walked again on resume
+                if (self.isStopping()) return;
+                // No worker could get a buffer: try the window again later
+                if (!pass.finished()) {
+                    if (self.pause(std.time.ns_per_s)) return;
+                    continue;
+                }
+                checkpoint.next = window_end;
+            }
+            report.position.store(checkpoint.next, .monotonic);
+
+            // A checkpoint that did not persist is carried by the next one
+            self.storage.saveScrubCheckpoint(checkpoint) catch {};
+            if (self.isStopping()) return;
+        }
+    }
+
+    /// Walk [pass.next, pass.end) on this thread and the workers
+    fn runPass(self: *Scrubber, pass: *Pass) void {
+        const extents = std.math.divCeil(u64, pass.end -| pass.next.load(.monotonic), EXTENT_BLOCKS) catch unreachable;
+        const helpers: usize = @intCast(@min(self.options.workers - 1, extents -| 1));
+        const pool = (if (helpers > 0) self.startedWorkers() else null) orelse {
+            pass.work();
+            return;
+        };
+
+        var wg: std.Thread.WaitGroup = .{};
+        for (0..helpers) |_| pool.spawnWg(&wg, Pass.work, .{pass});
+        pass.work();
+        pool.waitAndWork(&wg);
+    }
+
+    /// The worker pool, started on first use; null when threads cannot be
+    /// started, in which case passes run on one thread
+    fn startedWorkers(self: *Scrubber) ?*std.Thread.Pool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (self.workers != null or self.workers_failed) return self.workers;
+
+        const pool = self.allocator.create(std.Thread.Pool) catch {
+            self.workers_failed = true;
+            return null;
+        };
+        pool.init(.{ .allocator = self.allocator, .n_jobs = self.options.workers - 1 }) catch {
+            self.allocator.destroy(pool);
+            self.workers_failed = true;
+            return null;
+        };
+        self.workers = pool;
+        return pool;
+    }
+};
+
+/// One walk over a block range. Workers claim extents from `next` until
+/// it passes `end`.
+const Pass = struct {
+    scrubber: *Scrubber,
+    /// Held to the background read budget
+    paced: bool,
+    /// Where corrupted IDs go besides the report
+    findings: ?*Findings,
+    next: std.atomic.Value(u64),
+    end: u64,
+
+    /// Whether every extent was claimed. Claimed extents are verified
+    /// unless the scrubber stopped; a worker without a buffer claims none.
+    fn finished(self: *Pass) bool {
+        return self.next.load(.monotonic) >= self.end;
+    }
+
+    fn work(self: *Pass) void {
+        const buf = self.scrubber.allocator.alloc(u8, EXTENT_BLOCKS * BLOCK_SIZE) catch return;
+        defer self.scrubber.allocator.free(buf);
+        while (true) {
+            const first = self.next.fetchAdd(EXTENT_BLOCKS, .monotonic);
+            if (first >= self.end) return;
+            const count: usize = @intCast(@min(EXTENT_BLOCKS, self.end - first));
+
+            if (self.paced) {
+                const wait = self.scrubber.limiter.reserve(count * BLOCK_SIZE);
+                if (wait > 0 and self.scrubber.pause(wait)) return;
+            } else if (self.scrubber.isStopping()) return;
+
+            self.verifyExtent(first, buf[0 .. count * BLOCK_SIZE]);
+        }
+    }
+
+    fn verifyExtent(self: *Pass, first: u64, buf: []u8) void {
+        const storage = self.scrubber.storage;
+        const report = &storage.stats.scrub;
+
+        // An unreadable extent is retried block by block, so one bad
+        // sector condemns only its own block
+        const got = storage.readRawBlocks(first, buf) catch 0;
+        _ = report.bytes_read.fetchAdd(got, .monotonic);
+        const whole = got / BLOCK_SIZE;
+
+        var i: usize = 0;
+        while (i < buf.len / BLOCK_SIZE) : (i += 1) {
+            const block_id = first + i;
+            const bytes: *[BLOCK_SIZE]u8 = buf[i * BLOCK_SIZE ..][0..BLOCK_SIZE];
+            if (i >= whole) {
+                // Past the end of the file, or the extent read failed
+                var single: [BLOCK_SIZE]u8 = undefined;
+                const n = storage.readRawBlocks(block_id, &single) catch {
+                    self.corrupt(block_id);
+                    continue;
+                };
+                if (n < BLOCK_SIZE) return; // reserved IDs not yet written
+                @memcpy(bytes, &single);
+            }
+
+            _ = report.blocks_verified.fetchAdd(1, .monotonic);
+            if (checkBlock(bytes) != .corrupt) continue;
+            if (self.confirm(block_id, bytes)) self.corrupt(block_id);
+        }
+    }
+
+    /// Whether a failed block reads back the same on its own
+    fn confirm(self: *Pass, block_id: u64, first_read: *const [BLOCK_SIZE]u8) bool {
+        var again: [BLOCK_SIZE]u8 = undefined;
+        const n = self.scrubber.storage.readRawBlocks(block_id, &again) catch return true;
+        return n == BLOCK_SIZE and std.mem.eql(u8, &again, first_read);
+    }
+
+    fn corrupt(self: *Pass, block_id: u64) void {
+        self.scrubber.storage.stats.scrub.recordCorrupt(block_id);
+        if (self.findings) |findings| findings.add(block_id);
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "the limiter spaces reservations out at its rate" {
+    var limiter = RateLimiter.init(1024 * 1024);
+    try std.testing.expectEqual(@as(u64, 0), limiter.reserve(512 * 1024));
+    // The second half second is booked behind the first
+    const wait = limiter.reserve(512 * 1024);
+    try std.testing.expect(wait > 400 * std.time.ns_per_ms and wait <= 500 * std.time.ns_per_ms);
+
+    var unlimited = RateLimiter.init(0);
+    try std.testing.expectEqual(@as(u64, 0), unlimited.reserve(1 << 40));
+}
+
+test "a read budget without a clock refuses to start" {
+    var scrubber = Scrubber.init(std.testing.allocator, undefined, .{ .bytes_per_sec = 1024 * 1024 });
+    scrubber.limiter.timer = null;
+    if (!builtin.single_threaded) try std.testing.expectError(error.TimerUnsupported, scrubber.start());
+    try std.testing.expect(scrubber.thread == null);
+    scrubber.deinit();
+}
+
+test "blocks are judged by header and checksum" {
+    var block = blocks.Block.init(.document, 5, 1);
+    try block.setPayload("{\"collection\":\"evidence\"}");
+    var bytes = block.toBytes();
+    try std.testing.expectEqual(Verdict.ok, checkBlock(&bytes));
+
+    bytes[blocks.HEADER_SIZE + 3] ^= 0x40;
+    try std.testing.expectEqual(Verdict.corrupt, checkBlock(&bytes));
+
+    const zeroes = [_]u8{0} ** BLOCK_SIZE;
+    try std.testing.expectEqual(Verdict.unwritten, checkBlock(&zeroes));
+}
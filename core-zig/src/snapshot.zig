@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Snapshots - Multi-Version Reads for Read-Only Transactions
+//
+// A snapshot is keyed on the superblock journal sequence at the moment it
+// was taken: it sees every block whose header sequence is <= that value.
+// Blocks are updated in place, so while a commit group runs the writer
+// preserves each pre-image here before overwriting it. Readers that find a
+// block newer than their snapshot look up the pre-image instead; readers
+// without one do the same at the published journal head, which the group
+// holds a view at until it publishes. Versions no active snapshot can see
+// are pruned after each commit group.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const blocks = @import("blocks.zig");
+
+const Block = blocks.Block;
+
+/// Read view taken by fdb_txn_begin(LG_TXN_READ_ONLY)
+pub const Snapshot = struct {
+    /// Last journal sequence visible to this snapshot
+    sequence: u64,
+    /// Blocks at or beyond this ID did not exist when the snapshot was taken
+    block_count: u64,
+};
+
+const Version = struct {
+    block: Block,
+    /// Sequence of the commit that replaced this version
+    superseded_at: u64,
+};
+
+pub const VersionStore = struct {
+    allocator: std.mem.Allocator,
+    mutex: std.Thread.Mutex = .{},
+
+    // Active snapshot sequence -> reader count
+    readers: std.AutoHashMapUnmanaged(u64, u32) = .{},
+    versions: std.AutoHashMapUnmanaged(u64, std.ArrayList(Version)) = .{},
+
+    pub fn init(allocator: std.mem.Allocator) VersionStore {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(self: *VersionStore) void {
+        var it = self.versions.valueIterator();
+        while (it.next()) |list| list.deinit(self.allocator);
+        self.versions.deinit(self.allocator);
+        self.readers.deinit(self.allocator);
+    }
+
+    /// Register a reader at `sequence`. The caller must read `sequence`
+    /// while holding `mutex` (see BlockStorage.beginSnapshot) so the
+    /// registration cannot race a prune.
+    pub fn registerLocked(self: *VersionStore, sequence: u64) !void {
+        const entry = try self.readers.getOrPut(self.allocator, sequence);
+        if (entry.found_existing) {
+            entry.value_ptr.* += 1;
+        } else {
+            entry.value_ptr.* = 1;
+        }
+    }
+
+    pub fn release(self: *VersionStore, sequence: u64) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        if (self.readers.getPtr(sequence)) |count| {
+            count.* -= 1;
+            if (count.* == 0) _ = self.readers.remove(sequence);
+        }
+        self.pruneLocked();
+    }
+
+    /// Keep `block` readable for snapshots older than `superseded_at`
+    pub fn preserve(self: *VersionStore, block: *const Block, superseded_at: u64) !void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        const entry = try self.versions.getOrPut(self.allocator, block.header.block_id);
+        if (!entry.found_existing) entry.value_ptr.* = .{};
+        try entry.value_ptr.append(self.allocator, .{
+            .block = block.*,
+            .superseded_at = superseded_at,
+        });
+    }
+
+    /// Copy the version of `block_id` visible at `sequence` into `out`
+    pub fn find(self: *VersionStore, block_id: u64, sequence: u64, out: *Block) bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        const list = self.versions.getPtr(block_id) orelse return false;
+        var best: ?*const Version = null;
+        for (list.items) |*v| {
+            if (v.block.header.sequence > sequence or v.superseded_at <= sequence) continue;
+            if (best == null or v.block.header.sequence > best.?.block.header.sequence) best = v;
+        }
+        const found = best orelse return false;
+        out.* = found.block;
+        return true;
+    }
+
+    /// Append IDs in [from, limit) that have a preserved `block_type` version
+    pub fn collectIds(
+        self: *VersionStore,
+        allocator: std.mem.Allocator,
+        block_type: u16,
+        from: u64,
+        limit: u64,
+        out: *std.ArrayList(u64),
+    ) !void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        var it = self.versions.iterator();
+        while (it.next()) |entry| {
+            const id = entry.key_ptr.*;
+            if (id < from or id >= limit) continue;
+            for (entry.value_ptr.items) |v| {
+                if (v.block.header.block_type != block_type) continue;
+                try out.append(allocator, id);
+                break;
+            }
+        }
+    }
+
+    /// Drop versions that no registered reader can still see
+    pub fn prune(self: *VersionStore) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        self.pruneLocked();
+    }
+
+    pub fn activeReaders(self: *VersionStore) u32 {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        var total: u32 = 0;
+        var it = self.readers.valueIterator();
+        while (it.next()) |count| total += count.*;
+        return total;
+    }
+
+    fn pruneLocked(self: *VersionStore) void {
+        var oldest: ?u64 = null;
+        var rit = self.readers.keyIterator();
+        while (rit.next()) |seq| {
+            if (oldest == null or seq.* < oldest.?) oldest = seq.*;
+        }
+
+        const min_seq = oldest orelse {
+            var all = self.versions.valueIterator();
+            while (all.next()) |list| list.deinit(self.allocator);
+            self.versions.clearRetainingCapacity();
+            return;
+        };
+
+        var it = self.versions.valueIterator();
+        while (it.next()) |list| {
+            var kept: usize = 0;
+            for (list.items) |v| {
+                // A reader at S needs v while S < superseded_at
+                if (min_seq < v.superseded_at) {
+                    list.items[kept] = v;
+                    kept += 1;
+                }
+            }
+            list.shrinkRetainingCapacity(kept);
+        }
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+fn testVersion(block_id: u64, sequence: u64, tag: u8) Block {
+    var block = Block.init(.document, block_id, sequence);
+    block.setPayload(&[_]u8{tag}) catch unreachable;
+    return block;
+}
+
+test "reader sees the version current at its sequence" {
+    var store = VersionStore.init(std.testing.allocator);
+    defer store.deinit();
+
+    store.mutex.lock();
+    try store.registerLocked(5);
+    store.mutex.unlock();
+
+    // v1 written at 2, replaced at 6; v2 written at 6, replaced at 9
+    const v1 = testVersion(42, 2, '1');
+    const v2 = testVersion(42, 6, '2');
+    try store.preserve(&v1, 6);
+    try store.preserve(&v2, 9);
+
+    var out: Block = undefined;
+    try std.testing.expect(store.find(42, 5, &out));
+    try std.testing.expectEqual(@as(u8, '1'), out.getPayload()[0]);
+    try std.testing.expect(store.find(42, 7, &out));
+    try std.testing.expectEqual(@as(u8, '2'), out.getPayload()[0]);
+    try std.testing.expect(!store.find(42, 1, &out));
+}
+
+test "versions are pruned once no reader needs them" {
+    var store = VersionStore.init(std.testing.allocator);
+    defer store.deinit();
+
+    store.mutex.lock();
+    try store.registerLocked(5);
+    store.mutex.unlock();
+
+    const v1 = testVersion(7, 2, 'a');
+    try store.preserve(&v1, 6);
+    store.prune();
+
+    var out: Block = undefined;
+    try std.testing.expect(store.find(7, 5, &out));
+
+    store.release(5);
+    try std.testing.expectEqual(@as(u32, 0), store.activeReaders());
+    try std.testing.expect(!store.find(7, 5, &out));
+}
@@ -0,0 +1,641 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Spatial Index - STR-Packed R-tree Blocks
+//
+// A spatial index over one collection's location field is an R-tree packed bottom-up
+// with Sort-Tile-Recursive: points are sorted into vertical slabs by
+// longitude, each slab by latitude, and cut into full nodes; the node
+// rectangles are packed the same way until one node remains. Every node
+// is one SPATIAL_NODE block, and a tree's nodes occupy one contiguous
+// extent, leaves first and the root last.
+//
+//   SPATIAL_NODE payload
+//   0   2   level (0 = leaf)
+//   2   2   entry count (at most NODE_CAPACITY)
+//   4   4   reserved
+//   8   40  entries: min_x, min_y, max_x, max_y (f64), ref (u64)
+//
+// Leaf refs are document block IDs; inner refs are node block IDs.
+// x is longitude and y latitude, so a leaf entry is a point rectangle.
+//
+// One SPATIAL_META block per collection and field names the tree: root, extent, entry
+// count and the journal sequence it was packed at. Writes after that
+// sequence are not in the tree. Readers take them from the journal tail
+// (as fdb_export_columnar does), and a sync repacks from the old leaves
+// plus the tail, without reparsing documents that did not change. Old
+// trees are freed by the commit that installs the new one, so readers on
+// an older snapshot keep reading theirs through the version store.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const blocks = @import("blocks.zig");
+const cbor = @import("cbor.zig");
+const json_fields = @import("json_fields.zig");
+const query = @import("query.zig");
+
+const PAYLOAD_SIZE = blocks.PAYLOAD_SIZE;
+
+pub const NODE_HEADER_SIZE: usize = 8;
+pub const ENTRY_SIZE: usize = 40;
+
+/// Entries per node: as many as fill LG_BLOCK_PAYLOAD_SIZE
+pub const NODE_CAPACITY: usize = (PAYLOAD_SIZE - NODE_HEADER_SIZE) / ENTRY_SIZE;
+
+pub const META_MAGIC = "LGRTREE1";
+pub const META_HEADER_SIZE: usize = 56;
+/// Room for the collection name and field path together
+pub const MAX_NAME_LEN: usize = PAYLOAD_SIZE - META_HEADER_SIZE;
+
+pub const Rect = struct {
+    min_x: f64,
+    min_y: f64,
+    max_x: f64,
+    max_y: f64,
+
+    pub fn point(x: f64, y: f64) Rect {
+        return .{ .min_x = x, .min_y = y, .max_x = x, .max_y = y };
+    }
+
+    pub fn intersects(self: Rect, other: Rect) bool {
+        return self.min_x <= other.max_x and other.min_x <= self.max_x and
+            self.min_y <= other.max_y and other.min_y <= self.max_y;
+    }
+
+    fn merge(self: Rect, other: Rect) Rect {
+        return .{
+            .min_x = @min(self.min_x, other.min_x),
+            .min_y = @min(self.min_y, other.min_y),
+            .max_x = @max(self.max_x, other.max_x),
+            .max_y = @max(self.max_y, other.max_y),
+        };
+    }
+
+    /// Squared planar distance from (x, y) to the nearest point inside
+    pub fn distance2(self: Rect, x: f64, y: f64) f64 {
+        const dx = @max(self.min_x - x, 0, x - self.max_x);
+        const dy = @max(self.min_y - y, 0, y - self.max_y);
+        return dx * dx + dy * dy;
+    }
+};
+
+pub const Entry = struct {
+    rect: Rect,
+    ref: u64,
+};
+
+// ============================================================
+// Nodes
+// ============================================================
+
+/// A node payload as stored
+pub const Node = struct {
+    level: u16,
+    count: usize,
+    entries: []const u8,
+
+    pub fn parse(payload: []const u8) !Node {
+        if (payload.len < NODE_HEADER_SIZE) return error.InvalidSpatialNode;
+        const count = std.mem.readInt(u16, payload[2..4], .little);
+        if (count > NODE_CAPACITY or payload.len < NODE_HEADER_SIZE + count * ENTRY_SIZE) return error.InvalidSpatialNode;
+        return .{
+            .level = std.mem.readInt(u16, payload[0..2], .little),
+            .count = count,
+            .entries = payload[NODE_HEADER_SIZE..][0 .. count * ENTRY_SIZE],
+        };
+    }
+
+    pub fn entry(self: Node, index: usize) Entry {
+        const raw = self.entries[index * ENTRY_SIZE ..][0..ENTRY_SIZE];
+        return .{
+            .rect = .{
+                .min_x = readF64(raw[0..8]),
+                .min_y = readF64(raw[8..16]),
+                .max_x = readF64(raw[16..24]),
+                .max_y = readF64(raw[24..32]),
+            },
+            .ref = std.mem.readInt(u64, raw[32..40], .little),
+        };
+    }
+};
+
+fn readF64(raw: *const [8]u8) f64 {
+    return @bitCast(std.mem.readInt(u64, raw, .little));
+}
+
+fn writeF64(raw: *[8]u8, value: f64) void {
+    std.mem.writeInt(u64, raw, @bitCast(value), .little);
+}
+
+/// Write a node into `dst`; returns the payload length
+fn writeNode(dst: *[PAYLOAD_SIZE]u8, level: u16, entries: []const Entry) usize {
+    std.mem.writeInt(u16, dst[0..2], level, .little);
+    std.mem.writeInt(u16, dst[2..4], @intCast(entries.len), .little);
+    @memset(dst[4..8], 0);
+    for (entries, 0..) |e, i| {
+        const raw = dst[NODE_HEADER_SIZE + i * ENTRY_SIZE ..][0..ENTRY_SIZE];
+        writeF64(raw[0..8], e.rect.min_x);
+        writeF64(raw[8..16], e.rect.min_y);
+        writeF64(raw[16..24], e.rect.max_x);
+        writeF64(raw[24..32], e.rect.max_y);
+        std.mem.writeInt(u64, raw[32..40], e.ref, .little);
+    }
+    return NODE_HEADER_SIZE + entries.len * ENTRY_SIZE;
+}
+
+// ============================================================
+// STR packing
+// ============================================================
+
+/// Nodes in a packed tree over `entries` points (0 for none)
+pub fn nodeCount(entries: usize) usize {
+    if (entries == 0) return 0;
+    var total: usize = 0;
+    var level = entries;
+    while (true) {
+        level = std.math.divCeil(usize, level, NODE_CAPACITY) catch unreachable;
+        total += level;
+        if (level == 1) return total;
+    }
+}
+
+/// Node payloads of a packed tree, node i destined for `first_id + i`
+pub const Packed = struct {
+    allocator: std.mem.Allocator,
+    buffer: [][PAYLOAD_SIZE]u8,
+    lens: []usize,
+    root: u64,
+    height: u16,
+
+    pub fn deinit(self: *Packed) void {
+        self.allocator.free(self.buffer);
+        self.allocator.free(self.lens);
+    }
+
+    pub fn count(self: *const Packed) usize {
+        return self.lens.len;
+    }
+
+    pub fn payload(self: *const Packed, index: usize) []const u8 {
+        return self.buffer[index][0..self.lens[index]];
+    }
+};
+
+/// Pack `entries` (reordered in place) into nodes numbered from
+/// `first_id`, which must start nodeCount(entries.len) free IDs
+pub fn pack(allocator: std.mem.Allocator, entries: []Entry, first_id: u64) !Packed {
+    const total = nodeCount(entries.len);
+    const buffer = try allocator.alloc([PAYLOAD_SIZE]u8, total);
+    errdefer allocator.free(buffer);
+    const lens = try allocator.alloc(usize, total);
+    errdefer allocator.free(lens);
+
+    var result = Packed{ .allocator = allocator, .buffer = buffer, .lens = lens, .root = 0, .height = 0 };
+    if (total == 0) return result;
+
+    // Parents of each level are packed in place: node i's entry is
+    // written only after node i's children, which start at i * CAPACITY
+    const parents = try allocator.alloc(Entry, std.math.divCeil(usize, entries.len, NODE_CAPACITY) catch unreachable);
+    defer allocator.free(parents);
+
+    var level_entries = entries;
+    var level: u16 = 0;
+    var next: usize = 0;
+    while (true) : (level += 1) {
+        sortTiles(level_entries);
+        const nodes = std.math.divCeil(usize, level_entries.len, NODE_CAPACITY) catch unreachable;
+        for (0..nodes) |i| {
+            const children = level_entries[i * NODE_CAPACITY .. @min(level_entries.len, (i + 1) * NODE_CAPACITY)];
+            var bounds = children[0].rect;
+            for (children[1..]) |child| bounds = bounds.merge(child.rect);
+
+            lens[next] = writeNode(&buffer[next], level, children);
+            parents[i] = .{ .rect = bounds, .ref = first_id + next };
+            next += 1;
+        }
+        if (nodes == 1) break;
+        level_entries = parents[0..nodes];
+    }
+
+    result.root = first_id + next - 1;
+    result.height = level + 1;
+    return result;
+}
+
+fn centerX(e: Entry) f64 {
+    return (e.rect.min_x + e.rect.max_x) / 2;
+}
+
+fn centerY(e: Entry) f64 {
+    return (e.rect.min_y + e.rect.max_y) / 2;
+}
+
+fn lessX(_: void, a: Entry, b: Entry) bool {
+    return centerX(a) < centerX(b);
+}
+
+fn lessY(_: void, a: Entry, b: Entry) bool {
+    return centerY(a) < centerY(b);
+}
+
+/// Sort-Tile-Recursive order: ceil(sqrt(nodes)) slabs by x, each by y
+fn sortTiles(entries: []Entry) void {
+    const nodes = std.math.divCeil(usize, entries.len, NODE_CAPACITY) catch unreachable;
+    const slabs: usize = @intFromFloat(@ceil(@sqrt(@as(f64, @floatFromInt(nodes)))));
+    const slab_len = slabs * NODE_CAPACITY;
+
+    std.mem.sort(Entry, entries, {}, lessX);
+    var start: usize = 0;
+    while (start < entries.len) : (start += slab_len) {
+        std.mem.sort(Entry, entries[start..@min(entries.len, start + slab_len)], {}, lessY);
+    }
+}
+
+// ============================================================
+// Queries
+// ============================================================
+
+/// Leaf entries of the tree under `root` that intersect `rect`.
+/// `source.read(block_id, scratch)` returns a node's payload, valid
+/// until the next read.
+pub fn search(allocator: std.mem.Allocator, source: anytype, root: u64, rect: Rect, out: *std.ArrayList(Entry)) !void {
+    if (root == 0) return;
+    var stack: std.ArrayList(u64) = .{};
+    defer stack.deinit(allocator);
+    try stack.append(allocator, root);
+
+    var scratch: [PAYLOAD_SIZE]u8 = undefined;
+    while (stack.pop()) |block_id| {
+        const node = try Node.parse(try source.read(block_id, &scratch));
+        for (0..node.count) |i| {
+            const e = node.entry(i);
+            if (!e.rect.intersects(rect)) continue;
+            if (node.level == 0) try out.append(allocator, e) else try stack.append(allocator, e.ref);
+        }
+    }
+}
+
+const Candidate = struct {
+    distance2: f64,
+    entry: Entry,
+    /// Whether `entry` points at a node to open rather than a leaf entry
+    node: bool,
+
+    fn order(_: void, a: Candidate, b: Candidate) std.math.Order {
+        return std.math.order(a.distance2, b.distance2);
+    }
+};
+
+/// The `k` leaf entries nearest (x, y) by planar distance, nearest
+/// first, leaving out those `skip(ref)` rejects
+pub fn nearest(
+    allocator: std.mem.Allocator,
+    source: anytype,
+    root: u64,
+    x: f64,
+    y: f64,
+    k: usize,
+    skip: anytype,
+    out: *std.ArrayList(Entry),
+) !void {
+    if (root == 0 or k == 0) return;
+    var queue = std.PriorityQueue(Candidate, void, Candidate.order).init(allocator, {});
+    defer queue.deinit();
+    try queue.add(.{ .distance2 = 0, .entry = .{ .rect = Rect.point(x, y), .ref = root }, .node = true });
+
+    var scratch: [PAYLOAD_SIZE]u8 = undefined;
+    var found: usize = 0;
+    while (queue.removeOrNull()) |candidate| {
+        if (!candidate.node) {
+            try out.append(allocator, candidate.entry);
+            found += 1;
+            if (found == k) return;
+            continue;
+        }
+        const node = try Node.parse(try source.read(candidate.entry.ref, &scratch));
+        for (0..node.count) |i| {
+            const e = node.entry(i);
+            if (node.level == 0 and skip.skip(e.ref)) continue;
+            try queue.add(.{ .distance2 = e.rect.distance2(x, y), .entry = e, .node = node.level != 0 });
+        }
+    }
+}
+
+/// Every leaf entry, in tree order, leaving out those `skip(ref)` rejects
+pub fn collectLeaves(allocator: std.mem.Allocator, source: anytype, root: u64, skip: anytype, out: *std.ArrayList(Entry)) !void {
+    if (root == 0) return;
+    var stack: std.ArrayList(u64) = .{};
+    defer stack.deinit(allocator);
+    try stack.append(allocator, root);
+
+    var scratch: [PAYLOAD_SIZE]u8 = undefined;
+    while (stack.pop()) |block_id| {
+        const node = try Node.parse(try source.read(block_id, &scratch));
+        for (0..node.count) |i| {
+            const e = node.entry(i);
+            if (node.level != 0) {
+                try stack.append(allocator, e.ref);
+            } else if (!skip.skip(e.ref)) {
+                try out.append(allocator, e);
+            }
+        }
+    }
+}
+
+// ============================================================
+// Meta block
+// ============================================================
+//
+//   0   8   magic "LGRTREE1"
+//   8   8   root node block (0: empty tree)
+//   16  8   first node block of the extent
+//   24  8   node count
+//   32  8   entry count
+//   40  8   journal sequence the tree was packed at
+//   48  2   height
+//   50  2   collection name length
+//   52  2   field path length
+//   54  2   reserved
+//   56      collection name, then field path (e.g. "location")
+
+pub const Meta = struct {
+    root: u64,
+    first_node: u64,
+    nodes: u64,
+    entries: u64,
+    through: u64,
+    height: u16,
+    /// Borrowed from the payload it was decoded from
+    collection: []const u8,
+    field: []const u8,
+
+    pub fn indexes(self: Meta, collection: []const u8, field: []const u8) bool {
+        return std.mem.eql(u8, self.collection, collection) and std.mem.eql(u8, self.field, field);
+    }
+
+    pub fn encode(self: Meta, dst: *[PAYLOAD_SIZE]u8) []const u8 {
+        std.debug.assert(self.collection.len + self.field.len <= MAX_NAME_LEN);
+        @memcpy(dst[0..8], META_MAGIC);
+        std.mem.writeInt(u64, dst[8..16], self.root, .little);
+        std.mem.writeInt(u64, dst[16..24], self.first_node, .little);
+        std.mem.writeInt(u64, dst[24..32], self.nodes, .little);
+        std.mem.writeInt(u64, dst[32..40], self.entries, .little);
+        std.mem.writeInt(u64, dst[40..48], self.through, .little);
+        std.mem.writeInt(u16, dst[48..50], self.height, .little);
+        std.mem.writeInt(u16, dst[50..52], @intCast(self.collection.len), .little);
+        std.mem.writeInt(u16, dst[52..54], @intCast(self.field.len), .little);
+        @memset(dst[54..56], 0);
+        const names = dst[META_HEADER_SIZE..];
+        @memcpy(names[0..self.collection.len], self.collection);
+        @memcpy(names[self.collection.len..][0..self.field.len], self.field);
+        return dst[0 .. META_HEADER_SIZE + self.collection.len + self.field.len];
+    }
+
+    pub fn decode(payload: []const u8) !Meta {
+        if (payload.len < META_HEADER_SIZE or !std.mem.eql(u8, payload[0..8], META_MAGIC)) return error.InvalidSpatialMeta;
+        const collection_len = std.mem.readInt(u16, payload[50..52], .little);
+        const field_len = std.mem.readInt(u16, payload[52..54], .little);
+        if (payload.len < META_HEADER_SIZE + collection_len + field_len) return error.InvalidSpatialMeta;
+        const names = payload[META_HEADER_SIZE..];
+        return .{
+            .root = std.mem.readInt(u64, payload[8..16], .little),
+            .first_node = std.mem.readInt(u64, payload[16..24], .little),
+            .nodes = std.mem.readInt(u64, payload[24..32], .little),
+            .entries = std.mem.readInt(u64, payload[32..40], .little),
+            .through = std.mem.readInt(u64, payload[40..48], .little),
+            .height = std.mem.readInt(u16, payload[48..50], .little),
+            .collection = names[0..collection_len],
+            .field = names[collection_len..][0..field_len],
+        };
+    }
+};
+
+// ============================================================
+// Locations
+// ============================================================
+
+/// Location of a document in `collection` (its "collection" member), or
+/// null when it is elsewhere or has no readable location. `scratch`
+/// holds an unescaped JSON collection name.
+pub fn documentLocation(
+    allocator: std.mem.Allocator,
+    data: []const u8,
+    collection: []const u8,
+    field: []const u8,
+    scratch: *std.ArrayList(u8),
+) !?[2]f64 {
+    const doc = query.Document.of(data) orelse return null;
+    const member = (doc.findPath("collection") catch return null) orelse return null;
+    const name = switch (doc.encoding) {
+        .json => blk: {
+            if (json_fields.kindOf(member) != .string) return null;
+            break :blk json_fields.stringContents(allocator, member, scratch) catch |err| switch (err) {
+                error.OutOfMemory => return err,
+                else => return null,
+            };
+        },
+        .cbor => blk: {
+            if (member.len == 0 or member[0] >> 5 != @intFromEnum(cbor.MajorType.text)) return null;
+            var decoder = rawDecoder(member);
+            break :blk decoder.decodeText() catch return null;
+        },
+    };
+    if (!std.mem.eql(u8, name, collection)) return null;
+    return locationOf(data, field);
+}
+
+/// Longitude and latitude stored at `field`, in the forms the geo
+/// service reads: {"lat":..,"lon":..} (or latitude, lng, longitude),
+/// [lon, lat], or GeoJSON {"coordinates":[lon, lat]}. JSON or CBOR.
+pub fn locationOf(data: []const u8, field: []const u8) ?[2]f64 {
+    const doc = query.Document.of(data) orelse return null;
+    const value = (doc.findPath(field) catch return null) orelse return null;
+    const location = query.Document{ .data = value, .encoding = doc.encoding };
+
+    switch (kindOf(location)) {
+        .object => {
+            const lat = memberNumber(location, &.{ "lat", "latitude" });
+            const lon = memberNumber(location, &.{ "lon", "lng", "longitude" });
+            if (lat != null and lon != null) return finite(.{ lon.?, lat.? });
+            const coordinates = (location.findPath("coordinates") catch return null) orelse return null;
+            return pairOf(.{ .data = coordinates, .encoding = doc.encoding });
+        },
+        .array => return pairOf(location),
+        .other => return null,
+    }
+}
+
+const Kind = enum { object, array, other };
+
+fn kindOf(value: query.Document) Kind {
+    if (value.data.len == 0) return .other;
+    switch (value.encoding) {
+        .json => return switch (json_fields.kindOf(value.data) orelse return .other) {
+            .object => .object,
+            .array => .array,
+            else => .other,
+        },
+        .cbor => return switch (value.data[0] >> 5) {
+            @intFromEnum(cbor.MajorType.map) => .object,
+            @intFromEnum(cbor.MajorType.array) => .array,
+            else => .other,
+        },
+    }
+}
+
+fn memberNumber(object: query.Document, names: []const []const u8) ?f64 {
+    for (names) |name| {
+        const raw = (object.findPath(name) catch return null) orelse continue;
+        return numberOf(.{ .data = raw, .encoding = object.encoding });
+    }
+    return null;
+}
+
+fn numberOf(value: query.Document) ?f64 {
+    switch (value.encoding) {
+        .json => {
+            if (json_fields.kindOf(value.data) != .number) return null;
+            return std.fmt.parseFloat(f64, value.data) catch null;
+        },
+        .cbor => {
+            var decoder = rawDecoder(value.data);
+            return decoder.decodeNumber() catch null;
+        },
+    }
+}
+
+/// [x, y] from a two-or-more element array
+fn pairOf(array: query.Document) ?[2]f64 {
+    var pair: [2]f64 = undefined;
+    switch (array.encoding) {
+        .json => {
+            var elements = json_fields.ElementIterator.init(array.data) catch return null;
+            for (&pair) |*n| {
+                const raw = (elements.next() catch return null) orelse return null;
+                n.* = numberOf(.{ .data = raw, .encoding = .json }) orelse return null;
+            }
+        },
+        .cbor => {
+            var decoder = rawDecoder(array.data);
+            const len = decoder.decodeArrayLen() catch return null;
+            if (len < 2) return null;
+            for (&pair) |*n| n.* = decoder.decodeNumber() catch return null;
+        },
+    }
+    return finite(pair);
+}
+
+fn finite(pair: [2]f64) ?[2]f64 {
+    if (!std.math.isFinite(pair[0]) or !std.math.isFinite(pair[1])) return null;
+    return pair;
+}
+
+/// Decoders over raw items only decode numbers, text and lengths, which
+/// never allocate
+fn rawDecoder(raw: []const u8) cbor.Decoder {
+    return .{ .data = raw, .pos = 0, .allocator = undefined };
+}
+
+// ============================================================
+// Tests
+// ============================================================
+
+/// Nodes held in a Packed tree, as the storage would return them
+const PackedSource = struct {
+    tree: *const Packed,
+    first_id: u64,
+
+    pub fn read(self: PackedSource, block_id: u64, scratch: *[PAYLOAD_SIZE]u8) ![]const u8 {
+        const p = self.tree.payload(block_id - self.first_id);
+        @memcpy(scratch[0..p.len], p);
+        return scratch[0..p.len];
+    }
+};
+
+const SkipNone = struct {
+    pub fn skip(_: SkipNone, _: u64) bool {
+        return false;
+    }
+};
+
+test "packed trees answer boxes and nearest neighbours like a scan" {
+    const allocator = std.testing.allocator;
+
+    // A 150 x 80 grid: 120 leaves under two inner nodes and the root
+    var points: std.ArrayList(Entry) = .{};
+    defer points.deinit(allocator);
+    for (0..150) |i| {
+        for (0..80) |j| {
+            const x = @as(f64, @floatFromInt(i)) * 0.5 - 20;
+            const y = @as(f64, @floatFromInt(j)) * 0.25 + 40;
+            try points.append(allocator, .{ .rect = Rect.point(x, y), .ref = 1000 + i * 80 + j });
+        }
+    }
+    const all = try allocator.dupe(Entry, points.items);
+    defer allocator.free(all);
+
+    const first_id: u64 = 500;
+    var tree = try pack(allocator, points.items, first_id);
+    defer tree.deinit();
+    try std.testing.expectEqual(nodeCount(all.len), tree.count());
+    try std.testing.expectEqual(@as(u16, 3), tree.height);
+    try std.testing.expectEqual(first_id + tree.count() - 1, tree.root);
+
+    const source = PackedSource{ .tree = &tree, .first_id = first_id };
+    const box = Rect{ .min_x = -3.2, .min_y = 41.1, .max_x = 4.9, .max_y = 44.0 };
+    var hits: std.ArrayList(Entry) = .{};
+    defer hits.deinit(allocator);
+    try search(allocator, source, tree.root, box, &hits);
+
+    var expected: usize = 0;
+    for (all) |e| expected += @intFromBool(e.rect.intersects(box));
+    try std.testing.expect(expected > 0);
+    try std.testing.expectEqual(expected, hits.items.len);
+
+    var near: std.ArrayList(Entry) = .{};
+    defer near.deinit(allocator);
+    try nearest(allocator, source, tree.root, 0.1, 45.01, 3, SkipNone{}, &near);
+    try std.testing.expectEqual(@as(usize, 3), near.items.len);
+    try std.testing.expectEqual(Rect.point(0, 45), near.items[0].rect);
+    try std.testing.expect(near.items[1].rect.distance2(0.1, 45.01) <= near.items[2].rect.distance2(0.1, 45.01));
+
+    var leaves: std.ArrayList(Entry) = .{};
+    defer leaves.deinit(allocator);
+    try collectLeaves(allocator, source, tree.root, SkipNone{}, &leaves);
+    try std.testing.expectEqual(all.len, leaves.items.len);
+}
+
+test "locations are read from objects, arrays and GeoJSON" {
+    const cases = [_][]const u8{
+        \\{"location":{"lat":51.5,"lon":-0.1}}
+        ,
+        \\{"location":{"latitude":51.5,"lng":-0.1}}
+        ,
+        \\{"location":[-0.1,51.5]}
+        ,
+        \\{"location":{"type":"Point","coordinates":[-0.1,51.5]}}
+        ,
+    };
+    for (cases) |doc| {
+        const at = locationOf(doc, "location").?;
+        try std.testing.expectEqual(@as(f64, -0.1), at[0]);
+        try std.testing.expectEqual(@as(f64, 51.5), at[1]);
+    }
+    try std.testing.expectEqual(@as(?[2]f64, null), locationOf("{\"location\":\"London\"}", "location"));
+    try std.testing.expectEqual(@as(?[2]f64, null), locationOf("{\"name\":\"x\"}", "location"));
+
+    var scratch: std.ArrayList(u8) = .{};
+    defer scratch.deinit(std.testing.allocator);
+    const placed = "{\"collection\":\"sites\",\"location\":[2.35,48.85]}";
+    try std.testing.expect((try documentLocation(std.testing.allocator, placed, "sites", "location", &scratch)) != null);
+    try std.testing.expectEqual(@as(?[2]f64, null), try documentLocation(std.testing.allocator, placed, "finds", "location", &scratch));
+}
+
+test "meta blocks round-trip" {
+    var buf: [PAYLOAD_SIZE]u8 = undefined;
+    const meta = Meta{ .root = 90, .first_node = 40, .nodes = 51, .entries = 5001, .through = 77, .height = 2, .collection = "sites", .field = "site.location" };
+    const decoded = try Meta.decode(meta.encode(&buf));
+    try std.testing.expectEqual(meta.root, decoded.root);
+    try std.testing.expectEqual(meta.through, decoded.through);
+    try std.testing.expectEqualStrings("sites", decoded.collection);
+    try std.testing.expectEqualStrings("site.location", decoded.field);
+}
@@ -0,0 +1,287 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+// Lithoglyph Engine Statistics - I/O Counters and Commit Phase Timings
+//
+// Every counter is a relaxed atomic bumped on the path it measures, so
+// keeping them costs one uncontended add per block or phase and readers
+// never take a lock. Commit phases are recorded by the group leader into
+// log2 histograms of microseconds:
+//
+//   bucket 0      under 1 us
+//   bucket i      [2^(i-1), 2^i) us
+//   last bucket   everything longer
+//
+// Counts only grow; rates come from the difference between two reads.
+//
+// Part of Lithoglyph: Stone-carved data for the ages.
+
+const std = @import("std");
+const buffer_pool = @import("buffer_pool.zig");
+
+const Counter = std.atomic.Value(u64);
+
+/// The flushGroup phases, in commit order
+pub const CommitPhase = enum {
+    /// Pack journal entries into segments
+    journal,
+    /// Separate segment write, now folded into block_write (kept so
+    /// reports keep their shape)
+    journal_write,
+    /// Stage data blocks in the pool, compressing and chaining documents
+    blocks,
+    /// Free deleted blocks
+    deletes,
+    /// Write back staged blocks, sync, write the superblock, sync
+    block_write,
+    /// Publish the new journal pointers and prune pre-images
+    publish,
+};
+
+const PHASE_COUNT = @typeInfo(CommitPhase).@"enum".fields.len;
+
+pub const HISTOGRAM_BUCKETS = 32;
+
+pub const Histogram = struct {
+    buckets: [HISTOGRAM_BUCKETS]Counter = [_]Counter{.init(0)} ** HISTOGRAM_BUCKETS,
+    count: Counter = .init(0),
+    total_ns: Counter = .init(0),
+    max_ns: Counter = .init(0),
+
+    pub fn record(self: *Histogram, ns: u64) void {
+        _ = self.buckets[bucketOf(ns)].fetchAdd(1, .monotonic);
+        _ = self.count.fetchAdd(1, .monotonic);
+        _ = self.total_ns.fetchAdd(ns, .monotonic);
+        _ = self.max_ns.fetchMax(ns, .monotonic);
+    }
+
+    fn bucketOf(ns: u64) usize {
+        const us = ns / std.time.ns_per_us;
+        if (us == 0) return 0;
+        return @min(HISTOGRAM_BUCKETS - 1, 64 - @as(usize, @clz(us)));
+    }
+
+    /// Upper bound in microseconds of the bucket holding quantile `q`
+    /// (the maximum for the open-ended last bucket); 0 when empty
+    pub fn quantileUs(self: *const Histogram, q: f64) u64 {
+        var counts: [HISTOGRAM_BUCKETS]u64 = undefined;
+        var total: u64 = 0;
+        for (&self.buckets, &counts) |*bucket, *n| {
+            n.* = bucket.load(.monotonic);
+            total += n.*;
+        }
+        if (total == 0) return 0;
+
+        const rank: u64 = @max(1, @as(u64, @intFromFloat(@ceil(q * @as(f64, @floatFromInt(total))))));
+        var seen: u64 = 0;
+        for (counts, 0..) |n, i| {
+            seen += n;
+            if (seen < rank) continue;
+            if (i + 1 < HISTOGRAM_BUCKETS) return @as(u64, 1) << @intCast(i);
+            break;
+        }
+        return self.max_ns.load(.monotonic) / std.time.ns_per_us;
+    }
+
+    /// {"count":N,"total_us":N,"max_us":N,"p50_us":N,"p99_us":N,"buckets":[...]}
+    /// with trailing empty buckets trimmed
+    pub fn appendJson(self: *const Histogram, allocator: std.mem.Allocator, out: *std.ArrayList(u8)) !void {
+        try out.print(allocator,
+            \\{{"count":{d},"total_us":{d},"max_us":{d},"p50_us":{d},"p99_us":{d},"buckets":[
+        , .{
+            self.count.load(.monotonic),
+            self.total_ns.load(.monotonic) / std.time.ns_per_us,
+            self.max_ns.load(.monotonic) / std.time.ns_per_us,
+            self.quantileUs(0.50),
+            self.quantileUs(0.99),
+        });
+        var used: usize = HISTOGRAM_BUCKETS;
+        while (used > 0 and self.buckets[used - 1].load(.monotonic) == 0) used -= 1;
+        for (self.buckets[0..used], 0..) |*bucket, i| {
+            if (i > 0) try out.append(allocator, ',');
+            try out.print(allocator, "{d}", .{bucket.load(.monotonic)});
+        }
+        try out.appendSlice(allocator, "]}");
+    }
+};
+
+/// Most corrupted block IDs a scrub report lists
+pub const SCRUB_REPORTED_MAX = 256;
+
+/// Progress and findings of checksum scrubbing (scrub.zig). The list of
+/// corrupted IDs is written under `mutex` and published through `reported`,
+/// so readers still take no lock.
+pub const ScrubStats = struct {
+    /// Full passes finished since open
+    passes: Counter = .init(0),
+    blocks_verified: Counter = .init(0),
+    bytes_read: Counter = .init(0),
+    /// Next block of the background pass in progress
+    position: Counter = .init(0),
+    /// Millisecond timestamp the last full pass ended (0: none yet)
+    last_pass_completed: Counter = .init(0),
+
+    mutex: std.Thread.Mutex = .{},
+    corrupted: [SCRUB_REPORTED_MAX]Counter = [_]Counter{.init(0)} ** SCRUB_REPORTED_MAX,
+    reported: std.atomic.Value(usize) = .init(0),
+    truncated: std.atomic.Value(bool) = .init(false),
+
+    /// Add a block that failed verification, once however often it fails
+    pub fn recordCorrupt(self: *ScrubStats, block_id: u64) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        const n = self.reported.load(.monotonic);
+        for (self.corrupted[0..n]) |*id| {
+            if (id.load(.monotonic) == block_id) return;
+        }
+        if (n == SCRUB_REPORTED_MAX) {
+            self.truncated.store(true, .monotonic);
+            return;
+        }
+        self.corrupted[n].store(block_id, .monotonic);
+        self.reported.store(n + 1, .release);
+    }
+
+    /// {"passes":N,...,"corrupted":[id,...],"corrupted_truncated":bool}
+    pub fn appendJson(self: *const ScrubStats, allocator: std.mem.Allocator, out: *std.ArrayList(u8)) !void {
+        try out.print(allocator,
+            \{{"passes":{d},"blocks_verified":{d},"bytes_read":{d},"position":{d},"last_pass_completed_ms":{d},"corrupted":[
+        , .{
+            self.passes.load(.monotonic),
+            self.blocks_verified.load(.monotonic),
+            self.bytes_read.load(.monotonic),
+            self.position.load(.monotonic),
+            self.last_pass_completed.load(.monotonic),
+        });
+        const n = self.reported.load(.acquire);
+        for (self.corrupted[0..n], 0..) |*id, i| {
+            if (i > 0) try out.append(allocator, ',');
+            try out.print(allocator, "{d}", .{id.load(.monotonic)});
+        }
+        try out.print(allocator, "],\"corrupted_truncated\":{}}}", .{self.truncated.load(.monotonic)});
+    }
+};
+
+pub const EngineStats = struct {
+    /// Blocks fetched from the file (pread or mapping), not the pool
+    blocks_read: Counter = .init(0),
+    blocks_written: Counter = .init(0),
+    bytes_written: Counter = .init(0),
+    syncs: Counter = .init(0),
+    /// Blocks read from the file whose checksum did not match
+    crc_failures: Counter = .init(0),
+    commit_groups: Counter = .init(0),
+    phases: [PHASE_COUNT]Histogram = [_]Histogram{.{}} ** PHASE_COUNT,
+    scrub: ScrubStats = .{},
+
+    pub fn recordPhase(self: *EngineStats, which: CommitPhase, ns: u64) void {
+        self.phases[@intFromEnum(which)].record(ns);
+    }
+
+    /// The fdb_stats document:
+    /// {"blocks_read":N,...,"cache":{"frames":N,"hits":N,"misses":N},
+    ///  "commit_phases":{"journal":{histogram},...},"scrub":{scrub report}}
+    pub fn appendJson(self: *const EngineStats, allocator: std.mem.Allocator, out: *std.ArrayList(u8), cache: buffer_pool.PoolStats) !void {
+        try out.print(allocator,
+            \\{{"blocks_read":{d},"blocks_written":{d},"bytes_written":{d},"fsyncs":{d},"crc_failures":{d},"commit_groups":{d},"cache":{{"frames":{d},"hits":{d},"misses":{d}}},"commit_phases":{{
+        , .{
+            self.blocks_read.load(.monotonic),
+            self.blocks_written.load(.monotonic),
+            self.bytes_written.load(.monotonic),
+            self.syncs.load(.monotonic),
+            self.crc_failures.load(.monotonic),
+            self.commit_groups.load(.monotonic),
+            cache.frames,
+            cache.hits,
+            cache.misses,
+        });
+        inline for (@typeInfo(CommitPhase).@"enum".fields, 0..) |field, i| {
+            if (i > 0) try out.append(allocator, ',');
+            try out.appendSlice(allocator, "\"" ++ field.name ++ "\":");
+            try self.phases[i].appendJson(allocator, out);
+        }
+        try out.appendSlice(allocator, "},\"scrub\":");
+        try self.scrub.appendJson(allocator, out);
+        try out.append(allocator, '}');
+    }
+};
+
+/// Times one commit phase; `stop` records it and starts the next
+pub const PhaseTimer = struct {
+    stats: *EngineStats,
+    timer: ?std.time.Timer,
+
+    pub fn start(engine_stats: *EngineStats) PhaseTimer {
+        return .{ .stats = engine_stats, .timer = std.time.Timer.start() catch null };
+    }
+
+    pub fn stop(self: *PhaseTimer, which: CommitPhase) void {
+        if (self.timer) |*timer| self.stats.recordPhase(which, timer.lap());
+    }
+};
+
+// ============================================================
+// Tests
+// ============================================================
+
+test "histogram buckets by power of two microseconds" {
+    var h = Histogram{};
+    h.record(500); // under 1 us
+    h.record(3 * std.time.ns_per_us); // [2, 4)
+    h.record(3 * std.time.ns_per_us);
+    h.record(700 * std.time.ns_per_us); // [512, 1024)
+
+    try std.testing.expectEqual(@as(u64, 1), h.buckets[0].load(.monotonic));
+    try std.testing.expectEqual(@as(u64, 2), h.buckets[2].load(.monotonic));
+    try std.testing.expectEqual(@as(u64, 1), h.buckets[10].load(.monotonic));
+    try std.testing.expectEqual(@as(u64, 4), h.quantileUs(0.50));
+    try std.testing.expectEqual(@as(u64, 1024), h.quantileUs(0.99));
+    try std.testing.expectEqual(@as(u64, 700), h.max_ns.load(.monotonic) / std.time.ns_per_us);
+
+    // Longer than the last bound lands in the open bucket
+    h.record(std.math.maxInt(u64) / 2);
+    try std.testing.expectEqual(@as(u64, 1), h.buckets[HISTOGRAM_BUCKETS - 1].load(.monotonic));
+}
+
+test "stats render as one JSON document" {
+    const allocator = std.testing.allocator;
+    var stats = EngineStats{};
+    _ = stats.blocks_written.fetchAdd(3, .monotonic);
+    _ = stats.syncs.fetchAdd(2, .monotonic);
+    stats.recordPhase(.journal_write, 40 * std.time.ns_per_us);
+
+    var out: std.ArrayList(u8) = .{};
+    defer out.deinit(allocator);
+    try stats.appendJson(allocator, &out, .{ .frames = 8, .hits = 5, .misses = 1 });
+
+    const parsed = try std.json.parseFromSlice(std.json.Value, allocator, out.items, .{});
+    defer parsed.deinit();
+    const root = parsed.value.object;
+    try std.testing.expectEqual(@as(i64, 3), root.get("blocks_written").?.integer);
+    try std.testing.expectEqual(@as(i64, 2), root.get("fsyncs").?.integer);
+    try std.testing.expectEqual(@as(i64, 5), root.get("cache").?.object.get("hits").?.integer);
+
+    const phases = root.get("commit_phases").?.object;
+    try std.testing.expectEqual(@as(usize, 6), phases.count());
+    try std.testing.expectEqual(@as(i64, 1), phases.get("journal_write").?.object.get("count").?.integer);
+    try std.testing.expectEqual(@as(i64, 0), phases.get("publish").?.object.get("count").?.integer);
+    try std.testing.expectEqual(@as(usize, 0), root.get("scrub").?.object.get("corrupted").?.array.items.len);
+}
+
+test "scrub reports list each corrupted block once" {
+    const allocator = std.testing.allocator;
+    var scrub = ScrubStats{};
+    scrub.recordCorrupt(42);
+    scrub.recordCorrupt(7);
+    scrub.recordCorrupt(42);
+    _ = scrub.blocks_verified.fetchAdd(512, .monotonic);
+
+    var out: std.ArrayList(u8) = .{};
+    defer out.deinit(allocator);
+    try scrub.appendJson(allocator, &out);
+    try std.testing.expectEqualStrings(
+        \\{"passes":0,"blocks_verified":512,"bytes_read":0,"position":0,"last_pass_completed_ms":0,"corrupted":[42,7],"corrupted_truncated":false}
+    , out.items);
+
+    for (0..SCRUB_REPORTED_MAX) |i| scrub.recordCorrupt(1000 + i);
+    try std.testing.expectEqual(@as(usize, SCRUB_REPORTED_MAX), scrub.reported.load(.monotonic));
+    try std.testing.expect(scrub.truncated.load(.monotonic));
+}
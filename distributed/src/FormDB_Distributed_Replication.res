@@ -67,6 +67,15 @@ type replicaStatus = {
   lastSync: float,
 }
 
+/** Replica position in the leader's journal (segment shipping) */
+type watermarkStatus = {
+  nodeId: string,
+  watermark: float, // last leader journal sequence applied
+  lag: float, // journal entries behind the leader
+  isHealthy: bool,
+  lastSync: float,
+}
+
 /** Replication manager */
 type replicationManager = {
   config: replicationConfig,
@@ -74,6 +83,8 @@ type replicationManager = {
   mutable sequence: int,
   mutable pendingEvents: array<replicationEvent>,
   mutable replicaStatus: Js.Dict.t<replicaStatus>,
+  mutable journalHead: float,
+  mutable watermarks: Js.Dict.t<watermarkStatus>,
 }
 
 /** Create replication manager */
@@ -84,6 +95,8 @@ let make = (~config: replicationConfig=defaultConfig, ~nodeId: string): replicat
     sequence: 0,
     pendingEvents: [],
     replicaStatus: Js.Dict.empty(),
+    journalHead: 0.0,
+    watermarks: Js.Dict.empty(),
   }
 }
 
@@ -232,3 +245,161 @@ let eventToJson = (event: replicationEvent): Js.Json.t => {
   Js.Dict.set(obj, "sequenceNumber", Js.Json.number(Int.toFloat(event.sequenceNumber)))
   Js.Json.object_(obj)
 }
+
+/**
+ * Journal segment shipping
+ *
+ * Followers replicate in bulk through the engine: the leader reads
+ * shipments of raw journal entries with fdb_replication_read, followers
+ * apply each in one group commit with fdb_replication_apply, and
+ * acknowledge the leader sequence they have applied up to (their
+ * watermark). Sequences are u64 in the engine, kept here as floats
+ * (exact up to 2^53).
+ */
+
+/** Shipment header (generated/abi/bridge.h, fdb_replication_read) */
+type shipmentHeader = {
+  firstSequence: float,
+  lastSequence: float,
+  entryCount: int,
+  documentCount: int,
+  compressed: bool,
+}
+
+let shipmentHeaderSize = 56
+let shipmentMagic = "LGSHIP01"
+
+let byteAt = (bytes: Uint8Array.t, i: int): int => bytes->TypedArray.get(i)->Option.getOr(0)
+
+let readU16 = (bytes: Uint8Array.t, at: int): int => byteAt(bytes, at) + byteAt(bytes, at + 1) * 256
+
+let readU32 = (bytes: Uint8Array.t, at: int): float =>
+  Int.toFloat(readU16(bytes, at)) +. Int.toFloat(readU16(bytes, at + 2)) *. 65536.0
+
+let readU64 = (bytes: Uint8Array.t, at: int): float =>
+  readU32(bytes, at) +. readU32(bytes, at + 4) *. 4294967296.0
+
+/** Read a shipment's header; None if it is not a shipment */
+let parseShipmentHeader = (bytes: Uint8Array.t): option<shipmentHeader> => {
+  let hasMagic = ref(TypedArray.length(bytes) >= shipmentHeaderSize)
+  for i in 0 to String.length(shipmentMagic) - 1 {
+    if byteAt(bytes, i) != String.charCodeAt(shipmentMagic, i)->Float.toInt {
+      hasMagic := false
+    }
+  }
+
+  if hasMagic.contents {
+    Some({
+      firstSequence: readU64(bytes, 8),
+      lastSequence: readU64(bytes, 16),
+      entryCount: readU32(bytes, 24)->Float.toInt,
+      documentCount: readU32(bytes, 28)->Float.toInt,
+      compressed: land(readU16(bytes, 46), 1) == 1,
+    })
+  } else {
+    None
+  }
+}
+
+/** Record the leader's journal head, e.g. the last sequence shipped */
+let recordJournalHead = (manager: replicationManager, head: float): unit => {
+  if head > manager.journalHead {
+    manager.journalHead = head
+  }
+}
+
+/** Get a replica's watermark status */
+let getWatermark = (manager: replicationManager, nodeId: string): option<watermarkStatus> => {
+  Js.Dict.get(manager.watermarks, nodeId)
+}
+
+/** Sequence the next shipment to a replica starts from */
+let nextShipmentFrom = (manager: replicationManager, nodeId: string): float => {
+  switch getWatermark(manager, nodeId) {
+  | Some(status) => status.watermark +. 1.0
+  | None => 1.0
+  }
+}
+
+/** Acknowledge a replica's watermark (fdb_replication_apply output).
+ * Watermarks only move forward, so a late acknowledgement is harmless. */
+let acknowledgeWatermark = (
+  manager: replicationManager,
+  nodeId: string,
+  watermark: float,
+  isHealthy: bool,
+): unit => {
+  let current = switch getWatermark(manager, nodeId) {
+  | Some(status) => max(status.watermark, watermark)
+  | None => watermark
+  }
+  recordJournalHead(manager, current)
+  let status: watermarkStatus = {
+    nodeId,
+    watermark: current,
+    lag: manager.journalHead -. current,
+    isHealthy,
+    lastSync: Js.Date.now(),
+  }
+  Js.Dict.set(manager.watermarks, nodeId, status)
+}
+
+/** Replicas that have applied the leader's journal through `sequence` */
+let replicasThrough = (manager: replicationManager, sequence: float): int => {
+  Js.Dict.values(manager.watermarks)->Array.filter(s => s.watermark >= sequence)->Array.length
+}
+
+/** Whether enough replicas hold `sequence` for the write consistency level */
+let isSequenceReplicated = (manager: replicationManager, sequence: float): bool => {
+  isWriteSuccessful(manager, replicasThrough(manager, sequence))
+}
+
+/** Lowest watermark over all replicas: history every replica has applied */
+let minimumWatermark = (manager: replicationManager): option<float> => {
+  Js.Dict.values(manager.watermarks)->Array.reduce(None, (acc, s) =>
+    switch acc {
+    | Some(w) => Some(min(w, s.watermark))
+    | None => Some(s.watermark)
+    }
+  )
+}
+
+/** Replication lag by journal watermark */
+type watermarkLagStats = {
+  maxLag: float,
+  avgLag: float,
+  healthyReplicas: int,
+  totalReplicas: int,
+}
+
+let getWatermarkLagStats = (manager: replicationManager): watermarkLagStats => {
+  let statuses = Js.Dict.values(manager.watermarks)
+  let len = Array.length(statuses)
+
+  if len == 0 {
+    {maxLag: 0.0, avgLag: 0.0, healthyReplicas: 0, totalReplicas: 0}
+  } else {
+    let lagOf = (s: watermarkStatus) => manager.journalHead -. s.watermark
+    let maxLag = statuses->Array.map(lagOf)->Array.reduce(0.0, (a, b) => max(a, b))
+    let totalLag = statuses->Array.map(lagOf)->Array.reduce(0.0, (a, b) => a +. b)
+    let healthy = statuses->Array.filter(s => s.isHealthy)->Array.length
+
+    {
+      maxLag,
+      avgLag: totalLag /. Int.toFloat(len),
+      healthyReplicas: healthy,
+      totalReplicas: len,
+    }
+  }
+}
+
+/** Watermark acknowledgement to JSON */
+let watermarkToJson = (status: watermarkStatus): Js.Json.t => {
+  let obj = Js.Dict.empty()
+  Js.Dict.set(obj, "nodeId", Js.Json.string(status.nodeId))
+  Js.Dict.set(obj, "watermark", Js.Json.number(status.watermark))
+  Js.Dict.set(obj, "lag", Js.Json.number(status.lag))
+  Js.Dict.set(obj, "isHealthy", Js.Json.boolean(status.isHealthy))
+  Js.Dict.set(obj, "lastSync", Js.Json.number(status.lastSync))
+  Js.Json.object_(obj)
+}
@@ -21,8 +21,6 @@
 //   - Library-level init/cleanup lifecycle (not needed by core-zig)
 //   - Type adaptation between Idris2 ABI types and core-zig Lg* types
 //   - Collection-level operations (future, requires schema layer)
-//   - FQL query execution (future, requires Factor/Forth runtime)
-//   - Cursor-based result iteration (future, requires query engine)
 //   - Seam boundary tests for multi-language integration
 //
 // Symbol Export Strategy:
@@ -36,7 +34,6 @@
 const std = @import("std");
 const types = @import("types.zig");
 const cbor = @import("cbor.zig");
-const query_executor = @import("query_executor.zig");
 
 // Import core-zig bridge (the real storage engine implementation).
 // This module provides all the Lg* types and fdb_* functions.
@@ -53,6 +50,9 @@ pub const FdbDb = core_bridge.LgDb;
 /// Opaque transaction handle (delegates to core-zig LgTxn)
 pub const FdbTxn = core_bridge.LgTxn;
 
+/// Opaque cursor handle (delegates to core-zig LgCursor)
+pub const FdbCursor = core_bridge.LgCursor;
+
 /// Core-zig types re-exported for FFI layer consumers
 pub const LgBlob = core_bridge.LgBlob;
 pub const LgStatus = core_bridge.LgStatus;
@@ -79,7 +79,6 @@ pub const Status = enum(i32) {
 };
 
 // Opaque handle types for features not yet in core-zig
-pub const FdbCursor = opaque {};
 pub const FdbCollection = opaque {};
 pub const FdbSchema = opaque {};
 pub const FdbJournal = opaque {};
@@ -100,6 +99,7 @@ pub fn fromLgStatus(lg_status: core_bridge.LgStatus) i32 {
         .err_not_implemented => @intFromEnum(Status.internal_error),
         .err_txn_not_active => @intFromEnum(Status.invalid_arg),
         .err_txn_already_committed => @intFromEnum(Status.invalid_arg),
+        .err_conflict => @intFromEnum(Status.conflict),
     };
 }
 
@@ -109,7 +109,6 @@ pub fn fromLgStatus(lg_status: core_bridge.LgStatus) i32 {
 
 var initialized: bool = false;
 var gpa = std.heap.GeneralPurposeAllocator(.{}){};
-var global_executor: ?query_executor.SimpleExecutor = null;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Library Lifecycle
@@ -118,17 +117,12 @@ var global_executor: ?query_executor.SimpleExecutor = null;
 ////////////////////////////////////////////////////////////////////////////////
 
 /// Initialize FormBD library.
-/// Sets up the query executor and any global state needed by the FFI layer.
-/// The core-zig storage engine is initialized per-database via fdb_open.
+/// Sets up any global state needed by the FFI layer. The core-zig storage
+/// engine (and its query plan cache) is initialized per-database via
+/// fdb_open.
 export fn fdb_init() callconv(.c) i32 {
     if (initialized) return @intFromEnum(Status.ok);
 
-    // Initialize query executor (M5 implementation)
-    const allocator = gpa.allocator();
-    global_executor = query_executor.SimpleExecutor.init(allocator) catch {
-        return @intFromEnum(Status.out_of_memory);
-    };
-
     initialized = true;
     return @intFromEnum(Status.ok);
 }
@@ -138,11 +132,6 @@ export fn fdb_init() callconv(.c) i32 {
 export fn fdb_cleanup() callconv(.c) void {
     if (!initialized) return;
 
-    if (global_executor) |*executor| {
-        executor.deinit();
-        global_executor = null;
-    }
-
     _ = gpa.deinit();
     initialized = false;
 }
@@ -193,12 +182,6 @@ export fn fdb_open(
 export fn fdb_close(db: *FdbDb) callconv(.c) i32 {
     if (!initialized) return @intFromEnum(Status.internal_error);
 
-    // Clean up query executor if still active
-    if (global_executor) |*executor| {
-        executor.deinit();
-        global_executor = null;
-    }
-
     // Delegates to core-zig/src/bridge.zig fdb_db_close
     const status = core_bridge.fdb_db_close(db);
     return fromLgStatus(status);
@@ -302,6 +285,18 @@ export fn fdb_ffi_txn_commit(txn: *FdbTxn) callconv(.c) i32 {
     return fromLgStatus(status);
 }
 
+/// Queue a transaction for the writer pool; `callback` reports the result.
+/// Delegates to core-zig/src/bridge.zig fdb_txn_commit_async.
+pub fn ffiTxnCommitAsync(
+    txn: ?*FdbTxn,
+    callback: core_bridge.LgCommitCallback,
+    ctx: ?*anyopaque,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_txn_commit_async
+    return core_bridge.fdb_txn_commit_async(txn, callback, ctx, out_err);
+}
+
 /// Rollback transaction.
 /// Delegates to core-zig/src/bridge.zig fdb_txn_abort which discards all
 /// buffered operations (nothing written to disk yet due to WAL buffering).
@@ -334,6 +329,20 @@ pub fn ffiApply(
     return core_bridge.fdb_apply(txn, op_ptr, op_len);
 }
 
+/// Apply a batch of inserts with one contiguous block-ID extent.
+/// Delegates to core-zig/src/bridge.zig fdb_apply_batch.
+pub fn ffiApplyBatch(
+    txn: ?*FdbTxn,
+    ops: [*]const core_bridge.LgBlob,
+    count: usize,
+    flags: u32,
+    out_ids: [*]u64,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_apply_batch
+    return core_bridge.fdb_apply_batch(txn, ops, count, flags, out_ids, out_err);
+}
+
 /// Update an existing block within a transaction.
 /// Delegates to core-zig/src/bridge.zig fdb_update_block.
 pub fn ffiUpdateBlock(
@@ -370,6 +379,19 @@ pub fn ffiReadBlocks(
     return core_bridge.fdb_read_blocks(db, block_type, out_data, out_err);
 }
 
+/// Read all blocks of a given type as JSON or CBOR.
+/// Delegates to core-zig/src/bridge.zig fdb_read_blocks_format.
+pub fn ffiReadBlocksFormat(
+    db: ?*FdbDb,
+    block_type: u16,
+    opts: core_bridge.LgRenderOpts,
+    out_data: *core_bridge.LgBlob,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_read_blocks_format
+    return core_bridge.fdb_read_blocks_format(db, block_type, opts, out_data, out_err);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Introspection (Zig-level delegation wrappers)
 // Same pattern: `pub fn` wrappers to avoid symbol collision with core-zig.
@@ -401,6 +423,27 @@ pub fn ffiRenderJournal(
     return core_bridge.fdb_render_journal(db, since, opts, out_text, out_err);
 }
 
+/// Read journal entries from a sequence number into a caller buffer.
+/// Delegates to core-zig/src/bridge.zig fdb_journal_read.
+pub fn ffiJournalRead(
+    db: ?*FdbDb,
+    start_seq: u64,
+    count: u64,
+    buf: [*]u8,
+    buf_len: usize,
+    written: *usize,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_journal_read
+    return core_bridge.fdb_journal_read(db, start_seq, count, buf, buf_len, written);
+}
+
+/// Checkpoint the journal, compacting superseded segments.
+/// Delegates to core-zig/src/bridge.zig fdb_db_checkpoint.
+pub fn ffiDbCheckpoint(db: ?*FdbDb, out_err: *core_bridge.LgBlob) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_db_checkpoint
+    return core_bridge.fdb_db_checkpoint(db, out_err);
+}
+
 /// Get database schema information.
 /// Delegates to core-zig/src/bridge.zig fdb_introspect_schema.
 pub fn ffiIntrospectSchema(
@@ -423,6 +466,30 @@ pub fn ffiIntrospectConstraints(
     return core_bridge.fdb_introspect_constraints(db, out_constraints, out_err);
 }
 
+/// Get engine statistics (I/O counters and commit phase histograms).
+/// Delegates to core-zig/src/bridge.zig fdb_stats.
+pub fn ffiStats(
+    db: ?*FdbDb,
+    out_stats: *core_bridge.LgBlob,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_stats
+    return core_bridge.fdb_stats(db, out_stats, out_err);
+}
+
+/// Verify every block's checksum now, returning the corrupted block IDs.
+/// Delegates to core-zig/src/bridge.zig fdb_verify_checksums.
+pub fn ffiVerifyChecksums(
+    db: ?*FdbDb,
+    out_ids: ?[*]u64,
+    capacity: usize,
+    out_count: *usize,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_verify_checksums
+    return core_bridge.fdb_verify_checksums(db, out_ids, capacity, out_count, out_err);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Proof Verification (Zig-level delegation wrappers, D-NORM-004)
 // Same pattern: `pub fn` wrappers to avoid symbol collision with core-zig.
@@ -555,106 +622,201 @@ export fn fdb_collection_schema(
 
 ////////////////////////////////////////////////////////////////////////////////
 // FQL Query Execution
-// NOT YET IMPLEMENTED: requires Factor/Forth runtime for full query planning.
-// The SimpleExecutor provides hardcoded responses for M5 testing only.
+// Delegates to core-zig: plans are compiled, cached per database and run
+// inside the block scan by core-zig/src/query.zig. Declared as `pub fn`
+// because core-zig exports the symbols.
 ////////////////////////////////////////////////////////////////////////////////
 
-/// Execute FQL query with provenance.
-/// Partially implemented via SimpleExecutor (M5 hardcoded responses).
-/// NOT YET IMPLEMENTED: requires Factor runtime for real query planning,
-/// cursor creation from result sets, and provenance audit logging.
-export fn fdb_query_execute(
-    db: *FdbDb,
-    query_str: [*:0]const u8,
-    query_len: u64,
-    provenance_json: [*:0]const u8,
-    provenance_len: u64,
-    cursor_out: *?*FdbCursor,
-) callconv(.c) i32 {
-    if (!initialized) return @intFromEnum(Status.internal_error);
-    if (query_len == 0) return @intFromEnum(Status.invalid_arg);
-    if (query_len > 1_000_000) return @intFromEnum(Status.invalid_arg); // 1MB query limit
-    if (provenance_len == 0) return @intFromEnum(Status.invalid_arg);
+/// Execute an FQL query, returning its rows through a cursor.
+/// Delegates to core-zig/src/bridge.zig fdb_query_execute.
+pub fn ffiQueryExecute(
+    db: ?*FdbDb,
+    query_ptr: [*]const u8,
+    query_len: usize,
+    prov_ptr: ?[*]const u8,
+    prov_len: usize,
+    out_cursor: *?*FdbCursor,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_query_execute
+    return core_bridge.fdb_query_execute(db, query_ptr, query_len, prov_ptr, prov_len, out_cursor);
+}
 
-    _ = db;
-    _ = provenance_json; // NOT YET IMPLEMENTED: provenance audit logging
+/// Explain an FQL query: plan plus estimated and actual blocks read.
+/// Delegates to core-zig/src/bridge.zig fdb_query_explain.
+pub fn ffiQueryExplain(
+    db: ?*FdbDb,
+    query_ptr: [*]const u8,
+    query_len: usize,
+    buf: [*]u8,
+    buf_len: usize,
+    written: *usize,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_query_explain
+    return core_bridge.fdb_query_explain(db, query_ptr, query_len, buf, buf_len, written);
+}
 
-    // Get the global executor (M5 hardcoded responses)
-    if (global_executor) |*executor| {
-        const query = query_str[0..query_len];
+/// Export a collection as typed column batches, in full or since a
+/// journal sequence. Delegates to core-zig/src/bridge.zig
+/// fdb_export_columnar.
+pub fn ffiExportColumnar(
+    db: ?*FdbDb,
+    collection_ptr: [*]const u8,
+    collection_len: usize,
+    fields_ptr: [*]const u8,
+    fields_len: usize,
+    since_seq: u64,
+    out_batch: *core_bridge.LgBlob,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_export_columnar
+    return core_bridge.fdb_export_columnar(db, collection_ptr, collection_len, fields_ptr, fields_len, since_seq, out_batch, out_err);
+}
 
-        var result = executor.execute(query) catch {
-            return @intFromEnum(Status.internal_error);
-        };
-        defer result.deinit();
+/// Read a journal shipment for a follower from a sequence. Delegates to
+/// core-zig/src/bridge.zig fdb_replication_read.
+pub fn ffiReplicationRead(
+    db: ?*FdbDb,
+    from_seq: u64,
+    max_bytes: usize,
+    flags: u32,
+    out_shipment: *core_bridge.LgBlob,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_replication_read
+    return core_bridge.fdb_replication_read(db, from_seq, max_bytes, flags, out_shipment, out_err);
+}
 
-        // NOT YET IMPLEMENTED: create FdbCursor from result set
-        _ = cursor_out;
+/// Apply a journal shipment on a follower in one commit group. Delegates
+/// to core-zig/src/bridge.zig fdb_replication_apply.
+pub fn ffiReplicationApply(
+    db: ?*FdbDb,
+    shipment_ptr: [*]const u8,
+    shipment_len: usize,
+    out_watermark: *u64,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_replication_apply
+    return core_bridge.fdb_replication_apply(db, shipment_ptr, shipment_len, out_watermark, out_err);
+}
 
-        if (std.mem.eql(u8, result.status, "ok")) {
-            return @intFromEnum(Status.ok);
-        } else {
-            return @intFromEnum(Status.internal_error);
-        }
-    }
+/// Last leader sequence a follower has applied. Delegates to
+/// core-zig/src/bridge.zig fdb_replication_watermark.
+pub fn ffiReplicationWatermark(
+    db: ?*FdbDb,
+    out_watermark: *u64,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_replication_watermark
+    return core_bridge.fdb_replication_watermark(db, out_watermark, out_err);
+}
 
-    return @intFromEnum(Status.internal_error);
+/// Bring a collection's persistent spatial index up to date from the
+/// journal. Delegates to core-zig/src/bridge.zig fdb_spatial_sync.
+pub fn ffiSpatialSync(
+    db: ?*FdbDb,
+    collection_ptr: [*]const u8,
+    collection_len: usize,
+    field_ptr: [*]const u8,
+    field_len: usize,
+    out_entries: *u64,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_spatial_sync
+    return core_bridge.fdb_spatial_sync(db, collection_ptr, collection_len, field_ptr, field_len, out_entries, out_err);
 }
 
-/// Explain FQL query (get execution plan).
-/// NOT YET IMPLEMENTED: requires Factor runtime query planner with EXPLAIN
-/// output generation.
-export fn fdb_query_explain(
-    db: *FdbDb,
-    query_str: [*:0]const u8,
-    query_len: u64,
-    explain_json_out: [*]u8,
-    buffer_len: u64,
-    written_out: *u64,
-) callconv(.c) i32 {
-    if (!initialized) return @intFromEnum(Status.internal_error);
-    if (query_len == 0) return @intFromEnum(Status.invalid_arg);
-    if (buffer_len == 0) return @intFromEnum(Status.invalid_arg);
+/// Documents of a spatial index inside a box. Delegates to
+/// core-zig/src/bridge.zig fdb_spatial_query_bbox.
+pub fn ffiSpatialQueryBbox(
+    db: ?*FdbDb,
+    collection_ptr: [*]const u8,
+    collection_len: usize,
+    field_ptr: [*]const u8,
+    field_len: usize,
+    min_lon: f64,
+    min_lat: f64,
+    max_lon: f64,
+    max_lat: f64,
+    out_rows: *core_bridge.LgBlob,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_spatial_query_bbox
+    return core_bridge.fdb_spatial_query_bbox(db, collection_ptr, collection_len, field_ptr, field_len, min_lon, min_lat, max_lon, max_lat, out_rows, out_err);
+}
 
-    // NOT YET IMPLEMENTED: requires Factor runtime query planner
-    _ = db;
-    _ = query_str;
-    _ = explain_json_out;
-    written_out.* = 0;
-    return @intFromEnum(Status.internal_error);
+/// The k documents of a spatial index nearest a point. Delegates to
+/// core-zig/src/bridge.zig fdb_spatial_nearest.
+pub fn ffiSpatialNearest(
+    db: ?*FdbDb,
+    collection_ptr: [*]const u8,
+    collection_len: usize,
+    field_ptr: [*]const u8,
+    field_len: usize,
+    lon: f64,
+    lat: f64,
+    k: usize,
+    out_rows: *core_bridge.LgBlob,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_spatial_nearest
+    return core_bridge.fdb_spatial_nearest(db, collection_ptr, collection_len, field_ptr, field_len, lon, lat, k, out_rows, out_err);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Cursor Operations
-// NOT YET IMPLEMENTED: requires query engine result set materialization.
+// Block-type and query cursors live in core-zig. Declared as `pub fn`
+// because core-zig exports the symbols.
 ////////////////////////////////////////////////////////////////////////////////
 
-/// Fetch next result from cursor.
-/// NOT YET IMPLEMENTED: requires cursor state management and result set
-/// iteration backed by block storage reads.
-export fn fdb_cursor_next(
-    cursor: *FdbCursor,
-    document_json_out: [*]u8,
-    buffer_len: u64,
-    written_out: *u64,
-) callconv(.c) i32 {
-    if (!initialized) return @intFromEnum(Status.internal_error);
-    if (buffer_len == 0) return @intFromEnum(Status.invalid_arg);
+/// Open a cursor over the live blocks of one type.
+/// Delegates to core-zig/src/bridge.zig fdb_cursor_open_blocks.
+pub fn ffiCursorOpenBlocks(
+    db: ?*FdbDb,
+    block_type: u16,
+    opts: core_bridge.LgRenderOpts,
+    out_cursor: *?*FdbCursor,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_cursor_open_blocks
+    return core_bridge.fdb_cursor_open_blocks(db, block_type, opts, out_cursor, out_err);
+}
 
-    // NOT YET IMPLEMENTED: requires cursor result set iteration
-    _ = cursor;
-    _ = document_json_out;
-    written_out.* = 0;
-    return @intFromEnum(Status.not_found);
+/// Fetch the next batch of rows from a cursor.
+/// Delegates to core-zig/src/bridge.zig fdb_cursor_next.
+pub fn ffiCursorNext(
+    cursor: ?*FdbCursor,
+    buf: [*]u8,
+    buf_len: usize,
+    written: *usize,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_cursor_next
+    return core_bridge.fdb_cursor_next(cursor, buf, buf_len, written);
 }
 
 /// Close cursor.
-/// NOT YET IMPLEMENTED: requires cursor state cleanup.
-export fn fdb_cursor_close(cursor: *FdbCursor) callconv(.c) void {
-    if (!initialized) return;
+/// Delegates to core-zig/src/bridge.zig fdb_cursor_close.
+pub fn ffiCursorClose(cursor: ?*FdbCursor) void {
+    // Delegates to core-zig/src/bridge.zig fdb_cursor_close
+    core_bridge.fdb_cursor_close(cursor);
+}
+
+/// Read one document as a view into the buffer pool where possible.
+/// Delegates to core-zig/src/bridge.zig fdb_read_block_view.
+pub fn ffiReadBlockView(
+    db: ?*FdbDb,
+    block_id: u64,
+    out_view: *core_bridge.LgView,
+    out_err: *core_bridge.LgBlob,
+) core_bridge.LgStatus {
+    // Delegates to core-zig/src/bridge.zig fdb_read_block_view
+    return core_bridge.fdb_read_block_view(db, block_id, out_view, out_err);
+}
 
-    // NOT YET IMPLEMENTED: requires cursor state management
-    _ = cursor;
+/// Release a view from ffiReadBlockView.
+/// Delegates to core-zig/src/bridge.zig fdb_view_release.
+pub fn ffiViewRelease(view: *core_bridge.LgView) void {
+    // Delegates to core-zig/src/bridge.zig fdb_view_release
+    core_bridge.fdb_view_release(view);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
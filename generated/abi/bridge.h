@@ -46,9 +46,17 @@ typedef enum {
 
 /* ============================================================
  * Opaque Handles
+ *
+ * Handles are tokens, not pointers: never dereference them. Every call
+ * validates its handle without taking a global lock, so calls on
+ * different handles may come from any number of threads at once. A
+ * closed, committed or aborted handle is rejected (INVALID_ARGUMENT)
+ * rather than reused, but a handle must not be closed while another
+ * thread is still using it.
  * ============================================================ */
 typedef struct FdbDb  FdbDb;
 typedef struct FdbTxn FdbTxn;
+typedef struct FdbCursor FdbCursor;
 
 /* ============================================================
  * Blob Types (FormBD.FormBridge + core-zig)
@@ -60,6 +68,13 @@ typedef struct {
     size_t         len;
 } LgBlob;
 
+/** Borrowed byte range; valid until fdb_view_release(&view) */
+typedef struct {
+    const uint8_t* ptr;
+    size_t         len;
+    uint64_t       token;     /* identifies the view to the bridge */
+} LgView;
+
 /** Result type for operations returning data + provenance */
 typedef struct {
     LgBlob  data;
@@ -76,10 +91,14 @@ typedef enum {
 
 /** Render options for introspection functions */
 typedef struct {
-    int  format;            /* 0 = JSON */
+    int  format;            /* LG_RENDER_JSON or LG_RENDER_CBOR */
     bool include_metadata;
 } LgRenderOpts;
 
+/** LgRenderOpts.format values */
+#define LG_RENDER_JSON 0    /* Text, for debugging and tools */
+#define LG_RENDER_CBOR 1    /* RFC 8949; payloads as byte strings */
+
 /** Proof verifier callback type */
 typedef FdbStatus (*LgProofVerifier)(
     const uint8_t* proof_ptr,
@@ -97,6 +116,8 @@ typedef FdbStatus (*LgProofVerifier)(
 #define LG_BLOCK_HEADER_SIZE   64
 /** Block payload size in bytes */
 #define LG_BLOCK_PAYLOAD_SIZE  4032
+/** Largest document; beyond LG_BLOCK_PAYLOAD_SIZE it spans an overflow chain */
+#define LG_MAX_DOCUMENT_SIZE   (16 * 1024 * 1024)
 /** Block type: document */
 #define LG_BLOCK_TYPE_DOCUMENT 0x0011
 
@@ -114,11 +135,37 @@ typedef FdbStatus (*LgProofVerifier)(
  *
  * @param path_ptr  Path to database file
  * @param path_len  Length of path
- * @param opts_ptr  CBOR-encoded options (may be NULL)
+ * @param opts_ptr  CBOR-encoded options map (may be NULL)
  * @param opts_len  Length of options (0 if opts_ptr is NULL)
  * @param out_db    Output: database handle
  * @param out_err   Output: error blob (empty on success)
  * @return FdbStatus
+ *
+ * Recognised option keys (unknown keys are ignored):
+ *   "buffer_pool_frames"  uint  Shared page cache size in 4 KiB frames
+ *                               (default 1024, 0 disables caching)
+ *   "mmap"                bool  Serve reads from a read-only mapping of
+ *                               the file instead of pread (default false;
+ *                               ignored where mmap is unavailable)
+ *   "io_uring"            bool  Submit commit write-back through io_uring
+ *                               (default true; a thread pool is used
+ *                               where it is unavailable)
+ *   "compression"         text  "lz4" compresses documents larger than
+ *                               one block when that saves blocks, or
+ *                               "none" (default); reads decode either
+ *   "checkpoint_segments" uint  Checkpoint once this many journal
+ *                               segments accumulate (default 4096, 0
+ *                               leaves it to fdb_db_checkpoint); opening
+ *                               only verifies segments since the last one
+ *   "scan_workers"        uint  Threads per fdb_read_blocks scan, the
+ *                               caller included (default 0, one per CPU;
+ *                               1 scans on the calling thread only)
+ *   "scrub_mib_per_sec"   uint  Background checksum scrubbing read budget
+ *                               (default 0: only fdb_verify_checksums
+ *                               scrubs); a pass resumes across restarts
+ *   "scrub_workers"       uint  Threads per checksum pass (default 2)
+ *   "scrub_interval_hours" uint Least time from the start of one
+ *                               background pass to the next (default 24)
  */
 FdbStatus fdb_db_open(
     const uint8_t* path_ptr, size_t path_len,
@@ -134,11 +181,36 @@ FdbStatus fdb_db_open(
  */
 FdbStatus fdb_db_close(FdbDb* db);
 
+/**
+ * Checkpoint the journal now. Segments before the checkpoint are compacted
+ * into LZ4-packed archive blocks (history is kept) and their blocks are
+ * reused by later commits.
+ *
+ * @param db       Database handle
+ * @param out_err  Output: error blob
+ * @return FdbStatus
+ */
+FdbStatus fdb_db_checkpoint(FdbDb* db, LgBlob* out_err);
+
+/**
+ * Number of fsyncs issued on the database file since it was opened, or 0
+ * for an invalid handle. Commits grouped together share their syncs, so
+ * this grows more slowly than the commit count under concurrency.
+ *
+ * @param db  Database handle
+ * @return fsync count
+ */
+uint64_t fdb_db_sync_count(FdbDb* db);
+
 /* --- Transaction Management --- */
 
 /**
  * Begin a new transaction.
  *
+ * LG_TXN_READ_ONLY takes a snapshot at the last committed journal sequence;
+ * use fdb_txn_read_blocks to read it. Any number of read-only transactions
+ * may run on one database concurrently with the writer.
+ *
  * @param db       Database handle
  * @param mode     Transaction mode (read-only or read-write)
  * @param out_txn  Output: transaction handle
@@ -153,12 +225,44 @@ FdbStatus fdb_txn_begin(
 /**
  * Commit a transaction (6-phase WAL: journal → sync → blocks → deletes → superblock → sync).
  *
+ * Journal entries are packed into shared journal segments. Commits issued
+ * concurrently on the same database are coalesced into one group that
+ * shares the journal sync and the final sync. Block and superblock writes
+ * are submitted as one batch (io_uring on Linux) with the superblock
+ * ordered behind a sync of the data blocks.
+ *
  * @param txn      Transaction handle
  * @param out_err  Output: error blob
  * @return FdbStatus
  */
 FdbStatus fdb_txn_commit(FdbTxn* txn, LgBlob* out_err);
 
+/**
+ * Completion callback for fdb_txn_commit_async. Runs once, on one of the
+ * database's writer threads. `err` belongs to the callback: release it
+ * with fdb_blob_free.
+ */
+typedef void (*LgCommitCallback)(void* ctx, FdbStatus status, LgBlob err);
+
+/**
+ * Commit a transaction without waiting for it to become durable.
+ *
+ * The transaction is queued for the database's writer threads (started
+ * on first use) and its handle is invalidated immediately. Each writer
+ * takes every queued transaction and commits them as one group, so many
+ * callers share each sync. A transaction that fails to commit is aborted.
+ * fdb_db_close completes all queued commits before closing.
+ *
+ * @param txn       Transaction handle
+ * @param callback  Called exactly once with the outcome if LG_OK is returned
+ * @param ctx       Passed through to the callback
+ * @param out_err   Output: error blob
+ * @return FdbStatus (LG_OK once queued)
+ */
+FdbStatus fdb_txn_commit_async(
+    FdbTxn* txn, LgCommitCallback callback, void* ctx, LgBlob* out_err
+);
+
 /**
  * Abort a transaction, discarding all buffered operations.
  *
@@ -171,17 +275,45 @@ FdbStatus fdb_txn_abort(FdbTxn* txn);
 
 /**
  * Apply an insert operation within a transaction.
- * Data is buffered and not written to disk until commit.
+ * Data is buffered and not written to disk until commit. Documents up to
+ * LG_MAX_DOCUMENT_SIZE are accepted; reads return them whole. A document
+ * is a JSON object or a CBOR map and is stored as given, so CBOR documents
+ * are queried and exported in place without converting them to JSON.
  *
  * @param txn     Transaction handle
- * @param op_ptr  Operation data (JSON document)
+ * @param op_ptr  Operation data (JSON object or CBOR map)
  * @param op_len  Length of operation data
  * @return LgResult with block_id in data blob on success
  */
 LgResult fdb_apply(FdbTxn* txn, const uint8_t* op_ptr, size_t op_len);
 
+/* fdb_apply_batch flags */
+#define LG_APPLY_BULK_LOAD 0x0001  /* One BULK_INSERT journal record per batch */
+
+/**
+ * Apply many insert operations in one call.
+ * Each op is buffered like fdb_apply. The batch is given one contiguous
+ * range of block IDs; out_ids[i] receives the ID of ops[i]. All ops are
+ * validated first, so a rejected batch leaves the transaction unchanged.
+ * With LG_APPLY_BULK_LOAD the journal records the batch as a single
+ * BULK_INSERT entry naming the range instead of one DOC_INSERT per op.
+ *
+ * @param txn      Transaction handle
+ * @param ops      Array of count documents (each up to LG_MAX_DOCUMENT_SIZE)
+ * @param count    Number of documents
+ * @param flags    0 or LG_APPLY_BULK_LOAD
+ * @param out_ids  Output: array of count block IDs
+ * @param out_err  Output: error blob
+ * @return FdbStatus
+ */
+FdbStatus fdb_apply_batch(
+    FdbTxn* txn, const LgBlob* ops, size_t count, uint32_t flags,
+    uint64_t* out_ids, LgBlob* out_err
+);
+
 /**
  * Update an existing block within a transaction.
+ * Accepts up to LG_MAX_DOCUMENT_SIZE bytes, like fdb_apply.
  *
  * @param txn       Transaction handle
  * @param block_id  Block ID to update
@@ -211,6 +343,8 @@ FdbStatus fdb_delete_block(FdbTxn* txn, uint64_t block_id, LgBlob* out_err);
 /**
  * Read all blocks of a given type (full scan).
  * Returns a JSON array of objects with block_id, size, and data fields.
+ * Large scans are split over the "scan_workers" threads given to
+ * fdb_db_open; rows still come back in block-ID order.
  *
  * @param db          Database handle
  * @param block_type  Block type filter (e.g. LG_BLOCK_TYPE_DOCUMENT)
@@ -223,10 +357,384 @@ FdbStatus fdb_read_blocks(
     LgBlob* out_data, LgBlob* out_err
 );
 
+/**
+ * Read all blocks of a given type within a transaction.
+ *
+ * Read-only transactions see the snapshot taken at fdb_txn_begin (keyed on
+ * the last committed journal sequence) and never block the writer.
+ * Read-write transactions see the latest committed state.
+ *
+ * @param txn         Transaction handle
+ * @param block_type  Block type to filter (e.g. LG_BLOCK_TYPE_DOCUMENT)
+ * @param out_data    Output: JSON array blob
+ * @param out_err     Output: error blob
+ * @return FdbStatus
+ */
+FdbStatus fdb_txn_read_blocks(
+    FdbTxn* txn, uint16_t block_type,
+    LgBlob* out_data, LgBlob* out_err
+);
+
+/**
+ * fdb_read_blocks with a selectable output format.
+ *
+ * LG_RENDER_JSON returns the JSON array of fdb_read_blocks.
+ * LG_RENDER_CBOR returns a CBOR array of maps
+ * {"block_id": uint, "size": uint, "data": bytes}; payloads are copied
+ * verbatim with no escaping.
+ *
+ * @param db          Database handle
+ * @param block_type  Block type filter (e.g. LG_BLOCK_TYPE_DOCUMENT)
+ * @param opts        Render options (format selects the encoding)
+ * @param out_data    Output: JSON or CBOR blob
+ * @param out_err     Output: error blob
+ * @return FdbStatus (INVALID_ARGUMENT for an unknown format)
+ */
+FdbStatus fdb_read_blocks_format(
+    FdbDb* db, uint16_t block_type, LgRenderOpts opts,
+    LgBlob* out_data, LgBlob* out_err
+);
+
+/**
+ * fdb_txn_read_blocks with a selectable output format.
+ * See fdb_read_blocks_format for the encodings.
+ *
+ * @param txn         Transaction handle
+ * @param block_type  Block type filter (e.g. LG_BLOCK_TYPE_DOCUMENT)
+ * @param opts        Render options (format selects the encoding)
+ * @param out_data    Output: JSON or CBOR blob
+ * @param out_err     Output: error blob
+ * @return FdbStatus
+ */
+FdbStatus fdb_txn_read_blocks_format(
+    FdbTxn* txn, uint16_t block_type, LgRenderOpts opts,
+    LgBlob* out_data, LgBlob* out_err
+);
+
+/**
+ * Open a cursor over all live blocks of a given type.
+ *
+ * The cursor reads from its own snapshot taken here, so it sees a
+ * consistent view however long it is held. Drain it with fdb_cursor_next
+ * and release it with fdb_cursor_close; fdb_db_close closes any cursors
+ * still open on the database.
+ *
+ * @param db          Database handle
+ * @param block_type  Block type filter (e.g. LG_BLOCK_TYPE_DOCUMENT)
+ * @param opts        Render options (format selects the row encoding)
+ * @param out_cursor  Output: cursor handle
+ * @param out_err     Output: error blob
+ * @return FdbStatus
+ */
+FdbStatus fdb_cursor_open_blocks(
+    FdbDb* db, uint16_t block_type, LgRenderOpts opts,
+    FdbCursor** out_cursor, LgBlob* out_err
+);
+
+/**
+ * Fill a caller-provided buffer with the next batch of rows.
+ *
+ * With LG_RENDER_JSON, rows use the object format of fdb_read_blocks,
+ * one per line, each terminated by '\n'. With LG_RENDER_CBOR, rows are
+ * the maps of fdb_read_blocks_format written back to back (an RFC 8742
+ * CBOR sequence). Only whole rows are written. Scan state is kept between
+ * calls.
+ *
+ * @param cursor   Cursor handle
+ * @param buf      Output buffer
+ * @param buf_len  Size of buf in bytes
+ * @param written  Output: bytes written
+ * @return FdbStatus: FDB_OK with rows written;
+ *         FDB_ERR_NOT_FOUND with *written = 0 once the scan is exhausted;
+ *         FDB_ERR_INVALID_ARGUMENT if the next row does not fit, with
+ *         *written set to the buffer size that row needs
+ */
+FdbStatus fdb_cursor_next(
+    FdbCursor* cursor, uint8_t* buf, size_t buf_len, size_t* written
+);
+
+/**
+ * Close a cursor and release its snapshot.
+ *
+ * @param cursor  Cursor handle (NULL is ignored)
+ */
+void fdb_cursor_close(FdbCursor* cursor);
+
+/**
+ * Run a query and return its rows through a cursor.
+ *
+ *   SELECT * | field, ... FROM collection
+ *     [WHERE cond (AND | OR) cond ...] [LIMIT n [OFFSET m]]
+ *
+ * where cond compares a field (a top-level member, a dotted path into a
+ * nested object, or _id for the block ID) with =, !=, <>, <, >, <=, >=,
+ * LIKE, IN (...) or CONTAINS. A document belongs to a collection when
+ * its top-level "collection" member names it. Predicates are evaluated
+ * inside the scan, and `_id = N` / `_id IN (...)` reads only those
+ * blocks. Compiled plans are cached per database by normalized query
+ * text. Documents may be JSON objects or CBOR maps.
+ *
+ * Rows are the JSON objects of fdb_cursor_next, with `data` holding the
+ * document, or an object of the selected fields (null when missing).
+ *
+ * @param db          Database handle
+ * @param query       Query text (not NUL-terminated)
+ * @param query_len   Length of query
+ * @param provenance  Provenance JSON (nullable; reads are not journaled)
+ * @param prov_len    Length of provenance
+ * @param cursor_out  Output: cursor handle, closed with fdb_cursor_close
+ * @return FdbStatus: FDB_ERR_INVALID_ARGUMENT for an invalid query
+ */
+FdbStatus fdb_query_execute(
+    FdbDb* db, const char* query, size_t query_len,
+    const char* provenance, size_t prov_len, FdbCursor** cursor_out
+);
+
+/**
+ * Plan and run a query, writing its plan and block counts as JSON:
+ *
+ *   {"query":"<normalized>","plan":{"access":"type_scan"|"block_ids",
+ *    "collection":...,"fields":[...]|null,"where":[[{"field":...,
+ *    "op":...,"values":[...]}]],"limit":N|null,"offset":N},
+ *    "cached":bool,"estimated_blocks":N,"actual_blocks":N,
+ *    "examined":N,"prefiltered":N,"rows":N}
+ *
+ * `where` lists the conjunctions, any of which admits a document.
+ * prefiltered counts the documents rejected by a vectorized search for
+ * the keys and string values the query needs, before any member was
+ * located.
+ * estimated_blocks comes from the type index before the scan runs;
+ * actual_blocks counts the blocks the scan read, overflow blocks of
+ * chained documents included.
+ *
+ * @param db         Database handle
+ * @param query      Query text
+ * @param query_len  Length of query
+ * @param buf        Output buffer
+ * @param buf_len    Capacity of buf
+ * @param written    Output: bytes written, or on INVALID_ARGUMENT with a
+ *                   valid query the size needed
+ * @return FdbStatus
+ */
+FdbStatus fdb_query_explain(
+    FdbDb* db, const char* query, size_t query_len,
+    void* buf, size_t buf_len, size_t* written
+);
+
+/**
+ * Export one collection's documents as typed column batches, read from
+ * a snapshot, so analytics clients load columns instead of parsing
+ * documents. The batch is a CBOR map:
+ *
+ *   {"since":N,"sequence":N,"rows":N,"deleted":bytes,
+ *    "columns":[{"name":text,"type":"int64"|"float64"|"bool"|"utf8"|"null",
+ *                "null_count":N,"mismatched":N,"validity":bytes,
+ *                "values":bytes,"offsets":bytes}, ...]}
+ *
+ * Column buffers follow Arrow's physical layout, little-endian: the
+ * validity bitmap (empty when null_count is 0), int64/float64 values
+ * 8 bytes a row, bools as a bitmap, utf8 bytes with rows + 1 int32
+ * offsets. The first value of a field fixes its column's type; integers
+ * widen to float64, objects and arrays go into utf8 columns as JSON,
+ * and other disagreeing values are null and counted as mismatched.
+ * "_id" and "_seq" (block ID and the sequence that last wrote it)
+ * always come first.
+ *
+ * With since_seq 0 every document of the collection is exported. Any
+ * other since_seq exports only the blocks the journal records as
+ * written after it. "deleted" lists, as int64 block IDs, the blocks
+ * written since then that are no longer in the collection. Pass
+ * "sequence" as the next since_seq.
+ *
+ * @param db              Database handle
+ * @param collection      Collection name (the documents' "collection")
+ * @param collection_len  Length of collection
+ * @param fields          Comma-separated member paths, e.g. "title,meta.lang"
+ * @param fields_len      Length of fields
+ * @param since_seq       Sequence of the previous batch, or 0
+ * @param out_batch       Output: CBOR batch blob
+ * @param out_err         Output: error blob
+ * @return FdbStatus (NOT_FOUND when the journal no longer reaches
+ *         since_seq and a full export is needed)
+ */
+FdbStatus fdb_export_columnar(
+    FdbDb* db, const char* collection, size_t collection_len,
+    const char* fields, size_t fields_len, uint64_t since_seq,
+    LgBlob* out_batch, LgBlob* out_err
+);
+
+/** fdb_replication_read flag: LZ4-compress the shipment body */
+#define LG_SHIP_LZ4 0x0001u
+
+/**
+ * Read a journal shipment for a follower.
+ *
+ * A shipment is a 56-byte header ("LGSHIP01", first and last sequence,
+ * counts, lengths, flags, CRC32C) followed by the journal entries from
+ * from_seq on, byte for byte as the leader stored them, and the current
+ * image of every document they insert or update. Entries are added until
+ * the shipment holds about max_bytes (always at least one when any
+ * exist); an empty shipment means the follower is up to date. Images are
+ * read at the time of the call, and a shipment may end inside a leader
+ * transaction.
+ *
+ * @param db            Leader database handle
+ * @param from_seq      First sequence wanted: the follower's watermark + 1
+ * @param max_bytes     Uncompressed size to stop adding entries at; 0 for 16 MiB
+ * @param flags         0 or LG_SHIP_LZ4
+ * @param out_shipment  Output: shipment blob
+ * @param out_err       Output: error blob
+ * @return FdbStatus (NOT_FOUND when the journal no longer reaches
+ *         from_seq and the follower must be copied afresh)
+ */
+FdbStatus fdb_replication_read(
+    FdbDb* db, uint64_t from_seq, size_t max_bytes, uint32_t flags,
+    LgBlob* out_shipment, LgBlob* out_err
+);
+
+/**
+ * Apply a shipment from fdb_replication_read as one group commit.
+ *
+ * The shipment must start right after the follower's watermark; one
+ * already applied is accepted and changes nothing. Replicated documents
+ * get the follower's own block IDs. Each of their journal records names
+ * the leader block ("origin=N"), and a REPLICA_MARK record stores the
+ * watermark, so both survive a restart.
+ *
+ * @param db             Follower database handle
+ * @param shipment       Shipment bytes
+ * @param shipment_len   Length of shipment
+ * @param out_watermark  Output: last leader sequence applied
+ * @param out_err        Output: error blob
+ * @return FdbStatus (CONFLICT when the shipment does not follow the
+ *         watermark: read again from *out_watermark + 1)
+ */
+FdbStatus fdb_replication_apply(
+    FdbDb* db, const uint8_t* shipment, size_t shipment_len,
+    uint64_t* out_watermark, LgBlob* out_err
+);
+
+/**
+ * Last leader sequence applied by fdb_replication_apply (0 for a
+ * database that has never followed a leader).
+ *
+ * @param db             Database handle
+ * @param out_watermark  Output: the watermark
+ * @param out_err        Output: error blob
+ * @return FdbStatus
+ */
+FdbStatus fdb_replication_watermark(FdbDb* db, uint64_t* out_watermark, LgBlob* out_err);
+
+/**
+ * Bring the persistent R-tree over one location field of a collection
+ * up to date.
+ *
+ * The tree is stored in the database file: STR-packed SPATIAL_NODE
+ * blocks of LG_BLOCK_PAYLOAD_SIZE and a SPATIAL_META block recording the
+ * root and the journal sequence it was packed at (spec/blocks.adoc). The
+ * first sync reads every document. Later syncs repack from the old
+ * leaves and only the documents the journal records as written since,
+ * and commit the new tree and the freeing of the old one together.
+ * Locations are {"lat","lon"} objects (or latitude/lng/longitude),
+ * [lon, lat] arrays or GeoJSON {"coordinates": [lon, lat]}.
+ *
+ * @param db              Database handle
+ * @param collection      Collection name (the documents' "collection")
+ * @param collection_len  Length of collection
+ * @param field           Location member path, e.g. "location"
+ * @param field_len       Length of field
+ * @param out_entries     Output: documents in the index
+ * @param out_err         Output: error blob
+ * @return FdbStatus
+ */
+FdbStatus fdb_spatial_sync(
+    FdbDb* db, const char* collection, size_t collection_len,
+    const char* field, size_t field_len,
+    uint64_t* out_entries, LgBlob* out_err
+);
+
+/**
+ * Documents of a synced spatial index inside a box, by block ID.
+ *
+ * Reads one snapshot and never waits for writers. Documents written
+ * since the last fdb_spatial_sync are taken from the journal, so results
+ * are current without a sync. Rows are a JSON array of
+ * {"block_id":N,"lon":X,"lat":Y}.
+ *
+ * @param db              Database handle
+ * @param collection      Collection name
+ * @param collection_len  Length of collection
+ * @param field           Location member path the index was synced with
+ * @param field_len       Length of field
+ * @param min_lon, min_lat, max_lon, max_lat  Box edges (inclusive)
+ * @param out_rows        Output: JSON rows
+ * @param out_err         Output: error blob
+ * @return FdbStatus (NOT_FOUND when there is no such index, or the
+ *         journal no longer reaches it: sync and retry)
+ */
+FdbStatus fdb_spatial_query_bbox(
+    FdbDb* db, const char* collection, size_t collection_len,
+    const char* field, size_t field_len,
+    double min_lon, double min_lat, double max_lon, double max_lat,
+    LgBlob* out_rows, LgBlob* out_err
+);
+
+/**
+ * The k documents of a synced spatial index nearest a point, nearest
+ * first by planar distance in degrees. Same snapshot rules, rows and
+ * errors as fdb_spatial_query_bbox.
+ *
+ * @param db              Database handle
+ * @param collection      Collection name
+ * @param collection_len  Length of collection
+ * @param field           Location member path the index was synced with
+ * @param field_len       Length of field
+ * @param lon, lat        The point
+ * @param k               Number of documents wanted
+ * @param out_rows        Output: JSON rows
+ * @param out_err         Output: error blob
+ * @return FdbStatus
+ */
+FdbStatus fdb_spatial_nearest(
+    FdbDb* db, const char* collection, size_t collection_len,
+    const char* field, size_t field_len,
+    double lon, double lat, size_t k,
+    LgBlob* out_rows, LgBlob* out_err
+);
+
+/**
+ * Read one document without copying it out of the buffer pool.
+ *
+ * A single-block document comes back as a view of its pinned pool
+ * frame, which a concurrent commit detaches rather than overwrites, so
+ * the bytes stay as read until the view is released. Chained or
+ * compressed documents (and databases opened with no buffer pool) are
+ * reassembled or copied into memory owned by the view. Views hold pool
+ * frames, so release them promptly. fdb_db_close on a database with
+ * views still out defers closing the file to the last fdb_view_release.
+ *
+ * @param db        Database handle
+ * @param block_id  Document block ID
+ * @param out_view  Output: document bytes and release token
+ * @param out_err   Output: error blob
+ * @return FdbStatus (NOT_FOUND for missing, deleted or non-document blocks)
+ */
+FdbStatus fdb_read_block_view(
+    FdbDb* db, uint64_t block_id,
+    LgView* out_view, LgBlob* out_err
+);
+
+/**
+ * Release a view from fdb_read_block_view and clear it. Unknown or
+ * already released views are ignored.
+ */
+void fdb_view_release(LgView* view);
+
 /* --- Introspection --- */
 
 /**
- * Render a block as canonical text (JSON).
+ * Render a block as canonical text (JSON), or with LG_RENDER_CBOR as a
+ * CBOR map of the same fields whose "payload" holds the payload bytes.
  *
  * @param db        Database handle
  * @param block_id  Block ID to render
@@ -242,10 +750,13 @@ FdbStatus fdb_render_block(
 );
 
 /**
- * Render journal entries since a sequence number.
+ * Render journal entries after a sequence number (JSON or CBOR map):
+ * {"since", "head", "tail", "entries": [{"seq", "timestamp", "op",
+ * "affected_block", "forward"}, ...]}. At most 1024 entries are rendered;
+ * call again with the last "seq" to page on.
  *
  * @param db        Database handle
- * @param since     Starting sequence number
+ * @param since     Last sequence already seen (0 renders from the start)
  * @param opts      Render options
  * @param out_text  Output: text blob
  * @param out_err   Output: error blob
@@ -257,6 +768,28 @@ FdbStatus fdb_render_journal(
     LgBlob* out_text, LgBlob* out_err
 );
 
+/**
+ * Read up to `count` journal entries starting at `start_seq` (inclusive;
+ * 0 reads from the oldest, archived entries included) as a JSON array of
+ * the objects fdb_render_journal produces. Only whole entries are
+ * written; "[]" means there is nothing at or after `start_seq` yet. Each
+ * call seeks through an in-memory sequence index, so polling costs the
+ * same however long the journal grows.
+ *
+ * @param db         Database handle
+ * @param start_seq  First sequence to return
+ * @param count      Maximum number of entries
+ * @param buf        Output buffer
+ * @param buf_len    Capacity of buf
+ * @param written    Output: bytes written, or on INVALID_ARGUMENT the
+ *                   size needed for the first entry
+ * @return FdbStatus
+ */
+FdbStatus fdb_journal_read(
+    FdbDb* db, uint64_t start_seq, uint64_t count,
+    uint8_t* buf, size_t buf_len, size_t* written
+);
+
 /**
  * Get database schema information as JSON.
  *
@@ -281,10 +814,60 @@ FdbStatus fdb_introspect_constraints(
     FdbDb* db, LgBlob* out_constraints, LgBlob* out_err
 );
 
+/**
+ * Get engine statistics as JSON:
+ *
+ *   {"blocks_read":N,"blocks_written":N,"bytes_written":N,"fsyncs":N,
+ *    "crc_failures":N,"commit_groups":N,
+ *    "cache":{"frames":N,"hits":N,"misses":N},
+ *    "commit_phases":{"journal":H,"journal_write":H,"blocks":H,
+ *                     "deletes":H,"block_write":H,"publish":H},
+ *    "scrub":{"passes":N,"blocks_verified":N,"bytes_read":N,"position":N,
+ *             "last_pass_completed_ms":N,"corrupted":[id,...],
+ *             "corrupted_truncated":B}}
+ *
+ * where each H is {"count","total_us","max_us","p50_us","p99_us","buckets"}
+ * and buckets[i] counts group commits whose phase took [2^(i-1), 2^i) us
+ * (bucket 0: under 1 us). journal_write and block_write include their
+ * fsyncs, so they separate journal I/O from block I/O. "scrub" covers
+ * background passes and fdb_verify_checksums: "position" is the next block
+ * of the background pass, and "corrupted" lists each block that failed
+ * its checksum (the first 256; "corrupted_truncated" says more were
+ * found). Counters grow from open; sample twice for rates.
+ *
+ * @param db         Database handle
+ * @param out_stats  Output: JSON blob (free with fdb_blob_free)
+ * @param out_err    Output: error blob
+ * @return FdbStatus
+ */
+FdbStatus fdb_stats(FdbDb* db, LgBlob* out_stats, LgBlob* out_err);
+
+/**
+ * Verify the CRC32C of every block in the file now, reading it in 1 MiB
+ * extents over the "scrub_workers" threads at full speed. Blocks that fail
+ * are also listed in fdb_stats. Background scrubbing ("scrub_mib_per_sec")
+ * runs the same check paced, without blocking a caller.
+ *
+ * @param db         Database handle
+ * @param out_ids    Output: corrupted block IDs, ascending (may be NULL
+ *                   when capacity is 0)
+ * @param capacity   Number of IDs out_ids holds
+ * @param out_count  Output: number of corrupted blocks (may exceed capacity)
+ * @param out_err    Output: error blob
+ * @return FdbStatus
+ */
+FdbStatus fdb_verify_checksums(
+    FdbDb* db, uint64_t* out_ids, size_t capacity, size_t* out_count,
+    LgBlob* out_err
+);
+
 /* --- Proof Verification --- */
 
 /**
  * Register a proof verifier for a specific proof type.
+ * Replaces any verifier already registered for the type. Registration is
+ * expected to be rare; fdb_proof_verify looks verifiers up without
+ * locking and may run concurrently with it.
  *
  * @param type_ptr  Proof type identifier (e.g. "fd-holds", "normalization")
  * @param type_len  Length of type identifier
@@ -362,12 +945,7 @@ uint32_t fdb_version(void);
 /* FdbStatus fdb_collection_create(FdbDb* db, const char* name, size_t name_len, const char* schema_json, size_t schema_len); */
 /* FdbStatus fdb_collection_drop(FdbDb* db, const char* name, size_t name_len); */
 /* FdbStatus fdb_collection_schema(FdbDb* db, const char* name, void** schema_out); */
-/* FdbStatus fdb_query_execute(FdbDb* db, const char* query, size_t query_len, const char* provenance, size_t prov_len, void** cursor_out); */
-/* FdbStatus fdb_query_explain(FdbDb* db, const char* query, size_t query_len, void* buf, size_t buf_len, size_t* written); */
-/* FdbStatus fdb_cursor_next(void* cursor, void* buf, size_t buf_len, size_t* written); */
-/* void      fdb_cursor_close(void* cursor); */
 /* FdbStatus fdb_journal_get(FdbDb* db, void** journal_out); */
-/* FdbStatus fdb_journal_read(void* journal, uint64_t start_seq, uint64_t count, void* buf, size_t buf_len, size_t* written); */
 /* FdbStatus fdb_journal_replay(FdbDb* db, uint64_t from_seq); */
 /* FdbStatus fdb_normalize_discover(FdbDb* db, const char* collection, void* buf, size_t buf_len, size_t* written); */
 /* FdbStatus fdb_normalize_analyze(FdbDb* db, const char* collection, void* nf_out); */
@@ -375,7 +953,6 @@ uint32_t fdb_version(void);
 /* FdbStatus fdb_migrate_commit(void* migration, uint8_t phase); */
 /* FdbStatus fdb_serialize_cbor(const char* json, size_t json_len, void* buf, size_t buf_len, size_t* written); */
 /* FdbStatus fdb_deserialize_cbor(void* cbor, size_t cbor_len, void* buf, size_t buf_len, size_t* written); */
-/* FdbStatus fdb_verify_checksums(FdbDb* db, void* corrupted_out, size_t buf_len, size_t* count_out); */
 /* FdbStatus fdb_repair(FdbDb* db, void* report_buf, size_t buf_len, size_t* written); */
 
 #ifdef __cplusplus
@@ -228,6 +228,24 @@ async fn nearest_handler(
 async fn reindex_handler(State(state): State<Arc<AppState>>) -> Result<Json<ReindexResponse>, StatusCode> {
     let start = std::time::Instant::now();
 
+    // A persistent index folds in the journal instead of refetching
+    if state.spatial_index.is_persistent() {
+        let engine_state = state.clone();
+        let count = tokio::task::spawn_blocking(move || engine_state.spatial_index.sync_engine())
+            .await
+            .map_err(|_| StatusCode::INTERNAL_SERVER_ERROR)?
+            .unwrap_or(Ok(0))
+            .map_err(|e| {
+                tracing::error!("Failed to sync the persistent index: {:#}", e);
+                StatusCode::INTERNAL_SERVER_ERROR
+            })?;
+        return Ok(Json(ReindexResponse {
+            status: "ok".to_string(),
+            entries_indexed: count,
+            duration_ms: start.elapsed().as_millis(),
+        }));
+    }
+
     // Fetch documents from FormBD
     let documents = state
         .lithoglyph_client
@@ -40,6 +40,13 @@ pub struct IndexConfig {
     pub auto_rebuild_minutes: u32,
     /// Maximum memory for R-tree index in MB
     pub max_memory_mb: usize,
+    /// Engine bridge library; with `database`, queries use the R-tree
+    /// persisted in the database file instead of an in-memory one
+    #[serde(default)]
+    pub engine_library: Option<String>,
+    /// Database file opened through `engine_library`
+    #[serde(default)]
+    pub database: Option<String>,
 }
 
 impl Config {
@@ -78,6 +85,8 @@ fn default() -> Self {
             index: IndexConfig {
                 auto_rebuild_minutes: 0,
                 max_memory_mb: 512,
+                engine_library: None,
+                database: None,
             },
         }
     }
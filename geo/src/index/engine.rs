@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: PMPL-1.0-or-later
+//! Persistent R-tree kept by the Lithoglyph engine
+//!
+//! The engine stores the index in the database file as STR-packed node
+//! blocks and folds the journal into it (`fdb_spatial_*` in
+//! generated/abi/bridge.h), so a restart reads the tree where it was
+//! instead of rebuilding it. Queries read an engine snapshot and never
+//! wait for writers.
+
+use super::{BoundingBox, SpatialEntry};
+use anyhow::{anyhow, Context, Result};
+use libloading::Library;
+use serde::Deserialize;
+use std::ffi::c_void;
+use std::path::Path;
+
+/// FdbStatus values used here
+const FDB_OK: i32 = 0;
+const FDB_ERR_NOT_FOUND: i32 = 2;
+
+/// Owned byte buffer passed across the FFI boundary (LgBlob)
+#[repr(C)]
+struct LgBlob {
+    ptr: *const u8,
+    len: usize,
+}
+
+impl LgBlob {
+    fn empty() -> Self {
+        Self {
+            ptr: std::ptr::null(),
+            len: 0,
+        }
+    }
+}
+
+type DbOpenFn = unsafe extern "C" fn(*const u8, usize, *const u8, usize, *mut *mut c_void, *mut LgBlob) -> i32;
+type DbCloseFn = unsafe extern "C" fn(*mut c_void) -> i32;
+type BlobFreeFn = unsafe extern "C" fn(*mut LgBlob);
+type SyncFn = unsafe extern "C" fn(*mut c_void, *const u8, usize, *const u8, usize, *mut u64, *mut LgBlob) -> i32;
+type BboxFn = unsafe extern "C" fn(
+    *mut c_void,
+    *const u8,
+    usize,
+    *const u8,
+    usize,
+    f64,
+    f64,
+    f64,
+    f64,
+    *mut LgBlob,
+    *mut LgBlob,
+) -> i32;
+type NearestFn =
+    unsafe extern "C" fn(*mut c_void, *const u8, usize, *const u8, usize, f64, f64, usize, *mut LgBlob, *mut LgBlob) -> i32;
+
+/// One row of fdb_spatial_query_bbox / fdb_spatial_nearest
+#[derive(Debug, Deserialize)]
+struct Row {
+    block_id: u64,
+    lon: f64,
+    lat: f64,
+}
+
+/// An open database whose spatial index answers the queries
+pub struct EngineIndex {
+    db: *mut c_void,
+    collection: String,
+    field: String,
+    db_close: DbCloseFn,
+    blob_free: BlobFreeFn,
+    sync: SyncFn,
+    bbox: BboxFn,
+    nearest: NearestFn,
+    // The function pointers above point into the library
+    _library: Library,
+}
+
+// The bridge serializes syncs itself and queries only read snapshots
+unsafe impl Send for EngineIndex {}
+unsafe impl Sync for EngineIndex {}
+
+impl EngineIndex {
+    /// Load the bridge library and open `database`, indexing
+    /// `location_field` of `collection`
+    pub fn open(library: &Path, database: &Path, collection: &str, location_field: &str) -> Result<Self> {
+        // SAFETY: the library is the Lithoglyph bridge, whose exports
+        // match the signatures declared above
+        unsafe {
+            let lib = Library::new(library).with_context(|| format!("Failed to load {}", library.display()))?;
+            let db_open = *lib.get::<DbOpenFn>(b"fdb_db_open\0")?;
+            let db_close = *lib.get::<DbCloseFn>(b"fdb_db_close\0")?;
+            let blob_free = *lib.get::<BlobFreeFn>(b"fdb_blob_free\0")?;
+            let sync = *lib.get::<SyncFn>(b"fdb_spatial_sync\0")?;
+            let bbox = *lib.get::<BboxFn>(b"fdb_spatial_query_bbox\0")?;
+            let nearest = *lib.get::<NearestFn>(b"fdb_spatial_nearest\0")?;
+
+            let path = database.to_string_lossy();
+            let mut db: *mut c_void = std::ptr::null_mut();
+            let mut err = LgBlob::empty();
+            let status = db_open(path.as_ptr(), path.len(), std::ptr::null(), 0, &mut db, &mut err);
+            let message = take_blob(blob_free, &mut err);
+            if status != FDB_OK {
+                return Err(anyhow!("fdb_db_open failed ({}): {}", status, String::from_utf8_lossy(&message)));
+            }
+
+            Ok(Self {
+                db,
+                collection: collection.to_string(),
+                field: location_field.to_string(),
+                db_close,
+                blob_free,
+                sync,
+                bbox,
+                nearest,
+                _library: lib,
+            })
+        }
+    }
+
+    /// Fold the journal into the persisted tree; returns the entry count
+    pub fn sync(&self) -> Result<usize> {
+        let mut entries = 0u64;
+        let mut err = LgBlob::empty();
+        // SAFETY: db is open until drop; the names outlive the call
+        let status = unsafe {
+            (self.sync)(
+                self.db,
+                self.collection.as_ptr(),
+                self.collection.len(),
+                self.field.as_ptr(),
+                self.field.len(),
+                &mut entries,
+                &mut err,
+            )
+        };
+        self.check("fdb_spatial_sync", status, &mut err)?;
+        Ok(entries as usize)
+    }
+
+    /// Documents inside `bbox`
+    pub fn query_bbox(&self, bbox: BoundingBox) -> Result<Vec<SpatialEntry>> {
+        self.rows("fdb_spatial_query_bbox", |rows, err| unsafe {
+            (self.bbox)(
+                self.db,
+                self.collection.as_ptr(),
+                self.collection.len(),
+                self.field.as_ptr(),
+                self.field.len(),
+                bbox.min_lon,
+                bbox.min_lat,
+                bbox.max_lon,
+                bbox.max_lat,
+                rows,
+                err,
+            )
+        })
+    }
+
+    /// The `k` documents nearest (lat, lon), nearest first
+    pub fn query_nearest(&self, lat: f64, lon: f64, k: usize) -> Result<Vec<SpatialEntry>> {
+        self.rows("fdb_spatial_nearest", |rows, err| unsafe {
+            (self.nearest)(
+                self.db,
+                self.collection.as_ptr(),
+                self.collection.len(),
+                self.field.as_ptr(),
+                self.field.len(),
+                lon,
+                lat,
+                k,
+                rows,
+                err,
+            )
+        })
+    }
+
+    /// Run a query, syncing once first if the index is missing or the
+    /// journal no longer reaches it
+    fn rows(&self, call: &str, query: impl Fn(*mut LgBlob, *mut LgBlob) -> i32) -> Result<Vec<SpatialEntry>> {
+        let mut rows = LgBlob::empty();
+        let mut err = LgBlob::empty();
+        let mut status = query(&mut rows, &mut err);
+        if status == FDB_ERR_NOT_FOUND {
+            take_blob(self.blob_free, &mut err);
+            self.sync()?;
+            status = query(&mut rows, &mut err);
+        }
+        self.check(call, status, &mut err)?;
+
+        let bytes = take_blob(self.blob_free, &mut rows);
+        let parsed: Vec<Row> = serde_json::from_slice(&bytes).with_context(|| format!("{} returned invalid rows", call))?;
+        Ok(parsed
+            .into_iter()
+            .map(|row| SpatialEntry::new(row.block_id.to_string(), row.lat, row.lon))
+            .collect())
+    }
+
+    fn check(&self, call: &str, status: i32, err: &mut LgBlob) -> Result<()> {
+        let message = take_blob(self.blob_free, err);
+        if status == FDB_OK {
+            return Ok(());
+        }
+        Err(anyhow!("{} failed ({}): {}", call, status, String::from_utf8_lossy(&message)))
+    }
+}
+
+impl Drop for EngineIndex {
+    fn drop(&mut self) {
+        // SAFETY: db came from fdb_db_open and is closed exactly once
+        unsafe {
+            (self.db_close)(self.db);
+        }
+    }
+}
+
+/// Copy a blob's bytes out and free it
+fn take_blob(blob_free: BlobFreeFn, blob: &mut LgBlob) -> Vec<u8> {
+    if blob.ptr.is_null() {
+        return Vec::new();
+    }
+    // SAFETY: the bridge hands out len readable bytes at ptr until freed
+    let bytes = unsafe { std::slice::from_raw_parts(blob.ptr, blob.len) }.to_vec();
+    unsafe { blob_free(blob) };
+    *blob = LgBlob::empty();
+    bytes
+}
@@ -4,8 +4,10 @@
 //! This module provides spatial indexing for FormBD documents.
 //! The index is a materialized projection - FormBD remains the source of truth.
 
+mod engine;
 mod rtree;
 
+pub use engine::EngineIndex;
 pub use rtree::SpatialIndex;
 
 use geo::Point;
@@ -1,19 +1,27 @@
 // SPDX-License-Identifier: PMPL-1.0-or-later
 //! R-tree spatial index implementation
 
+use super::engine::EngineIndex;
 use super::{BoundingBox, SpatialEntry, SpatialQueryResult};
 use geo::{HaversineDistance, Point};
 use rstar::{primitives::GeomWithData, RTree, AABB};
-use std::sync::RwLock;
-use tracing::info;
+use std::sync::{Arc, RwLock};
+use tracing::{error, info};
 
 /// Type alias for R-tree entries
 type RTreeEntry = GeomWithData<[f64; 2], String>;
 
 /// Spatial index using R-tree for efficient spatial queries
+///
+/// Queries take a snapshot of the tree (an `Arc` clone) and run without
+/// holding the lock, so a rebuild never waits for them and they never
+/// wait for a rebuild. With an engine attached the tree lives in the
+/// database file instead and this one stays empty.
 pub struct SpatialIndex {
-    /// The R-tree index
-    tree: RwLock<RTree<RTreeEntry>>,
+    /// The R-tree index, replaced or copied on write
+    tree: RwLock<Arc<RTree<RTreeEntry>>>,
+    /// Persistent index in the engine, when configured
+    engine: Option<EngineIndex>,
     /// Maximum memory limit in MB
     max_memory_mb: usize,
     /// Index statistics
@@ -35,19 +43,52 @@ impl SpatialIndex {
     /// Create a new empty spatial index
     pub fn new(max_memory_mb: usize) -> Self {
         Self {
-            tree: RwLock::new(RTree::new()),
+            tree: RwLock::new(Arc::new(RTree::new())),
+            engine: None,
             max_memory_mb,
             stats: RwLock::new(IndexStats::default()),
         }
     }
 
+    /// Create an index served by the engine's persistent R-tree
+    pub fn with_engine(max_memory_mb: usize, engine: EngineIndex) -> Self {
+        Self {
+            engine: Some(engine),
+            ..Self::new(max_memory_mb)
+        }
+    }
+
+    /// Whether queries go to the engine
+    pub fn is_persistent(&self) -> bool {
+        self.engine.is_some()
+    }
+
+    /// Bring the engine's index up to date with its journal. None when
+    /// there is no engine.
+    pub fn sync_engine(&self) -> Option<anyhow::Result<usize>> {
+        let engine = self.engine.as_ref()?;
+        Some(engine.sync().map(|count| {
+            let mut stats = self.stats.write().unwrap();
+            stats.entry_count = count;
+            stats.last_rebuild = Some(chrono::Utc::now());
+            info!("Persistent spatial index synced with {} entries", count);
+            count
+        }))
+    }
+
+    /// Current tree; queries on it see no later writes
+    fn snapshot(&self) -> Arc<RTree<RTreeEntry>> {
+        Arc::clone(&self.tree.read().unwrap())
+    }
+
     /// Insert an entry into the index
     pub fn insert(&self, entry: SpatialEntry) {
         let point = [entry.lon(), entry.lat()];
         let rtree_entry = GeomWithData::new(point, entry.lithoglyph_id);
 
+        // Copies the tree only while a query still holds the old one
         let mut tree = self.tree.write().unwrap();
-        tree.insert(rtree_entry);
+        Arc::make_mut(&mut tree).insert(rtree_entry);
 
         let mut stats = self.stats.write().unwrap();
         stats.entry_count += 1;
@@ -63,8 +104,7 @@ pub fn bulk_insert(&self, entries: Vec<SpatialEntry>) {
         let count = rtree_entries.len();
         let new_tree = RTree::bulk_load(rtree_entries);
 
-        let mut tree = self.tree.write().unwrap();
-        *tree = new_tree;
+        *self.tree.write().unwrap() = Arc::new(new_tree);
 
         let mut stats = self.stats.write().unwrap();
         stats.entry_count = count;
@@ -75,8 +115,7 @@ pub fn bulk_insert(&self, entries: Vec<SpatialEntry>) {
 
     /// Clear the index
     pub fn clear(&self) {
-        let mut tree = self.tree.write().unwrap();
-        *tree = RTree::new();
+        *self.tree.write().unwrap() = Arc::new(RTree::new());
 
         let mut stats = self.stats.write().unwrap();
         stats.entry_count = 0;
@@ -84,7 +123,16 @@ pub fn clear(&self) {
 
     /// Query entries within a bounding box
     pub fn query_bbox(&self, bbox: BoundingBox) -> Vec<SpatialQueryResult> {
-        let tree = self.tree.read().unwrap();
+        if let Some(engine) = &self.engine {
+            return engine_results(engine.query_bbox(bbox))
+                .into_iter()
+                .map(|entry| SpatialQueryResult {
+                    entry,
+                    distance_km: None,
+                })
+                .collect();
+        }
+        let tree = self.snapshot();
 
         let aabb = AABB::from_corners([bbox.min_lon, bbox.min_lat], [bbox.max_lon, bbox.max_lat]);
 
@@ -101,43 +149,72 @@ pub fn query_bbox(&self, bbox: BoundingBox) -> Vec<SpatialQueryResult> {
 
     /// Query entries within a radius of a point
     pub fn query_radius(&self, lat: f64, lon: f64, radius_km: f64) -> Vec<SpatialQueryResult> {
-        let tree = self.tree.read().unwrap();
         let center = Point::new(lon, lat);
 
         // Convert km to approximate degrees for initial bbox filter
         // 1 degree latitude ≈ 111 km
         let degree_radius = radius_km / 111.0;
 
+        let within = |id: &String, entry_lat: f64, entry_lon: f64| {
+            let entry_point = Point::new(entry_lon, entry_lat);
+
+            // Calculate actual distance using Haversine formula
+            let distance_m = center.haversine_distance(&entry_point);
+            let distance_km = distance_m / 1000.0;
+
+            if distance_km <= radius_km {
+                Some(SpatialQueryResult {
+                    entry: SpatialEntry::new(id.clone(), entry_lat, entry_lon),
+                    distance_km: Some(distance_km),
+                })
+            } else {
+                None
+            }
+        };
+
+        if let Some(engine) = &self.engine {
+            let bbox = BoundingBox::new(
+                lat - degree_radius,
+                lon - degree_radius,
+                lat + degree_radius,
+                lon + degree_radius,
+            );
+            return engine_results(engine.query_bbox(bbox))
+                .iter()
+                .filter_map(|e| within(&e.lithoglyph_id, e.lat(), e.lon()))
+                .collect();
+        }
+
         let bbox = AABB::from_corners(
             [lon - degree_radius, lat - degree_radius],
             [lon + degree_radius, lat + degree_radius],
         );
 
-        tree.locate_in_envelope(&bbox)
+        self.snapshot()
+            .locate_in_envelope(&bbox)
             .filter_map(|entry| {
                 let [entry_lon, entry_lat] = *entry.geom();
-                let entry_point = Point::new(entry_lon, entry_lat);
-
-                // Calculate actual distance using Haversine formula
-                let distance_m = center.haversine_distance(&entry_point);
-                let distance_km = distance_m / 1000.0;
-
-                if distance_km <= radius_km {
-                    Some(SpatialQueryResult {
-                        entry: SpatialEntry::new(entry.data.clone(), entry_lat, entry_lon),
-                        distance_km: Some(distance_km),
-                    })
-                } else {
-                    None
-                }
+                within(&entry.data, entry_lat, entry_lon)
             })
             .collect()
     }
 
     /// Find k nearest neighbors to a point
     pub fn query_nearest(&self, lat: f64, lon: f64, k: usize) -> Vec<SpatialQueryResult> {
-        let tree = self.tree.read().unwrap();
         let center = Point::new(lon, lat);
+        if let Some(engine) = &self.engine {
+            return engine_results(engine.query_nearest(lat, lon, k))
+                .into_iter()
+                .map(|entry| {
+                    let distance_km = center.haversine_distance(&entry.location) / 1000.0;
+                    SpatialQueryResult {
+                        entry,
+                        distance_km: Some(distance_km),
+                    }
+                })
+                .collect();
+        }
+        let tree = self.snapshot();
 
         tree.nearest_neighbor_iter(&[lon, lat])
             .take(k)
@@ -161,6 +238,9 @@ pub fn stats(&self) -> IndexStats {
 
     /// Get entry count
     pub fn len(&self) -> usize {
+        if self.engine.is_some() {
+            return self.stats.read().unwrap().entry_count;
+        }
         self.tree.read().unwrap().size()
     }
 
@@ -170,6 +250,14 @@ pub fn is_empty(&self) -> bool {
     }
 }
 
+/// Entries of an engine query; failures are logged and answer nothing
+fn engine_results(result: anyhow::Result<Vec<SpatialEntry>>) -> Vec<SpatialEntry> {
+    result.unwrap_or_else(|e| {
+        error!("Persistent spatial index query failed: {:#}", e);
+        Vec::new()
+    })
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -225,4 +313,21 @@ fn test_query_nearest() {
         assert_eq!(results.len(), 2);
         // Should be doc_1 (51.5) and doc_2 (51.6), both ~5.5km away
     }
+
+    #[test]
+    fn test_queries_keep_their_snapshot_across_rebuilds() {
+        let index = SpatialIndex::new(512);
+        index.insert(SpatialEntry::new("doc_london".to_string(), 51.5074, -0.1278));
+
+        let before = index.snapshot();
+        index.bulk_insert(vec![
+            SpatialEntry::new("doc_paris".to_string(), 48.8566, 2.3522),
+            SpatialEntry::new("doc_berlin".to_string(), 52.5200, 13.4050),
+        ]);
+        index.insert(SpatialEntry::new("doc_rome".to_string(), 41.9028, 12.4964));
+
+        assert_eq!(before.size(), 1);
+        assert_eq!(index.len(), 3);
+        assert!(!index.is_persistent());
+    }
 }
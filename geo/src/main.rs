@@ -66,8 +66,24 @@ async fn main() -> Result<()> {
     // Create FormBD client
     let lithoglyph_client = lithoglyph::Client::new(&config.lithoglyph.api_url)?;
 
-    // Create spatial index
-    let spatial_index = index::SpatialIndex::new(config.index.max_memory_mb);
+    // Create spatial index: the engine's persistent tree when configured,
+    // which only needs the journal written since its last sync
+    let spatial_index = match (&config.index.engine_library, &config.index.database) {
+        (Some(library), Some(database)) => {
+            let engine = index::EngineIndex::open(
+                library.as_ref(),
+                database.as_ref(),
+                &config.lithoglyph.collection,
+                &config.lithoglyph.location_field,
+            )?;
+            let spatial_index = index::SpatialIndex::with_engine(config.index.max_memory_mb, engine);
+            if let Some(synced) = spatial_index.sync_engine() {
+                synced?;
+            }
+            spatial_index
+        }
+        _ => index::SpatialIndex::new(config.index.max_memory_mb),
+    };
 
     // Create application state
     let app_state = api::AppState::new(lithoglyph_client, spatial_index, config.clone());
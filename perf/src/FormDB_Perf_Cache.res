@@ -104,7 +104,13 @@ let stats = (cache: lruCache<'a>): {size: int, maxSize: int, hitRate: float} =>
   }
 }
 
-/** Global query plan cache */
+/**
+ * Global query plan cache
+ *
+ * Queries run through fdb_query_execute are planned and cached by the
+ * engine itself (per database, keyed by normalized text), so this cache
+ * is only for plans compiled on the client side.
+ */
 let queryPlanCache: lruCache<string> = make(~maxSize=1000, ~ttlMs=300000.0)
 
 /** Cache a query plan */
@@ -70,6 +70,25 @@ let gauge = (registry: metricsRegistry, name: string, ~labels: Js.Dict.t<string>
   m
 }
 
+/** Register histogram with fixed bucket upper bounds */
+let histogram = (
+  registry: metricsRegistry,
+  name: string,
+  ~buckets: array<float>,
+  ~labels: Js.Dict.t<string>=Js.Dict.empty(),
+): metric => {
+  let fullName = `${registry.prefix}_${name}`
+  let m = {
+    name: fullName,
+    metricType: Histogram,
+    value: HistogramValue({buckets, counts: buckets->Array.map(_ => 0)}),
+    labels,
+    timestamp: Js.Date.now(),
+  }
+  Js.Dict.set(registry.metrics, fullName, m)
+  m
+}
+
 /** Increment counter */
 let inc = (m: metric, ~by: int=1): unit => {
   switch m.value {
@@ -86,6 +105,26 @@ let set = (m: metric, value: float): unit => {
   }
 }
 
+/** Set counter to a running total kept elsewhere (e.g. by the engine) */
+let setTotal = (m: metric, total: int): unit => {
+  switch m.value {
+  | IntValue(_) => m.value = IntValue(total)
+  | _ => ()
+  }
+}
+
+/** Replace histogram bucket counts (same length as its buckets) */
+let setCounts = (m: metric, counts: array<int>): unit => {
+  switch m.value {
+  | HistogramValue({buckets}) =>
+    m.value = HistogramValue({
+      buckets,
+      counts: buckets->Array.mapWithIndex((_, i) => counts[i]->Option.getOr(0)),
+    })
+  | _ => ()
+  }
+}
+
 /** Timer context */
 type timerContext = {
   metric: metric,
@@ -141,6 +180,93 @@ let recordError = (): unit => {
   inc(errorCount)
 }
 
+/**
+ * Engine statistics
+ *
+ * Counters and commit phase histograms kept inside the storage engine and
+ * read with fdb_stats (formdb_nif:stats/1 on the BEAM). Timing only from
+ * the outside cannot tell journal I/O from block I/O; these can.
+ */
+
+/** Commit phases reported by fdb_stats, in commit order */
+let commitPhases = ["journal", "journal_write", "blocks", "deletes", "block_write", "publish"]
+
+/** fdb_stats bucket upper bounds in microseconds: 1, 2, 4, ... 2^31 */
+let engineBucketBounds = {
+  let bounds: array<float> = []
+  let bound = ref(1.0)
+  for _ in 1 to 32 {
+    bounds->Array.push(bound.contents)->ignore
+    bound := bound.contents *. 2.0
+  }
+  bounds
+}
+
+let engineBlocksRead = counter(registry, "engine_blocks_read_total")
+let engineBlocksWritten = counter(registry, "engine_blocks_written_total")
+let engineBytesWritten = counter(registry, "engine_bytes_written_total")
+let engineFsyncs = counter(registry, "engine_fsyncs_total")
+let engineCrcFailures = counter(registry, "engine_crc_failures_total")
+let engineCommitGroups = counter(registry, "engine_commit_groups_total")
+let engineCacheHits = counter(registry, "engine_cache_hits_total")
+let engineCacheMisses = counter(registry, "engine_cache_misses_total")
+let engineCommitPhases: Js.Dict.t<metric> =
+  commitPhases
+  ->Array.map(phase => (phase, histogram(registry, `engine_commit_${phase}_us`, ~buckets=engineBucketBounds)))
+  ->Js.Dict.fromArray
+
+let intField = (obj: Js.Dict.t<Js.Json.t>, key: string): int =>
+  switch Js.Dict.get(obj, key)->Option.flatMap(Js.Json.decodeNumber) {
+  | Some(n) => Float.toInt(n)
+  | None => 0
+  }
+
+let objectField = (obj: Js.Dict.t<Js.Json.t>, key: string): Js.Dict.t<Js.Json.t> =>
+  Js.Dict.get(obj, key)->Option.flatMap(Js.Json.decodeObject)->Option.getOr(Js.Dict.empty())
+
+/** Feed an fdb_stats JSON document into the registry. Returns false when
+ * it does not parse as an object; missing fields read as 0. */
+let recordEngineStats = (json: string): bool => {
+  let parsed = try {
+    Js.Json.parseExn(json)->Js.Json.decodeObject
+  } catch {
+  | _ => None
+  }
+
+  switch parsed {
+  | Some(stats) => {
+      setTotal(engineBlocksRead, intField(stats, "blocks_read"))
+      setTotal(engineBlocksWritten, intField(stats, "blocks_written"))
+      setTotal(engineBytesWritten, intField(stats, "bytes_written"))
+      setTotal(engineFsyncs, intField(stats, "fsyncs"))
+      setTotal(engineCrcFailures, intField(stats, "crc_failures"))
+      setTotal(engineCommitGroups, intField(stats, "commit_groups"))
+
+      let cache = objectField(stats, "cache")
+      setTotal(engineCacheHits, intField(cache, "hits"))
+      setTotal(engineCacheMisses, intField(cache, "misses"))
+
+      let phases = objectField(stats, "commit_phases")
+      commitPhases->Array.forEach(phase => {
+        switch Js.Dict.get(engineCommitPhases, phase) {
+        | Some(m) => {
+            let counts =
+              objectField(phases, phase)
+              ->Js.Dict.get("buckets")
+              ->Option.flatMap(Js.Json.decodeArray)
+              ->Option.getOr([])
+              ->Array.map(n => n->Js.Json.decodeNumber->Option.getOr(0.0)->Float.toInt)
+            setCounts(m, counts)
+          }
+        | None => ()
+        }
+      })
+      true
+    }
+  | None => false
+  }
+}
+
 /** Export metrics in Prometheus format */
 let exportPrometheus = (): string => {
   let lines: array<string> = []
@@ -151,7 +277,7 @@ let exportPrometheus = (): string => {
         let valueStr = switch m.value {
         | IntValue(v) => Int.toString(v)
         | FloatValue(v) => Float.toString(v)
-        | HistogramValue(_) => "0" // Simplified
+        | HistogramValue({counts}) => Int.toString(counts->Array.reduce(0, (a, b) => a + b))
         }
         lines->Array.push(`${m.name} ${valueStr}`)->ignore
       }